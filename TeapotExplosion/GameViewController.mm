@@ -24,6 +24,7 @@ struct thread_data{
 }
 
 @property (strong, nonatomic) EAGLContext *context;
+@property (strong, nonatomic) EAGLContext *backgroundContext;
 
 - (void)setupGL;
 - (void)tearDownGL;
@@ -31,6 +32,16 @@ struct thread_data{
 
 @end
 
+static void makeBackgroundContextCurrent(void *userData)
+{
+    [EAGLContext setCurrentContext:(__bridge EAGLContext *)userData];
+}
+
+static void releaseBackgroundContext(void *userData)
+{
+    [EAGLContext setCurrentContext:nil];
+}
+
 @implementation GameViewController
 
 - (void)viewDidLoad
@@ -44,12 +55,24 @@ struct thread_data{
                                                  encoding:NSASCIIStringEncoding]];
     jamesfolk::World::setBundlePath([path UTF8String]);
     
+    NSArray *cachePaths = NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES);
+    if ([cachePaths count] > 0)
+        jamesfolk::World::setCachePath([[cachePaths firstObject] UTF8String]);
+    
     self.context = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2];
 
     if (!self.context) {
         NSLog(@"Failed to create ES context");
     }
     
+    // Shares the render context's objects so shader variants can be compiled off the render thread.
+    self.backgroundContext = [[EAGLContext alloc] initWithAPI:kEAGLRenderingAPIOpenGLES2 sharegroup:self.context.sharegroup];
+    if (self.backgroundContext) {
+        jamesfolk::World::setBackgroundContext(makeBackgroundContextCurrent,
+                                               releaseBackgroundContext,
+                                               (__bridge void *)self.backgroundContext);
+    }
+    
     GLKView *view = (GLKView *)self.view;
     view.context = self.context;
     view.drawableDepthFormat = GLKViewDrawableDepthFormat24;
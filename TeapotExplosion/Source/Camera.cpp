@@ -27,6 +27,62 @@ namespace jamesfolk
         
         return btTransform(basis, origin);
     }
+    
+    // Column major 4x4 product, a * b.
+    static inline void multiply4x4Matrix(const float *a, const float *b, float *out)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            for (int row = 0; row < 4; row++)
+            {
+                out[column * 4 + row] = (a[0 * 4 + row] * b[column * 4 + 0] +
+                                         a[1 * 4 + row] * b[column * 4 + 1] +
+                                         a[2 * 4 + row] * b[column * 4 + 2] +
+                                         a[3 * 4 + row] * b[column * 4 + 3]);
+            }
+        }
+    }
+    
+    // General 4x4 inverse by cofactors.
+    static bool invert4x4Matrix(const float *m, float *out)
+    {
+        float inv[16];
+        
+        inv[0] = m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+        inv[4] = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+        inv[8] = m[4]*m[9]*m[15] - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+        inv[12] = -m[4]*m[9]*m[14] + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+        inv[1] = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+        inv[5] = m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+        inv[9] = -m[0]*m[9]*m[15] + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+        inv[13] = m[0]*m[9]*m[14] - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+        inv[2] = m[1]*m[6]*m[15] - m[1]*m[7]*m[14] - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7] - m[13]*m[3]*m[6];
+        inv[6] = -m[0]*m[6]*m[15] + m[0]*m[7]*m[14] + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7] + m[12]*m[3]*m[6];
+        inv[10] = m[0]*m[5]*m[15] - m[0]*m[7]*m[13] - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7] - m[12]*m[3]*m[5];
+        inv[14] = -m[0]*m[5]*m[14] + m[0]*m[6]*m[13] + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6] + m[12]*m[2]*m[5];
+        inv[3] = -m[1]*m[6]*m[11] + m[1]*m[7]*m[10] + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7] + m[9]*m[3]*m[6];
+        inv[7] = m[0]*m[6]*m[11] - m[0]*m[7]*m[10] - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7] - m[8]*m[3]*m[6];
+        inv[11] = -m[0]*m[5]*m[11] + m[0]*m[7]*m[9] + m[4]*m[1]*m[11] - m[4]*m[3]*m[9] - m[8]*m[1]*m[7] + m[8]*m[3]*m[5];
+        inv[15] = m[0]*m[5]*m[10] - m[0]*m[6]*m[9] - m[4]*m[1]*m[10] + m[4]*m[2]*m[9] + m[8]*m[1]*m[6] - m[8]*m[2]*m[5];
+        
+        float det = m[0] * inv[0] + m[1] * inv[4] + m[2] * inv[8] + m[3] * inv[12];
+        if(det == 0.0f)
+            return false;
+        
+        det = 1.0f / det;
+        for (int i = 0; i < 16; i++)
+            out[i] = inv[i] * det;
+        return true;
+    }
+    
+    static inline btVector3 transformPoint4x4Matrix(const float *m, float x, float y, float z)
+    {
+        const float w = m[3] * x + m[7] * y + m[11] * z + m[15];
+        
+        return btVector3(m[0] * x + m[4] * y + m[8] * z + m[12],
+                         m[1] * x + m[5] * y + m[9] * z + m[13],
+                         m[2] * x + m[6] * y + m[10] * z + m[14]) / w;
+    }
 
     btTransform Camera::makeFrustum(float *matrixBuffer, float fov, float aspect, float nearDist, float farDist, bool leftHanded )
     {
@@ -243,6 +299,27 @@ namespace jamesfolk
         getNodeOwner()->setOrientation(q);
     }
     
+    void Camera::unProject(const btVector2 &ndc, btVector3 &nearPoint, btVector3 &farPoint)const
+    {
+        // Same order as the vertex shader: (modelView * projection) * position.
+        float modelView[16];
+        float viewProjection[16];
+        float inverse[16];
+        
+        getModelView().getOpenGLMatrix(modelView);
+        multiply4x4Matrix(modelView, m_ProjectionMatrixBuffer, viewProjection);
+        
+        if(!invert4x4Matrix(viewProjection, inverse))
+        {
+            nearPoint = farPoint = btVector3(0, 0, 0);
+            return;
+        }
+        
+        // makeFrustum maps the near plane to z = 0 and the far plane to z = 1.
+        nearPoint = transformPoint4x4Matrix(inverse, ndc.x(), ndc.y(), 0.0f);
+        farPoint = transformPoint4x4Matrix(inverse, ndc.x(), ndc.y(), 1.0f);
+    }
+    
     void Camera::render(Shader *const shader, bool shouldRedraw)
     {
         if(m_ModelViewDirty || shouldRedraw)
@@ -13,6 +13,7 @@
 #import <OpenGLES/ES2/gl.h>
 
 #include "btTransform.h"
+#include "btVector2.h"
 
 namespace jamesfolk
 {
@@ -55,6 +56,10 @@ namespace jamesfolk
         void setNodeOwner(Node *const node);
         
         void lookAt(const btVector3& pos, const btVector3& up = btVector3(0, 1.0f, 0));
+        
+        // World space points on the near and far planes under a point in
+        // normalized device coordinates.
+        void unProject(const btVector2 &ndc, btVector3 &nearPoint, btVector3 &farPoint)const;
     protected:
         void render(Shader *const shader, bool shouldRedraw = false);
     private:
@@ -32,6 +32,8 @@ namespace jamesfolk
     m_NumberSubDivisions(1),
     m_ExtraSubdivisionBuffer(1),
     m_Shader(NULL),
+    m_ActiveShader(NULL),
+    m_ShaderVariants(NULL),
     m_OpacityModifyRGB(false),
     m_ElementBufferChanged(true),
     m_VertexBufferChanged(true),
@@ -65,6 +67,7 @@ namespace jamesfolk
         assert(m_MatrixBufferFullSize);
         
         m_References.resize(m_NumberInstances);
+        m_InstanceRevisions.resize(m_NumberInstances, 0);
     }
     
     
@@ -97,6 +100,7 @@ namespace jamesfolk
             m_ExtraSubdivisionBuffer *= 4;
         
         m_References.resize(m_NumberInstances);
+        m_InstanceRevisions.resize(m_NumberInstances, 0);
         
         loadData();
         
@@ -252,9 +256,55 @@ namespace jamesfolk
         m_ShaderChanged = true;
     }
     
+    void Geometry::setShaderVariants(ShaderVariantCache *const variants)
+    {
+        m_ShaderVariants = variants;
+    }
+    
+    ShaderVariantCache *const Geometry::getShaderVariants()
+    {
+        return m_ShaderVariants;
+    }
+    
+    ShaderVariantCache::Key Geometry::getShaderPermutation()const
+    {
+        ShaderVariantCache::Key key = ShaderVariantCache::Feature_None;
+        
+        if(getRimLightCoefficient() != 0.0f && getRimLightColor().length2() > 0.0f)
+            key |= ShaderVariantCache::Feature_RimLight;
+        
+        if(getLightSourceSpotCutoff() != 180.0f)
+            key |= ShaderVariantCache::Feature_SpotLight;
+        
+        if(getLightSourceConstantAttenuation() != 1.0f ||
+           getLightSourceLinearAttenuation() != 0.0f ||
+           getLightSourceQuadraticAttenuation() != 0.0f)
+            key |= ShaderVariantCache::Feature_Attenuation;
+        
+        // Same choice as the general shader, which applies linear fog
+        // whenever the density is not positive.
+        if(getFogDensity() > 0.0f)
+            key |= ShaderVariantCache::Feature_ExponentialFog;
+        else
+            key |= ShaderVariantCache::Feature_LinearFog;
+        
+        return key;
+    }
+    
     void Geometry::render(Camera *camera)
     {
         Shader *shader = getShader();
+        ShaderVariantCache::Key features = ShaderVariantCache::Feature_All;
+        
+        if(shader && m_ShaderVariants && m_ShaderVariants->getGeneralShader() == shader)
+            shader = m_ShaderVariants->getShader(getShaderPermutation(), features);
+        
+        if(shader != m_ActiveShader)
+        {
+            m_ActiveShader = shader;
+            m_ShaderChanged = true;
+        }
+        
         if(shader && camera)
         {
             assert(shader->use());
@@ -302,10 +352,13 @@ namespace jamesfolk
 //            glBindTexture(GL_TEXTURE_2D, m_SpecularTexture);
 //            shader->setUniformValue("tSpecularColor", m_SpecularTexture);
             
-            shader->setUniformValue("RimLightColor", getRimLightColor());
-            shader->setUniformValue("RimLightStart", getRimLightStart());
-            shader->setUniformValue("RimLightEnd", getRimLightEnd());
-            shader->setUniformValue("RimLightCoefficient", getRimLightCoefficient());
+            if(features & ShaderVariantCache::Feature_RimLight)
+            {
+                shader->setUniformValue("RimLightColor", getRimLightColor());
+                shader->setUniformValue("RimLightStart", getRimLightStart());
+                shader->setUniformValue("RimLightEnd", getRimLightEnd());
+                shader->setUniformValue("RimLightCoefficient", getRimLightCoefficient());
+            }
             
             shader->setUniformValue("LightSourceAmbientColor", getLightSourceAmbientColor());
             shader->setUniformValue("LightSourceDiffuseColor", getLightSourceDiffuseColor());
@@ -313,24 +366,37 @@ namespace jamesfolk
             
             shader->setUniformValue("LightSourcePosition_worldspace", getLightSourcePosition());
             
-            shader->setUniformValue("LightSourceSpotDirection", getLightSourceSpotDirection());
-            shader->setUniformValue("LightSourceSpotExponent", getLightSourceSpotExponent());
-            
-            shader->setUniformValue("LightSourceSpotCutoff", getLightSourceSpotCutoff());
-            shader->setUniformValue("LightSourceSpotCosCutoff", getLightSourceSpotCosCutoff());
+            if(features & ShaderVariantCache::Feature_SpotLight)
+            {
+                shader->setUniformValue("LightSourceSpotDirection", getLightSourceSpotDirection());
+                shader->setUniformValue("LightSourceSpotExponent", getLightSourceSpotExponent());
+                
+                shader->setUniformValue("LightSourceSpotCutoff", getLightSourceSpotCutoff());
+                shader->setUniformValue("LightSourceSpotCosCutoff", getLightSourceSpotCosCutoff());
+            }
             
-            shader->setUniformValue("LightSourceConstantAttenuation", getLightSourceConstantAttenuation());
-            shader->setUniformValue("LightSourceLinearAttenuation", getLightSourceLinearAttenuation());
-            shader->setUniformValue("LightSourceQuadraticAttenuation", getLightSourceQuadraticAttenuation());
+            if(features & ShaderVariantCache::Feature_Attenuation)
+            {
+                shader->setUniformValue("LightSourceConstantAttenuation", getLightSourceConstantAttenuation());
+                shader->setUniformValue("LightSourceLinearAttenuation", getLightSourceLinearAttenuation());
+                shader->setUniformValue("LightSourceQuadraticAttenuation", getLightSourceQuadraticAttenuation());
+            }
             
             shader->setUniformValue("LightAmbientColor", getLightAmbientColor());
             
             shader->setUniformValue("MaterialShininess", getMaterialShininess());
             
-            shader->setUniformValue("FogMaxDistance", getFogMaxDistance());
-            shader->setUniformValue("FogMinDistance", getFogMinDistance());
-            shader->setUniformValue("FogColor", getFogColor());
-            shader->setUniformValue("FogDensity", getFogDensity());
+            if(features & (ShaderVariantCache::Feature_LinearFog | ShaderVariantCache::Feature_ExponentialFog))
+                shader->setUniformValue("FogColor", getFogColor());
+            
+            if(features & ShaderVariantCache::Feature_LinearFog)
+            {
+                shader->setUniformValue("FogMaxDistance", getFogMaxDistance());
+                shader->setUniformValue("FogMinDistance", getFogMinDistance());
+            }
+            
+            if(features & ShaderVariantCache::Feature_ExponentialFog)
+                shader->setUniformValue("FogDensity", getFogDensity());
             
             m_ShaderChanged = false;
             
@@ -391,82 +457,43 @@ namespace jamesfolk
     {
         return node->getGeometryIndex();
     }
-    
-    void computeTangentBasis(
-                             // inputs
-                             const std::vector<btVector3> & vertices,
-                             const std::vector<btVector2> & uvs,
-                             const std::vector<btVector3> & normals,
-                             // outputs
-                             std::vector<btVector3> & tangents,
-                             std::vector<btVector3> & bitangents
-                             )
+
+    btVector3 Geometry::getVertexWorldPosition(const GLsizei instanceIdx, const GLsizei verticeIdx)const
     {
-        
-        tangents.clear();
-        bitangents.clear();
-        tangents.resize(vertices.size());
-        bitangents.resize(vertices.size());
-        
-        for (unsigned int i=0; i<vertices.size(); i+=3 )
-        {
-            
-            // Shortcuts for vertices
-            btVector3  v0 = vertices[i+0];
-            btVector3  v1 = vertices[i+1];
-            btVector3  v2 = vertices[i+2];
-            
-            // Shortcuts for UVs
-            btVector2  uv0 = uvs[i+0];
-            btVector2  uv1 = uvs[i+1];
-            btVector2  uv2 = uvs[i+2];
-            
-            // Edges of the triangle : postion delta
-            btVector3 deltaPos1 = v1-v0;
-            btVector3 deltaPos2 = v2-v0;
-            
-            // UV delta
-            btVector2 deltaUV1 = uv1-uv0;
-            btVector2 deltaUV2 = uv2-uv0;
-            
-            float r = 1.0f / (deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x());
-            btVector3 tangent = (deltaPos1 * deltaUV2.y()   - deltaPos2 * deltaUV1.y())*r;
-            btVector3 bitangent = (deltaPos2 * deltaUV1.x()   - deltaPos1 * deltaUV2.x())*r;
-            
-            // Set the same tangent for all three vertices of the triangle.
-            // They will be merged later, in vboindexer.cpp
-            tangents[i] = tangent;
-            tangents[i+1] = tangent;
-            tangents[i+2] = tangent;
-            
-            // Same thing for binormals
-            bitangents[i] = bitangent;
-            bitangents[i+1] = bitangent;
-            bitangents[i+2] = bitangent;
-            
-        }
-        
-        // See "Going Further"
-        for (unsigned int i=0; i<vertices.size(); i+=1 )
+        const btVector3 v(getVertexPosition(instanceIdx, verticeIdx));
+
+        if(instanceIdx < maxNumberOfInstances() &&
+           verticeIdx < numberOfVertices())
         {
-            btVector3  n = normals[i];
-            btVector3  t = tangents[i];
-            btVector3  b = bitangents[i];
-            
-            
-            // Gram-Schmidt orthogonalize
-            t = (t - n * n.dot(t)).normalized();
-            
-            
-            // Calculate handedness
-            if (n.cross(t).dot(b) < 0.0f)
-            {
-                t = t * -1.0f;
-            }
-            
+            // Column major, as uploaded for inTransform.
+            const GLfloat *m = m_ModelViewTransformData + (((instanceIdx * numberOfVertices()) + verticeIdx) * 16);
+
+            return btVector3(m[0] * v.x() + m[4] * v.y() + m[8] * v.z() + m[12],
+                             m[1] * v.x() + m[5] * v.y() + m[9] * v.z() + m[13],
+                             m[2] * v.x() + m[6] * v.y() + m[10] * v.z() + m[14]);
         }
+        return v;
     }
-    
+
+    GLsizei Geometry::numberOfInstances()const
+    {
+        return maxNumberOfInstances();
+    }
+
+    bool Geometry::isInstanceReferenced(const GLsizei instanceIdx)const
+    {
+        if(instanceIdx < m_References.size())
+            return m_References[instanceIdx];
+        return false;
+    }
+
+    unsigned long Geometry::getInstanceRevision(const GLsizei instanceIdx)const
+    {
+        if(instanceIdx < m_InstanceRevisions.size())
+            return m_InstanceRevisions[instanceIdx];
+        return 0;
+    }
+
     void Geometry::setRimLightColor(const btVector3 &color)
     {
         m_RimLightColor = color;
@@ -850,6 +877,7 @@ namespace jamesfolk
             
             transform.getOpenGLMatrix(m_MatrixBuffer);
             
+            bool changed = false;
             for (int currentVertex = 0; currentVertex < numberOfVertices(); currentVertex++)
             {
                 unsigned long p = ((index * STRIDE) + (16 * currentVertex));
@@ -860,8 +888,11 @@ namespace jamesfolk
                 if(0 != cmp)
                 {
                     memcpy(m_ModelViewTransformData + p, m_MatrixBuffer, sizeof(GLfloat) * 16);
+                    changed = true;
                 }
             }
+            if(changed)
+                m_InstanceRevisions[index]++;
             enableModelViewBufferChanged(true);
         }
     }
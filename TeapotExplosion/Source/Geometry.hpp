@@ -19,6 +19,8 @@
 #include "btTransform.h"
 #include "btVector2.h"
 
+#include "ShaderVariantCache.hpp"
+
 namespace jamesfolk
 {
     static const GLfloat TRANSFORM_IDENTITY_MATRIX[] =
@@ -32,68 +34,6 @@ namespace jamesfolk
     ATTRIBUTE_ALIGNED16(struct)
     TexturedColoredVertex
     {
-        static void computeTangentBasis(TexturedColoredVertex *v, unsigned int numVerts)
-        {
-            for (unsigned int i=0; i<numVerts; i+=3 )
-            {
-                // Shortcuts for vertices
-                btVector3  v0 = (v + (i + 0))->vertex;
-                btVector3  v1 = (v + (i + 1))->vertex;
-                btVector3  v2 = (v + (i + 2))->vertex;
-                
-                // Shortcuts for UVs
-                btVector2  uv0 = (v + (i + 0))->texture;
-                btVector2  uv1 = (v + (i + 1))->texture;
-                btVector2  uv2 = (v + (i + 2))->texture;
-                
-                // Edges of the triangle : postion delta
-                btVector3 deltaPos1 = v1-v0;
-                btVector3 deltaPos2 = v2-v0;
-                
-                // UV delta
-                btVector2 deltaUV1 = uv1-uv0;
-                btVector2 deltaUV2 = uv2-uv0;
-                
-                float d = (deltaUV1.x() * deltaUV2.y() - deltaUV1.y() * deltaUV2.x());
-                
-                float r = (d!=0.0f)?(1.0f / d):0.0f;
-                btVector3 tangent = (deltaPos1 * deltaUV2.y()   - deltaPos2 * deltaUV1.y())*r;
-                btVector3 bitangent = (deltaPos2 * deltaUV1.x()   - deltaPos1 * deltaUV2.x())*r;
-                
-                // Set the same tangent for all three vertices of the triangle.
-                // They will be merged later, in vboindexer.cpp
-                (v + (i + 0))->tangent = tangent;
-                (v + (i + 1))->tangent = tangent;
-                (v + (i + 2))->tangent = tangent;
-                
-                // Same thing for binormals
-                (v + (i + 0))->bitangent = bitangent;
-                (v + (i + 1))->bitangent = bitangent;
-                (v + (i + 2))->bitangent = bitangent;
-            }
-            
-            // See "Going Further"
-//            for (unsigned int i=0; i<numVerts; i+=1 )
-//            {
-//                btVector3 & n = (v + (i))->normal;
-//                btVector3 & t = (v + (i))->tangent;
-//                btVector3 & b = (v + (i))->bitangent;
-//                
-//                
-//                // Gram-Schmidt orthogonalize
-//                t = (t - n * n.dot(t));
-//                
-//                if(t.length() > 0.0f)
-//                    t.normalize();
-//                
-//                // Calculate handedness
-//                if (n.cross(t).dot(b) < 0.0f)
-//                {
-//                    t = t * -1.0f;
-//                }
-//            }
-        }
-        
         TexturedColoredVertex()
         : vertex(0, 0, 0)
         , color(1, 1, 1, 1)
@@ -159,7 +99,7 @@ namespace jamesfolk
             ret.texture = (a.texture + b.texture) / 2.0f;
             ret.normal = (a.normal + b.normal) / 2.0f;
             ret.tangent = (a.tangent + b.tangent) / 2.0f;
-            ret.bitangent = (a.vertex + b.bitangent) / 2.0f;
+            ret.bitangent = (a.bitangent + b.bitangent) / 2.0f;
             
 //            ret.vertex.setW(1.0);
             ret.color.setW(1.0);
@@ -204,6 +144,12 @@ namespace jamesfolk
         
         void setShader(Shader *const shader);
         
+        // Render with the permutation of the shader that matches the enabled
+        // features, once it has been compiled by the variant cache.
+        void setShaderVariants(ShaderVariantCache *const variants);
+        ShaderVariantCache *const getShaderVariants();
+        ShaderVariantCache::Key getShaderPermutation()const;
+        
         void render(Camera *camera);
         
         virtual void subdivide() = 0;
@@ -215,7 +161,7 @@ namespace jamesfolk
             if(instanceIdx < maxNumberOfInstances() &&
                verticeIdx < numberOfVertices())
             {
-                GLsizei idx = (instanceIdx * numberOfVertices());
+                GLsizei idx = (instanceIdx * numberOfVertices() * 16);
                 idx += (verticeIdx * 16);
                 
                 t.getOpenGLMatrix(m_MatrixBufferFullSize);
@@ -223,6 +169,7 @@ namespace jamesfolk
                        m_MatrixBufferFullSize,
                        sizeof(TRANSFORM_IDENTITY_MATRIX));
                 enableModelViewBufferChanged();
+                m_InstanceRevisions[instanceIdx]++;
             }
         }
         
@@ -231,7 +178,7 @@ namespace jamesfolk
             if(instanceIdx < maxNumberOfInstances() &&
                verticeIdx < numberOfVertices())
             {
-                GLsizei idx = (instanceIdx * numberOfVertices());
+                GLsizei idx = (instanceIdx * numberOfVertices() * 16);
                 idx += (verticeIdx * 16);
                 
                 memcpy(m_MatrixBufferFullSize,
@@ -264,6 +211,15 @@ namespace jamesfolk
         virtual GLsizei numberOfVertices()const = 0;
         virtual GLsizei numberOfIndices()const = 0;
         
+        // Position of a vertex after its per vertex transform.
+        btVector3 getVertexWorldPosition(const GLsizei instanceIdx, const GLsizei verticeIdx)const;
+        
+        GLsizei numberOfInstances()const;
+        bool isInstanceReferenced(const GLsizei instanceIdx)const;
+        // Changes whenever a vertex transform of the instance is written.
+        unsigned long getInstanceRevision(const GLsizei instanceIdx)const;
+        unsigned long getGeometryIndex(Node *const node)const;
+        
         void setRimLightColor(const btVector3 &color);
         const btVector3 &getRimLightColor()const;
         
@@ -377,8 +333,6 @@ namespace jamesfolk
         virtual GLsizei maxNumberOfSubDivisions()const;
         virtual GLsizei subdivisionBufferSize()const;
         
-        unsigned long getGeometryIndex(Node *const node)const;
-        
         GLfloat *m_MatrixBuffer;
         float *m_MatrixBufferFullSize;
         
@@ -393,11 +347,14 @@ namespace jamesfolk
         GLuint m_IndexBuffer;
         
         std::vector<bool> m_References;
+        std::vector<unsigned long> m_InstanceRevisions;
         GLsizei m_NumberInstances;
         GLsizei m_NumberSubDivisions;
         GLsizei m_ExtraSubdivisionBuffer;
         
         Shader *m_Shader;
+        Shader *m_ActiveShader;
+        ShaderVariantCache *m_ShaderVariants;
         
         bool m_OpacityModifyRGB;
         bool m_ElementBufferChanged;
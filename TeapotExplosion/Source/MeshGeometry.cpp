@@ -9,6 +9,7 @@
 #include "MeshGeometry.hpp"
 
 #include "Node.hpp"
+#include "TangentSpace.hpp"
 #include <string>
 #include <iostream>
 #include <sstream>
@@ -27,13 +28,17 @@ namespace jamesfolk
     m_NumberOfIndices(0),
     m_TotalSubdivisions(0),
     m_triangleBuffer(new TexturedColoredVertex[12]),
-    m_indiceBuffer(new GLuint[12])
+    m_indiceBuffer(new GLuint[12]),
+    m_TangentSpace(new TangentSpace())
     {
     }
     
     
     MeshGeometry::~MeshGeometry()
     {
+        delete m_TangentSpace;
+        m_TangentSpace = NULL;
+        
         delete [] m_indiceBuffer;
         m_indiceBuffer = NULL;
         
@@ -93,6 +98,8 @@ namespace jamesfolk
                        sizeof(GLuint) * 12);
             }
             
+            m_TangentSpace->generate(m_VertexDataBuffer, numberOfVertices());
+            
             enableVertexArrayBufferChanged(true);
             enableIndiceArrayBufferChanged(true);
             
@@ -143,11 +150,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].vertex;
+            ret = m_VertexData[idx].vertex;
         }
         
         return ret;
@@ -163,11 +166,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].color;
+            ret = m_VertexData[idx].color;
         }
         
         return ret;
@@ -183,11 +182,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].texture;
+            ret = m_VertexData[idx].texture;
         }
         
         return ret;
@@ -203,11 +198,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].normal;
+            ret = m_VertexData[idx].normal;
         }
         
         return ret;
@@ -223,11 +214,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].tangent;
+            ret = m_VertexData[idx].tangent;
         }
         
         return ret;
@@ -243,11 +230,7 @@ namespace jamesfolk
             GLsizei idx = (instanceIdx * numberOfVertices());
             idx += (verticeIdx * 1);
             
-            memcpy(m_triangleBuffer,
-                   m_VertexData + idx,
-                   sizeof(TexturedColoredVertex) * 12);
-            
-            ret = m_triangleBuffer[0].bitangent;
+            ret = m_VertexData[idx].bitangent;
         }
         
         return ret;
@@ -449,6 +432,8 @@ namespace jamesfolk
             indiceData[idx] = (GLuint)idx;
         }
         
+        m_TangentSpace->generate(vertexData, numberOfVertices());
+        
         Geometry::loadData();
         
         assert(m_VertexData == NULL);
@@ -492,8 +477,6 @@ namespace jamesfolk
             }
         }
         
-        TexturedColoredVertex::computeTangentBasis(m_VertexData, numberOfVertices());
-        
         delete [] indiceData;
         indiceData = NULL;
         
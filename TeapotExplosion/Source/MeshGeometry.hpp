@@ -13,6 +13,8 @@
 
 namespace jamesfolk
 {
+    class TangentSpace;
+    
     class MeshGeometry : public Geometry
     {
     public:
@@ -77,6 +79,8 @@ namespace jamesfolk
         TexturedColoredVertex *m_triangleBuffer;
         GLuint *m_indiceBuffer;
         
+        TangentSpace *m_TangentSpace;
+        
     };
 }
 
@@ -17,19 +17,23 @@
 namespace jamesfolk
 {
     Node::Node():
+    m_Transform(btTransform::getIdentity()),
+    m_NormalMatrix(btMatrix3x3::getIdentity()),
+//    m_ColorTransform(btTransform::getIdentity()),
+    m_Orientation(),
+    m_Colorbase(1, 1, 1, 1),
+    m_Scale(1.0f, 1.0f, 1.0f),
+    m_GravityForce(0.0f, 0.0f, 0.0f),
+    m_ImpulseForce(0.0f, 0.0f, 0.0f),
+    m_CurrentVelocity(0.0f, 0.0f, 0.0f),
+    m_HeadingVector(0.0f, 0.0f, 0.0f),
     m_Name("NODE"),
-    m_Scale(new btVector3(1.0f, 1.0f, 1.0f)),
-    m_Transform(new btTransform(btTransform::getIdentity())),
-//    m_ColorTransform(new btTransform(btTransform::getIdentity())),
-    m_Orientation(new btQuaternion()),
     m_ParentNode(NULL),
     m_Camera(NULL),
     m_Geometry(NULL),
     m_GeometryIndex(-1),
     m_HideGeometry(false),
     m_Opacity(1.0f),
-    m_NormalMatrix(new btMatrix3x3(btMatrix3x3::getIdentity())),
-    m_Colorbase(new btVector4(1, 1, 1, 1)),
     m_PhysicsBody(NULL),
     m_TransformDirty(true),
     m_NormalMatrixDirty(true),
@@ -37,10 +41,6 @@ namespace jamesfolk
     m_OpacityDirty(true),
     m_HiddenDirty(true),
     m_ColorBaseDirty(true),
-    m_GravityForce(new btVector3(0.0f, 0.0f, 0.0f)),
-    m_ImpulseForce(new btVector3(0.0f, 0.0f, 0.0f)),
-    m_CurrentVelocity(new btVector3(0.0f, 0.0f, 0.0f)),
-    m_HeadingVector(new btVector3(0.0f, 0.0f, 0.0f)),
     m_MaxSpeed(std::numeric_limits<float>::max())
     {
         
@@ -48,38 +48,8 @@ namespace jamesfolk
     
     Node::~Node()
     {
-        delete m_HeadingVector;
-        m_HeadingVector = NULL;
-        
-        delete m_CurrentVelocity;
-        m_CurrentVelocity = NULL;
-        
-        delete m_ImpulseForce;
-        m_ImpulseForce = NULL;
-        
-        delete m_GravityForce;
-        m_GravityForce = NULL;
-        
-        delete m_Colorbase;
-        m_Colorbase = NULL;
-        
-        delete m_NormalMatrix;
-        m_NormalMatrix = NULL;
-        
         m_Camera = NULL;
         m_ParentNode = NULL;
-        
-        delete m_Orientation;
-        m_Orientation = NULL;
-        
-//        delete m_ColorTransform;
-//        m_ColorTransform = NULL;
-        
-        delete m_Transform;
-        m_Transform = NULL;
-        
-        delete m_Scale;
-        m_Scale = NULL;
     }
     
     void Node::setName(const std::string &name)
@@ -164,25 +134,25 @@ namespace jamesfolk
     
     void Node::setNormalMatrix(const btMatrix3x3 &mtx)
     {
-        *m_NormalMatrix = mtx;
+        m_NormalMatrix = mtx;
         m_NormalMatrixDirty = true;
     }
     
     const btMatrix3x3 &Node::getNormalMatrix()const
     {
-        return *m_NormalMatrix;
+        return m_NormalMatrix;
     }
     
     void Node::setColorBase(const btVector4 &color)
     {
-        if(*m_Colorbase != color)
+        if(m_Colorbase != color)
             m_ColorBaseDirty = true;
-        *m_Colorbase = color;
+        m_Colorbase = color;
     }
     
     const btVector4 &Node::getColorBase()const
     {
-        return *m_Colorbase;
+        return m_Colorbase;
     }
     
     Node *Node::getParentNode()
@@ -412,14 +382,14 @@ namespace jamesfolk
     
     const btTransform &Node::getTransform()const
     {
-        return *m_Transform;
+        return m_Transform;
     }
     
     void Node::setTransform(const btTransform &transform)
     {
         m_TransformDirty = true;
         
-        *m_Transform = transform;
+        m_Transform = transform;
         
         PhysicsBody *physicsBody = m_PhysicsBody;
         
@@ -463,7 +433,7 @@ namespace jamesfolk
     {
         float x, y, z;
         
-        m_Transform->getBasis().getEulerYPR(x, y, z);
+        m_Transform.getBasis().getEulerYPR(x, y, z);
         
         btVector3 v(x,y,z);
         return v;
@@ -480,22 +450,22 @@ namespace jamesfolk
     
     const btQuaternion &Node::getOrientation()const
     {
-        return *m_Orientation;
+        return m_Orientation;
     }
     
     void Node::setOrientation(const btQuaternion &orientation)
     {
-        *m_Orientation = orientation;
+        m_Orientation = orientation;
     }
     
     const btVector3 &Node::getScale()const
     {
-        return *m_Scale;
+        return m_Scale;
     }
     
     void Node::setScale(const btVector3 &scale)
     {
-        *m_Scale = scale;
+        m_Scale = scale;
     }
     
     void Node::setScale(const float scale)
@@ -594,22 +564,22 @@ namespace jamesfolk
     
     void Node::setGravity(const btVector3 &vec)
     {
-        *m_GravityForce = vec;
+        m_GravityForce = vec;
     }
     
     void Node::setVelocity(const btVector3 &vec)
     {
-        *m_CurrentVelocity = vec;
+        m_CurrentVelocity = vec;
     }
     
     const btVector3 &Node::getVelocity()const
     {
-        return *m_CurrentVelocity;
+        return m_CurrentVelocity;
     }
     
     void Node::addImpulseForce(const btVector3 &vec)
     {
-        *m_ImpulseForce += vec;
+        m_ImpulseForce += vec;
     }
     
     void Node::setMaxSpeed(float speed)
@@ -626,21 +596,21 @@ namespace jamesfolk
     {
         float mass = 1.0f;
         
-        *m_ImpulseForce += *m_GravityForce;
+        m_ImpulseForce += m_GravityForce;
         
-        btVector3 acceleration((*m_ImpulseForce) / mass);
+        btVector3 acceleration(m_ImpulseForce / mass);
         
         setVelocity(getVelocity() + acceleration * timestep);
         if(getVelocity().length() > getMaxSpeed())
             setVelocity(getVelocity().normalized() * getMaxSpeed());
         
-        setOrigin(getTransform().getOrigin() + (*m_CurrentVelocity) * timestep);
+        setOrigin(getTransform().getOrigin() + m_CurrentVelocity * timestep);
         
-        if(m_CurrentVelocity->length() > 0.00000001)
+        if(m_CurrentVelocity.length() > 0.00000001)
         {
-            *m_HeadingVector = m_CurrentVelocity->normalized();
+            m_HeadingVector = m_CurrentVelocity.normalized();
         }
-        *m_ImpulseForce = btVector3(0,0,0);
+        m_ImpulseForce = btVector3(0,0,0);
     }
     void Node::render(Geometry *const geometry)
     {
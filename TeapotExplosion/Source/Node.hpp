@@ -24,12 +24,14 @@ namespace jamesfolk
     
     class TornadoData;
     
-    class Node
+    ATTRIBUTE_ALIGNED16(class) Node
     {
         friend class Geometry;
         friend class Scene;
         
     public:
+        BT_DECLARE_ALIGNED_ALLOCATOR();
+        
         /* members */
         Node();
         Node(const Node &rhs);
@@ -122,11 +124,20 @@ namespace jamesfolk
         void update(float timestep);
         void render(Geometry *const geometry);
     private:
+        // The vector math members are stored inline (16 byte aligned) so a
+        // node is a single allocation, or none when it comes from a NodePool.
+        btTransform m_Transform;
+        btMatrix3x3 m_NormalMatrix;
+//        btTransform m_ColorTransform;
+        btQuaternion m_Orientation;
+        btVector4 m_Colorbase;
+        btVector3 m_Scale;
+        btVector3 m_GravityForce;
+        btVector3 m_ImpulseForce;
+        btVector3 m_CurrentVelocity;
+        btVector3 m_HeadingVector;
+        
         std::string m_Name;
-        btVector3 *m_Scale;
-        btTransform* m_Transform;
-//        btTransform* m_ColorTransform;
-        btQuaternion* m_Orientation;
         
         Node* m_ParentNode;
         std::vector<Node*> m_ChildrenNodes;
@@ -137,8 +148,6 @@ namespace jamesfolk
         
         bool m_HideGeometry;
         float m_Opacity;
-        btMatrix3x3 *m_NormalMatrix;
-        btVector4 *m_Colorbase;
         
         PhysicsBody *m_PhysicsBody;
         
@@ -149,10 +158,6 @@ namespace jamesfolk
         bool m_HiddenDirty;
         bool m_ColorBaseDirty;
         
-        btVector3 *m_GravityForce;
-        btVector3 *m_ImpulseForce;
-        btVector3 *m_CurrentVelocity;
-        btVector3 *m_HeadingVector;
         float m_MaxSpeed;
         
     };
@@ -0,0 +1,146 @@
+//
+//  NodePool.cpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#include "NodePool.hpp"
+#include "Node.hpp"
+
+#include "btPoolAllocator.h"
+
+#include <assert.h>
+#include <new>
+
+namespace jamesfolk
+{
+    // Round the element up so every node in a slab stays 16 byte aligned.
+    static const int NODE_ELEMENT_SIZE = (int)((sizeof(Node) + 15) & ~(size_t)15);
+
+    NodePool::NodePool(unsigned long nodesPerSlab):
+    m_NodesPerSlab(nodesPerSlab > 0 ? nodesPerSlab : 1),
+    m_NumberOfNodes(0),
+    m_FreeSlab(0)
+    {
+    }
+
+    NodePool::~NodePool()
+    {
+        assert(m_NumberOfNodes == 0);
+
+        while(!m_Slabs.empty())
+        {
+            btPoolAllocator *slab = m_Slabs.back();
+            delete slab;
+
+            m_Slabs.pop_back();
+        }
+    }
+
+    Node *NodePool::create()
+    {
+        btPoolAllocator *slab = getFreeSlab();
+
+        Node *node = new (slab->allocate(NODE_ELEMENT_SIZE)) Node();
+        m_NumberOfNodes++;
+
+        return node;
+    }
+
+    void NodePool::destroy(Node *node)
+    {
+        if(node)
+        {
+            btPoolAllocator *slab = findSlab(node);
+            assert(slab);
+
+            node->~Node();
+            slab->freeMemory(node);
+            m_NumberOfNodes--;
+
+            m_FreeSlab = 0;
+        }
+    }
+
+    void NodePool::create(unsigned long count, std::vector<Node*> &nodes)
+    {
+        nodes.reserve(nodes.size() + count);
+
+        for (unsigned long i = 0; i < count; i++)
+            nodes.push_back(create());
+    }
+
+    void NodePool::destroy(std::vector<Node*> &nodes)
+    {
+        btPoolAllocator *slab = NULL;
+
+        for (std::vector<Node*>::iterator i = nodes.begin();
+             i != nodes.end();
+             i++)
+        {
+            Node *node = *i;
+            if(!node)
+                continue;
+
+            // Nodes created together share a slab, so try the last one first.
+            if(!slab || !slab->validPtr(node))
+                slab = findSlab(node);
+            assert(slab);
+
+            node->~Node();
+            slab->freeMemory(node);
+            m_NumberOfNodes--;
+        }
+        nodes.clear();
+
+        m_FreeSlab = 0;
+    }
+
+    bool NodePool::owns(const Node *node)const
+    {
+        return (findSlab(node) != NULL);
+    }
+
+    unsigned long NodePool::numberOfNodes()const
+    {
+        return m_NumberOfNodes;
+    }
+
+    unsigned long NodePool::numberOfSlabs()const
+    {
+        return m_Slabs.size();
+    }
+
+    unsigned long NodePool::getNodesPerSlab()const
+    {
+        return m_NodesPerSlab;
+    }
+
+    btPoolAllocator *NodePool::getFreeSlab()
+    {
+        for (; m_FreeSlab < m_Slabs.size(); m_FreeSlab++)
+        {
+            if(m_Slabs[m_FreeSlab]->getFreeCount() > 0)
+                return m_Slabs[m_FreeSlab];
+        }
+
+        btPoolAllocator *slab = new btPoolAllocator(NODE_ELEMENT_SIZE, (int)m_NodesPerSlab);
+        m_Slabs.push_back(slab);
+
+        return slab;
+    }
+
+    btPoolAllocator *NodePool::findSlab(const Node *node)const
+    {
+        for (std::vector<btPoolAllocator*>::const_iterator i = m_Slabs.begin();
+             i != m_Slabs.end();
+             i++)
+        {
+            if((*i)->validPtr((void*)node))
+                return *i;
+        }
+        return NULL;
+    }
+}
@@ -0,0 +1,61 @@
+//
+//  NodePool.hpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#ifndef NodePool_hpp
+#define NodePool_hpp
+
+#include <vector>
+
+class btPoolAllocator;
+
+namespace jamesfolk
+{
+    class Node;
+
+    // Allocates nodes from 16 byte aligned slabs (btPoolAllocator) instead of
+    // one heap allocation per node. A new slab is added when the existing
+    // ones are full, so nodes created together are contiguous in memory.
+    //
+    // Nodes from a pool must be returned to it with destroy(), never deleted.
+    class NodePool
+    {
+    public:
+        NodePool(unsigned long nodesPerSlab = 256);
+        ~NodePool();
+
+        Node *create();
+        void destroy(Node *node);
+
+        // Appends count new nodes to nodes.
+        void create(unsigned long count, std::vector<Node*> &nodes);
+        // Destroys every node in nodes and clears it.
+        void destroy(std::vector<Node*> &nodes);
+
+        bool owns(const Node *node)const;
+
+        unsigned long numberOfNodes()const;
+        unsigned long numberOfSlabs()const;
+        unsigned long getNodesPerSlab()const;
+
+    protected:
+        btPoolAllocator *getFreeSlab();
+        btPoolAllocator *findSlab(const Node *node)const;
+
+    private:
+        NodePool(const NodePool &rhs);
+        const NodePool &operator=(const NodePool &rhs);
+
+        std::vector<btPoolAllocator*> m_Slabs;
+        unsigned long m_NodesPerSlab;
+        unsigned long m_NumberOfNodes;
+        // Index of the first slab that may have room.
+        unsigned long m_FreeSlab;
+    };
+}
+
+#endif /* NodePool_hpp */
@@ -11,9 +11,12 @@
 #include "btVector3.h"
 #include "btDefaultCollisionConfiguration.h"
 #include "btCollisionDispatcher.h"
+#include "btCollisionDispatcherMt.h"
+#include "btThreads.h"
 #include "btDbvtBroadphase.h"
 #include "btSequentialImpulseConstraintSolver.h"
 #include "btDiscreteDynamicsWorld.h"
+#include "btDiscreteDynamicsWorldMt.h"
 #include "btBox2dBox2dCollisionAlgorithm.h"
 #include "btConvex2dConvex2dAlgorithm.h"
 #include "btMinkowskiPenetrationDepthSolver.h"
@@ -210,17 +213,18 @@ namespace jamesfolk
         return collides;
     }
     
-    PhysicsWorld::PhysicsWorld():
+    PhysicsWorld::PhysicsWorld(bool multithreaded):
     m_SimulationSpeed(1.0f),
     m_TimeStep(0.0f),
     m_collisionConfiguration(new btDefaultCollisionConfiguration()),
-    m_dispatcher(new btCollisionDispatcher(m_collisionConfiguration)),
+    m_taskScheduler(multithreaded ? btCreateDefaultTaskScheduler() : NULL),
+    m_dispatcher(new btCollisionDispatcherMt(m_collisionConfiguration)),
     m_overlappingPairCache(new btDbvtBroadphase()),
     m_solver(new btSequentialImpulseConstraintSolver),
-    m_dynamicsWorld(new btDiscreteDynamicsWorld(m_dispatcher,
-                                                m_overlappingPairCache,
-                                                m_solver,
-                                                m_collisionConfiguration)),
+    m_dynamicsWorld(new btDiscreteDynamicsWorldMt(m_dispatcher,
+                                                  m_overlappingPairCache,
+                                                  m_solver,
+                                                  m_collisionConfiguration)),
     m_btOverlapFilterCallback(new CustomFilterCallback()),
     m_btGhostPairCallback(new btGhostPairCallback()),
     m_GhostObjects(new btAlignedObjectArray<btPairCachingGhostObject*>()),
@@ -228,6 +232,9 @@ namespace jamesfolk
     {
         m_dynamicsWorld->setGravity(btVector3(0,0,0));
         
+        if(m_taskScheduler)
+            btSetTaskScheduler(m_taskScheduler);
+        
         m_dispatcher->setNearCallback(CustomNearCallback);
         m_dynamicsWorld->getPairCache()->setOverlapFilterCallback(m_btOverlapFilterCallback);
         m_dynamicsWorld->setInternalTickCallback(DefaultCustomPreTickCallback,NULL,true);
@@ -275,6 +282,13 @@ namespace jamesfolk
         delete m_overlappingPairCache;m_overlappingPairCache=NULL;
         delete m_dispatcher;m_dispatcher=NULL;
         delete m_collisionConfiguration;m_collisionConfiguration=NULL;
+        
+        if(m_taskScheduler)
+        {
+            if(btGetTaskScheduler() == m_taskScheduler)
+                btSetTaskScheduler(NULL);
+            delete m_taskScheduler;m_taskScheduler=NULL;
+        }
     }
     
     void PhysicsWorld::update(float timeStep,int maxSubSteps, float fixedTimeStep)
@@ -405,6 +419,11 @@ namespace jamesfolk
         return m_Paused;
     }
     
+    bool PhysicsWorld::isMultithreaded()const
+    {
+        return m_taskScheduler != NULL;
+    }
+    
     void PhysicsWorld::debugDrawWorld()
     {
         m_dynamicsWorld->debugDrawWorld();
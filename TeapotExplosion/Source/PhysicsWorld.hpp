@@ -27,6 +27,7 @@ class btPairCachingGhostObject;
 struct btBroadphaseProxy;
 class btVoronoiSimplexSolver;
 class btMinkowskiPenetrationDepthSolver;
+class btITaskScheduler;
 
 namespace jamesfolk
 {
@@ -37,7 +38,15 @@ namespace jamesfolk
     class PhysicsWorld
     {
     public:
-        PhysicsWorld();
+        // The narrowphase goes through btCollisionDispatcherMt, whose
+        // manifold and algorithm pools grow in slabs instead of falling back
+        // to malloc when an explosion creates thousands of contacts. A
+        // multithreaded world also runs it, and the solving of the debris
+        // islands (btDiscreteDynamicsWorldMt), on a thread pool. The near
+        // callback and the contact added callback are then called from
+        // several threads at once, so the PhysicsBody collision handlers must
+        // not modify shared state.
+        PhysicsWorld(bool multithreaded = false);
         virtual ~PhysicsWorld();
         
         class CustomFilterCallback : public btOverlapFilterCallback {
@@ -88,6 +97,8 @@ namespace jamesfolk
         void enablePause(bool enable = true);
         bool isPaused() const;
         
+        bool isMultithreaded() const;
+        
         void ghostObjectCollisionTest();
     protected:
         void debugDrawWorld();
@@ -105,6 +116,7 @@ namespace jamesfolk
         float m_TimeStep;
         
         btDefaultCollisionConfiguration* m_collisionConfiguration;
+        btITaskScheduler* m_taskScheduler;
         btCollisionDispatcher* m_dispatcher;
         
         btBroadphaseInterface* m_overlappingPairCache;
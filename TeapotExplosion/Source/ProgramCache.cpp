@@ -0,0 +1,327 @@
+//
+//  ProgramCache.cpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#include "ProgramCache.hpp"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <atomic>
+#include <iostream>
+
+namespace jamesfolk
+{
+    static const unsigned int CACHE_MAGIC = 0x43505445; // "ETPC"
+    static const unsigned int CACHE_VERSION = 1;
+
+    static bool writeUInt32(FILE *file, unsigned int value)
+    {
+        return fwrite(&value, sizeof(value), 1, file) == 1;
+    }
+
+    static bool readUInt32(FILE *file, unsigned int &value)
+    {
+        return fread(&value, sizeof(value), 1, file) == 1;
+    }
+
+    static bool writeUInt64(FILE *file, unsigned long long value)
+    {
+        return fwrite(&value, sizeof(value), 1, file) == 1;
+    }
+
+    static bool readUInt64(FILE *file, unsigned long long &value)
+    {
+        return fread(&value, sizeof(value), 1, file) == 1;
+    }
+
+    static bool writeLocations(FILE *file, const ProgramCache::LocationMap &locations)
+    {
+        if(!writeUInt32(file, (unsigned int)locations.size()))
+            return false;
+
+        for (ProgramCache::LocationMap::const_iterator i = locations.begin();
+             i != locations.end();
+             i++)
+        {
+            if(!writeUInt32(file, (unsigned int)i->second) ||
+               !writeUInt32(file, (unsigned int)i->first.size()) ||
+               fwrite(i->first.data(), 1, i->first.size(), file) != i->first.size())
+                return false;
+        }
+        return true;
+    }
+
+    static bool readLocations(FILE *file, ProgramCache::LocationMap &locations)
+    {
+        unsigned int count;
+        if(!readUInt32(file, count))
+            return false;
+
+        locations.clear();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            unsigned int location, length;
+            if(!readUInt32(file, location) || !readUInt32(file, length) || length > 1024)
+                return false;
+
+            std::string name(length, '\0');
+            if(length > 0 && fread(&name[0], 1, length, file) != length)
+                return false;
+
+            locations.insert(ProgramCache::LocationPair(name, (int)location));
+        }
+        return true;
+    }
+
+    ProgramCache::Backend::~Backend()
+    {
+    }
+
+    std::string ProgramCache::Backend::getDriverIdentity()const
+    {
+        std::string identity;
+        const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION, GL_SHADING_LANGUAGE_VERSION};
+
+        for (unsigned long i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+        {
+            const GLubyte *value = glGetString(names[i]);
+            if(value)
+                identity += (const char*)value;
+            identity += '\n';
+        }
+        return identity;
+    }
+
+    bool ProgramCache::Backend::isProgramBinarySupported()const
+    {
+#if defined(GL_OES_get_program_binary)
+        GLint formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats);
+        return formats > 0;
+#else
+        return false;
+#endif
+    }
+
+    bool ProgramCache::Backend::getProgramBinary(GLuint program, GLenum &format, std::vector<unsigned char> &binary)const
+    {
+#if defined(GL_OES_get_program_binary)
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH_OES, &length);
+        if(length <= 0)
+            return false;
+
+        binary.resize(length);
+        GLsizei written = 0;
+        glGetProgramBinaryOES(program, length, &written, &format, &binary[0]);
+        binary.resize(written);
+
+        return written > 0;
+#else
+        return false;
+#endif
+    }
+
+    GLuint ProgramCache::Backend::createProgramFromBinary(GLenum format, const std::vector<unsigned char> &binary)const
+    {
+#if defined(GL_OES_get_program_binary)
+        if(binary.empty())
+            return 0;
+
+        GLuint program = glCreateProgram();
+        glProgramBinaryOES(program, format, &binary[0], (GLint)binary.size());
+
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if(status != GL_TRUE)
+        {
+            glDeleteProgram(program);
+            program = 0;
+        }
+        return program;
+#else
+        return 0;
+#endif
+    }
+
+    ProgramCache::ProgramCache(Backend *backend):
+    m_Backend(backend ? backend : new Backend()),
+    m_OwnsBackend(backend == NULL),
+    m_Directory(""),
+    m_DriverIdentity(""),
+    m_DriverIdentityResolved(false)
+    {
+    }
+
+    ProgramCache::~ProgramCache()
+    {
+        if(m_OwnsBackend)
+            delete m_Backend;
+        m_Backend = NULL;
+    }
+
+    void ProgramCache::setDirectory(const std::string &directory)
+    {
+        m_Directory = directory;
+        if(!m_Directory.empty() && m_Directory[m_Directory.size() - 1] != '/')
+            m_Directory += '/';
+
+        // Resolved here rather than on the first load, which may run on the
+        // ShaderVariantCache worker while the main thread loads as well.
+        if(!m_Directory.empty() && !m_DriverIdentityResolved)
+        {
+            m_DriverIdentity = m_Backend->getDriverIdentity();
+            m_DriverIdentityResolved = true;
+        }
+    }
+
+    const std::string &ProgramCache::getDirectory()const
+    {
+        return m_Directory;
+    }
+
+    bool ProgramCache::isEnabled()const
+    {
+        return !m_Directory.empty() && m_Backend->isProgramBinarySupported();
+    }
+
+    GLuint ProgramCache::load(const std::string &vertexSource,
+                              const std::string &fragmentSource,
+                              LocationMap &attributes,
+                              LocationMap &uniforms)
+    {
+        if(!isEnabled())
+            return 0;
+
+        const unsigned long long key = makeKey(vertexSource, fragmentSource);
+        const std::string path = getEntryPath(key);
+
+        FILE *file = fopen(path.c_str(), "rb");
+        if(!file)
+            return 0;
+
+        unsigned int magic = 0, version = 0, format = 0, length = 0;
+        unsigned long long storedKey = 0;
+        std::vector<unsigned char> binary;
+        LocationMap storedAttributes, storedUniforms;
+
+        bool valid = (readUInt32(file, magic) && magic == CACHE_MAGIC &&
+                      readUInt32(file, version) && version == CACHE_VERSION &&
+                      readUInt64(file, storedKey) && storedKey == key &&
+                      readLocations(file, storedAttributes) &&
+                      readLocations(file, storedUniforms) &&
+                      readUInt32(file, format) &&
+                      readUInt32(file, length) && length > 0);
+        if(valid)
+        {
+            binary.resize(length);
+            valid = (fread(&binary[0], 1, length, file) == length);
+        }
+        fclose(file);
+
+        GLuint program = valid ? m_Backend->createProgramFromBinary(format, binary) : 0;
+
+        if(program == 0)
+        {
+#if defined(DEBUG)
+            std::cout << "Discarding stale program cache entry " << path << std::endl;
+#endif
+            remove(path.c_str());
+            return 0;
+        }
+
+        attributes.swap(storedAttributes);
+        uniforms.swap(storedUniforms);
+        return program;
+    }
+
+    bool ProgramCache::store(GLuint program,
+                             const std::string &vertexSource,
+                             const std::string &fragmentSource,
+                             const LocationMap &attributes,
+                             const LocationMap &uniforms)
+    {
+        if(!isEnabled() || program == 0)
+            return false;
+
+        GLenum format = 0;
+        std::vector<unsigned char> binary;
+        if(!m_Backend->getProgramBinary(program, format, binary))
+            return false;
+
+        const unsigned long long key = makeKey(vertexSource, fragmentSource);
+        const std::string path = getEntryPath(key);
+        // Every writer gets its own temporary file, other threads or processes
+        // may be storing the same entry at the same time.
+        static std::atomic<unsigned int> temporaryCounter(0);
+        const std::string temporaryPath = (path + "." + std::to_string(getpid()) + "." +
+                                           std::to_string(temporaryCounter.fetch_add(1)) + ".tmp");
+
+        FILE *file = fopen(temporaryPath.c_str(), "wb");
+        if(!file)
+            return false;
+
+        bool written = (writeUInt32(file, CACHE_MAGIC) &&
+                        writeUInt32(file, CACHE_VERSION) &&
+                        writeUInt64(file, key) &&
+                        writeLocations(file, attributes) &&
+                        writeLocations(file, uniforms) &&
+                        writeUInt32(file, (unsigned int)format) &&
+                        writeUInt32(file, (unsigned int)binary.size()) &&
+                        fwrite(&binary[0], 1, binary.size(), file) == binary.size());
+        written = (fclose(file) == 0) && written;
+
+        // Publish the entry atomically so a crash never leaves a torn file behind.
+        if(!written || rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            remove(temporaryPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void ProgramCache::invalidate(const std::string &vertexSource,
+                                  const std::string &fragmentSource)
+    {
+        if(!m_Directory.empty())
+            remove(getEntryPath(makeKey(vertexSource, fragmentSource)).c_str());
+    }
+
+    unsigned long long ProgramCache::hash(const std::string &data, unsigned long long seed)
+    {
+        // 64 bit FNV-1a
+        unsigned long long h = seed;
+        for (std::string::const_iterator i = data.begin(); i != data.end(); i++)
+        {
+            h ^= (unsigned char)(*i);
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    unsigned long long ProgramCache::makeKey(const std::string &vertexSource, const std::string &fragmentSource)const
+    {
+        assert(m_DriverIdentityResolved);
+
+        // Length prefixes keep ("ab", "c") and ("a", "bc") apart.
+        unsigned long long h = hash(std::to_string(vertexSource.size()) + ':');
+        h = hash(vertexSource, h);
+        h = hash(std::to_string(fragmentSource.size()) + ':', h);
+        h = hash(fragmentSource, h);
+        h = hash(m_DriverIdentity, h);
+        return h;
+    }
+
+    std::string ProgramCache::getEntryPath(unsigned long long key)const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.program", key);
+        return m_Directory + name;
+    }
+}
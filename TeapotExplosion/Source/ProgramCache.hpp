@@ -0,0 +1,88 @@
+//
+//  ProgramCache.hpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#ifndef ProgramCache_hpp
+#define ProgramCache_hpp
+
+#import <OpenGLES/ES2/glext.h>
+#import <OpenGLES/ES2/gl.h>
+
+#include <string>
+#include <vector>
+#include <map>
+
+namespace jamesfolk
+{
+    // Persistent cache of linked program binaries (GL_OES_get_program_binary).
+    //
+    // Each entry is keyed by a hash of the vertex source, the fragment source
+    // and the driver identity (vendor, renderer, version), and stores the
+    // program binary together with the attribute and uniform locations that
+    // were resolved when it was first linked. A missing, stale or rejected
+    // entry makes load() return 0 so the caller compiles from source.
+    class ProgramCache
+    {
+    public:
+        typedef std::map<std::string, int> LocationMap;
+        typedef std::pair<std::string, int> LocationPair;
+
+        // The GL entry points used by the cache. Override to run against a stub.
+        class Backend
+        {
+        public:
+            virtual ~Backend();
+
+            virtual std::string getDriverIdentity()const;
+            virtual bool isProgramBinarySupported()const;
+
+            virtual bool getProgramBinary(GLuint program, GLenum &format, std::vector<unsigned char> &binary)const;
+            // Returns 0 if the driver rejects the binary. The caller owns the program.
+            virtual GLuint createProgramFromBinary(GLenum format, const std::vector<unsigned char> &binary)const;
+        };
+
+        ProgramCache(Backend *backend = NULL);
+        ~ProgramCache();
+
+        // Reads the driver identity, so call it with the GL context current and
+        // before other threads load or store programs.
+        void setDirectory(const std::string &directory);
+        const std::string &getDirectory()const;
+        bool isEnabled()const;
+
+        GLuint load(const std::string &vertexSource,
+                    const std::string &fragmentSource,
+                    LocationMap &attributes,
+                    LocationMap &uniforms);
+
+        bool store(GLuint program,
+                   const std::string &vertexSource,
+                   const std::string &fragmentSource,
+                   const LocationMap &attributes,
+                   const LocationMap &uniforms);
+
+        void invalidate(const std::string &vertexSource,
+                        const std::string &fragmentSource);
+
+        static unsigned long long hash(const std::string &data, unsigned long long seed = 14695981039346656037ULL);
+    protected:
+        unsigned long long makeKey(const std::string &vertexSource, const std::string &fragmentSource)const;
+        std::string getEntryPath(unsigned long long key)const;
+
+    private:
+        ProgramCache(const ProgramCache &rhs);
+        const ProgramCache &operator=(const ProgramCache &rhs);
+
+        Backend *m_Backend;
+        bool m_OwnsBackend;
+        std::string m_Directory;
+        std::string m_DriverIdentity;
+        bool m_DriverIdentityResolved;
+    };
+}
+
+#endif /* ProgramCache_hpp */
@@ -7,7 +7,9 @@
 //
 
 #include "Shader.hpp"
+#include "ProgramCache.hpp"
 #include <iostream>
+#include <algorithm>
 #include <assert.h>
 
 namespace jamesfolk
@@ -37,11 +39,22 @@ namespace jamesfolk
     
     
     bool Shader::load(const std::string &vertexSource,
-              const std::string &fragmentSource)//,
+              const std::string &fragmentSource,
+              ProgramCache *cache)//,
 //              const std::vector<std::string> &attributes)
     {
         GLuint vertShader, fragShader;
         
+        m_UniformMap.clear();
+        m_AttributeMap.clear();
+        
+        if(cache)
+        {
+            m_Program = cache->load(vertexSource, fragmentSource, m_AttributeMap, m_UniformMap);
+            if(m_Program)
+                return true;
+        }
+        
         m_Program = glCreateProgram();
         
         if(!(vertShader = compileShader(vertexSource, GL_VERTEX_SHADER)))
@@ -53,6 +66,14 @@ namespace jamesfolk
         glAttachShader(m_Program, vertShader);
         glAttachShader(m_Program, fragShader);
         
+        for (UniformMap::const_iterator i = m_BoundAttributeMap.begin();
+             i != m_BoundAttributeMap.end();
+             i++)
+        {
+            if(i->second != -1)
+                glBindAttribLocation(m_Program, i->second, i->first.c_str());
+        }
+        
         if(!linkProgram(m_Program))
         {
             if (vertShader)
@@ -85,6 +106,11 @@ namespace jamesfolk
             glDeleteShader(fragShader);
         }
         
+        resolveLocations();
+        
+        if(cache)
+            cache->store(m_Program, vertexSource, fragmentSource, m_AttributeMap, m_UniformMap);
+        
         return true;
     }
     
@@ -100,6 +126,11 @@ namespace jamesfolk
         return (m_Program != 0);
     }
     
+    void Shader::bindAttributeLocations(const Shader &layout)
+    {
+        m_BoundAttributeMap = layout.m_AttributeMap;
+    }
+    
     bool Shader::use()const
     {
         if(m_Program)
@@ -115,6 +146,10 @@ namespace jamesfolk
     
     int Shader::getAttributeLocation(const std::string &attributeName)const
     {
+        UniformMap::const_iterator iter = m_AttributeMap.find(attributeName);
+        if(iter != m_AttributeMap.end())
+            return iter->second;
+        
         int location = glGetAttribLocation(m_Program, attributeName.c_str());
         
 #if defined(DEBUG)
@@ -390,4 +425,38 @@ namespace jamesfolk
         glGetProgramiv(program, GL_LINK_STATUS, &status);
         return (status == GL_TRUE);
     }
+    
+    void Shader::resolveLocations()
+    {
+        GLint count = 0;
+        GLint maxLength = 0;
+        GLint size;
+        GLenum type;
+        
+        glGetProgramiv(m_Program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+        glGetProgramiv(m_Program, GL_ACTIVE_ATTRIBUTES, &count);
+        std::vector<GLchar> name(std::max<GLint>(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            glGetActiveAttrib(m_Program, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+            m_AttributeMap.insert(UniformPair(&name[0], glGetAttribLocation(m_Program, &name[0])));
+        }
+        
+        glGetProgramiv(m_Program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        glGetProgramiv(m_Program, GL_ACTIVE_UNIFORMS, &count);
+        name.resize(std::max<GLint>(maxLength, 1));
+        for (GLint i = 0; i < count; i++)
+        {
+            glGetActiveUniform(m_Program, i, (GLsizei)name.size(), NULL, &size, &type, &name[0]);
+            
+            std::string uniformName(&name[0]);
+            int location = glGetUniformLocation(m_Program, uniformName.c_str());
+            m_UniformMap.insert(UniformPair(uniformName, location));
+            
+            // Arrays are reported as "name[0]"; also answer to the bare name.
+            std::string::size_type bracket = uniformName.find('[');
+            if(bracket != std::string::npos)
+                m_UniformMap.insert(UniformPair(uniformName.substr(0, bracket), location));
+        }
+    }
 }
@@ -20,6 +20,8 @@
 
 namespace jamesfolk
 {
+    class ProgramCache;
+    
     class Shader
     {
     public:
@@ -30,11 +32,15 @@ namespace jamesfolk
         ~Shader();
 
         bool load(const std::string &vertexSource,
-                  const std::string &fragmentSource);
+                  const std::string &fragmentSource,
+                  ProgramCache *cache = NULL);
         
         void unLoad();
         bool isLoaded()const;
         
+        // Link the next load() with the attribute locations of layout.
+        void bindAttributeLocations(const Shader &layout);
+        
         bool use()const;
         
         int getAttributeLocation(const std::string &attributeName)const;
@@ -62,6 +68,8 @@ namespace jamesfolk
         
         bool linkProgram(GLuint program);
         
+        void resolveLocations();
+        
     private:
         GLuint m_Program;
         
@@ -73,6 +81,8 @@ namespace jamesfolk
         typedef std::pair<std::string, int> UniformPair;
         
         UniformMap m_UniformMap;
+        UniformMap m_AttributeMap;
+        UniformMap m_BoundAttributeMap;
         
     };
 }
@@ -0,0 +1,271 @@
+//
+//  ShaderVariantCache.cpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#include "ShaderVariantCache.hpp"
+
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+
+#include "Shader.hpp"
+#include "ProgramCache.hpp"
+
+namespace jamesfolk
+{
+    struct FeatureDefine
+    {
+        ShaderVariantCache::Feature feature;
+        const char *define;
+    };
+
+    static const FeatureDefine FEATUREDEFINES[] =
+    {
+        {ShaderVariantCache::Feature_RimLight, "RIM_LIGHT"},
+        {ShaderVariantCache::Feature_SpotLight, "SPOT_LIGHT"},
+        {ShaderVariantCache::Feature_Attenuation, "ATTENUATION"},
+        {ShaderVariantCache::Feature_LinearFog, "LINEAR_FOG"},
+        {ShaderVariantCache::Feature_ExponentialFog, "EXPONENTIAL_FOG"},
+        {ShaderVariantCache::Feature_None, 0}
+    };
+
+    ShaderVariantCache::ShaderVariantCache(Shader *generalShader,
+                                           const std::string &vertexSource,
+                                           const std::string &fragmentSource,
+                                           ProgramCache *cache):
+    m_GeneralShader(generalShader),
+    m_VertexSource(vertexSource),
+    m_FragmentSource(fragmentSource),
+    m_ProgramCache(cache),
+    m_Stopping(false),
+    m_MakeCurrent(NULL),
+    m_Release(NULL),
+    m_ContextUserData(NULL)
+    {
+        assert(m_GeneralShader);
+    }
+
+    ShaderVariantCache::~ShaderVariantCache()
+    {
+        stopWorker();
+
+        for (std::vector<VariantPair>::iterator i = m_Finished.begin();
+             i != m_Finished.end();
+             i++)
+            delete i->second;
+        m_Finished.clear();
+
+        for (VariantMap::iterator i = m_Variants.begin();
+             i != m_Variants.end();
+             i++)
+            delete i->second;
+        m_Variants.clear();
+    }
+
+    void ShaderVariantCache::setBackgroundContext(ContextCallback makeCurrent, ContextCallback release, void *userData)
+    {
+        assert(!m_Worker.joinable());
+
+        m_MakeCurrent = makeCurrent;
+        m_Release = release;
+        m_ContextUserData = userData;
+    }
+
+    Shader *ShaderVariantCache::getShader(Key key, Key &activeKey)
+    {
+        key &= Feature_All;
+
+        if(key != Feature_All)
+        {
+            VariantMap::const_iterator iter = m_Variants.find(key);
+            if(iter == m_Variants.end())
+            {
+                request(key);
+            }
+            else if(iter->second)
+            {
+                activeKey = key;
+                return iter->second;
+            }
+        }
+
+        activeKey = Feature_All;
+        return m_GeneralShader;
+    }
+
+    Shader *ShaderVariantCache::getGeneralShader()const
+    {
+        return m_GeneralShader;
+    }
+
+    bool ShaderVariantCache::isReady(Key key)
+    {
+        key &= Feature_All;
+        if(key == Feature_All)
+            return true;
+
+        VariantMap::const_iterator iter = m_Variants.find(key);
+        return (iter != m_Variants.end() && iter->second != NULL);
+    }
+
+    void ShaderVariantCache::update()
+    {
+        if(!m_Worker.joinable())
+        {
+            Key key = Feature_All;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if(!m_Pending.empty())
+                {
+                    key = m_Pending.front();
+                    m_Pending.pop_front();
+                }
+            }
+
+            if(key != Feature_All)
+                publish(key, compile(key));
+        }
+
+        std::vector<VariantPair> finished;
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            finished.swap(m_Finished);
+        }
+
+        for (std::vector<VariantPair>::iterator i = finished.begin();
+             i != finished.end();
+             i++)
+        {
+#if defined(DEBUG)
+            if(i->second == NULL)
+                std::cout << "Shader variant " << i->first << " failed, using the general shader" << std::endl;
+#endif
+            // A failed variant stays NULL so it is not requested again.
+            m_Variants[i->first] = i->second;
+        }
+    }
+
+    std::string ShaderVariantCache::getDefines(Key key)
+    {
+        std::string defines("#define PERMUTATION 1\n");
+
+        for (unsigned long i = 0; FEATUREDEFINES[i].define != 0; i++)
+        {
+            if(key & FEATUREDEFINES[i].feature)
+                defines += std::string("#define ") + FEATUREDEFINES[i].define + " 1\n";
+        }
+        return defines;
+    }
+
+    std::string ShaderVariantCache::injectDefines(const std::string &source, Key key)
+    {
+        // The defines have to follow #version, which must be the first token.
+        std::string::size_type position = 0;
+        std::string::size_type version = source.find("#version");
+        if(version != std::string::npos)
+        {
+            position = source.find('\n', version);
+            position = (position == std::string::npos) ? source.size() : position + 1;
+        }
+
+        const unsigned long line = std::count(source.begin(), source.begin() + position, '\n') + 1;
+
+        std::string ret(source, 0, position);
+        if(!ret.empty() && ret[ret.size() - 1] != '\n')
+            ret += '\n';
+        ret += getDefines(key);
+        // Keep compiler messages pointing at the lines of the original file.
+        ret += "#line " + std::to_string(line) + "\n";
+        ret.append(source, position, std::string::npos);
+        return ret;
+    }
+
+    void ShaderVariantCache::request(Key key)
+    {
+        m_Variants.insert(VariantPair(key, (Shader*)NULL));
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Pending.push_back(key);
+        }
+
+        if(m_MakeCurrent && !m_Worker.joinable())
+            startWorker();
+
+        m_Condition.notify_one();
+    }
+
+    Shader *ShaderVariantCache::compile(Key key)
+    {
+        Shader *shader = new Shader();
+
+        // Variants share the general shader's vertex array objects.
+        shader->bindAttributeLocations(*m_GeneralShader);
+
+        if(!shader->load(m_VertexSource, injectDefines(m_FragmentSource, key), m_ProgramCache))
+        {
+            delete shader;
+            shader = NULL;
+        }
+        return shader;
+    }
+
+    void ShaderVariantCache::publish(Key key, Shader *shader)
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Finished.push_back(VariantPair(key, shader));
+    }
+
+    void ShaderVariantCache::startWorker()
+    {
+        m_Stopping = false;
+        m_Worker = std::thread(&ShaderVariantCache::runWorker, this);
+    }
+
+    void ShaderVariantCache::stopWorker()
+    {
+        if(m_Worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stopping = true;
+            }
+            m_Condition.notify_one();
+            m_Worker.join();
+        }
+    }
+
+    void ShaderVariantCache::runWorker()
+    {
+        if(m_MakeCurrent)
+            m_MakeCurrent(m_ContextUserData);
+
+        for (;;)
+        {
+            Key key;
+            {
+                std::unique_lock<std::mutex> lock(m_Mutex);
+                m_Condition.wait(lock, [this]{ return m_Stopping || !m_Pending.empty(); });
+                if(m_Stopping)
+                    break;
+
+                key = m_Pending.front();
+                m_Pending.pop_front();
+            }
+
+            Shader *shader = compile(key);
+
+            // The render context may only use the program once it is complete.
+            glFinish();
+
+            publish(key, shader);
+        }
+
+        if(m_Release)
+            m_Release(m_ContextUserData);
+    }
+}
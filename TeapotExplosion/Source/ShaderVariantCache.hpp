@@ -0,0 +1,113 @@
+//
+//  ShaderVariantCache.hpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#ifndef ShaderVariantCache_hpp
+#define ShaderVariantCache_hpp
+
+#import <OpenGLES/ES2/glext.h>
+#import <OpenGLES/ES2/gl.h>
+
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+namespace jamesfolk
+{
+    class Shader;
+    class ProgramCache;
+
+    // Specialized permutations of one shader source pair.
+    //
+    // A variant is the fragment source with "#define PERMUTATION 1" and one
+    // define per enabled feature injected after the #version line. Variants
+    // are compiled on demand: getShader() returns the variant for a key once
+    // it is linked, and the general shader (every feature compiled in and
+    // selected by uniforms) until then. With a background context the
+    // variants are compiled on a worker thread that shares objects with the
+    // render context; without one, update() compiles one variant per call on
+    // the calling thread.
+    class ShaderVariantCache
+    {
+    public:
+        enum Feature
+        {
+            Feature_None = 0,
+            Feature_RimLight = 1 << 0,
+            Feature_SpotLight = 1 << 1,
+            Feature_Attenuation = 1 << 2,
+            Feature_LinearFog = 1 << 3,
+            Feature_ExponentialFog = 1 << 4,
+            Feature_All = (1 << 5) - 1
+        };
+        typedef unsigned int Key;
+
+        typedef void (*ContextCallback)(void *userData);
+
+        ShaderVariantCache(Shader *generalShader,
+                           const std::string &vertexSource,
+                           const std::string &fragmentSource,
+                           ProgramCache *cache = NULL);
+        ~ShaderVariantCache();
+
+        // makeCurrent/release are called on the worker thread around its
+        // lifetime; the context they bind must share objects with the
+        // render context.
+        void setBackgroundContext(ContextCallback makeCurrent, ContextCallback release, void *userData);
+
+        Shader *getShader(Key key, Key &activeKey);
+        Shader *getGeneralShader()const;
+        bool isReady(Key key);
+
+        void update();
+
+        static std::string getDefines(Key key);
+        static std::string injectDefines(const std::string &source, Key key);
+
+    protected:
+        void request(Key key);
+        Shader *compile(Key key);
+        void publish(Key key, Shader *shader);
+
+        void startWorker();
+        void stopWorker();
+        void runWorker();
+
+    private:
+        ShaderVariantCache(const ShaderVariantCache &rhs);
+        const ShaderVariantCache &operator=(const ShaderVariantCache &rhs);
+
+        typedef std::map<Key, Shader*> VariantMap;
+        typedef std::pair<Key, Shader*> VariantPair;
+
+        Shader *m_GeneralShader;
+        std::string m_VertexSource;
+        std::string m_FragmentSource;
+        ProgramCache *m_ProgramCache;
+
+        // Render thread only.
+        VariantMap m_Variants;
+
+        // Shared with the worker, guarded by m_Mutex.
+        std::mutex m_Mutex;
+        std::condition_variable m_Condition;
+        std::deque<Key> m_Pending;
+        std::vector<VariantPair> m_Finished;
+        bool m_Stopping;
+
+        std::thread m_Worker;
+        ContextCallback m_MakeCurrent;
+        ContextCallback m_Release;
+        void *m_ContextUserData;
+    };
+}
+
+#endif /* ShaderVariantCache_hpp */
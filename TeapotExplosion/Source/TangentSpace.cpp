@@ -0,0 +1,367 @@
+//
+//  TangentSpace.cpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#include "TangentSpace.hpp"
+#include "Geometry.hpp"
+#include "btThreads.h"
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_map>
+
+namespace jamesfolk
+{
+    static const GLsizei LANES = 4;
+    static const GLsizei TRIANGLE_GRAIN = 1024;
+    static const GLsizei VERTEX_GRAIN = 4096;
+
+#if defined(BT_USE_SSE)
+    typedef __m128 Lane;
+
+    static inline Lane laneLoad(const float *p){return _mm_loadu_ps(p);}
+    static inline void laneStore(float *p, Lane a){_mm_storeu_ps(p, a);}
+    static inline Lane laneAdd(Lane a, Lane b){return _mm_add_ps(a, b);}
+    static inline Lane laneSub(Lane a, Lane b){return _mm_sub_ps(a, b);}
+    static inline Lane laneMul(Lane a, Lane b){return _mm_mul_ps(a, b);}
+    static inline Lane laneSafeReciprocal(Lane a)
+    {
+        Lane zero = _mm_setzero_ps();
+        return _mm_and_ps(_mm_div_ps(_mm_set1_ps(1.0f), a), _mm_cmpneq_ps(a, zero));
+    }
+#elif defined(BT_USE_NEON)
+    typedef float32x4_t Lane;
+
+    static inline Lane laneLoad(const float *p){return vld1q_f32(p);}
+    static inline void laneStore(float *p, Lane a){vst1q_f32(p, a);}
+    static inline Lane laneAdd(Lane a, Lane b){return vaddq_f32(a, b);}
+    static inline Lane laneSub(Lane a, Lane b){return vsubq_f32(a, b);}
+    static inline Lane laneMul(Lane a, Lane b){return vmulq_f32(a, b);}
+    static inline Lane laneSafeReciprocal(Lane a)
+    {
+#if defined(__aarch64__)
+        Lane r = vdivq_f32(vdupq_n_f32(1.0f), a);
+#else
+        Lane r = vrecpeq_f32(a);
+        r = vmulq_f32(vrecpsq_f32(a, r), r);
+        r = vmulq_f32(vrecpsq_f32(a, r), r);
+#endif
+        uint32x4_t isZero = vceqq_f32(a, vdupq_n_f32(0.0f));
+        return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(r), isZero));
+    }
+#else
+    struct Lane
+    {
+        float v[LANES];
+    };
+
+    static inline Lane laneLoad(const float *p){Lane r; memcpy(r.v, p, sizeof(r.v)); return r;}
+    static inline void laneStore(float *p, Lane a){memcpy(p, a.v, sizeof(a.v));}
+    static inline Lane laneAdd(Lane a, Lane b){for(int i = 0; i < LANES; i++) a.v[i] += b.v[i]; return a;}
+    static inline Lane laneSub(Lane a, Lane b){for(int i = 0; i < LANES; i++) a.v[i] -= b.v[i]; return a;}
+    static inline Lane laneMul(Lane a, Lane b){for(int i = 0; i < LANES; i++) a.v[i] *= b.v[i]; return a;}
+    static inline Lane laneSafeReciprocal(Lane a)
+    {
+        for(int i = 0; i < LANES; i++)
+            a.v[i] = (a.v[i] != 0.0f)?(1.0f / a.v[i]):0.0f;
+        return a;
+    }
+#endif
+
+    // Calls body on one chunk of [begin, end) for each chunk index btParallelFor
+    // hands out. The chunk boundaries are multiples of 'alignment' from begin.
+    template <typename Body>
+    class ChunkedForBody : public btIParallelForBody
+    {
+    public:
+        ChunkedForBody(GLsizei begin, GLsizei end, GLsizei chunkSize, const Body &body):
+        m_Begin(begin),
+        m_End(end),
+        m_ChunkSize(chunkSize),
+        m_Body(body)
+        {
+        }
+
+        virtual void forLoop(int iBegin, int iEnd)const
+        {
+            const GLsizei chunkBegin = m_Begin + iBegin * m_ChunkSize;
+            const GLsizei chunkEnd = std::min<GLsizei>(m_End, m_Begin + iEnd * m_ChunkSize);
+            if(chunkBegin < chunkEnd)
+                m_Body(chunkBegin, chunkEnd);
+        }
+
+    private:
+        GLsizei m_Begin;
+        GLsizei m_End;
+        GLsizei m_ChunkSize;
+        const Body &m_Body;
+    };
+
+    // Splits [begin, end) into one chunk per thread of the task scheduler the
+    // physics world set, keeping the chunk boundaries on multiples of
+    // 'alignment'. The chunks run on the scheduler's workers, so no threads are
+    // started here. Small ranges, and the sequential scheduler, run inline.
+    template <typename Body>
+    static void parallelFor(GLsizei begin, GLsizei end, GLsizei grain, GLsizei alignment, const Body &body)
+    {
+        const GLsizei count = end - begin;
+        const GLsizei workers = std::max<GLsizei>(1, btGetTaskScheduler()->getNumThreads());
+
+        if(workers < 2 || count <= grain)
+        {
+            if(count > 0)
+                body(begin, end);
+            return;
+        }
+
+        const GLsizei chunks = std::min<GLsizei>(workers, (count + grain - 1) / grain);
+        GLsizei chunkSize = (count + chunks - 1) / chunks;
+        chunkSize = ((chunkSize + alignment - 1) / alignment) * alignment;
+
+        btParallelFor(0, (count + chunkSize - 1) / chunkSize, 1, ChunkedForBody<Body>(begin, end, chunkSize, body));
+    }
+
+    struct WeldKey
+    {
+        uint32_t bits[8];
+
+        bool operator==(const WeldKey &rhs)const
+        {
+            return 0 == memcmp(bits, rhs.bits, sizeof(bits));
+        }
+    };
+
+    struct WeldKeyHash
+    {
+        size_t operator()(const WeldKey &key)const
+        {
+            // FNV-1a over the attribute bit patterns.
+            uint32_t hash = 2166136261u;
+            for (int i = 0; i < 8; i++)
+            {
+                hash ^= key.bits[i];
+                hash *= 16777619u;
+            }
+            return hash;
+        }
+    };
+
+    TangentSpace::TangentSpace():
+    m_NumberOfTriangles(0),
+    m_NumberOfWelds(0)
+    {
+    }
+
+    TangentSpace::~TangentSpace()
+    {
+    }
+
+    void TangentSpace::generate(TexturedColoredVertex *vertices, GLsizei numberOfVertices)
+    {
+        assert(vertices);
+        assert(numberOfVertices % 3 == 0);
+
+        m_NumberOfTriangles = numberOfVertices / 3;
+        if(m_NumberOfTriangles == 0)
+            return;
+
+        // Pad to a whole number of lanes; the padding is zero and yields a zero tangent.
+        const GLsizei paddedTriangles = ((m_NumberOfTriangles + LANES - 1) / LANES) * LANES;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            m_PositionX[corner].assign(paddedTriangles, 0.0f);
+            m_PositionY[corner].assign(paddedTriangles, 0.0f);
+            m_PositionZ[corner].assign(paddedTriangles, 0.0f);
+            m_TextureU[corner].assign(paddedTriangles, 0.0f);
+            m_TextureV[corner].assign(paddedTriangles, 0.0f);
+        }
+        m_TriangleTangentX.resize(paddedTriangles);
+        m_TriangleTangentY.resize(paddedTriangles);
+        m_TriangleTangentZ.resize(paddedTriangles);
+        m_TriangleBitangentX.resize(paddedTriangles);
+        m_TriangleBitangentY.resize(paddedTriangles);
+        m_TriangleBitangentZ.resize(paddedTriangles);
+
+        parallelFor(0, m_NumberOfTriangles, TRIANGLE_GRAIN, 1,
+                    [this, vertices](GLsizei b, GLsizei e){gather(vertices, b, e);});
+
+        weld(vertices, numberOfVertices);
+
+        parallelFor(0, paddedTriangles, TRIANGLE_GRAIN, LANES,
+                    [this](GLsizei b, GLsizei e){computeTriangles(b, e);});
+
+        parallelFor(0, m_NumberOfWelds, VERTEX_GRAIN, 1,
+                    [this](GLsizei b, GLsizei e){orthonormalize(b, e);});
+
+        parallelFor(0, numberOfVertices, VERTEX_GRAIN, 1,
+                    [this, vertices](GLsizei b, GLsizei e){scatter(vertices, b, e);});
+    }
+
+    void TangentSpace::gather(const TexturedColoredVertex *vertices, GLsizei triangleBegin, GLsizei triangleEnd)
+    {
+        for (GLsizei triangle = triangleBegin; triangle < triangleEnd; triangle++)
+        {
+            for (int corner = 0; corner < 3; corner++)
+            {
+                const TexturedColoredVertex &v = vertices[(triangle * 3) + corner];
+
+                m_PositionX[corner][triangle] = v.vertex.x();
+                m_PositionY[corner][triangle] = v.vertex.y();
+                m_PositionZ[corner][triangle] = v.vertex.z();
+                m_TextureU[corner][triangle] = v.texture.x();
+                m_TextureV[corner][triangle] = v.texture.y();
+            }
+        }
+    }
+
+    void TangentSpace::weld(const TexturedColoredVertex *vertices, GLsizei numberOfVertices)
+    {
+        std::unordered_map<WeldKey, GLsizei, WeldKeyHash> welds;
+        welds.reserve(numberOfVertices);
+
+        m_WeldIndex.resize(numberOfVertices);
+        m_WeldNormal.clear();
+
+        for (GLsizei i = 0; i < numberOfVertices; i++)
+        {
+            const TexturedColoredVertex &v = vertices[i];
+            const float attributes[8] =
+            {
+                v.vertex.x(), v.vertex.y(), v.vertex.z(),
+                v.texture.x(), v.texture.y(),
+                v.normal.x(), v.normal.y(), v.normal.z()
+            };
+
+            WeldKey key;
+            memcpy(key.bits, attributes, sizeof(key.bits));
+
+            std::pair<std::unordered_map<WeldKey, GLsizei, WeldKeyHash>::iterator, bool> result =
+            welds.insert(std::make_pair(key, (GLsizei)welds.size()));
+
+            if(result.second)
+            {
+                btVector3 n(v.normal);
+                if(n.length2() > 0.0f)
+                    n.normalize();
+
+                m_WeldNormal.push_back(n.x());
+                m_WeldNormal.push_back(n.y());
+                m_WeldNormal.push_back(n.z());
+            }
+            m_WeldIndex[i] = result.first->second;
+        }
+
+        m_NumberOfWelds = (GLsizei)welds.size();
+
+        m_WeldOffsets.assign(m_NumberOfWelds + 1, 0);
+        for (GLsizei i = 0; i < numberOfVertices; i++)
+            m_WeldOffsets[m_WeldIndex[i] + 1]++;
+        for (GLsizei i = 0; i < m_NumberOfWelds; i++)
+            m_WeldOffsets[i + 1] += m_WeldOffsets[i];
+
+        std::vector<GLsizei> cursor(m_WeldOffsets.begin(), m_WeldOffsets.end() - 1);
+        m_WeldVertices.resize(numberOfVertices);
+        for (GLsizei i = 0; i < numberOfVertices; i++)
+            m_WeldVertices[cursor[m_WeldIndex[i]]++] = i;
+
+        m_WeldTangent.resize(m_NumberOfWelds * 3);
+        m_WeldBitangent.resize(m_NumberOfWelds * 3);
+    }
+
+    void TangentSpace::computeTriangles(GLsizei triangleBegin, GLsizei triangleEnd)
+    {
+        assert(triangleBegin % LANES == 0);
+
+        for (GLsizei t = triangleBegin; t < triangleEnd; t += LANES)
+        {
+            Lane x0 = laneLoad(&m_PositionX[0][t]), y0 = laneLoad(&m_PositionY[0][t]), z0 = laneLoad(&m_PositionZ[0][t]);
+            Lane u0 = laneLoad(&m_TextureU[0][t]), v0 = laneLoad(&m_TextureV[0][t]);
+
+            // Edges of the triangle : position delta
+            Lane dx1 = laneSub(laneLoad(&m_PositionX[1][t]), x0);
+            Lane dy1 = laneSub(laneLoad(&m_PositionY[1][t]), y0);
+            Lane dz1 = laneSub(laneLoad(&m_PositionZ[1][t]), z0);
+            Lane dx2 = laneSub(laneLoad(&m_PositionX[2][t]), x0);
+            Lane dy2 = laneSub(laneLoad(&m_PositionY[2][t]), y0);
+            Lane dz2 = laneSub(laneLoad(&m_PositionZ[2][t]), z0);
+
+            // UV delta
+            Lane du1 = laneSub(laneLoad(&m_TextureU[1][t]), u0);
+            Lane dv1 = laneSub(laneLoad(&m_TextureV[1][t]), v0);
+            Lane du2 = laneSub(laneLoad(&m_TextureU[2][t]), u0);
+            Lane dv2 = laneSub(laneLoad(&m_TextureV[2][t]), v0);
+
+            // Degenerate texture mappings get a zero reciprocal and contribute nothing.
+            Lane r = laneSafeReciprocal(laneSub(laneMul(du1, dv2), laneMul(dv1, du2)));
+
+            laneStore(&m_TriangleTangentX[t], laneMul(laneSub(laneMul(dx1, dv2), laneMul(dx2, dv1)), r));
+            laneStore(&m_TriangleTangentY[t], laneMul(laneSub(laneMul(dy1, dv2), laneMul(dy2, dv1)), r));
+            laneStore(&m_TriangleTangentZ[t], laneMul(laneSub(laneMul(dz1, dv2), laneMul(dz2, dv1)), r));
+
+            laneStore(&m_TriangleBitangentX[t], laneMul(laneSub(laneMul(dx2, du1), laneMul(dx1, du2)), r));
+            laneStore(&m_TriangleBitangentY[t], laneMul(laneSub(laneMul(dy2, du1), laneMul(dy1, du2)), r));
+            laneStore(&m_TriangleBitangentZ[t], laneMul(laneSub(laneMul(dz2, du1), laneMul(dz1, du2)), r));
+        }
+    }
+
+    void TangentSpace::orthonormalize(GLsizei weldBegin, GLsizei weldEnd)
+    {
+        for (GLsizei w = weldBegin; w < weldEnd; w++)
+        {
+            btVector3 t(0.0f, 0.0f, 0.0f);
+            btVector3 b(0.0f, 0.0f, 0.0f);
+
+            for (GLsizei i = m_WeldOffsets[w]; i < m_WeldOffsets[w + 1]; i++)
+            {
+                const GLsizei triangle = m_WeldVertices[i] / 3;
+
+                t += btVector3(m_TriangleTangentX[triangle], m_TriangleTangentY[triangle], m_TriangleTangentZ[triangle]);
+                b += btVector3(m_TriangleBitangentX[triangle], m_TriangleBitangentY[triangle], m_TriangleBitangentZ[triangle]);
+            }
+
+            const btVector3 n(m_WeldNormal[(w * 3) + 0], m_WeldNormal[(w * 3) + 1], m_WeldNormal[(w * 3) + 2]);
+
+            // Gram-Schmidt orthogonalize
+            t = t - n * n.dot(t);
+
+            if(t.length2() > SIMD_EPSILON)
+            {
+                t.normalize();
+            }
+            else
+            {
+                btVector3 unused;
+                btPlaneSpace1(n, t, unused);
+            }
+
+            // Calculate handedness
+            btVector3 bitangent(n.cross(t));
+            if(bitangent.dot(b) < 0.0f)
+                bitangent = -bitangent;
+
+            m_WeldTangent[(w * 3) + 0] = t.x();
+            m_WeldTangent[(w * 3) + 1] = t.y();
+            m_WeldTangent[(w * 3) + 2] = t.z();
+
+            m_WeldBitangent[(w * 3) + 0] = bitangent.x();
+            m_WeldBitangent[(w * 3) + 1] = bitangent.y();
+            m_WeldBitangent[(w * 3) + 2] = bitangent.z();
+        }
+    }
+
+    void TangentSpace::scatter(TexturedColoredVertex *vertices, GLsizei vertexBegin, GLsizei vertexEnd)const
+    {
+        for (GLsizei i = vertexBegin; i < vertexEnd; i++)
+        {
+            const GLsizei w = m_WeldIndex[i] * 3;
+
+            vertices[i].tangent = btVector3(m_WeldTangent[w + 0], m_WeldTangent[w + 1], m_WeldTangent[w + 2]);
+            vertices[i].bitangent = btVector3(m_WeldBitangent[w + 0], m_WeldBitangent[w + 1], m_WeldBitangent[w + 2]);
+        }
+    }
+}
@@ -0,0 +1,79 @@
+//
+//  TangentSpace.hpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#ifndef TangentSpace_hpp
+#define TangentSpace_hpp
+
+#import <OpenGLES/ES2/glext.h>
+#import <OpenGLES/ES2/gl.h>
+
+#include <vector>
+
+namespace jamesfolk
+{
+    struct TexturedColoredVertex;
+
+    // Generates per-vertex tangent frames for an un-indexed triangle list.
+    //
+    // The vertices are split into structure-of-arrays streams, the per-triangle
+    // tangents are computed four triangles at a time, and the results are
+    // accumulated and Gram-Schmidt orthonormalized per welded vertex (vertices
+    // that share position, texture coordinate and normal). Each pass runs in
+    // parallel chunks on Bullet's task scheduler. The scratch streams are kept
+    // between calls so the same generator can be reused for every subdivision
+    // level.
+    class TangentSpace
+    {
+    public:
+        TangentSpace();
+        ~TangentSpace();
+
+        void generate(TexturedColoredVertex *vertices, GLsizei numberOfVertices);
+
+    protected:
+        void gather(const TexturedColoredVertex *vertices, GLsizei triangleBegin, GLsizei triangleEnd);
+        void weld(const TexturedColoredVertex *vertices, GLsizei numberOfVertices);
+        void computeTriangles(GLsizei triangleBegin, GLsizei triangleEnd);
+        void orthonormalize(GLsizei weldBegin, GLsizei weldEnd);
+        void scatter(TexturedColoredVertex *vertices, GLsizei vertexBegin, GLsizei vertexEnd)const;
+
+    private:
+        TangentSpace(const TangentSpace &rhs);
+        const TangentSpace &operator=(const TangentSpace &rhs);
+
+        GLsizei m_NumberOfTriangles;
+        GLsizei m_NumberOfWelds;
+
+        // Per triangle corner (0, 1, 2), indexed by triangle.
+        std::vector<float> m_PositionX[3];
+        std::vector<float> m_PositionY[3];
+        std::vector<float> m_PositionZ[3];
+        std::vector<float> m_TextureU[3];
+        std::vector<float> m_TextureV[3];
+
+        // Un-normalized per triangle tangent and bitangent.
+        std::vector<float> m_TriangleTangentX;
+        std::vector<float> m_TriangleTangentY;
+        std::vector<float> m_TriangleTangentZ;
+        std::vector<float> m_TriangleBitangentX;
+        std::vector<float> m_TriangleBitangentY;
+        std::vector<float> m_TriangleBitangentZ;
+
+        // Vertex -> weld, and weld -> vertices (compressed rows).
+        std::vector<GLsizei> m_WeldIndex;
+        std::vector<GLsizei> m_WeldOffsets;
+        std::vector<GLsizei> m_WeldVertices;
+
+        // Per weld normal and orthonormalized frame.
+        std::vector<float> m_WeldNormal;
+        std::vector<float> m_WeldTangent;
+        std::vector<float> m_WeldBitangent;
+    };
+}
+
+#endif /* TangentSpace_hpp */
@@ -0,0 +1,317 @@
+//
+//  TrianglePicker.cpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#include "TrianglePicker.hpp"
+#include "Geometry.hpp"
+
+#include "btDbvt.h"
+
+#include <assert.h>
+
+namespace jamesfolk
+{
+    struct TriangleRayCallback : public btDbvt::ICollide
+    {
+        TriangleRayCallback(const btVector3 &from,
+                            const btVector3 &direction,
+                            float maxDistance,
+                            const btAlignedObjectArray<btVector3> &vertices):
+        m_From(from),
+        m_Direction(direction),
+        m_Vertices(vertices),
+        m_Distance(maxDistance),
+        m_Leaf(-1)
+        {
+        }
+
+        // Moller-Trumbore, both faces.
+        void Process(const btDbvtNode *leaf)
+        {
+            const int index = leaf->dataAsInt;
+            const btVector3 &a = m_Vertices[index * 3 + 0];
+            const btVector3 edge1(m_Vertices[index * 3 + 1] - a);
+            const btVector3 edge2(m_Vertices[index * 3 + 2] - a);
+
+            const btVector3 p(m_Direction.cross(edge2));
+            const btScalar determinant = edge1.dot(p);
+            if(btFabs(determinant) < SIMD_EPSILON)
+                return;
+
+            const btScalar inverseDeterminant = btScalar(1.0) / determinant;
+            const btVector3 s(m_From - a);
+
+            const btScalar u = s.dot(p) * inverseDeterminant;
+            if(u < 0 || u > 1)
+                return;
+
+            const btVector3 q(s.cross(edge1));
+            const btScalar v = m_Direction.dot(q) * inverseDeterminant;
+            if(v < 0 || u + v > 1)
+                return;
+
+            const btScalar t = edge2.dot(q) * inverseDeterminant;
+            if(t >= 0 && t < m_Distance)
+            {
+                m_Distance = t;
+                m_Leaf = index;
+                m_Normal = edge1.cross(edge2);
+            }
+        }
+
+        const btVector3 &m_From;
+        const btVector3 &m_Direction;
+        const btAlignedObjectArray<btVector3> &m_Vertices;
+
+        btScalar m_Distance;
+        int m_Leaf;
+        btVector3 m_Normal;
+    };
+
+    // Leaves reinserted by the incremental optimization per refitted leaf.
+    static const int OPTIMIZE_RATIO = 16;
+
+    static void refitVolumes(btDbvtNode *node)
+    {
+        if(node && node->isinternal())
+        {
+            refitVolumes(node->childs[0]);
+            refitVolumes(node->childs[1]);
+
+            Merge(node->childs[0]->volume, node->childs[1]->volume, node->volume);
+        }
+    }
+
+    TrianglePicker::TrianglePicker(float margin):
+    m_Tree(new btDbvt()),
+    m_TrianglesPerInstance(0),
+    m_Margin(margin),
+    m_NumberOfTriangles(0),
+    m_NumberOfRefits(0)
+    {
+    }
+
+    TrianglePicker::~TrianglePicker()
+    {
+        clear();
+
+        delete m_Tree;
+        m_Tree = NULL;
+    }
+
+    void TrianglePicker::update(const Geometry &geometry)
+    {
+        const GLsizei trianglesPerInstance = geometry.numberOfVertices() / 3;
+        const GLsizei numberOfInstances = geometry.numberOfInstances();
+
+        // Subdividing changes every triangle, so start over.
+        if(trianglesPerInstance != m_TrianglesPerInstance ||
+           numberOfInstances != (GLsizei)m_Instances.size())
+        {
+            clear();
+
+            m_TrianglesPerInstance = trianglesPerInstance;
+            m_Instances.resize(numberOfInstances, false);
+            m_Revisions.resize(numberOfInstances, 0);
+            m_Leaves.resize(numberOfInstances * trianglesPerInstance, NULL);
+            m_Vertices.resize(numberOfInstances * trianglesPerInstance * 3);
+        }
+
+        m_NumberOfRefits = 0;
+        m_Escaped.resize(0);
+
+        btVector3 vertices[3];
+        for (GLsizei instanceIdx = 0; instanceIdx < numberOfInstances; instanceIdx++)
+        {
+            const bool referenced = geometry.isInstanceReferenced(instanceIdx);
+            if(referenced != m_Instances[instanceIdx])
+            {
+                if(referenced)
+                    insertInstance(geometry, instanceIdx);
+                else
+                    removeInstance(instanceIdx);
+                continue;
+            }
+
+            // Instances whose vertex transforms were not written since the
+            // last update are skipped without reading them.
+            const unsigned long revision = geometry.getInstanceRevision(instanceIdx);
+            if(!referenced || revision == m_Revisions[instanceIdx])
+                continue;
+            m_Revisions[instanceIdx] = revision;
+
+            const int first = instanceIdx * m_TrianglesPerInstance;
+            for (GLsizei triangleIdx = 0; triangleIdx < m_TrianglesPerInstance; triangleIdx++)
+            {
+                const int index = first + triangleIdx;
+
+                getTriangle(geometry, instanceIdx, triangleIdx, vertices);
+                m_Vertices[index * 3 + 0] = vertices[0];
+                m_Vertices[index * 3 + 1] = vertices[1];
+                m_Vertices[index * 3 + 2] = vertices[2];
+
+                if(!m_Leaves[index]->volume.Contain(btDbvtVolume::FromPoints(vertices, 3)))
+                    m_Escaped.push_back(index);
+            }
+        }
+
+        if(m_Escaped.size() == 0)
+            return;
+
+        // A few escaped leaves are reinserted where they fit best. When most
+        // of the tree moved (every shard of an explosion), reinserting is
+        // slower than growing the boxes in place, and the incremental
+        // optimization below restores the tree over the next frames.
+        const bool refitInPlace = (m_Escaped.size() * 8 > (int)m_NumberOfTriangles);
+
+        for (int i = 0; i < m_Escaped.size(); i++)
+        {
+            const int index = m_Escaped[i];
+
+            btDbvtVolume volume(btDbvtVolume::FromPoints(&m_Vertices[index * 3], 3));
+            volume.Expand(btVector3(m_Margin, m_Margin, m_Margin));
+
+            if(refitInPlace)
+                m_Leaves[index]->volume = volume;
+            else
+                m_Tree->update(m_Leaves[index], volume);
+        }
+
+        if(refitInPlace)
+            refitVolumes(m_Tree->m_root);
+
+        m_NumberOfRefits = m_Escaped.size();
+        m_Tree->optimizeIncremental(1 + m_NumberOfRefits / OPTIMIZE_RATIO);
+    }
+
+    void TrianglePicker::clear()
+    {
+        m_Tree->clear();
+
+        m_Leaves.clear();
+        m_Vertices.clear();
+        m_Instances.clear();
+        m_Revisions.clear();
+
+        m_TrianglesPerInstance = 0;
+        m_NumberOfTriangles = 0;
+        m_NumberOfRefits = 0;
+    }
+
+    bool TrianglePicker::pick(const btVector3 &from, const btVector3 &to, Hit &hit)const
+    {
+        btVector3 direction(to - from);
+        const btScalar length = direction.length();
+        if(m_Tree->m_root == NULL || length < SIMD_EPSILON)
+            return false;
+        direction /= length;
+
+        // Same setup as btDbvtBroadphase::rayTest.
+        btVector3 inverseDirection;
+        inverseDirection[0] = direction[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[0];
+        inverseDirection[1] = direction[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[1];
+        inverseDirection[2] = direction[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[2];
+        unsigned int signs[3] =
+        {
+            inverseDirection[0] < 0.0,
+            inverseDirection[1] < 0.0,
+            inverseDirection[2] < 0.0
+        };
+
+        TriangleRayCallback callback(from, direction, length, m_Vertices);
+        m_Tree->rayTestInternal(m_Tree->m_root,
+                                from,
+                                to,
+                                inverseDirection,
+                                signs,
+                                length,
+                                btVector3(0, 0, 0),
+                                btVector3(0, 0, 0),
+                                callback);
+
+        if(callback.m_Leaf < 0)
+            return false;
+
+        hit.instance = callback.m_Leaf / m_TrianglesPerInstance;
+        hit.triangle = callback.m_Leaf % m_TrianglesPerInstance;
+        hit.distance = callback.m_Distance;
+        hit.point = from + direction * callback.m_Distance;
+
+        hit.normal = callback.m_Normal;
+        if(hit.normal.length2() > 0.0f)
+            hit.normal.normalize();
+        // Face the ray, the teapot is not closed once it explodes.
+        if(hit.normal.dot(direction) > 0.0f)
+            hit.normal = -hit.normal;
+
+        return true;
+    }
+
+    unsigned long TrianglePicker::numberOfTriangles()const
+    {
+        return m_NumberOfTriangles;
+    }
+
+    unsigned long TrianglePicker::numberOfRefits()const
+    {
+        return m_NumberOfRefits;
+    }
+
+    void TrianglePicker::insertInstance(const Geometry &geometry, GLsizei instanceIdx)
+    {
+        assert(!m_Instances[instanceIdx]);
+
+        btVector3 vertices[3];
+        const int first = instanceIdx * m_TrianglesPerInstance;
+        for (GLsizei triangleIdx = 0; triangleIdx < m_TrianglesPerInstance; triangleIdx++)
+        {
+            const int index = first + triangleIdx;
+
+            getTriangle(geometry, instanceIdx, triangleIdx, vertices);
+            m_Vertices[index * 3 + 0] = vertices[0];
+            m_Vertices[index * 3 + 1] = vertices[1];
+            m_Vertices[index * 3 + 2] = vertices[2];
+
+            btDbvtVolume volume(btDbvtVolume::FromPoints(vertices, 3));
+            volume.Expand(btVector3(m_Margin, m_Margin, m_Margin));
+
+            btDbvtNode *leaf = m_Tree->insert(volume, NULL);
+            leaf->dataAsInt = index;
+            m_Leaves[index] = leaf;
+        }
+
+        m_Instances[instanceIdx] = true;
+        m_Revisions[instanceIdx] = geometry.getInstanceRevision(instanceIdx);
+        m_NumberOfTriangles += m_TrianglesPerInstance;
+        m_NumberOfRefits += m_TrianglesPerInstance;
+    }
+
+    void TrianglePicker::removeInstance(GLsizei instanceIdx)
+    {
+        assert(m_Instances[instanceIdx]);
+
+        const int first = instanceIdx * m_TrianglesPerInstance;
+        for (GLsizei triangleIdx = 0; triangleIdx < m_TrianglesPerInstance; triangleIdx++)
+        {
+            m_Tree->remove(m_Leaves[first + triangleIdx]);
+            m_Leaves[first + triangleIdx] = NULL;
+        }
+
+        m_Instances[instanceIdx] = false;
+        m_NumberOfTriangles -= m_TrianglesPerInstance;
+    }
+
+    void TrianglePicker::getTriangle(const Geometry &geometry, GLsizei instanceIdx, GLsizei triangleIdx, btVector3 *vertices)const
+    {
+        // The mesh is an unindexed triangle list.
+        const GLsizei verticeIdx = triangleIdx * 3;
+
+        vertices[0] = geometry.getVertexWorldPosition(instanceIdx, verticeIdx + 0);
+        vertices[1] = geometry.getVertexWorldPosition(instanceIdx, verticeIdx + 1);
+        vertices[2] = geometry.getVertexWorldPosition(instanceIdx, verticeIdx + 2);
+    }
+}
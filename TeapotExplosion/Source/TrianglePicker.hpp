@@ -0,0 +1,90 @@
+//
+//  TrianglePicker.hpp
+//  TeapotExplosion
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#ifndef TrianglePicker_hpp
+#define TrianglePicker_hpp
+
+#import <OpenGLES/ES2/glext.h>
+#import <OpenGLES/ES2/gl.h>
+
+#include <vector>
+
+#include "btVector3.h"
+#include "btAlignedObjectArray.h"
+
+struct btDbvt;
+struct btDbvtNode;
+
+namespace jamesfolk
+{
+    class Geometry;
+
+    // Ray picking against the world space triangles of a geometry.
+    //
+    // Every triangle of a referenced instance is a leaf in a dynamic AABB
+    // tree (btDbvt). update() refits the tree to the current vertex
+    // transforms of the instances that changed since the last call, so it
+    // is meant to be called right before pick() rather than every frame: a leaf
+    // is only moved when its triangle has left the margin around the box it
+    // was last given, so shards that move a little each frame are cheap.
+    // pick() walks the tree with the ray and runs an exact ray/triangle test
+    // on the leaves it reaches.
+    class TrianglePicker
+    {
+    public:
+        struct Hit
+        {
+            GLsizei instance;
+            GLsizei triangle;
+            // Distance from the ray origin.
+            float distance;
+            btVector3 point;
+            btVector3 normal;
+        };
+
+        TrianglePicker(float margin = 0.05f);
+        ~TrianglePicker();
+
+        void update(const Geometry &geometry);
+        void clear();
+
+        // Nearest triangle hit between from and to.
+        bool pick(const btVector3 &from, const btVector3 &to, Hit &hit)const;
+
+        unsigned long numberOfTriangles()const;
+        // Leaves that were moved by the last update().
+        unsigned long numberOfRefits()const;
+
+    protected:
+        void insertInstance(const Geometry &geometry, GLsizei instanceIdx);
+        void removeInstance(GLsizei instanceIdx);
+        void getTriangle(const Geometry &geometry, GLsizei instanceIdx, GLsizei triangleIdx, btVector3 *vertices)const;
+
+    private:
+        TrianglePicker(const TrianglePicker &rhs);
+        const TrianglePicker &operator=(const TrianglePicker &rhs);
+
+        btDbvt *m_Tree;
+        // One leaf per triangle, instance major. NULL for instances that are
+        // not referenced.
+        std::vector<btDbvtNode*> m_Leaves;
+        // Three world space vertices per leaf, from the last update().
+        btAlignedObjectArray<btVector3> m_Vertices;
+        std::vector<bool> m_Instances;
+        // Geometry::getInstanceRevision() at the last refit of each instance.
+        std::vector<unsigned long> m_Revisions;
+        btAlignedObjectArray<int> m_Escaped;
+
+        GLsizei m_TrianglesPerInstance;
+        float m_Margin;
+        unsigned long m_NumberOfTriangles;
+        unsigned long m_NumberOfRefits;
+    };
+}
+
+#endif /* TrianglePicker_hpp */
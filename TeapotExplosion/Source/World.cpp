@@ -8,6 +8,7 @@
 
 #include "World.hpp"
 #include <stdlib.h>
+#include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -18,6 +19,10 @@
 #include "Camera.hpp"
 #include "Node.hpp"
 #include "Scene.hpp"
+#include "ProgramCache.hpp"
+#include "ShaderVariantCache.hpp"
+#include "NodePool.hpp"
+#include "TrianglePicker.hpp"
 
 
 static unsigned int MAXIMUM_TEAPOTS = 10;
@@ -40,6 +45,10 @@ namespace jamesfolk
 {
     World *World::s_Instance = NULL;
     std::string World::s_BundlePath = "";
+    std::string World::s_CachePath = "";
+    World::ContextCallback World::s_MakeBackgroundContextCurrent = NULL;
+    World::ContextCallback World::s_ReleaseBackgroundContext = NULL;
+    void *World::s_BackgroundContext = NULL;
     
     World *const World::getInstance()
     {
@@ -108,6 +117,18 @@ namespace jamesfolk
     {
         s_BundlePath = path;
     }
+    
+    void World::setCachePath(const std::string &path)
+    {
+        s_CachePath = path;
+    }
+    
+    void World::setBackgroundContext(ContextCallback makeCurrent, ContextCallback release, void *userData)
+    {
+        s_MakeBackgroundContextCurrent = makeCurrent;
+        s_ReleaseBackgroundContext = release;
+        s_BackgroundContext = userData;
+    }
 
     void World::create()
     {
@@ -140,6 +161,8 @@ namespace jamesfolk
         m_Scene->addActiveNode(m_CameraNode);
         m_Scene->addActiveCamera(m_Camera);
         
+        m_ProgramCache->setDirectory(s_CachePath);
+        
         unsigned long i = 0;
         for (std::vector<Shader*>::iterator iter = m_Shaders.begin();
              iter != m_Shaders.end();
@@ -150,14 +173,23 @@ namespace jamesfolk
             std::string vertexShader = loadASCIIFile(std::string("Shaders/") + shaderName + std::string(".vert"));
             std::string fragmentShader = loadASCIIFile(std::string("Shaders/") + shaderName + std::string(".frag"));
             
-            assert(shader->load(vertexShader, fragmentShader));
+            assert(shader->load(vertexShader, fragmentShader, m_ProgramCache));
             m_ShaderMap.insert(ShaderMapPair(shaderName, shader));
             
+            if(shaderName == "StandardShader")
+            {
+                assert(m_ShaderVariants == NULL);
+                m_ShaderVariants = new ShaderVariantCache(shader, vertexShader, fragmentShader, m_ProgramCache);
+                m_ShaderVariants->setBackgroundContext(s_MakeBackgroundContextCurrent,
+                                                       s_ReleaseBackgroundContext,
+                                                       s_BackgroundContext);
+            }
         }
         
         m_Scene->getRootNode()->setOrigin(btVector3(0.0f, 0.0f, 5.0f));
         
         m_Geometry->load(m_Shaders[0], objFileData, MAXIMUM_TEAPOTS, MAXIMUM_SUBDIVISIONS);
+        m_Geometry->setShaderVariants(m_ShaderVariants);
         
         float y = 0.0f;
         float z = -3.0f;
@@ -209,6 +241,9 @@ namespace jamesfolk
         GLint params[4];
         glGetIntegerv(GL_VIEWPORT, params);
         
+        m_ViewportOrigin = btVector2(x, y);
+        m_ViewportSize = btVector2(width, height);
+        
         if(params[2] != width && params[3] != height)
         {
             glViewport(x, y, width, height);
@@ -219,11 +254,23 @@ namespace jamesfolk
     
     void World::update(float step)
     {
+        // The vertex transforms are still the ones on screen when the
+        // touches are handled, pick() fits the picker to them.
         for (std::vector<Touch>::iterator i = m_Touches.begin();
              i != m_Touches.end();
              i++)
         {
             Touch t = *i;
+            
+            if(t.state == TouchState_Down)
+            {
+                if(!pick(t.touch, m_LastPick))
+                    m_LastPick.node = NULL;
+#if defined(DEBUG)
+                else
+                    std::cout << "Picked triangle " << m_LastPick.triangle << " at " << m_LastPick.distance << std::endl;
+#endif
+            }
         }
         m_Touches.clear();
         
@@ -279,6 +326,9 @@ namespace jamesfolk
     {
         glClear(GL_COLOR_BUFFER_BIT|GL_DEPTH_BUFFER_BIT);
         
+        if(m_ShaderVariants)
+            m_ShaderVariants->update();
+        
         m_Scene->render();
     }
     
@@ -291,6 +341,51 @@ namespace jamesfolk
         m_Touches.push_back(t);
     }
     
+    bool World::pick(const btVector2 &touch, Pick &result)const
+    {
+        if(m_ViewportSize.x() <= 0.0f || m_ViewportSize.y() <= 0.0f)
+            return false;
+        
+        const btVector2 ndc((2.0f * (touch.x() - m_ViewportOrigin.x()) / m_ViewportSize.x()) - 1.0f,
+                            1.0f - (2.0f * (touch.y() - m_ViewportOrigin.y()) / m_ViewportSize.y()));
+        
+        btVector3 from, to;
+        m_Camera->unProject(ndc, from, to);
+        
+        // Refit lazily: frames without a touch never touch the tree, and the
+        // first pick after the shards moved refits only the instances whose
+        // vertex transforms were written since the last pick.
+        m_TrianglePicker->update(*m_Geometry);
+        
+        TrianglePicker::Hit hit;
+        if(!m_TrianglePicker->pick(from, to, hit))
+            return false;
+        
+        for (std::vector<Node*>::const_iterator i = m_TeapotNodes.begin();
+             i != m_TeapotNodes.end();
+             i++)
+        {
+            Node *node = *i;
+            
+            if(node->getGeometry() == m_Geometry &&
+               m_Geometry->getGeometryIndex(node) == hit.instance)
+            {
+                result.node = node;
+                result.triangle = hit.triangle;
+                result.distance = hit.distance;
+                result.point = hit.point;
+                result.normal = hit.normal;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    const World::Pick &World::getLastPick()const
+    {
+        return m_LastPick;
+    }
+    
     void World::setShader(const std::string &shader)
     {
         ShaderMap::iterator i = m_ShaderMap.find(shader);
@@ -468,6 +563,10 @@ namespace jamesfolk
     m_Camera(new Camera()),
     m_CameraNode(new Node()),
     m_Scene(new Scene()),
+    m_ProgramCache(new ProgramCache()),
+    m_ShaderVariants(NULL),
+    m_NodePool(new NodePool(MAXIMUM_TEAPOTS)),
+    m_TrianglePicker(new TrianglePicker()),
     m_NumberOfTeapots(1),
     m_Rotation(0.0f),
     m_TriangleShrapnelTransforms(NULL),
@@ -475,6 +574,8 @@ namespace jamesfolk
     m_CurrentVelocity(NULL),
     m_Normals(NULL),
     m_NumberOfTriangles(0),
+    m_ViewportOrigin(0.0f, 0.0f),
+    m_ViewportSize(0.0f, 0.0f),
     m_IsExploding(false),
     m_AmbientTextureImage(NULL),
     m_SpecularTextureImage(NULL),
@@ -484,8 +585,11 @@ namespace jamesfolk
     m_SpecularTexture(0),
     m_NormalTexture(0)
     {
-        for (unsigned long i = 0; i < MAXIMUM_TEAPOTS; i++)
-            m_TeapotNodes.push_back(new Node());
+        m_NodePool->create(MAXIMUM_TEAPOTS, m_TeapotNodes);
+        
+        m_LastPick.node = NULL;
+        m_LastPick.triangle = 0;
+        m_LastPick.distance = 0.0f;
         
         unsigned long i = 0;
         const char *shaderName = SHADERNAMES[i];
@@ -544,6 +648,10 @@ namespace jamesfolk
             delete [] m_TriangleShrapnelTransforms;
         m_TriangleShrapnelTransforms = NULL;
         
+        // Stops the variant compiler before the shaders and cache go away.
+        delete m_ShaderVariants;
+        m_ShaderVariants = NULL;
+        
         while(!m_Shaders.empty())
         {
             Shader *shader = m_Shaders.back();
@@ -552,14 +660,11 @@ namespace jamesfolk
             m_Shaders.pop_back();
         }
         
-        while(!m_TeapotNodes.empty())
-        {
-            Node *node = m_TeapotNodes.back();
-            delete node;
-            
-            m_TeapotNodes.pop_back();
-        }
+        m_NodePool->destroy(m_TeapotNodes);
         
+        delete m_TrianglePicker;
+        delete m_NodePool;
+        delete m_ProgramCache;
         delete m_Scene;
         delete m_CameraNode;
         delete m_Camera;
@@ -32,10 +32,16 @@ namespace jamesfolk
     class Camera;
     class Node;
     class Scene;
+    class ProgramCache;
+    class ShaderVariantCache;
+    class NodePool;
+    class TrianglePicker;
     
     class World
     {
     public:
+        typedef void (*ContextCallback)(void *userData);
+        
         static World *const getInstance();
         static void createInstance();
         static void destroyInstance();
@@ -43,6 +49,10 @@ namespace jamesfolk
         
         static void loadPngFile(const std::string &filepath, GLubyte **row_pointers);
         static void setBundlePath(const std::string &path);
+        static void setCachePath(const std::string &path);
+        // A context sharing objects with the render context, made current on
+        // the thread that compiles shader variants.
+        static void setBackgroundContext(ContextCallback makeCurrent, ContextCallback release, void *userData);
         
         void create();
         void destroy();
@@ -61,6 +71,22 @@ namespace jamesfolk
         
         void addTouch(TouchState state, const btVector2 &touch, unsigned long taps);
         
+        struct Pick
+        {
+            Node *node;
+            GLsizei triangle;
+            float distance;
+            btVector3 point;
+            btVector3 normal;
+        };
+        
+        // Casts a ray through a point in viewport pixels (origin top left)
+        // and finds the nearest teapot triangle under it. The picker is refit
+        // to the current vertex transforms first if they changed.
+        bool pick(const btVector2 &touch, Pick &result)const;
+        // The result of the last touch down, node is NULL on a miss.
+        const Pick &getLastPick()const;
+        
         void setShader(const std::string &shader);
         
         void setNumberOfTeapots(const int num);
@@ -285,6 +311,10 @@ namespace jamesfolk
     private:
         static World *s_Instance;
         static std::string s_BundlePath;
+        static std::string s_CachePath;
+        static ContextCallback s_MakeBackgroundContextCurrent;
+        static ContextCallback s_ReleaseBackgroundContext;
+        static void *s_BackgroundContext;
         
         World();
         World(const World &world);
@@ -298,6 +328,10 @@ namespace jamesfolk
         Camera *m_Camera;
         Node *m_CameraNode;
         Scene *m_Scene;
+        ProgramCache *m_ProgramCache;
+        ShaderVariantCache *m_ShaderVariants;
+        NodePool *m_NodePool;
+        TrianglePicker *m_TrianglePicker;
         
         typedef std::map<std::string, Shader*> ShaderMap;
         typedef std::pair<std::string, Shader*> ShaderMapPair;
@@ -320,6 +354,10 @@ namespace jamesfolk
             unsigned long taps;
         };
         std::vector<Touch> m_Touches;
+        Pick m_LastPick;
+        
+        btVector2 m_ViewportOrigin;
+        btVector2 m_ViewportSize;
         
         bool m_IsExploding;
         
@@ -4,6 +4,17 @@
 precision highp float;
 #endif
 
+// Permutations are built by prepending "#define PERMUTATION 1" and the
+// feature defines below. Without PERMUTATION every term is compiled in and
+// selected at runtime from the uniforms (the general variant).
+#ifndef PERMUTATION
+#define RIM_LIGHT 1
+#define SPOT_LIGHT 1
+#define ATTENUATION 1
+#define LINEAR_FOG 1
+#define EXPONENTIAL_FOG 1
+#endif
+
 varying vec2 VertexUV_modelspace;
 varying vec3 Position_worldspace;
 varying vec3 Normal_modelspace;
@@ -287,9 +298,13 @@ void PointLight(in float materialShininess,
     VP = normalize(VP);
     
     // Compute attenuation
+#ifdef ATTENUATION
     attenuation = 1.0 / (lightSource.constantAttenuation +
                          lightSource.linearAttenuation * d +
                          lightSource.quadraticAttenuation * d * d);
+#else
+    attenuation = 1.0;
+#endif
     
     halfVector = normalize(VP + eye);
 
@@ -329,6 +344,7 @@ void PointLight(in float materialShininess,
     specular += lightSource.specular * pf * attenuation;
 }
 
+#ifdef SPOT_LIGHT
 void SpotLight(in float materialShininess,
                 in LightSourceParameters lightSource,
                 in vec3 eye, in vec3 ecPosition3, in vec3 normal, in vec3 lightDirection_tangentspace, in vec3 eyeDirection_tangentspace, in vec3 textureNormal_tangentspace, inout vec4 ambient, inout vec4 diffuse, inout vec4 specular)
@@ -353,9 +369,13 @@ void SpotLight(in float materialShininess,
     VP = normalize(VP);
     
     // Compute attenuation
+#ifdef ATTENUATION
     attenuation = 1.0 / (lightSource.constantAttenuation +
                          lightSource.linearAttenuation * d +
                          lightSource.quadraticAttenuation * d * d);
+#else
+    attenuation = 1.0;
+#endif
     
     // See if point on surface is inside cone of illumination
     spotDot = dot(-VP, normalize(lightSource.spotDirection));
@@ -387,6 +407,7 @@ void SpotLight(in float materialShininess,
     diffuse  += lightSource.diffuse * nDotVP * attenuation;
     specular += lightSource.specular * pf * attenuation;
 }
+#endif
 
 vec4 calc_lighting_color(in MaterialParameters material,
                          in LightSourceParameters lightSource[1],
@@ -407,7 +428,9 @@ vec4 calc_lighting_color(in MaterialParameters material,
     // Loop through enabled lights, compute contribution from each
     for (int i = 0; i < 1; i++)
     {
+#ifdef SPOT_LIGHT
         if (lightSource[i].spotCutoff == 180.0)
+#endif
         {
             if (lightSource[i].position.w == 0.0)
             {
@@ -436,6 +459,7 @@ vec4 calc_lighting_color(in MaterialParameters material,
                            spec);
             }
         }
+#ifdef SPOT_LIGHT
         else
         {
             SpotLight(material.shininess,
@@ -450,6 +474,7 @@ vec4 calc_lighting_color(in MaterialParameters material,
                       diff,
                       spec);
         }
+#endif
     }
     
     vec4 sceneColor = material.emission * material.ambient * lightAmbient;
@@ -547,9 +572,12 @@ void main()
                                      textureNormal_tangentspace);
     
     vec4 baseColor = color * Vertex_color;
+#ifdef RIM_LIGHT
     vec3 rimColor = computeRim(RimLightColor, RimLightStart, RimLightEnd, RimLightCoefficient);
     baseColor += vec4(rimColor, 0.0);
+#endif
     
+#if defined(EXPONENTIAL_FOG) && defined(LINEAR_FOG)
     if(FogDensity > 0.0)
     {
         baseColor = computeExponentialFogColor(baseColor);
@@ -558,6 +586,11 @@ void main()
     {
         baseColor = computeLinearFogColor(baseColor);
     }
+#elif defined(EXPONENTIAL_FOG)
+    baseColor = computeExponentialFogColor(baseColor);
+#elif defined(LINEAR_FOG)
+    baseColor = computeLinearFogColor(baseColor);
+#endif
     
     gl_FragColor = baseColor;
 }
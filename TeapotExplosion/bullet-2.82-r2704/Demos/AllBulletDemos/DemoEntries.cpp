@@ -170,6 +170,8 @@ btDemoEntry g_demoEntries[] =
 //	{"Benchmark Mesh-Prim",BenchmarkDemo5::Create},
 //	{"Benchmark Mesh-Convex",BenchmarkDemo6::Create},
 //	{"Benchmark Raycast",BenchmarkDemo7::Create},
+//	{"Benchmark 50k Sleeping",BenchmarkDemo8::Create},
+//	{"Benchmark Heightfield",BenchmarkDemo9::Create},
 
 	{"MemoryLeak Checker",btEmptyDebugDemo::Create},	
 	{0, 0}
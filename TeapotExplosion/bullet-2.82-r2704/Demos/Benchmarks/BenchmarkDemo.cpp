@@ -29,6 +29,10 @@ subject to the following restrictions:
 #include "Taru.mdl"
 #include "landscape.mdl"
 #include "BulletCollision/BroadphaseCollision/btDbvtBroadphase.h"
+#include "BulletCollision/BroadphaseCollision/btOpenAddressingPairCache.h"
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcherMt.h"
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "BulletDynamics/ConstraintSolver/btSoaConstraintSolver.h"
 #ifdef USE_PARALLEL_DISPATCHER_BENCHMARK
 #include "BulletMultiThreaded/SpuGatheringCollisionDispatcher.h"
 #include "BulletMultiThreaded/SequentialThreadSupport.h"
@@ -42,7 +46,7 @@ subject to the following restrictions:
 #ifdef _WIN32
 #include "BulletMultiThreaded/Win32ThreadSupport.h"
 #elif defined (USE_PTHREADS)
-#include "BulletMultiThreaded/PosixThreadSupport.h"
+#include "BulletMultiThreaded/TaskSchedulerThreadSupport.h"
 #endif
 #include "BulletMultiThreaded/SpuGatheringCollisionDispatcher.h"
 #include "BulletMultiThreaded/btParallelConstraintSolver.h"
@@ -64,10 +68,10 @@ btThreadSupportInterface* createSolverThreadSupport(int maxNumThreads)
 	Win32ThreadSupport* threadSupport = new Win32ThreadSupport(threadConstructionInfo);
 	threadSupport->startSPU();
 #elif defined (USE_PTHREADS)
-	PosixThreadSupport::ThreadConstructionInfo solverConstructionInfo("solver", SolverThreadFunc,
+	TaskSchedulerThreadSupport::ThreadConstructionInfo solverConstructionInfo("solver", SolverThreadFunc,
 																	  SolverlsMemoryFunc, maxNumThreads);
 	
-	PosixThreadSupport* threadSupport = new PosixThreadSupport(solverConstructionInfo);
+	TaskSchedulerThreadSupport* threadSupport = new TaskSchedulerThreadSupport(solverConstructionInfo);
 	
 #else
 	SequentialThreadSupport::SequentialThreadConstructionInfo tci("solverThreads",SolverThreadFunc,SolverlsMemoryFunc);
@@ -164,7 +168,7 @@ public:
 			sign = -1.0;
 	}
 
-	void cast (btCollisionWorld* cw)
+	void cast (btCollisionWorld* cw, bool useRayTestBatch)
 	{
 #ifdef USE_BT_CLOCK
 		frame_timer.reset ();
@@ -188,21 +192,40 @@ public:
 				normal[i].normalize ();
 		}
 #else
-		for (int i = 0; i < NUMRAYS; i++)
+		if (useRayTestBatch)
 		{
-			btCollisionWorld::ClosestRayResultCallback cb(source[i], dest[i]);
-			
-			cw->rayTest (source[i], dest[i], cb);
-			if (cb.hasHit ())
+			btCollisionWorld::ClosestRayResult results[NUMRAYS];
+			cw->rayTestBatch (source, dest, NUMRAYS, results);
+			for (int i = 0; i < NUMRAYS; i++)
 			{
-				hit[i] = cb.m_hitPointWorld;
-				normal[i] = cb.m_hitNormalWorld;
-				normal[i].normalize ();
-			} else {
-				hit[i] = dest[i];
-				normal[i] = btVector3(1.0, 0.0, 0.0);
+				if (results[i].hasHit ())
+				{
+					hit[i] = results[i].m_hitPointWorld;
+					normal[i] = results[i].m_hitNormalWorld;
+					normal[i].normalize ();
+				} else {
+					hit[i] = dest[i];
+					normal[i] = btVector3(1.0, 0.0, 0.0);
+				}
 			}
+		} else
+		{
+			for (int i = 0; i < NUMRAYS; i++)
+			{
+				btCollisionWorld::ClosestRayResultCallback cb(source[i], dest[i]);
+			
+				cw->rayTest (source[i], dest[i], cb);
+				if (cb.hasHit ())
+				{
+					hit[i] = cb.m_hitPointWorld;
+					normal[i] = cb.m_hitNormalWorld;
+					normal[i].normalize ();
+				} else {
+					hit[i] = dest[i];
+					normal[i] = btVector3(1.0, 0.0, 0.0);
+				}
 
+			}
 		}
 #ifdef USE_BT_CLOCK
 		ms += frame_timer.getTimeMilliseconds ();
@@ -278,7 +301,7 @@ void BenchmarkDemo::clientMoveAndDisplay()
 		m_dynamicsWorld->debugDrawWorld();
 	}
 		
-	if (m_benchmark==7)
+	if (m_benchmark==7 || m_benchmark==9)
 	{
 		castRays();
 
@@ -329,7 +352,18 @@ void	BenchmarkDemo::initPhysics()
 	m_collisionConfiguration = new btDefaultCollisionConfiguration(cci);
 
 	///use the default collision dispatcher. For parallel processing you can use a diffent dispatcher (see Extras/BulletMultiThreaded)
-	m_dispatcher = new	btCollisionDispatcher(m_collisionConfiguration);
+	if (m_useParallelDispatcher)
+	{
+		btCollisionDispatcherMt* dispatcherMt = new	btCollisionDispatcherMt(m_collisionConfiguration);
+		if (m_useGjkBatch)
+		{
+			dispatcherMt->setGjkBatchMinPairs(BT_GJK_BATCH_WIDTH);
+		}
+		m_dispatcher = dispatcherMt;
+	} else
+	{
+		m_dispatcher = new	btCollisionDispatcher(m_collisionConfiguration);
+	}
 	
 	m_dispatcher->setDispatcherFlags(btCollisionDispatcher::CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION);
 
@@ -339,8 +373,8 @@ void	BenchmarkDemo::initPhysics()
 #ifdef _WIN32
 	Win32ThreadSupport* threadSupportCollision = new Win32ThreadSupport(Win32ThreadSupport::Win32ThreadConstructionInfo(	"collision",processCollisionTask,	createCollisionLocalStoreMemory,maxNumOutstandingTasks));
 #elif defined (USE_PTHREADS)
-        PosixThreadSupport::ThreadConstructionInfo collisionConstructionInfo( "collision",processCollisionTask,       createCollisionLocalStoreMemory,maxNumOutstandingTasks);
-	PosixThreadSupport* threadSupportCollision = new PosixThreadSupport(collisionConstructionInfo);
+        TaskSchedulerThreadSupport::ThreadConstructionInfo collisionConstructionInfo( "collision",processCollisionTask,       createCollisionLocalStoreMemory,maxNumOutstandingTasks);
+	TaskSchedulerThreadSupport* threadSupportCollision = new TaskSchedulerThreadSupport(collisionConstructionInfo);
 #endif
 	//SequentialThreadSupport::SequentialThreadConstructionInfo sci("spuCD",	processCollisionTask,	createCollisionLocalStoreMemory);
 	//SequentialThreadSupport* seq = new SequentialThreadSupport(sci);
@@ -353,8 +387,15 @@ void	BenchmarkDemo::initPhysics()
 	btVector3 worldAabbMin(-1000,-1000,-1000);
 	btVector3 worldAabbMax(1000,1000,1000);
 	
-	btHashedOverlappingPairCache* pairCache = new btHashedOverlappingPairCache();
-	m_overlappingPairCache = new btAxisSweep3(worldAabbMin,worldAabbMax,3500,pairCache);
+	btOverlappingPairCache* pairCache = m_useOpenAddressingPairCache ? (btOverlappingPairCache*)new btOpenAddressingPairCache() : new btHashedOverlappingPairCache();
+	if (m_benchmark==8 || m_benchmark==9)
+	{
+		//too many objects for btAxisSweep3, or a terrain larger than its world
+		m_overlappingPairCache = new btDbvtBroadphase(pairCache);
+	} else
+	{
+		m_overlappingPairCache = new btAxisSweep3(worldAabbMin,worldAabbMax,3500,pairCache);
+	}
 //	m_overlappingPairCache = new btSimpleBroadphase();
 //	m_overlappingPairCache = new btDbvtBroadphase();
 	
@@ -365,7 +406,7 @@ void	BenchmarkDemo::initPhysics()
 	btThreadSupportInterface* thread = createSolverThreadSupport(4);
 	btConstraintSolver* sol = new btParallelConstraintSolver(thread);
 #else
-	btSequentialImpulseConstraintSolver* sol = new btSequentialImpulseConstraintSolver;
+	btSequentialImpulseConstraintSolver* sol = m_useSoaSolver ? new btSoaConstraintSolver : new btSequentialImpulseConstraintSolver;
 #endif //USE_PARALLEL_DISPATCHER_BENCHMARK
 	
 	
@@ -386,7 +427,7 @@ void	BenchmarkDemo::initPhysics()
 
 	m_dynamicsWorld->setGravity(btVector3(0,-10,0));
 
-	if (m_benchmark<5)
+	if (m_benchmark<5 || m_benchmark==8)
 	{
 		///create a few basic rigid bodies
 		btCollisionShape* groundShape = new btBoxShape(btVector3(btScalar(250.),btScalar(50.),btScalar(250.)));
@@ -456,6 +497,16 @@ void	BenchmarkDemo::initPhysics()
 			createTest7();
 			break;
 		}
+		case 8:
+		{
+			createTest8();
+			break;
+		}
+		case 9:
+		{
+			createTest9();
+			break;
+		}
 
 
 	default:
@@ -1087,7 +1138,13 @@ void BenchmarkDemo::createLargeMeshBody()
 		meshInterface->addIndexedMesh(part,PHY_SHORT);
 
 		bool	useQuantizedAabbCompression = true;
-		btBvhTriangleMeshShape* trimeshShape = new btBvhTriangleMeshShape(meshInterface,useQuantizedAabbCompression);
+		btBvhTriangleMeshShape* trimeshShape = new btBvhTriangleMeshShape(meshInterface,useQuantizedAabbCompression,false);
+		if (m_useSahBvh)
+		{
+			trimeshShape->setBvhBuildMethod(btQuantizedBvh::BUILD_BINNED_SAH);
+		}
+		trimeshShape->buildOptimizedBvh();
+		trimeshShape->setUseWideBvh(m_useWideBvh);
 		btVector3 localInertia(0,0,0);
 		trans.setOrigin(btVector3(0,-25,0));
 
@@ -1232,7 +1289,7 @@ void BenchmarkDemo::initRays()
 
 void BenchmarkDemo::castRays()
 {
-	raycastBar.cast (m_dynamicsWorld);
+	raycastBar.cast (m_dynamicsWorld, m_useRayTestBatch);
 }
 
 void	BenchmarkDemo::createTest7()
@@ -1243,6 +1300,122 @@ void	BenchmarkDemo::createTest7()
 	initRays();
 }
 
+void	BenchmarkDemo::createTest8()
+{
+	// 50000 sleeping boxes in 10000 towers, and 200 boxes falling on a corner of the field
+	setCameraDistance(btScalar(150.));
+
+	int size = 100;
+	int height = 5;
+	const float cubeSize = 0.5f;
+	float spacing = 4.f*cubeSize;
+	float offset = -size * spacing * 0.5f;
+
+	btBoxShape* blockShape = new btBoxShape(btVector3(cubeSize-COLLISION_RADIUS,cubeSize-COLLISION_RADIUS,cubeSize-COLLISION_RADIUS));
+	m_collisionShapes.push_back(blockShape);
+	btVector3 localInertia(0,0,0);
+	float mass = 1.f;
+	blockShape->calculateLocalInertia(mass,localInertia);
+
+	btTransform trans;
+	trans.setIdentity();
+
+	for(int i=0;i<size;i++) {
+		for(int j=0;j<size;j++) {
+			for(int k=0;k<height;k++) {
+				trans.setOrigin(btVector3(offset + i*spacing, cubeSize + k*2.f*cubeSize, offset + j*spacing));
+				btRigidBody* body = localCreateRigidBody(mass,trans,blockShape);
+				body->setActivationState(ISLAND_SLEEPING);
+			}
+		}
+	}
+
+	for(int i=0;i<200;i++) {
+		trans.setOrigin(btVector3(offset + (i%10)*2.6f*cubeSize, 8.f + (i/10)*2.4f*cubeSize, offset + ((i/10)%10)*2.6f*cubeSize));
+		localCreateRigidBody(mass,trans,blockShape);
+	}
+}
+
+void	BenchmarkDemo::createTest9()
+{
+	// 1024 boxes and spheres falling on a 4096x4096 terrain, heightfield128x128.raw upsampled, and the rays of the raytests demo
+	setCameraDistance(btScalar(150.));
+
+	const int sourceSize = 128;
+	unsigned char sourceHeights[sourceSize*sourceSize];
+	const char* filenames[3] = {"heightfield128x128.raw","../../heightfield128x128.raw","../../../heightfield128x128.raw"};
+	int numBytes = 0;
+	for (int f=0;f<3 && numBytes!=sourceSize*sourceSize;f++)
+	{
+		FILE* heightfieldFile = fopen(filenames[f],"rb");
+		if (heightfieldFile)
+		{
+			numBytes = (int)fread(sourceHeights,1,sourceSize*sourceSize,heightfieldFile);
+			fclose(heightfieldFile);
+		}
+	}
+	if (numBytes!=sourceSize*sourceSize)
+	{
+		printf("couldn't read heightfield128x128.raw, using rolling hills\n");
+		for (int i=0;i<sourceSize*sourceSize;i++)
+		{
+			sourceHeights[i] = (unsigned char)(127.5f+127.5f*btSin(btScalar(i%sourceSize)*0.2f)*btCos(btScalar(i/sourceSize)*0.15f));
+		}
+	}
+
+	// bilinear upsampling, with 6 more bits than the source
+	const int size = 4096;
+	m_heightfieldData.resize(size*size);
+	const btScalar step = btScalar(sourceSize-1)/btScalar(size-1);
+	for (int j=0;j<size;j++)
+	{
+		const btScalar v = j*step;
+		const int j0 = btMin((int)v,sourceSize-2);
+		const btScalar fv = v-j0;
+		for (int i=0;i<size;i++)
+		{
+			const btScalar u = i*step;
+			const int i0 = btMin((int)u,sourceSize-2);
+			const btScalar fu = u-i0;
+			const btScalar h0 = sourceHeights[j0*sourceSize+i0]*(1.f-fu)+sourceHeights[j0*sourceSize+i0+1]*fu;
+			const btScalar h1 = sourceHeights[(j0+1)*sourceSize+i0]*(1.f-fu)+sourceHeights[(j0+1)*sourceSize+i0+1]*fu;
+			m_heightfieldData[j*size+i] = (short)((h0*(1.f-fv)+h1*fv)*64.f);
+		}
+	}
+
+	const btScalar maxHeight = 40.f;
+	btHeightfieldTerrainShape* terrainShape = new btHeightfieldTerrainShape(size,size,&m_heightfieldData[0],maxHeight/(255.f*64.f),0.f,maxHeight,1,PHY_SHORT,false);
+	terrainShape->setLocalScaling(btVector3(0.25f,1.f,0.25f));
+	if (m_useHeightfieldPyramid)
+	{
+		terrainShape->buildMinMaxPyramid();
+	}
+	m_collisionShapes.push_back(terrainShape);
+
+	btTransform trans;
+	trans.setIdentity();
+	localCreateRigidBody(0.f,trans,terrainShape);
+
+	btBoxShape* boxShape = new btBoxShape(btVector3(1.f,1.f,1.f));
+	btSphereShape* sphereShape = new btSphereShape(1.f);
+	m_collisionShapes.push_back(boxShape);
+	m_collisionShapes.push_back(sphereShape);
+
+	const int bodiesPerRow = 32;
+	const float spacing = 24.f;
+	const float offset = -bodiesPerRow*spacing*0.5f;
+	for (int i=0;i<bodiesPerRow;i++)
+	{
+		for (int j=0;j<bodiesPerRow;j++)
+		{
+			trans.setOrigin(btVector3(offset + i*spacing, 25.f, offset + j*spacing));
+			localCreateRigidBody(1.f,trans,((i+j)&1) ? (btCollisionShape*)sphereShape : (btCollisionShape*)boxShape);
+		}
+	}
+
+	initRays();
+}
+
 void	BenchmarkDemo::exitPhysics()
 {
 	int i;
@@ -1278,6 +1451,7 @@ void	BenchmarkDemo::exitPhysics()
 		delete shape;
 	}
     m_collisionShapes.clear();
+	m_heightfieldData.clear();
 
 	//delete dynamics world
 	delete m_dynamicsWorld;
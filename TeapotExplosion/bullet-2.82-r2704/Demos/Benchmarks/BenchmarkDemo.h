@@ -97,6 +97,25 @@ class BenchmarkDemo : public PlatformDemoApplication
 	
 	int	m_benchmark;
 
+	bool	m_useParallelDispatcher;
+
+	bool	m_useSoaSolver;
+
+	bool	m_useOpenAddressingPairCache;
+
+	bool	m_useRayTestBatch;
+
+	bool	m_useWideBvh;
+
+	bool	m_useSahBvh;
+
+	bool	m_useGjkBatch;
+
+	bool	m_useHeightfieldPyramid;
+
+	///the heights of the terrain of createTest9, the btHeightfieldTerrainShape doesn't copy them
+	btAlignedObjectArray<short>	m_heightfieldData;
+
 	void	createTest1();
 	void	createTest2();
 	void	createTest3();
@@ -104,6 +123,8 @@ class BenchmarkDemo : public PlatformDemoApplication
 	void	createTest5();
 	void	createTest6();
 	void	createTest7();
+	void	createTest8();
+	void	createTest9();
 
 	void createWall(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
 	void createPyramid(const btVector3& offsetPosition,int stackSize,const btVector3& boxSize);
@@ -120,7 +141,15 @@ class BenchmarkDemo : public PlatformDemoApplication
 	public:
 
 	BenchmarkDemo(int benchmark)
-	:m_benchmark(benchmark)
+	:m_benchmark(benchmark),
+	m_useParallelDispatcher(false),
+	m_useSoaSolver(false),
+	m_useOpenAddressingPairCache(false),
+	m_useRayTestBatch(false),
+	m_useWideBvh(false),
+	m_useSahBvh(false),
+	m_useGjkBatch(false),
+	m_useHeightfieldPyramid(false)
 	{
 	}
 	virtual ~BenchmarkDemo()
@@ -131,6 +160,54 @@ class BenchmarkDemo : public PlatformDemoApplication
 
 	void	exitPhysics();
 
+	///run the narrowphase with btCollisionDispatcherMt on the task scheduler set with btSetTaskScheduler, call before initPhysics
+	void	setUseParallelDispatcher(bool useParallelDispatcher)
+	{
+		m_useParallelDispatcher = useParallelDispatcher;
+	}
+
+	///solve the contacts with btSoaConstraintSolver instead of btSequentialImpulseConstraintSolver, call before initPhysics
+	void	setUseSoaSolver(bool useSoaSolver)
+	{
+		m_useSoaSolver = useSoaSolver;
+	}
+
+	///keep the overlapping pairs in a btOpenAddressingPairCache instead of a btHashedOverlappingPairCache, call before initPhysics
+	void	setUseOpenAddressingPairCache(bool useOpenAddressingPairCache)
+	{
+		m_useOpenAddressingPairCache = useOpenAddressingPairCache;
+	}
+
+	///cast the rays of the raytests demo with btCollisionWorld::rayTestBatch instead of one rayTest per ray
+	void	setUseRayTestBatch(bool useRayTestBatch)
+	{
+		m_useRayTestBatch = useRayTestBatch;
+	}
+
+	///query the landscape triangle meshes through a btWideBvh instead of their btOptimizedBvh, call before initPhysics
+	void	setUseWideBvh(bool useWideBvh)
+	{
+		m_useWideBvh = useWideBvh;
+	}
+
+	///build the optimized bvh of the landscape triangle meshes with btQuantizedBvh::BUILD_BINNED_SAH, call before initPhysics
+	void	setUseSahBvh(bool useSahBvh)
+	{
+		m_useSahBvh = useSahBvh;
+	}
+
+	///let btCollisionDispatcherMt compute the closest points of the convex pairs with btGjkBatch, call before initPhysics
+	void	setUseGjkBatch(bool useGjkBatch)
+	{
+		m_useGjkBatch = useGjkBatch;
+	}
+
+	///build the min/max pyramid of the heightfield terrain, call before initPhysics
+	void	setUseHeightfieldPyramid(bool useHeightfieldPyramid)
+	{
+		m_useHeightfieldPyramid = useHeightfieldPyramid;
+	}
+
 	virtual void clientMoveAndDisplay();
 
 	virtual void displayCallback();
@@ -261,5 +338,39 @@ public:
 	}
 };
 
+class BenchmarkDemo8 : public BenchmarkDemo
+{
+public:
+	BenchmarkDemo8()
+		:BenchmarkDemo(8)
+	{
+	}
+
+	static DemoApplication* Create()
+	{
+		BenchmarkDemo8* demo = new BenchmarkDemo8;
+		demo->myinit();
+		demo->initPhysics();
+		return demo;
+	}
+};
+
+class BenchmarkDemo9 : public BenchmarkDemo
+{
+public:
+	BenchmarkDemo9()
+		:BenchmarkDemo(9)
+	{
+	}
+
+	static DemoApplication* Create()
+	{
+		BenchmarkDemo9* demo = new BenchmarkDemo9;
+		demo->myinit();
+		demo->initPhysics();
+		return demo;
+	}
+};
+
 #endif //BENCHMARK_DEMO_H
 
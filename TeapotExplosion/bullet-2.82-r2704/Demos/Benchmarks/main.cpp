@@ -16,7 +16,14 @@ subject to the following restrictions:
 #include "BenchmarkDemo.h"
 #include "btBulletDynamicsCommon.h"
 #include "LinearMath/btHashMap.h"
+#include "LinearMath/btThreads.h"
+#include "BulletDynamics/ConstraintSolver/btSoaConstraintSolver.h"
+#include <stdlib.h>
+#include <string.h>
 #include <stdio.h>
+#ifdef BT_NO_PROFILE
+#include <chrono>
+#endif //BT_NO_PROFILE
 
 #ifdef USE_GRAPHICAL_BENCHMARK
 	#include "GlutStuff.h"
@@ -26,7 +33,7 @@ subject to the following restrictions:
 #endif //USE_GRAPHICAL_BENCHMARK
 
 
-#define NUM_DEMOS 7
+#define NUM_DEMOS 9
 #define NUM_TESTS 200
 
 extern bool gDisableDeactivation;
@@ -42,10 +49,12 @@ int main(int argc,char** argv)
 	BenchmarkDemo5 benchmarkDemo5;
 	BenchmarkDemo6 benchmarkDemo6;
 	BenchmarkDemo7 benchmarkDemo7;
+	BenchmarkDemo8 benchmarkDemo8;
+	BenchmarkDemo9 benchmarkDemo9;
 
-	BenchmarkDemo* demoArray[NUM_DEMOS] = {&benchmarkDemo1,&benchmarkDemo2,&benchmarkDemo3,&benchmarkDemo4,&benchmarkDemo5,&benchmarkDemo6,&benchmarkDemo7};
-	const char* demoNames[NUM_DEMOS] = {"3000 fall", "1000 stack", "136 ragdolls","1000 convex", "prim-trimesh", "convex-trimesh","raytests"};
-	float totalTime[NUM_DEMOS] = {0.f,0.f,0.f,0.f,0.f,0.f,0.f};
+	BenchmarkDemo* demoArray[NUM_DEMOS] = {&benchmarkDemo1,&benchmarkDemo2,&benchmarkDemo3,&benchmarkDemo4,&benchmarkDemo5,&benchmarkDemo6,&benchmarkDemo7,&benchmarkDemo8,&benchmarkDemo9};
+	const char* demoNames[NUM_DEMOS] = {"3000 fall", "1000 stack", "136 ragdolls","1000 convex", "prim-trimesh", "convex-trimesh","raytests","50k sleeping","heightfield"};
+	float totalTime[NUM_DEMOS] = {0.f,0.f,0.f,0.f,0.f,0.f,0.f,0.f,0.f};
 
 #ifdef USE_GRAPHICAL_BENCHMARK
 	benchmarkDemo.initPhysics();
@@ -56,22 +65,110 @@ int main(int argc,char** argv)
 #else //USE_GRAPHICAL_BENCHMARK
 	int d;
 
+	///AppBenchmarks --threads N runs the narrowphase with btCollisionDispatcherMt on N threads
+	///AppBenchmarks --soa-solver solves the contacts with btSoaConstraintSolver
+	///AppBenchmarks --open-pair-cache keeps the overlapping pairs in a btOpenAddressingPairCache
+	///AppBenchmarks --ray-batch casts the rays of the raytests demo with btCollisionWorld::rayTestBatch
+	///AppBenchmarks --wide-bvh gives the landscape triangle meshes a btWideBvh
+	///AppBenchmarks --sah-bvh builds the optimized bvh of the landscape triangle meshes with btQuantizedBvh::BUILD_BINNED_SAH
+	///AppBenchmarks --heightfield-pyramid builds the min/max pyramid of the terrain of the heightfield demo
+	///AppBenchmarks --threads N --gjk-batch computes the closest points of the convex pairs with btGjkBatch
+	btITaskScheduler* taskScheduler = 0;
+	bool useSoaSolver = false;
+	bool useOpenAddressingPairCache = false;
+	bool useRayTestBatch = false;
+	bool useWideBvh = false;
+	bool useSahBvh = false;
+	bool useGjkBatch = false;
+	bool useHeightfieldPyramid = false;
+	for (int a=1;a<argc;a++)
+	{
+		if (strcmp(argv[a],"--soa-solver")==0)
+		{
+			useSoaSolver = true;
+			printf("BenchmarkDemo: btSoaConstraintSolver, %d rows per step\n",BT_SOA_SOLVER_WIDTH);
+		}
+		if (strcmp(argv[a],"--open-pair-cache")==0)
+		{
+			useOpenAddressingPairCache = true;
+			printf("BenchmarkDemo: btOpenAddressingPairCache\n");
+		}
+		if (strcmp(argv[a],"--ray-batch")==0)
+		{
+			useRayTestBatch = true;
+			printf("BenchmarkDemo: btCollisionWorld::rayTestBatch\n");
+		}
+		if (strcmp(argv[a],"--wide-bvh")==0)
+		{
+			useWideBvh = true;
+			printf("BenchmarkDemo: btWideBvh\n");
+		}
+		if (strcmp(argv[a],"--sah-bvh")==0)
+		{
+			useSahBvh = true;
+			printf("BenchmarkDemo: binned SAH bvh build\n");
+		}
+		if (strcmp(argv[a],"--gjk-batch")==0)
+		{
+			useGjkBatch = true;
+			printf("BenchmarkDemo: btGjkBatch\n");
+		}
+		if (strcmp(argv[a],"--heightfield-pyramid")==0)
+		{
+			useHeightfieldPyramid = true;
+			printf("BenchmarkDemo: heightfield min/max pyramid\n");
+		}
+	}
+	for (int a=1;a<argc-1;a++)
+	{
+		if (strcmp(argv[a],"--threads")==0)
+		{
+			int numThreads = atoi(argv[a+1]);
+			if (numThreads>1)
+			{
+				taskScheduler = btCreateDefaultTaskScheduler();
+				taskScheduler->setNumThreads(numThreads);
+				btSetTaskScheduler(taskScheduler);
+				printf("BenchmarkDemo: btCollisionDispatcherMt on %d threads\n",taskScheduler->getNumThreads());
+			}
+		}
+	}
+
 	for (d=0;d<NUM_DEMOS;d++)
 	{
+		//the towers of "50k sleeping" have to be allowed to stay asleep
+		gDisableDeactivation = (demoArray[d] != &benchmarkDemo8);
+		demoArray[d]->setUseParallelDispatcher(taskScheduler!=0);
+		demoArray[d]->setUseSoaSolver(useSoaSolver);
+		demoArray[d]->setUseOpenAddressingPairCache(useOpenAddressingPairCache);
+		demoArray[d]->setUseRayTestBatch(useRayTestBatch);
+		demoArray[d]->setUseWideBvh(useWideBvh);
+		demoArray[d]->setUseSahBvh(useSahBvh);
+		demoArray[d]->setUseGjkBatch(useGjkBatch);
+		demoArray[d]->setUseHeightfieldPyramid(useHeightfieldPyramid);
 		demoArray[d]->initPhysics();
 		
 
 		for (int i=0;i<NUM_TESTS;i++)
 		{
+#ifdef BT_NO_PROFILE
+			//CProfileManager is compiled out, time the frame here
+			std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+			demoArray[d]->clientMoveAndDisplay();
+			float frameTime = std::chrono::duration<float,std::milli>(std::chrono::steady_clock::now()-frameStart).count();
+#else
 			demoArray[d]->clientMoveAndDisplay();
 			float frameTime = CProfileManager::Get_Time_Since_Reset();
+#endif //BT_NO_PROFILE
 			if ((i % 25)==0)
 			{
 				printf("BenchmarkDemo: %s, Frame %d, Duration (ms): %f\n",demoNames[d],i,frameTime);
 			}
 			totalTime[d] += frameTime;
+#ifndef BT_NO_PROFILE
 			if (i==NUM_TESTS-1)
 				CProfileManager::dumpAll();
+#endif //BT_NO_PROFILE
 
 			
 		}
@@ -83,6 +180,9 @@ int main(int argc,char** argv)
 		printf("\nResults for %s: %f",demoNames[d],totalTime[d]*(1.f/NUM_TESTS));
 	}
 
+	btSetTaskScheduler(0);
+	delete taskScheduler;
+
 #endif //USE_GRAPHICAL_BENCHMARK
 	return 0;
 }
@@ -35,10 +35,11 @@ subject to the following restrictions:
 /// Include Torus Mesh here
 #include "TorusMesh.h"
 #include "BunnyMesh.h"
+#include <atomic>
 
 #ifdef SHOW_NUM_DEEP_PENETRATIONS 
 extern int gNumDeepPenetrationChecks;
-extern int gNumSplitImpulseRecoveries;
+extern std::atomic<int> gNumSplitImpulseRecoveries;
 extern int gNumGjkChecks;
 #endif //
 
@@ -240,7 +241,7 @@ void GimpactConcaveDemo::renderme()
 				yStart += yIncr;
 
 				glRasterPos3f(xOffset,yStart,0);
-				sprintf(buf,"gNumSplitImpulseRecoveries= %d",gNumSplitImpulseRecoveries);
+				sprintf(buf,"gNumSplitImpulseRecoveries= %d",gNumSplitImpulseRecoveries.load());
 				GLDebugDrawString(xOffset,yStart,buf);
 				yStart += yIncr;
 
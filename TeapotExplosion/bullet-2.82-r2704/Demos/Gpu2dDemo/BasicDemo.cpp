@@ -78,6 +78,7 @@ subject to the following restrictions:
 ///btBulletDynamicsCommon.h is the main Bullet include file, contains most common include files.
 #include "btBulletDynamicsCommon.h"
 #include <stdio.h> //printf debugging
+#include <atomic>
 
 #include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
 
@@ -726,7 +727,7 @@ extern int gNumClampedCcdMotions;
 #define SHOW_NUM_DEEP_PENETRATIONS 1
 #ifdef SHOW_NUM_DEEP_PENETRATIONS 
 	extern int gNumDeepPenetrationChecks;
-	extern int gNumSplitImpulseRecoveries;
+	extern std::atomic<int> gNumSplitImpulseRecoveries;
 	extern int gNumGjkChecks;
 	extern int gNumAlignedAllocs;
 	extern int gNumAlignedFree;
@@ -33,7 +33,7 @@ subject to the following restrictions:
 
 #elif defined (USE_PTHREADS)
 
-#include "BulletMultiThreaded/PosixThreadSupport.h"
+#include "BulletMultiThreaded/TaskSchedulerThreadSupport.h"
 #include "BulletMultiThreaded/SpuNarrowPhaseCollisionTask/SpuGatheringCollisionTask.h"
 
 #else
@@ -61,10 +61,10 @@ btThreadSupportInterface* createSolverThreadSupport(int maxNumThreads)
 	Win32ThreadSupport* threadSupport = new Win32ThreadSupport(threadConstructionInfo);
 	threadSupport->startSPU();
 #elif defined (USE_PTHREADS)
-	PosixThreadSupport::ThreadConstructionInfo solverConstructionInfo("solver", SolverThreadFunc,
+	TaskSchedulerThreadSupport::ThreadConstructionInfo solverConstructionInfo("solver", SolverThreadFunc,
 																	  SolverlsMemoryFunc, maxNumThreads);
 	
-	PosixThreadSupport* threadSupport = new PosixThreadSupport(solverConstructionInfo);
+	TaskSchedulerThreadSupport* threadSupport = new TaskSchedulerThreadSupport(solverConstructionInfo);
 	
 #else
 	SequentialThreadSupport::SequentialThreadConstructionInfo tci("solverThreads",SolverThreadFunc,SolverlsMemoryFunc);
@@ -325,11 +325,11 @@ m_threadSupportCollision = new Win32ThreadSupport(Win32ThreadSupport::Win32Threa
 #endif
         SpuLibspe2Support* threadSupportCollision  = new SpuLibspe2Support( program_handle, maxNumOutstandingTasks);
 #elif defined (USE_PTHREADS)
-    PosixThreadSupport::ThreadConstructionInfo constructionInfo("collision",
+    TaskSchedulerThreadSupport::ThreadConstructionInfo constructionInfo("collision",
 								processCollisionTask,
 								createCollisionLocalStoreMemory,
 								maxNumOutstandingTasks);
-    m_threadSupportCollision = new PosixThreadSupport(constructionInfo);
+    m_threadSupportCollision = new TaskSchedulerThreadSupport(constructionInfo);
 #else
 
 	SequentialThreadSupport::SequentialThreadConstructionInfo colCI("collision",processCollisionTask,createCollisionLocalStoreMemory);
@@ -17,11 +17,16 @@ subject to the following restrictions:
 #include "GlutStuff.h"
 #include "GLDebugDrawer.h"
 #include "btBulletDynamicsCommon.h"
+#include "LinearMath/btThreads.h"
 
 GLDebugDrawer	gDebugDrawer;
 
 int main(int argc,char** argv)
 {
+	///the pthreads version of the demo runs its collision and solver tasks on the default task scheduler
+	btITaskScheduler* taskScheduler = btCreateDefaultTaskScheduler();
+	btSetTaskScheduler(taskScheduler);
+
 	MultiThreadedDemo* demo = new MultiThreadedDemo();
 
 	demo->initPhysics();
@@ -32,5 +37,8 @@ int main(int argc,char** argv)
 
 	delete demo;
 
+	btSetTaskScheduler(0);
+	delete taskScheduler;
+
 	return EXIT_SUCCESS;
 }
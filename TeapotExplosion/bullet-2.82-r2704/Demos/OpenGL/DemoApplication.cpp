@@ -32,6 +32,7 @@ subject to the following restrictions:
 #include "LinearMath/btDefaultMotionState.h"
 #include "LinearMath/btSerializer.h"
 #include "GLDebugFont.h"
+#include <atomic>
 
 
 extern bool gDisableDeactivation;
@@ -46,7 +47,7 @@ extern int gNumClampedCcdMotions;
 #ifdef SHOW_NUM_DEEP_PENETRATIONS 
 extern int gNumDeepPenetrationChecks;
 
-extern int gNumSplitImpulseRecoveries;
+extern std::atomic<int> gNumSplitImpulseRecoveries;
 extern int gNumGjkChecks;
 extern int gNumAlignedAllocs;
 extern int gNumAlignedFree;
@@ -28,15 +28,17 @@ void*	SamplelsMemoryFunc();
 
 #ifdef USE_PTHREADS
 //#ifdef __APPLE__
-#include "BulletMultiThreaded/PosixThreadSupport.h"
+#include "BulletMultiThreaded/TaskSchedulerThreadSupport.h"
 
 btThreadSupportInterface* createThreadSupport(int numThreads)
 {
-	PosixThreadSupport::ThreadConstructionInfo constructionInfo("testThreads",
+	///the tasks run on the task scheduler set with btSetTaskScheduler, more tasks than threads wait in its queues
+	btSetTaskScheduler(btCreateDefaultTaskScheduler());
+	TaskSchedulerThreadSupport::ThreadConstructionInfo constructionInfo("testThreads",
                                                                 SampleThreadFunc,
                                                                 SamplelsMemoryFunc,
                                                                 numThreads);
-    btThreadSupportInterface* threadSupport = new PosixThreadSupport(constructionInfo);
+    btThreadSupportInterface* threadSupport = new TaskSchedulerThreadSupport(constructionInfo);
 	
 	return threadSupport;
 	
@@ -125,7 +127,7 @@ int main(int argc,char** argv)
 	
 	threadSupport->startSPU();
 
-	for (int i=0;i<threadSupport->getNumTasks();i++)
+	for (int i=0;i<numThreads;i++)
 	{
 		SampleThreadLocalStorage* storage = (SampleThreadLocalStorage*)threadSupport->getThreadLocalMemory(i);
 		btAssert(storage);
@@ -179,6 +181,11 @@ int main(int argc,char** argv)
 printf("stopping threads\n");
 
 	delete threadSupport;
+#ifdef USE_PTHREADS
+	btITaskScheduler* taskScheduler = btGetTaskScheduler();
+	btSetTaskScheduler(0);
+	delete taskScheduler;
+#endif
 	printf("Press ENTER to quit\n");
 	getchar();
 	return 0;
@@ -39,6 +39,19 @@
 #include "Test_3x3getRot.h"
 
 #include "Test_btDbvt.h"
+#include "Test_polyhedralClipping.h"
+#include "Test_contactReduction.h"
+#include "Test_collisionMeshBlob.h"
+#include "Test_poolAllocatorMt.h"
+#include "Test_gjkBatch.h"
+#include "Test_wideBvh.h"
+#include "Test_heightfield.h"
+#include "Test_threadIndex.h"
+#include "Test_dbvtParallelCollide.h"
+#include "Test_rayTestBatch.h"
+#include "Test_openAddressingPairCache.h"
+#include "Test_parallelBatches.h"
+#include "Test_soaSolver.h"
 #include "Test_quat_aos_neon.h"
 
 #include "LinearMath/btScalar.h"
@@ -86,6 +99,19 @@ TestDesc  gTestList[] =
     ENTRY( "3x3getRot", Test_3x3getRot ),
   
     ENTRY( "btDbvt", Test_btDbvt ),
+    ENTRY( "polyhedralClipping", Test_polyhedralClipping ),
+    ENTRY( "contactReduction", Test_contactReduction ),
+    ENTRY( "collisionMeshBlob", Test_collisionMeshBlob ),
+    ENTRY( "poolAllocatorMt", Test_poolAllocatorMt ),
+    ENTRY( "gjkBatch", Test_gjkBatch ),
+    ENTRY( "wideBvh", Test_wideBvh ),
+    ENTRY( "heightfield", Test_heightfield ),
+    ENTRY( "threadIndex", Test_threadIndex ),
+    ENTRY( "dbvtParallelCollide", Test_dbvtParallelCollide ),
+    ENTRY( "rayTestBatch", Test_rayTestBatch ),
+    ENTRY( "openAddressingPairCache", Test_openAddressingPairCache ),
+    ENTRY( "parallelBatches", Test_parallelBatches ),
+    ENTRY( "soaSolver", Test_soaSolver ),
     ENTRY("quat_aos_neon", Test_quat_aos_neon),
     
     { NULL, NULL }
@@ -18,6 +18,7 @@
 #include <string.h>
 
 #include <BulletCollision/BroadphaseCollision/btDbvt.h>
+#include <BulletCollision/BroadphaseCollision/btDbvtCompact.h>
 
 // reference code for testing purposes
 SIMD_FORCE_INLINE bool Intersect_ref( btDbvtAabbMm& a,  btDbvtAabbMm& b)
@@ -96,6 +97,39 @@ SIMD_FORCE_INLINE void		Merge_ref(	 btDbvtAabbMm& a,
 #define LOOPCOUNT 1000
 #define NUM_CYCLES 10000
 #define DATA_SIZE 1024
+#define TREE_SIZE (DATA_SIZE*16)
+#define TRAVERSAL_CYCLES 100
+
+// counts the leaves of a traversal and sums their addresses, so both layouts are checked to report the same leaves
+struct CountLeaves : btDbvt::ICollide
+{
+    int m_count;
+    size_t m_sum;
+    CountLeaves() : m_count(0), m_sum(0) {}
+    void Process(const btDbvtNode* leaf) { ++m_count; m_sum += (size_t)leaf; }
+};
+
+// runs a second query from inside every leaf callback of the first one
+struct NestedLeaves : CountLeaves
+{
+    const btDbvtCompact& m_compact;
+    const btDbvtAabbMm& m_volume;
+    CountLeaves m_inner;
+    NestedLeaves(const btDbvtCompact& compact, const btDbvtAabbMm& volume) : m_compact(compact), m_volume(volume) {}
+    void Process(const btDbvtNode* leaf)
+    {
+        CountLeaves::Process(leaf);
+        btDbvtCompactScratch<int> scratch;
+        m_compact.collideTV(m_volume, scratch.stack(), m_inner);
+    }
+};
+
+static btDbvtAabbMm RandomVolume(float worldSize, float maxExtent)
+{
+    btVector3 center(worldSize * (float)rand() / (float)RAND_MAX, worldSize * (float)rand() / (float)RAND_MAX, worldSize * (float)rand() / (float)RAND_MAX);
+    btVector3 extents(maxExtent * (float)rand() / (float)RAND_MAX, maxExtent * (float)rand() / (float)RAND_MAX, maxExtent * (float)rand() / (float)RAND_MAX);
+    return btDbvtAabbMm::FromCE(center, extents);
+}
 
 int Test_btDbvt(void)
 {
@@ -486,6 +520,112 @@ c   [0]	float32_t	0.829904
         
     }
     
+    ////////////////////////////////////
+    //
+    // Time and Test btDbvt vs btDbvtCompact traversal
+    //
+    ////////////////////////////////////
+    {
+        btDbvt tree;
+        for (i = 0; i < TREE_SIZE; i++)
+        {
+            tree.insert(RandomVolume(100.f, 1.f), 0);
+        }
+        // leave the node pointers scattered the way a running simulation does
+        tree.optimizeIncremental(TREE_SIZE);
+        
+        btDbvtCompact compact;
+        compact.build(tree);
+        btAlignedObjectArray<int> stack;
+        
+        for (i = 0; i < DATA_SIZE; i++)
+        {
+            c[i] = RandomVolume(100.f, 4.f);
+        }
+        
+        CountLeaves treeLeaves, compactLeaves;
+        {
+            uint64_t startTime, bestTime, currentTime;
+            
+            bestTime = -1LL;
+            scalarTime = 0;
+            for (j = 0; j < TRAVERSAL_CYCLES; j++) 
+            {
+                startTime = ReadTicks();
+                
+                for (i = 0; i < DATA_SIZE; i++)
+                {
+                    tree.collideTV(tree.m_root, c[i], treeLeaves);
+                }
+                
+                currentTime = ReadTicks() - startTime;
+                scalarTime += currentTime;
+                if( currentTime < bestTime )
+                    bestTime = currentTime;
+            }
+            if( 0 == gReportAverageTimes )
+                scalarTime = bestTime;        
+            else
+                scalarTime /= TRAVERSAL_CYCLES;
+        }
+        
+        {
+            uint64_t startTime, bestTime, currentTime;
+            
+            bestTime = -1LL;
+            vectorTime = 0;
+            for (j = 0; j < TRAVERSAL_CYCLES; j++) 
+            {
+                startTime = ReadTicks();
+                
+                for (i = 0; i < DATA_SIZE; i++)
+                {
+                    compact.collideTV(c[i], stack, compactLeaves);
+                }
+                
+                currentTime = ReadTicks() - startTime;
+                vectorTime += currentTime;
+                if( currentTime < bestTime )
+                    bestTime = currentTime;
+            }
+            if( 0 == gReportAverageTimes )
+                vectorTime = bestTime;        
+            else
+                vectorTime /= TRAVERSAL_CYCLES;
+        }
+        
+        vlog( "collideTV Timing (%d leaves, per query):\n", TREE_SIZE );
+        vlog( "     \t     btDbvt\tbtDbvtCompact\n" );
+        vlog( "    \t%10.4f\t%10.4f\n", TicksToCycles( scalarTime ) / DATA_SIZE, TicksToCycles( vectorTime ) / DATA_SIZE );
+        
+        if( treeLeaves.m_count != compactLeaves.m_count || treeLeaves.m_sum != compactLeaves.m_sum )
+        {
+            printf("collideTV fail with btDbvt = %d leaves, btDbvtCompact = %d leaves\n", treeLeaves.m_count, compactLeaves.m_count);
+            return 1;
+        }
+        
+        // queries started from inside a callback must not share the scratch stack of the outer query
+        NestedLeaves outerLeaves(compact, c[1]);
+        CountLeaves innerLeaves;
+        {
+            btDbvtCompactScratch<int> scratch;
+            compact.collideTV(c[0], scratch.stack(), outerLeaves);
+        }
+        for (i = 0; i < outerLeaves.m_count; i++)
+        {
+            btDbvtCompactScratch<int> scratch;
+            compact.collideTV(c[1], scratch.stack(), innerLeaves);
+        }
+        CountLeaves plainLeaves;
+        compact.collideTV(c[0], stack, plainLeaves);
+        if( outerLeaves.m_count != plainLeaves.m_count || outerLeaves.m_sum != plainLeaves.m_sum ||
+            outerLeaves.m_inner.m_count != innerLeaves.m_count || outerLeaves.m_inner.m_sum != innerLeaves.m_sum )
+        {
+            printf("collideTV fail with nested btDbvtCompactScratch = %d/%d leaves, expected %d/%d\n", outerLeaves.m_count, outerLeaves.m_inner.m_count, plainLeaves.m_count, innerLeaves.m_count);
+            return 1;
+        }
+    }
+    
     return 0;
 }
 #endif
@@ -0,0 +1,401 @@
+//
+//  Test_collisionMeshBlob.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_collisionMeshBlob.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btCollisionMeshBlob.h>
+#include <BulletCollision/CollisionShapes/btTriangleInfoMap.h>
+#include <BulletCollision/CollisionDispatch/btInternalEdgeUtility.h>
+
+#define GRID_SIZE 24
+
+///counts the triangles a query reports and sums their indices
+class TriangleSumCallback : public btTriangleCallback
+{
+public:
+	int	m_numTriangles;
+	int	m_indexSum;
+
+	TriangleSumCallback()
+	:m_numTriangles(0),
+	m_indexSum(0)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle,int partId,int triangleIndex)
+	{
+		m_numTriangles++;
+		m_indexSum += partId*100000+triangleIndex;
+	}
+};
+
+struct GridMesh
+{
+	btAlignedObjectArray<btVector3>			m_vertices;
+	btAlignedObjectArray<int>				m_intIndices;
+	btAlignedObjectArray<unsigned short>	m_shortIndices;
+};
+
+static void AddGrid(GridMesh& mesh,btScalar offset)
+{
+	for (int i=0;i<GRID_SIZE;i++)
+	{
+		for (int j=0;j<GRID_SIZE;j++)
+		{
+			mesh.m_vertices.push_back(btVector3(btScalar(i)+offset,btSin(btScalar(i*0.3+j*0.2)),btScalar(j)));
+		}
+	}
+}
+
+//two parts, with int and short indices
+static btBvhTriangleMeshShape* CreateShape(GridMesh& mesh,bool useQuantizedAabbCompression)
+{
+	AddGrid(mesh,0);
+	AddGrid(mesh,GRID_SIZE);
+	for (int i=0;i<GRID_SIZE-1;i++)
+	{
+		for (int j=0;j<GRID_SIZE-1;j++)
+		{
+			const int v[4] = {i*GRID_SIZE+j,i*GRID_SIZE+j+1,(i+1)*GRID_SIZE+j,(i+1)*GRID_SIZE+j+1};
+			const int triangles[6] = {v[0],v[1],v[2],v[1],v[3],v[2]};
+			for (int k=0;k<6;k++)
+			{
+				mesh.m_intIndices.push_back(triangles[k]);
+				mesh.m_shortIndices.push_back((unsigned short)triangles[k]);
+			}
+		}
+	}
+
+	btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
+	for (int p=0;p<2;p++)
+	{
+		btIndexedMesh part;
+		part.m_numTriangles = mesh.m_intIndices.size()/3;
+		part.m_numVertices = GRID_SIZE*GRID_SIZE;
+		part.m_vertexBase = (const unsigned char*)&mesh.m_vertices[p*GRID_SIZE*GRID_SIZE];
+		part.m_vertexStride = sizeof(btVector3);
+		part.m_vertexType = PHY_FLOAT;
+		if (p==0)
+		{
+			part.m_triangleIndexBase = (const unsigned char*)&mesh.m_intIndices[0];
+			part.m_triangleIndexStride = 3*sizeof(int);
+			meshInterface->addIndexedMesh(part,PHY_INTEGER);
+		}
+		else
+		{
+			part.m_triangleIndexBase = (const unsigned char*)&mesh.m_shortIndices[0];
+			part.m_triangleIndexStride = 3*sizeof(unsigned short);
+			meshInterface->addIndexedMesh(part,PHY_SHORT);
+		}
+	}
+	btBvhTriangleMeshShape* shape = new btBvhTriangleMeshShape(meshInterface,useQuantizedAabbCompression);
+	btTriangleInfoMap* triangleInfoMap = new btTriangleInfoMap();
+	btGenerateInternalEdgeInfo(shape,triangleInfoMap);
+	return shape;
+}
+
+static bool SameQueries(btBvhTriangleMeshShape* shape,btBvhTriangleMeshShape* original)
+{
+	for (int q=0;q<64;q++)
+	{
+		const btVector3 from(btScalar(q%8)*6+1,5,btScalar(q/8)*3);
+		const btVector3 to(btScalar(q%5)*9,-5,btScalar(q%7)*3);
+		TriangleSumCallback rayA,rayB;
+		shape->performRaycast(&rayA,from,to);
+		original->performRaycast(&rayB,from,to);
+		const btVector3 center(from.x(),0,from.z());
+		TriangleSumCallback boxA,boxB;
+		shape->processAllTriangles(&boxA,center-btVector3(2,2,2),center+btVector3(2,2,2));
+		original->processAllTriangles(&boxB,center-btVector3(2,2,2),center+btVector3(2,2,2));
+		if (rayA.m_numTriangles!=rayB.m_numTriangles || rayA.m_indexSum!=rayB.m_indexSum ||
+			boxA.m_numTriangles!=boxB.m_numTriangles || boxA.m_indexSum!=boxB.m_indexSum || !boxA.m_numTriangles)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+enum Corruption
+{
+	TRUNCATED,
+	NEGATIVE_PARTS,
+	NEGATIVE_TRIANGLES,
+	NEGATIVE_STRIDE,
+	OVERFLOWING_TRIANGLES,
+	OVERFLOWING_VERTICES,
+	INDEX_OUT_OF_RANGE,
+	SHORT_INDEX_OUT_OF_RANGE,
+	SMALL_BVH,
+	MISALIGNED_BVH,
+	HUGE_HASH_TABLE,
+	NEGATIVE_VALUES,
+	NEGATIVE_NODE_COUNT,
+	HUGE_NODE_COUNT,
+	MISSING_NODE,
+	ESCAPE_OUT_OF_RANGE,
+	ESCAPE_INTO_SIBLING,
+	LEAF_PART_OUT_OF_RANGE,
+	LEAF_TRIANGLE_OUT_OF_RANGE,
+	SUBTREE_ROOT_OUT_OF_RANGE,
+	SUBTREE_SIZE_OUT_OF_RANGE,
+	NUM_CORRUPTIONS
+};
+
+static const char* gCorruptionNames[NUM_CORRUPTIONS] =
+{
+	"truncated",
+	"negative parts",
+	"negative triangles",
+	"negative stride",
+	"overflowing triangles",
+	"overflowing vertices",
+	"index out of range",
+	"short index out of range",
+	"small bvh",
+	"misaligned bvh",
+	"huge hash table",
+	"negative values",
+	"negative node count",
+	"huge node count",
+	"missing node",
+	"escape index out of range",
+	"escape index into a sibling",
+	"leaf part out of range",
+	"leaf triangle out of range",
+	"subtree root out of range",
+	"subtree size out of range"
+};
+
+///reaches the protected fields of a serialized bvh
+struct SerializedBvhFields : public btQuantizedBvh
+{
+	static int btQuantizedBvh::*	nodeCount()
+	{
+		return &SerializedBvhFields::m_curNodeIndex;
+	}
+
+	static bool btQuantizedBvh::*	useQuantization()
+	{
+		return &SerializedBvhFields::m_useQuantization;
+	}
+
+	static int btQuantizedBvh::*	subtreeHeaderCount()
+	{
+		return &SerializedBvhFields::m_subtreeHeaderCount;
+	}
+};
+
+//the escape index of an internal node, 1 for leaves
+static int GetEscapeIndex(unsigned char* nodeData,bool useQuantization,int nodeIndex)
+{
+	if (useQuantization)
+	{
+		const btQuantizedBvhNode& node = ((btQuantizedBvhNode*)nodeData)[nodeIndex];
+		return node.isLeafNode() ? 1 : node.getEscapeIndex();
+	}
+	const btOptimizedBvhNode& node = ((btOptimizedBvhNode*)nodeData)[nodeIndex];
+	return node.m_escapeIndex==-1 ? 1 : node.m_escapeIndex;
+}
+
+static void SetEscapeIndex(unsigned char* nodeData,bool useQuantization,int nodeIndex,int escapeIndex)
+{
+	if (useQuantization)
+	{
+		((btQuantizedBvhNode*)nodeData)[nodeIndex].m_escapeIndexOrTriangleIndex = -escapeIndex;
+	}
+	else
+	{
+		((btOptimizedBvhNode*)nodeData)[nodeIndex].m_escapeIndex = escapeIndex;
+	}
+}
+
+static void SetLeaf(unsigned char* nodeData,bool useQuantization,int nodeIndex,int partId,int triangleIndex)
+{
+	if (useQuantization)
+	{
+		((btQuantizedBvhNode*)nodeData)[nodeIndex].m_escapeIndexOrTriangleIndex = (partId<<(31-MAX_NUM_PARTS_IN_BITS)) | triangleIndex;
+	}
+	else
+	{
+		((btOptimizedBvhNode*)nodeData)[nodeIndex].m_subPart = partId;
+		((btOptimizedBvhNode*)nodeData)[nodeIndex].m_triangleIndex = triangleIndex;
+	}
+}
+
+//corrupts the blob and returns its size, 0 if the corruption does not apply to the blob
+static unsigned int Corrupt(unsigned char* blob,unsigned int blobSize,int corruption)
+{
+	btCollisionMeshBlobHeader* header = (btCollisionMeshBlobHeader*)blob;
+	btCollisionMeshBlobPart* parts = (btCollisionMeshBlobPart*)(blob+header->m_partsOffset);
+	btTriangleInfoMapInPlaceData* triangleInfoMap = (btTriangleInfoMapInPlaceData*)(blob+header->m_triangleInfoMapOffset);
+	btQuantizedBvh* bvh = (btQuantizedBvh*)(blob+header->m_bvhOffset);
+	int& nodeCount = bvh->*SerializedBvhFields::nodeCount();
+	const bool useQuantization = bvh->*SerializedBvhFields::useQuantization();
+	const int subtreeHeaderCount = bvh->*SerializedBvhFields::subtreeHeaderCount();
+	unsigned char* nodeData = blob+header->m_bvhOffset+sizeof(btQuantizedBvh);
+	btBvhSubtreeInfo* subtreeHeaders = (btBvhSubtreeInfo*)(nodeData+nodeCount*(useQuantization ? sizeof(btQuantizedBvhNode) : sizeof(btOptimizedBvhNode)));
+	//the left child of the root and the first leaf
+	const int left = 1;
+	int leaf = 0;
+	while (GetEscapeIndex(nodeData,useQuantization,leaf)>1)
+	{
+		leaf++;
+	}
+	switch (corruption)
+	{
+	case TRUNCATED:
+		return blobSize-16;
+	case NEGATIVE_PARTS:
+		header->m_numParts = -1;
+		break;
+	case NEGATIVE_TRIANGLES:
+		parts[1].m_numTriangles = -1;
+		break;
+	case NEGATIVE_STRIDE:
+		parts[0].m_vertexStride = -12;
+		break;
+	case OVERFLOWING_TRIANGLES:
+		//the 32 bit size wraps to 0
+		parts[0].m_numTriangles = 0x40000000;
+		parts[0].m_triangleIndexStride = 16;
+		break;
+	case OVERFLOWING_VERTICES:
+		parts[1].m_numVertices = 0x20000000;
+		parts[1].m_vertexStride = 16;
+		break;
+	case INDEX_OUT_OF_RANGE:
+		((int*)(blob+parts[0].m_triangleIndexOffset))[7] = GRID_SIZE*GRID_SIZE;
+		break;
+	case SHORT_INDEX_OUT_OF_RANGE:
+		((unsigned short*)(blob+parts[1].m_triangleIndexOffset))[11] = 0xffff;
+		break;
+	case SMALL_BVH:
+		header->m_bvhSize = 16;
+		break;
+	case MISALIGNED_BVH:
+		header->m_bvhOffset += 4;
+		break;
+	case HUGE_HASH_TABLE:
+		triangleInfoMap->m_hashTableSize = 0x40000000;
+		break;
+	case NEGATIVE_VALUES:
+		triangleInfoMap->m_numValues = -2;
+		break;
+	case NEGATIVE_NODE_COUNT:
+		nodeCount = -1;
+		break;
+	case HUGE_NODE_COUNT:
+		//the 32 bit size of the nodes wraps
+		nodeCount = 0x10000001;
+		break;
+	case MISSING_NODE:
+		nodeCount--;
+		break;
+	case ESCAPE_OUT_OF_RANGE:
+		SetEscapeIndex(nodeData,useQuantization,left,nodeCount);
+		break;
+	case ESCAPE_INTO_SIBLING:
+		SetEscapeIndex(nodeData,useQuantization,left,GetEscapeIndex(nodeData,useQuantization,left)+1);
+		break;
+	case LEAF_PART_OUT_OF_RANGE:
+		SetLeaf(nodeData,useQuantization,leaf,header->m_numParts,0);
+		break;
+	case LEAF_TRIANGLE_OUT_OF_RANGE:
+		SetLeaf(nodeData,useQuantization,leaf,1,parts[1].m_numTriangles);
+		break;
+	case SUBTREE_ROOT_OUT_OF_RANGE:
+		if (!subtreeHeaderCount)
+			return 0;
+		subtreeHeaders[subtreeHeaderCount-1].m_rootNodeIndex = nodeCount;
+		break;
+	case SUBTREE_SIZE_OUT_OF_RANGE:
+		if (!subtreeHeaderCount)
+			return 0;
+		subtreeHeaders[subtreeHeaderCount-1].m_subtreeSize = nodeCount-subtreeHeaders[subtreeHeaderCount-1].m_rootNodeIndex+1;
+		break;
+	}
+	return blobSize;
+}
+
+static int TestBlob(bool useQuantizedAabbCompression)
+{
+	GridMesh mesh;
+	btBvhTriangleMeshShape* original = CreateShape(mesh,useQuantizedAabbCompression);
+	const unsigned int blobSize = btCollisionMeshBlob::calculateBlobSize(original);
+	unsigned char* blob = (unsigned char*)btAlignedAlloc(blobSize,16);
+	unsigned char* corrupt = (unsigned char*)btAlignedAlloc(blobSize,16);
+	int result = 0;
+
+	if (!btCollisionMeshBlob::writeBlob(original,blob,blobSize))
+	{
+		printf( "collisionMeshBlob fail: writeBlob\n" );
+		result = 1;
+	}
+
+	if (!result)
+	{
+		memcpy(corrupt,blob,blobSize);
+		btCollisionMeshBlob meshBlob;
+		uint64_t startTime = ReadTicks();
+		const bool wrapped = meshBlob.wrapBlob(corrupt,blobSize);
+		uint64_t checkedTime = ReadTicks() - startTime;
+		meshBlob.release();
+		memcpy(corrupt,blob,blobSize);
+		startTime = ReadTicks();
+		const bool wrappedUnchecked = meshBlob.wrapBlob(corrupt,blobSize,false);
+		uint64_t uncheckedTime = ReadTicks() - startTime;
+		vlog( "collisionMeshBlob %s %d bytes, wrap %10.1f, without index check %10.1f\n", useQuantizedAabbCompression ? "quantized" : "unquantized", blobSize, TicksToCycles(checkedTime), TicksToCycles(uncheckedTime) );
+		if (!wrapped || !wrappedUnchecked || !meshBlob.getShape()->getTriangleInfoMap() ||
+			meshBlob.getShape()->getTriangleInfoMap()->size()!=original->getTriangleInfoMap()->size() ||
+			!SameQueries(meshBlob.getShape(),original))
+		{
+			printf( "collisionMeshBlob fail: the wrapped blob does not match the shape\n" );
+			result = 1;
+		}
+	}
+
+	for (int c=0;c<NUM_CORRUPTIONS && !result;c++)
+	{
+		memcpy(corrupt,blob,blobSize);
+		const unsigned int corruptSize = Corrupt(corrupt,blobSize,c);
+		btCollisionMeshBlob meshBlob;
+		if (corruptSize && (meshBlob.wrapBlob(corrupt,corruptSize) || meshBlob.getShape()))
+		{
+			printf( "collisionMeshBlob fail: a %s blob with %s was accepted\n", useQuantizedAabbCompression ? "quantized" : "unquantized", gCorruptionNames[c] );
+			result = 1;
+		}
+	}
+
+	btAlignedFree(corrupt);
+	btAlignedFree(blob);
+	delete original->getTriangleInfoMap();
+	delete original->getMeshInterface();
+	delete original;
+	return result;
+}
+
+int Test_collisionMeshBlob(void)
+{
+	if (TestBlob(true) || TestBlob(false))
+	{
+		return 1;
+	}
+	return 0;
+}
+#endif
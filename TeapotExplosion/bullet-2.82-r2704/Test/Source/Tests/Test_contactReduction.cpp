@@ -0,0 +1,228 @@
+//
+//  Test_contactReduction.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_contactReduction.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletCollision/CollisionDispatch/btSimulationIslandManager.h>
+#include <BulletCollision/CollisionDispatch/btContactReduction.h>
+
+#define STACK_WIDTH 5
+#define STACK_HEIGHT 4
+#define STACK_STEPS 600
+
+///counts the contact points handed to the solver
+class RowCountingSolver : public btSequentialImpulseConstraintSolver
+{
+public:
+	long long	m_numRows;
+
+	RowCountingSolver()
+	:m_numRows(0)
+	{
+	}
+
+	virtual btScalar solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifolds,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& info,btIDebugDraw* debugDrawer,btDispatcher* dispatcher)
+	{
+		for (int i=0;i<numManifolds;i++)
+		{
+			m_numRows += manifolds[i]->getNumContacts();
+		}
+		return btSequentialImpulseConstraintSolver::solveGroup(bodies,numBodies,manifolds,numManifolds,constraints,numConstraints,info,debugDrawer,dispatcher);
+	}
+};
+
+static void AddPoint(btPersistentManifold& manifold,const btVector3& point,int index,btScalar impulse)
+{
+	btManifoldPoint pt(point,point,btVector3(0,1,0),btScalar(-0.01));
+	pt.m_positionWorldOnA = point;
+	pt.m_positionWorldOnB = point;
+	pt.m_partId0 = 0;
+	pt.m_partId1 = 0;
+	pt.m_index0 = index;
+	pt.m_index1 = 0;
+	pt.m_appliedImpulse = impulse;
+	manifold.addManifoldPoint(pt);
+}
+
+//a pair that is merged and then released must not warm start from the impulses of before the merge
+static int TestRelease(void)
+{
+	btCollisionObject body0;
+	btCollisionObject body1;
+	btPersistentManifold manifoldA(&body0,&body1,0,btScalar(0.02),btScalar(0.02));
+	btPersistentManifold manifoldB(&body0,&body1,0,btScalar(0.02),btScalar(0.02));
+	for (int i=0;i<3;i++)
+	{
+		AddPoint(manifoldA,btVector3(btScalar(i),0,0),i,btScalar(1.));
+		AddPoint(manifoldB,btVector3(btScalar(i),0,1),i,btScalar(2.));
+	}
+
+	btContactReduction reduction;
+	btAlignedObjectArray<btPersistentManifold*> manifolds;
+	manifolds.push_back(&manifoldA);
+	manifolds.push_back(&manifoldB);
+	reduction.reduceManifolds(manifolds);
+
+	btPersistentManifold* merged = reduction.findMergedManifold(&body1,&body0);
+	if (manifolds.size()!=1 || !merged || manifolds[0]!=merged || reduction.getNumPointsIn()!=6 || merged->getNumContacts()!=4)
+	{
+		printf( "contactReduction fail: %d manifolds, %d points in, %d merged points\n", manifolds.size(), reduction.getNumPointsIn(), merged ? merged->getNumContacts() : 0 );
+		return 1;
+	}
+	//a new merged manifold warm starts from the points of the algorithms
+	for (int i=0;i<merged->getNumContacts();i++)
+	{
+		if (merged->getContactPoint(i).m_appliedImpulse==btScalar(0.))
+		{
+			printf( "contactReduction fail: merged point %d has no warm starting impulse\n", i );
+			return 1;
+		}
+	}
+
+	//the pair drops to one manifold, the merged manifold is released
+	manifoldB.clearManifold();
+	manifolds.resize(0);
+	manifolds.push_back(&manifoldA);
+	manifolds.push_back(&manifoldB);
+	reduction.reduceManifolds(manifolds);
+	if (reduction.getNumMergedManifolds()!=0 || reduction.findMergedManifold(&body0,&body1) || manifolds.size()!=2)
+	{
+		printf( "contactReduction fail: the merged manifold of a pair with one manifold was kept\n" );
+		return 1;
+	}
+	for (int i=0;i<manifoldA.getNumContacts();i++)
+	{
+		if (manifoldA.getContactPoint(i).m_appliedImpulse!=btScalar(0.))
+		{
+			printf( "contactReduction fail: released point %d keeps the stale impulse %f\n", i, manifoldA.getContactPoint(i).m_appliedImpulse );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+struct StackResult
+{
+	long long	m_numRows;
+	btScalar	m_maxVelocity;
+	btScalar	m_maxDrop;
+	uint64_t	m_time;
+};
+
+//stacks of compounds of 9 boxes resting on a ground box
+static void RunStack(btContactReduction* reduction,StackResult& result)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	RowCountingSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+	world.getSimulationIslandManager()->setContactReduction(reduction);
+
+	btBoxShape groundShape(btVector3(50,1,50));
+	btRigidBody ground(0,0,&groundShape);
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(btVector3(0,-1,0));
+	ground.setWorldTransform(transform);
+	world.addRigidBody(&ground);
+
+	btBoxShape cube(btVector3(btScalar(0.25),btScalar(0.25),btScalar(0.25)));
+	btCompoundShape compound;
+	for (int x=0;x<3;x++)
+	{
+		for (int z=0;z<3;z++)
+		{
+			btTransform child;
+			child.setIdentity();
+			child.setOrigin(btVector3(btScalar(x*0.5-0.5),0,btScalar(z*0.5-0.5)));
+			compound.addChildShape(child,&cube);
+		}
+	}
+	btVector3 inertia;
+	compound.calculateLocalInertia(1,inertia);
+
+	btAlignedObjectArray<btRigidBody*> bodies;
+	for (int i=0;i<STACK_WIDTH;i++)
+	{
+		for (int j=0;j<STACK_WIDTH;j++)
+		{
+			for (int k=0;k<STACK_HEIGHT;k++)
+			{
+				btRigidBody* body = new btRigidBody(1,0,&compound,inertia);
+				transform.setOrigin(btVector3(btScalar(i*2.0-4),btScalar(0.25+k*0.52),btScalar(j*2.0-4)));
+				body->setWorldTransform(transform);
+				body->setActivationState(DISABLE_DEACTIVATION);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	uint64_t startTime = ReadTicks();
+	for (int s=0;s<STACK_STEPS;s++)
+	{
+		world.stepSimulation(btScalar(1./60.),0);
+	}
+	result.m_time = ReadTicks() - startTime;
+	result.m_numRows = solver.m_numRows;
+
+	result.m_maxVelocity = 0;
+	result.m_maxDrop = 0;
+	for (int i=0;i<bodies.size();i++)
+	{
+		const int level = i%STACK_HEIGHT;
+		result.m_maxVelocity = btMax(result.m_maxVelocity,bodies[i]->getLinearVelocity().length());
+		result.m_maxDrop = btMax(result.m_maxDrop,btFabs(bodies[i]->getWorldTransform().getOrigin().y()-btScalar(0.25+level*0.5)));
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	world.removeRigidBody(&ground);
+}
+
+int Test_contactReduction(void)
+{
+	if (TestRelease())
+		return 1;
+
+	StackResult plain;
+	StackResult reduced;
+	btContactReduction reduction;
+	RunStack(0,plain);
+	RunStack(&reduction,reduced);
+
+	vlog( "contactReduction %d compound stacks, %d steps:\n", STACK_WIDTH*STACK_WIDTH, STACK_STEPS );
+	vlog( "     \t      rows\t  max velocity\t  max drop\t    time\n" );
+	vlog( "plain\t%10lld\t%14.5f\t%10.5f\t%10.1f\n", plain.m_numRows, plain.m_maxVelocity, plain.m_maxDrop, TicksToCycles( plain.m_time ) / STACK_STEPS );
+	vlog( "reduced\t%10lld\t%14.5f\t%10.5f\t%10.1f\n", reduced.m_numRows, reduced.m_maxVelocity, reduced.m_maxDrop, TicksToCycles( reduced.m_time ) / STACK_STEPS );
+
+	//each compound rests on 9 boxes, the reduction keeps 4 points per pair
+	if (reduced.m_numRows*4 > plain.m_numRows)
+	{
+		printf( "contactReduction fail: %lld solver rows, %lld without reduction\n", reduced.m_numRows, plain.m_numRows );
+		return 1;
+	}
+	//the stacks stay at rest as well as without reduction
+	if (reduced.m_maxVelocity > btMax(plain.m_maxVelocity*btScalar(1.5),btScalar(0.05)) || reduced.m_maxDrop > btScalar(0.01))
+	{
+		printf( "contactReduction fail: max velocity %f and drop %f, %f and %f without reduction\n", reduced.m_maxVelocity, reduced.m_maxDrop, plain.m_maxVelocity, plain.m_maxDrop );
+		return 1;
+	}
+	return 0;
+}
+#endif
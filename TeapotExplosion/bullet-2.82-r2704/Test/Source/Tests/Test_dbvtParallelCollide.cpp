@@ -0,0 +1,141 @@
+//
+//  Test_dbvtParallelCollide.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_dbvtParallelCollide.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <LinearMath/btThreads.h>
+
+#define NUM_PROXIES 3000
+#define NUM_STEPS 40
+#define NUM_THREADS 4
+#define WORLD_SIZE 60
+
+namespace
+{
+
+btScalar RandomScalar(btScalar range)
+{
+	return range*btScalar(rand())/btScalar(RAND_MAX);
+}
+
+void RandomAabb(btVector3& aabbMin,btVector3& aabbMax)
+{
+	aabbMin.setValue(RandomScalar(WORLD_SIZE),RandomScalar(WORLD_SIZE),RandomScalar(WORLD_SIZE));
+	aabbMax = aabbMin+btVector3(1+RandomScalar(3),1+RandomScalar(3),1+RandomScalar(3));
+}
+
+///the same pairs, with the same proxies first, in the same order
+bool SamePairs(btOverlappingPairCache* serial,btOverlappingPairCache* parallel,int step)
+{
+	const btBroadphasePairArray& serialPairs = serial->getOverlappingPairArray();
+	const btBroadphasePairArray& parallelPairs = parallel->getOverlappingPairArray();
+	if (serialPairs.size()!=parallelPairs.size())
+	{
+		printf( "dbvtParallelCollide fail: step %d has %d pairs, %d with parallelCollide\n", step, serialPairs.size(), parallelPairs.size() );
+		return false;
+	}
+	for (int i=0;i<serialPairs.size();i++)
+	{
+		const btBroadphasePair& a = serialPairs[i];
+		const btBroadphasePair& b = parallelPairs[i];
+		if (a.m_pProxy0->m_uniqueId!=b.m_pProxy0->m_uniqueId || a.m_pProxy1->m_uniqueId!=b.m_pProxy1->m_uniqueId)
+		{
+			printf( "dbvtParallelCollide fail: step %d pair %d is (%d,%d), (%d,%d) with parallelCollide\n", step, i,
+				a.m_pProxy0->m_uniqueId, a.m_pProxy1->m_uniqueId, b.m_pProxy0->m_uniqueId, b.m_pProxy1->m_uniqueId );
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+int Test_dbvtParallelCollide(void)
+{
+	btITaskScheduler* previousScheduler = btGetTaskScheduler();
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	//several threads even on a single core, so the subtree pairs run on several threads
+	scheduler->setNumThreads(NUM_THREADS);
+	btSetTaskScheduler(scheduler);
+
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	//the same scene, the first never runs the deferred collide on the task scheduler, the second always does
+	btDbvtBroadphase serial;
+	btDbvtBroadphase parallel;
+	serial.m_deferedcollide = parallel.m_deferedcollide = true;
+	serial.m_parallelleaves = 0x7fffffff;
+	parallel.m_parallelleaves = 0;
+
+	srand(7);
+	btAlignedObjectArray<btBroadphaseProxy*> serialProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> parallelProxies;
+	for (int i=0;i<NUM_PROXIES;i++)
+	{
+		btVector3 aabbMin,aabbMax;
+		RandomAabb(aabbMin,aabbMax);
+		serialProxies.push_back(serial.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0));
+		parallelProxies.push_back(parallel.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0));
+	}
+
+	int result = 0;
+	uint64_t serialTime = 0;
+	uint64_t parallelTime = 0;
+	int numParallelSteps = 0;
+	for (int step=0;step<NUM_STEPS && !result;step++)
+	{
+		//a third of the proxies moves, the others stay and end up in the fixed tree
+		for (int i=0;i<NUM_PROXIES;i+=3)
+		{
+			const int proxy = (i+step)%NUM_PROXIES;
+			btVector3 aabbMin,aabbMax;
+			RandomAabb(aabbMin,aabbMax);
+			serial.setAabb(serialProxies[proxy],aabbMin,aabbMax,&dispatcher);
+			parallel.setAabb(parallelProxies[proxy],aabbMin,aabbMax,&dispatcher);
+		}
+		uint64_t startTime = ReadTicks();
+		serial.calculateOverlappingPairs(&dispatcher);
+		serialTime += ReadTicks() - startTime;
+		startTime = ReadTicks();
+		parallel.m_collideTasks.resize(0);
+		parallel.calculateOverlappingPairs(&dispatcher);
+		parallelTime += ReadTicks() - startTime;
+		numParallelSteps += parallel.m_collideTasks.size() ? 1 : 0;
+		if (!SamePairs(serial.getOverlappingPairCache(),parallel.getOverlappingPairCache(),step))
+		{
+			result = 1;
+		}
+	}
+	vlog( "dbvtParallelCollide %d proxies, %d pairs, serial %10.1f, parallel %10.1f per step\n", NUM_PROXIES,
+		serial.getOverlappingPairCache()->getNumOverlappingPairs(), TicksToCycles(serialTime)/NUM_STEPS, TicksToCycles(parallelTime)/NUM_STEPS );
+	if (!result && numParallelSteps!=NUM_STEPS)
+	{
+		printf( "dbvtParallelCollide fail: parallelCollide ran in %d of %d steps\n", numParallelSteps, NUM_STEPS );
+		result = 1;
+	}
+
+	for (int i=0;i<NUM_PROXIES;i++)
+	{
+		serial.destroyProxy(serialProxies[i],&dispatcher);
+		parallel.destroyProxy(parallelProxies[i],&dispatcher);
+	}
+	btSetTaskScheduler(previousScheduler);
+	delete scheduler;
+	return result;
+}
+#endif
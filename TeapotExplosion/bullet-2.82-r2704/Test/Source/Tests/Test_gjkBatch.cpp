@@ -0,0 +1,182 @@
+//
+//  Test_gjkBatch.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_gjkBatch.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkBatch.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h>
+#include <BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h>
+#include <BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h>
+
+#define NUM_PAIRS 4000
+#define NUM_SHAPE_PAIRS 5
+
+///keeps the last contact point btGjkPairDetector reports
+struct ClosestPointResult : public btDiscreteCollisionDetectorInterface::Result
+{
+	bool		m_hasResult;
+	btVector3	m_normalOnBInWorld;
+	btVector3	m_pointInWorld;
+	btScalar	m_distance;
+
+	ClosestPointResult()
+	:m_hasResult(false)
+	{
+	}
+
+	virtual void setShapeIdentifiersA(int partId0,int index0)
+	{
+	}
+
+	virtual void setShapeIdentifiersB(int partId1,int index1)
+	{
+	}
+
+	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth)
+	{
+		m_hasResult = true;
+		m_normalOnBInWorld = normalOnBInWorld;
+		m_pointInWorld = pointInWorld;
+		m_distance = depth;
+	}
+};
+
+static btScalar RandomUnit(void)
+{
+	return btScalar(rand())/btScalar(RAND_MAX);
+}
+
+static btVector3 RandomDirection(void)
+{
+	return btVector3(RandomUnit()-btScalar(0.5),RandomUnit()-btScalar(0.5),RandomUnit()-btScalar(0.5)).normalized();
+}
+
+int Test_gjkBatch(void)
+{
+	srand(1);
+	btConvexHullShape hull;
+	for (int i=0;i<40;i++)
+	{
+		hull.addPoint(RandomDirection()*(btScalar(0.5)+RandomUnit()*btScalar(0.5)),false);
+	}
+	hull.recalcLocalAabb();
+	btConvexHullShape scaledHull;
+	for (int i=0;i<12;i++)
+	{
+		scaledHull.addPoint(RandomDirection()*btVector3(btScalar(1.5),btScalar(0.5),btScalar(0.7)),false);
+	}
+	scaledHull.recalcLocalAabb();
+	scaledHull.setLocalScaling(btVector3(1,btScalar(1.3),btScalar(0.8)));
+	btBoxShape box(btVector3(btScalar(0.5),btScalar(0.8),btScalar(0.3)));
+	btBoxShape flatBox(btVector3(1,btScalar(0.2),btScalar(0.6)));
+	btSphereShape sphere(btScalar(0.6));
+
+	const btConvexShape* shapesA[NUM_SHAPE_PAIRS] = {&hull,&box,&hull,&sphere,&box};
+	const btConvexShape* shapesB[NUM_SHAPE_PAIRS] = {&scaledHull,&flatBox,&box,&hull,&sphere};
+	static const char* names[NUM_SHAPE_PAIRS] = {"hull-hull","box-box","hull-box","sphere-hull","box-sphere"};
+
+	btVoronoiSimplexSolver simplexSolver;
+	btGjkEpaPenetrationDepthSolver penetrationDepthSolver;
+	btAlignedObjectArray<btGjkBatchInput> inputs;
+	btAlignedObjectArray<btGjkBatchOutput> outputs;
+	inputs.resize(NUM_PAIRS);
+	outputs.resize(NUM_PAIRS);
+
+	for (int c=0;c<NUM_SHAPE_PAIRS;c++)
+	{
+		//pairs from touching to a few margins apart
+		const btScalar margin = shapesA[c]->getMargin()+shapesB[c]->getMargin()+btScalar(0.02);
+		for (int i=0;i<NUM_PAIRS;i++)
+		{
+			btGjkBatchInput& input = inputs[i];
+			const btVector3 origin(3,4,5);
+			input.m_transformA = btTransform(btQuaternion(RandomDirection(),RandomUnit()*SIMD_2_PI),origin);
+			input.m_transformB = btTransform(btQuaternion(RandomDirection(),RandomUnit()*SIMD_2_PI),origin+RandomDirection()*(btScalar(0.5)+RandomUnit()*btScalar(2.5)));
+			input.m_shapeA = shapesA[c];
+			input.m_shapeB = shapesB[c];
+			input.m_maximumDistanceSquared = margin*margin;
+		}
+
+		uint64_t startTime = ReadTicks();
+		btGjkBatch::computeClosestPoints(&inputs[0],&outputs[0],NUM_PAIRS);
+		uint64_t batchTime = ReadTicks() - startTime;
+
+		int numContacts = 0;
+		int numSeparated = 0;
+		int numFallbacks = 0;
+		uint64_t detectorTime = 0;
+		for (int i=0;i<NUM_PAIRS;i++)
+		{
+			const btGjkBatchInput& input = inputs[i];
+			const btGjkBatchOutput& output = outputs[i];
+			ClosestPointResult result;
+			btGjkPairDetector detector(input.m_shapeA,input.m_shapeB,&simplexSolver,&penetrationDepthSolver);
+			btGjkPairDetector::ClosestPointInput closestPointInput;
+			closestPointInput.m_transformA = input.m_transformA;
+			closestPointInput.m_transformB = input.m_transformB;
+			closestPointInput.m_maximumDistanceSquared = input.m_maximumDistanceSquared;
+			startTime = ReadTicks();
+			detector.getClosestPoints(closestPointInput,result,0);
+			detectorTime += ReadTicks() - startTime;
+
+			switch (output.m_status)
+			{
+			case BT_GJK_BATCH_CONTACT:
+				{
+					numContacts++;
+					const btScalar error = result.m_hasResult ?
+						btMax(btMax((output.m_normalOnBInWorld-result.m_normalOnBInWorld).length(),(output.m_pointInWorld-result.m_pointInWorld).length()),btFabs(output.m_distance-result.m_distance)) :
+						BT_LARGE_FLOAT;
+					if (error > btScalar(1e-3))
+					{
+						printf( "gjkBatch fail: %s pair %d contact at distance %f, btGjkPairDetector %s %f\n", names[c], i, output.m_distance,
+							result.m_hasResult ? "at" : "has no contact", result.m_hasResult ? result.m_distance : btScalar(0.) );
+						return 1;
+					}
+					break;
+				}
+			case BT_GJK_BATCH_SEPARATED:
+				{
+					numSeparated++;
+					const btVector3 axis = detector.getCachedSeparatingAxis();
+					if (result.m_hasResult || (output.m_separatingAxis-axis).length() > axis.length()*btScalar(1e-3))
+					{
+						printf( "gjkBatch fail: %s pair %d separated, btGjkPairDetector %s\n", names[c], i,
+							result.m_hasResult ? "has a contact" : "has another separating axis" );
+						return 1;
+					}
+					break;
+				}
+			default:
+				//penetrating pairs are left to btGjkPairDetector
+				numFallbacks++;
+				break;
+			}
+		}
+
+		vlog( "gjkBatch %-12s %5d contacts %5d separated %5d fallbacks, batch %10.1f, btGjkPairDetector %10.1f\n", names[c],
+			numContacts, numSeparated, numFallbacks, TicksToCycles(batchTime)/NUM_PAIRS, TicksToCycles(detectorTime)/NUM_PAIRS );
+		if (!numContacts || !numSeparated)
+		{
+			printf( "gjkBatch fail: %s has %d contacts and %d separated pairs\n", names[c], numContacts, numSeparated );
+			return 1;
+		}
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,374 @@
+//
+//  Test_heightfield.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_heightfield.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h>
+#include <BulletCollision/NarrowPhaseCollision/btRaycastCallback.h>
+
+#define GRID_WIDTH 61
+#define GRID_LENGTH 47
+#define NUM_QUERIES 200
+#define NUM_RAYS 300
+
+namespace
+{
+
+struct ReportedTriangle
+{
+	int			m_x;
+	int			m_j;
+	btVector3	m_vertices[3];
+
+	bool	operator<(const ReportedTriangle& other) const
+	{
+		return m_x<other.m_x || (m_x==other.m_x && m_j<other.m_j);
+	}
+	bool	operator==(const ReportedTriangle& other) const
+	{
+		return m_x==other.m_x && m_j==other.m_j && m_vertices[0]==other.m_vertices[0] && m_vertices[1]==other.m_vertices[1] && m_vertices[2]==other.m_vertices[2];
+	}
+};
+
+class ReportedTriangleSortPredicate
+{
+public:
+	bool operator() ( const ReportedTriangle& a, const ReportedTriangle& b ) const
+	{
+		return a < b;
+	}
+};
+
+struct CollectTriangles : public btTriangleCallback
+{
+	btAlignedObjectArray<ReportedTriangle>	m_triangles;
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		ReportedTriangle reported;
+		reported.m_x = partId;
+		reported.m_j = triangleIndex;
+		reported.m_vertices[0] = triangle[0];
+		reported.m_vertices[1] = triangle[1];
+		reported.m_vertices[2] = triangle[2];
+		m_triangles.push_back(reported);
+	}
+
+	void	sort()
+	{
+		m_triangles.quickSort(ReportedTriangleSortPredicate());
+	}
+
+	///the triangles have to be sorted
+	bool	contains(const ReportedTriangle& triangle) const
+	{
+		int low = 0;
+		int high = m_triangles.size();
+		while (low<high)
+		{
+			const int mid = (low+high)/2;
+			if (m_triangles[mid]<triangle)
+				low = mid+1;
+			else
+				high = mid;
+		}
+		for (int i=low;i<m_triangles.size() && !(triangle<m_triangles[i]);i++)
+		{
+			if (m_triangles[i]==triangle)
+				return true;
+		}
+		return false;
+	}
+};
+
+struct ClosestHit : public btTriangleRaycastCallback
+{
+	ClosestHit(const btVector3& from,const btVector3& to)
+	:btTriangleRaycastCallback(from,to)
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex)
+	{
+		return hitFraction;
+	}
+};
+
+///a terrain with a hole: the cells of the hole are left out by processAllTriangles and performRaycast
+class HoleTerrainShape : public btHeightfieldTerrainShape
+{
+	struct SkipHole : public btTriangleCallback
+	{
+		btTriangleCallback*	m_callback;
+
+		virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+		{
+			if (partId<GRID_WIDTH/4 || partId>=GRID_WIDTH*3/4 || triangleIndex<GRID_LENGTH/4 || triangleIndex>=GRID_LENGTH*3/4)
+				m_callback->processTriangle(triangle,partId,triangleIndex);
+		}
+	};
+
+public:
+
+	HoleTerrainShape(const void* heightfieldData,btScalar heightScale,btScalar minHeight,btScalar maxHeight,PHY_ScalarType heightDataType)
+	:btHeightfieldTerrainShape(GRID_WIDTH,GRID_LENGTH,heightfieldData,heightScale,minHeight,maxHeight,1,heightDataType,false)
+	{
+	}
+
+	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const
+	{
+		SkipHole skipHole;
+		skipHole.m_callback = callback;
+		btHeightfieldTerrainShape::processAllTriangles(&skipHole,aabbMin,aabbMax);
+	}
+
+	virtual void	performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const
+	{
+		SkipHole skipHole;
+		skipHole.m_callback = callback;
+		btHeightfieldTerrainShape::performRaycast(&skipHole,raySource,rayTarget);
+	}
+};
+
+}
+
+static btScalar RandomUnit(void)
+{
+	return btScalar(rand())/btScalar(RAND_MAX);
+}
+
+static btVector3 RandomPoint(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	return btVector3(aabbMin.x()+RandomUnit()*(aabbMax.x()-aabbMin.x()),aabbMin.y()+RandomUnit()*(aabbMax.y()-aabbMin.y()),aabbMin.z()+RandomUnit()*(aabbMax.z()-aabbMin.z()));
+}
+
+static const char* DataTypeName(PHY_ScalarType type)
+{
+	return type==PHY_FLOAT ? "float" : type==PHY_UCHAR ? "uchar" : "short";
+}
+
+///the pyramid may only leave out triangles out of the up range of the query, every triangle it reports has to be one of the plain query
+static int CompareCulledQueries(const char* title,const btHeightfieldTerrainShape& plain,const btHeightfieldTerrainShape& culled,int upAxis,
+								const btVector3& terrainMin,const btVector3& terrainMax,int& numPlain,int& numCulled)
+{
+	for (int q=0;q<NUM_QUERIES;q++)
+	{
+		const btVector3 center = RandomPoint(terrainMin,terrainMax);
+		btVector3 halfExtents = RandomPoint(btVector3(0,0,0),btVector3(8,8,8));
+		halfExtents[upAxis] = RandomUnit()*btScalar(3.);
+		CollectTriangles plainTriangles,culledTriangles;
+		plain.processAllTriangles(&plainTriangles,center-halfExtents,center+halfExtents);
+		culled.processAllTriangles(&culledTriangles,center-halfExtents,center+halfExtents);
+		plainTriangles.sort();
+		culledTriangles.sort();
+		numPlain += plainTriangles.m_triangles.size();
+		numCulled += culledTriangles.m_triangles.size();
+
+		for (int i=0;i<culledTriangles.m_triangles.size();i++)
+		{
+			if (!plainTriangles.contains(culledTriangles.m_triangles[i]))
+			{
+				printf( "heightfield fail: %s query %d, the pyramid reports a triangle of cell %d,%d the plain query does not\n", title, q,
+					culledTriangles.m_triangles[i].m_x, culledTriangles.m_triangles[i].m_j );
+				return 1;
+			}
+		}
+		const btScalar low = center[upAxis]-halfExtents[upAxis];
+		const btScalar high = center[upAxis]+halfExtents[upAxis];
+		for (int i=0;i<plainTriangles.m_triangles.size();i++)
+		{
+			const ReportedTriangle& triangle = plainTriangles.m_triangles[i];
+			const btScalar triangleLow = btMin(triangle.m_vertices[0][upAxis],btMin(triangle.m_vertices[1][upAxis],triangle.m_vertices[2][upAxis]));
+			const btScalar triangleHigh = btMax(triangle.m_vertices[0][upAxis],btMax(triangle.m_vertices[1][upAxis],triangle.m_vertices[2][upAxis]));
+			if (triangleLow<=high-btScalar(1e-3) && triangleHigh>=low+btScalar(1e-3) && !culledTriangles.contains(triangle))
+			{
+				printf( "heightfield fail: %s query %d, the pyramid misses the triangle of cell %d,%d\n", title, q, triangle.m_x, triangle.m_j );
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static int TestTerrain(PHY_ScalarType dataType,int upAxis,bool flipQuadEdges,bool useDiamondSubdivision)
+{
+	char title[64];
+	sprintf( title, "%s up %d%s%s", DataTypeName(dataType), upAxis, flipQuadEdges ? " flipped" : "", useDiamondSubdivision ? " diamond" : "" );
+
+	btAlignedObjectArray<float> floatHeights;
+	btAlignedObjectArray<unsigned char> charHeights;
+	btAlignedObjectArray<short> shortHeights;
+	for (int j=0;j<GRID_LENGTH;j++)
+	{
+		for (int x=0;x<GRID_WIDTH;x++)
+		{
+			const float height = 20.f*sinf(float(x)*0.3f)*cosf(float(j)*0.2f)+float(RandomUnit())*3.f;
+			floatHeights.push_back(height);
+			charHeights.push_back((unsigned char)(height*4.f+128.f));
+			shortHeights.push_back((short)(height*100.f));
+		}
+	}
+	const void* data = dataType==PHY_FLOAT ? (const void*)&floatHeights[0] : dataType==PHY_UCHAR ? (const void*)&charHeights[0] : (const void*)&shortHeights[0];
+	const btScalar heightScale = dataType==PHY_FLOAT ? btScalar(1.) : dataType==PHY_UCHAR ? btScalar(0.25) : btScalar(0.01);
+	const btScalar minHeight = dataType==PHY_UCHAR ? btScalar(0.) : btScalar(-24.);
+	const btScalar maxHeight = dataType==PHY_UCHAR ? btScalar(255.*0.25) : btScalar(24.);
+
+	btHeightfieldTerrainShape plain(GRID_WIDTH,GRID_LENGTH,data,heightScale,minHeight,maxHeight,upAxis,dataType,flipQuadEdges);
+	btHeightfieldTerrainShape culled(GRID_WIDTH,GRID_LENGTH,data,heightScale,minHeight,maxHeight,upAxis,dataType,flipQuadEdges);
+	plain.setUseDiamondSubdivision(useDiamondSubdivision);
+	culled.setUseDiamondSubdivision(useDiamondSubdivision);
+	const btVector3 scaling(btScalar(0.5)+RandomUnit(),btScalar(0.5)+RandomUnit(),btScalar(0.5)+RandomUnit());
+	plain.setLocalScaling(scaling);
+	culled.setLocalScaling(scaling);
+	culled.buildMinMaxPyramid();
+	btVector3 terrainMin,terrainMax;
+	plain.getAabb(btTransform::getIdentity(),terrainMin,terrainMax);
+
+	int numPlain = 0;
+	int numCulled = 0;
+	if (CompareCulledQueries(title,plain,culled,upAxis,terrainMin,terrainMax,numPlain,numCulled))
+		return 1;
+
+	//performRaycast has to find the hit the aabb of the ray finds, with and without the pyramid
+	int numHits = 0;
+	uint64_t aabbTime = 0;
+	uint64_t marchTime = 0;
+	for (int q=0;q<NUM_RAYS;q++)
+	{
+		btVector3 rayFrom = RandomPoint(terrainMin,terrainMax)*btScalar(1.5);
+		btVector3 rayTo = RandomPoint(terrainMin,terrainMax)*btScalar(1.5);
+		if (q%7==0)
+		{
+			rayTo = rayFrom;
+			rayTo[upAxis] = terrainMin[upAxis]-btScalar(5.);
+		}
+		ClosestHit aabbHit(rayFrom,rayTo),marchHit(rayFrom,rayTo),culledHit(rayFrom,rayTo);
+		btVector3 rayMin = rayFrom;
+		btVector3 rayMax = rayFrom;
+		rayMin.setMin(rayTo);
+		rayMax.setMax(rayTo);
+		uint64_t startTime = ReadTicks();
+		plain.processAllTriangles(&aabbHit,rayMin,rayMax);
+		aabbTime += ReadTicks() - startTime;
+		startTime = ReadTicks();
+		plain.performRaycast(&marchHit,rayFrom,rayTo);
+		marchTime += ReadTicks() - startTime;
+		culled.performRaycast(&culledHit,rayFrom,rayTo);
+		if (btFabs(aabbHit.m_hitFraction-marchHit.m_hitFraction)>btScalar(1e-6) || btFabs(aabbHit.m_hitFraction-culledHit.m_hitFraction)>btScalar(1e-6))
+		{
+			printf( "heightfield fail: %s ray %d hits at %f in the aabb of the ray, performRaycast at %f, with the pyramid at %f\n", title, q,
+				aabbHit.m_hitFraction, marchHit.m_hitFraction, culledHit.m_hitFraction );
+			return 1;
+		}
+		if (aabbHit.m_hitFraction<btScalar(1.))
+			numHits++;
+	}
+
+	//raise a patch, the updated pyramid has to report what a newly built one reports
+	const int startX = rand()%GRID_WIDTH;
+	const int startJ = rand()%GRID_LENGTH;
+	const int endX = btMin(GRID_WIDTH-1,startX+rand()%5);
+	const int endJ = btMin(GRID_LENGTH-1,startJ+rand()%5);
+	for (int j=startJ;j<=endJ;j++)
+	{
+		for (int x=startX;x<=endX;x++)
+		{
+			floatHeights[j*GRID_WIDTH+x] = 20.f;
+			charHeights[j*GRID_WIDTH+x] = 250;
+			shortHeights[j*GRID_WIDTH+x] = 2000;
+		}
+	}
+	culled.updateMinMaxPyramid(startX,startJ,endX,endJ);
+	btHeightfieldTerrainShape rebuilt(GRID_WIDTH,GRID_LENGTH,data,heightScale,minHeight,maxHeight,upAxis,dataType,flipQuadEdges);
+	rebuilt.setUseDiamondSubdivision(useDiamondSubdivision);
+	rebuilt.setLocalScaling(scaling);
+	rebuilt.buildMinMaxPyramid();
+	for (int q=0;q<NUM_QUERIES;q++)
+	{
+		const btVector3 center = RandomPoint(terrainMin,terrainMax);
+		const btVector3 halfExtents = RandomPoint(btVector3(0,0,0),btVector3(8,8,8));
+		CollectTriangles updatedTriangles,rebuiltTriangles;
+		culled.processAllTriangles(&updatedTriangles,center-halfExtents,center+halfExtents);
+		rebuilt.processAllTriangles(&rebuiltTriangles,center-halfExtents,center+halfExtents);
+		if (updatedTriangles.m_triangles.size()!=rebuiltTriangles.m_triangles.size())
+		{
+			printf( "heightfield fail: %s query %d, the updated pyramid reports %d triangles, a new one %d\n", title, q,
+				updatedTriangles.m_triangles.size(), rebuiltTriangles.m_triangles.size() );
+			return 1;
+		}
+		for (int i=0;i<updatedTriangles.m_triangles.size();i++)
+		{
+			if (!(updatedTriangles.m_triangles[i]==rebuiltTriangles.m_triangles[i]))
+			{
+				printf( "heightfield fail: %s query %d, the updated pyramid reports another triangle than a new one\n", title, q );
+				return 1;
+			}
+		}
+	}
+
+	vlog( "%-26s triangles per query %7.1f, with the pyramid %7.1f, %3d hits of %d rays, aabb of the ray %8.1f, performRaycast %8.1f\n", title,
+		float(numPlain)/NUM_QUERIES, float(numCulled)/NUM_QUERIES, numHits, NUM_RAYS, TicksToCycles(aabbTime)/NUM_RAYS, TicksToCycles(marchTime)/NUM_RAYS );
+	return 0;
+}
+
+///btCollisionWorld::rayTest has to use the performRaycast of a derived class
+static int TestDerivedTerrain(void)
+{
+	btAlignedObjectArray<float> heights;
+	heights.resize(GRID_WIDTH*GRID_LENGTH,0.f);
+	HoleTerrainShape terrain(&heights[0],1,-1,1,PHY_FLOAT);
+	btCollisionObject object;
+	object.setCollisionShape(&terrain);
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher,&broadphase,&configuration);
+	world.addCollisionObject(&object);
+	world.updateAabbs();
+
+	const btVector3 hole(0,5,0);
+	const btVector3 edge(btScalar(GRID_WIDTH/2-2),5,0);
+	btCollisionWorld::ClosestRayResultCallback holeResult(hole,hole-btVector3(0,10,0));
+	btCollisionWorld::ClosestRayResultCallback edgeResult(edge,edge-btVector3(0,10,0));
+	world.rayTest(holeResult.m_rayFromWorld,holeResult.m_rayToWorld,holeResult);
+	world.rayTest(edgeResult.m_rayFromWorld,edgeResult.m_rayToWorld,edgeResult);
+	world.removeCollisionObject(&object);
+	if (holeResult.hasHit() || !edgeResult.hasHit())
+	{
+		printf( "heightfield fail: a ray through the hole of a derived terrain %s, a ray next to it %s\n",
+			holeResult.hasHit() ? "hits" : "misses", edgeResult.hasHit() ? "hits" : "misses" );
+		return 1;
+	}
+	return 0;
+}
+
+int Test_heightfield(void)
+{
+	static const PHY_ScalarType dataTypes[3] = {PHY_FLOAT,PHY_UCHAR,PHY_SHORT};
+	srand(7);
+	for (int upAxis=0;upAxis<3;upAxis++)
+	{
+		for (int t=0;t<3;t++)
+		{
+			if (TestTerrain(dataTypes[t],upAxis,t==upAxis,t==(upAxis+1)%3))
+				return 1;
+		}
+	}
+	return TestDerivedTerrain();
+}
+#endif
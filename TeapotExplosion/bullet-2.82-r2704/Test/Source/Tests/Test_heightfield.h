@@ -0,0 +1,22 @@
+//
+//  Test_heightfield.h
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+#ifndef BulletTest_Test_heightfield_h
+#define BulletTest_Test_heightfield_h
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+int Test_heightfield(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+    
+#endif
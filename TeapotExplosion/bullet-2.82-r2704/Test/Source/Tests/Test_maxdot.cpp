@@ -19,6 +19,8 @@
 #include <string.h>
 
 #include <LinearMath/btVector3.h>
+#include <LinearMath/btAlignedObjectArray.h>
+#include <BulletCollision/CollisionShapes/btConvexHullSupportMap.h>
 
 
 // reference code for testing purposes
@@ -27,6 +29,8 @@ static long maxdot_ref(    const btSimdFloat4 *vertices,
                 size_t count, 
                 float *dotResult );
 
+static int Test_supportmap(void);
+
 
 
 
@@ -247,6 +251,114 @@ int Test_maxdot(void)
     
     GuardFree(data);
     
+    return Test_supportmap();
+}
+
+
+#define SUPPORT_MAP_DIRECTIONS  64
+
+// btConvexHullSupportMap against maxDot, for hulls where every point is a vertex
+static int Test_supportmap(void)
+{
+    btAlignedObjectArray<btVector3> points;
+    btVector3 directions[SUPPORT_MAP_DIRECTIONS];
+    size_t i, j, k;
+    for( i = 0; i < SUPPORT_MAP_DIRECTIONS; i++ )
+    {
+        directions[i].setValue( RANDF_m1p1, RANDF_m1p1, RANDF_m1p1 );
+        directions[i][3] = 0.f;
+    }
+    
+    uint64_t scalarTimes[MAX_LOG2_SIZE+1];
+    uint64_t mapTimes[MAX_LOG2_SIZE+1];
+    int numVertices[MAX_LOG2_SIZE+1];
+    size_t size, index = 0;
+    long test = 0, correct = 0;
+    for( size = 16; size <= MAX_SIZE; size *= 2, index++ )
+    {
+        points.resize( (int) size );
+        for( i = 0; i < size; i++ )
+        {
+            btVector3 p( RANDF_m1p1, RANDF_m1p1, RANDF_m1p1 );
+            if( p.length2() < 1e-6f )
+                p.setValue( 1.f, 0.f, 0.f );
+            points[(int) i] = p.normalized() * btVector3( 1.f, 0.7f, 0.4f );
+        }
+        
+        btConvexHullSupportMap supportMap;
+        if( !supportMap.build( &points[0], (int) size ) )
+        {
+            vlog( "Error @ %ld: support map not built\n", size );
+            return 1;
+        }
+        numVertices[index] = supportMap.getNumVertices();
+        
+        for( i = 0; i < SUPPORT_MAP_DIRECTIONS; i++ )
+        {
+            float correctDot, testDot;
+            correct = directions[i].maxDot( &points[0], size, correctDot );
+            test = supportMap.getSupportingPointIndex( directions[i], testDot );
+            if( test < 0 || test >= (long) size )
+            {
+                vlog( "Error @ %ld: support map index out of bounds! *%ld vs %ld \n", size, correct, test );
+                return 1;
+            }
+            float relativeError = btFabs( (points[(int) test].dot( directions[i] ) - correctDot) / correctDot );
+            if( relativeError > 1e-6f )
+            {
+                vlog( "Error @ %ld: support map misses the supporting point! *%ld vs %ld  (*%f, %f)\n", size, correct, test,
+                       correctDot, testDot );
+                return 1;
+            }
+        }
+        
+        uint64_t startTime, bestTime, currentTime;
+        float dot;
+        bestTime = -1LL;
+        scalarTimes[index] = 0;
+        for( j = 0; j < 100; j++ )
+        {
+            startTime = ReadTicks();
+            for( k = 0; k < SUPPORT_MAP_DIRECTIONS; k++ )
+                correct += directions[k].maxDot( &points[0], size, dot );
+            currentTime = ReadTicks() - startTime;
+            scalarTimes[index] += currentTime;
+            if( currentTime < bestTime )
+                bestTime = currentTime;
+        }
+        if( 0 == gReportAverageTimes )
+            scalarTimes[index] = bestTime;
+        else
+            scalarTimes[index] /= 100;
+        
+        bestTime = -1LL;
+        mapTimes[index] = 0;
+        for( j = 0; j < 100; j++ )
+        {
+            startTime = ReadTicks();
+            for( k = 0; k < SUPPORT_MAP_DIRECTIONS; k++ )
+                test += supportMap.getSupportingPointIndex( directions[k], dot );
+            currentTime = ReadTicks() - startTime;
+            mapTimes[index] += currentTime;
+            if( currentTime < bestTime )
+                bestTime = currentTime;
+        }
+        if( 0 == gReportAverageTimes )
+            mapTimes[index] = bestTime;
+        else
+            mapTimes[index] /= 100;
+    }
+    
+    vlog( "Support map timing:\n" );
+    vlog( " size\t  vertices\t    maxDot\t  support map\n" );
+    index = 0;
+    for( size = 16; size <= MAX_SIZE; size *= 2, index++ )
+        vlog( "%5lu\t%10d\t%10.2f\t%10.2f\n", size, numVertices[index], TicksToCycles( scalarTimes[index] ) / SUPPORT_MAP_DIRECTIONS, TicksToCycles( mapTimes[index] ) / SUPPORT_MAP_DIRECTIONS );
+    
+    // keep the timing loops from being optimized away
+    volatile long sink = test + correct;
+    (void) sink;
+    
     return 0;
 }
 
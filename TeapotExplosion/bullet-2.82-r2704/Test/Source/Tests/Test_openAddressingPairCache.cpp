@@ -0,0 +1,400 @@
+//
+//  Test_openAddressingPairCache.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_openAddressingPairCache.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/BroadphaseCollision/btOpenAddressingPairCache.h>
+
+extern int gOverlappingPairs;
+
+#define NUM_PROXIES 400
+#define NUM_GROWTH_PAIRS 3000
+#define NUM_CHURN_PAIRS 300
+#define NUM_CHURN_LOOPS 20000
+#define NUM_OPERATIONS 3000
+#define MAX_BATCH 64
+#define NUM_BROADPHASE_PROXIES 1500
+#define NUM_BROADPHASE_STEPS 30
+#define WORLD_SIZE 50
+
+namespace
+{
+
+btScalar RandomScalar(btScalar range)
+{
+	return range*btScalar(rand())/btScalar(RAND_MAX);
+}
+
+void RandomAabb(btVector3& aabbMin,btVector3& aabbMax)
+{
+	aabbMin.setValue(RandomScalar(WORLD_SIZE),RandomScalar(WORLD_SIZE),RandomScalar(WORLD_SIZE));
+	aabbMax = aabbMin+btVector3(1+RandomScalar(3),1+RandomScalar(3),1+RandomScalar(3));
+}
+
+///proxies with unique ids from 1, with filters every seventh one only overlaps proxies of group 2
+void CreateProxies(btAlignedObjectArray<btBroadphaseProxy>& proxies,bool withFilters)
+{
+	proxies.resize(NUM_PROXIES);
+	for (int i=0;i<NUM_PROXIES;i++)
+	{
+		const bool filtered = withFilters && (i%7)==6;
+		proxies[i] = btBroadphaseProxy(btVector3(0,0,0),btVector3(1,1,1),0,short(filtered ? 2 : 1),short(filtered ? 2 : -1));
+		proxies[i].m_uniqueId = i+1;
+	}
+}
+
+///pair i of the even and odd proxies, there are (NUM_PROXIES/2)^2 of them
+void GetPair(btAlignedObjectArray<btBroadphaseProxy>& proxies,int i,btBroadphaseProxy*& proxy0,btBroadphaseProxy*& proxy1)
+{
+	proxy0 = &proxies[i%(NUM_PROXIES/2)*2];
+	proxy1 = &proxies[i/(NUM_PROXIES/2)*2+1];
+}
+
+///the smallest table that holds numPairs pairs in half of the 7/8 of its slots that may be used
+int ExpectedNumSlots(int numPairs)
+{
+	int numSlots = BT_PAIR_GROUP_SIZE;
+	while ((numSlots/8)*7 < 2*numPairs)
+	{
+		numSlots *= 2;
+	}
+	return numSlots;
+}
+
+///the same pairs, with the same proxies first, in the same order
+bool SamePairs(const btOverlappingPairCache* expected,const btOverlappingPairCache* cache,const char* operation,int i)
+{
+	const btBroadphasePair* expectedPairs = expected->getNumOverlappingPairs() ? expected->getOverlappingPairArrayPtr() : 0;
+	const btBroadphasePair* pairs = cache->getNumOverlappingPairs() ? cache->getOverlappingPairArrayPtr() : 0;
+	if (expected->getNumOverlappingPairs()!=cache->getNumOverlappingPairs())
+	{
+		printf( "openAddressingPairCache fail: %s %d leaves %d pairs, %d in btHashedOverlappingPairCache\n", operation, i,
+			cache->getNumOverlappingPairs(), expected->getNumOverlappingPairs() );
+		return false;
+	}
+	for (int j=0;j<cache->getNumOverlappingPairs();j++)
+	{
+		if (expectedPairs[j].m_pProxy0->m_uniqueId!=pairs[j].m_pProxy0->m_uniqueId || expectedPairs[j].m_pProxy1->m_uniqueId!=pairs[j].m_pProxy1->m_uniqueId)
+		{
+			printf( "openAddressingPairCache fail: %s %d leaves pair %d (%d,%d), (%d,%d) in btHashedOverlappingPairCache\n", operation, i, j,
+				pairs[j].m_pProxy0->m_uniqueId, pairs[j].m_pProxy1->m_uniqueId, expectedPairs[j].m_pProxy0->m_uniqueId, expectedPairs[j].m_pProxy1->m_uniqueId );
+			return false;
+		}
+	}
+	return true;
+}
+
+///every pair of the array is found at its own place
+bool FindsAllPairs(btOpenAddressingPairCache& cache,const char* operation,int i)
+{
+	btBroadphasePairArray& pairs = cache.getOverlappingPairArray();
+	for (int j=0;j<pairs.size();j++)
+	{
+		if (cache.findPair(pairs[j].m_pProxy1,pairs[j].m_pProxy0)!=&pairs[j])
+		{
+			printf( "openAddressingPairCache fail: %s %d loses pair %d (%d,%d)\n", operation, i, j, pairs[j].m_pProxy0->m_uniqueId, pairs[j].m_pProxy1->m_uniqueId );
+			return false;
+		}
+	}
+	return true;
+}
+
+int TestAddFindRemove(btAlignedObjectArray<btBroadphaseProxy>& proxies)
+{
+	btOpenAddressingPairCache cache;
+	btBroadphaseProxy* a = &proxies[3];
+	btBroadphaseProxy* b = &proxies[1];
+	btBroadphaseProxy* c = &proxies[2];
+	btBroadphasePair* ab = cache.addOverlappingPair(a,b);
+	if (!ab || ab->m_pProxy0!=b || ab->m_pProxy1!=a || cache.getNumOverlappingPairs()!=1)
+	{
+		printf( "openAddressingPairCache fail: the first pair isn't added with the smaller id first\n" );
+		return 1;
+	}
+	if (cache.addOverlappingPair(b,a)!=ab || cache.getNumOverlappingPairs()!=1)
+	{
+		printf( "openAddressingPairCache fail: adding a pair again doesn't return the pair\n" );
+		return 1;
+	}
+	if (cache.addOverlappingPair(a,&proxies[6]) || cache.getNumOverlappingPairs()!=1)
+	{
+		printf( "openAddressingPairCache fail: a pair rejected by the filter is added\n" );
+		return 1;
+	}
+	btBroadphasePair* bc = cache.addOverlappingPair(b,c);
+	if (cache.findPair(a,b)!=ab || cache.findPair(c,b)!=bc || cache.findPair(a,c))
+	{
+		printf( "openAddressingPairCache fail: findPair doesn't find the pairs\n" );
+		return 1;
+	}
+	ab->m_internalInfo1 = a;
+	if (cache.removeOverlappingPair(b,a,0)!=a || cache.findPair(a,b) || cache.getNumOverlappingPairs()!=1)
+	{
+		printf( "openAddressingPairCache fail: removeOverlappingPair doesn't remove the pair\n" );
+		return 1;
+	}
+	//the last pair moved into the hole
+	if (cache.findPair(b,c)!=&cache.getOverlappingPairArray()[0] || cache.removeOverlappingPair(a,b,0))
+	{
+		printf( "openAddressingPairCache fail: the pairs don't survive the removal\n" );
+		return 1;
+	}
+	return 0;
+}
+
+///only additions, the table grows when they used up 7/8 of its slots
+int TestGrowth(btAlignedObjectArray<btBroadphaseProxy>& proxies)
+{
+	btOpenAddressingPairCache cache;
+	if (cache.getNumSlots()!=BT_PAIR_GROUP_SIZE)
+	{
+		printf( "openAddressingPairCache fail: an empty cache has %d slots\n", cache.getNumSlots() );
+		return 1;
+	}
+	int numGrowths = 0;
+	for (int i=0;i<NUM_GROWTH_PAIRS;i++)
+	{
+		const int numSlots = cache.getNumSlots();
+		const int numPairs = cache.getNumOverlappingPairs();
+		btBroadphaseProxy* proxy0;
+		btBroadphaseProxy* proxy1;
+		GetPair(proxies,i,proxy0,proxy1);
+		cache.addOverlappingPair(proxy0,proxy1);
+		const int expectedNumSlots = numPairs==(numSlots/8)*7 ? ExpectedNumSlots(numPairs+1) : numSlots;
+		if (cache.getNumOverlappingPairs()!=numPairs+1 || cache.getNumSlots()!=expectedNumSlots)
+		{
+			printf( "openAddressingPairCache fail: pair %d grows %d slots to %d, expected %d\n", i, numSlots, cache.getNumSlots(), expectedNumSlots );
+			return 1;
+		}
+		numGrowths += cache.getNumSlots()!=numSlots ? 1 : 0;
+	}
+	if (numGrowths<4 || !FindsAllPairs(cache,"growth",NUM_GROWTH_PAIRS))
+	{
+		printf( "openAddressingPairCache fail: %d growths\n", numGrowths );
+		return 1;
+	}
+	return 0;
+}
+
+///removals leave deleted slots behind in full groups, new pairs have to reuse them instead of growing the table
+int TestTombstones(btAlignedObjectArray<btBroadphaseProxy>& proxies)
+{
+	btOpenAddressingPairCache cache;
+	btAlignedObjectArray<int> live;
+	int next = 0;
+	btBroadphaseProxy* proxy0;
+	btBroadphaseProxy* proxy1;
+	for (;next<NUM_CHURN_PAIRS;next++)
+	{
+		GetPair(proxies,next,proxy0,proxy1);
+		cache.addOverlappingPair(proxy0,proxy1);
+		live.push_back(next);
+	}
+	const int maxNumSlots = ExpectedNumSlots(NUM_CHURN_PAIRS+1);
+	for (int i=0;i<NUM_CHURN_LOOPS;i++)
+	{
+		const int victim = rand()%live.size();
+		const int removed = live[victim];
+		GetPair(proxies,removed,proxy0,proxy1);
+		cache.removeOverlappingPair(proxy0,proxy1,0);
+		if (cache.findPair(proxy0,proxy1))
+		{
+			printf( "openAddressingPairCache fail: churn %d finds the removed pair\n", i );
+			return 1;
+		}
+		//every other loop adds the pair again, into its own deleted slot or an earlier one
+		const int added = (i&1) ? removed : next++;
+		GetPair(proxies,added,proxy0,proxy1);
+		cache.addOverlappingPair(proxy0,proxy1);
+		live[victim] = added;
+		if (cache.getNumOverlappingPairs()!=NUM_CHURN_PAIRS || cache.getNumSlots()>maxNumSlots)
+		{
+			printf( "openAddressingPairCache fail: churn %d has %d pairs in %d slots, at most %d slots\n", i, cache.getNumOverlappingPairs(), cache.getNumSlots(), maxNumSlots );
+			return 1;
+		}
+		if ((i%500)==0 && !FindsAllPairs(cache,"churn",i))
+		{
+			return 1;
+		}
+	}
+	return FindsAllPairs(cache,"churn",NUM_CHURN_LOOPS) ? 0 : 1;
+}
+
+///removes the pairs of every fifth proxy
+struct RemoveSomePairsCallback : public btOverlapCallback
+{
+	virtual bool processOverlap(btBroadphasePair& pair)
+	{
+		return (pair.m_pProxy0->m_uniqueId%5)==0;
+	}
+};
+
+///the same operations on both caches, which have to end up with the same pairs in the same order and count them alike
+int TestSameOrder(btAlignedObjectArray<btBroadphaseProxy>& proxies)
+{
+	btHashedOverlappingPairCache expected;
+	btOpenAddressingPairCache cache;
+	btAlignedObjectArray<btBroadphaseProxy*> batch;
+	static const char* operationNames[] = { "add", "remove", "addBatch", "removeBatch", "removeContainingProxy", "processAll", "sort" };
+	for (int i=0;i<NUM_OPERATIONS;i++)
+	{
+		const int operation = rand()%100<40 ? 0 : rand()%100<50 ? 1 : 2+rand()%(i%100==99 ? 5 : 3);
+		batch.resize(0);
+		const int batchSize = operation<2 ? 1 : 1+rand()%MAX_BATCH;
+		for (int j=0;j<batchSize;j++)
+		{
+			//removals mostly pick existing pairs
+			const btBroadphasePairArray& pairs = expected.getOverlappingPairArray();
+			if ((operation==1 || operation==3) && pairs.size() && rand()%4)
+			{
+				const btBroadphasePair& pair = pairs[rand()%pairs.size()];
+				batch.push_back(rand()&1 ? pair.m_pProxy0 : pair.m_pProxy1);
+				batch.push_back(batch[batch.size()-1]==pair.m_pProxy0 ? pair.m_pProxy1 : pair.m_pProxy0);
+			} else
+			{
+				const int proxy0 = rand()%(NUM_PROXIES/4);
+				const int proxy1 = (proxy0+1+rand()%(NUM_PROXIES/4-1))%(NUM_PROXIES/4);
+				batch.push_back(&proxies[proxy0]);
+				batch.push_back(&proxies[proxy1]);
+			}
+		}
+
+		int expectedDelta = gOverlappingPairs;
+		int delta = 0;
+		for (int c=0;c<2;c++)
+		{
+			btOverlappingPairCache* target = c ? (btOverlappingPairCache*)&cache : (btOverlappingPairCache*)&expected;
+			const int overlappingPairs = gOverlappingPairs;
+			switch (operation)
+			{
+			case 0:
+				target->addOverlappingPair(batch[0],batch[1]);
+				break;
+			case 1:
+				target->removeOverlappingPair(batch[0],batch[1],0);
+				break;
+			case 2:
+				target->addOverlappingPairs(&batch[0],batchSize);
+				break;
+			case 3:
+				target->removeOverlappingPairs(&batch[0],batchSize,0);
+				break;
+			case 4:
+				target->removeOverlappingPairsContainingProxy(batch[0],0);
+				break;
+			case 5:
+				{
+					RemoveSomePairsCallback callback;
+					target->processAllOverlappingPairs(&callback,0);
+				}
+				break;
+			default:
+				target->sortOverlappingPairs(0);
+				break;
+			}
+			if (c)
+			{
+				delta = gOverlappingPairs-overlappingPairs;
+			} else
+			{
+				expectedDelta = gOverlappingPairs-overlappingPairs;
+			}
+		}
+		if (!SamePairs(&expected,&cache,operationNames[operation],i) || !FindsAllPairs(cache,operationNames[operation],i))
+		{
+			return 1;
+		}
+		if (delta!=expectedDelta)
+		{
+			printf( "openAddressingPairCache fail: %s %d changes gOverlappingPairs by %d, %d in btHashedOverlappingPairCache\n", operationNames[operation], i, delta, expectedDelta );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+///btDbvtBroadphase hands its pairs over in batches, the pair order has to be the one of btHashedOverlappingPairCache
+int TestBroadphaseOrder()
+{
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	btHashedOverlappingPairCache expectedCache;
+	btOpenAddressingPairCache cache;
+	btDbvtBroadphase expected(&expectedCache);
+	btDbvtBroadphase broadphase(&cache);
+	btAlignedObjectArray<btBroadphaseProxy*> expectedProxies;
+	btAlignedObjectArray<btBroadphaseProxy*> proxies;
+	for (int i=0;i<NUM_BROADPHASE_PROXIES;i++)
+	{
+		btVector3 aabbMin,aabbMax;
+		RandomAabb(aabbMin,aabbMax);
+		expectedProxies.push_back(expected.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0));
+		proxies.push_back(broadphase.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0));
+	}
+	int result = 0;
+	for (int step=0;step<NUM_BROADPHASE_STEPS && !result;step++)
+	{
+		for (int i=0;i<NUM_BROADPHASE_PROXIES;i+=4)
+		{
+			const int proxy = (i+step)%NUM_BROADPHASE_PROXIES;
+			btVector3 aabbMin,aabbMax;
+			RandomAabb(aabbMin,aabbMax);
+			expected.setAabb(expectedProxies[proxy],aabbMin,aabbMax,&dispatcher);
+			broadphase.setAabb(proxies[proxy],aabbMin,aabbMax,&dispatcher);
+		}
+		//a proxy goes away and comes back, which removes the pairs containing it
+		const int replaced = rand()%NUM_BROADPHASE_PROXIES;
+		btVector3 aabbMin,aabbMax;
+		RandomAabb(aabbMin,aabbMax);
+		expected.destroyProxy(expectedProxies[replaced],&dispatcher);
+		broadphase.destroyProxy(proxies[replaced],&dispatcher);
+		expectedProxies[replaced] = expected.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0);
+		proxies[replaced] = broadphase.createProxy(aabbMin,aabbMax,BOX_SHAPE_PROXYTYPE,0,1,-1,&dispatcher,0);
+
+		expected.calculateOverlappingPairs(&dispatcher);
+		broadphase.calculateOverlappingPairs(&dispatcher);
+		if (!SamePairs(&expectedCache,&cache,"broadphase step",step) || !FindsAllPairs(cache,"broadphase step",step))
+		{
+			result = 1;
+		}
+	}
+	vlog( "openAddressingPairCache broadphase with %d proxies has %d pairs in %d slots\n", NUM_BROADPHASE_PROXIES, cache.getNumOverlappingPairs(), cache.getNumSlots() );
+	for (int i=0;i<NUM_BROADPHASE_PROXIES;i++)
+	{
+		expected.destroyProxy(expectedProxies[i],&dispatcher);
+		broadphase.destroyProxy(proxies[i],&dispatcher);
+	}
+	return result;
+}
+
+}
+
+int Test_openAddressingPairCache(void)
+{
+	srand(5);
+	btAlignedObjectArray<btBroadphaseProxy> proxies;
+	btAlignedObjectArray<btBroadphaseProxy> filteredProxies;
+	CreateProxies(proxies,false);
+	CreateProxies(filteredProxies,true);
+	if (TestAddFindRemove(filteredProxies) || TestGrowth(proxies) || TestTombstones(proxies) || TestSameOrder(filteredProxies) || TestBroadphaseOrder())
+	{
+		return 1;
+	}
+	return 0;
+}
+#endif
@@ -0,0 +1,22 @@
+//
+//  Test_openAddressingPairCache.h
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+#ifndef BulletTest_Test_openAddressingPairCache_h
+#define BulletTest_Test_openAddressingPairCache_h
+
+#ifdef __cplusplus
+extern "C" { 
+#endif
+
+int Test_openAddressingPairCache(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+    
+#endif
@@ -0,0 +1,269 @@
+//
+//  Test_parallelBatches.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_parallelBatches.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletDynamicsCommon.h>
+#include <LinearMath/btThreads.h>
+
+#define WALL_WIDTH 8
+#define WALL_HEIGHT 5
+#define WALL_STEPS 300
+#define NUM_THREADS 4
+
+namespace
+{
+
+///checks after every setup that the batches hold every row once and no two rows of a batch share a dynamic body
+class BatchCheckingSolver : public btSequentialImpulseConstraintSolver
+{
+	btAlignedObjectArray<int>	m_bodyBatch;
+
+	bool CheckBatches(const btConstraintArray& rows,const btAlignedObjectArray<int>& order,const btAlignedObjectArray<int>& batchOffsets)
+	{
+		if (!batchOffsets.size() || batchOffsets[0]!=0 || batchOffsets[batchOffsets.size()-1]!=rows.size() || order.size()<rows.size())
+		{
+			printf( "parallelBatches fail: %d batches end at %d, %d rows\n", batchOffsets.size()-1,
+				batchOffsets.size() ? batchOffsets[batchOffsets.size()-1] : -1, rows.size() );
+			return false;
+		}
+		btAlignedObjectArray<bool> seen;
+		seen.resize(rows.size(),false);
+		m_bodyBatch.resize(0);
+		m_bodyBatch.resize(m_tmpSolverBodyPool.size(),-1);
+		for (int b=0;b+1<batchOffsets.size();b++)
+		{
+			for (int i=batchOffsets[b];i<batchOffsets[b+1];i++)
+			{
+				const int row = order[i];
+				if (row<0 || row>=rows.size() || seen[row])
+				{
+					printf( "parallelBatches fail: row %d is in batch %d twice or is out of range\n", row, b );
+					return false;
+				}
+				seen[row] = true;
+				const int bodies[2] = { rows[row].m_solverBodyIdA, rows[row].m_solverBodyIdB };
+				for (int k=0;k<2;k++)
+				{
+					if (!m_batchBodyIsDynamic[bodies[k]])
+						continue;
+					if (m_bodyBatch[bodies[k]]==b)
+					{
+						printf( "parallelBatches fail: two rows of batch %d share solver body %d\n", b, bodies[k] );
+						return false;
+					}
+					m_bodyBatch[bodies[k]] = b;
+				}
+			}
+		}
+		return true;
+	}
+
+protected:
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
+	{
+		btScalar result = btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(bodies,numBodies,manifoldPtr,numManifolds,constraints,numConstraints,infoGlobal,debugDrawer);
+		if (m_useParallelBatches && !m_failed)
+		{
+			m_numBatchedGroups++;
+			m_maxNumBatches = btMax(m_maxNumBatches,m_contactBatchOffsets.size()-1);
+			m_failed = !CheckBatches(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactBatchOffsets);
+			if (!m_failed && !(infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS))
+			{
+				m_failed = !CheckBatches(m_tmpSolverContactFrictionConstraintPool,m_orderFrictionConstraintPool,m_frictionBatchOffsets);
+			}
+		}
+		return result;
+	}
+
+public:
+	bool	m_failed;
+	int		m_numBatchedGroups;
+	int		m_maxNumBatches;
+
+	BatchCheckingSolver()
+	:m_failed(false),
+	m_numBatchedGroups(0),
+	m_maxNumBatches(0)
+	{
+	}
+};
+
+struct WallResult
+{
+	btAlignedObjectArray<btTransform>	m_transforms;
+	btAlignedObjectArray<btVector3>		m_velocities;
+	btScalar	m_maxVelocity;
+	btScalar	m_maxDrop;
+	bool		m_failed;
+	int			m_numBatchedGroups;
+	int			m_maxNumBatches;
+	uint64_t	m_time;
+};
+
+//a wall of unit boxes, each touching its neighbours on all sides, resting on a ground box
+void RunWall(int solverMode,btITaskScheduler* scheduler,WallResult& result)
+{
+	btITaskScheduler* previousScheduler = btGetTaskScheduler();
+	btSetTaskScheduler(scheduler);
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	BatchCheckingSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+	world.getSolverInfo().m_solverMode = solverMode;
+
+	btBoxShape groundShape(btVector3(50,1,50));
+	btRigidBody ground(0,0,&groundShape);
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(btVector3(0,-1,0));
+	ground.setWorldTransform(transform);
+	world.addRigidBody(&ground);
+
+	btBoxShape boxShape(btVector3(btScalar(0.5),btScalar(0.5),btScalar(0.5)));
+	btVector3 inertia;
+	boxShape.calculateLocalInertia(1,inertia);
+
+	btAlignedObjectArray<btRigidBody*> bodies;
+	for (int i=0;i<WALL_WIDTH;i++)
+	{
+		for (int j=0;j<WALL_WIDTH;j++)
+		{
+			for (int k=0;k<WALL_HEIGHT;k++)
+			{
+				btRigidBody* body = new btRigidBody(1,0,&boxShape,inertia);
+				transform.setOrigin(btVector3(btScalar(i-WALL_WIDTH/2),btScalar(0.5+k),btScalar(j-WALL_WIDTH/2)));
+				body->setWorldTransform(transform);
+				body->setActivationState(DISABLE_DEACTIVATION);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	uint64_t startTime = ReadTicks();
+	for (int s=0;s<WALL_STEPS;s++)
+	{
+		world.stepSimulation(btScalar(1./60.),0);
+	}
+	result.m_time = ReadTicks() - startTime;
+	result.m_failed = solver.m_failed;
+	result.m_numBatchedGroups = solver.m_numBatchedGroups;
+	result.m_maxNumBatches = solver.m_maxNumBatches;
+
+	result.m_transforms.resize(0);
+	result.m_velocities.resize(0);
+	result.m_maxVelocity = 0;
+	result.m_maxDrop = 0;
+	for (int i=0;i<bodies.size();i++)
+	{
+		const int level = i%WALL_HEIGHT;
+		result.m_transforms.push_back(bodies[i]->getWorldTransform());
+		result.m_velocities.push_back(bodies[i]->getLinearVelocity());
+		result.m_velocities.push_back(bodies[i]->getAngularVelocity());
+		result.m_maxVelocity = btMax(result.m_maxVelocity,bodies[i]->getLinearVelocity().length());
+		result.m_maxDrop = btMax(result.m_maxDrop,btFabs(bodies[i]->getWorldTransform().getOrigin().y()-btScalar(0.5+level)));
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	world.removeRigidBody(&ground);
+	btSetTaskScheduler(previousScheduler);
+}
+
+bool SameVector(const btVector3& a,const btVector3& b)
+{
+	return a.x()==b.x() && a.y()==b.y() && a.z()==b.z();
+}
+
+///the batched solve does not depend on the number of threads, bit for bit
+bool SameWall(const WallResult& a,const WallResult& b,const char* mode)
+{
+	for (int i=0;i<a.m_transforms.size();i++)
+	{
+		const btTransform& ta = a.m_transforms[i];
+		const btTransform& tb = b.m_transforms[i];
+		if (!SameVector(ta.getOrigin(),tb.getOrigin()) || !SameVector(ta.getBasis()[0],tb.getBasis()[0]) ||
+			!SameVector(ta.getBasis()[1],tb.getBasis()[1]) || !SameVector(ta.getBasis()[2],tb.getBasis()[2]) ||
+			!SameVector(a.m_velocities[i*2],b.m_velocities[i*2]) || !SameVector(a.m_velocities[i*2+1],b.m_velocities[i*2+1]))
+		{
+			printf( "parallelBatches fail: %s box %d at (%f,%f,%f) with one thread, (%f,%f,%f) with %d\n", mode, i,
+				ta.getOrigin().x(), ta.getOrigin().y(), ta.getOrigin().z(), tb.getOrigin().x(), tb.getOrigin().y(), tb.getOrigin().z(), NUM_THREADS );
+			return false;
+		}
+	}
+	return true;
+}
+
+}
+
+int Test_parallelBatches(void)
+{
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	//several threads even on a single core, so the batches run on several threads
+	scheduler->setNumThreads(NUM_THREADS);
+
+	static const struct
+	{
+		const char*	m_name;
+		int			m_solverMode;
+	} modes[] =
+	{
+		{ "separate", SOLVER_USE_WARMSTARTING | SOLVER_SIMD },
+		{ "interleaved", SOLVER_USE_WARMSTARTING | SOLVER_SIMD | SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS | SOLVER_USE_2_FRICTION_DIRECTIONS },
+	};
+
+	int result = 0;
+	for (int m=0;m<int(sizeof(modes)/sizeof(modes[0])) && !result;m++)
+	{
+		WallResult serial;
+		WallResult batched;
+		WallResult threaded;
+		RunWall(modes[m].m_solverMode,btGetSequentialTaskScheduler(),serial);
+		RunWall(modes[m].m_solverMode | SOLVER_PARALLEL_BATCHES,btGetSequentialTaskScheduler(),batched);
+		RunWall(modes[m].m_solverMode | SOLVER_PARALLEL_BATCHES,scheduler,threaded);
+
+		vlog( "parallelBatches %s, %d boxes, %d steps, up to %d batches:\n", modes[m].m_name, WALL_WIDTH*WALL_WIDTH*WALL_HEIGHT, WALL_STEPS, threaded.m_maxNumBatches );
+		vlog( "        \t  max velocity\t  max drop\t    time\n" );
+		vlog( "serial  \t%14.5f\t%10.5f\t%10.1f\n", serial.m_maxVelocity, serial.m_maxDrop, TicksToCycles( serial.m_time ) / WALL_STEPS );
+		vlog( "batched \t%14.5f\t%10.5f\t%10.1f\n", batched.m_maxVelocity, batched.m_maxDrop, TicksToCycles( batched.m_time ) / WALL_STEPS );
+		vlog( "threaded\t%14.5f\t%10.5f\t%10.1f\n", threaded.m_maxVelocity, threaded.m_maxDrop, TicksToCycles( threaded.m_time ) / WALL_STEPS );
+
+		if (serial.m_numBatchedGroups || !batched.m_numBatchedGroups || !threaded.m_numBatchedGroups || threaded.m_maxNumBatches<2)
+		{
+			printf( "parallelBatches fail: %s batched %d, %d and %d groups, up to %d batches\n", modes[m].m_name,
+				serial.m_numBatchedGroups, batched.m_numBatchedGroups, threaded.m_numBatchedGroups, threaded.m_maxNumBatches );
+			result = 1;
+		}
+		else if (batched.m_failed || threaded.m_failed || !SameWall(batched,threaded,modes[m].m_name))
+		{
+			result = 1;
+		}
+		//the rows of a batch come in another order and converge a little slower, the wall still stays at rest
+		else if (batched.m_maxVelocity > btMax(serial.m_maxVelocity*btScalar(3.),btScalar(0.1)) || batched.m_maxDrop > btMax(serial.m_maxDrop*btScalar(1.5),btScalar(0.01)))
+		{
+			printf( "parallelBatches fail: %s max velocity %f and drop %f, %f and %f with the serial rows\n", modes[m].m_name,
+				batched.m_maxVelocity, batched.m_maxDrop, serial.m_maxVelocity, serial.m_maxDrop );
+			result = 1;
+		}
+	}
+
+	delete scheduler;
+	return result;
+}
+#endif
@@ -0,0 +1,335 @@
+//
+//  Test_polyhedralClipping.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_polyhedralClipping.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+#include <float.h>
+
+#include <BulletCollision/CollisionShapes/btBoxShape.h>
+#include <BulletCollision/CollisionShapes/btConvexHullShape.h>
+#include <BulletCollision/CollisionShapes/btConvexPolyhedron.h>
+#include <BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h>
+
+#define BOX_PAIRS 256
+#define BOX_CYCLES 100
+#define HULL_PAIRS 64
+#define HULL_CYCLES 10
+#define HULL_POINTS 60
+
+struct ContactCounter : public btDiscreteCollisionDetectorInterface::Result
+{
+	int			m_count;
+	btScalar	m_depthSum;
+
+	ContactCounter()
+	:m_count(0),
+	m_depthSum(0)
+	{
+	}
+	virtual void setShapeIdentifiersA(int partId0,int index0) {}
+	virtual void setShapeIdentifiersB(int partId1,int index1) {}
+	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth)
+	{
+		m_count++;
+		m_depthSum += depth;
+	}
+};
+
+// reference code for testing purposes, the separating axis test projecting with btConvexPolyhedron::project
+static bool TestSepAxis_ref(const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA, const btTransform& transB, const btVector3& axis, btScalar& depth)
+{
+	btScalar Min0,Max0,Min1,Max1;
+	btVector3 witnessMin,witnessMax;
+	hullA.project(transA,axis,Min0,Max0,witnessMin,witnessMax);
+	hullB.project(transB,axis,Min1,Max1,witnessMin,witnessMax);
+	if(Max0<Min1 || Max1<Min0)
+		return false;
+	const btScalar d0 = Max0 - Min1;
+	const btScalar d1 = Max1 - Min0;
+	depth = d0<d1 ? d0 : d1;
+	return true;
+}
+
+static btScalar InternalObjectsRadius_ref(const btTransform& trans, const btConvexPolyhedron& convex, const btVector3& axis)
+{
+	const btVector3 localAxis = axis*trans.getBasis();
+	btScalar radius = 0;
+	for (int k=0;k<3;k++)
+	{
+		radius += btFabs(localAxis[k])*convex.m_extents[k];
+	}
+	return radius>convex.m_radius ? radius : convex.m_radius;
+}
+
+static void TestAxis_ref(const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA, const btTransform& transB, const btVector3& deltaC, btVector3 axis, btScalar& dmin, btVector3& sep, bool& separated)
+{
+	if (separated)
+		return;
+	if (deltaC.dot(axis)<0)
+		axis *= -1.f;
+	const btScalar dp = deltaC.dot(axis);
+	const btScalar radius = InternalObjectsRadius_ref(transA,hullA,axis) + InternalObjectsRadius_ref(transB,hullB,axis);
+	if (btMin(radius+dp,radius-dp)>dmin)
+		return;
+	btScalar depth;
+	if (!TestSepAxis_ref(hullA,hullB,transA,transB,axis,depth))
+	{
+		separated = true;
+		return;
+	}
+	if (depth<dmin)
+	{
+		dmin = depth;
+		sep = axis;
+	}
+}
+
+static bool findSeparatingAxis_ref(const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA, const btTransform& transB, btVector3& sep)
+{
+	const btVector3 deltaC = transA*hullA.m_localCenter - transB*hullB.m_localCenter;
+	btScalar dmin = FLT_MAX;
+	bool separated = false;
+	for (int i=0;i<hullA.m_faces.size();i++)
+	{
+		const btFace& face = hullA.m_faces[i];
+		TestAxis_ref(hullA,hullB,transA,transB,deltaC,transA.getBasis()*btVector3(face.m_plane[0],face.m_plane[1],face.m_plane[2]),dmin,sep,separated);
+	}
+	for (int i=0;i<hullB.m_faces.size();i++)
+	{
+		const btFace& face = hullB.m_faces[i];
+		TestAxis_ref(hullA,hullB,transA,transB,deltaC,transB.getBasis()*btVector3(face.m_plane[0],face.m_plane[1],face.m_plane[2]),dmin,sep,separated);
+	}
+	for (int e0=0;e0<hullA.m_uniqueEdges.size();e0++)
+	{
+		const btVector3 worldEdge0 = transA.getBasis()*hullA.m_uniqueEdges[e0];
+		for (int e1=0;e1<hullB.m_uniqueEdges.size();e1++)
+		{
+			const btVector3 cross = worldEdge0.cross(transB.getBasis()*hullB.m_uniqueEdges[e1]);
+			if (btFabs(cross.x())>1e-6 || btFabs(cross.y())>1e-6 || btFabs(cross.z())>1e-6)
+				TestAxis_ref(hullA,hullB,transA,transB,deltaC,cross.normalized(),dmin,sep,separated);
+		}
+	}
+	if (deltaC.dot(sep)<0)
+		sep = -sep;
+	return !separated;
+}
+
+static btTransform randomTransform(btScalar range)
+{
+	btQuaternion rotation((float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f);
+	rotation.normalize();
+	btVector3 origin(range * ((float)rand() / (float)RAND_MAX - 0.5f), range * ((float)rand() / (float)RAND_MAX - 0.5f), range * ((float)rand() / (float)RAND_MAX - 0.5f));
+	return btTransform(rotation,origin);
+}
+
+static int TestPairs(const char* name, const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, btScalar range, int numPairs, int numCycles)
+{
+	btAlignedObjectArray<btTransform> transA;
+	btAlignedObjectArray<btTransform> transB;
+	btAlignedObjectArray<btVector3> sepRef;
+	btAlignedObjectArray<btVector3> sepTest;
+	btAlignedObjectArray<int> foundRef;
+	btAlignedObjectArray<int> foundTest;
+	transA.resize(numPairs);
+	transB.resize(numPairs);
+	sepRef.resize(numPairs);
+	sepTest.resize(numPairs);
+	foundRef.resize(numPairs);
+	foundTest.resize(numPairs);
+	for (int i = 0; i < numPairs; i++)
+	{
+		transA[i] = randomTransform(range);
+		transB[i] = randomTransform(range);
+	}
+
+	uint64_t scalarTime;
+	uint64_t vectorTime;
+	int i, j;
+
+	////////////////////////////////////
+	//
+	// Time and Test findSeparatingAxis
+	//
+	////////////////////////////////////
+	{
+		uint64_t startTime, bestTime, currentTime;
+
+		bestTime = -1LL;
+		scalarTime = 0;
+		for (j = 0; j < numCycles; j++)
+		{
+			startTime = ReadTicks();
+			for (i = 0; i < numPairs; i++)
+			{
+				foundRef[i] = findSeparatingAxis_ref(hullA, hullB, transA[i], transB[i], sepRef[i]);
+			}
+			currentTime = ReadTicks() - startTime;
+			scalarTime += currentTime;
+			if( currentTime < bestTime )
+				bestTime = currentTime;
+		}
+		if( 0 == gReportAverageTimes )
+			scalarTime = bestTime;
+		else
+			scalarTime /= numCycles;
+	}
+
+	{
+		uint64_t startTime, bestTime, currentTime;
+		btVertexArray worldVertsA;
+		btVertexArray worldVertsB;
+		ContactCounter counter;
+
+		bestTime = -1LL;
+		vectorTime = 0;
+		for (j = 0; j < numCycles; j++)
+		{
+			startTime = ReadTicks();
+			for (i = 0; i < numPairs; i++)
+			{
+				foundTest[i] = btPolyhedralContactClipping::findSeparatingAxis(hullA, hullB, transA[i], transB[i], sepTest[i], counter, worldVertsA, worldVertsB);
+			}
+			currentTime = ReadTicks() - startTime;
+			vectorTime += currentTime;
+			if( currentTime < bestTime )
+				bestTime = currentTime;
+		}
+		if( 0 == gReportAverageTimes )
+			vectorTime = bestTime;
+		else
+			vectorTime /= numCycles;
+	}
+
+	vlog( "%s findSeparatingAxis Timing (per pair):\n", name );
+	vlog( "     \t    scalar\t    vector\n" );
+	vlog( "    \t%10.4f\t%10.4f\n", TicksToCycles( scalarTime ) / numPairs, TicksToCycles( vectorTime ) / numPairs );
+
+	int numOverlapping = 0;
+	for (i = 0; i < numPairs; i++)
+	{
+		//the axes are compared by their depth, several axes can have the same smallest depth
+		if (foundRef[i] != foundTest[i])
+		{
+			printf( "%s findSeparatingAxis fail at %d: found %d, expected %d\n", name, i, foundTest[i], foundRef[i] );
+			return 1;
+		}
+		if (foundTest[i])
+		{
+			numOverlapping++;
+			btScalar depthRef,depthTest;
+			TestSepAxis_ref(hullA, hullB, transA[i], transB[i], sepRef[i], depthRef);
+			TestSepAxis_ref(hullA, hullB, transA[i], transB[i], sepTest[i], depthTest);
+			if (btFabs(depthRef-depthTest) > 1e-4f)
+			{
+				printf( "%s findSeparatingAxis fail at %d: depth %f, expected %f\n", name, i, depthTest, depthRef );
+				return 1;
+			}
+		}
+	}
+
+	////////////////////////////////////
+	//
+	// Time and Test clipHullAgainstHull, allocating the clipper arrays per call versus reusing them
+	//
+	////////////////////////////////////
+	ContactCounter allocCounter;
+	ContactCounter scratchCounter;
+	{
+		uint64_t startTime, bestTime, currentTime;
+
+		bestTime = -1LL;
+		scalarTime = 0;
+		for (j = 0; j < numCycles; j++)
+		{
+			allocCounter = ContactCounter();
+			startTime = ReadTicks();
+			for (i = 0; i < numPairs; i++)
+			{
+				if (foundTest[i])
+					btPolyhedralContactClipping::clipHullAgainstHull(sepTest[i], hullA, hullB, transA[i], transB[i], -1e30f, 0.02f, allocCounter);
+			}
+			currentTime = ReadTicks() - startTime;
+			scalarTime += currentTime;
+			if( currentTime < bestTime )
+				bestTime = currentTime;
+		}
+		if( 0 == gReportAverageTimes )
+			scalarTime = bestTime;
+		else
+			scalarTime /= numCycles;
+	}
+
+	{
+		uint64_t startTime, bestTime, currentTime;
+		btVertexArray worldVertsB1;
+		btVertexArray worldVertsB2;
+
+		bestTime = -1LL;
+		vectorTime = 0;
+		for (j = 0; j < numCycles; j++)
+		{
+			scratchCounter = ContactCounter();
+			startTime = ReadTicks();
+			for (i = 0; i < numPairs; i++)
+			{
+				if (foundTest[i])
+					btPolyhedralContactClipping::clipHullAgainstHull(sepTest[i], hullA, hullB, transA[i], transB[i], -1e30f, 0.02f, worldVertsB1, worldVertsB2, scratchCounter);
+			}
+			currentTime = ReadTicks() - startTime;
+			vectorTime += currentTime;
+			if( currentTime < bestTime )
+				bestTime = currentTime;
+		}
+		if( 0 == gReportAverageTimes )
+			vectorTime = bestTime;
+		else
+			vectorTime /= numCycles;
+	}
+
+	vlog( "%s clipHullAgainstHull Timing (%d of %d pairs overlap, per overlapping pair):\n", name, numOverlapping, numPairs );
+	vlog( "     \t  allocate\t    reuse\n" );
+	if (numOverlapping)
+		vlog( "    \t%10.4f\t%10.4f\n", TicksToCycles( scalarTime ) / numOverlapping, TicksToCycles( vectorTime ) / numOverlapping );
+
+	if (allocCounter.m_count != scratchCounter.m_count || allocCounter.m_depthSum != scratchCounter.m_depthSum)
+	{
+		printf( "%s clipHullAgainstHull fail with %d contacts, expected %d\n", name, scratchCounter.m_count, allocCounter.m_count );
+		return 1;
+	}
+	return 0;
+}
+
+int Test_polyhedralClipping(void)
+{
+	btBoxShape box(btVector3(0.5f,0.3f,0.4f));
+	box.initializePolyhedralFeatures();
+
+	btConvexHullShape hull;
+	for (int i = 0; i < HULL_POINTS; i++)
+	{
+		btVector3 point((float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f, (float)rand() / (float)RAND_MAX - 0.5f);
+		hull.addPoint(point.normalized()*btScalar(0.5f), false);
+	}
+	hull.recalcLocalAabb();
+	hull.initializePolyhedralFeatures();
+
+	if (TestPairs("box/box", *box.getConvexPolyhedron(), *box.getConvexPolyhedron(), 1.5f, BOX_PAIRS, BOX_CYCLES))
+		return 1;
+	if (TestPairs("hull/hull", *hull.getConvexPolyhedron(), *hull.getConvexPolyhedron(), 1.5f, HULL_PAIRS, HULL_CYCLES))
+		return 1;
+	return 0;
+}
+#endif
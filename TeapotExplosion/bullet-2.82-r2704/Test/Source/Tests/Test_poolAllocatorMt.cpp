@@ -0,0 +1,220 @@
+//
+//  Test_poolAllocatorMt.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_poolAllocatorMt.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include <LinearMath/btPoolAllocatorMt.h>
+#include <LinearMath/btAlignedObjectArray.h>
+
+#define ELEMENT_SIZE 48
+#define ELEMENTS_PER_SLAB 512
+#define STRESS_LOOPS 4000
+#define NUM_THREADS 4
+//below the two batches a cache holds before it spills to the global list
+#define SLICE_SIZE 20
+
+///each thread frees a slice of elements, few enough that they stay in its cache
+struct FreeSliceBody : public btIParallelForBody
+{
+	btPoolAllocatorMt*		m_pool;
+	void**					m_elements;
+	std::atomic<int>*		m_numArrived;
+	std::atomic<int>*		m_numThreads;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		//wait until every slice runs on a thread of its own, idle threads steal the slices of a waiting one
+		m_numArrived->fetch_add(1);
+		uint64_t startTime = ReadTicks();
+		while (m_numArrived->load()<NUM_THREADS && TicksToCycles(ReadTicks()-startTime)<1e9)
+		{
+			std::this_thread::yield();
+		}
+		if (m_numArrived->load()==NUM_THREADS)
+		{
+			m_numThreads->fetch_add(1);
+		}
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			for (int j=0;j<SLICE_SIZE;j++)
+			{
+				m_pool->freeMemory(m_elements[i*SLICE_SIZE+j]);
+			}
+		}
+	}
+};
+
+///allocates a few elements per loop, tags and checks them and frees them again
+struct StressBody : public btIParallelForBody
+{
+	btPoolAllocatorMt*		m_pool;
+	std::atomic<int>*		m_numErrors;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			int* elements[8];
+			const int numElements = 1+(i*7)%8;
+			for (int j=0;j<numElements;j++)
+			{
+				elements[j] = (int*)m_pool->allocate();
+				for (int k=0;k<ELEMENT_SIZE/int(sizeof(int));k++)
+				{
+					elements[j][k] = i*8+j;
+				}
+			}
+			for (int j=0;j<numElements;j++)
+			{
+				for (int k=0;k<ELEMENT_SIZE/int(sizeof(int));k++)
+				{
+					if (elements[j][k]!=i*8+j)
+					{
+						m_numErrors->fetch_add(1);
+						break;
+					}
+				}
+				m_pool->freeMemory(elements[j]);
+			}
+		}
+	}
+};
+
+struct PointerLess
+{
+	bool operator()(const void* a,const void* b) const
+	{
+		return a<b;
+	}
+};
+
+static int CheckStats(btPoolAllocatorMt& pool,int numSlabs,int usedCount,const char* phase)
+{
+	btPoolAllocatorStats stats;
+	pool.getStats(stats);
+	if (stats.m_numSlabs!=numSlabs || stats.m_capacity!=numSlabs*ELEMENTS_PER_SLAB || stats.m_usedCount!=usedCount ||
+		stats.m_numAllocations-stats.m_numFrees!=usedCount || stats.m_numOverflowAllocations)
+	{
+		printf( "poolAllocatorMt fail after %s: %d slabs, capacity %d, %d used, %d allocations, %d frees, %d overflows\n", phase,
+			stats.m_numSlabs, stats.m_capacity, stats.m_usedCount, stats.m_numAllocations, stats.m_numFrees, stats.m_numOverflowAllocations );
+		return 1;
+	}
+	return 0;
+}
+
+static int TestReclaim(void)
+{
+	btPoolAllocatorMt pool(ELEMENT_SIZE,ELEMENTS_PER_SLAB);
+	btAlignedObjectArray<void*> elements;
+	for (int i=0;i<ELEMENTS_PER_SLAB;i++)
+	{
+		elements.push_back(pool.allocate(false));
+	}
+	if (pool.allocate(false) || CheckStats(pool,1,ELEMENTS_PER_SLAB,"allocating the slab"))
+		return 1;
+
+	std::atomic<int> numArrived(0);
+	std::atomic<int> numThreads(0);
+	FreeSliceBody freeSlices;
+	freeSlices.m_pool = &pool;
+	freeSlices.m_elements = &elements[0];
+	freeSlices.m_numArrived = &numArrived;
+	freeSlices.m_numThreads = &numThreads;
+	btParallelFor(0,NUM_THREADS,1,freeSlices);
+	if (CheckStats(pool,1,ELEMENTS_PER_SLAB-NUM_THREADS*SLICE_SIZE,"freeing on all threads"))
+		return 1;
+	if (numThreads.load()!=NUM_THREADS)
+	{
+		vlog( "poolAllocatorMt: the slices ran on fewer than %d threads\n", NUM_THREADS );
+	}
+
+	//the main thread gets the elements in the caches of the other threads back without growing the pool
+	for (int i=0;i<NUM_THREADS*SLICE_SIZE;i++)
+	{
+		elements[i] = pool.allocate(false);
+		if (!elements[i])
+		{
+			printf( "poolAllocatorMt fail: allocate(false) found no element after %d of %d\n", i, NUM_THREADS*SLICE_SIZE );
+			return 1;
+		}
+	}
+	if (pool.allocate(false) || CheckStats(pool,1,ELEMENTS_PER_SLAB,"reclaiming"))
+		return 1;
+	btAlignedObjectArray<void*> sorted;
+	sorted.copyFromArray(elements);
+	sorted.quickSort(PointerLess());
+	for (int i=1;i<ELEMENTS_PER_SLAB;i++)
+	{
+		if (sorted[i]==sorted[i-1] || !pool.validPtr(sorted[i]))
+		{
+			printf( "poolAllocatorMt fail: element %p was handed out twice\n", sorted[i] );
+			return 1;
+		}
+	}
+	for (int i=0;i<ELEMENTS_PER_SLAB;i++)
+	{
+		pool.freeMemory(elements[i]);
+	}
+	return CheckStats(pool,1,0,"freeing on the main thread");
+}
+
+static int TestStress(void)
+{
+	btPoolAllocatorMt pool(ELEMENT_SIZE,ELEMENTS_PER_SLAB);
+	std::atomic<int> numErrors(0);
+	StressBody stress;
+	stress.m_pool = &pool;
+	stress.m_numErrors = &numErrors;
+
+	uint64_t startTime = ReadTicks();
+	btParallelFor(0,STRESS_LOOPS,16,stress);
+	uint64_t time = ReadTicks() - startTime;
+
+	btPoolAllocatorStats stats;
+	pool.getStats(stats);
+	vlog( "poolAllocatorMt %d threads, %d allocations in %d slabs, %10.1f per loop\n", btGetTaskScheduler()->getNumThreads(),
+		stats.m_numAllocations, stats.m_numSlabs, TicksToCycles(time)/STRESS_LOOPS );
+	if (numErrors.load())
+	{
+		printf( "poolAllocatorMt fail: %d elements were used by two threads at once\n", numErrors.load() );
+		return 1;
+	}
+	//every loop holds at most 8 elements, the caches of the threads hold at most 2 batches each
+	return CheckStats(pool,stats.m_numSlabs,0,"the stress loops");
+}
+
+int Test_poolAllocatorMt(void)
+{
+	btITaskScheduler* previousScheduler = btGetTaskScheduler();
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	//several threads even on a single core, so elements end up in several caches
+	scheduler->setNumThreads(NUM_THREADS);
+	btSetTaskScheduler(scheduler);
+
+	int result = TestReclaim();
+	if (!result)
+	{
+		result = TestStress();
+	}
+
+	btSetTaskScheduler(previousScheduler);
+	delete scheduler;
+	return result;
+}
+#endif
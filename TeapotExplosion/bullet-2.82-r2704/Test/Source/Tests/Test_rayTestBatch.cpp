@@ -0,0 +1,202 @@
+//
+//  Test_rayTestBatch.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_rayTestBatch.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <LinearMath/btThreads.h>
+
+#define NUM_RAYS 4000
+#define NUM_OBJECTS 300
+#define GRID_SIZE 32
+#define WORLD_SIZE 64
+#define NUM_THREADS 4
+
+namespace
+{
+
+btScalar RandomScalar(btScalar range)
+{
+	return range*btScalar(rand())/btScalar(RAND_MAX);
+}
+
+btVector3 RandomPoint(btScalar minHeight,btScalar maxHeight)
+{
+	return btVector3(RandomScalar(WORLD_SIZE),minHeight+RandomScalar(maxHeight-minHeight),RandomScalar(WORLD_SIZE));
+}
+
+///the filter of a rayTestBatch call and of the ClosestRayResultCallbacks it is compared to
+struct RayFilter
+{
+	short int	m_group;
+	short int	m_mask;
+};
+
+///compares ray i of rayTestBatch with rayTest, counts the hits on the mesh and the misses
+bool SameHit(btCollisionWorld& world,const btVector3& rayFrom,const btVector3& rayTo,const btCollisionWorld::ClosestRayResult& result,
+	const RayFilter& filter,int i,int& numMeshHits,int& numMisses)
+{
+	btCollisionWorld::ClosestRayResultCallback callback(rayFrom,rayTo);
+	callback.m_collisionFilterGroup = filter.m_group;
+	callback.m_collisionFilterMask = filter.m_mask;
+	world.rayTest(rayFrom,rayTo,callback);
+
+	if (callback.m_collisionObject!=result.m_collisionObject)
+	{
+		printf( "rayTestBatch fail: filter %d %d ray %d hits %p, %p with rayTest\n", filter.m_group, filter.m_mask, i,
+			(const void*)result.m_collisionObject, (const void*)callback.m_collisionObject );
+		return false;
+	}
+	if (!callback.hasHit())
+	{
+		numMisses++;
+		return true;
+	}
+	if (callback.m_collisionObject->getCollisionShape()->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+	{
+		numMeshHits++;
+	}
+	if (btFabs(callback.m_closestHitFraction-result.m_closestHitFraction)>btScalar(1e-5) ||
+		(callback.m_hitNormalWorld-result.m_hitNormalWorld).length()>btScalar(1e-4))
+	{
+		printf( "rayTestBatch fail: filter %d %d ray %d hits at %f normal (%f,%f,%f), at %f normal (%f,%f,%f) with rayTest\n",
+			filter.m_group, filter.m_mask, i, result.m_closestHitFraction,
+			result.m_hitNormalWorld.x(), result.m_hitNormalWorld.y(), result.m_hitNormalWorld.z(), callback.m_closestHitFraction,
+			callback.m_hitNormalWorld.x(), callback.m_hitNormalWorld.y(), callback.m_hitNormalWorld.z() );
+		return false;
+	}
+	return true;
+}
+
+}
+
+int Test_rayTestBatch(void)
+{
+	btITaskScheduler* previousScheduler = btGetTaskScheduler();
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	//several threads even on a single core, so the packets run on several threads
+	scheduler->setNumThreads(NUM_THREADS);
+	btSetTaskScheduler(scheduler);
+
+	btDefaultCollisionConfiguration configuration;
+	btCollisionDispatcher dispatcher(&configuration);
+	btDbvtBroadphase broadphase;
+	btCollisionWorld world(&dispatcher,&broadphase,&configuration);
+
+	srand(11);
+	//a bumpy ground mesh in group 1, hit by many rays of a packet at once, turned so the rays are tested in its local space
+	btAlignedObjectArray<btVector3> vertices;
+	btAlignedObjectArray<int> indices;
+	for (int z=0;z<=GRID_SIZE;z++)
+	{
+		for (int x=0;x<=GRID_SIZE;x++)
+		{
+			const btScalar cell = btScalar(WORLD_SIZE)/GRID_SIZE;
+			vertices.push_back(btVector3(x*cell,RandomScalar(2),z*cell));
+		}
+	}
+	for (int z=0;z<GRID_SIZE;z++)
+	{
+		for (int x=0;x<GRID_SIZE;x++)
+		{
+			const int v = z*(GRID_SIZE+1)+x;
+			indices.push_back(v); indices.push_back(v+GRID_SIZE+1); indices.push_back(v+1);
+			indices.push_back(v+1); indices.push_back(v+GRID_SIZE+1); indices.push_back(v+GRID_SIZE+2);
+		}
+	}
+	btTriangleIndexVertexArray meshInterface(indices.size()/3,&indices[0],3*sizeof(int),vertices.size(),&vertices[0][0],sizeof(btVector3));
+	btBvhTriangleMeshShape meshShape(&meshInterface,true);
+	btCollisionObject ground;
+	ground.setCollisionShape(&meshShape);
+	ground.setWorldTransform(btTransform(btQuaternion(btVector3(0,1,0),btScalar(0.3)),btVector3(WORLD_SIZE/4,0,-WORLD_SIZE/4)));
+	world.addCollisionObject(&ground,1,-1);
+
+	//boxes and spheres above the ground in groups 2 and 4, a few of them only accept rays of group 1
+	btBoxShape boxShape(btVector3(1,btScalar(0.5),btScalar(1.5)));
+	btSphereShape sphereShape(1);
+	btAlignedObjectArray<btCollisionObject*> objects;
+	for (int i=0;i<NUM_OBJECTS;i++)
+	{
+		btCollisionObject* object = new btCollisionObject();
+		object->setCollisionShape(i&1 ? (btCollisionShape*)&boxShape : (btCollisionShape*)&sphereShape);
+		btTransform transform;
+		transform.setOrigin(RandomPoint(4,20));
+		transform.setRotation(btQuaternion(btVector3(RandomScalar(1),1,RandomScalar(1)).normalized(),RandomScalar(SIMD_2_PI)));
+		object->setWorldTransform(transform);
+		world.addCollisionObject(object,short(i&1 ? 2 : 4),short(i%5 ? -1 : 1));
+		objects.push_back(object);
+	}
+
+	//rays down onto the ground and up into the sky, the rays up mostly miss
+	btAlignedObjectArray<btVector3> rayFrom;
+	btAlignedObjectArray<btVector3> rayTo;
+	for (int i=0;i<NUM_RAYS;i++)
+	{
+		const btVector3 from = RandomPoint(22,24);
+		btVector3 to = RandomPoint(-2,-1);
+		if (i%4==3)
+		{
+			to = from+btVector3(RandomScalar(20)-10,RandomScalar(20),RandomScalar(20)-10);
+		}
+		rayFrom.push_back(from);
+		rayTo.push_back(to);
+	}
+
+	static const RayFilter filters[] =
+	{
+		{ btBroadphaseProxy::DefaultFilter, btBroadphaseProxy::AllFilter },
+		{ 1, 2 },
+		{ 2, 1|4 },
+		{ 1, 8 },
+	};
+	btAlignedObjectArray<btCollisionWorld::ClosestRayResult> results;
+	results.resize(NUM_RAYS);
+	int result = 0;
+	int numMeshHits = 0;
+	int numMisses = 0;
+	int numHits = 0;
+	for (int f=0;f<int(sizeof(filters)/sizeof(filters[0])) && !result;f++)
+	{
+		world.rayTestBatch(&rayFrom[0],&rayTo[0],NUM_RAYS,&results[0],filters[f].m_group,filters[f].m_mask);
+		for (int i=0;i<NUM_RAYS && !result;i++)
+		{
+			if (!SameHit(world,rayFrom[i],rayTo[i],results[i],filters[f],i,numMeshHits,numMisses))
+			{
+				result = 1;
+			}
+			numHits += results[i].hasHit() ? 1 : 0;
+		}
+	}
+	vlog( "rayTestBatch %d rays, %d hits, %d on the mesh, %d misses\n", NUM_RAYS, numHits, numMeshHits, numMisses );
+	if (!result && (!numMeshHits || numHits==numMeshHits || !numMisses))
+	{
+		printf( "rayTestBatch fail: %d hits, %d on the mesh, %d misses, the rays don't cover meshes, convex shapes and misses\n",
+			numHits, numMeshHits, numMisses );
+		result = 1;
+	}
+
+	for (int i=0;i<objects.size();i++)
+	{
+		world.removeCollisionObject(objects[i]);
+		delete objects[i];
+	}
+	world.removeCollisionObject(&ground);
+	btSetTaskScheduler(previousScheduler);
+	delete scheduler;
+	return result;
+}
+#endif
@@ -0,0 +1,296 @@
+//
+//  Test_soaSolver.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_soaSolver.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletDynamicsCommon.h>
+#include <BulletDynamics/ConstraintSolver/btSoaConstraintSolver.h>
+
+#define WALL_WIDTH 8
+#define WALL_HEIGHT 5
+#define CHAIN_LENGTH 5
+#define NUM_STEPS 300
+
+namespace
+{
+
+///checks after every setup that each contact and friction row has one lane, and no two lanes of a group share a dynamic body
+class LaneCheckingSolver : public btSoaConstraintSolver
+{
+	btAlignedObjectArray<int>	m_bodyGroup;
+
+	bool CheckGroups(const btConstraintArray& rows,const btAlignedObjectArray<btSoaRowGroup>& groups,const btAlignedObjectArray<int>& lanes,bool frictionRows)
+	{
+		const int zeroBodyId = m_tmpSolverBodyPool.size();
+		if (lanes.size()!=rows.size() || groups.size()*BT_SOA_SOLVER_WIDTH<rows.size())
+		{
+			printf( "soaSolver fail: %d rows, %d lanes in %d groups\n", rows.size(), lanes.size(), groups.size() );
+			return false;
+		}
+		for (int i=0;i<rows.size();i++)
+		{
+			const int lane = lanes[i];
+			if (lane<0 || lane>=groups.size()*BT_SOA_SOLVER_WIDTH || groups[lane/BT_SOA_SOLVER_WIDTH].m_rowIndex[lane%BT_SOA_SOLVER_WIDTH]!=i)
+			{
+				printf( "soaSolver fail: row %d is in lane %d of another row\n", i, lane );
+				return false;
+			}
+			if (frictionRows && groups[lane/BT_SOA_SOLVER_WIDTH].m_contactLane[lane%BT_SOA_SOLVER_WIDTH]!=m_contactLanes[rows[i].m_frictionIndex])
+			{
+				printf( "soaSolver fail: friction row %d does not read the lane of contact %d\n", i, rows[i].m_frictionIndex );
+				return false;
+			}
+		}
+		m_bodyGroup.resize(0);
+		m_bodyGroup.resize(zeroBodyId,-1);
+		for (int g=0;g<groups.size();g++)
+		{
+			const btSoaRowGroup& group = groups[g];
+			for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+			{
+				if (group.m_rowIndex[l]<0)
+				{
+					//an unused lane never changes a velocity
+					if (group.m_jacDiagABInv[l]!=btScalar(0) || group.m_solverBodyIdA[l]!=zeroBodyId || group.m_solverBodyIdB[l]!=zeroBodyId)
+					{
+						printf( "soaSolver fail: unused lane %d of group %d is not empty\n", l, g );
+						return false;
+					}
+					continue;
+				}
+				const int bodies[2] = { group.m_solverBodyIdA[l], group.m_solverBodyIdB[l] };
+				for (int k=0;k<2;k++)
+				{
+					if (bodies[k]==zeroBodyId)
+						continue;
+					if (m_bodyGroup[bodies[k]]==g)
+					{
+						printf( "soaSolver fail: two lanes of group %d share solver body %d\n", g, bodies[k] );
+						return false;
+					}
+					m_bodyGroup[bodies[k]] = g;
+				}
+			}
+		}
+		return true;
+	}
+
+protected:
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
+	{
+		btScalar result = btSoaConstraintSolver::solveGroupCacheFriendlySetup(bodies,numBodies,manifoldPtr,numManifolds,constraints,numConstraints,infoGlobal,debugDrawer);
+		if (!m_failed)
+		{
+			m_numGroups += m_contactGroups.size();
+			m_failed = !CheckGroups(m_tmpSolverContactConstraintPool,m_contactGroups,m_contactLanes,false) ||
+				!CheckGroups(m_tmpSolverContactFrictionConstraintPool,m_frictionGroups,m_frictionLanes,true);
+		}
+		return result;
+	}
+
+public:
+	bool	m_failed;
+	int		m_numGroups;
+
+	LaneCheckingSolver()
+	:m_failed(false),
+	m_numGroups(0)
+	{
+	}
+};
+
+struct SceneResult
+{
+	btScalar	m_maxVelocity;
+	btScalar	m_maxDrop;
+	btScalar	m_groundImpulse;
+	btScalar	m_maxChainError;
+	uint64_t	m_time;
+};
+
+//a wall of unit boxes, each touching its neighbours on all sides, resting on a ground box,
+//and next to it a chain of point to point joints hanging from a fixed pivot, long enough to lie on the ground
+void RunScene(btSequentialImpulseConstraintSolver* solver,btScalar splitImpulsePenetrationThreshold,SceneResult& result)
+{
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,solver,&collisionConfiguration);
+	world.getSolverInfo().m_splitImpulsePenetrationThreshold = splitImpulsePenetrationThreshold;
+
+	btBoxShape groundShape(btVector3(50,1,50));
+	btRigidBody ground(0,0,&groundShape);
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(btVector3(0,-1,0));
+	ground.setWorldTransform(transform);
+	world.addRigidBody(&ground);
+
+	btBoxShape boxShape(btVector3(btScalar(0.5),btScalar(0.5),btScalar(0.5)));
+	btVector3 inertia;
+	boxShape.calculateLocalInertia(1,inertia);
+
+	btAlignedObjectArray<btRigidBody*> bodies;
+	for (int i=0;i<WALL_WIDTH;i++)
+	{
+		for (int j=0;j<WALL_WIDTH;j++)
+		{
+			for (int k=0;k<WALL_HEIGHT;k++)
+			{
+				btRigidBody* body = new btRigidBody(1,0,&boxShape,inertia);
+				transform.setOrigin(btVector3(btScalar(i-WALL_WIDTH/2),btScalar(0.5+k),btScalar(j-WALL_WIDTH/2)));
+				body->setWorldTransform(transform);
+				body->setActivationState(DISABLE_DEACTIVATION);
+				world.addRigidBody(body);
+				bodies.push_back(body);
+			}
+		}
+	}
+
+	//the links start level with the pivot and swing down, so the joints and the contacts of the chain meet in one island
+	btBoxShape linkShape(btVector3(btScalar(0.4),btScalar(0.1),btScalar(0.1)));
+	linkShape.calculateLocalInertia(1,inertia);
+	btAlignedObjectArray<btRigidBody*> links;
+	btAlignedObjectArray<btPoint2PointConstraint*> joints;
+	for (int i=0;i<CHAIN_LENGTH;i++)
+	{
+		btRigidBody* link = new btRigidBody(1,0,&linkShape,inertia);
+		transform.setOrigin(btVector3(btScalar(20.5+i),3,0));
+		link->setWorldTransform(transform);
+		link->setActivationState(DISABLE_DEACTIVATION);
+		world.addRigidBody(link);
+		btPoint2PointConstraint* joint = i ? new btPoint2PointConstraint(*links[i-1],*link,btVector3(btScalar(0.5),0,0),btVector3(btScalar(-0.5),0,0)) :
+			new btPoint2PointConstraint(*link,btVector3(btScalar(-0.5),0,0));
+		world.addConstraint(joint,true);
+		links.push_back(link);
+		joints.push_back(joint);
+	}
+
+	result.m_maxChainError = 0;
+	uint64_t startTime = ReadTicks();
+	for (int s=0;s<NUM_STEPS;s++)
+	{
+		world.stepSimulation(btScalar(1./60.),0);
+		//the chain has settled on the ground by the second half
+		for (int i=0;i<joints.size() && s>=NUM_STEPS/2;i++)
+		{
+			const btPoint2PointConstraint* joint = joints[i];
+			const btVector3 pivotA = joint->getRigidBodyA().getCenterOfMassTransform()*joint->getPivotInA();
+			const btVector3 pivotB = i ? joint->getRigidBodyB().getCenterOfMassTransform()*joint->getPivotInB() : joint->getPivotInB();
+			result.m_maxChainError = btMax(result.m_maxChainError,(pivotA-pivotB).length());
+		}
+	}
+	result.m_time = ReadTicks() - startTime;
+
+	//the last impulses are written back to the manifolds and carry the weight of the wall, and a little of the chain
+	result.m_groundImpulse = 0;
+	for (int i=0;i<dispatcher.getNumManifolds();i++)
+	{
+		const btPersistentManifold* manifold = dispatcher.getManifoldByIndexInternal(i);
+		if (manifold->getBody0()!=&ground && manifold->getBody1()!=&ground)
+			continue;
+		for (int p=0;p<manifold->getNumContacts();p++)
+		{
+			result.m_groundImpulse += manifold->getContactPoint(p).getAppliedImpulse();
+		}
+	}
+
+	result.m_maxVelocity = 0;
+	result.m_maxDrop = 0;
+	for (int i=0;i<bodies.size();i++)
+	{
+		const int level = i%WALL_HEIGHT;
+		result.m_maxVelocity = btMax(result.m_maxVelocity,bodies[i]->getLinearVelocity().length());
+		result.m_maxDrop = btMax(result.m_maxDrop,btFabs(bodies[i]->getWorldTransform().getOrigin().y()-btScalar(0.5+level)));
+		world.removeRigidBody(bodies[i]);
+		delete bodies[i];
+	}
+	for (int i=0;i<links.size();i++)
+	{
+		world.removeConstraint(joints[i]);
+		delete joints[i];
+		world.removeRigidBody(links[i]);
+		delete links[i];
+	}
+	world.removeRigidBody(&ground);
+}
+
+}
+
+int Test_soaSolver(void)
+{
+	static const struct
+	{
+		const char*	m_name;
+		btScalar	m_splitImpulsePenetrationThreshold;
+	} modes[] =
+	{
+		{ "default", btScalar(-.04) },
+		//no contact is deep enough to be solved without split impulse
+		{ "split impulse", BT_LARGE_FLOAT },
+	};
+
+	//the weight of the wall over one step
+	const btScalar weight = btScalar(WALL_WIDTH*WALL_WIDTH*WALL_HEIGHT*10)/btScalar(60.);
+
+	int result = 0;
+	for (int m=0;m<int(sizeof(modes)/sizeof(modes[0])) && !result;m++)
+	{
+		SceneResult sequential;
+		SceneResult soa;
+		btSequentialImpulseConstraintSolver sequentialSolver;
+		LaneCheckingSolver soaSolver;
+		RunScene(&sequentialSolver,modes[m].m_splitImpulsePenetrationThreshold,sequential);
+		RunScene(&soaSolver,modes[m].m_splitImpulsePenetrationThreshold,soa);
+
+		vlog( "soaSolver %s, %d boxes, %d links, %d steps, %d lanes:\n", modes[m].m_name, WALL_WIDTH*WALL_WIDTH*WALL_HEIGHT, CHAIN_LENGTH, NUM_STEPS, BT_SOA_SOLVER_WIDTH );
+		vlog( "          \t  max velocity\t  max drop\t  ground impulse\t  chain error\t    time\n" );
+		vlog( "sequential\t%14.5f\t%10.5f\t%16.5f\t%13.5f\t%10.1f\n", sequential.m_maxVelocity, sequential.m_maxDrop, sequential.m_groundImpulse, sequential.m_maxChainError, TicksToCycles( sequential.m_time ) / NUM_STEPS );
+		vlog( "soa       \t%14.5f\t%10.5f\t%16.5f\t%13.5f\t%10.1f\n", soa.m_maxVelocity, soa.m_maxDrop, soa.m_groundImpulse, soa.m_maxChainError, TicksToCycles( soa.m_time ) / NUM_STEPS );
+
+		if (soaSolver.m_failed)
+		{
+			result = 1;
+		}
+		else if (!soaSolver.m_numGroups)
+		{
+			printf( "soaSolver fail: %s solved no contact rows in lanes\n", modes[m].m_name );
+			result = 1;
+		}
+		//the rows of a color are solved in one step and converge a little slower, the wall still stays at rest
+		else if (soa.m_maxVelocity > btMax(sequential.m_maxVelocity*btScalar(3.),btScalar(0.1)) || soa.m_maxDrop > btMax(sequential.m_maxDrop*btScalar(1.5),btScalar(0.01)))
+		{
+			printf( "soaSolver fail: %s max velocity %f and drop %f, %f and %f with the sequential solver\n", modes[m].m_name,
+				soa.m_maxVelocity, soa.m_maxDrop, sequential.m_maxVelocity, sequential.m_maxDrop );
+			result = 1;
+		}
+		else if (btFabs(soa.m_groundImpulse-weight) > weight*btScalar(0.05))
+		{
+			printf( "soaSolver fail: %s ground impulse %f, the wall weighs %f per step, %f with the sequential solver\n", modes[m].m_name,
+				soa.m_groundImpulse, weight, sequential.m_groundImpulse );
+			result = 1;
+		}
+		//the joints still run on the sequential impulse rows between the lanes
+		else if (soa.m_maxChainError > btMax(sequential.m_maxChainError*btScalar(1.5),btScalar(0.01)))
+		{
+			printf( "soaSolver fail: %s chain error %f, %f with the sequential solver\n", modes[m].m_name, soa.m_maxChainError, sequential.m_maxChainError );
+			result = 1;
+		}
+	}
+	return result;
+}
+#endif
@@ -0,0 +1,155 @@
+//
+//  Test_threadIndex.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_threadIndex.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include <LinearMath/btThreads.h>
+
+#define NUM_THREADS 4
+#define NUM_CALLERS 3
+#define NUM_LOOPS 64
+
+namespace
+{
+
+///per-thread data indexed by btGetCurrentThreadIndex, counts the loops that find it in use by another thread
+struct ExclusiveUseBody : public btIParallelForBody
+{
+	std::atomic<int>*	m_inUse;
+	std::atomic<int>*	m_numErrors;
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		const unsigned int threadIndex = btGetCurrentThreadIndex();
+		if (threadIndex>=BT_MAX_THREAD_COUNT || m_inUse[threadIndex].fetch_add(1)!=0)
+		{
+			m_numErrors->fetch_add(1);
+		}
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			std::this_thread::yield();
+		}
+		if (threadIndex<BT_MAX_THREAD_COUNT)
+		{
+			m_inUse[threadIndex].fetch_sub(1);
+		}
+	}
+};
+
+///a thread outside the task scheduler that runs loops at the same time as the other callers
+struct Caller
+{
+	const ExclusiveUseBody*	m_body;
+	std::atomic<int>*		m_numStarted;
+	unsigned int			m_threadIndex;
+
+	void run()
+	{
+		m_threadIndex = btGetCurrentThreadIndex();
+		m_numStarted->fetch_add(1);
+		while (m_numStarted->load()<NUM_CALLERS)
+		{
+			std::this_thread::yield();
+		}
+		for (int i=0;i<NUM_LOOPS;i++)
+		{
+			btParallelFor(0,NUM_THREADS*4,1,*m_body);
+		}
+	}
+};
+
+}
+
+int Test_threadIndex(void)
+{
+	btITaskScheduler* previousScheduler = btGetTaskScheduler();
+	btITaskScheduler* scheduler = btCreateDefaultTaskScheduler();
+	scheduler->setNumThreads(NUM_THREADS);
+	btSetTaskScheduler(scheduler);
+	int result = 0;
+
+	std::atomic<int> inUse[BT_MAX_THREAD_COUNT];
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		inUse[i].store(0);
+	}
+	std::atomic<int> numErrors(0);
+	ExclusiveUseBody body;
+	body.m_inUse = inUse;
+	body.m_numErrors = &numErrors;
+
+	const unsigned int mainIndex = btGetCurrentThreadIndex();
+	std::atomic<int> numStarted(0);
+	Caller callers[NUM_CALLERS];
+	std::thread threads[NUM_CALLERS];
+	uint64_t startTime = ReadTicks();
+	for (int i=0;i<NUM_CALLERS;i++)
+	{
+		callers[i].m_body = &body;
+		callers[i].m_numStarted = &numStarted;
+		callers[i].m_threadIndex = BT_MAX_THREAD_COUNT;
+		threads[i] = std::thread(&Caller::run,&callers[i]);
+	}
+	for (int i=0;i<NUM_CALLERS;i++)
+	{
+		threads[i].join();
+	}
+	uint64_t time = ReadTicks() - startTime;
+	vlog( "threadIndex %d callers, %d loops each, %10.1f per loop\n", NUM_CALLERS, NUM_LOOPS, TicksToCycles(time)/NUM_LOOPS );
+
+	if (numErrors.load())
+	{
+		printf( "threadIndex fail: %d loops found their per-thread data in use by another thread\n", numErrors.load() );
+		result = 1;
+	}
+	for (int i=0;i<NUM_CALLERS && !result;i++)
+	{
+		bool distinct = callers[i].m_threadIndex!=mainIndex && callers[i].m_threadIndex<BT_MAX_THREAD_COUNT;
+		for (int j=0;j<i;j++)
+		{
+			distinct = distinct && callers[i].m_threadIndex!=callers[j].m_threadIndex;
+		}
+		if (!distinct)
+		{
+			printf( "threadIndex fail: caller %d got index %d, which another thread holds\n", i, callers[i].m_threadIndex );
+			result = 1;
+		}
+	}
+
+	//the indices of the callers are free again once they exited
+	if (!result)
+	{
+		Caller caller;
+		caller.m_body = &body;
+		caller.m_numStarted = &numStarted;
+		numStarted.store(NUM_CALLERS);
+		std::thread thread(&Caller::run,&caller);
+		thread.join();
+		if (caller.m_threadIndex!=BT_MAX_THREAD_COUNT-1)
+		{
+			printf( "threadIndex fail: a new caller got index %d instead of the released index %d\n", caller.m_threadIndex, BT_MAX_THREAD_COUNT-1 );
+			result = 1;
+		}
+	}
+
+	btSetTaskScheduler(previousScheduler);
+	delete scheduler;
+	return result;
+}
+#endif
@@ -0,0 +1,267 @@
+//
+//  Test_wideBvh.cpp
+//  BulletTest
+//
+//  Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+//
+
+
+
+#include "LinearMath/btScalar.h"
+#if defined (BT_USE_SSE_IN_API) || defined (BT_USE_NEON)
+
+#include "Test_wideBvh.h"
+#include "vector.h"
+#include "Utils.h"
+#include "main.h"
+#include <math.h>
+#include <string.h>
+
+#include <btBulletCollisionCommon.h>
+#include <BulletCollision/CollisionShapes/btWideBvh.h>
+
+#define GRID_SIZE 64
+#define NUM_DEBRIS 2000
+#define NUM_QUERIES 500
+
+namespace
+{
+
+///collects the triangles a query reports, as partId<<24|triangleIndex
+struct CollectTriangles : public btNodeOverlapCallback
+{
+	btAlignedObjectArray<int>	m_triangles;
+
+	virtual void processNode(int subPart, int triangleIndex)
+	{
+		m_triangles.push_back((subPart<<24)|triangleIndex);
+	}
+};
+
+///the exact boxes of all triangles of the mesh
+struct TriangleBoxes : public btInternalTriangleIndexCallback
+{
+	btAlignedObjectArray<int>		m_triangles;
+	btAlignedObjectArray<btVector3>	m_aabbMin;
+	btAlignedObjectArray<btVector3>	m_aabbMax;
+
+	virtual void internalProcessTriangleIndex(btVector3* triangle,int partId,int triangleIndex)
+	{
+		btVector3 aabbMin = triangle[0];
+		btVector3 aabbMax = triangle[0];
+		aabbMin.setMin(triangle[1]);
+		aabbMax.setMax(triangle[1]);
+		aabbMin.setMin(triangle[2]);
+		aabbMax.setMax(triangle[2]);
+		m_triangles.push_back((partId<<24)|triangleIndex);
+		m_aabbMin.push_back(aabbMin);
+		m_aabbMax.push_back(aabbMax);
+	}
+};
+
+class IntSortPredicate
+{
+public:
+	bool operator() ( const int& a, const int& b ) const
+	{
+		return a < b;
+	}
+};
+
+}
+
+static btScalar RandomUnit(void)
+{
+	return btScalar(rand())/btScalar(RAND_MAX);
+}
+
+static btVector3 RandomPoint(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	return btVector3(aabbMin.x()+RandomUnit()*(aabbMax.x()-aabbMin.x()),aabbMin.y()+RandomUnit()*(aabbMax.y()-aabbMin.y()),aabbMin.z()+RandomUnit()*(aabbMax.z()-aabbMin.z()));
+}
+
+///every triangle whose box the query touches has to be reported by the trees, each triangle once
+static int CheckQuery(const char* name,int query,const TriangleBoxes& boxes,const btVector3& raySource,const btVector3& rayTarget,
+					  const btVector3& castMin,const btVector3& castMax,bool checkOptimized,CollectTriangles& optimized,CollectTriangles& wide)
+{
+	optimized.m_triangles.quickSort(IntSortPredicate());
+	wide.m_triangles.quickSort(IntSortPredicate());
+	for (int i=1;i<wide.m_triangles.size();i++)
+	{
+		if (wide.m_triangles[i]==wide.m_triangles[i-1])
+		{
+			printf( "wideBvh fail: %s query %d reports triangle %x twice\n", name, query, wide.m_triangles[i] );
+			return 1;
+		}
+	}
+	const bool isRay = raySource!=rayTarget;
+	for (int i=0;i<boxes.m_triangles.size();i++)
+	{
+		//the box swept along the ray is tested as the ray against the triangle box grown by the box
+		const btVector3 aabbMin = boxes.m_aabbMin[i]-castMax;
+		const btVector3 aabbMax = boxes.m_aabbMax[i]-castMin;
+		btScalar param = btScalar(1.);
+		btVector3 normal;
+		const bool touches = isRay ? btRayAabb(raySource,rayTarget,aabbMin,aabbMax,param,normal) : TestPointAgainstAabb2(aabbMin,aabbMax,raySource);
+		if (!touches)
+			continue;
+		const int triangle = boxes.m_triangles[i];
+		if (checkOptimized && optimized.m_triangles.findBinarySearch(triangle)==optimized.m_triangles.size())
+		{
+			printf( "wideBvh fail: %s query %d, btOptimizedBvh misses triangle %x\n", name, query, triangle );
+			return 1;
+		}
+		if (wide.m_triangles.findBinarySearch(triangle)==wide.m_triangles.size())
+		{
+			printf( "wideBvh fail: %s query %d, btWideBvh misses triangle %x\n", name, query, triangle );
+			return 1;
+		}
+	}
+	return 0;
+}
+
+static int CompareQueries(const char* title,btBvhTriangleMeshShape& shape,btStridingMeshInterface& mesh,const btVector3& meshMin,const btVector3& meshMax,bool checkOptimized)
+{
+	TriangleBoxes boxes;
+	mesh.InternalProcessAllTriangles(&boxes,meshMin,meshMax);
+	const btOptimizedBvh* optimizedBvh = shape.getOptimizedBvh();
+	const btWideBvh* wideBvh = shape.getWideBvh();
+	const btVector3 zero(0,0,0);
+	int optimizedCount[3] = {0,0,0};
+	int wideCount[3] = {0,0,0};
+
+	for (int q=0;q<NUM_QUERIES;q++)
+	{
+		//a box around a point of the mesh
+		const btVector3 center = RandomPoint(meshMin,meshMax);
+		const btVector3 halfExtents = RandomPoint(btVector3(0.1f,0.1f,0.1f),btVector3(3,3,3));
+		CollectTriangles optimized,wide;
+		optimizedBvh->reportAabbOverlappingNodex(&optimized,center-halfExtents,center+halfExtents);
+		wideBvh->reportAabbOverlappingNodex(&wide,center-halfExtents,center+halfExtents);
+		if (CheckQuery("aabb",q,boxes,center,center,-halfExtents,halfExtents,checkOptimized,optimized,wide))
+			return 1;
+		optimizedCount[0] += optimized.m_triangles.size();
+		wideCount[0] += wide.m_triangles.size();
+	}
+
+	for (int q=0;q<NUM_QUERIES;q++)
+	{
+		//rays from above the mesh, half of them steep and half almost parallel to it
+		const btVector3 raySource = RandomPoint(btVector3(meshMin.x(),meshMax.y()+1,meshMin.z()),btVector3(meshMax.x(),meshMax.y()+5,meshMax.z()));
+		const btVector3 spread = (q&1) ? btVector3(5,0,5) : btVector3(40,0,40);
+		const btVector3 rayTarget = raySource+RandomPoint(-spread,spread)-btVector3(0,meshMax.y()-meshMin.y()+6,0);
+		CollectTriangles optimized,wide;
+		optimizedBvh->reportRayOverlappingNodex(&optimized,raySource,rayTarget);
+		wideBvh->reportRayOverlappingNodex(&wide,raySource,rayTarget);
+		if (CheckQuery("ray",q,boxes,raySource,rayTarget,zero,zero,checkOptimized,optimized,wide))
+			return 1;
+		optimizedCount[1] += optimized.m_triangles.size();
+		wideCount[1] += wide.m_triangles.size();
+	}
+
+	for (int q=0;q<NUM_QUERIES;q++)
+	{
+		const btVector3 raySource = RandomPoint(meshMin,meshMax);
+		const btVector3 rayTarget = RandomPoint(meshMin,meshMax);
+		const btVector3 halfExtents = RandomPoint(btVector3(0.1f,0.1f,0.1f),btVector3(1,1,1));
+		CollectTriangles optimized,wide;
+		optimizedBvh->reportBoxCastOverlappingNodex(&optimized,raySource,rayTarget,-halfExtents,halfExtents);
+		wideBvh->reportBoxCastOverlappingNodex(&wide,raySource,rayTarget,-halfExtents,halfExtents);
+		if (CheckQuery("box cast",q,boxes,raySource,rayTarget,-halfExtents,halfExtents,checkOptimized,optimized,wide))
+			return 1;
+		optimizedCount[2] += optimized.m_triangles.size();
+		wideCount[2] += wide.m_triangles.size();
+	}
+
+	vlog( "%s: triangles per aabb, ray, box cast query btOptimizedBvh %6.1f %6.1f %6.1f, btWideBvh %6.1f %6.1f %6.1f\n", title,
+		float(optimizedCount[0])/NUM_QUERIES, float(optimizedCount[1])/NUM_QUERIES, float(optimizedCount[2])/NUM_QUERIES,
+		float(wideCount[0])/NUM_QUERIES, float(wideCount[1])/NUM_QUERIES, float(wideCount[2])/NUM_QUERIES );
+	return 0;
+}
+
+int Test_wideBvh(void)
+{
+	srand(1);
+
+	//a bumpy grid and a second part of scattered triangles above it
+	btAlignedObjectArray<btVector3> gridVertices;
+	btAlignedObjectArray<int> gridIndices;
+	for (int z=0;z<GRID_SIZE;z++)
+	{
+		for (int x=0;x<GRID_SIZE;x++)
+		{
+			gridVertices.push_back(btVector3(btScalar(x),btSin(btScalar(x)*btScalar(0.3))*btCos(btScalar(z)*btScalar(0.2))*btScalar(2.),btScalar(z)));
+		}
+	}
+	for (int z=0;z<GRID_SIZE-1;z++)
+	{
+		for (int x=0;x<GRID_SIZE-1;x++)
+		{
+			const int i = z*GRID_SIZE+x;
+			gridIndices.push_back(i);
+			gridIndices.push_back(i+GRID_SIZE);
+			gridIndices.push_back(i+1);
+			gridIndices.push_back(i+1);
+			gridIndices.push_back(i+GRID_SIZE);
+			gridIndices.push_back(i+GRID_SIZE+1);
+		}
+	}
+	btAlignedObjectArray<btVector3> debrisVertices;
+	btAlignedObjectArray<int> debrisIndices;
+	for (int i=0;i<NUM_DEBRIS;i++)
+	{
+		const btVector3 center = RandomPoint(btVector3(0,2,0),btVector3(GRID_SIZE,6,GRID_SIZE));
+		for (int j=0;j<3;j++)
+		{
+			debrisIndices.push_back(debrisVertices.size());
+			debrisVertices.push_back(center+RandomPoint(btVector3(-1,-1,-1),btVector3(1,1,1)));
+		}
+	}
+
+	btTriangleIndexVertexArray mesh;
+	btIndexedMesh part;
+	part.m_numTriangles = gridIndices.size()/3;
+	part.m_triangleIndexBase = (const unsigned char*)&gridIndices[0];
+	part.m_triangleIndexStride = 3*sizeof(int);
+	part.m_numVertices = gridVertices.size();
+	part.m_vertexBase = (const unsigned char*)&gridVertices[0];
+	part.m_vertexStride = sizeof(btVector3);
+	mesh.addIndexedMesh(part,PHY_INTEGER);
+	part.m_numTriangles = debrisIndices.size()/3;
+	part.m_triangleIndexBase = (const unsigned char*)&debrisIndices[0];
+	part.m_numVertices = debrisVertices.size();
+	part.m_vertexBase = (const unsigned char*)&debrisVertices[0];
+	mesh.addIndexedMesh(part,PHY_INTEGER);
+
+	btBvhTriangleMeshShape shape(&mesh,true);
+	shape.setUseWideBvh(true);
+	btVector3 meshMin,meshMax;
+	shape.getAabb(btTransform::getIdentity(),meshMin,meshMax);
+	if (CompareQueries("built",shape,mesh,meshMin,meshMax,true))
+		return 1;
+
+	//raise a patch of the grid, partialRefitTree has to refit the triangles in it
+	const btVector3 patchMin(btScalar(GRID_SIZE/4),btScalar(-3.),btScalar(GRID_SIZE/4));
+	const btVector3 patchMax(btScalar(GRID_SIZE/2),btScalar(6.),btScalar(GRID_SIZE/2));
+	for (int i=0;i<gridVertices.size();i++)
+	{
+		btVector3& vertex = gridVertices[i];
+		if (vertex.x()>patchMin.x() && vertex.x()<patchMax.x() && vertex.z()>patchMin.z() && vertex.z()<patchMax.z())
+		{
+			vertex.setY(vertex.y()+btScalar(3.));
+		}
+	}
+	uint64_t startTime = ReadTicks();
+	shape.partialRefitTree(patchMin,patchMax);
+	uint64_t partialTime = ReadTicks() - startTime;
+	//btOptimizedBvh::refitPartial leaves the nodes above its subtrees as they were, so it can miss triangles that moved out of them
+	if (CompareQueries("partial refit",shape,mesh,meshMin,meshMax,false))
+		return 1;
+
+	startTime = ReadTicks();
+	shape.refitTree(meshMin,meshMax);
+	uint64_t fullTime = ReadTicks() - startTime;
+	vlog( "partialRefitTree of a quarter of the grid %10.1f cycles, refitTree %10.1f cycles\n", TicksToCycles(partialTime), TicksToCycles(fullTime) );
+	return 0;
+}
+#endif
@@ -58,8 +58,27 @@ public:
 	virtual void	setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax, btDispatcher* dispatcher)=0;
 	virtual void	getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const =0;
 
+	///setAabbs updates the aabbs of numProxies proxies at once, broadphases that can reorder the updates override it
+	virtual void	setAabbs(btBroadphaseProxy** proxies,const btVector3* aabbMins,const btVector3* aabbMaxs,int numProxies, btDispatcher* dispatcher)
+	{
+		for (int i=0;i<numProxies;i++)
+		{
+			setAabb(proxies[i],aabbMins[i],aabbMaxs[i],dispatcher);
+		}
+	}
+
 	virtual void	rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0)) = 0;
 
+	///rayTestPacket casts up to four rays at once, ray i reports to rayCallbacks[i] in the same order as rayTest would.
+	///btCollisionWorld::rayTestBatch calls it from several threads at once, so overrides must not use shared scratch memory
+	virtual void	rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0))
+	{
+		for (int i=0;i<numRays;i++)
+		{
+			rayTest(rayFrom[i],rayTo[i],*rayCallbacks[i],aabbMin,aabbMax);
+		}
+	}
+
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
@@ -26,6 +26,8 @@ class btCollisionObject;
 struct btCollisionObjectWrapper;
 struct btDispatcherInfo;
 class	btPersistentManifold;
+struct	btGjkBatchInput;
+struct	btGjkBatchOutput;
 
 typedef btAlignedObjectArray<btPersistentManifold*>	btManifoldArray;
 
@@ -75,6 +77,22 @@ public:
 	virtual btScalar calculateTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut) = 0;
 
 	virtual	void	getAllContactManifolds(btManifoldArray&	manifoldArray) = 0;
+
+	///algorithms that find their closest points with GJK return true and the input of their next processCollision,
+	///so a dispatcher can compute the closest points of many pairs at once with btGjkBatch
+	virtual	bool	getGjkBatchInput(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,btGjkBatchInput& input)
+	{
+		(void)body0Wrap;
+		(void)body1Wrap;
+		(void)input;
+		return false;
+	}
+
+	///the closest points for the next processCollision, computed from the input of getGjkBatchInput, 0 to clear them
+	virtual	void	setGjkBatchOutput(const btGjkBatchOutput* output)
+	{
+		(void)output;
+	}
 };
 
 
@@ -413,6 +413,7 @@ btDbvt::btDbvt()
 	m_lkhd		=	-1;
 	m_leaves	=	0;
 	m_opath		=	0;
+	m_revision	=	0;
 }
 
 //
@@ -431,6 +432,7 @@ void			btDbvt::clear()
 	m_lkhd		=	-1;
 	m_stkStack.clear();
 	m_opath		=	0;
+	++m_revision;
 	
 }
 
@@ -444,6 +446,7 @@ void			btDbvt::optimizeBottomUp()
 		fetchleaves(this,m_root,leaves);
 		bottomup(this,leaves);
 		m_root=leaves[0];
+		++m_revision;
 	}
 }
 
@@ -456,6 +459,7 @@ void			btDbvt::optimizeTopDown(int bu_treshold)
 		leaves.reserve(m_leaves);
 		fetchleaves(this,m_root,leaves);
 		m_root=topdown(this,leaves,bu_treshold);
+		++m_revision;
 	}
 }
 
@@ -485,6 +489,7 @@ btDbvtNode*	btDbvt::insert(const btDbvtVolume& volume,void* data)
 	btDbvtNode*	leaf=createnode(this,0,volume,data);
 	insertleaf(this,m_root,leaf);
 	++m_leaves;
+	++m_revision;
 	return(leaf);
 }
 
@@ -503,6 +508,7 @@ void			btDbvt::update(btDbvtNode* leaf,int lookahead)
 		} else root=m_root;
 	}
 	insertleaf(this,root,leaf);
+	++m_revision;
 }
 
 //
@@ -521,6 +527,7 @@ void			btDbvt::update(btDbvtNode* leaf,btDbvtVolume& volume)
 	}
 	leaf->volume=volume;
 	insertleaf(this,root,leaf);
+	++m_revision;
 }
 
 //
@@ -557,6 +564,7 @@ void			btDbvt::remove(btDbvtNode* leaf)
 	removeleaf(this,leaf);
 	deletenode(this,leaf);
 	--m_leaves;
+	++m_revision;
 }
 
 //
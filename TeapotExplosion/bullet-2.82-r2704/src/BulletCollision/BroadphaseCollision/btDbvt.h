@@ -230,6 +230,7 @@ struct	btDbvt
 			DBVT_VIRTUAL void	Process(const btDbvtNode*,const btDbvtNode*)		{}
 		DBVT_VIRTUAL void	Process(const btDbvtNode*)					{}
 		DBVT_VIRTUAL void	Process(const btDbvtNode* n,btScalar)			{ Process(n); }
+		DBVT_VIRTUAL void	ProcessRays(const btDbvtNode* n,int)				{ Process(n); }
 		DBVT_VIRTUAL bool	Descent(const btDbvtNode*)					{ return(true); }
 		DBVT_VIRTUAL bool	AllLeaves(const btDbvtNode*)					{ return(true); }
 	};
@@ -260,6 +261,7 @@ struct	btDbvt
 	int				m_lkhd;
 	int				m_leaves;
 	unsigned		m_opath;
+	unsigned		m_revision;	// Bumped by every change of the tree, see btDbvtCompact
 
 	
 	btAlignedObjectArray<sStkNN>	m_stkStack;
@@ -307,6 +309,12 @@ struct	btDbvt
 		void		collideTTpersistentStack(	const btDbvtNode* root0,
 		  const btDbvtNode* root1,
 		  DBVT_IPOLICY);
+	///collideTTpersistentStack on a stack of the caller, several of them can traverse the same trees at once
+	DBVT_PREFIX
+		static void		collideTTstack(	const btDbvtNode* root0,
+		  const btDbvtNode* root1,
+		  btAlignedObjectArray<sStkNN>& stack,
+		  DBVT_IPOLICY);
 #if 0
 	DBVT_PREFIX
 		void		collideTT(	const btDbvtNode* root0,
@@ -344,6 +352,14 @@ struct	btDbvt
 								const btVector3& aabbMin,
 								const btVector3& aabbMax,
 								DBVT_IPOLICY) const;
+	///rayTestPacket walks the tree once for all rays of packet and calls policy.ProcessRays(leaf,rayMask) with the rays that reach the leaf.
+	///Every ray sees its leaves in the same order as with rayTestInternal. It uses a local stack, so it can be called in parallel
+	DBVT_PREFIX
+		static void		rayTestPacket(	const btDbvtNode* root,
+								const btRayPacket& packet,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								DBVT_IPOLICY);
 
 	DBVT_PREFIX
 		static void		collideKDOP(const btDbvtNode* root,
@@ -789,6 +805,16 @@ DBVT_PREFIX
 inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 								  const btDbvtNode* root1,
 								  DBVT_IPOLICY)
+{
+	collideTTstack(root0,root1,m_stkStack,policy);
+}
+
+//
+DBVT_PREFIX
+inline void		btDbvt::collideTTstack(	const btDbvtNode* root0,
+								  const btDbvtNode* root1,
+								  btAlignedObjectArray<sStkNN>& stack,
+								  DBVT_IPOLICY)
 {
 	DBVT_CHECKTYPE
 		if(root0&&root1)
@@ -796,22 +822,22 @@ inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 			int								depth=1;
 			int								treshold=DOUBLE_STACKSIZE-4;
 			
-			m_stkStack.resize(DOUBLE_STACKSIZE);
-			m_stkStack[0]=sStkNN(root0,root1);
+			stack.resize(DOUBLE_STACKSIZE);
+			stack[0]=sStkNN(root0,root1);
 			do	{		
-				sStkNN	p=m_stkStack[--depth];
+				sStkNN	p=stack[--depth];
 				if(depth>treshold)
 				{
-					m_stkStack.resize(m_stkStack.size()*2);
-					treshold=m_stkStack.size()-4;
+					stack.resize(stack.size()*2);
+					treshold=stack.size()-4;
 				}
 				if(p.a==p.b)
 				{
 					if(p.a->isinternal())
 					{
-						m_stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[0]);
-						m_stkStack[depth++]=sStkNN(p.a->childs[1],p.a->childs[1]);
-						m_stkStack[depth++]=sStkNN(p.a->childs[0],p.a->childs[1]);
+						stack[depth++]=sStkNN(p.a->childs[0],p.a->childs[0]);
+						stack[depth++]=sStkNN(p.a->childs[1],p.a->childs[1]);
+						stack[depth++]=sStkNN(p.a->childs[0],p.a->childs[1]);
 					}
 				}
 				else if(Intersect(p.a->volume,p.b->volume))
@@ -820,23 +846,23 @@ inline void		btDbvt::collideTTpersistentStack(	const btDbvtNode* root0,
 					{
 						if(p.b->isinternal())
 						{
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b->childs[1]);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b->childs[1]);
+							stack[depth++]=sStkNN(p.a->childs[0],p.b->childs[0]);
+							stack[depth++]=sStkNN(p.a->childs[1],p.b->childs[0]);
+							stack[depth++]=sStkNN(p.a->childs[0],p.b->childs[1]);
+							stack[depth++]=sStkNN(p.a->childs[1],p.b->childs[1]);
 						}
 						else
 						{
-							m_stkStack[depth++]=sStkNN(p.a->childs[0],p.b);
-							m_stkStack[depth++]=sStkNN(p.a->childs[1],p.b);
+							stack[depth++]=sStkNN(p.a->childs[0],p.b);
+							stack[depth++]=sStkNN(p.a->childs[1],p.b);
 						}
 					}
 					else
 					{
 						if(p.b->isinternal())
 						{
-							m_stkStack[depth++]=sStkNN(p.a,p.b->childs[0]);
-							m_stkStack[depth++]=sStkNN(p.a,p.b->childs[1]);
+							stack[depth++]=sStkNN(p.a,p.b->childs[0]);
+							stack[depth++]=sStkNN(p.a,p.b->childs[1]);
 						}
 						else
 						{
@@ -1003,6 +1029,55 @@ inline void		btDbvt::rayTestInternal(	const btDbvtNode* root,
 }
 
 //
+DBVT_PREFIX
+inline void		btDbvt::rayTestPacket(	const btDbvtNode* root,
+								const btRayPacket& packet,
+								const btVector3& aabbMin,
+								const btVector3& aabbMax,
+								DBVT_IPOLICY)
+{
+	DBVT_CHECKTYPE
+	if(root)
+	{
+		btAlignedObjectArray<const btDbvtNode*>	stack;
+		btAlignedObjectArray<int>				masks;
+		stack.resize(DOUBLE_STACKSIZE);
+		masks.resize(DOUBLE_STACKSIZE);
+		int				depth=1;
+		int				treshold=DOUBLE_STACKSIZE-2;
+		stack[0]=root;
+		masks[0]=(1<<packet.m_numRays)-1;
+		btVector3 bounds[2];
+		do	
+		{
+			const btDbvtNode*	node=stack[--depth];
+			bounds[0] = node->volume.Mins()-aabbMax;
+			bounds[1] = node->volume.Maxs()-aabbMin;
+			const int			mask=masks[depth]&btRayAabbPacket(packet,bounds,0.f);
+			if(mask)
+			{
+				if(node->isinternal())
+				{
+					if(depth>treshold)
+					{
+						stack.resize(stack.size()*2);
+						masks.resize(stack.size());
+						treshold=stack.size()-2;
+					}
+					masks[depth]=mask;
+					stack[depth++]=node->childs[0];
+					masks[depth]=mask;
+					stack[depth++]=node->childs[1];
+				}
+				else
+				{
+					policy.ProcessRays(node,mask);
+				}
+			}
+		} while(depth);
+	}
+}
+
 DBVT_PREFIX
 inline void		btDbvt::rayTest(	const btDbvtNode* root,
 								const btVector3& rayFrom,
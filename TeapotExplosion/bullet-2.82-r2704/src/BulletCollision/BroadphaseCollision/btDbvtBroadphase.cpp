@@ -16,6 +16,7 @@ subject to the following restrictions:
 ///btDbvtBroadphase implementation by Nathanael Presson
 
 #include "btDbvtBroadphase.h"
+#include "LinearMath/btThreads.h"
 
 //
 // Profiling
@@ -104,7 +105,8 @@ struct	btDbvtTreeCollider : btDbvt::ICollide
 			if(pa->m_uniqueId>pb->m_uniqueId) 
 				btSwap(pa,pb);
 #endif
-			pbp->m_paircache->addOverlappingPair(pa,pb);
+			pbp->m_pairBuffer.push_back(pa);
+			pbp->m_pairBuffer.push_back(pb);
 			++pbp->m_newpairs;
 		}
 	}
@@ -114,6 +116,119 @@ struct	btDbvtTreeCollider : btDbvt::ICollide
 	}
 };
 
+/* Tree collider of a parallel collide task	*/ 
+struct	btDbvtThreadCollider : btDbvt::ICollide
+{
+	btAlignedObjectArray<btBroadphaseProxy*>&	pairs;
+	btDbvtThreadCollider(btAlignedObjectArray<btBroadphaseProxy*>& p) : pairs(p) {}
+	void	Process(const btDbvtNode* na,const btDbvtNode* nb)
+	{
+		if(na!=nb)
+		{
+			btDbvtProxy*	pa=(btDbvtProxy*)na->data;
+			btDbvtProxy*	pb=(btDbvtProxy*)nb->data;
+#if DBVT_BP_SORTPAIRS
+			if(pa->m_uniqueId>pb->m_uniqueId) 
+				btSwap(pa,pb);
+#endif
+			pairs.push_back(pa);
+			pairs.push_back(pb);
+		}
+	}
+};
+
+/* Parallel collide tasks	*/ 
+struct	btDbvtCollideLoop : btIParallelForBody
+{
+	btDbvtBroadphase*	pbp;
+	btDbvtCollideLoop(btDbvtBroadphase* p) : pbp(p) {}
+	void	forLoop(int iBegin,int iEnd) const
+	{
+		const int				threadIndex=(int)btGetCurrentThreadIndex();
+		btAssert(threadIndex<pbp->m_collideThreads.size());
+		btDbvtCollideThread&	thread=pbp->m_collideThreads[threadIndex];
+		btDbvtThreadCollider	collider(thread.m_pairs);
+		for(int i=iBegin;i<iEnd;++i)
+		{
+			btDbvtCollideTask&	task=pbp->m_collideTasks[i];
+			task.m_thread	=	threadIndex;
+			task.m_begin	=	thread.m_pairs.size();
+			btDbvt::collideTTstack(task.m_nodes.a,task.m_nodes.b,thread.m_stack,collider);
+			task.m_end		=	thread.m_pairs.size();
+		}
+	}
+};
+
+//
+struct	btDbvtSplitNode
+{
+	btDbvt::sStkNN	nodes;
+	int				depth;
+	btDbvtSplitNode() {}
+	btDbvtSplitNode(const btDbvtNode* na,const btDbvtNode* nb,int d) : nodes(na,nb),depth(d) {}
+};
+
+/* expands the traversal of collideTTpersistentStack down to maxdepth, the subtree pairs are emitted in the order it pops them	*/ 
+static void						splitCollideTasks(	const btDbvtNode* root0,
+													const btDbvtNode* root1,
+													int maxdepth,
+													btAlignedObjectArray<btDbvtSplitNode>& stack,
+													btAlignedObjectArray<btDbvtCollideTask>& tasks)
+{
+	if(!root0||!root1) return;
+	stack.resize(0);
+	stack.push_back(btDbvtSplitNode(root0,root1,0));
+	do	{
+		const btDbvtSplitNode	n=stack[stack.size()-1];
+		const btDbvt::sStkNN&	p=n.nodes;
+		const int				d=n.depth+1;
+		stack.pop_back();
+		if(n.depth>=maxdepth)
+		{
+			tasks.expandNonInitializing().m_nodes=p;
+		}
+		else if(p.a==p.b)
+		{
+			if(p.a->isinternal())
+			{
+				stack.push_back(btDbvtSplitNode(p.a->childs[0],p.a->childs[0],d));
+				stack.push_back(btDbvtSplitNode(p.a->childs[1],p.a->childs[1],d));
+				stack.push_back(btDbvtSplitNode(p.a->childs[0],p.a->childs[1],d));
+			}
+		}
+		else if(Intersect(p.a->volume,p.b->volume))
+		{
+			if(p.a->isinternal())
+			{
+				if(p.b->isinternal())
+				{
+					stack.push_back(btDbvtSplitNode(p.a->childs[0],p.b->childs[0],d));
+					stack.push_back(btDbvtSplitNode(p.a->childs[1],p.b->childs[0],d));
+					stack.push_back(btDbvtSplitNode(p.a->childs[0],p.b->childs[1],d));
+					stack.push_back(btDbvtSplitNode(p.a->childs[1],p.b->childs[1],d));
+				}
+				else
+				{
+					stack.push_back(btDbvtSplitNode(p.a->childs[0],p.b,d));
+					stack.push_back(btDbvtSplitNode(p.a->childs[1],p.b,d));
+				}
+			}
+			else
+			{
+				if(p.b->isinternal())
+				{
+					stack.push_back(btDbvtSplitNode(p.a,p.b->childs[0],d));
+					stack.push_back(btDbvtSplitNode(p.a,p.b->childs[1],d));
+				}
+				else
+				{
+					tasks.expandNonInitializing().m_nodes=p;
+				}
+			}
+		}
+	} while(stack.size());
+}
+
 //
 // btDbvtBroadphase
 //
@@ -123,6 +238,7 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 {
 	m_deferedcollide	=	false;
 	m_needcleanup		=	true;
+	m_compactfixed		=	false;
 	m_releasepaircache	=	(paircache!=0)?false:true;
 	m_prediction		=	0;
 	m_stageCurrent		=	0;
@@ -138,6 +254,7 @@ btDbvtBroadphase::btDbvtBroadphase(btOverlappingPairCache* paircache)
 	m_gid				=	0;
 	m_pid				=	0;
 	m_cid				=	0;
+	m_parallelleaves	=	1024;
 	for(int i=0;i<=STAGECOUNT;++i)
 	{
 		m_stageRoots[i]=0;
@@ -183,7 +300,11 @@ btBroadphaseProxy*				btDbvtBroadphase::createProxy(	const btVector3& aabbMin,
 		btDbvtTreeCollider	collider(this);
 		collider.proxy=proxy;
 		m_sets[0].collideTV(m_sets[0].m_root,aabb,collider);
-		m_sets[1].collideTV(m_sets[1].m_root,aabb,collider);
+		if(useFixedCompact())
+			m_fixedcompact.collideTV(aabb,m_compactStack,collider);
+		else
+			m_sets[1].collideTV(m_sets[1].m_root,aabb,collider);
+		flushNewPairs();
 	}
 	return(proxy);
 }
@@ -238,16 +359,64 @@ void	btDbvtBroadphase::rayTest(const btVector3& rayFrom,const btVector3& rayTo,
 		aabbMax,
 		callback);
 
-	m_sets[1].rayTestInternal(	m_sets[1].m_root,
-		rayFrom,
-		rayTo,
-		rayCallback.m_rayDirectionInverse,
-		rayCallback.m_signs,
-		rayCallback.m_lambda_max,
-		aabbMin,
-		aabbMax,
-		callback);
+	if(useFixedCompact())
+	{
+		btDbvtCompactScratch<int>	scratch;
+		m_fixedcompact.rayTestInternal(	rayFrom,
+			rayCallback.m_rayDirectionInverse,
+			rayCallback.m_signs,
+			rayCallback.m_lambda_max,
+			aabbMin,
+			aabbMax,
+			scratch.stack(),
+			callback);
+	}
+	else
+	{
+		m_sets[1].rayTestInternal(	m_sets[1].m_root,
+			rayFrom,
+			rayTo,
+			rayCallback.m_rayDirectionInverse,
+			rayCallback.m_signs,
+			rayCallback.m_lambda_max,
+			aabbMin,
+			aabbMax,
+			callback);
+	}
+
+}
+
+struct	BroadphaseRayPacketTester : btDbvt::ICollide
+{
+	btBroadphaseRayCallback** m_rayCallbacks;
+	BroadphaseRayPacketTester(btBroadphaseRayCallback** orgCallbacks)
+		:m_rayCallbacks(orgCallbacks)
+	{
+	}
+	void					ProcessRays(const btDbvtNode* leaf,int rayMask)
+	{
+		btDbvtProxy*	proxy=(btDbvtProxy*)leaf->data;
+		for (int i=0;rayMask;i++,rayMask>>=1)
+		{
+			if (rayMask&1)
+				m_rayCallbacks[i]->process(proxy);
+		}
+	}
+};
 
+void	btDbvtBroadphase::rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks,int numRays,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	(void) rayTo;
+	btRayPacket packet;
+	for (int i=0;i<numRays;i++)
+	{
+		packet.setRay(i,rayFrom[i],rayCallbacks[i]->m_rayDirectionInverse,rayCallbacks[i]->m_signs,rayCallbacks[i]->m_lambda_max);
+	}
+	packet.setNumRays(numRays);
+	BroadphaseRayPacketTester callback(rayCallbacks);
+	///the fixed set is walked through its pointer tree even with m_compactfixed, the order of the leaves is the same
+	btDbvt::rayTestPacket(m_sets[0].m_root,packet,aabbMin,aabbMax,callback);
+	btDbvt::rayTestPacket(m_sets[1].m_root,packet,aabbMin,aabbMax,callback);
 }
 
 
@@ -272,17 +441,42 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 	const ATTRIBUTE_ALIGNED16(btDbvtVolume)	bounds=btDbvtVolume::FromMM(aabbMin,aabbMax);
 		//process all children, that overlap with  the given AABB bounds
 	m_sets[0].collideTV(m_sets[0].m_root,bounds,callback);
-	m_sets[1].collideTV(m_sets[1].m_root,bounds,callback);
+	if(useFixedCompact())
+	{
+		btDbvtCompactScratch<int>	scratch;
+		m_fixedcompact.collideTV(bounds,scratch.stack(),callback);
+	}
+	else
+		m_sets[1].collideTV(m_sets[1].m_root,bounds,callback);
 
 }
 
 
 
+//
+void							btDbvtBroadphase::flushNewPairs()
+{
+	if(m_pairBuffer.size()>0)
+	{
+		m_paircache->addOverlappingPairs(&m_pairBuffer[0],m_pairBuffer.size()/2);
+		m_pairBuffer.resize(0);
+	}
+}
+
 //
 void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 														  const btVector3& aabbMin,
 														  const btVector3& aabbMax,
 														  btDispatcher* /*dispatcher*/)
+{
+	updateProxy(absproxy,aabbMin,aabbMax);
+	flushNewPairs();
+}
+
+//
+void							btDbvtBroadphase::updateProxy(	btBroadphaseProxy* absproxy,
+															  const btVector3& aabbMin,
+															  const btVector3& aabbMax)
 {
 	btDbvtProxy*						proxy=(btDbvtProxy*)absproxy;
 	ATTRIBUTE_ALIGNED16(btDbvtVolume)	aabb=btDbvtVolume::FromMM(aabbMin,aabbMax);
@@ -338,7 +532,13 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 			if(!m_deferedcollide)
 			{
 				btDbvtTreeCollider	collider(this);
-				m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
+				if(useFixedCompact())
+				{
+					collider.proxy=proxy;
+					m_fixedcompact.collideTV(proxy->leaf->volume,m_compactStack,collider);
+				}
+				else
+					m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
 				m_sets[0].collideTTpersistentStack(m_sets[0].m_root,proxy->leaf,collider);
 			}
 		}	
@@ -346,6 +546,84 @@ void							btDbvtBroadphase::setAabb(		btBroadphaseProxy* absproxy,
 }
 
 
+//
+//
+static inline unsigned int	spreadBits10(unsigned int x)
+{
+	x&=0x3ff;
+	x=(x|(x<<16))&0x030000ff;
+	x=(x|(x<<8))&0x0300f00f;
+	x=(x|(x<<4))&0x030c30c3;
+	x=(x|(x<<2))&0x09249249;
+	return(x);
+}
+
+//
+static inline unsigned int	mortonKey(const btVector3& center,const btVector3& origin,const btVector3& scale)
+{
+	const btVector3	q=(center-origin)*scale;
+	const unsigned int	x=(unsigned int)btMax(btScalar(0),btMin(q.x(),btScalar(1023)));
+	const unsigned int	y=(unsigned int)btMax(btScalar(0),btMin(q.y(),btScalar(1023)));
+	const unsigned int	z=(unsigned int)btMax(btScalar(0),btMin(q.z(),btScalar(1023)));
+	return(spreadBits10(x)|(spreadBits10(y)<<1)|(spreadBits10(z)<<2));
+}
+
+//
+struct	btDbvtProxyUpdateSortPredicate
+{
+	bool operator() (const btDbvtProxyUpdate& a,const btDbvtProxyUpdate& b) const
+	{
+		return((a.m_key<b.m_key)||((a.m_key==b.m_key)&&(a.m_index<b.m_index)));
+	}
+};
+
+//
+void							btDbvtBroadphase::setAabbs(		btBroadphaseProxy** proxies,
+														   const btVector3* aabbMins,
+														   const btVector3* aabbMaxs,
+														   int numProxies,
+														   btDispatcher* dispatcher)
+{
+	/* below a few proxies the sort costs more than it saves	*/ 
+	if(numProxies<64)
+	{
+		for(int i=0;i<numProxies;++i)
+		{
+			setAabb(proxies[i],aabbMins[i],aabbMaxs[i],dispatcher);
+		}
+		return;
+	}
+	btVector3	boundsMin=aabbMins[0];
+	btVector3	boundsMax=aabbMaxs[0];
+	for(int i=1;i<numProxies;++i)
+	{
+		boundsMin.setMin(aabbMins[i]);
+		boundsMax.setMax(aabbMaxs[i]);
+	}
+	const btVector3	extent=boundsMax-boundsMin;
+	/* keys are computed from min+max, twice the center, so origin and scale are doubled as well	*/ 
+	const btVector3	origin=boundsMin*2;
+	const btVector3	scale(	btScalar(1023)/btMax(extent.x()*2,SIMD_EPSILON),
+							btScalar(1023)/btMax(extent.y()*2,SIMD_EPSILON),
+							btScalar(1023)/btMax(extent.z()*2,SIMD_EPSILON));
+	m_batchUpdates.resize(numProxies);
+	for(int i=0;i<numProxies;++i)
+	{
+		btDbvtProxyUpdate&	update=m_batchUpdates[i];
+		update.m_key	=	mortonKey(aabbMins[i]+aabbMaxs[i],origin,scale);
+		update.m_index	=	i;
+	}
+	/* ties keep the caller's order, so the result only depends on the input	*/ 
+	m_batchUpdates.quickSort(btDbvtProxyUpdateSortPredicate());
+	for(int i=0;i<numProxies;++i)
+	{
+		const int	index=m_batchUpdates[i].m_index;
+		updateProxy(proxies[index],aabbMins[index],aabbMaxs[index]);
+	}
+	/* the new pairs of all proxies go to the pair cache at once	*/ 
+	flushNewPairs();
+}
+
 //
 void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 														  const btVector3& aabbMin,
@@ -380,8 +658,15 @@ void							btDbvtBroadphase::setAabbForceUpdate(		btBroadphaseProxy* absproxy,
 		if(!m_deferedcollide)
 		{
 			btDbvtTreeCollider	collider(this);
-			m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
+			if(useFixedCompact())
+			{
+				collider.proxy=proxy;
+				m_fixedcompact.collideTV(proxy->leaf->volume,m_compactStack,collider);
+			}
+			else
+				m_sets[1].collideTTpersistentStack(m_sets[1].m_root,proxy->leaf,collider);
 			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,proxy->leaf,collider);
+			flushNewPairs();
 		}
 	}	
 }
@@ -526,6 +811,7 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			listremove(current,m_stageRoots[current->stage]);
 			listappend(current,m_stageRoots[STAGECOUNT]);
 #if DBVT_BP_ACCURATESLEEPING
+			flushNewPairs();
 			m_paircache->removeOverlappingPairsContainingProxy(current,dispatcher);
 			collider.proxy=current;
 			btDbvt::collideTV(m_sets[0].m_root,current->aabb,collider);
@@ -537,10 +823,17 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			current->stage	=	STAGECOUNT;	
 			current			=	next;
 		} while(current);
+		flushNewPairs();
 		m_fixedleft=m_sets[1].m_leaves;
 		m_needcleanup=true;
 	}
 	/* collide dynamics		*/ 
+	if(m_deferedcollide&&(m_sets[0].m_leaves>=m_parallelleaves)&&(btGetTaskScheduler()->getNumThreads()>1))
+	{
+		parallelCollide();
+		flushNewPairs();
+	}
+	else
 	{
 		btDbvtTreeCollider	collider(this);
 		if(m_deferedcollide)
@@ -553,6 +846,12 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 			SPC(m_profiling.m_ddcollide);
 			m_sets[0].collideTTpersistentStack(m_sets[0].m_root,m_sets[0].m_root,collider);
 		}
+		flushNewPairs();
+	}
+	/* compact fixed set	*/ 
+	if(m_compactfixed&&!m_fixedcompact.isCurrent(m_sets[1]))
+	{
+		m_fixedcompact.build(m_sets[1]);
 	}
 	/* clean up				*/ 
 	if(m_needcleanup)
@@ -563,6 +862,7 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 		{
 
 			int			ni=btMin(pairs.size(),btMax<int>(m_newpairs,(pairs.size()*m_cupdates)/100));
+			/* collect the separated pairs of the window, then remove them in one batch	*/ 
 			for(int i=0;i<ni;++i)
 			{
 				btBroadphasePair&	p=pairs[(m_cid+i)%pairs.size()];
@@ -574,10 +874,16 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 					if(pa->m_uniqueId>pb->m_uniqueId) 
 						btSwap(pa,pb);
 #endif
-					m_paircache->removeOverlappingPair(pa,pb,dispatcher);
-					--ni;--i;
+					m_pairBuffer.push_back(pa);
+					m_pairBuffer.push_back(pb);
 				}
 			}
+			if(m_pairBuffer.size()>0)
+			{
+				ni-=m_pairBuffer.size()/2;
+				m_paircache->removeOverlappingPairs(&m_pairBuffer[0],m_pairBuffer.size()/2,dispatcher);
+				m_pairBuffer.resize(0);
+			}
 			if(pairs.size()>0) m_cid=(m_cid+ni)%pairs.size(); else m_cid=0;
 		}
 	}
@@ -592,6 +898,44 @@ void							btDbvtBroadphase::collide(btDispatcher* dispatcher)
 	m_updates_call/=2;
 }
 
+//
+void							btDbvtBroadphase::parallelCollide()
+{
+	const int	numThreads=btMin(btGetTaskScheduler()->getNumThreads(),int(BT_MAX_THREAD_COUNT));
+	/* indexed by btGetCurrentThreadIndex, which is not bounded by the number of threads	*/ 
+	if(m_collideThreads.size()<BT_MAX_THREAD_COUNT)
+	{
+		m_collideThreads.resize(BT_MAX_THREAD_COUNT);
+	}
+	for(int i=0;i<m_collideThreads.size();++i)
+	{
+		m_collideThreads[i].m_pairs.resize(0);
+	}
+	/* about 16 subtree pairs per thread, fewer where the trees do not overlap	*/ 
+	int	maxdepth=1;
+	while((1<<maxdepth)<numThreads*16) ++maxdepth;
+	btAlignedObjectArray<btDbvtSplitNode>	stack;
+	m_collideTasks.resize(0);
+	splitCollideTasks(m_sets[0].m_root,m_sets[1].m_root,maxdepth,stack,m_collideTasks);
+	splitCollideTasks(m_sets[0].m_root,m_sets[0].m_root,maxdepth,stack,m_collideTasks);
+	{
+		SPC(m_profiling.m_ddcollide);
+		btDbvtCollideLoop	loop(this);
+		btParallelFor(0,m_collideTasks.size(),1,loop);
+	}
+	/* merge in task order	*/ 
+	for(int i=0;i<m_collideTasks.size();++i)
+	{
+		const btDbvtCollideTask&	task=m_collideTasks[i];
+		const btDbvtCollideThread&	thread=m_collideThreads[task.m_thread];
+		for(int j=task.m_begin;j<task.m_end;++j)
+		{
+			m_pairBuffer.push_back(thread.m_pairs[j]);
+		}
+		m_newpairs+=(task.m_end-task.m_begin)/2;
+	}
+}
+
 //
 void							btDbvtBroadphase::optimize()
 {
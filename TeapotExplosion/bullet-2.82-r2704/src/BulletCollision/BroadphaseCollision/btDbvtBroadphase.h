@@ -18,6 +18,7 @@ subject to the following restrictions:
 #define BT_DBVT_BROADPHASE_H
 
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtCompact.h"
 #include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
 
 //
@@ -56,6 +57,29 @@ struct btDbvtProxy : btBroadphaseProxy
 
 typedef btAlignedObjectArray<btDbvtProxy*>	btDbvtProxyArray;
 
+///one entry of a btDbvtBroadphase::setAabbs batch, m_key is the Morton code of the center of the new aabb
+struct btDbvtProxyUpdate
+{
+	unsigned int	m_key;
+	int				m_index;
+};
+
+///a subtree pair of the parallel collide, its pairs end up in m_pairs[m_begin..m_end) of the btDbvtCollideThread that ran it
+struct btDbvtCollideTask
+{
+	btDbvt::sStkNN	m_nodes;
+	int				m_thread;
+	int				m_begin;
+	int				m_end;
+};
+
+///traversal stack and pair buffer of one thread of the parallel collide
+struct btDbvtCollideThread
+{
+	btAlignedObjectArray<btDbvt::sStkNN>		m_stack;
+	btAlignedObjectArray<btBroadphaseProxy*>	m_pairs;
+};
+
 ///The btDbvtBroadphase implements a broadphase using two dynamic AABB bounding volume hierarchies/trees (see btDbvt).
 ///One tree is used for static/non-moving objects, and another tree is used for dynamic objects. Objects can move from one tree to the other.
 ///This is a very fast broadphase, especially for very dynamic worlds where many objects are moving. Its insert/add and remove of objects is generally faster than the sweep and prune broadphases btAxisSweep3 and bt32BitAxisSweep3.
@@ -84,9 +108,17 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	int						m_pid;						// Parse id
 	int						m_cid;						// Cleanup index
 	int						m_gid;						// Gen id
+	int						m_parallelleaves;			// Dynamic leaves from which a deferred collide runs on the task scheduler
 	bool					m_releasepaircache;			// Release pair cache on delete
 	bool					m_deferedcollide;			// Defere dynamic/static collision to collide call
 	bool					m_needcleanup;				// Need to run cleanup?
+	bool					m_compactfixed;				// Query the fixed set through m_fixedcompact
+	btAlignedObjectArray<btDbvtProxyUpdate>	m_batchUpdates;	// Scratch array of setAabbs
+	btAlignedObjectArray<btBroadphaseProxy*>	m_pairBuffer;	// Proxy pairs handed to the pair cache in one batch
+	btAlignedObjectArray<btDbvtCollideTask>		m_collideTasks;	// Subtree pairs of the parallel collide
+	btAlignedObjectArray<btDbvtCollideThread>	m_collideThreads;	// Per thread state of the parallel collide
+	btDbvtCompact			m_fixedcompact;				// Compact copy of the fixed set, rebuilt by collide
+	btAlignedObjectArray<int>	m_compactStack;			// Traversal stack of m_fixedcompact for the pair updates, queries use btDbvtCompactScratch
 #if DBVT_BP_PROFILE
 	btClock					m_clock;
 	struct	{
@@ -102,12 +134,23 @@ struct	btDbvtBroadphase : btBroadphaseInterface
 	~btDbvtBroadphase();
 	void							collide(btDispatcher* dispatcher);
 	void							optimize();
+	void							flushNewPairs();
+	///the deferred tree-vs-tree collide of collide on the task scheduler. The top levels are split into subtree pairs in
+	///the order collideTTpersistentStack visits them, so the merged pairs come out in the same order as a serial collide
+	void							parallelCollide();
+	void							updateProxy(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax);
+	///true when the fixed set is queried through m_fixedcompact, which is only up to date until the fixed set changes again
+	bool							useFixedCompact() const { return(m_compactfixed&&m_fixedcompact.isCurrent(m_sets[1])); }
 	
 	/* btBroadphaseInterface Implementation	*/
 	btBroadphaseProxy*				createProxy(const btVector3& aabbMin,const btVector3& aabbMax,int shapeType,void* userPtr,short int collisionFilterGroup,short int collisionFilterMask,btDispatcher* dispatcher,void* multiSapProxy);
 	virtual void					destroyProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
 	virtual void					setAabb(btBroadphaseProxy* proxy,const btVector3& aabbMin,const btVector3& aabbMax,btDispatcher* dispatcher);
+	///applies the updates along a Morton curve, so consecutive leaf reinsertions walk nearby parts of the tree
+	virtual void					setAabbs(btBroadphaseProxy** proxies,const btVector3* aabbMins,const btVector3* aabbMaxs,int numProxies,btDispatcher* dispatcher);
 	virtual void					rayTest(const btVector3& rayFrom,const btVector3& rayTo, btBroadphaseRayCallback& rayCallback, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
+	///walks both sets once per packet, with local stacks so packets can be cast in parallel
+	virtual void					rayTestPacket(const btVector3* rayFrom,const btVector3* rayTo, btBroadphaseRayCallback** rayCallbacks, int numRays, const btVector3& aabbMin=btVector3(0,0,0), const btVector3& aabbMax = btVector3(0,0,0));
 	virtual void					aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback);
 
 	virtual void					getAabb(btBroadphaseProxy* proxy,btVector3& aabbMin, btVector3& aabbMax ) const;
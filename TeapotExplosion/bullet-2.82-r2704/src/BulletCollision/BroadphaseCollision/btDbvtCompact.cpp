@@ -0,0 +1,90 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDbvtCompact.h"
+
+//
+static void		setCompactChild(btDbvtCompactNode& node,int i,const btDbvtVolume& volume)
+{
+	node.m_bounds[0+i]	=	volume.Mins().x();
+	node.m_bounds[2+i]	=	volume.Mins().y();
+	node.m_bounds[4+i]	=	volume.Mins().z();
+	node.m_bounds[6+i]	=	-volume.Maxs().x();
+	node.m_bounds[8+i]	=	-volume.Maxs().y();
+	node.m_bounds[10+i]	=	-volume.Maxs().z();
+}
+
+//
+btDbvtCompact::btDbvtCompact()
+{
+	m_root		=	0;
+	m_tree		=	0;
+	m_revision	=	0;
+}
+
+//
+void			btDbvtCompact::clear()
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_root		=	0;
+	m_tree		=	0;
+	m_revision	=	0;
+}
+
+//
+void			btDbvtCompact::build(const btDbvt& tree)
+{
+	m_nodes.resize(0);
+	m_leaves.resize(0);
+	m_tree		=	&tree;
+	m_revision	=	tree.m_revision;
+	m_root		=	0;
+	if(!tree.m_root) return;
+	m_volume	=	tree.m_root->volume;
+	if(tree.m_root->isleaf())
+	{
+		m_leaves.push_back(tree.m_root);
+		m_root	=	~0;
+		return;
+	}
+	m_nodes.reserve(tree.m_leaves);
+	m_leaves.reserve(tree.m_leaves);
+	/* depth first, child 0 is pushed last so it is stored right after its parent	*/
+	btAlignedObjectArray<sStkNR>	stack;
+	stack.reserve(btDbvt::SIMPLE_STACKSIZE);
+	stack.push_back(sStkNR(tree.m_root,-1,0));
+	do	{
+		const sStkNR	e=stack[stack.size()-1];
+		const int		index=m_nodes.size();
+		stack.pop_back();
+		m_nodes.expand();
+		if(e.parent>=0) m_nodes[e.parent].m_childs[e.child]=index;
+		for(int i=0;i<2;++i)
+		{
+			const btDbvtNode*	child=e.node->childs[i];
+			btDbvtCompactNode&	node=m_nodes[index];
+			setCompactChild(node,i,child->volume);
+			node.m_padding[i]=0;
+			if(child->isleaf())
+			{
+				node.m_childs[i]=~m_leaves.size();
+				m_leaves.push_back(child);
+			}
+		}
+		if(e.node->childs[1]->isinternal()) stack.push_back(sStkNR(e.node->childs[1],index,1));
+		if(e.node->childs[0]->isinternal()) stack.push_back(sStkNR(e.node->childs[0],index,0));
+	} while(stack.size()>0);
+}
@@ -0,0 +1,350 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_DBVT_COMPACT_H
+#define BT_DBVT_COMPACT_H
+
+#include "btDbvt.h"
+#include "LinearMath/btAabbUtil2.h"
+
+///internal node of a btDbvtCompact. The volumes of both children share the node, as min x, y, z and negated max x, y, z
+///with the two children interleaved: (x0,x1,y0,y1) (z0,z1,-X0,-X1) (-Y0,-Y1,-Z0,-Z1). A child is separated from a query
+///volume when any of its 6 values is greater than the matching query value, so both children are tested with 3 compares.
+ATTRIBUTE_ALIGNED16(struct) btDbvtCompactNode
+{
+	btScalar	m_bounds[12];
+	///index of an internal child in m_nodes, or ~index of a leaf child in m_leaves
+	int			m_childs[2];
+	int			m_padding[2];
+};
+
+///a volume laid out to be tested against both children of a btDbvtCompactNode
+ATTRIBUTE_ALIGNED16(struct) btDbvtCompactQuery
+{
+	btScalar	m_bounds[12];
+
+	btDbvtCompactQuery()
+	{
+	}
+
+	btDbvtCompactQuery(const btDbvtVolume& volume)
+	{
+		setVolume(volume.Mins(),volume.Maxs());
+	}
+
+	void	setVolume(const btVector3& mins,const btVector3& maxs)
+	{
+		m_bounds[0]=m_bounds[1]=maxs.x();
+		m_bounds[2]=m_bounds[3]=maxs.y();
+		m_bounds[4]=m_bounds[5]=maxs.z();
+		m_bounds[6]=m_bounds[7]=-mins.x();
+		m_bounds[8]=m_bounds[9]=-mins.y();
+		m_bounds[10]=m_bounds[11]=-mins.z();
+	}
+
+	///the volume of child i of node
+	void	setChild(const btDbvtCompactNode& node,int i)
+	{
+		m_bounds[0]=m_bounds[1]=-node.m_bounds[6+i];
+		m_bounds[2]=m_bounds[3]=-node.m_bounds[8+i];
+		m_bounds[4]=m_bounds[5]=-node.m_bounds[10+i];
+		m_bounds[6]=m_bounds[7]=-node.m_bounds[0+i];
+		m_bounds[8]=m_bounds[9]=-node.m_bounds[2+i];
+		m_bounds[10]=m_bounds[11]=-node.m_bounds[4+i];
+	}
+};
+
+///bit 0 is set when child 0 of node overlaps the query volume, bit 1 for child 1. Same result as Intersect on btDbvtAabbMm.
+SIMD_FORCE_INLINE int	btDbvtCompactOverlap(const btDbvtCompactNode& node,const btDbvtCompactQuery& query)
+{
+#if defined (BT_USE_SSE)
+	const __m128	separated=_mm_or_ps(_mm_or_ps(
+		_mm_cmpgt_ps(_mm_load_ps(node.m_bounds),_mm_load_ps(query.m_bounds)),
+		_mm_cmpgt_ps(_mm_load_ps(node.m_bounds+4),_mm_load_ps(query.m_bounds+4))),
+		_mm_cmpgt_ps(_mm_load_ps(node.m_bounds+8),_mm_load_ps(query.m_bounds+8)));
+	const int		mask=_mm_movemask_ps(separated);
+	return(((mask&5)?0:1)|((mask&10)?0:2));
+#else
+	int	mask=0;
+	for(int i=0;i<12;++i)
+	{
+		mask|=(node.m_bounds[i]>query.m_bounds[i]?1:0)<<(i&1);
+	}
+	return(((mask&1)?0:1)|((mask&2)?0:2));
+#endif
+}
+
+///btDbvtCompact is a read-only copy of a btDbvt in one array of 64 byte nodes, in depth first order with 32 bit child
+///indices, so a traversal walks forward through memory instead of chasing node pointers. The leaves are the btDbvtNode
+///leaves of the tree, so the ICollide policies of btDbvt work unchanged and report the same leaves in the same order.
+///A copy is only valid as long as isCurrent returns true for its tree, every change of the tree invalidates it.
+///It is used for trees that are queried much more often than they change, see btDbvtBroadphase::m_compactfixed,
+///btCompoundShape::setUseCompactAabbTree and btSoftBody::m_useCompactDbvt.
+struct	btDbvtCompact
+{
+	struct	sStkRR
+	{
+		int		a;
+		int		b;
+		sStkRR() {}
+		sStkRR(int ra,int rb) : a(ra),b(rb) {}
+	};
+
+	struct	sStkNR
+	{
+		const btDbvtNode*	node;
+		int					parent;
+		int					child;
+		sStkNR() {}
+		sStkNR(const btDbvtNode* n,int p,int c) : node(n),parent(p),child(c) {}
+	};
+
+	// Fields
+	btAlignedObjectArray<btDbvtCompactNode>	m_nodes;
+	btAlignedObjectArray<const btDbvtNode*>	m_leaves;
+	btDbvtVolume	m_volume;
+	int				m_root;
+	const btDbvt*	m_tree;
+	unsigned		m_revision;
+
+	// Methods
+	btDbvtCompact();
+	///copies tree in depth first order
+	void			build(const btDbvt& tree);
+	void			clear();
+	bool			empty() const { return(0==m_leaves.size()); }
+	bool			isCurrent(const btDbvt& tree) const { return((m_tree==&tree)&&(m_revision==tree.m_revision)); }
+
+	// T& policy must support ICollide policy/interface, the leaves are passed to Process(const btDbvtNode*)
+	template <typename T>
+		void		collideTV(	const btDbvtVolume& volume,
+		btAlignedObjectArray<int>& stack,
+		T& policy) const;
+	///same rays and lambda_max handling as btDbvt::rayTestInternal
+	template <typename T>
+		void		rayTestInternal(	const btVector3& rayFrom,
+		const btVector3& rayDirectionInverse,
+		unsigned int signs[3],
+		btScalar lambda_max,
+		const btVector3& aabbMin,
+		const btVector3& aabbMax,
+		btAlignedObjectArray<int>& stack,
+		T& policy) const;
+	///pairs of leaves of tree0 and tree1, or of one tree with itself when both are the same, passed to Process(const btDbvtNode*,const btDbvtNode*)
+	template <typename T>
+		static void	collideTT(	const btDbvtCompact& tree0,
+		const btDbvtCompact& tree1,
+		btAlignedObjectArray<sStkRR>& stack,
+		T& policy);
+};
+
+///btDbvtCompactScratch lends the calling thread its traversal stack of T for the lifetime of the scratch,
+///so repeated queries reuse the memory of the previous ones. A query started from inside the callback of
+///another one finds the stack taken and uses a stack of its own.
+template <typename T>
+class btDbvtCompactScratch
+{
+	struct sSlot
+	{
+		btAlignedObjectArray<T>	m_stack;
+		bool					m_taken;
+		sSlot() : m_taken(false) {}
+	};
+	static sSlot&				threadSlot()
+	{
+		static thread_local sSlot	slot;
+		return(slot);
+	}
+	btAlignedObjectArray<T>		m_nested;
+	btAlignedObjectArray<T>*	m_stack;
+
+	btDbvtCompactScratch(const btDbvtCompactScratch&);
+	btDbvtCompactScratch& operator=(const btDbvtCompactScratch&);
+
+public:
+	btDbvtCompactScratch()
+	{
+		sSlot&	slot=threadSlot();
+		if(slot.m_taken)
+		{
+			m_stack=&m_nested;
+		}
+		else
+		{
+			slot.m_taken=true;
+			m_stack=&slot.m_stack;
+		}
+	}
+	~btDbvtCompactScratch()
+	{
+		if(m_stack!=&m_nested) threadSlot().m_taken=false;
+	}
+	btAlignedObjectArray<T>&	stack() { return(*m_stack); }
+};
+
+//
+// Inline's
+//
+
+//
+template <typename T>
+inline void		btDbvtCompact::collideTV(	const btDbvtVolume& vol,
+											btAlignedObjectArray<int>& stack,
+											T& policy) const
+{
+	if(empty()||!Intersect(m_volume,vol)) return;
+	if(m_root<0)
+	{
+		policy.Process(m_leaves[~m_root]);
+		return;
+	}
+	const btDbvtCompactQuery	query(vol);
+	stack.resize(0);
+	stack.push_back(m_root);
+	do	{
+		/* children were tested by their parent, pushing 0 before 1 keeps the order of btDbvt::collideTV	*/
+		const int	ref=stack[stack.size()-1];
+		stack.pop_back();
+		if(ref<0)
+		{
+			policy.Process(m_leaves[~ref]);
+		}
+		else
+		{
+			const btDbvtCompactNode&	node=m_nodes[ref];
+			const int					overlap=btDbvtCompactOverlap(node,query);
+			if(overlap&1) stack.push_back(node.m_childs[0]);
+			if(overlap&2) stack.push_back(node.m_childs[1]);
+		}
+	} while(stack.size()>0);
+}
+
+//
+template <typename T>
+inline void		btDbvtCompact::rayTestInternal(	const btVector3& rayFrom,
+												const btVector3& rayDirectionInverse,
+												unsigned int signs[3],
+												btScalar lambda_max,
+												const btVector3& aabbMin,
+												const btVector3& aabbMax,
+												btAlignedObjectArray<int>& stack,
+												T& policy) const
+{
+	if(empty()) return;
+	btVector3	bounds[2];
+	btScalar	tmin=1.f,lambda_min=0.f;
+	bounds[0]=m_volume.Mins()-aabbMax;
+	bounds[1]=m_volume.Maxs()-aabbMin;
+	if(!btRayAabb2(rayFrom,rayDirectionInverse,signs,bounds,tmin,lambda_min,lambda_max)) return;
+	stack.resize(0);
+	stack.push_back(m_root);
+	do	{
+		const int	ref=stack[stack.size()-1];
+		stack.pop_back();
+		if(ref<0)
+		{
+			policy.Process(m_leaves[~ref]);
+		}
+		else
+		{
+			const btDbvtCompactNode&	node=m_nodes[ref];
+			for(int i=0;i<2;++i)
+			{
+				bounds[0].setValue(node.m_bounds[0+i],node.m_bounds[2+i],node.m_bounds[4+i]);
+				bounds[1].setValue(-node.m_bounds[6+i],-node.m_bounds[8+i],-node.m_bounds[10+i]);
+				bounds[0]-=aabbMax;
+				bounds[1]-=aabbMin;
+				tmin=1.f;
+				lambda_min=0.f;
+				if(btRayAabb2(rayFrom,rayDirectionInverse,signs,bounds,tmin,lambda_min,lambda_max))
+				{
+					stack.push_back(node.m_childs[i]);
+				}
+			}
+		}
+	} while(stack.size()>0);
+}
+
+//
+template <typename T>
+inline void		btDbvtCompact::collideTT(	const btDbvtCompact& tree0,
+											const btDbvtCompact& tree1,
+											btAlignedObjectArray<sStkRR>& stack,
+											T& policy)
+{
+	const bool	self=(&tree0==&tree1);
+	if(tree0.empty()||tree1.empty()) return;
+	if(!self&&!Intersect(tree0.m_volume,tree1.m_volume)) return;
+	btDbvtCompactQuery	query;
+	stack.resize(0);
+	stack.push_back(sStkRR(tree0.m_root,tree1.m_root));
+	/* pairs are pushed in the order of btDbvt::collideTT once they are known to overlap	*/
+	do	{
+		const sStkRR	p=stack[stack.size()-1];
+		stack.pop_back();
+		if(self&&(p.a==p.b))
+		{
+			if(p.a>=0)
+			{
+				const btDbvtCompactNode&	n=tree0.m_nodes[p.a];
+				query.setChild(n,0);
+				const bool					cross=(btDbvtCompactOverlap(n,query)&2)!=0;
+				stack.push_back(sStkRR(n.m_childs[0],n.m_childs[0]));
+				stack.push_back(sStkRR(n.m_childs[1],n.m_childs[1]));
+				if(cross) stack.push_back(sStkRR(n.m_childs[0],n.m_childs[1]));
+			}
+		}
+		else if(p.a>=0)
+		{
+			const btDbvtCompactNode&	na=tree0.m_nodes[p.a];
+			if(p.b>=0)
+			{
+				const btDbvtCompactNode&	nb=tree1.m_nodes[p.b];
+				query.setChild(na,0);
+				const int					o0=btDbvtCompactOverlap(nb,query);
+				query.setChild(na,1);
+				const int					o1=btDbvtCompactOverlap(nb,query);
+				if(o0&1) stack.push_back(sStkRR(na.m_childs[0],nb.m_childs[0]));
+				if(o1&1) stack.push_back(sStkRR(na.m_childs[1],nb.m_childs[0]));
+				if(o0&2) stack.push_back(sStkRR(na.m_childs[0],nb.m_childs[1]));
+				if(o1&2) stack.push_back(sStkRR(na.m_childs[1],nb.m_childs[1]));
+			}
+			else
+			{
+				query=btDbvtCompactQuery(tree1.m_leaves[~p.b]->volume);
+				const int					o=btDbvtCompactOverlap(na,query);
+				if(o&1) stack.push_back(sStkRR(na.m_childs[0],p.b));
+				if(o&2) stack.push_back(sStkRR(na.m_childs[1],p.b));
+			}
+		}
+		else
+		{
+			if(p.b>=0)
+			{
+				const btDbvtCompactNode&	nb=tree1.m_nodes[p.b];
+				query=btDbvtCompactQuery(tree0.m_leaves[~p.a]->volume);
+				const int					o=btDbvtCompactOverlap(nb,query);
+				if(o&1) stack.push_back(sStkRR(p.a,nb.m_childs[0]));
+				if(o&2) stack.push_back(sStkRR(p.a,nb.m_childs[1]));
+			}
+			else
+			{
+				policy.Process(tree0.m_leaves[~p.a],tree1.m_leaves[~p.b]);
+			}
+		}
+	} while(stack.size()>0);
+}
+
+#endif //BT_DBVT_COMPACT_H
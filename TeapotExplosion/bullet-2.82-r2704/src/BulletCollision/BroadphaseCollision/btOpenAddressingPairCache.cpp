@@ -0,0 +1,484 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btOpenAddressingPairCache.h"
+#include "btDispatcher.h"
+#include "btCollisionAlgorithm.h"
+
+extern int gOverlappingPairs;
+
+static const unsigned char BT_PAIR_SLOT_EMPTY = 0x80;
+static const unsigned char BT_PAIR_SLOT_DELETED = 0xfe;
+
+///key of a rejected pair in a batch, proxy ids are positive so no pair packs to it
+static const unsigned long long BT_PAIR_KEY_NONE = ~0ULL;
+
+//btMatchGroup returns a bit per slot of the group whose control byte is h2, btMatchGroupEmpty a bit per empty slot
+//and btMatchGroupFree a bit per empty or deleted slot. Full slots have the top bit of their control byte cleared.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+
+#include <emmintrin.h>
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroup(const unsigned char* control, unsigned char h2)
+{
+	__m128i group = _mm_load_si128((const __m128i*)control);
+	return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(group,_mm_set1_epi8((char)h2)));
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupEmpty(const unsigned char* control)
+{
+	return btMatchGroup(control,BT_PAIR_SLOT_EMPTY);
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupFree(const unsigned char* control)
+{
+	return (unsigned int)_mm_movemask_epi8(_mm_load_si128((const __m128i*)control));
+}
+
+static SIMD_FORCE_INLINE void btPrefetchGroup(const unsigned char* control)
+{
+	_mm_prefetch((const char*)control,_MM_HINT_T0);
+}
+
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+#include <arm_neon.h>
+
+///turns 16 bytes of 0xff or 0 into 16 bits
+static SIMD_FORCE_INLINE unsigned int btGroupMask(uint8x16_t bytes)
+{
+	static const unsigned char weights[16] = {1,2,4,8,16,32,64,128,1,2,4,8,16,32,64,128};
+	uint8x16_t bits = vandq_u8(bytes,vld1q_u8(weights));
+	uint8x8_t sum = vpadd_u8(vget_low_u8(bits),vget_high_u8(bits));
+	sum = vpadd_u8(sum,sum);
+	sum = vpadd_u8(sum,sum);
+	return (unsigned int)vget_lane_u8(sum,0) | ((unsigned int)vget_lane_u8(sum,1)<<8);
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroup(const unsigned char* control, unsigned char h2)
+{
+	return btGroupMask(vceqq_u8(vld1q_u8(control),vdupq_n_u8(h2)));
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupEmpty(const unsigned char* control)
+{
+	return btMatchGroup(control,BT_PAIR_SLOT_EMPTY);
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupFree(const unsigned char* control)
+{
+	return btGroupMask(vcgeq_u8(vld1q_u8(control),vdupq_n_u8(BT_PAIR_SLOT_EMPTY)));
+}
+
+static SIMD_FORCE_INLINE void btPrefetchGroup(const unsigned char* control)
+{
+	__builtin_prefetch(control);
+}
+
+#else
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroup(const unsigned char* control, unsigned char h2)
+{
+	unsigned int mask = 0;
+	for (int i=0;i<BT_PAIR_GROUP_SIZE;i++)
+	{
+		mask |= (control[i]==h2 ? 1u : 0u)<<i;
+	}
+	return mask;
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupEmpty(const unsigned char* control)
+{
+	return btMatchGroup(control,BT_PAIR_SLOT_EMPTY);
+}
+
+static SIMD_FORCE_INLINE unsigned int btMatchGroupFree(const unsigned char* control)
+{
+	unsigned int mask = 0;
+	for (int i=0;i<BT_PAIR_GROUP_SIZE;i++)
+	{
+		mask |= (unsigned int)(control[i]>>7)<<i;
+	}
+	return mask;
+}
+
+static SIMD_FORCE_INLINE void btPrefetchGroup(const unsigned char* /*control*/)
+{
+}
+
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+static SIMD_FORCE_INLINE int btFirstBit(unsigned int mask)
+{
+	unsigned long index;
+	_BitScanForward(&index,mask);
+	return (int)index;
+}
+#else
+static SIMD_FORCE_INLINE int btFirstBit(unsigned int mask)
+{
+	return __builtin_ctz(mask);
+}
+#endif
+
+///pairs are stored with the proxy of the smaller unique id first
+static SIMD_FORCE_INLINE unsigned long long btPairKey(const btBroadphaseProxy* proxy0, const btBroadphaseProxy* proxy1)
+{
+	return ((unsigned long long)(unsigned int)proxy0->getUid()<<32) | (unsigned long long)(unsigned int)proxy1->getUid();
+}
+
+///64 bit finalizer of MurmurHash3, the low 7 bits go to the control byte, the others select the first group
+static SIMD_FORCE_INLINE unsigned long long btPairHash(unsigned long long key)
+{
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdULL;
+	key ^= key >> 33;
+	key *= 0xc4ceb9fe1a85ec53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+
+btOpenAddressingPairCache::btOpenAddressingPairCache()
+	:m_groupMask(0),
+	m_growthLeft(0),
+	m_overlapFilterCallback(0),
+	m_ghostPairCallback(0)
+{
+	int initialAllocatedSize= 2;
+	m_overlappingPairArray.reserve(initialAllocatedSize);
+	rehash(0);
+}
+
+btOpenAddressingPairCache::~btOpenAddressingPairCache()
+{
+}
+
+int	btOpenAddressingPairCache::findSlot(unsigned long long key, unsigned long long hash) const
+{
+	int group = (int)(hash>>7) & m_groupMask;
+	unsigned char h2 = (unsigned char)(hash & 0x7f);
+	for (int probe=1;;probe++)
+	{
+		const unsigned char* control = &m_control[group*BT_PAIR_GROUP_SIZE];
+		unsigned int match = btMatchGroup(control,h2);
+		while (match)
+		{
+			int slot = group*BT_PAIR_GROUP_SIZE + btFirstBit(match);
+			if (m_slots[slot].m_key == key)
+			{
+				return slot;
+			}
+			match &= match-1;
+		}
+		//a key is never stored behind a group with an empty slot
+		if (btMatchGroupEmpty(control))
+		{
+			return -1;
+		}
+		//triangular probing visits every group once, the number of groups is a power of two
+		group = (group+probe) & m_groupMask;
+	}
+}
+
+int	btOpenAddressingPairCache::insertSlot(unsigned long long key, unsigned long long hash, int pairIndex)
+{
+	int group = (int)(hash>>7) & m_groupMask;
+	for (int probe=1;;probe++)
+	{
+		unsigned char* control = &m_control[group*BT_PAIR_GROUP_SIZE];
+		unsigned int freeSlots = btMatchGroupFree(control);
+		if (freeSlots)
+		{
+			int slot = group*BT_PAIR_GROUP_SIZE + btFirstBit(freeSlots);
+			if (m_control[slot] == BT_PAIR_SLOT_EMPTY)
+			{
+				m_growthLeft--;
+			}
+			m_control[slot] = (unsigned char)(hash & 0x7f);
+			m_slots[slot].m_key = key;
+			m_slots[slot].m_pairIndex = pairIndex;
+			return slot;
+		}
+		group = (group+probe) & m_groupMask;
+	}
+}
+
+void	btOpenAddressingPairCache::eraseSlot(int slot)
+{
+	//no probe went past a group that still has an empty slot, so this one can become empty too
+	if (btMatchGroupEmpty(&m_control[slot & ~(BT_PAIR_GROUP_SIZE-1)]))
+	{
+		m_control[slot] = BT_PAIR_SLOT_EMPTY;
+		m_growthLeft++;
+	} else
+	{
+		m_control[slot] = BT_PAIR_SLOT_DELETED;
+	}
+}
+
+void	btOpenAddressingPairCache::rehash(int numPairs)
+{
+	//at most 7/8 of the slots are full or deleted, right after a rehash at most half of them
+	int numSlots = BT_PAIR_GROUP_SIZE;
+	while ((numSlots/8)*7 < 2*numPairs)
+	{
+		numSlots *= 2;
+	}
+
+	m_control.resize(0);
+	m_control.resize(numSlots,BT_PAIR_SLOT_EMPTY);
+	m_slots.resizeNoInitialize(numSlots);
+	m_groupMask = numSlots/BT_PAIR_GROUP_SIZE-1;
+	m_growthLeft = (numSlots/8)*7;
+
+	int numStored = m_overlappingPairArray.size();
+	m_pairSlots.resizeNoInitialize(numStored);
+	for (int i=0;i<numStored;i++)
+	{
+		const btBroadphasePair& pair = m_overlappingPairArray[i];
+		unsigned long long key = btPairKey(pair.m_pProxy0,pair.m_pProxy1);
+		m_pairSlots[i] = insertSlot(key,btPairHash(key),i);
+	}
+}
+
+btBroadphasePair*	btOpenAddressingPairCache::internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, unsigned long long key, unsigned long long hash)
+{
+	int slot = findSlot(key,hash);
+	if (slot>=0)
+	{
+		return &m_overlappingPairArray[m_slots[slot].m_pairIndex];
+	}
+
+	int count = m_overlappingPairArray.size();
+	if (m_growthLeft==0)
+	{
+		rehash(count+1);
+	}
+
+	void* mem = &m_overlappingPairArray.expandNonInitializing();
+
+	//this is where we add an actual pair, so also call the 'ghost'
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->addOverlappingPair(proxy0,proxy1);
+
+	btBroadphasePair* pair = new (mem) btBroadphasePair(*proxy0,*proxy1);
+	pair->m_algorithm = 0;
+	pair->m_internalTmpValue = 0;
+
+	m_pairSlots.push_back(insertSlot(key,hash,count));
+	return pair;
+}
+
+void*	btOpenAddressingPairCache::internalRemovePair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, int slot, btDispatcher* dispatcher)
+{
+	int pairIndex = m_slots[slot].m_pairIndex;
+	btBroadphasePair& pair = m_overlappingPairArray[pairIndex];
+
+	cleanOverlappingPair(pair,dispatcher);
+	void* userData = pair.m_internalInfo1;
+
+	eraseSlot(slot);
+
+	if (m_ghostPairCallback)
+		m_ghostPairCallback->removeOverlappingPair(proxy0,proxy1,dispatcher);
+
+	//move the last pair into the hole, its slot knows where it went
+	int lastPairIndex = m_overlappingPairArray.size()-1;
+	if (pairIndex != lastPairIndex)
+	{
+		m_overlappingPairArray[pairIndex] = m_overlappingPairArray[lastPairIndex];
+		int lastSlot = m_pairSlots[lastPairIndex];
+		m_pairSlots[pairIndex] = lastSlot;
+		m_slots[lastSlot].m_pairIndex = pairIndex;
+	}
+	m_overlappingPairArray.pop_back();
+	m_pairSlots.pop_back();
+
+	return userData;
+}
+
+btBroadphasePair*	btOpenAddressingPairCache::addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1)
+{
+	gAddedPairs++;
+
+	if (!needsBroadphaseCollision(proxy0,proxy1))
+		return 0;
+
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+	unsigned long long key = btPairKey(proxy0,proxy1);
+	return internalAddPair(proxy0,proxy1,key,btPairHash(key));
+}
+
+void*	btOpenAddressingPairCache::removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher)
+{
+	gRemovePairs++;
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+	unsigned long long key = btPairKey(proxy0,proxy1);
+	int slot = findSlot(key,btPairHash(key));
+	if (slot<0)
+	{
+		return 0;
+	}
+	return internalRemovePair(proxy0,proxy1,slot,dispatcher);
+}
+
+btBroadphasePair*	btOpenAddressingPairCache::findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1)
+{
+	gFindPairs++;
+	if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+		btSwap(proxy0,proxy1);
+	unsigned long long key = btPairKey(proxy0,proxy1);
+	int slot = findSlot(key,btPairHash(key));
+	if (slot<0)
+	{
+		return NULL;
+	}
+	return &m_overlappingPairArray[m_slots[slot].m_pairIndex];
+}
+
+//the batches are hashed up front, so the group of a pair can be prefetched a few pairs before it is probed
+#define BT_PAIR_PREFETCH_DISTANCE 8
+
+void	btOpenAddressingPairCache::addOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs)
+{
+	m_batchKeys.resizeNoInitialize(numPairs);
+	m_batchHashes.resizeNoInitialize(numPairs);
+	for (int i=0;i<numPairs;i++)
+	{
+		gAddedPairs++;
+		btBroadphaseProxy* proxy0 = proxyPairs[2*i];
+		btBroadphaseProxy* proxy1 = proxyPairs[2*i+1];
+		if (!needsBroadphaseCollision(proxy0,proxy1))
+		{
+			m_batchKeys[i] = BT_PAIR_KEY_NONE;
+			m_batchHashes[i] = 0;
+			continue;
+		}
+		if (proxy0->m_uniqueId>proxy1->m_uniqueId)
+			btSwap(proxy0,proxy1);
+		m_batchKeys[i] = btPairKey(proxy0,proxy1);
+		m_batchHashes[i] = btPairHash(m_batchKeys[i]);
+	}
+
+	for (int i=0;i<numPairs;i++)
+	{
+		if (i+BT_PAIR_PREFETCH_DISTANCE<numPairs)
+		{
+			btPrefetchGroup(&m_control[((int)(m_batchHashes[i+BT_PAIR_PREFETCH_DISTANCE]>>7) & m_groupMask)*BT_PAIR_GROUP_SIZE]);
+		}
+		if (m_batchKeys[i] == BT_PAIR_KEY_NONE)
+		{
+			continue;
+		}
+		btBroadphasePair proxies(*proxyPairs[2*i],*proxyPairs[2*i+1]);
+		internalAddPair(proxies.m_pProxy0,proxies.m_pProxy1,m_batchKeys[i],m_batchHashes[i]);
+	}
+}
+
+void	btOpenAddressingPairCache::removeOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs,btDispatcher* dispatcher)
+{
+	m_batchHashes.resizeNoInitialize(numPairs);
+	for (int i=0;i<numPairs;i++)
+	{
+		btBroadphasePair proxies(*proxyPairs[2*i],*proxyPairs[2*i+1]);
+		m_batchHashes[i] = btPairHash(btPairKey(proxies.m_pProxy0,proxies.m_pProxy1));
+	}
+
+	for (int i=0;i<numPairs;i++)
+	{
+		gRemovePairs++;
+		if (i+BT_PAIR_PREFETCH_DISTANCE<numPairs)
+		{
+			btPrefetchGroup(&m_control[((int)(m_batchHashes[i+BT_PAIR_PREFETCH_DISTANCE]>>7) & m_groupMask)*BT_PAIR_GROUP_SIZE]);
+		}
+		btBroadphasePair proxies(*proxyPairs[2*i],*proxyPairs[2*i+1]);
+		int slot = findSlot(btPairKey(proxies.m_pProxy0,proxies.m_pProxy1),m_batchHashes[i]);
+		if (slot>=0)
+		{
+			internalRemovePair(proxies.m_pProxy0,proxies.m_pProxy1,slot,dispatcher);
+		}
+	}
+}
+
+void	btOpenAddressingPairCache::removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+	for (int i=0;i<m_overlappingPairArray.size();)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) || (pair.m_pProxy1 == proxy))
+		{
+			gRemovePairs++;
+			internalRemovePair(pair.m_pProxy0,pair.m_pProxy1,m_pairSlots[i],dispatcher);
+
+			gOverlappingPairs--;
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+void	btOpenAddressingPairCache::cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher)
+{
+	for (int i=0;i<m_overlappingPairArray.size();i++)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if ((pair.m_pProxy0 == proxy) || (pair.m_pProxy1 == proxy))
+		{
+			cleanOverlappingPair(pair,dispatcher);
+		}
+	}
+}
+
+void	btOpenAddressingPairCache::cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher)
+{
+	if (pair.m_algorithm && dispatcher)
+	{
+		pair.m_algorithm->~btCollisionAlgorithm();
+		dispatcher->freeCollisionAlgorithm(pair.m_algorithm);
+		pair.m_algorithm=0;
+	}
+}
+
+void	btOpenAddressingPairCache::processAllOverlappingPairs(btOverlapCallback* callback,btDispatcher* dispatcher)
+{
+	for (int i=0;i<m_overlappingPairArray.size();)
+	{
+		btBroadphasePair& pair = m_overlappingPairArray[i];
+		if (callback->processOverlap(pair))
+		{
+			gRemovePairs++;
+			internalRemovePair(pair.m_pProxy0,pair.m_pProxy1,m_pairSlots[i],dispatcher);
+
+			gOverlappingPairs--;
+		} else
+		{
+			i++;
+		}
+	}
+}
+
+void	btOpenAddressingPairCache::sortOverlappingPairs(btDispatcher* /*dispatcher*/)
+{
+	//the pairs keep their collision algorithms, only their slots have to be found again
+	m_overlappingPairArray.quickSort(btBroadphasePairSortPredicate());
+	rehash(m_overlappingPairArray.size());
+}
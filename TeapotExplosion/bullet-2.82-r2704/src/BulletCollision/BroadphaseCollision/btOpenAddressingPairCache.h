@@ -0,0 +1,156 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_OPEN_ADDRESSING_PAIR_CACHE_H
+#define BT_OPEN_ADDRESSING_PAIR_CACHE_H
+
+#include "btOverlappingPairCache.h"
+
+///number of slots whose control bytes are matched at once
+#define BT_PAIR_GROUP_SIZE 16
+
+///slot of the btOpenAddressingPairCache hash table
+struct btOpenAddressingPairSlot
+{
+	///the unique ids of the two proxies, the smaller one in the upper 32 bits
+	unsigned long long	m_key;
+	///index in the overlapping pair array
+	int					m_pairIndex;
+	int					m_padding;
+};
+
+///btOpenAddressingPairCache is a btOverlappingPairCache with an open addressing hash table, laid out like a 'Swiss table'.
+///Each slot has a control byte that is empty, deleted or holds 7 bits of the hash of its key. Probing visits groups of
+///BT_PAIR_GROUP_SIZE slots and matches all their control bytes with one SSE2 or NEON compare, so a lookup usually reads
+///one group of control bytes and one slot. Keys pack the two proxy ids into 64 bits, so no proxy is dereferenced while probing.
+///The pairs themselves stay in a dense btBroadphasePairArray in the order they were added, a removal moves the last pair
+///into the hole like btHashedOverlappingPairCache does. The order of the pairs only depends on the sequence of additions and
+///removals, never on the table size or the hash values. addOverlappingPairs and removeOverlappingPairs hash a batch first
+///and prefetch the groups they will probe, btDbvtBroadphase hands over its pairs that way.
+class btOpenAddressingPairCache : public btOverlappingPairCache
+{
+	btBroadphasePairArray	m_overlappingPairArray;
+	///slot of each pair in m_slots
+	btAlignedObjectArray<int>	m_pairSlots;
+	btAlignedObjectArray<unsigned char>	m_control;
+	btAlignedObjectArray<btOpenAddressingPairSlot>	m_slots;
+	int		m_groupMask;
+	///number of empty slots that can still be filled before the table has to grow
+	int		m_growthLeft;
+
+	btOverlapFilterCallback*	m_overlapFilterCallback;
+	btOverlappingPairCallback*	m_ghostPairCallback;
+
+	///scratch space of the batch functions
+	btAlignedObjectArray<unsigned long long>	m_batchKeys;
+	btAlignedObjectArray<unsigned long long>	m_batchHashes;
+
+	int		findSlot(unsigned long long key, unsigned long long hash) const;
+	int		insertSlot(unsigned long long key, unsigned long long hash, int pairIndex);
+	void	eraseSlot(int slot);
+	void	rehash(int numPairs);
+
+	btBroadphasePair*	internalAddPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, unsigned long long key, unsigned long long hash);
+	void*	internalRemovePair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1, int slot, btDispatcher* dispatcher);
+
+public:
+
+	btOpenAddressingPairCache();
+	virtual ~btOpenAddressingPairCache();
+
+	SIMD_FORCE_INLINE bool needsBroadphaseCollision(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1) const
+	{
+		if (m_overlapFilterCallback)
+			return m_overlapFilterCallback->needBroadphaseCollision(proxy0,proxy1);
+
+		bool collides = (proxy0->m_collisionFilterGroup & proxy1->m_collisionFilterMask) != 0;
+		collides = collides && (proxy1->m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+
+		return collides;
+	}
+
+	virtual btBroadphasePair*	addOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1);
+
+	virtual void*	removeOverlappingPair(btBroadphaseProxy* proxy0,btBroadphaseProxy* proxy1,btDispatcher* dispatcher);
+
+	virtual void	addOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs);
+
+	virtual void	removeOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs,btDispatcher* dispatcher);
+
+	virtual void	removeOverlappingPairsContainingProxy(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual void	cleanProxyFromPairs(btBroadphaseProxy* proxy,btDispatcher* dispatcher);
+
+	virtual void	cleanOverlappingPair(btBroadphasePair& pair,btDispatcher* dispatcher);
+
+	virtual void	processAllOverlappingPairs(btOverlapCallback*,btDispatcher* dispatcher);
+
+	virtual btBroadphasePair*	findPair(btBroadphaseProxy* proxy0, btBroadphaseProxy* proxy1);
+
+	virtual btBroadphasePair*	getOverlappingPairArrayPtr()
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	virtual const btBroadphasePair*	getOverlappingPairArrayPtr() const
+	{
+		return &m_overlappingPairArray[0];
+	}
+
+	virtual btBroadphasePairArray&	getOverlappingPairArray()
+	{
+		return m_overlappingPairArray;
+	}
+
+	const btBroadphasePairArray&	getOverlappingPairArray() const
+	{
+		return m_overlappingPairArray;
+	}
+
+	virtual int	getNumOverlappingPairs() const
+	{
+		return m_overlappingPairArray.size();
+	}
+
+	///number of slots of the hash table, a power of two of at least BT_PAIR_GROUP_SIZE
+	int	getNumSlots() const
+	{
+		return m_control.size();
+	}
+
+	btOverlapFilterCallback* getOverlapFilterCallback()
+	{
+		return m_overlapFilterCallback;
+	}
+
+	virtual void setOverlapFilterCallback(btOverlapFilterCallback* callback)
+	{
+		m_overlapFilterCallback = callback;
+	}
+
+	virtual bool	hasDeferredRemoval()
+	{
+		return false;
+	}
+
+	virtual	void	setInternalGhostPairCallback(btOverlappingPairCallback* ghostPairCallback)
+	{
+		m_ghostPairCallback = ghostPairCallback;
+	}
+
+	virtual void	sortOverlappingPairs(btDispatcher* dispatcher);
+};
+
+#endif //BT_OPEN_ADDRESSING_PAIR_CACHE_H
@@ -86,6 +86,23 @@ public:
 
 	virtual void	sortOverlappingPairs(btDispatcher* dispatcher) = 0;
 
+	///adds the pairs proxyPairs[2*i],proxyPairs[2*i+1] in order, like numPairs calls to addOverlappingPair
+	virtual void	addOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs)
+	{
+		for (int i=0;i<numPairs;i++)
+		{
+			addOverlappingPair(proxyPairs[2*i],proxyPairs[2*i+1]);
+		}
+	}
+
+	///removes the pairs proxyPairs[2*i],proxyPairs[2*i+1] in order, like numPairs calls to removeOverlappingPair
+	virtual void	removeOverlappingPairs(btBroadphaseProxy* const* proxyPairs,int numPairs,btDispatcher* dispatcher)
+	{
+		for (int i=0;i<numPairs;i++)
+		{
+			removeOverlappingPair(proxyPairs[2*i],proxyPairs[2*i+1],dispatcher);
+		}
+	}
 
 };
 
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 
 #define RAYAABB2
 
@@ -37,7 +38,7 @@ btQuantizedBvh::btQuantizedBvh() :
 
 
 
-void btQuantizedBvh::buildInternal()
+void btQuantizedBvh::buildInternal(btBuildMethod buildMethod)
 {
 	///assumes that caller filled in the m_quantizedLeafNodes
 	m_useQuantization = true;
@@ -54,7 +55,14 @@ void btQuantizedBvh::buildInternal()
 
 	m_curNodeIndex = 0;
 
-	buildTree(0,numLeafNodes);
+	if (buildMethod==BUILD_BINNED_SAH)
+	{
+		buildTreeBinnedSah(numLeafNodes);
+	}
+	else
+	{
+		buildTree(0,numLeafNodes);
+	}
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -326,6 +334,498 @@ int	btQuantizedBvh::calcSplittingAxis(int startIndex,int endIndex)
 	return variance.maxAxis();
 }
 
+///number of bins along the split axis of BUILD_BINNED_SAH, ranges of fewer leaves use one bin per leaf
+#define BT_BVH_SAH_BINS 16
+///ranges of at least this many leaves are split with btParallelFor, in chunks of BT_BVH_SAH_CHUNK_SIZE leaves
+#define BT_BVH_SAH_PARALLEL_SIZE 16384
+#define BT_BVH_SAH_CHUNK_SIZE 4096
+///ranges of at most this many leaves are built as one task
+#define BT_BVH_SAH_TASK_SIZE 2048
+
+///the union of leaf boxes and the bounds of their centroids
+struct btBvhSahBounds
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	btVector3	m_centroidMin;
+	btVector3	m_centroidMax;
+	int			m_count;
+
+	void	clear()
+	{
+		m_aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		m_aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+		m_centroidMin = m_aabbMin;
+		m_centroidMax = m_aabbMax;
+		m_count = 0;
+	}
+
+	void	add(const btVector3& aabbMin,const btVector3& aabbMax,const btVector3& centroid)
+	{
+		m_aabbMin.setMin(aabbMin);
+		m_aabbMax.setMax(aabbMax);
+		m_centroidMin.setMin(centroid);
+		m_centroidMax.setMax(centroid);
+		m_count++;
+	}
+
+	void	merge(const btBvhSahBounds& other)
+	{
+		m_aabbMin.setMin(other.m_aabbMin);
+		m_aabbMax.setMax(other.m_aabbMax);
+		m_centroidMin.setMin(other.m_centroidMin);
+		m_centroidMax.setMax(other.m_centroidMax);
+		m_count += other.m_count;
+	}
+
+	btScalar	getCost() const
+	{
+		const btVector3 extent = m_aabbMax-m_aabbMin;
+		return (extent.x()*extent.y()+extent.y()*extent.z()+extent.z()*extent.x())*btScalar(m_count);
+	}
+};
+
+///a leaf box of BUILD_BINNED_SAH, the splits move these between two buffers
+struct btBvhSahLeaf
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	btVector3	m_centroid;
+	int			m_leafIndex;
+};
+
+///leaves [m_begin,m_end) of btBvhSahBuilder::m_leaves[m_buffer], their subtree starts at m_nodeIndex
+struct btBvhSahRange
+{
+	btBvhSahBounds	m_bounds;
+	int				m_begin;
+	int				m_end;
+	int				m_buffer;
+	int				m_nodeIndex;
+};
+
+///the bins of a part of a range, each thread of a parallel split fills the bins of its chunks
+struct btBvhSahChunk
+{
+	btBvhSahBounds	m_bins[BT_BVH_SAH_BINS];
+	int				m_leftIndex;
+	int				m_rightIndex;
+};
+
+///builds the nodes of BUILD_BINNED_SAH. A split partitions its range stably into the other leaf buffer, so the tree does
+///not depend on how the splits were spread over the threads. The buffers are shared by copies of the builder that build
+///disjoint ranges
+struct btBvhSahBuilder
+{
+	enum btPass
+	{
+		PASS_PREPARE,	//fills m_leaves[0] and the bounds of each chunk in its m_bins[0]
+		PASS_BINS,
+		PASS_SCATTER
+	};
+
+	const btQuantizedBvh*		m_bvh;
+	const btQuantizedBvhNode*	m_quantizedLeafNodes;
+	const btOptimizedBvhNode*	m_leafNodes;
+	btQuantizedBvhNode*			m_quantizedNodes;
+	btOptimizedBvhNode*			m_nodes;
+	btBvhSahLeaf*				m_leaves[2];
+	unsigned char*				m_leafBin;		// bin of the leaf at each position of the split
+
+	//the split that is running
+	int							m_begin;
+	int							m_end;
+	int							m_buffer;
+	int							m_axis;
+	int							m_numBins;
+	btScalar					m_centroidMin;
+	btScalar					m_binScale;
+	int							m_bestBin;
+
+	void	runPass(btPass pass,int begin,int end,btBvhSahChunk& chunk)
+	{
+		switch (pass)
+		{
+		case PASS_PREPARE:
+			{
+				chunk.m_bins[0].clear();
+				for (int i=begin;i<end;i++)
+				{
+					btBvhSahLeaf& leaf = m_leaves[0][i];
+					if (m_quantizedLeafNodes)
+					{
+						leaf.m_aabbMin = m_bvh->unQuantize(&m_quantizedLeafNodes[i].m_quantizedAabbMin[0]);
+						leaf.m_aabbMax = m_bvh->unQuantize(&m_quantizedLeafNodes[i].m_quantizedAabbMax[0]);
+					}
+					else
+					{
+						leaf.m_aabbMin = m_leafNodes[i].m_aabbMinOrg;
+						leaf.m_aabbMax = m_leafNodes[i].m_aabbMaxOrg;
+					}
+					leaf.m_centroid = btScalar(0.5)*(leaf.m_aabbMax+leaf.m_aabbMin);
+					leaf.m_leafIndex = i;
+					chunk.m_bins[0].add(leaf.m_aabbMin,leaf.m_aabbMax,leaf.m_centroid);
+				}
+				break;
+			}
+		case PASS_BINS:
+			{
+				const btBvhSahLeaf* leaves = m_leaves[m_buffer];
+				for (int b=0;b<m_numBins;b++)
+				{
+					chunk.m_bins[b].clear();
+				}
+				for (int i=begin;i<end;i++)
+				{
+					const btBvhSahLeaf& leaf = leaves[i];
+					const int bin = btMin(m_numBins-1,btMax(0,int((leaf.m_centroid[m_axis]-m_centroidMin)*m_binScale)));
+					m_leafBin[i] = (unsigned char)bin;
+					chunk.m_bins[bin].add(leaf.m_aabbMin,leaf.m_aabbMax,leaf.m_centroid);
+				}
+				break;
+			}
+		case PASS_SCATTER:
+			{
+				const btBvhSahLeaf* leaves = m_leaves[m_buffer];
+				btBvhSahLeaf* target = m_leaves[1-m_buffer];
+				int left = chunk.m_leftIndex;
+				int right = chunk.m_rightIndex;
+				for (int i=begin;i<end;i++)
+				{
+					if (m_leafBin[i]<=m_bestBin)
+						target[left++] = leaves[i];
+					else
+						target[right++] = leaves[i];
+				}
+				break;
+			}
+		}
+	}
+
+	struct btPassLoop : public btIParallelForBody
+	{
+		btBvhSahBuilder*	m_builder;
+		btPass				m_pass;
+		btBvhSahChunk*		m_chunks;
+
+		virtual void forLoop(int iBegin,int iEnd) const
+		{
+			for (int c=iBegin;c<iEnd;c++)
+			{
+				const int begin = m_builder->m_begin+c*BT_BVH_SAH_CHUNK_SIZE;
+				const int end = btMin(begin+BT_BVH_SAH_CHUNK_SIZE,m_builder->m_end);
+				m_builder->runPass(m_pass,begin,end,m_chunks[c]);
+			}
+		}
+	};
+
+	///runs pass on the chunks of [m_begin,m_end), with btParallelFor if there are several
+	void	runPass(btPass pass,btBvhSahChunk* chunks,int numChunks)
+	{
+		if (numChunks==1)
+		{
+			runPass(pass,m_begin,m_end,chunks[0]);
+			return;
+		}
+		btPassLoop loop;
+		loop.m_builder = this;
+		loop.m_pass = pass;
+		loop.m_chunks = chunks;
+		btParallelFor(0,numChunks,1,loop);
+	}
+
+	void	calcBounds(int buffer,int begin,int end,btBvhSahBounds& bounds) const
+	{
+		bounds.clear();
+		for (int i=begin;i<end;i++)
+		{
+			const btBvhSahLeaf& leaf = m_leaves[buffer][i];
+			bounds.add(leaf.m_aabbMin,leaf.m_aabbMax,leaf.m_centroid);
+		}
+	}
+
+	///splits range into left and right at the cheapest bin boundary along the longest axis of the centroid bounds, or at the
+	///median when the centroids can't be told apart. Ranges of BT_BVH_SAH_PARALLEL_SIZE or more leaves are split with btParallelFor
+	void	split(const btBvhSahRange& range,btBvhSahRange& left,btBvhSahRange& right)
+	{
+		const btBvhSahBounds& bounds = range.m_bounds;
+		m_begin = range.m_begin;
+		m_end = range.m_end;
+		m_buffer = range.m_buffer;
+		m_axis = (bounds.m_centroidMax-bounds.m_centroidMin).maxAxis();
+		m_numBins = btMin(BT_BVH_SAH_BINS,m_end-m_begin);
+		m_centroidMin = bounds.m_centroidMin[m_axis];
+		const btScalar extent = bounds.m_centroidMax[m_axis]-m_centroidMin;
+		m_binScale = extent>btScalar(0) ? btScalar(m_numBins)/extent : btScalar(0);
+		m_bestBin = -1;
+
+		if (m_binScale>btScalar(0) && m_binScale<btScalar(BT_LARGE_FLOAT))
+		{
+			btBvhSahChunk localChunk;
+			btAlignedObjectArray<btBvhSahChunk> chunkArray;
+			btBvhSahChunk* chunks = &localChunk;
+			int numChunks = 1;
+			if (m_end-m_begin>=BT_BVH_SAH_PARALLEL_SIZE)
+			{
+				numChunks = (m_end-m_begin+BT_BVH_SAH_CHUNK_SIZE-1)/BT_BVH_SAH_CHUNK_SIZE;
+				chunkArray.resize(numChunks);
+				chunks = &chunkArray[0];
+			}
+
+			runPass(PASS_BINS,chunks,numChunks);
+			btBvhSahBounds mergedBins[BT_BVH_SAH_BINS];
+			const btBvhSahBounds* bins = chunks[0].m_bins;
+			if (numChunks>1)
+			{
+				for (int b=0;b<m_numBins;b++)
+				{
+					mergedBins[b] = chunks[0].m_bins[b];
+					for (int c=1;c<numChunks;c++)
+					{
+						mergedBins[b].merge(chunks[c].m_bins[b]);
+					}
+				}
+				bins = mergedBins;
+			}
+
+			//rightBounds[b] has the bins after b
+			btBvhSahBounds rightBounds[BT_BVH_SAH_BINS-1];
+			rightBounds[m_numBins-2] = bins[m_numBins-1];
+			for (int b=m_numBins-3;b>=0;b--)
+			{
+				rightBounds[b] = rightBounds[b+1];
+				rightBounds[b].merge(bins[b+1]);
+			}
+			btScalar bestCost = btScalar(BT_LARGE_FLOAT);
+			btBvhSahBounds leftBounds = bins[0];
+			for (int b=0;b<m_numBins-1;b++)
+			{
+				if (b>0)
+				{
+					leftBounds.merge(bins[b]);
+				}
+				if (leftBounds.m_count==0 || rightBounds[b].m_count==0)
+					continue;
+				const btScalar cost = leftBounds.getCost()+rightBounds[b].getCost();
+				if (cost<bestCost)
+				{
+					bestCost = cost;
+					m_bestBin = b;
+					left.m_bounds = leftBounds;
+				}
+			}
+
+			if (m_bestBin>=0)
+			{
+				right.m_bounds = rightBounds[m_bestBin];
+				int leftIndex = m_begin;
+				int rightIndex = m_begin+left.m_bounds.m_count;
+				for (int c=0;c<numChunks;c++)
+				{
+					chunks[c].m_leftIndex = leftIndex;
+					chunks[c].m_rightIndex = rightIndex;
+					for (int b=0;b<m_numBins;b++)
+					{
+						if (b<=m_bestBin)
+							leftIndex += chunks[c].m_bins[b].m_count;
+						else
+							rightIndex += chunks[c].m_bins[b].m_count;
+					}
+				}
+				runPass(PASS_SCATTER,chunks,numChunks);
+			}
+		}
+
+		int mid;
+		if (m_bestBin>=0)
+		{
+			mid = m_begin+left.m_bounds.m_count;
+			left.m_buffer = 1-m_buffer;
+			right.m_buffer = 1-m_buffer;
+		}
+		else
+		{
+			mid = m_begin+(m_end-m_begin)/2;
+			calcBounds(m_buffer,m_begin,mid,left.m_bounds);
+			calcBounds(m_buffer,mid,m_end,right.m_bounds);
+			left.m_buffer = m_buffer;
+			right.m_buffer = m_buffer;
+		}
+		left.m_begin = range.m_begin;
+		left.m_end = mid;
+		left.m_nodeIndex = range.m_nodeIndex+1;
+		right.m_begin = mid;
+		right.m_end = range.m_end;
+		right.m_nodeIndex = range.m_nodeIndex+2*(mid-range.m_begin);
+	}
+
+	void	setInternalNode(const btBvhSahRange& range)
+	{
+		const int escapeIndex = 2*(range.m_end-range.m_begin)-1;
+		if (m_quantizedNodes)
+		{
+			btQuantizedBvhNode& node = m_quantizedNodes[range.m_nodeIndex];
+			m_bvh->quantize(&node.m_quantizedAabbMin[0],range.m_bounds.m_aabbMin,0);
+			m_bvh->quantize(&node.m_quantizedAabbMax[0],range.m_bounds.m_aabbMax,1);
+			node.m_escapeIndexOrTriangleIndex = -escapeIndex;
+		}
+		else
+		{
+			btOptimizedBvhNode& node = m_nodes[range.m_nodeIndex];
+			node.m_aabbMinOrg = range.m_bounds.m_aabbMin;
+			node.m_aabbMaxOrg = range.m_bounds.m_aabbMax;
+			node.m_escapeIndex = escapeIndex;
+		}
+	}
+
+	void	setLeafNode(int nodeIndex,int buffer,int position)
+	{
+		const int leafIndex = m_leaves[buffer][position].m_leafIndex;
+		if (m_quantizedNodes)
+		{
+			m_quantizedNodes[nodeIndex] = m_quantizedLeafNodes[leafIndex];
+		}
+		else
+		{
+			m_nodes[nodeIndex] = m_leafNodes[leafIndex];
+		}
+	}
+
+	///builds the subtree of range. A subtree of n leaves has 2n-1 nodes in depth first order, so the node index of every
+	///range is known before its siblings are built. With deferredRanges, ranges of at most maxRangeSize leaves are added
+	///to deferredRanges instead of being built
+	void	buildRange(const btBvhSahRange& range,btAlignedObjectArray<btBvhSahRange>& stack,btAlignedObjectArray<btBvhSahRange>* deferredRanges,int maxRangeSize)
+	{
+		stack.resize(0);
+		stack.push_back(range);
+		while (stack.size())
+		{
+			const btBvhSahRange cur = stack[stack.size()-1];
+			stack.pop_back();
+			const int numLeaves = cur.m_end-cur.m_begin;
+			if (numLeaves==1)
+			{
+				setLeafNode(cur.m_nodeIndex,cur.m_buffer,cur.m_begin);
+				continue;
+			}
+			if (deferredRanges && numLeaves<=maxRangeSize)
+			{
+				deferredRanges->push_back(cur);
+				continue;
+			}
+			setInternalNode(cur);
+			if (numLeaves==2)
+			{
+				setLeafNode(cur.m_nodeIndex+1,cur.m_buffer,cur.m_begin);
+				setLeafNode(cur.m_nodeIndex+2,cur.m_buffer,cur.m_begin+1);
+				continue;
+			}
+			btBvhSahRange left,right;
+			split(cur,left,right);
+			stack.push_back(right);
+			stack.push_back(left);
+		}
+	}
+};
+
+///builds the deferred ranges of btQuantizedBvh::buildTreeBinnedSah, each with a copy of the builder
+struct btBvhSahTaskLoop : public btIParallelForBody
+{
+	const btBvhSahBuilder*						m_builder;
+	const btAlignedObjectArray<btBvhSahRange>*	m_tasks;
+
+	virtual void forLoop(int iBegin,int iEnd) const
+	{
+		btBvhSahBuilder builder = *m_builder;
+		btAlignedObjectArray<btBvhSahRange> stack;
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			builder.buildRange((*m_tasks)[i],stack,0,0);
+		}
+	}
+};
+
+void	btQuantizedBvh::buildTreeBinnedSah(int numLeafNodes)
+{
+	m_curNodeIndex = 0;
+	if (numLeafNodes<=0)
+		return;
+
+	btAlignedObjectArray<btBvhSahLeaf> leaves;
+	btAlignedObjectArray<btBvhSahLeaf> scratch;
+	btAlignedObjectArray<unsigned char> leafBin;
+	leaves.resize(numLeafNodes);
+	scratch.resize(numLeafNodes);
+	leafBin.resize(numLeafNodes);
+
+	btBvhSahBuilder builder;
+	builder.m_bvh = this;
+	builder.m_quantizedLeafNodes = m_useQuantization ? &m_quantizedLeafNodes[0] : 0;
+	builder.m_leafNodes = m_useQuantization ? 0 : &m_leafNodes[0];
+	builder.m_quantizedNodes = m_useQuantization ? &m_quantizedContiguousNodes[0] : 0;
+	builder.m_nodes = m_useQuantization ? 0 : &m_contiguousNodes[0];
+	builder.m_leaves[0] = &leaves[0];
+	builder.m_leaves[1] = &scratch[0];
+	builder.m_leafBin = &leafBin[0];
+	builder.m_begin = 0;
+	builder.m_end = numLeafNodes;
+
+	btAlignedObjectArray<btBvhSahChunk> chunks;
+	chunks.resize((numLeafNodes+BT_BVH_SAH_CHUNK_SIZE-1)/BT_BVH_SAH_CHUNK_SIZE);
+	builder.runPass(btBvhSahBuilder::PASS_PREPARE,&chunks[0],chunks.size());
+
+	btBvhSahRange root;
+	root.m_bounds = chunks[0].m_bins[0];
+	for (int c=1;c<chunks.size();c++)
+	{
+		root.m_bounds.merge(chunks[c].m_bins[0]);
+	}
+	root.m_begin = 0;
+	root.m_end = numLeafNodes;
+	root.m_buffer = 0;
+	root.m_nodeIndex = 0;
+
+	//split the top of the tree here, with parallel splits for large ranges, then build the ranges below in parallel
+	btAlignedObjectArray<btBvhSahRange> tasks;
+	btAlignedObjectArray<btBvhSahRange> stack;
+	builder.buildRange(root,stack,&tasks,BT_BVH_SAH_TASK_SIZE);
+
+	btBvhSahTaskLoop taskLoop;
+	taskLoop.m_builder = &builder;
+	taskLoop.m_tasks = &tasks;
+	btParallelFor(0,tasks.size(),1,taskLoop);
+
+	m_curNodeIndex = 2*numLeafNodes-1;
+
+	if (m_useQuantization)
+	{
+		//add the subtree headers in the order of buildTree, which adds the children of a node bigger than
+		//MAX_SUBTREE_SIZE_IN_BYTES after the headers of both child subtrees: that is the reverse of this preorder walk
+		btAlignedObjectArray<int> largeNodes;
+		btAlignedObjectArray<int> nodeStack;
+		nodeStack.push_back(0);
+		while (nodeStack.size())
+		{
+			const int nodeIndex = nodeStack[nodeStack.size()-1];
+			nodeStack.pop_back();
+			const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+			if (node.isLeafNode() || node.getEscapeIndex()*static_cast<int>(sizeof(btQuantizedBvhNode))<=MAX_SUBTREE_SIZE_IN_BYTES)
+				continue;
+			largeNodes.push_back(nodeIndex);
+			const int leftChildNodeIndex = nodeIndex+1;
+			const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[leftChildNodeIndex];
+			nodeStack.push_back(leftChildNodeIndex);
+			nodeStack.push_back(leftChildNodeIndex+(leftChildNode.isLeafNode() ? 1 : leftChildNode.getEscapeIndex()));
+		}
+		for (int i=largeNodes.size()-1;i>=0;i--)
+		{
+			const int leftChildNodeIndex = largeNodes[i]+1;
+			const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[leftChildNodeIndex];
+			updateSubtreeHeaders(leftChildNodeIndex,leftChildNodeIndex+(leftChildNode.isLeafNode() ? 1 : leftChildNode.getEscapeIndex()));
+		}
+	}
+}
+
 
 
 void	btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
@@ -682,6 +1182,125 @@ void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback*
 
 }
 
+void	btQuantizedBvh::walkStacklessQuantizedTreeAgainstRayPacket(btNodeRayPacketCallback* nodeCallback, const btVector3* raySources, const btVector3* rayTargets, int numRays, int startNodeIndex,int endNodeIndex) const
+{
+	btAssert(m_useQuantization);
+	btAssert(numRays>0 && numRays<=4);
+
+	btRayPacket packet;
+	unsigned short int quantizedQueryAabbMin[4][3];
+	unsigned short int quantizedQueryAabbMax[4][3];
+	int i;
+	for (i=0;i<numRays;i++)
+	{
+		//same ray setup as walkStacklessQuantizedTreeAgainstRay, so each lane sees the same bounds tests
+		const btVector3& raySource = raySources[i];
+		const btVector3& rayTarget = rayTargets[i];
+		btVector3 rayDirection = (rayTarget-raySource);
+		rayDirection.normalize ();
+		btScalar lambda_max = rayDirection.dot(rayTarget-raySource);
+		rayDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0];
+		rayDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1];
+		rayDirection[2] = rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2];
+		unsigned int sign[3] = { rayDirection[0] < 0.0, rayDirection[1] < 0.0, rayDirection[2] < 0.0};
+		packet.setRay(i,raySource,rayDirection,sign,lambda_max);
+
+		btVector3 rayAabbMin = raySource;
+		btVector3 rayAabbMax = raySource;
+		rayAabbMin.setMin(rayTarget);
+		rayAabbMax.setMax(rayTarget);
+		quantizeWithClamp(quantizedQueryAabbMin[i],rayAabbMin,0);
+		quantizeWithClamp(quantizedQueryAabbMax[i],rayAabbMax,1);
+	}
+	packet.setNumRays(numRays);
+#ifdef BT_USE_SSE_RAY_PACKET
+	//quantized query boxes of the rays as one lane per ray, unused lanes repeat the last ray
+	__m128i queryAabbMin[3];
+	__m128i queryAabbMax[3];
+	for (int j=0;j<3;j++)
+	{
+		queryAabbMin[j] = _mm_set_epi32(quantizedQueryAabbMin[btMin(3,numRays-1)][j],quantizedQueryAabbMin[btMin(2,numRays-1)][j],quantizedQueryAabbMin[btMin(1,numRays-1)][j],quantizedQueryAabbMin[0][j]);
+		queryAabbMax[j] = _mm_set_epi32(quantizedQueryAabbMax[btMin(3,numRays-1)][j],quantizedQueryAabbMax[btMin(2,numRays-1)][j],quantizedQueryAabbMax[btMin(1,numRays-1)][j],quantizedQueryAabbMax[0][j]);
+	}
+	//unQuantize with one division for the three axes, the same float operations per lane
+	const __m128 quantization = _mm_setr_ps(m_bvhQuantization.getX(),m_bvhQuantization.getY(),m_bvhQuantization.getZ(),1.f);
+	const __m128 bvhAabbMin = _mm_setr_ps(m_bvhAabbMin.getX(),m_bvhAabbMin.getY(),m_bvhAabbMin.getZ(),0.f);
+#endif
+
+	//subtrees that some rays entered, with the end index of the subtree and the rays that were active before it
+	int subtreeEnd[128];
+	int subtreeMask[128];
+	int depth = 0;
+	int activeMask = (1<<numRays)-1;
+
+	int curIndex = startNodeIndex;
+	const btQuantizedBvhNode* rootNode = &m_quantizedContiguousNodes[startNodeIndex];
+	while (curIndex < endNodeIndex)
+	{
+#ifdef BT_USE_SSE_RAY_PACKET
+		__m128i separated = _mm_setzero_si128();
+		for (int j=0;j<3;j++)
+		{
+			separated = _mm_or_si128(separated,_mm_cmpgt_epi32(queryAabbMin[j],_mm_set1_epi32(rootNode->m_quantizedAabbMax[j])));
+			separated = _mm_or_si128(separated,_mm_cmpgt_epi32(_mm_set1_epi32(rootNode->m_quantizedAabbMin[j]),queryAabbMax[j]));
+		}
+		const int boxMask = activeMask & ~_mm_movemask_ps(_mm_castsi128_ps(separated));
+#else
+		int boxMask = 0;
+		for (i=0;i<numRays;i++)
+		{
+			if (((activeMask>>i)&1) && testQuantizedAabbAgainstQuantizedAabb(quantizedQueryAabbMin[i],quantizedQueryAabbMax[i],rootNode->m_quantizedAabbMin,rootNode->m_quantizedAabbMax))
+				boxMask |= 1<<i;
+		}
+#endif
+		int hitMask = 0;
+		if (boxMask)
+		{
+#ifdef BT_USE_SSE_RAY_PACKET
+			const __m128i node = _mm_loadu_si128((const __m128i*)rootNode);
+			const __m128i quantizedMin = _mm_unpacklo_epi16(node,_mm_setzero_si128());
+			const __m128i quantizedMax = _mm_unpacklo_epi16(_mm_srli_si128(node,6),_mm_setzero_si128());
+			const __m128 boundsMin = _mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(quantizedMin),quantization),bvhAabbMin);
+			const __m128 boundsMax = _mm_add_ps(_mm_div_ps(_mm_cvtepi32_ps(quantizedMax),quantization),bvhAabbMin);
+			hitMask = boxMask & btRayAabbPacket(packet,boundsMin,boundsMax,0.0f);
+#else
+			btVector3 bounds[2];
+			bounds[0] = unQuantize(rootNode->m_quantizedAabbMin);
+			bounds[1] = unQuantize(rootNode->m_quantizedAabbMax);
+			hitMask = boxMask & btRayAabbPacket(packet,bounds,0.0f);
+#endif
+		}
+
+		if (rootNode->isLeafNode())
+		{
+			if (hitMask)
+			{
+				nodeCallback->processNode(rootNode->getPartId(),rootNode->getTriangleIndex(),hitMask);
+			}
+			rootNode++;
+			curIndex++;
+		} else if (hitMask)
+		{
+			btAssert(depth<128);
+			subtreeEnd[depth] = curIndex + rootNode->getEscapeIndex();
+			subtreeMask[depth] = activeMask;
+			depth++;
+			activeMask = hitMask;
+			rootNode++;
+			curIndex++;
+		} else
+		{
+			int escapeIndex = rootNode->getEscapeIndex();
+			rootNode += escapeIndex;
+			curIndex += escapeIndex;
+		}
+		while (depth && subtreeEnd[depth-1]==curIndex)
+		{
+			activeMask = subtreeMask[--depth];
+		}
+	}
+}
+
 void	btQuantizedBvh::walkStacklessQuantizedTree(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax,int startNodeIndex,int endNodeIndex) const
 {
 	btAssert(m_useQuantization);
@@ -777,6 +1396,12 @@ void	btQuantizedBvh::reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallb
 }
 
 
+void	btQuantizedBvh::reportRayPacketOverlappingNodex(btNodeRayPacketCallback* nodeCallback, const btVector3* raySources, const btVector3* rayTargets, int numRays) const
+{
+	btAssert(m_useQuantization);
+	walkStacklessQuantizedTreeAgainstRayPacket(nodeCallback, raySources, rayTargets, numRays, 0, m_curNodeIndex);
+}
+
 void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const
 {
 	//always use stackless
@@ -1152,6 +1777,134 @@ btQuantizedBvh *btQuantizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, un
 	return bvh;
 }
 
+static bool btIsSerializedVectorFinite(const btVector3& v)
+{
+	for (int i=0;i<3;i++)
+	{
+		if (!(btFabs(v[i])<=BT_LARGE_FLOAT))
+			return false;
+	}
+	return true;
+}
+
+///nodes written by serialize, with the leaf test and escape index of btQuantizedBvhNode and btOptimizedBvhNode
+struct btSerializedQuantizedNodes
+{
+	const btQuantizedBvhNode* m_nodes;
+
+	bool isLeaf(int i) const { return m_nodes[i].m_escapeIndexOrTriangleIndex>=0; }
+	long long escapeIndex(int i) const { return -(long long)m_nodes[i].m_escapeIndexOrTriangleIndex; }
+	int partId(int i) const { return m_nodes[i].getPartId(); }
+	int triangleIndex(int i) const { return m_nodes[i].getTriangleIndex(); }
+};
+
+struct btSerializedOptimizedNodes
+{
+	const btOptimizedBvhNode* m_nodes;
+
+	bool isLeaf(int i) const { return m_nodes[i].m_escapeIndex==-1; }
+	long long escapeIndex(int i) const { return m_nodes[i].m_escapeIndex; }
+	int partId(int i) const { return m_nodes[i].m_subPart; }
+	int triangleIndex(int i) const { return m_nodes[i].m_triangleIndex; }
+};
+
+///true if nodes is one tree of nodeCount nodes: every internal node is followed by its left subtree and then its right subtree,
+///and its escape index is the size of the subtree. Leaves have to reference existing triangles
+template <typename Nodes>
+static bool btIsSerializedTreeValid(const Nodes& nodes, int nodeCount, int numParts, const int *numTrianglesPerPart)
+{
+	for (int i=0;i<nodeCount;i++)
+	{
+		if (nodes.isLeaf(i))
+		{
+			const int partId = nodes.partId(i);
+			const int triangleIndex = nodes.triangleIndex(i);
+			if (partId<0 || partId>=numParts || triangleIndex<0 || triangleIndex>=numTrianglesPerPart[partId])
+				return false;
+			continue;
+		}
+		const long long size = nodes.escapeIndex(i);
+		if (size<3 || size>nodeCount-i)
+			return false;
+		const int left = i+1;
+		const long long leftSize = nodes.isLeaf(left) ? 1 : nodes.escapeIndex(left);
+		if (leftSize<1 || left+leftSize>=i+size)
+			return false;
+		const int right = int(left+leftSize);
+		const long long rightSize = nodes.isLeaf(right) ? 1 : nodes.escapeIndex(right);
+		if (1+leftSize+rightSize!=size)
+			return false;
+	}
+	if (nodeCount>0)
+	{
+		const long long rootSize = nodes.isLeaf(0) ? 1 : nodes.escapeIndex(0);
+		if (rootSize!=nodeCount)
+			return false;
+	}
+	return true;
+}
+
+bool btQuantizedBvh::isValidSerializedBuffer(const void *i_alignedDataBuffer, unsigned int i_dataBufferSize, int i_numParts, const int *i_numTrianglesPerPart)
+{
+	if (i_alignedDataBuffer == NULL || i_dataBufferSize < sizeof(btQuantizedBvh) || i_numParts < 0)
+	{
+		return false;
+	}
+	const btQuantizedBvh *bvh = (const btQuantizedBvh *)i_alignedDataBuffer;
+	//a bool with another value than 0 or 1 is undefined behaviour, read the byte instead
+	const unsigned char useQuantization = *(const unsigned char *)&bvh->m_useQuantization;
+	const int nodeCount = bvh->m_curNodeIndex;
+	const int subtreeHeaderCount = bvh->m_subtreeHeaderCount;
+	if (useQuantization > 1 || nodeCount < 0 || subtreeHeaderCount < 0 ||
+		(bvh->m_traversalMode != TRAVERSAL_STACKLESS && bvh->m_traversalMode != TRAVERSAL_STACKLESS_CACHE_FRIENDLY && bvh->m_traversalMode != TRAVERSAL_RECURSIVE))
+	{
+		return false;
+	}
+	//only quantization uses the bvh aabb, an unquantized bvh keeps the infinite aabb of the constructor
+	if (useQuantization &&
+		(!btIsSerializedVectorFinite(bvh->m_bvhAabbMin) || !btIsSerializedVectorFinite(bvh->m_bvhAabbMax) || !btIsSerializedVectorFinite(bvh->m_bvhQuantization)))
+	{
+		return false;
+	}
+
+	const unsigned long long nodeSize = useQuantization ? sizeof(btQuantizedBvhNode) : sizeof(btOptimizedBvhNode);
+	const unsigned long long bufferSize = sizeof(btQuantizedBvh) + getAlignmentSerializationPadding() +
+		(unsigned long long)subtreeHeaderCount * sizeof(btBvhSubtreeInfo) + (unsigned long long)nodeCount * nodeSize;
+	if (bufferSize > i_dataBufferSize)
+	{
+		return false;
+	}
+
+	const unsigned char *nodeData = (const unsigned char *)i_alignedDataBuffer + sizeof(btQuantizedBvh);
+	if (useQuantization)
+	{
+		btSerializedQuantizedNodes nodes;
+		nodes.m_nodes = (const btQuantizedBvhNode *)nodeData;
+		if (!btIsSerializedTreeValid(nodes, nodeCount, i_numParts, i_numTrianglesPerPart))
+			return false;
+	}
+	else
+	{
+		btSerializedOptimizedNodes nodes;
+		nodes.m_nodes = (const btOptimizedBvhNode *)nodeData;
+		if (!btIsSerializedTreeValid(nodes, nodeCount, i_numParts, i_numTrianglesPerPart))
+			return false;
+	}
+
+	//the subtree headers of refit and the cache friendly traversal have to cover whole subtrees
+	const btBvhSubtreeInfo *subtreeHeaders = (const btBvhSubtreeInfo *)(nodeData + (unsigned long long)nodeCount * nodeSize);
+	for (int i = 0; i < subtreeHeaderCount; i++)
+	{
+		const btBvhSubtreeInfo &subtree = subtreeHeaders[i];
+		if (subtree.m_rootNodeIndex < 0 || subtree.m_rootNodeIndex >= nodeCount || subtree.m_subtreeSize < 1 ||
+			subtree.m_subtreeSize > nodeCount - subtree.m_rootNodeIndex)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
 // Constructor that prevents btVector3's default constructor from being called
 btQuantizedBvh::btQuantizedBvh(btQuantizedBvh &self, bool /* ownsMemory */) :
 m_bvhAabbMin(self.m_bvhAabbMin),
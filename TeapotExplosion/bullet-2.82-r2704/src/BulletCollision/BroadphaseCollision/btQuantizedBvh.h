@@ -157,6 +157,15 @@ public:
 	virtual void processNode(int subPart, int triangleIndex) = 0;
 };
 
+///btNodeRayPacketCallback gets the leaves of a reportRayPacketOverlappingNodex query, bit i of rayMask is set when ray i reaches the leaf
+class btNodeRayPacketCallback
+{
+public:
+	virtual ~btNodeRayPacketCallback() {};
+
+	virtual void processNode(int subPart, int triangleIndex, int rayMask) = 0;
+};
+
 #include "LinearMath/btAlignedAllocator.h"
 #include "LinearMath/btAlignedObjectArray.h"
 
@@ -181,6 +190,12 @@ public:
 		TRAVERSAL_RECURSIVE
 	};
 
+	enum btBuildMethod
+	{
+		BUILD_MEAN_SPLIT = 0,	//split at the mean center along the axis of largest variance, see buildTree
+		BUILD_BINNED_SAH		//split by a binned surface area heuristic, the subtrees are built in parallel with btParallelFor
+	};
+
 protected:
 
 
@@ -308,12 +323,16 @@ protected:
 	int	calcSplittingAxis(int startIndex,int endIndex);
 
 	int	sortAndCalcSplittingIndex(int startIndex,int endIndex,int splitAxis);
+
+	///builds the same node layout as buildTree(0,numLeafNodes), including the subtree headers, with BUILD_BINNED_SAH
+	void	buildTreeBinnedSah(int numLeafNodes);
 	
 	void	walkStacklessTree(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
 	void	walkStacklessQuantizedTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, int startNodeIndex,int endNodeIndex) const;
 	void	walkStacklessQuantizedTree(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax,int startNodeIndex,int endNodeIndex) const;
 	void	walkStacklessTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, int startNodeIndex,int endNodeIndex) const;
+	void	walkStacklessQuantizedTreeAgainstRayPacket(btNodeRayPacketCallback* nodeCallback, const btVector3* raySources, const btVector3* rayTargets, int numRays, int startNodeIndex,int endNodeIndex) const;
 
 	///tree traversal designed for small-memory processors like PS3 SPU
 	void	walkStacklessQuantizedTreeCacheFriendly(btNodeOverlapCallback* nodeCallback,unsigned short int* quantizedQueryAabbMin,unsigned short int* quantizedQueryAabbMax) const;
@@ -342,12 +361,15 @@ public:
 	void	setQuantizationValues(const btVector3& bvhAabbMin,const btVector3& bvhAabbMax,btScalar quantizationMargin=btScalar(1.0));
 	QuantizedNodeArray&	getLeafNodeArray() {			return	m_quantizedLeafNodes;	}
 	///buildInternal is expert use only: assumes that setQuantizationValues and LeafNodeArray are initialized
-	void	buildInternal();
+	void	buildInternal(btBuildMethod buildMethod=BUILD_MEAN_SPLIT);
 	///***************************************** expert/internal use only *************************
 
 	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const;
+	///reportRayPacketOverlappingNodex walks the tree once for up to four rays, each ray gets the leaves reportRayOverlappingNodex would report, in the same order.
+	///Only quantized trees are supported, the caller falls back to reportRayOverlappingNodex otherwise
+	void	reportRayPacketOverlappingNodex(btNodeRayPacketCallback* nodeCallback, const btVector3* raySources, const btVector3* rayTargets, int numRays) const;
 
 		SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point,int isMax) const
 	{
@@ -469,6 +491,11 @@ public:
 	///deSerializeInPlace loads and initializes a BVH from a buffer in memory 'in place'
 	static btQuantizedBvh *deSerializeInPlace(void *i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian);
 
+	///checks a native endian buffer written by serialize before deSerializeInPlace trusts it, for buffers from untrusted files.
+	///The nodes and subtree headers have to fit in i_dataBufferSize, escape indices and subtree headers have to describe a tree
+	///inside the node array, and leaves may only reference triangles of i_numParts parts of i_numTrianglesPerPart[part] triangles
+	static bool isValidSerializedBuffer(const void *i_alignedDataBuffer, unsigned int i_dataBufferSize, int i_numParts, const int *i_numTrianglesPerPart);
+
 	static unsigned int getAlignmentSerializationPadding();
 //////////////////////////////////////////////////////////////////////
 
@@ -0,0 +1,387 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btCollisionDispatcherMt.h"
+
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/BroadphaseCollision/btOverlappingPairCache.h"
+#include "LinearMath/btPoolAllocator.h"
+#include "LinearMath/btPoolAllocatorMt.h"
+#include "BulletCollision/CollisionDispatch/btCollisionConfiguration.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
+#include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
+
+extern int gNumManifold;
+
+
+class btManifoldRecordSortPredicate
+{
+public:
+	bool operator() (const btCollisionDispatcherMt::btManifoldRecord& a, const btCollisionDispatcherMt::btManifoldRecord& b) const
+	{
+		if (a.m_pairIndex != b.m_pairIndex)
+			return a.m_pairIndex < b.m_pairIndex;
+		return a.m_serial < b.m_serial;
+	}
+};
+
+
+class btCollisionDispatcherMtPairLoop : public btIParallelForBody
+{
+	btCollisionDispatcherMt*	m_dispatcher;
+	btBroadphasePair*			m_pairs;
+	const btDispatcherInfo&		m_dispatchInfo;
+
+public:
+
+	btCollisionDispatcherMtPairLoop(btCollisionDispatcherMt* dispatcher, btBroadphasePair* pairs, const btDispatcherInfo& dispatchInfo)
+	:m_dispatcher(dispatcher),
+	m_pairs(pairs),
+	m_dispatchInfo(dispatchInfo)
+	{
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		m_dispatcher->processPairs(m_pairs, iBegin, iEnd, m_dispatchInfo);
+	}
+};
+
+
+btCollisionDispatcherMt::btCollisionDispatcherMt(btCollisionConfiguration* collisionConfiguration, int grainSize)
+:btCollisionDispatcher(collisionConfiguration),
+m_grainSize(btMax(1, grainSize)),
+m_batchUpdating(false),
+m_gjkBatchMinPairs(0)
+{
+	//the pools of the collision configuration give the element and slab sizes, they are not used otherwise
+	void* mem = btAlignedAlloc(sizeof(btPoolAllocatorMt),16);
+	m_collisionAlgorithmPoolMt = new(mem) btPoolAllocatorMt(m_collisionAlgorithmPoolAllocator->getElementSize(),m_collisionAlgorithmPoolAllocator->getMaxCount());
+	mem = btAlignedAlloc(sizeof(btPoolAllocatorMt),16);
+	m_persistentManifoldPoolMt = new(mem) btPoolAllocatorMt(m_persistentManifoldPoolAllocator->getElementSize(),m_persistentManifoldPoolAllocator->getMaxCount());
+
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		m_threadManifolds[i] = 0;
+	}
+}
+
+btCollisionDispatcherMt::~btCollisionDispatcherMt()
+{
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		btThreadLocalManifolds* manifolds = m_threadManifolds[i];
+		if (!manifolds)
+			continue;
+		manifolds->~btThreadLocalManifolds();
+		btAlignedFree(manifolds);
+		m_threadManifolds[i] = 0;
+	}
+
+	m_persistentManifoldPoolMt->~btPoolAllocatorMt();
+	btAlignedFree(m_persistentManifoldPoolMt);
+	m_collisionAlgorithmPoolMt->~btPoolAllocatorMt();
+	btAlignedFree(m_collisionAlgorithmPoolMt);
+}
+
+btCollisionDispatcherMt::btThreadLocalManifolds* btCollisionDispatcherMt::getThreadManifolds()
+{
+	//only the thread of an index creates its lists, mergeManifolds reads them after the parallel loop
+	unsigned int threadIndex = btGetCurrentThreadIndex();
+	btThreadLocalManifolds* manifolds = m_threadManifolds[threadIndex];
+	if (!manifolds)
+	{
+		void* mem = btAlignedAlloc(sizeof(btThreadLocalManifolds),16);
+		manifolds = new(mem) btThreadLocalManifolds();
+		manifolds->m_pairIndex = 0;
+		manifolds->m_serial = 0;
+		m_threadManifolds[threadIndex] = manifolds;
+	}
+	return manifolds;
+}
+
+btPersistentManifold*	btCollisionDispatcherMt::getNewManifold(const btCollisionObject* body0,const btCollisionObject* body1)
+{
+	//optional relative contact breaking threshold, turned on by default (use setDispatcherFlags to switch off feature for improved performance)
+	btScalar contactBreakingThreshold =  (m_dispatcherFlags & btCollisionDispatcher::CD_USE_RELATIVE_CONTACT_BREAKING_THRESHOLD) ?
+		btMin(body0->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold) , body1->getCollisionShape()->getContactBreakingThreshold(gContactBreakingThreshold))
+		: gContactBreakingThreshold ;
+
+	btScalar contactProcessingThreshold = btMin(body0->getContactProcessingThreshold(),body1->getContactProcessingThreshold());
+
+	//the pool grows by another slab when it runs out, unless dynamic allocation is disabled
+	void* mem = m_persistentManifoldPoolMt->allocate((m_dispatcherFlags&CD_DISABLE_CONTACTPOOL_DYNAMIC_ALLOCATION)==0);
+	if (!mem)
+	{
+		btAssert(0);
+		//make sure to increase the m_defaultMaxPersistentManifoldPoolSize in the btDefaultCollisionConstructionInfo/btDefaultCollisionConfiguration
+		return 0;
+	}
+	btPersistentManifold* manifold = new(mem) btPersistentManifold (body0,body1,0,contactBreakingThreshold,contactProcessingThreshold);
+
+	if (m_batchUpdating)
+	{
+		//added to m_manifoldsPtr by mergeManifolds
+		btThreadLocalManifolds* manifolds = getThreadManifolds();
+		btManifoldRecord record;
+		record.m_pairIndex = manifolds->m_pairIndex;
+		record.m_serial = manifolds->m_serial++;
+		record.m_manifold = manifold;
+		manifold->m_index1a = -1;
+		manifolds->m_newManifolds.push_back(record);
+	} else
+	{
+		gNumManifold++;
+		manifold->m_index1a = m_manifoldsPtr.size();
+		m_manifoldsPtr.push_back(manifold);
+	}
+
+	return manifold;
+}
+
+void btCollisionDispatcherMt::releaseManifold(btPersistentManifold* manifold)
+{
+	if (m_batchUpdating)
+	{
+		//the contacts go away now, the manifold itself after mergeManifolds
+		clearManifold(manifold);
+
+		btThreadLocalManifolds* manifolds = getThreadManifolds();
+		btManifoldRecord record;
+		record.m_pairIndex = manifolds->m_pairIndex;
+		record.m_serial = manifolds->m_serial++;
+		record.m_manifold = manifold;
+		manifolds->m_releasedManifolds.push_back(record);
+	} else
+	{
+		releaseManifoldInternal(manifold);
+	}
+}
+
+void btCollisionDispatcherMt::releaseManifoldInternal(btPersistentManifold* manifold)
+{
+	gNumManifold--;
+
+	clearManifold(manifold);
+
+	int findIndex = manifold->m_index1a;
+	btAssert(findIndex >= 0 && findIndex < m_manifoldsPtr.size());
+	m_manifoldsPtr.swap(findIndex,m_manifoldsPtr.size()-1);
+	m_manifoldsPtr[findIndex]->m_index1a = findIndex;
+	m_manifoldsPtr.pop_back();
+
+	manifold->~btPersistentManifold();
+	m_persistentManifoldPoolMt->freeMemory(manifold);
+}
+
+void btCollisionDispatcherMt::mergeManifolds()
+{
+	m_mergedManifolds.resize(0);
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		btThreadLocalManifolds* manifolds = m_threadManifolds[i];
+		if (!manifolds)
+			continue;
+		for (int j=0;j<manifolds->m_newManifolds.size();j++)
+		{
+			m_mergedManifolds.push_back(manifolds->m_newManifolds[j]);
+		}
+		manifolds->m_newManifolds.resize(0);
+	}
+
+	m_mergedManifolds.quickSort(btManifoldRecordSortPredicate());
+	for (int i=0;i<m_mergedManifolds.size();i++)
+	{
+		btPersistentManifold* manifold = m_mergedManifolds[i].m_manifold;
+		gNumManifold++;
+		manifold->m_index1a = m_manifoldsPtr.size();
+		m_manifoldsPtr.push_back(manifold);
+	}
+
+	m_mergedManifolds.resize(0);
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		btThreadLocalManifolds* manifolds = m_threadManifolds[i];
+		if (!manifolds)
+			continue;
+		for (int j=0;j<manifolds->m_releasedManifolds.size();j++)
+		{
+			m_mergedManifolds.push_back(manifolds->m_releasedManifolds[j]);
+		}
+		manifolds->m_releasedManifolds.resize(0);
+		manifolds->m_serial = 0;
+	}
+
+	m_mergedManifolds.quickSort(btManifoldRecordSortPredicate());
+	for (int i=0;i<m_mergedManifolds.size();i++)
+	{
+		releaseManifoldInternal(m_mergedManifolds[i].m_manifold);
+	}
+	m_mergedManifolds.resize(0);
+}
+
+void btCollisionDispatcherMt::computeGjkBatch(btThreadLocalManifolds* manifolds, btBroadphasePair* pairs, int iBegin, int iEnd)
+{
+	btAlignedObjectArray<btGjkBatchRecord>& records = manifolds->m_gjkBatchRecords;
+	btAlignedObjectArray<btGjkBatchInput>& pairInputs = manifolds->m_gjkBatchPairInputs;
+	btAlignedObjectArray<btGjkBatchInput>& inputs = manifolds->m_gjkBatchInputs;
+	btAlignedObjectArray<int>& batchPairs = manifolds->m_gjkBatchPairs;
+	records.resizeNoInitialize(0);
+	pairInputs.resizeNoInitialize(0);
+	inputs.resizeNoInitialize(0);
+	batchPairs.resizeNoInitialize(0);
+
+	for (int i=iBegin;i<iEnd;i++)
+	{
+		const btBroadphasePair& pair = pairs[i];
+		if (!pair.m_algorithm)
+			continue;
+		const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(pair.m_pProxy0->m_clientObject);
+		const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(pair.m_pProxy1->m_clientObject);
+		const int shapeType0 = colObj0->getCollisionShape()->getShapeType();
+		const int shapeType1 = colObj1->getCollisionShape()->getShapeType();
+		if (!btGjkBatch::isBatchShapeType(shapeType0) || !btGjkBatch::isBatchShapeType(shapeType1) || !needsCollision(colObj0,colObj1))
+			continue;
+
+		btCollisionObjectWrapper obj0Wrap(0,colObj0->getCollisionShape(),colObj0,colObj0->getWorldTransform(),-1,-1);
+		btCollisionObjectWrapper obj1Wrap(0,colObj1->getCollisionShape(),colObj1,colObj1->getWorldTransform(),-1,-1);
+		btGjkBatchInput& input = pairInputs.expandNonInitializing();
+		if (!pair.m_algorithm->getGjkBatchInput(&obj0Wrap,&obj1Wrap,input))
+		{
+			pairInputs.pop_back();
+			continue;
+		}
+
+		//insertion sort by the shape types, stable so the pairs of a kernel stay in pair order
+		btGjkBatchRecord record;
+		record.m_shapeTypes = shapeType0*MAX_BROADPHASE_COLLISION_TYPES + shapeType1;
+		record.m_pairIndex = i;
+		record.m_inputIndex = pairInputs.size()-1;
+		records.push_back(record);
+		int r = records.size()-1;
+		while (r>0 && records[r-1].m_shapeTypes>record.m_shapeTypes)
+		{
+			records[r] = records[r-1];
+			r--;
+		}
+		records[r] = record;
+	}
+	if (records.size()<m_gjkBatchMinPairs)
+		return;
+
+	int begin = 0;
+	while (begin<records.size())
+	{
+		int end = begin+1;
+		while (end<records.size() && records[end].m_shapeTypes==records[begin].m_shapeTypes)
+		{
+			end++;
+		}
+		if (end-begin>=m_gjkBatchMinPairs)
+		{
+			for (int r=begin;r<end;r++)
+			{
+				inputs.push_back(pairInputs[records[r].m_inputIndex]);
+				batchPairs.push_back(records[r].m_pairIndex);
+			}
+		}
+		begin = end;
+	}
+
+	int numInputs = inputs.size();
+	if (numInputs==0)
+		return;
+
+	btAlignedObjectArray<btGjkBatchOutput>& outputs = manifolds->m_gjkBatchOutputs;
+	outputs.resize(numInputs);
+	btGjkBatch::computeClosestPoints(&inputs[0],&outputs[0],numInputs);
+
+	for (int i=0;i<numInputs;i++)
+	{
+		pairs[batchPairs[i]].m_algorithm->setGjkBatchOutput(&outputs[i]);
+	}
+}
+
+void btCollisionDispatcherMt::clearGjkBatch(btThreadLocalManifolds* manifolds, btBroadphasePair* pairs)
+{
+	btAlignedObjectArray<int>& batchPairs = manifolds->m_gjkBatchPairs;
+	for (int i=0;i<batchPairs.size();i++)
+	{
+		btCollisionAlgorithm* algorithm = pairs[batchPairs[i]].m_algorithm;
+		if (algorithm)
+			algorithm->setGjkBatchOutput(0);
+	}
+	batchPairs.resize(0);
+}
+
+void btCollisionDispatcherMt::processPairs(btBroadphasePair* pairs, int iBegin, int iEnd, const btDispatcherInfo& dispatchInfo)
+{
+	btThreadLocalManifolds* manifolds = getThreadManifolds();
+	btNearCallback nearCallback = getNearCallback();
+	for (int blockBegin=iBegin;blockBegin<iEnd;blockBegin+=BT_GJK_BATCH_BLOCK_SIZE)
+	{
+		int blockEnd = btMin(blockBegin+BT_GJK_BATCH_BLOCK_SIZE, iEnd);
+		if (m_gjkBatchMinPairs>0)
+		{
+			computeGjkBatch(manifolds,pairs,blockBegin,blockEnd);
+		}
+		for (int i=blockBegin;i<blockEnd;i++)
+		{
+			manifolds->m_pairIndex = i;
+			(*nearCallback)(pairs[i],*this,dispatchInfo);
+		}
+		clearGjkBatch(manifolds,pairs);
+	}
+}
+
+void	btCollisionDispatcherMt::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher)
+{
+	//the time of impact is a shared minimum, keep the continuous query sequential
+	if (dispatchInfo.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE)
+	{
+		btCollisionDispatcher::dispatchAllCollisionPairs(pairCache,dispatchInfo,dispatcher);
+		return;
+	}
+
+	int numPairs = pairCache->getNumOverlappingPairs();
+	if (numPairs==0)
+		return;
+
+	btBroadphasePair* pairs = pairCache->getOverlappingPairArrayPtr();
+
+	m_batchUpdating = true;
+	btCollisionDispatcherMtPairLoop pairLoop(this,pairs,dispatchInfo);
+	btParallelFor(0,numPairs,m_grainSize,pairLoop);
+	m_batchUpdating = false;
+
+	mergeManifolds();
+}
+
+void* btCollisionDispatcherMt::allocateCollisionAlgorithm(int size)
+{
+	if (size>m_collisionAlgorithmPoolMt->getElementSize())
+	{
+		return	btAlignedAlloc(static_cast<size_t>(size), 16);
+	}
+	return m_collisionAlgorithmPoolMt->allocate();
+}
+
+void btCollisionDispatcherMt::freeCollisionAlgorithm(void* ptr)
+{
+	//falls back to btAlignedFree for memory that is not part of the pool
+	m_collisionAlgorithmPoolMt->freeMemory(ptr);
+}
@@ -0,0 +1,151 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_DISPATCHER_MT_H
+#define BT_COLLISION_DISPATCHER_MT_H
+
+#include "BulletCollision/CollisionDispatch/btCollisionDispatcher.h"
+#include "LinearMath/btThreads.h"
+#include "LinearMath/btPoolAllocatorMt.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkBatch.h"
+
+///number of pairs gathered into one btGjkBatch, small enough that the pairs are still in the cache for the near callbacks
+#define BT_GJK_BATCH_BLOCK_SIZE 64
+
+
+///btCollisionDispatcherMt is a drop-in replacement for btCollisionDispatcher that runs the near callback
+///of the overlapping pairs on the task scheduler set with btSetTaskScheduler, grainSize pairs at a time.
+///Collision algorithms and manifolds come from btPoolAllocatorMt pools that grow by a slab of the size of the
+///collision configuration pools when they run out, and the manifolds created or released during a dispatch are
+///merged into the manifold array afterwards in pair order, so the result does not depend on the number of
+///threads or on how the pairs were scheduled.
+///The pairs are processed in blocks of BT_GJK_BATCH_BLOCK_SIZE. With setGjkBatchMinPairs, before the near callbacks of a block
+///run, the closest points of its pairs of convex shapes that btGjkBatch supports are computed with btGjkBatch, for each pair
+///of shape types that has at least getGjkBatchMinPairs pairs in the block, and handed to the collision algorithms with
+///btCollisionAlgorithm::setGjkBatchOutput. It is off by default, worlds of boxes and spheres are faster without it.
+///A custom near callback, gContactAddedCallback and gContactDestroyedCallback are called from several
+///threads at once and must be thread-safe. Continuous dispatch runs sequentially.
+class btCollisionDispatcherMt : public btCollisionDispatcher
+{
+public:
+
+	struct btGjkBatchRecord
+	{
+		int		m_shapeTypes;
+		int		m_pairIndex;
+		int		m_inputIndex;
+	};
+
+	struct btManifoldRecord
+	{
+		int						m_pairIndex;
+		int						m_serial;
+		btPersistentManifold*	m_manifold;
+	};
+
+	struct btThreadLocalManifolds
+	{
+		int						m_pairIndex;
+		int						m_serial;
+		btAlignedObjectArray<btManifoldRecord>	m_newManifolds;
+		btAlignedObjectArray<btManifoldRecord>	m_releasedManifolds;
+
+		//the btGjkBatch of the block of pairs the thread processes
+		btAlignedObjectArray<btGjkBatchRecord>	m_gjkBatchRecords;
+		btAlignedObjectArray<btGjkBatchInput>	m_gjkBatchPairInputs;
+		btAlignedObjectArray<btGjkBatchInput>	m_gjkBatchInputs;
+		btAlignedObjectArray<btGjkBatchOutput>	m_gjkBatchOutputs;
+		btAlignedObjectArray<int>				m_gjkBatchPairs;
+	};
+
+protected:
+
+	int							m_grainSize;
+	bool						m_batchUpdating;
+
+	btPoolAllocatorMt*			m_collisionAlgorithmPoolMt;
+	btPoolAllocatorMt*			m_persistentManifoldPoolMt;
+
+	btThreadLocalManifolds*		m_threadManifolds[BT_MAX_THREAD_COUNT];
+
+	btAlignedObjectArray<btManifoldRecord>	m_mergedManifolds;
+
+	int							m_gjkBatchMinPairs;
+
+	btThreadLocalManifolds*	getThreadManifolds();
+
+	void	mergeManifolds();
+
+	void	releaseManifoldInternal(btPersistentManifold* manifold);
+
+	///computes the closest points of the convex pairs in [iBegin,iEnd) with btGjkBatch and gives them to their collision algorithms
+	void	computeGjkBatch(btThreadLocalManifolds* manifolds, btBroadphasePair* pairs, int iBegin, int iEnd);
+
+	///clears the closest points that were not used by processCollision
+	void	clearGjkBatch(btThreadLocalManifolds* manifolds, btBroadphasePair* pairs);
+
+public:
+
+	btCollisionDispatcherMt(btCollisionConfiguration* collisionConfiguration, int grainSize = 40);
+
+	virtual ~btCollisionDispatcherMt();
+
+	virtual btPersistentManifold*	getNewManifold(const btCollisionObject* b0,const btCollisionObject* b1);
+
+	virtual void releaseManifold(btPersistentManifold* manifold);
+
+	virtual void	dispatchAllCollisionPairs(btOverlappingPairCache* pairCache,const btDispatcherInfo& dispatchInfo,btDispatcher* dispatcher) ;
+
+	virtual	void* allocateCollisionAlgorithm(int size);
+
+	virtual	void freeCollisionAlgorithm(void* ptr);
+
+	void	processPairs(btBroadphasePair* pairs, int iBegin, int iEnd, const btDispatcherInfo& dispatchInfo);
+
+	int		getGrainSize() const
+	{
+		return m_grainSize;
+	}
+
+	void	setGrainSize(int grainSize)
+	{
+		m_grainSize = btMax(1, grainSize);
+	}
+
+	int		getGjkBatchMinPairs() const
+	{
+		return m_gjkBatchMinPairs;
+	}
+
+	///pairs of shape types with fewer pairs than this in a block are left to the collision algorithms, 0 (the default) turns
+	///btGjkBatch off and BT_GJK_BATCH_WIDTH batches every pair type that fills its lanes
+	void	setGjkBatchMinPairs(int minPairs)
+	{
+		m_gjkBatchMinPairs = minPairs;
+	}
+
+	///allocation counters of the manifold and collision algorithm pools, call between simulation steps
+	void	getPersistentManifoldPoolStats(btPoolAllocatorStats& stats) const
+	{
+		m_persistentManifoldPoolMt->getStats(stats);
+	}
+
+	void	getCollisionAlgorithmPoolStats(btPoolAllocatorStats& stats) const
+	{
+		m_collisionAlgorithmPoolMt->getStats(stats);
+	}
+};
+
+#endif //BT_COLLISION_DISPATCHER_MT_H
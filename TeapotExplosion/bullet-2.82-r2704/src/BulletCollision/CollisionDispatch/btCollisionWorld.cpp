@@ -21,6 +21,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h" //for raycasting
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h" //for raycasting
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h"
@@ -32,6 +33,7 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btThreads.h"
 #include "BulletCollision/CollisionShapes/btConvexPolyhedron.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
 #include "BulletCollision/Gimpact/btGImpactShape.h"
@@ -144,9 +146,8 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject,sho
 
 
 
-void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
+void	btCollisionWorld::computeAabb(const btCollisionObject* colObj, btVector3& minAabb, btVector3& maxAabb) const
 {
-	btVector3 minAabb,maxAabb;
 	colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb,maxAabb);
 	//need to increase the aabb for contact thresholds
 	btVector3 contactThreshold(gContactBreakingThreshold,gContactBreakingThreshold,gContactBreakingThreshold);
@@ -162,36 +163,78 @@ void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 		minAabb.setMin(minAabb2);
 		maxAabb.setMax(maxAabb2);
 	}
+}
 
-	btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
-
+bool	btCollisionWorld::checkAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb)
+{
 	//moving objects should be moderately sized, probably something wrong if not
 	if ( colObj->isStaticObject() || ((maxAabb-minAabb).length2() < btScalar(1e12)))
 	{
+		return true;
+	}
+
+	//something went wrong, investigate
+	//this assert is unwanted in 3D modelers (danger of loosing work)
+	colObj->setActivationState(DISABLE_SIMULATION);
+
+	static bool reportMe = true;
+	if (reportMe && m_debugDrawer)
+	{
+		reportMe = false;
+		m_debugDrawer->reportErrorWarning("Overflow in AABB, object removed from simulation");
+		m_debugDrawer->reportErrorWarning("If you can reproduce this, please email bugs@continuousphysics.com\n");
+		m_debugDrawer->reportErrorWarning("Please include above information, your Platform, version of OS.\n");
+		m_debugDrawer->reportErrorWarning("Thanks.\n");
+	}
+	return false;
+}
+
+void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
+{
+	btVector3 minAabb,maxAabb;
+	computeAabb(colObj,minAabb,maxAabb);
+
+	if (checkAabb(colObj,minAabb,maxAabb))
+	{
+		btBroadphaseInterface* bp = (btBroadphaseInterface*)m_broadphasePairCache;
 		bp->setAabb(colObj->getBroadphaseHandle(),minAabb,maxAabb, m_dispatcher1);
-	} else
+	}
+}
+
+///objects per task of the parallel aabb computation
+#define BT_UPDATE_AABBS_GRAIN_SIZE 64
+
+class btCollisionWorldAabbLoop : public btIParallelForBody
+{
+	const btCollisionWorld*		m_world;
+	btCollisionObject* const*	m_objects;
+	btVector3*					m_aabbMins;
+	btVector3*					m_aabbMaxs;
+
+public:
+
+	btCollisionWorldAabbLoop(const btCollisionWorld* world, btCollisionObject* const* objects, btVector3* aabbMins, btVector3* aabbMaxs)
+	:m_world(world),
+	m_objects(objects),
+	m_aabbMins(aabbMins),
+	m_aabbMaxs(aabbMaxs)
 	{
-		//something went wrong, investigate
-		//this assert is unwanted in 3D modelers (danger of loosing work)
-		colObj->setActivationState(DISABLE_SIMULATION);
+	}
 
-		static bool reportMe = true;
-		if (reportMe && m_debugDrawer)
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
 		{
-			reportMe = false;
-			m_debugDrawer->reportErrorWarning("Overflow in AABB, object removed from simulation");
-			m_debugDrawer->reportErrorWarning("If you can reproduce this, please email bugs@continuousphysics.com\n");
-			m_debugDrawer->reportErrorWarning("Please include above information, your Platform, version of OS.\n");
-			m_debugDrawer->reportErrorWarning("Thanks.\n");
+			m_world->computeAabb(m_objects[i],m_aabbMins[i],m_aabbMaxs[i]);
 		}
 	}
-}
+};
 
 void	btCollisionWorld::updateAabbs()
 {
 	BT_PROFILE("updateAabbs");
 
-	btTransform predictedTrans;
+	m_updateAabbObjects.resize(0);
 	for ( int i=0;i<m_collisionObjects.size();i++)
 	{
 		btCollisionObject* colObj = m_collisionObjects[i];
@@ -199,9 +242,41 @@ void	btCollisionWorld::updateAabbs()
 		//only update aabb of active objects
 		if (m_forceUpdateAllAabbs || colObj->isActive())
 		{
-			updateSingleAabb(colObj);
+			m_updateAabbObjects.push_back(colObj);
+		}
+	}
+
+	int numObjects = m_updateAabbObjects.size();
+	if (numObjects==0)
+	{
+		return;
+	}
+	m_updateAabbMins.resize(numObjects);
+	m_updateAabbMaxs.resize(numObjects);
+
+	//getAabb of the shapes only reads the shape and the transform, so the objects are independent
+	btCollisionWorldAabbLoop aabbLoop(this,&m_updateAabbObjects[0],&m_updateAabbMins[0],&m_updateAabbMaxs[0]);
+	btParallelFor(0,numObjects,BT_UPDATE_AABBS_GRAIN_SIZE,aabbLoop);
+
+	//drop the objects with an overflowing aabb and compact the rest in place, in object order
+	m_updateAabbProxies.resize(numObjects);
+	int numProxies = 0;
+	for (int i=0;i<numObjects;i++)
+	{
+		btCollisionObject* colObj = m_updateAabbObjects[i];
+		if (checkAabb(colObj,m_updateAabbMins[i],m_updateAabbMaxs[i]))
+		{
+			m_updateAabbProxies[numProxies] = colObj->getBroadphaseHandle();
+			m_updateAabbMins[numProxies] = m_updateAabbMins[i];
+			m_updateAabbMaxs[numProxies] = m_updateAabbMaxs[i];
+			numProxies++;
 		}
 	}
+
+	if (numProxies)
+	{
+		m_broadphasePairCache->setAabbs(&m_updateAabbProxies[0],&m_updateAabbMins[0],&m_updateAabbMaxs[0],numProxies,m_dispatcher1);
+	}
 }
 
 
@@ -387,6 +462,15 @@ void	btCollisionWorld::rayTestSingleInternal(const btTransform& rayFromTrans,con
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 				triangleMesh->performRaycast(&rcb,rayFromLocal,rayToLocal);
 			}
+			else if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE)
+			{
+				///walks the cells under the ray instead of the cells in the aabb of the ray, performRaycast is virtual for derived terrains
+				btHeightfieldTerrainShape* heightfield = (btHeightfieldTerrainShape*)collisionShape;
+
+				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObjectWrap->getCollisionObject(),heightfield,colObjWorldTransform);
+				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
+				heightfield->performRaycast(&rcb,rayFromLocal,rayToLocal);
+			}
 			else if(collisionShape->getShapeType()==GIMPACT_SHAPE_PROXYTYPE)
 			{
 				btGImpactMeshShape* concaveShape = (btGImpactMeshShape*)collisionShape;
@@ -944,6 +1028,329 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 
 }
 
+void	btCollisionWorld::rayTestBatchSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans, btCollisionObject* collisionObject, RayResultCallback& resultCallback) const
+{
+	rayTestSingle(rayFromTrans,rayToTrans,
+		collisionObject,
+		collisionObject->getCollisionShape(),
+		collisionObject->getWorldTransform(),
+		resultCallback);
+}
+
+///rays per packet and packets per task of rayTestBatch
+#define BT_RAY_BATCH_PACKET_SIZE 4
+#define BT_RAY_BATCH_GRAIN_SIZE 16
+
+///a proxy that the broadphase reported for some rays of a rayTestBatch packet
+struct	btBatchRayCandidate
+{
+	const btBroadphaseProxy*	m_proxy;
+	int							m_rayMask;
+};
+
+///ClosestRayResultCallback that can be reused for the rays of one packet after the other
+struct	btBatchRayResultCallback : public btCollisionWorld::ClosestRayResultCallback
+{
+	btBatchRayResultCallback()
+		:ClosestRayResultCallback(btVector3(0,0,0),btVector3(0,0,0))
+	{
+	}
+};
+
+///broadphase callback of one ray of a rayTestBatch packet. Unlike btSingleRayCallback it only collects the proxies,
+///the rays of the packet are tested against them afterwards, so a mesh hit by several rays can be walked once
+struct	btBatchRayCallback : public btBroadphaseRayCallback
+{
+	btTransform	m_rayFromTrans;
+	btTransform	m_rayToTrans;
+	btBatchRayResultCallback	m_resultCallback;
+	btAlignedObjectArray<btBatchRayCandidate>*	m_candidates;
+	int			m_rayBit;
+
+	void	init(const btVector3& rayFromWorld,const btVector3& rayToWorld,short int collisionFilterGroup,short int collisionFilterMask,btAlignedObjectArray<btBatchRayCandidate>* candidates,int rayBit)
+	{
+		m_rayFromTrans.setIdentity();
+		m_rayFromTrans.setOrigin(rayFromWorld);
+		m_rayToTrans.setIdentity();
+		m_rayToTrans.setOrigin(rayToWorld);
+
+		//same setup as btSingleRayCallback, so the broadphase reports the same proxies
+		btVector3 rayDir = (rayToWorld-rayFromWorld);
+
+		rayDir.normalize ();
+		m_rayDirectionInverse[0] = rayDir[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[0];
+		m_rayDirectionInverse[1] = rayDir[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[1];
+		m_rayDirectionInverse[2] = rayDir[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDir[2];
+		m_signs[0] = m_rayDirectionInverse[0] < 0.0;
+		m_signs[1] = m_rayDirectionInverse[1] < 0.0;
+		m_signs[2] = m_rayDirectionInverse[2] < 0.0;
+
+		m_lambda_max = rayDir.dot(rayToWorld-rayFromWorld);
+
+		m_resultCallback.m_rayFromWorld = rayFromWorld;
+		m_resultCallback.m_rayToWorld = rayToWorld;
+		m_resultCallback.m_closestHitFraction = btScalar(1.);
+		m_resultCallback.m_collisionObject = 0;
+		m_resultCallback.m_collisionFilterGroup = collisionFilterGroup;
+		m_resultCallback.m_collisionFilterMask = collisionFilterMask;
+		m_candidates = candidates;
+		m_rayBit = rayBit;
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		//the rays of a packet report a proxy one after the other, those reports end up in one candidate
+		btAlignedObjectArray<btBatchRayCandidate>& candidates = *m_candidates;
+		if (candidates.size() && candidates[candidates.size()-1].m_proxy==proxy)
+		{
+			candidates[candidates.size()-1].m_rayMask |= m_rayBit;
+		} else
+		{
+			btBatchRayCandidate candidate;
+			candidate.m_proxy = proxy;
+			candidate.m_rayMask = m_rayBit;
+			candidates.push_back(candidate);
+		}
+		return true;
+	}
+};
+
+///forwards the triangle hits of one ray of a packet to its result callback, as the BridgeTriangleRaycastCallback of rayTestSingleInternal
+struct	btBatchTriangleRaycastCallback : public btTriangleRaycastCallback
+{
+	btCollisionWorld::RayResultCallback* m_resultCallback;
+	const btCollisionObject*	m_collisionObject;
+	const btTransform*	m_colObjWorldTransform;
+
+	btBatchTriangleRaycastCallback()
+		:btTriangleRaycastCallback(btVector3(0,0,0),btVector3(0,0,0))
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex )
+	{
+		btCollisionWorld::LocalShapeInfo	shapeInfo;
+		shapeInfo.m_shapePart = partId;
+		shapeInfo.m_triangleIndex = triangleIndex;
+
+		btVector3 hitNormalWorld = m_colObjWorldTransform->getBasis() * hitNormalLocal;
+
+		btCollisionWorld::LocalRayResult rayResult
+			(m_collisionObject,
+			&shapeInfo,
+			hitNormalWorld,
+			hitFraction);
+
+		bool	normalInWorldSpace = true;
+		return m_resultCallback->addSingleResult(rayResult,normalInWorldSpace);
+	}
+};
+
+///tests the rays of candidate.m_rayMask against the object of the candidate
+static void	rayTestBatchCandidate(const btCollisionWorld* world,btBatchRayCallback* rayCallbacks,const btBatchRayCandidate& candidate)
+{
+	btCollisionObject*	collisionObject = (btCollisionObject*)candidate.m_proxy->m_clientObject;
+	int		rays[BT_RAY_BATCH_PACKET_SIZE];
+	int		numRays = 0;
+	for (int i=0,rayMask=candidate.m_rayMask;rayMask;i++,rayMask>>=1)
+	{
+		btCollisionWorld::RayResultCallback& resultCallback = rayCallbacks[i].m_resultCallback;
+		///a ray stops testing objects once its closestHitFraction reached zero
+		if ((rayMask&1) && resultCallback.m_closestHitFraction != btScalar(0.f) && resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+		{
+			rays[numRays++] = i;
+		}
+	}
+
+	const btCollisionShape* collisionShape = collisionObject->getCollisionShape();
+	if (numRays>1 && collisionShape->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+	{
+		//same local rays and triangle callbacks as rayTestSingleInternal, with one walk of the bvh for all rays
+		btBvhTriangleMeshShape* triangleMesh = (btBvhTriangleMeshShape*)collisionShape;
+		const btTransform& colObjWorldTransform = collisionObject->getWorldTransform();
+		btTransform worldTocollisionObject = colObjWorldTransform.inverse();
+
+		btVector3 rayFromLocal[BT_RAY_BATCH_PACKET_SIZE];
+		btVector3 rayToLocal[BT_RAY_BATCH_PACKET_SIZE];
+		btBatchTriangleRaycastCallback	rcb[BT_RAY_BATCH_PACKET_SIZE];
+		btTriangleCallback*	triangleCallbacks[BT_RAY_BATCH_PACKET_SIZE];
+		for (int j=0;j<numRays;j++)
+		{
+			btBatchRayCallback& rayCallback = rayCallbacks[rays[j]];
+			rayFromLocal[j] = worldTocollisionObject * rayCallback.m_rayFromTrans.getOrigin();
+			rayToLocal[j] = worldTocollisionObject * rayCallback.m_rayToTrans.getOrigin();
+			rcb[j].m_from = rayFromLocal[j];
+			rcb[j].m_to = rayToLocal[j];
+			rcb[j].m_flags = rayCallback.m_resultCallback.m_flags;
+			rcb[j].m_hitFraction = rayCallback.m_resultCallback.m_closestHitFraction;
+			rcb[j].m_resultCallback = &rayCallback.m_resultCallback;
+			rcb[j].m_collisionObject = collisionObject;
+			rcb[j].m_colObjWorldTransform = &colObjWorldTransform;
+			triangleCallbacks[j] = &rcb[j];
+		}
+		triangleMesh->performRaycastPacket(triangleCallbacks,rayFromLocal,rayToLocal,numRays);
+	} else
+	{
+		for (int j=0;j<numRays;j++)
+		{
+			btBatchRayCallback& rayCallback = rayCallbacks[rays[j]];
+			world->rayTestBatchSingle(rayCallback.m_rayFromTrans,rayCallback.m_rayToTrans,collisionObject,rayCallback.m_resultCallback);
+		}
+	}
+}
+
+class btCollisionWorldRayBatchLoop : public btIParallelForBody
+{
+	const btCollisionWorld*		m_world;
+	btBroadphaseInterface*		m_broadphase;
+	const btVector3*			m_rayFromWorld;
+	const btVector3*			m_rayToWorld;
+	const int*					m_order;
+	int							m_numRays;
+	btCollisionWorld::ClosestRayResult*	m_results;
+	short int					m_collisionFilterGroup;
+	short int					m_collisionFilterMask;
+
+public:
+
+	btCollisionWorldRayBatchLoop(const btCollisionWorld* world, btBroadphaseInterface* broadphase, const btVector3* rayFromWorld, const btVector3* rayToWorld, const int* order, int numRays, btCollisionWorld::ClosestRayResult* results, short int collisionFilterGroup, short int collisionFilterMask)
+	:m_world(world),
+	m_broadphase(broadphase),
+	m_rayFromWorld(rayFromWorld),
+	m_rayToWorld(rayToWorld),
+	m_order(order),
+	m_numRays(numRays),
+	m_results(results),
+	m_collisionFilterGroup(collisionFilterGroup),
+	m_collisionFilterMask(collisionFilterMask)
+	{
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		btAlignedObjectArray<btBatchRayCandidate>	candidates;
+		btBatchRayCallback	rayCallbacks[BT_RAY_BATCH_PACKET_SIZE];
+		btBroadphaseRayCallback*	rayCallbackPtrs[BT_RAY_BATCH_PACKET_SIZE];
+		btVector3	rayFromWorld[BT_RAY_BATCH_PACKET_SIZE];
+		btVector3	rayToWorld[BT_RAY_BATCH_PACKET_SIZE];
+		for (int packet=iBegin;packet<iEnd;packet++)
+		{
+			const int first = packet*BT_RAY_BATCH_PACKET_SIZE;
+			const int numRays = btMin(BT_RAY_BATCH_PACKET_SIZE,m_numRays-first);
+			int i;
+			for (i=0;i<numRays;i++)
+			{
+				const int index = m_order[first+i];
+				rayFromWorld[i] = m_rayFromWorld[index];
+				rayToWorld[i] = m_rayToWorld[index];
+				rayCallbacks[i].init(rayFromWorld[i],rayToWorld[i],m_collisionFilterGroup,m_collisionFilterMask,&candidates,1<<i);
+				rayCallbackPtrs[i] = &rayCallbacks[i];
+			}
+
+			candidates.resize(0);
+#ifndef USE_BRUTEFORCE_RAYBROADPHASE
+			m_broadphase->rayTestPacket(rayFromWorld,rayToWorld,rayCallbackPtrs,numRays);
+#else
+			for (int j=0;j<m_world->getNumCollisionObjects();j++)
+			{
+				for (i=0;i<numRays;i++)
+				{
+					rayCallbacks[i].process(m_world->getCollisionObjectArray()[j]->getBroadphaseHandle());
+				}
+			}
+#endif //USE_BRUTEFORCE_RAYBROADPHASE
+			for (int c=0;c<candidates.size();c++)
+			{
+				rayTestBatchCandidate(m_world,rayCallbacks,candidates[c]);
+			}
+
+			for (i=0;i<numRays;i++)
+			{
+				const btBatchRayResultCallback& resultCallback = rayCallbacks[i].m_resultCallback;
+				btCollisionWorld::ClosestRayResult& result = m_results[m_order[first+i]];
+				result.m_collisionObject = resultCallback.m_collisionObject;
+				result.m_hitNormalWorld = resultCallback.m_hitNormalWorld;
+				result.m_hitPointWorld = resultCallback.m_hitPointWorld;
+				result.m_closestHitFraction = resultCallback.m_closestHitFraction;
+			}
+		}
+	}
+};
+
+///sort key of a ray of rayTestBatch, the octant of the direction above the Morton code of the origin
+struct	btBatchRayKey
+{
+	unsigned int	m_key;
+	int				m_index;
+};
+
+struct	btBatchRayKeySortPredicate
+{
+	bool operator() (const btBatchRayKey& a,const btBatchRayKey& b) const
+	{
+		return((a.m_key<b.m_key)||((a.m_key==b.m_key)&&(a.m_index<b.m_index)));
+	}
+};
+
+static inline unsigned int	spreadBits9(unsigned int x)
+{
+	x&=0x1ff;
+	x=(x|(x<<16))&0x030000ff;
+	x=(x|(x<<8))&0x0300f00f;
+	x=(x|(x<<4))&0x030c30c3;
+	x=(x|(x<<2))&0x09249249;
+	return(x);
+}
+
+void	btCollisionWorld::rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, ClosestRayResult* results, short int collisionFilterGroup, short int collisionFilterMask) const
+{
+	BT_PROFILE("rayTestBatch");
+	if (numRays<=0)
+	{
+		return;
+	}
+
+	//rays with the same direction octant and nearby origins end up in the same packet and walk the same nodes
+	btVector3 originMin = rayFromWorld[0];
+	btVector3 originMax = rayFromWorld[0];
+	int i;
+	for (i=1;i<numRays;i++)
+	{
+		originMin.setMin(rayFromWorld[i]);
+		originMax.setMax(rayFromWorld[i]);
+	}
+	const btVector3 extent = originMax-originMin;
+	const btVector3 scale(	btScalar(511)/btMax(extent.x(),SIMD_EPSILON),
+							btScalar(511)/btMax(extent.y(),SIMD_EPSILON),
+							btScalar(511)/btMax(extent.z(),SIMD_EPSILON));
+	btAlignedObjectArray<btBatchRayKey> keys;
+	keys.resize(numRays);
+	for (i=0;i<numRays;i++)
+	{
+		const btVector3 q = (rayFromWorld[i]-originMin)*scale;
+		const btVector3 dir = rayToWorld[i]-rayFromWorld[i];
+		const unsigned int x = (unsigned int)btMax(btScalar(0),btMin(q.x(),btScalar(511)));
+		const unsigned int y = (unsigned int)btMax(btScalar(0),btMin(q.y(),btScalar(511)));
+		const unsigned int z = (unsigned int)btMax(btScalar(0),btMin(q.z(),btScalar(511)));
+		const unsigned int octant = (dir.x()<btScalar(0) ? 1 : 0)|(dir.y()<btScalar(0) ? 2 : 0)|(dir.z()<btScalar(0) ? 4 : 0);
+		keys[i].m_key = (octant<<27)|spreadBits9(x)|(spreadBits9(y)<<1)|(spreadBits9(z)<<2);
+		keys[i].m_index = i;
+	}
+	keys.quickSort(btBatchRayKeySortPredicate());
+
+	btAlignedObjectArray<int> order;
+	order.resize(numRays);
+	for (i=0;i<numRays;i++)
+	{
+		order[i] = keys[i].m_index;
+	}
+
+	//every packet has its own callbacks and stacks, the results of a ray only depend on the ray
+	const int numPackets = (numRays+BT_RAY_BATCH_PACKET_SIZE-1)/BT_RAY_BATCH_PACKET_SIZE;
+	btCollisionWorldRayBatchLoop rayLoop(this,m_broadphasePairCache,rayFromWorld,rayToWorld,&order[0],numRays,results,collisionFilterGroup,collisionFilterMask);
+	btParallelFor(0,numPackets,BT_RAY_BATCH_GRAIN_SIZE,rayLoop);
+}
+
 
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
@@ -105,6 +105,15 @@ protected:
 	///it is true by default, because it is error-prone (setting the position of static objects wouldn't update their AABB)
 	bool m_forceUpdateAllAabbs;
 
+	///scratch arrays of updateAabbs, the aabbs of the objects to update are computed into separate min and max arrays
+	btAlignedObjectArray<btCollisionObject*>	m_updateAabbObjects;
+	btAlignedObjectArray<btBroadphaseProxy*>	m_updateAabbProxies;
+	btAlignedObjectArray<btVector3>	m_updateAabbMins;
+	btAlignedObjectArray<btVector3>	m_updateAabbMaxs;
+
+	///returns false and disables the object if its aabb is too large, as updateSingleAabb does
+	bool	checkAabb(btCollisionObject* colObj, const btVector3& minAabb, const btVector3& maxAabb);
+
 	void	serializeCollisionObjects(btSerializer* serializer);
 
 public:
@@ -145,8 +154,12 @@ public:
 		return m_dispatcher1;
 	}
 
+	///computes the broadphase aabb of colObj, including the contact breaking threshold and the swept aabb in continuous mode
+	void	computeAabb(const btCollisionObject* colObj, btVector3& minAabb, btVector3& maxAabb) const;
+
 	void	updateSingleAabb(btCollisionObject* colObj);
 
+	///computes the aabbs of the active objects on the task scheduler and hands them to the broadphase with one setAabbs call
 	virtual void	updateAabbs();
 
 	///the computeOverlappingPairs is usually already called by performDiscreteCollisionDetection (or stepSimulation)
@@ -273,6 +286,20 @@ public:
 		}
 	};
 
+	///ClosestRayResult is the result of one ray of rayTestBatch, with the fields a ClosestRayResultCallback fills in
+	struct	ClosestRayResult
+	{
+		const btCollisionObject*	m_collisionObject;
+		btVector3	m_hitNormalWorld;
+		btVector3	m_hitPointWorld;
+		btScalar	m_closestHitFraction;
+
+		bool	hasHit() const
+		{
+			return (m_collisionObject != 0);
+		}
+	};
+
 	struct	AllHitsRayResultCallback : public RayResultCallback
 	{
 		AllHitsRayResultCallback(const btVector3&	rayFromWorld,const btVector3&	rayToWorld)
@@ -444,6 +471,14 @@ public:
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestBatch casts numRays rays and stores in results[i] the hit that rayTest with a ClosestRayResultCallback and the same filter finds for ray i.
+	/// The rays are sorted by direction and origin and cast in packets of four on btParallelFor, so the shapes in the world must allow concurrent ray tests.
+	void	rayTestBatch(const btVector3* rayFromWorld, const btVector3* rayToWorld, int numRays, ClosestRayResult* results, short int collisionFilterGroup=btBroadphaseProxy::DefaultFilter, short int collisionFilterMask=btBroadphaseProxy::AllFilter) const;
+
+	/// rayTestBatchSingle tests one ray of rayTestBatch against one object, worlds with their own rayTestSingle override it.
+	/// Triangle meshes hit by several rays of a packet bypass it and go through btBvhTriangleMeshShape::performRaycastPacket
+	virtual void	rayTestBatchSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans, btCollisionObject* collisionObject, RayResultCallback& resultCallback) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
@@ -18,6 +18,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtCompact.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "btManifoldResult.h"
@@ -271,7 +272,15 @@ void btCompoundCollisionAlgorithm::processCollision (const btCollisionObjectWrap
 
 		const ATTRIBUTE_ALIGNED16(btDbvtVolume)	bounds=btDbvtVolume::FromMM(localAabbMin,localAabbMax);
 		//process all children, that overlap with  the given AABB bounds
-		tree->collideTV(tree->m_root,bounds,callback);
+		const btDbvtCompact* compactTree = compoundShape->getCompactAabbTree();
+		if (compactTree)
+		{
+			btDbvtCompactScratch<int> scratch;
+			compactTree->collideTV(bounds,scratch.stack(),callback);
+		} else
+		{
+			tree->collideTV(tree->m_root,bounds,callback);
+		}
 
 	} else
 	{
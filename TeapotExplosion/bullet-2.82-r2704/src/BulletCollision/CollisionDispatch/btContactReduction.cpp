@@ -0,0 +1,379 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btContactReduction.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "LinearMath/btQuickprof.h"
+
+
+static SIMD_FORCE_INLINE bool btLessPair(const btCollisionObject* a0,const btCollisionObject* a1,const btCollisionObject* b0,const btCollisionObject* b1)
+{
+	return a0<b0 || (a0==b0 && a1<b1);
+}
+
+struct btContactReductionEntrySortPredicate
+{
+	bool operator() ( const btContactReductionEntry& a, const btContactReductionEntry& b ) const
+	{
+		if (a.m_body0!=b.m_body0 || a.m_body1!=b.m_body1)
+			return btLessPair(a.m_body0,a.m_body1,b.m_body0,b.m_body1);
+		return a.m_manifoldIndex<b.m_manifoldIndex;
+	}
+};
+
+///the point as seen from the other body, for the manifolds of a pair that have the bodies the other way around
+static void btSwapContactPointBodies(btManifoldPoint& pt)
+{
+	btSwap(pt.m_localPointA,pt.m_localPointB);
+	btSwap(pt.m_positionWorldOnA,pt.m_positionWorldOnB);
+	btSwap(pt.m_partId0,pt.m_partId1);
+	btSwap(pt.m_index0,pt.m_index1);
+	pt.m_normalWorldOnB = -pt.m_normalWorldOnB;
+	//the friction impulses act on body A along the directions
+	pt.m_lateralFrictionDir1 = -pt.m_lateralFrictionDir1;
+	pt.m_lateralFrictionDir2 = -pt.m_lateralFrictionDir2;
+}
+
+static SIMD_FORCE_INLINE bool btSameFeatures(const btManifoldPoint& a,const btManifoldPoint& b)
+{
+	return a.m_partId0==b.m_partId0 && a.m_partId1==b.m_partId1 && a.m_index0==b.m_index0 && a.m_index1==b.m_index1;
+}
+
+
+btContactReduction::btContactReduction()
+:m_persistentPointBias(btScalar(1.2)),
+m_numPointsIn(0),
+m_numPointsOut(0)
+{
+}
+
+btContactReduction::~btContactReduction()
+{
+	clear();
+}
+
+void	btContactReduction::clear()
+{
+	for (int i=0;i<m_mergedPairs.size();i++)
+	{
+		delete m_mergedPairs[i].m_manifold;
+	}
+	m_mergedPairs.resize(0);
+}
+
+int		btContactReduction::findMergedPair(const btCollisionObject* body0,const btCollisionObject* body1) const
+{
+	int low = 0;
+	int high = m_mergedPairs.size();
+	while (low<high)
+	{
+		const int mid = (low+high)>>1;
+		const btContactReductionEntry& pair = m_mergedPairs[mid];
+		if (btLessPair(pair.m_body0,pair.m_body1,body0,body1))
+		{
+			low = mid+1;
+		} else
+		{
+			high = mid;
+		}
+	}
+	if (low<m_mergedPairs.size() && m_mergedPairs[low].m_body0==body0 && m_mergedPairs[low].m_body1==body1)
+		return low;
+	return -1;
+}
+
+btPersistentManifold*	btContactReduction::findMergedManifold(const btCollisionObject* body0,const btCollisionObject* body1) const
+{
+	const int index = findMergedPair(btMin(body0,body1),btMax(body0,body1));
+	return index>=0 ? m_mergedPairs[index].m_manifold : 0;
+}
+
+void	btContactReduction::reduceManifolds(btAlignedObjectArray<btPersistentManifold*>& manifolds)
+{
+	BT_PROFILE("reduceManifolds");
+
+	m_numPointsIn = 0;
+	m_numPointsOut = 0;
+
+	//sort the manifolds holding points by body pair, so the manifolds of a pair are next to each other
+	m_entries.resize(0);
+	int i;
+	for (i=0;i<manifolds.size();i++)
+	{
+		btPersistentManifold* manifold = manifolds[i];
+		if (manifold->getNumContacts()==0)
+			continue;
+		btContactReductionEntry entry;
+		entry.m_body0 = btMin(manifold->getBody0(),manifold->getBody1());
+		entry.m_body1 = btMax(manifold->getBody0(),manifold->getBody1());
+		entry.m_manifold = manifold;
+		entry.m_manifoldIndex = i;
+		m_entries.push_back(entry);
+	}
+	m_entries.quickSort(btContactReductionEntrySortPredicate());
+
+	m_replacements.resize(manifolds.size());
+	for (i=0;i<manifolds.size();i++)
+	{
+		m_replacements[i] = manifolds[i];
+	}
+	m_mergedPairUsed.resize(0);
+	m_mergedPairUsed.resize(m_mergedPairs.size(),false);
+	m_newMergedPairs.resize(0);
+
+	int endPair;
+	for (int startPair=0;startPair<m_entries.size();startPair = endPair)
+	{
+		const btContactReductionEntry& first = m_entries[startPair];
+		for (endPair=startPair+1;endPair<m_entries.size() && m_entries[endPair].m_body0==first.m_body0 && m_entries[endPair].m_body1==first.m_body1;endPair++)
+		{
+		}
+		if (endPair-startPair<2)
+			continue;
+
+		//the manifolds of the pair, in the order of the array
+		m_sources.resize(0);
+		for (i=startPair;i<endPair;i++)
+		{
+			m_sources.push_back(m_entries[i].m_manifold);
+			m_replacements[m_entries[i].m_manifoldIndex] = 0;
+		}
+
+		btPersistentManifold* merged;
+		const int mergedIndex = findMergedPair(first.m_body0,first.m_body1);
+		if (mergedIndex>=0)
+		{
+			merged = m_mergedPairs[mergedIndex].m_manifold;
+			m_mergedPairUsed[mergedIndex] = true;
+		} else
+		{
+			merged = new btPersistentManifold(m_sources[0]->getBody0(),m_sources[0]->getBody1(),0,m_sources[0]->getContactBreakingThreshold(),m_sources[0]->getContactProcessingThreshold());
+		}
+		//the merged manifold of a new pair starts with the impulses of the points of the algorithms, which were solved in the last step
+		mergeManifolds(merged,&m_sources[0],m_sources.size(),mergedIndex<0);
+		m_replacements[first.m_manifoldIndex] = merged;
+
+		btContactReductionEntry pair = first;
+		pair.m_manifold = merged;
+		m_newMergedPairs.push_back(pair);
+	}
+
+	for (i=0;i<m_mergedPairs.size();i++)
+	{
+		if (!m_mergedPairUsed[i])
+		{
+			delete m_mergedPairs[i].m_manifold;
+		}
+	}
+	//the pairs were visited in sorted order
+	m_mergedPairs.resize(0);
+	for (i=0;i<m_newMergedPairs.size();i++)
+	{
+		m_mergedPairs.push_back(m_newMergedPairs[i]);
+	}
+
+	int numManifolds = 0;
+	for (i=0;i<m_replacements.size();i++)
+	{
+		if (m_replacements[i])
+		{
+			manifolds[numManifolds++] = m_replacements[i];
+		}
+	}
+	manifolds.resize(numManifolds);
+}
+
+void	btContactReduction::mergeManifolds(btPersistentManifold* merged,btPersistentManifold** sources,int numSources,bool warmStartFromSources)
+{
+	const btCollisionObject* body0 = sources[0]->getBody0();
+	const btCollisionObject* body1 = sources[0]->getBody1();
+	merged->setBodies(body0,body1);
+	merged->setContactBreakingThreshold(sources[0]->getContactBreakingThreshold());
+	merged->setContactProcessingThreshold(sources[0]->getContactProcessingThreshold());
+	const btScalar breakingThreshold2 = merged->getContactBreakingThreshold()*merged->getContactBreakingThreshold();
+
+	m_candidates.resize(0);
+	m_candidateContinued.resize(0);
+	for (int s=0;s<numSources;s++)
+	{
+		btPersistentManifold* source = sources[s];
+		const bool swapped = source->getBody0()!=body0;
+		for (int j=0;j<source->getNumContacts();j++)
+		{
+			const btManifoldPoint& pt = source->getContactPoint(j);
+			m_numPointsIn++;
+			//the solver skips these points anyway, they would only take the place of useful points
+			if (pt.getDistance()>merged->getContactProcessingThreshold())
+				continue;
+
+			btManifoldPoint candidate = pt;
+			//the user data stays with the point of the algorithm, so a contact destroyed callback runs once
+			candidate.m_userPersistentData = 0;
+			if (swapped)
+			{
+				btSwapContactPointBodies(candidate);
+			}
+
+			//the nearest point of the last patch on the same features
+			int continued = -1;
+			btScalar nearestDistance2 = breakingThreshold2;
+			for (int k=0;k<merged->getNumContacts();k++)
+			{
+				const btManifoldPoint& oldPoint = merged->getContactPoint(k);
+				if (!btSameFeatures(oldPoint,candidate))
+					continue;
+				const btScalar distance2 = (oldPoint.m_localPointA-candidate.m_localPointA).length2();
+				if (distance2<nearestDistance2)
+				{
+					nearestDistance2 = distance2;
+					continued = k;
+				}
+			}
+			if (continued>=0)
+			{
+				const btManifoldPoint& oldPoint = merged->getContactPoint(continued);
+				candidate.m_appliedImpulse = oldPoint.m_appliedImpulse;
+				candidate.m_appliedImpulseLateral1 = oldPoint.m_appliedImpulseLateral1;
+				candidate.m_appliedImpulseLateral2 = oldPoint.m_appliedImpulseLateral2;
+				candidate.m_lateralFrictionInitialized = oldPoint.m_lateralFrictionInitialized;
+				candidate.m_lateralFrictionDir1 = oldPoint.m_lateralFrictionDir1;
+				candidate.m_lateralFrictionDir2 = oldPoint.m_lateralFrictionDir2;
+			} else if (!warmStartFromSources)
+			{
+				//the point of the algorithm was not solved while its pair was merged, its impulses are stale
+				candidate.m_appliedImpulse = 0.f;
+				candidate.m_appliedImpulseLateral1 = 0.f;
+				candidate.m_appliedImpulseLateral2 = 0.f;
+				candidate.m_lateralFrictionInitialized = false;
+			}
+			m_candidates.push_back(candidate);
+			m_candidateContinued.push_back(continued>=0);
+		}
+
+		//the impulses of the pair live in the merged manifold from now on, the points of the algorithm are not solved
+		//while the pair is merged, so they start cold instead of with stale impulses when the pair is released
+		for (int j=0;j<source->getNumContacts();j++)
+		{
+			btManifoldPoint& pt = source->getContactPoint(j);
+			pt.m_appliedImpulse = 0.f;
+			pt.m_appliedImpulseLateral1 = 0.f;
+			pt.m_appliedImpulseLateral2 = 0.f;
+			pt.m_lateralFrictionInitialized = false;
+		}
+	}
+
+	int selected[MANIFOLD_CACHE_SIZE];
+	const int numSelected = selectPatch(selected);
+	merged->clearManifold();
+	merged->setNumContacts(numSelected);
+	for (int i=0;i<numSelected;i++)
+	{
+		merged->getContactPoint(i) = m_candidates[selected[i]];
+	}
+	m_numPointsOut += numSelected;
+}
+
+int		btContactReduction::selectPatch(int* selected)
+{
+	const int numCandidates = m_candidates.size();
+	if (numCandidates<=MANIFOLD_CACHE_SIZE)
+	{
+		for (int i=0;i<numCandidates;i++)
+		{
+			selected[i] = i;
+		}
+		return numCandidates;
+	}
+
+	//the deepest point, a point of the last patch wins a tie
+	int best = 0;
+	for (int i=1;i<numCandidates;i++)
+	{
+		const btScalar distance = m_candidates[i].getDistance();
+		const btScalar bestDistance = m_candidates[best].getDistance();
+		if (distance<bestDistance || (distance==bestDistance && m_candidateContinued[i] && !m_candidateContinued[best]))
+			best = i;
+	}
+	selected[0] = best;
+	const btVector3 p0 = m_candidates[best].getPositionWorldOnB();
+
+	//the point farthest from it
+	btScalar bestScore = 0.f;
+	best = -1;
+	for (int i=0;i<numCandidates;i++)
+	{
+		btScalar score = (m_candidates[i].getPositionWorldOnB()-p0).length2();
+		if (m_candidateContinued[i])
+			score *= m_persistentPointBias;
+		if (score>bestScore)
+		{
+			bestScore = score;
+			best = i;
+		}
+	}
+	if (best<0)
+		return 1;
+	selected[1] = best;
+	const btVector3 p1 = m_candidates[best].getPositionWorldOnB();
+
+	//the point that spans the largest triangle with both
+	bestScore = 0.f;
+	best = -1;
+	for (int i=0;i<numCandidates;i++)
+	{
+		btScalar score = (p1-p0).cross(m_candidates[i].getPositionWorldOnB()-p0).length2();
+		if (m_candidateContinued[i])
+			score *= m_persistentPointBias;
+		if (score>bestScore)
+		{
+			bestScore = score;
+			best = i;
+		}
+	}
+	if (best<0)
+		return 2;
+	selected[2] = best;
+	const btVector3 p2 = m_candidates[best].getPositionWorldOnB();
+
+	//the point farthest outside of one of the edges of the triangle, which adds the most area
+	const btVector3 normal = (p1-p0).cross(p2-p0);
+	const btVector3 corners[3] = {p0,p1,p2};
+	bestScore = 0.f;
+	best = -1;
+	for (int i=0;i<numCandidates;i++)
+	{
+		const btVector3 p = m_candidates[i].getPositionWorldOnB();
+		btScalar outside = 0.f;
+		for (int e=0;e<3;e++)
+		{
+			const btVector3& a = corners[e];
+			const btVector3& b = corners[e<2 ? e+1 : 0];
+			outside = btMin(outside,normal.dot((b-a).cross(p-a)));
+		}
+		btScalar score = -outside;
+		if (m_candidateContinued[i])
+			score *= m_persistentPointBias;
+		if (score>bestScore)
+		{
+			bestScore = score;
+			best = i;
+		}
+	}
+	if (best<0)
+		return 3;
+	selected[3] = best;
+	return 4;
+}
@@ -0,0 +1,105 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_CONTACT_REDUCTION_H
+#define BT_CONTACT_REDUCTION_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
+
+class btCollisionObject;
+class btPersistentManifold;
+
+///a manifold of a body pair, the bodies are ordered by address
+struct btContactReductionEntry
+{
+	const btCollisionObject*	m_body0;
+	const btCollisionObject*	m_body1;
+	btPersistentManifold*		m_manifold;
+	int							m_manifoldIndex;
+};
+
+///btContactReduction merges the contact manifolds of a body pair with more than one manifold, such as the manifolds of the
+///children of a compound shape, into a single manifold of at most MANIFOLD_CACHE_SIZE points for the constraint solver.
+///The patch keeps the deepest point and chooses the others to cover the largest area, favouring the points of the patch of
+///the last step so it doesn't flip between equivalent configurations while the bodies rest on each other.
+///The merged manifolds are kept from one step to the next. A point of the new patch takes the impulses of the nearest point
+///of the old patch on the same features (the part and triangle or child indices) for warm starting, so the impulses of a
+///reduced pair live in its merged manifold and the manifolds of its collision algorithms are not solved.
+///While a pair is merged, getAppliedImpulse of the points of its dispatcher manifolds returns 0, read the impulses from
+///findMergedManifold instead. The points of a released pair start without warm starting.
+///See btSimulationIslandManager::setContactReduction.
+class btContactReduction
+{
+	btAlignedObjectArray<btContactReductionEntry>	m_entries;
+	btAlignedObjectArray<btPersistentManifold*>		m_replacements;
+	///sorted by body pair, from the last call to reduceManifolds
+	btAlignedObjectArray<btContactReductionEntry>	m_mergedPairs;
+	btAlignedObjectArray<btContactReductionEntry>	m_newMergedPairs;
+	btAlignedObjectArray<bool>						m_mergedPairUsed;
+	btAlignedObjectArray<btPersistentManifold*>		m_sources;
+
+	btAlignedObjectArray<btManifoldPoint>			m_candidates;
+	btAlignedObjectArray<int>						m_candidateContinued;	// the candidate continues a point of the last patch
+
+	btScalar	m_persistentPointBias;
+	int			m_numPointsIn;
+	int			m_numPointsOut;
+
+	int		findMergedPair(const btCollisionObject* body0,const btCollisionObject* body1) const;
+	void	mergeManifolds(btPersistentManifold* merged,btPersistentManifold** sources,int numSources,bool warmStartFromSources);
+	int		selectPatch(int* selected);
+
+public:
+
+	btContactReduction();
+	virtual ~btContactReduction();
+
+	///replaces the manifolds of each body pair with more than one manifold holding points by its merged manifold, in place of the
+	///first manifold of the pair. The merged manifolds of the pairs that don't show up are released.
+	void	reduceManifolds(btAlignedObjectArray<btPersistentManifold*>& manifolds);
+
+	///the merged manifold of a body pair from the last reduceManifolds, or 0 if the pair was not merged
+	btPersistentManifold*	findMergedManifold(const btCollisionObject* body0,const btCollisionObject* body1) const;
+
+	///releases all merged manifolds, the next reduceManifolds starts without warm starting data
+	void	clear();
+
+	///the scores of the candidates that continue a point of the last patch are multiplied by this factor, 1.2 by default
+	void	setPersistentPointBias(btScalar bias)
+	{
+		m_persistentPointBias = bias;
+	}
+	btScalar	getPersistentPointBias() const
+	{
+		return m_persistentPointBias;
+	}
+
+	///the number of points of the merged pairs before and after the last reduceManifolds
+	int		getNumPointsIn() const
+	{
+		return m_numPointsIn;
+	}
+	int		getNumPointsOut() const
+	{
+		return m_numPointsOut;
+	}
+	int		getNumMergedManifolds() const
+	{
+		return m_mergedPairs.size();
+	}
+};
+
+#endif //BT_CONTACT_REDUCTION_H
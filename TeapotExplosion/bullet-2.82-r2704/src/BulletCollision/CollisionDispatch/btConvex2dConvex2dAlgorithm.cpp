@@ -122,7 +122,9 @@ void btConvex2dConvex2dAlgorithm ::processCollision (const btCollisionObjectWrap
 
 		btGjkPairDetector::ClosestPointInput input;
 
-		btGjkPairDetector	gjkPairDetector(min0,min1,m_simplexSolver,m_pdSolver);
+		//the simplex solver of the CreateFunc is shared by all pairs, a local one keeps pairs independent when they are processed on several threads
+		btVoronoiSimplexSolver	simplexSolver;
+		btGjkPairDetector	gjkPairDetector(min0,min1,&simplexSolver,m_pdSolver);
 		//TODO: if (dispatchInfo.m_useContinuous)
 		gjkPairDetector.setMinkowskiA(min0);
 		gjkPairDetector.setMinkowskiB(min1);
@@ -50,6 +50,7 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btMinkowskiPenetrationDepthSolver.h"
 
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpa2.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkBatch.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
 #include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObjectWrapper.h"
@@ -203,7 +204,8 @@ m_sepDistance((static_cast<btConvexShape*>(body0->getCollisionShape()))->getAngu
 			  (static_cast<btConvexShape*>(body1->getCollisionShape()))->getAngularMotionDisc()),
 #endif
 m_numPerturbationIterations(numPerturbationIterations),
-m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold)
+m_minimumPointsPerturbationThreshold(minimumPointsPerturbationThreshold),
+m_gjkBatchOutput(0)
 {
 	(void)body0Wrap;
 	(void)body1Wrap;
@@ -221,6 +223,41 @@ btConvexConvexAlgorithm::~btConvexConvexAlgorithm()
 	}
 }
 
+bool	btConvexConvexAlgorithm::getGjkBatchInput(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,btGjkBatchInput& input)
+{
+#ifdef USE_SEPDISTANCE_UTIL2
+	(void)body0Wrap;
+	(void)body1Wrap;
+	(void)input;
+	return false;
+#else
+	//the maximum distance needs the contact breaking threshold of the manifold, the first processCollision creates it
+	if (!m_manifoldPtr)
+		return false;
+
+	const btConvexShape* min0 = static_cast<const btConvexShape*>(body0Wrap->getCollisionShape());
+	const btConvexShape* min1 = static_cast<const btConvexShape*>(body1Wrap->getCollisionShape());
+	if (!btGjkBatch::isBatchShapeType(min0->getShapeType()) || !btGjkBatch::isBatchShapeType(min1->getShapeType()))
+		return false;
+
+	//polyhedra with polyhedral features take the contact clipping path of processCollision
+	if (min0->isPolyhedral() && min1->isPolyhedral() &&
+		static_cast<const btPolyhedralConvexShape*>(min0)->getConvexPolyhedron() &&
+		static_cast<const btPolyhedralConvexShape*>(min1)->getConvexPolyhedron())
+	{
+		return false;
+	}
+
+	input.m_transformA = body0Wrap->getWorldTransform();
+	input.m_transformB = body1Wrap->getWorldTransform();
+	input.m_shapeA = min0;
+	input.m_shapeB = min1;
+	input.m_maximumDistanceSquared = min0->getMargin() + min1->getMargin() + m_manifoldPtr->getContactBreakingThreshold();
+	input.m_maximumDistanceSquared *= input.m_maximumDistanceSquared;
+	return true;
+#endif //USE_SEPDISTANCE_UTIL2
+}
+
 void	btConvexConvexAlgorithm ::setLowLevelOfDetail(bool useLowLevel)
 {
 	m_lowLevelOfDetail = useLowLevel;
@@ -291,6 +328,8 @@ extern btScalar gContactBreakingThreshold;
 //
 void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
 {
+	const btGjkBatchOutput* gjkBatchOutput = m_gjkBatchOutput;
+	m_gjkBatchOutput = 0;
 
 	if (!m_manifoldPtr)
 	{
@@ -350,7 +389,9 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 	
 	btGjkPairDetector::ClosestPointInput input;
 
-	btGjkPairDetector	gjkPairDetector(min0,min1,m_simplexSolver,m_pdSolver);
+	//the simplex solver of the CreateFunc is shared by all pairs, a local one keeps pairs independent when they are processed on several threads
+	btVoronoiSimplexSolver	simplexSolver;
+	btGjkPairDetector	gjkPairDetector(min0,min1,&simplexSolver,m_pdSolver);
 	//TODO: if (dispatchInfo.m_useContinuous)
 	gjkPairDetector.setMinkowskiA(min0);
 	gjkPairDetector.setMinkowskiB(min1);
@@ -472,7 +513,7 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 					*polyhedronA->getConvexPolyhedron(), *polyhedronB->getConvexPolyhedron(),
 					body0Wrap->getWorldTransform(), 
 					body1Wrap->getWorldTransform(),
-					sepNormalWorldSpace,*resultOut);
+					sepNormalWorldSpace,*resultOut,m_worldVertsB1,m_worldVertsB2);
 			} else
 			{
 #ifdef ZERO_MARGIN
@@ -505,7 +546,7 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 
 				btPolyhedralContactClipping::clipHullAgainstHull(sepNormalWorldSpace, *polyhedronA->getConvexPolyhedron(), *polyhedronB->getConvexPolyhedron(),
 					body0Wrap->getWorldTransform(), 
-					body1Wrap->getWorldTransform(), minDist-threshold, threshold, *resultOut);
+					body1Wrap->getWorldTransform(), minDist-threshold, threshold, m_worldVertsB1, m_worldVertsB2, *resultOut);
  				
 			}
 			if (m_ownManifold)
@@ -520,8 +561,9 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 			if (polyhedronA->getConvexPolyhedron() && polyhedronB->getShapeType()==TRIANGLE_SHAPE_PROXYTYPE)
 			{
 
-				btVertexArray vertices;
+				btVertexArray& vertices = m_worldVertsB1;
 				btTriangleShape* tri = (btTriangleShape*)polyhedronB;
+				vertices.resize(0);
 				vertices.push_back(	body1Wrap->getWorldTransform()*tri->m_vertices1[0]);
 				vertices.push_back(	body1Wrap->getWorldTransform()*tri->m_vertices1[1]);
 				vertices.push_back(	body1Wrap->getWorldTransform()*tri->m_vertices1[2]);
@@ -569,7 +611,7 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 			if (foundSepAxis)
 			{
 				btPolyhedralContactClipping::clipFaceAgainstHull(sepNormalWorldSpace, *polyhedronA->getConvexPolyhedron(), 
-					body0Wrap->getWorldTransform(), vertices, minDist-threshold, maxDist, *resultOut);
+					body0Wrap->getWorldTransform(), vertices, m_worldVertsB2, minDist-threshold, maxDist, *resultOut);
 			}
 				
 				
@@ -586,7 +628,18 @@ void btConvexConvexAlgorithm ::processCollision (const btCollisionObjectWrapper*
 
 	}
 	
-	gjkPairDetector.getClosestPoints(input,*resultOut,dispatchInfo.m_debugDraw);
+	if (gjkBatchOutput && gjkBatchOutput->m_status != BT_GJK_BATCH_FALLBACK)
+	{
+		//the dispatcher found the closest points of this input with btGjkBatch
+		if (gjkBatchOutput->m_status == BT_GJK_BATCH_CONTACT)
+		{
+			resultOut->addContactPoint(gjkBatchOutput->m_normalOnBInWorld,gjkBatchOutput->m_pointInWorld,gjkBatchOutput->m_distance);
+		}
+		gjkPairDetector.setCachedSeperatingAxis(gjkBatchOutput->m_separatingAxis);
+	} else
+	{
+		gjkPairDetector.getClosestPoints(input,*resultOut,dispatchInfo.m_debugDraw);
+	}
 
 	//now perform 'm_numPerturbationIterations' collision queries with the perturbated collision objects
 	
@@ -21,11 +21,13 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
 #include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPolyhedralContactClipping.h"
 #include "btCollisionCreateFunc.h"
 #include "btCollisionDispatcher.h"
 #include "LinearMath/btTransformUtil.h" //for btConvexSeparatingDistanceUtil
 
 class btConvexPenetrationDepthSolver;
+struct btGjkBatchOutput;
 
 ///Enabling USE_SEPDISTANCE_UTIL2 requires 100% reliable distance computation. However, when using large size ratios GJK can be imprecise
 ///so the distance is not conservative. In that case, enabling this USE_SEPDISTANCE_UTIL2 would result in failing/missing collisions.
@@ -53,6 +55,13 @@ class btConvexConvexAlgorithm : public btActivatingCollisionAlgorithm
 	int m_numPerturbationIterations;
 	int m_minimumPointsPerturbationThreshold;
 
+	///closest points computed by the dispatcher with btGjkBatch, for the next processCollision only
+	const btGjkBatchOutput*	m_gjkBatchOutput;
+
+	///scratch memory of the separating axis test and the contact clipping of polyhedral shapes
+	btVertexArray	m_worldVertsB1;
+	btVertexArray	m_worldVertsB2;
+
 
 	///cache separating vector to speedup collision detection
 	
@@ -74,6 +83,13 @@ public:
 			manifoldArray.push_back(m_manifoldPtr);
 	}
 
+	virtual	bool	getGjkBatchInput(const btCollisionObjectWrapper* body0Wrap,const btCollisionObjectWrapper* body1Wrap,btGjkBatchInput& input);
+
+	virtual	void	setGjkBatchOutput(const btGjkBatchOutput* output)
+	{
+		m_gjkBatchOutput = output;
+	}
+
 
 	void	setLowLevelOfDetail(bool useLowLevel);
 
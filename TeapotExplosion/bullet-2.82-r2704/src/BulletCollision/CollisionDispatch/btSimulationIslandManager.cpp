@@ -21,12 +21,14 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionDispatch/btContactReduction.h"
 
 //#include <stdio.h>
 #include "LinearMath/btQuickprof.h"
 
 btSimulationIslandManager::btSimulationIslandManager():
-m_splitIslands(true)
+m_splitIslands(true),
+m_contactReduction(0)
 {
 }
 
@@ -60,9 +62,13 @@ void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */,btColl
 			if (((colObj0) && ((colObj0)->mergesSimulationIslands())) &&
 				((colObj1) && ((colObj1)->mergesSimulationIslands())))
 			{
-
-				m_unionFind.unite((colObj0)->getIslandTag(),
-					(colObj1)->getIslandTag());
+				int tag0 = (colObj0)->getIslandTag();
+				int tag1 = (colObj1)->getIslandTag();
+				//pairs inside kept islands were united before, pairs between two kept islands are united once one of them wakes up
+				if (!(m_elementKept[tag0] && m_elementKept[tag1]))
+				{
+					m_unionFind.unite(tag0,tag1);
+				}
 			}
 		}
 		}
@@ -75,7 +81,11 @@ void   btSimulationIslandManager::updateActivationState(btCollisionWorld* colWor
 
 	// put the index into m_controllers into m_tag   
 	int index = 0;
+	int numPreviousElements = m_elementObjects.size();
 	{
+		//an island of the last step is kept if all its objects are still sleeping at the same index
+		m_islandKept.resize(0);
+		m_islandKept.resize(numPreviousElements,true);
 
 		int i;
 		for (i=0;i<colWorld->getCollisionObjectArray().size(); i++)
@@ -84,16 +94,45 @@ void   btSimulationIslandManager::updateActivationState(btCollisionWorld* colWor
 			//Adding filtering here
 			if (!collisionObject->isStaticOrKinematicObject())
 			{
+				if ((index<numPreviousElements) &&
+					((m_elementObjects[index] != collisionObject) || (collisionObject->getActivationState() != ISLAND_SLEEPING)))
+				{
+					m_islandKept[m_elementIslandIds[index]] = false;
+				}
 				collisionObject->setIslandTag(index++);
 			}
 			collisionObject->setCompanionId(-1);
 			collisionObject->setHitFraction(btScalar(1.));
 		}
+		for (i=index;i<numPreviousElements;i++)
+		{
+			m_islandKept[m_elementIslandIds[i]] = false;
+		}
 	}
 	// do the union find
 
 	initUnionFind( index );
 
+	m_elementKept.resize(index);
+	{
+		int i;
+		for (i=0;i<index;i++)
+		{
+			bool kept = (i<numPreviousElements) && m_islandKept[m_elementIslandIds[i]];
+			m_elementKept[i] = kept;
+			if (kept)
+			{
+				//the island id of the last step is an element of the same island, so it is kept as well and stays the root
+				int islandId = m_elementIslandIds[i];
+				if (islandId != i)
+				{
+					m_unionFind.getElement(i).m_id = islandId;
+					m_unionFind.getElement(islandId).m_sz++;
+				}
+			}
+		}
+	}
+
 	findUnions(dispatcher,colWorld);
 }
 
@@ -101,6 +140,12 @@ void   btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* c
 {
 	// put the islandId ('find' value) into m_tag   
 	{
+		int numElements = m_unionFind.getNumElements();
+		m_elementObjects.resize(numElements);
+		m_elementIslandIds.resize(numElements);
+		m_islandKept.resize(0);
+		m_islandKept.resize(numElements,true);
+
 		int index = 0;
 		int i;
 		for (i=0;i<colWorld->getCollisionObjectArray().size();i++)
@@ -108,10 +153,18 @@ void   btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* c
 			btCollisionObject* collisionObject= colWorld->getCollisionObjectArray()[i];
 			if (!collisionObject->isStaticOrKinematicObject())
 			{
-				collisionObject->setIslandTag( m_unionFind.find(index) );
+				int islandId = m_unionFind.find(index);
+				collisionObject->setIslandTag( islandId );
 				//Set the correct object offset in Collision Object Array
 				m_unionFind.getElement(index).m_sz = i;
 				collisionObject->setCompanionId(-1);
+				//remember the islands for the next step, an island joined by an element that was not kept is visited by buildIslands
+				m_elementObjects[index] = collisionObject;
+				m_elementIslandIds[index] = islandId;
+				if (!m_elementKept[index])
+				{
+					m_islandKept[islandId] = false;
+				}
 				index++;
 			} else
 			{
@@ -128,6 +181,9 @@ void	btSimulationIslandManager::updateActivationState(btCollisionWorld* colWorld
 {
 
 	initUnionFind( int (colWorld->getCollisionObjectArray().size()));
+	//every object has an element here, so islands are not kept
+	m_elementKept.resize(0);
+	m_elementKept.resize(colWorld->getCollisionObjectArray().size(),false);
 
 	// put the index into m_controllers into m_tag	
 	{
@@ -172,6 +228,8 @@ void	btSimulationIslandManager::storeIslandActivationState(btCollisionWorld* col
 			index++;
 		}
 	}
+	m_islandKept.resize(0);
+	m_islandKept.resize(m_unionFind.getNumElements(),false);
 }
 
 #endif //STATIC_SIMULATION_ISLAND_OPTIMIZATION
@@ -188,18 +246,6 @@ inline	int	getIslandId(const btPersistentManifold* lhs)
 
 
 
-/// function object that routes calls to operator<
-class btPersistentManifoldSortPredicate
-{
-	public:
-
-		SIMD_FORCE_INLINE bool operator() ( const btPersistentManifold* lhs, const btPersistentManifold* rhs ) const
-		{
-			return getIslandId(lhs) < getIslandId(rhs);
-		}
-};
-
-
 void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld)
 {
 
@@ -227,6 +273,12 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 		{
 		}
 
+		//a kept island is still sleeping
+		if (m_islandKept[islandId])
+		{
+			continue;
+		}
+
 		//int numSleeping = 0;
 
 		bool allSleeping = true;
@@ -331,12 +383,20 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 			if (colObj0->isKinematicObject() && colObj0->getActivationState() != ISLAND_SLEEPING)
 			{
 				if (colObj0->hasContactResponse())
+				{
 					colObj1->activate();
+					if (colObj1->getIslandTag()>=0)
+						m_islandKept[colObj1->getIslandTag()] = false;
+				}
 			}
 			if (colObj1->isKinematicObject() && colObj1->getActivationState() != ISLAND_SLEEPING)
 			{
 				if (colObj1->hasContactResponse())
+				{
 					colObj0->activate();
+					if (colObj0->getIslandTag()>=0)
+						m_islandKept[colObj0->getIslandTag()] = false;
+				}
 			}
 			if(m_splitIslands)
 			{ 
@@ -367,83 +427,93 @@ void btSimulationIslandManager::buildAndProcessIslands(btDispatcher* dispatcher,
 	{
 		btPersistentManifold** manifold = dispatcher->getInternalManifoldPointer();
 		int maxNumManifolds = dispatcher->getNumManifolds();
+		if (m_contactReduction)
+		{
+			//buildIslands leaves m_islandmanifold empty when islands are not split
+			for (int i=0;i<maxNumManifolds;i++)
+			{
+				m_islandmanifold.push_back(manifold[i]);
+			}
+			m_contactReduction->reduceManifolds(m_islandmanifold);
+			manifold = m_islandmanifold.size() ? &m_islandmanifold[0] : 0;
+			maxNumManifolds = m_islandmanifold.size();
+		}
 		callback->processIsland(&collisionObjects[0],collisionObjects.size(),manifold,maxNumManifolds, -1);
 	}
 	else
 	{
-		// Sort manifolds, based on islands
-		// Sort the vector using predicate and std::sort
-		//std::sort(islandmanifold.begin(), islandmanifold.end(), btPersistentManifoldSortPredicate);
+		if (m_contactReduction)
+		{
+			m_contactReduction->reduceManifolds(m_islandmanifold);
+		}
 
+		// Bucket the manifolds by island id, in dispatcher order within each island
 		int numManifolds = int (m_islandmanifold.size());
 
-		//tried a radix sort, but quicksort/heapsort seems still faster
-		//@todo rewrite island management
-		m_islandmanifold.quickSort(btPersistentManifoldSortPredicate());
-		//m_islandmanifold.heapSort(btPersistentManifoldSortPredicate());
-
-		//now process all active islands (sets of manifolds for now)
-
-		int startManifoldIndex = 0;
-		int endManifoldIndex = 1;
-
-		//int islandId;
-
-		
-
-	//	printf("Start Islands\n");
+		m_islandManifoldStarts.resize(0);
+		m_islandManifoldStarts.resize(numElem+1,0);
+		int i;
+		for (i=0;i<numManifolds;i++)
+		{
+			int islandId = getIslandId(m_islandmanifold[i]);
+			btAssert(islandId>=0 && islandId<numElem);
+			m_islandManifoldStarts[islandId+1]++;
+		}
+		for (i=0;i<numElem;i++)
+		{
+			m_islandManifoldStarts[i+1] += m_islandManifoldStarts[i];
+		}
+		m_sortedIslandManifolds.resizeNoInitialize(numManifolds);
+		for (i=0;i<numManifolds;i++)
+		{
+			btPersistentManifold* manifold = m_islandmanifold[i];
+			m_sortedIslandManifolds[m_islandManifoldStarts[getIslandId(manifold)]++] = manifold;
+		}
+		//the scatter moved each start to the end of its island, which is the start of the next one
+		for (i=numElem;i>0;i--)
+		{
+			m_islandManifoldStarts[i] = m_islandManifoldStarts[i-1];
+		}
+		m_islandManifoldStarts[0] = 0;
 
 		//traverse the simulation islands, and call the solver, unless all objects are sleeping/deactivated
 		for ( startIslandIndex=0;startIslandIndex<numElem;startIslandIndex = endIslandIndex)
 		{
 			int islandId = getUnionFind().getElement(startIslandIndex).m_id;
 
-
-			   bool islandSleeping = true;
-	                
-					for (endIslandIndex = startIslandIndex;(endIslandIndex<numElem) && (getUnionFind().getElement(endIslandIndex).m_id == islandId);endIslandIndex++)
-					{
-							int i = getUnionFind().getElement(endIslandIndex).m_sz;
-							btCollisionObject* colObj0 = collisionObjects[i];
-							m_islandBodies.push_back(colObj0);
-							if (colObj0->isActive())
-									islandSleeping = false;
-					}
-	                
-
-			//find the accompanying contact manifold for this islandId
-			int numIslandManifolds = 0;
-			btPersistentManifold** startManifold = 0;
-
-			if (startManifoldIndex<numManifolds)
+			//kept islands are sleeping, unless a kinematic object woke them up in buildIslands
+			bool islandSleeping = true;
+			if (m_islandKept[islandId])
 			{
-				int curIslandId = getIslandId(m_islandmanifold[startManifoldIndex]);
-				if (curIslandId == islandId)
+				for (endIslandIndex = startIslandIndex+1;(endIslandIndex<numElem) && (getUnionFind().getElement(endIslandIndex).m_id == islandId);endIslandIndex++)
 				{
-					startManifold = &m_islandmanifold[startManifoldIndex];
-				
-					for (endManifoldIndex = startManifoldIndex+1;(endManifoldIndex<numManifolds) && (islandId == getIslandId(m_islandmanifold[endManifoldIndex]));endManifoldIndex++)
-					{
-
-					}
-					/// Process the actual simulation, only if not sleeping/deactivated
-					numIslandManifolds = endManifoldIndex-startManifoldIndex;
 				}
-
+				continue;
+			}
+			for (endIslandIndex = startIslandIndex;(endIslandIndex<numElem) && (getUnionFind().getElement(endIslandIndex).m_id == islandId);endIslandIndex++)
+			{
+				if (islandSleeping && collisionObjects[getUnionFind().getElement(endIslandIndex).m_sz]->isActive())
+					islandSleeping = false;
 			}
 
+			/// Process the actual simulation, only if not sleeping/deactivated
 			if (!islandSleeping)
 			{
+				int idx;
+				for (idx=startIslandIndex;idx<endIslandIndex;idx++)
+				{
+					m_islandBodies.push_back(collisionObjects[getUnionFind().getElement(idx).m_sz]);
+				}
+
+				//the accompanying contact manifolds for this islandId
+				int startManifoldIndex = m_islandManifoldStarts[islandId];
+				int numIslandManifolds = m_islandManifoldStarts[islandId+1]-startManifoldIndex;
+				btPersistentManifold** startManifold = numIslandManifolds ? &m_sortedIslandManifolds[startManifoldIndex] : 0;
+
 				callback->processIsland(&m_islandBodies[0],m_islandBodies.size(),startManifold,numIslandManifolds, islandId);
 	//			printf("Island callback of size:%d bodies, %d manifolds\n",islandBodies.size(),numIslandManifolds);
+				m_islandBodies.resize(0);
 			}
-			
-			if (numIslandManifolds)
-			{
-				startManifoldIndex = endManifoldIndex;
-			}
-
-			m_islandBodies.resize(0);
 		}
 	} // else if(!splitIslands) 
 
@@ -25,17 +25,34 @@ class btCollisionObject;
 class btCollisionWorld;
 class btDispatcher;
 class btPersistentManifold;
+class btContactReduction;
 
 
 ///SimulationIslandManager creates and handles simulation islands, using btUnionFind
+///Islands of sleeping objects are kept from one step to the next: as long as all objects of an island keep sleeping
+///at the same place in the collision object array, its elements start out united and the overlapping pairs between them
+///are not visited again. Such an island is split lazily, once one of its objects wakes up or is removed.
 class btSimulationIslandManager
 {
 	btUnionFind m_unionFind;
 
 	btAlignedObjectArray<btPersistentManifold*>  m_islandmanifold;
 	btAlignedObjectArray<btCollisionObject* >  m_islandBodies;
+
+	///m_islandmanifold bucketed by island id, the manifolds of island i start at m_islandManifoldStarts[i]
+	btAlignedObjectArray<btPersistentManifold*>  m_sortedIslandManifolds;
+	btAlignedObjectArray<int>	m_islandManifoldStarts;
+
+	///object and island id of each union find element, stored by storeIslandActivationState
+	btAlignedObjectArray<btCollisionObject*>	m_elementObjects;
+	btAlignedObjectArray<int>	m_elementIslandIds;
+	///elements of islands kept from the last step, and islands that only hold such elements, indexed by island id
+	btAlignedObjectArray<bool>	m_elementKept;
+	btAlignedObjectArray<bool>	m_islandKept;
 	
 	bool m_splitIslands;
+
+	btContactReduction*	m_contactReduction;
 	
 public:
 	btSimulationIslandManager();
@@ -75,6 +92,16 @@ public:
 		m_splitIslands = doSplitIslands;
 	}
 
+	///the contact reduction merges the manifolds of each body pair before the islands are handed to the callback, it is not owned
+	btContactReduction*	getContactReduction()
+	{
+		return m_contactReduction;
+	}
+	void setContactReduction(btContactReduction* contactReduction)
+	{
+		m_contactReduction = contactReduction;
+	}
+
 };
 
 #endif //BT_SIMULATION_ISLAND_MANAGER_H
@@ -35,6 +35,8 @@ void	btUnionFind::allocate(int N)
 void	btUnionFind::Free()
 {
 	m_elements.clear();
+	m_unsortedElements.clear();
+	m_islandStarts.clear();
 }
 
 
@@ -49,16 +51,6 @@ void	btUnionFind::reset(int N)
 }
 
 
-class btUnionFindElementSortPredicate
-{
-	public:
-
-		bool operator() ( const btElement& lhs, const btElement& rhs ) const
-		{
-			return lhs.m_id < rhs.m_id;
-		}
-};
-
 ///this is a special operation, destroying the content of btUnionFind.
 ///it sorts the elements, based on island id, in order to make it easy to iterate over islands
 void	btUnionFind::sortIslands()
@@ -66,6 +58,9 @@ void	btUnionFind::sortIslands()
 
 	//first store the original body index, and islandId
 	int numElements = m_elements.size();
+
+	m_islandStarts.resize(0);
+	m_islandStarts.resize(numElements+1,0);
 	
 	for (int i=0;i<numElements;i++)
 	{
@@ -73,10 +68,24 @@ void	btUnionFind::sortIslands()
 #ifndef STATIC_SIMULATION_ISLAND_OPTIMIZATION
 		m_elements[i].m_sz = i;
 #endif //STATIC_SIMULATION_ISLAND_OPTIMIZATION
+		m_islandStarts[m_elements[i].m_id+1]++;
+	}
+
+	//island ids are element indices, so a counting sort puts the islands in the same order as a comparison sort would
+	for (int i=0;i<numElements;i++)
+	{
+		m_islandStarts[i+1] += m_islandStarts[i];
+	}
+
+	m_unsortedElements.resizeNoInitialize(numElements);
+	for (int i=0;i<numElements;i++)
+	{
+		m_unsortedElements[i] = m_elements[i];
+	}
+	for (int i=0;i<numElements;i++)
+	{
+		const btElement& element = m_unsortedElements[i];
+		m_elements[m_islandStarts[element.m_id]++] = element;
 	}
-	
-	 // Sort the vector using predicate and std::sort
-	  //std::sort(m_elements.begin(), m_elements.end(), btUnionFindElementSortPredicate);
-	  m_elements.quickSort(btUnionFindElementSortPredicate());
 
 }
@@ -36,6 +36,9 @@ class btUnionFind
   {
     private:
 		btAlignedObjectArray<btElement>	m_elements;
+		///scratch space of sortIslands
+		btAlignedObjectArray<btElement>	m_unsortedElements;
+		btAlignedObjectArray<int>		m_islandStarts;
 
     public:
 	  
@@ -45,6 +48,7 @@ class btUnionFind
 	
 		//this is a special operation, destroying the content of btUnionFind.
 		//it sorts the elements, based on island id, in order to make it easy to iterate over islands
+		//the elements are bucketed in linear time, elements of an island keep their order
 		void	sortIslands();
 
 	  void	reset(int N);
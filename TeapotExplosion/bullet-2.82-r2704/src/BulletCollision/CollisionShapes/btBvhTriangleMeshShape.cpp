@@ -25,6 +25,8 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_wideBvh(0),
+m_bvhBuildMethod(btQuantizedBvh::BUILD_MEAN_SPLIT),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
@@ -45,6 +47,8 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_wideBvh(0),
+m_bvhBuildMethod(btQuantizedBvh::BUILD_MEAN_SPLIT),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
 m_ownsBvh(false)
 {
@@ -68,6 +72,10 @@ m_ownsBvh(false)
 void	btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refitPartial( m_meshInterface,aabbMin,aabbMax );
+	if (m_wideBvh)
+	{
+		m_wideBvh->partialRefit(m_meshInterface,aabbMin,aabbMax);
+	}
 	
 	m_localAabbMin.setMin(aabbMin);
 	m_localAabbMax.setMax(aabbMax);
@@ -77,6 +85,10 @@ void	btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin,const btV
 void	btBvhTriangleMeshShape::refitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refit( m_meshInterface, aabbMin,aabbMax );
+	if (m_wideBvh)
+	{
+		m_wideBvh->refit(m_meshInterface);
+	}
 	
 	recalcLocalAabb();
 }
@@ -88,6 +100,7 @@ btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 		m_bvh->~btOptimizedBvh();
 		btAlignedFree(m_bvh);
 	}
+	setUseWideBvh(false);
 }
 
 void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget)
@@ -156,9 +169,99 @@ void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget);
+		return;
+	}
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget);
 }
 
+void	btBvhTriangleMeshShape::performRaycastPacket (btTriangleCallback** callbacks, const btVector3* raySources, const btVector3* rayTargets, int numRays)
+{
+	if (m_wideBvh || !m_bvh->isQuantized())
+	{
+		for (int i=0;i<numRays;i++)
+		{
+			performRaycast(callbacks[i],raySources[i],rayTargets[i]);
+		}
+		return;
+	}
+
+	struct	MyNodeRayPacketCallback : public btNodeRayPacketCallback
+	{
+		btStridingMeshInterface*	m_meshInterface;
+		btTriangleCallback** m_callbacks;
+
+		MyNodeRayPacketCallback(btTriangleCallback** callbacks,btStridingMeshInterface* meshInterface)
+			:m_meshInterface(meshInterface),
+			m_callbacks(callbacks)
+		{
+		}
+				
+		virtual void processNode(int nodeSubPart, int nodeTriangleIndex, int rayMask)
+		{
+			btVector3 m_triangle[3];
+			const unsigned char *vertexbase;
+			int numverts;
+			PHY_ScalarType type;
+			int stride;
+			const unsigned char *indexbase;
+			int indexstride;
+			int numfaces;
+			PHY_ScalarType indicestype;
+
+			m_meshInterface->getLockedReadOnlyVertexIndexBase(
+				&vertexbase,
+				numverts,
+				type,
+				stride,
+				&indexbase,
+				indexstride,
+				numfaces,
+				indicestype,
+				nodeSubPart);
+
+			unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
+			btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
+	
+			const btVector3& meshScaling = m_meshInterface->getScaling();
+			for (int j=2;j>=0;j--)
+			{
+				int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
+				
+				if (type == PHY_FLOAT)
+				{
+					float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
+					
+					m_triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());		
+				}
+				else
+				{
+					double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
+					
+					m_triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());		
+				}
+			}
+
+			/* Perform ray vs. triangle collision here, once for each ray that reached the leaf */
+			for (int i=0;rayMask;i++,rayMask>>=1)
+			{
+				if (rayMask&1)
+				{
+					btVector3 triangle[3] = {m_triangle[0],m_triangle[1],m_triangle[2]};
+					m_callbacks[i]->processTriangle(triangle,nodeSubPart,nodeTriangleIndex);
+				}
+			}
+			m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+		}
+	};
+
+	MyNodeRayPacketCallback	myNodeCallback(callbacks,m_meshInterface);
+
+	m_bvh->reportRayPacketOverlappingNodex(&myNodeCallback,raySources,rayTargets,numRays);
+}
+
 void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
@@ -225,6 +328,11 @@ void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, co
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportBoxCastOverlappingNodex(&myNodeCallback,raySource,rayTarget,aabbMin,aabbMax);
+		return;
+	}
 	m_bvh->reportBoxCastOverlappingNodex (&myNodeCallback, raySource, rayTarget, aabbMin, aabbMax);
 }
 
@@ -320,7 +428,14 @@ void	btBvhTriangleMeshShape::processAllTriangles(btTriangleCallback* callback,co
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
-	m_bvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	}
+	else
+	{
+		m_bvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	}
 
 
 #endif//DISABLE_BVH
@@ -348,8 +463,28 @@ void   btBvhTriangleMeshShape::buildOptimizedBvh()
 	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
 	m_bvh = new(mem) btOptimizedBvh();
 	//rebuild the bvh...
-	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax);
+	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax,m_bvhBuildMethod);
 	m_ownsBvh = true;
+	if (m_wideBvh)
+	{
+		m_wideBvh->build(m_meshInterface);
+	}
+}
+
+void	btBvhTriangleMeshShape::setUseWideBvh(bool useWideBvh)
+{
+	if (useWideBvh && !m_wideBvh)
+	{
+		void* mem = btAlignedAlloc(sizeof(btWideBvh),16);
+		m_wideBvh = new(mem) btWideBvh();
+		m_wideBvh->build(m_meshInterface);
+	}
+	else if (!useWideBvh && m_wideBvh)
+	{
+		m_wideBvh->~btWideBvh();
+		btAlignedFree(m_wideBvh);
+		m_wideBvh = 0;
+	}
 }
 
 void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVector3& scaling)
@@ -363,6 +498,10 @@ void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVect
    if ((getLocalScaling() -scaling).length2() > SIMD_EPSILON)
    {
       btTriangleMeshShape::setLocalScaling(scaling);
+      if (m_wideBvh)
+      {
+         m_wideBvh->build(m_meshInterface);
+      }
    }
 }
 
@@ -18,6 +18,7 @@ subject to the following restrictions:
 
 #include "btTriangleMeshShape.h"
 #include "btOptimizedBvh.h"
+#include "btWideBvh.h"
 #include "LinearMath/btAlignedAllocator.h"
 #include "btTriangleInfoMap.h"
 
@@ -36,10 +37,12 @@ ATTRIBUTE_ALIGNED16(class) btBvhTriangleMeshShape : public btTriangleMeshShape
 
 	btOptimizedBvh*	m_bvh;
 	btTriangleInfoMap*	m_triangleInfoMap;
+	btWideBvh*	m_wideBvh;
+	btQuantizedBvh::btBuildMethod	m_bvhBuildMethod;
 
 	bool m_useQuantizedAabbCompression;
 	bool m_ownsBvh;
-	bool m_pad[11];////need padding due to alignment
+	bool m_pad[7];////need padding due to alignment
 
 public:
 
@@ -61,6 +64,9 @@ public:
 
 	
 	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget);
+	///performRaycastPacket casts up to four rays in mesh space with one walk of the bvh, ray i reports to callbacks[i]
+	///the same triangles in the same order as performRaycast. Each fetched triangle is handed to all rays that reached it
+	void performRaycastPacket (btTriangleCallback** callbacks, const btVector3* raySources, const btVector3* rayTargets, int numRays);
 	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
@@ -85,11 +91,37 @@ public:
 
 	void    buildOptimizedBvh();
 
+	///the build method of the optimized bvh that buildOptimizedBvh and setLocalScaling build, it does not rebuild the current bvh.
+	///Pass buildBvh=false to the constructor and call buildOptimizedBvh after setting it, to build the first bvh with it
+	void	setBvhBuildMethod(btQuantizedBvh::btBuildMethod buildMethod)
+	{
+		m_bvhBuildMethod = buildMethod;
+	}
+
+	btQuantizedBvh::btBuildMethod	getBvhBuildMethod() const
+	{
+		return m_bvhBuildMethod;
+	}
+
 	bool	usesQuantizedAabbCompression() const
 	{
 		return	m_useQuantizedAabbCompression;
 	}
 
+	///builds a btWideBvh that processAllTriangles, performRaycast and performConvexcast walk instead of the optimized bvh.
+	///It is rebuilt by setLocalScaling and refit by refitTree and partialRefitTree, but it is not serialized
+	void	setUseWideBvh(bool useWideBvh);
+
+	bool	usesWideBvh() const
+	{
+		return m_wideBvh!=0;
+	}
+
+	const btWideBvh*	getWideBvh() const
+	{
+		return m_wideBvh;
+	}
+
 	void	setTriangleInfoMap(btTriangleInfoMap* triangleInfoMap)
 	{
 		m_triangleInfoMap = triangleInfoMap;
@@ -0,0 +1,472 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btCollisionMeshBlob.h"
+#include "btBvhTriangleMeshShape.h"
+#include "btOptimizedBvh.h"
+#include "btTriangleIndexVertexArray.h"
+#include "btTriangleInfoMap.h"
+#include "LinearMath/btAlignedAllocator.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOWINRES
+#define NOMCX
+#define NOIME
+#include <windows.h>
+#define BT_COLLISION_MESH_BLOB_MAPPING
+#elif defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define BT_COLLISION_MESH_BLOB_MAPPING
+#endif
+
+static const char btCollisionMeshBlobMagic[8] = {'B','T','C','M','B','L','O','B'};
+
+enum btCollisionMeshBlobStorage
+{
+	BT_BLOB_NONE,
+	BT_BLOB_WRAPPED,	//owned by the caller of wrapBlob
+	BT_BLOB_MAPPED,
+	BT_BLOB_ALLOCATED
+};
+
+static unsigned int	btAlignBlobOffset(unsigned int offset)
+{
+	return (offset+15)&~15u;
+}
+
+static int	btGetBlobIndexSize(int indexType)
+{
+	switch (indexType)
+	{
+	case PHY_INTEGER:
+		return sizeof(int);
+	case PHY_SHORT:
+		return sizeof(short);
+	case PHY_UCHAR:
+		return sizeof(unsigned char);
+	default:
+		return 0;
+	}
+}
+
+static int	btGetBlobVertexSize(int vertexType)
+{
+	switch (vertexType)
+	{
+	case PHY_FLOAT:
+		return sizeof(float);
+	case PHY_DOUBLE:
+		return sizeof(double);
+	default:
+		return 0;
+	}
+}
+
+///true if size bytes at offset fit in a blob of blobSize bytes
+static bool	btIsBlobRangeInside(unsigned int offset,unsigned long long size,unsigned int blobSize)
+{
+	return offset<=blobSize && size<=blobSize-offset;
+}
+
+template <typename T>
+static bool	btCheckBlobTriangleIndices(const unsigned char* indexBase,int numTriangles,int indexStride,int numVertices)
+{
+	for (int t=0;t<numTriangles;t++)
+	{
+		const T* indices = (const T*)(indexBase+t*indexStride);
+		for (int i=0;i<3;i++)
+		{
+			if ((unsigned int)indices[i]>=(unsigned int)numVertices)
+				return false;
+		}
+	}
+	return true;
+}
+
+///true if all triangles of part index its vertices
+static bool	btCheckBlobTriangleIndices(const btCollisionMeshBlobPart& part,const unsigned char* blob)
+{
+	const unsigned char* indexBase = blob+part.m_triangleIndexOffset;
+	switch (part.m_indexType)
+	{
+	case PHY_INTEGER:
+		return btCheckBlobTriangleIndices<int>(indexBase,part.m_numTriangles,part.m_triangleIndexStride,part.m_numVertices);
+	case PHY_SHORT:
+		return btCheckBlobTriangleIndices<unsigned short>(indexBase,part.m_numTriangles,part.m_triangleIndexStride,part.m_numVertices);
+	case PHY_UCHAR:
+		return btCheckBlobTriangleIndices<unsigned char>(indexBase,part.m_numTriangles,part.m_triangleIndexStride,part.m_numVertices);
+	default:
+		return false;
+	}
+}
+
+///lays out the blob of shape and returns its size, and writes it if blob is not 0. Returns 0 if shape can't be stored
+static unsigned int	btLayoutCollisionMeshBlob(btBvhTriangleMeshShape* shape,unsigned char* blob)
+{
+	btOptimizedBvh* bvh = shape->getOptimizedBvh();
+	if (!bvh)
+		return 0;
+
+	const btStridingMeshInterface* meshInterface = shape->getMeshInterface();
+	const int numParts = meshInterface->getNumSubParts();
+	btCollisionMeshBlobHeader* header = (btCollisionMeshBlobHeader*)blob;
+	btCollisionMeshBlobPart* parts = 0;
+
+	unsigned int offset = btAlignBlobOffset(sizeof(btCollisionMeshBlobHeader));
+	const unsigned int partsOffset = offset;
+	offset = btAlignBlobOffset(offset+numParts*sizeof(btCollisionMeshBlobPart));
+	if (blob)
+	{
+		parts = (btCollisionMeshBlobPart*)(blob+partsOffset);
+	}
+
+	for (int p=0;p<numParts;p++)
+	{
+		const unsigned char* vertexBase;
+		const unsigned char* indexBase;
+		int numVertices,vertexStride,numTriangles,indexStride;
+		PHY_ScalarType vertexType,indexType;
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexBase,numVertices,vertexType,vertexStride,&indexBase,indexStride,numTriangles,indexType,p);
+
+		const int indexSize = btGetBlobIndexSize(indexType);
+		const int vertexSize = btGetBlobVertexSize(vertexType);
+		if (indexSize && vertexSize && blob)
+		{
+			btCollisionMeshBlobPart& part = parts[p];
+			part.m_triangleIndexOffset = offset;
+			part.m_numTriangles = numTriangles;
+			part.m_triangleIndexStride = 3*indexSize;
+			part.m_indexType = indexType;
+			part.m_vertexOffset = btAlignBlobOffset(offset+numTriangles*3*indexSize);
+			part.m_numVertices = numVertices;
+			part.m_vertexStride = 3*vertexSize;
+			part.m_vertexType = vertexType;
+			for (int t=0;t<numTriangles;t++)
+			{
+				memcpy(blob+part.m_triangleIndexOffset+t*part.m_triangleIndexStride,indexBase+t*indexStride,part.m_triangleIndexStride);
+			}
+			for (int v=0;v<numVertices;v++)
+			{
+				memcpy(blob+part.m_vertexOffset+v*part.m_vertexStride,vertexBase+v*vertexStride,part.m_vertexStride);
+			}
+		}
+		meshInterface->unLockReadOnlyVertexBase(p);
+
+		if (!indexSize || !vertexSize)
+			return 0;
+		offset = btAlignBlobOffset(offset+numTriangles*3*indexSize);
+		offset = btAlignBlobOffset(offset+numVertices*3*vertexSize);
+	}
+
+	const unsigned int bvhOffset = offset;
+	const unsigned int bvhSize = bvh->calculateSerializeBufferSize();
+	offset = btAlignBlobOffset(offset+bvhSize);
+	if (blob && !bvh->serialize(blob+bvhOffset,bvhSize,false))
+		return 0;
+
+	unsigned int triangleInfoMapOffset = 0;
+	const btTriangleInfoMap* triangleInfoMap = shape->getTriangleInfoMap();
+	if (triangleInfoMap)
+	{
+		triangleInfoMapOffset = offset;
+		offset = btAlignBlobOffset(offset+triangleInfoMap->calculateInPlaceBufferSize());
+		if (blob)
+		{
+			triangleInfoMap->serializeInPlace(blob+triangleInfoMapOffset);
+		}
+	}
+
+	if (blob)
+	{
+		memcpy(header->m_magic,btCollisionMeshBlobMagic,sizeof(header->m_magic));
+		header->m_version = BT_COLLISION_MESH_BLOB_VERSION;
+		header->m_endianMarker = 1;
+		header->m_scalarSize = sizeof(btScalar);
+		header->m_numParts = numParts;
+		header->m_blobSize = offset;
+		header->m_partsOffset = partsOffset;
+		header->m_bvhOffset = bvhOffset;
+		header->m_bvhSize = bvhSize;
+		header->m_triangleInfoMapOffset = triangleInfoMapOffset;
+		header->m_useQuantizedAabbCompression = shape->usesQuantizedAabbCompression();
+		const btVector3& scaling = meshInterface->getScaling();
+		const btVector3& localAabbMin = shape->getLocalAabbMin();
+		const btVector3& localAabbMax = shape->getLocalAabbMax();
+		for (int i=0;i<3;i++)
+		{
+			header->m_scaling[i] = scaling[i];
+			header->m_localAabbMin[i] = localAabbMin[i];
+			header->m_localAabbMax[i] = localAabbMax[i];
+		}
+		header->m_scaling[3] = header->m_localAabbMin[3] = header->m_localAabbMax[3] = btScalar(0.);
+	}
+	return offset;
+}
+
+btCollisionMeshBlob::btCollisionMeshBlob()
+:m_blob(0),
+m_blobSize(0),
+m_storage(BT_BLOB_NONE),
+m_meshInterface(0),
+m_triangleInfoMap(0),
+m_shape(0)
+{
+}
+
+btCollisionMeshBlob::~btCollisionMeshBlob()
+{
+	release();
+}
+
+unsigned int	btCollisionMeshBlob::calculateBlobSize(btBvhTriangleMeshShape* shape)
+{
+	return btLayoutCollisionMeshBlob(shape,0);
+}
+
+bool	btCollisionMeshBlob::writeBlob(btBvhTriangleMeshShape* shape,void* alignedDataBuffer,unsigned int dataBufferSize)
+{
+	const unsigned int blobSize = btLayoutCollisionMeshBlob(shape,0);
+	if (!blobSize || blobSize>dataBufferSize)
+		return false;
+	//clear the alignment gaps
+	memset(alignedDataBuffer,0,blobSize);
+	return btLayoutCollisionMeshBlob(shape,(unsigned char*)alignedDataBuffer)==blobSize;
+}
+
+bool	btCollisionMeshBlob::writeFile(btBvhTriangleMeshShape* shape,const char* fileName)
+{
+	const unsigned int blobSize = calculateBlobSize(shape);
+	if (!blobSize)
+		return false;
+	void* blob = btAlignedAlloc(blobSize,16);
+	bool written = writeBlob(shape,blob,blobSize);
+	if (written)
+	{
+		FILE* file = fopen(fileName,"wb");
+		written = file && fwrite(blob,1,blobSize,file)==blobSize;
+		if (file)
+		{
+			written = (fclose(file)==0) && written;
+		}
+	}
+	btAlignedFree(blob);
+	return written;
+}
+
+bool	btCollisionMeshBlob::mapFile(const char* fileName,bool checkTriangleIndices)
+{
+	release();
+
+	void* blob = 0;
+	unsigned int blobSize = 0;
+	int storage = BT_BLOB_NONE;
+#if defined(_WIN32)
+	HANDLE file = CreateFileA(fileName,GENERIC_READ,FILE_SHARE_READ,0,OPEN_EXISTING,FILE_ATTRIBUTE_NORMAL,0);
+	if (file==INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(file,&fileSize) && !fileSize.HighPart && fileSize.LowPart)
+	{
+		//a copy on write view, the bvh and array headers are patched in place
+		HANDLE mapping = CreateFileMappingA(file,0,PAGE_WRITECOPY,0,0,0);
+		if (mapping)
+		{
+			blob = MapViewOfFile(mapping,FILE_MAP_COPY,0,0,0);
+			CloseHandle(mapping);
+			blobSize = fileSize.LowPart;
+			storage = BT_BLOB_MAPPED;
+		}
+	}
+	CloseHandle(file);
+#elif defined(BT_COLLISION_MESH_BLOB_MAPPING)
+	int file = open(fileName,O_RDONLY);
+	if (file<0)
+		return false;
+	struct stat fileStat;
+	if (fstat(file,&fileStat)==0 && fileStat.st_size>0 && (unsigned long long)fileStat.st_size<=0xffffffffull)
+	{
+		//a copy on write mapping, the bvh and array headers are patched in place
+		blob = mmap(0,(size_t)fileStat.st_size,PROT_READ|PROT_WRITE,MAP_PRIVATE,file,0);
+		if (blob==MAP_FAILED)
+		{
+			blob = 0;
+		}
+		blobSize = (unsigned int)fileStat.st_size;
+		storage = BT_BLOB_MAPPED;
+	}
+	close(file);
+#else
+	FILE* file = fopen(fileName,"rb");
+	if (!file)
+		return false;
+	if (fseek(file,0,SEEK_END)==0)
+	{
+		long fileSize = ftell(file);
+		if (fileSize>0 && fseek(file,0,SEEK_SET)==0)
+		{
+			blob = btAlignedAlloc((size_t)fileSize,16);
+			blobSize = (unsigned int)fileSize;
+			storage = BT_BLOB_ALLOCATED;
+			if (fread(blob,1,blobSize,file)!=blobSize)
+			{
+				btAlignedFree(blob);
+				blob = 0;
+			}
+		}
+	}
+	fclose(file);
+#endif
+	if (!blob)
+		return false;
+
+	m_blob = blob;
+	m_blobSize = blobSize;
+	m_storage = storage;
+	if (!createShape(checkTriangleIndices))
+	{
+		release();
+		return false;
+	}
+	return true;
+}
+
+bool	btCollisionMeshBlob::wrapBlob(void* alignedDataBuffer,unsigned int dataBufferSize,bool checkTriangleIndices)
+{
+	release();
+	m_blob = alignedDataBuffer;
+	m_blobSize = dataBufferSize;
+	m_storage = BT_BLOB_WRAPPED;
+	if (!createShape(checkTriangleIndices))
+	{
+		release();
+		return false;
+	}
+	return true;
+}
+
+bool	btCollisionMeshBlob::createShape(bool checkTriangleIndices)
+{
+	unsigned char* blob = (unsigned char*)m_blob;
+	const btCollisionMeshBlobHeader* header = (const btCollisionMeshBlobHeader*)blob;
+	if (!blob || ((size_t)blob & 15) || m_blobSize<sizeof(btCollisionMeshBlobHeader))
+		return false;
+	if (memcmp(header->m_magic,btCollisionMeshBlobMagic,sizeof(header->m_magic)) ||
+		header->m_version!=BT_COLLISION_MESH_BLOB_VERSION ||
+		header->m_endianMarker!=1 ||
+		header->m_scalarSize!=int(sizeof(btScalar)) ||
+		header->m_blobSize>m_blobSize ||
+		header->m_numParts<0 ||
+		((header->m_partsOffset|header->m_bvhOffset|header->m_triangleInfoMapOffset)&15) ||
+		!btIsBlobRangeInside(header->m_partsOffset,(unsigned long long)header->m_numParts*sizeof(btCollisionMeshBlobPart),header->m_blobSize) ||
+		header->m_bvhSize<sizeof(btOptimizedBvh) ||
+		!btIsBlobRangeInside(header->m_bvhOffset,header->m_bvhSize,header->m_blobSize) ||
+		header->m_triangleInfoMapOffset>=header->m_blobSize)
+	{
+		return false;
+	}
+
+	const btCollisionMeshBlobPart* parts = (const btCollisionMeshBlobPart*)(blob+header->m_partsOffset);
+	btAlignedObjectArray<int> numTrianglesPerPart;
+	numTrianglesPerPart.resize(header->m_numParts);
+	m_meshInterface = new btTriangleIndexVertexArray();
+	for (int p=0;p<header->m_numParts;p++)
+	{
+		const btCollisionMeshBlobPart& part = parts[p];
+		const int indexSize = btGetBlobIndexSize(part.m_indexType);
+		const int vertexSize = btGetBlobVertexSize(part.m_vertexType);
+		if (!indexSize || !vertexSize ||
+			part.m_numTriangles<0 || part.m_triangleIndexStride<3*indexSize ||
+			part.m_numVertices<0 || part.m_vertexStride<3*vertexSize ||
+			!btIsBlobRangeInside(part.m_triangleIndexOffset,(unsigned long long)part.m_numTriangles*part.m_triangleIndexStride,header->m_blobSize) ||
+			!btIsBlobRangeInside(part.m_vertexOffset,(unsigned long long)part.m_numVertices*part.m_vertexStride,header->m_blobSize))
+		{
+			return false;
+		}
+		if (checkTriangleIndices && !btCheckBlobTriangleIndices(part,blob))
+		{
+			return false;
+		}
+		numTrianglesPerPart[p] = part.m_numTriangles;
+		btIndexedMesh mesh;
+		mesh.m_numTriangles = part.m_numTriangles;
+		mesh.m_triangleIndexBase = blob+part.m_triangleIndexOffset;
+		mesh.m_triangleIndexStride = part.m_triangleIndexStride;
+		mesh.m_numVertices = part.m_numVertices;
+		mesh.m_vertexBase = blob+part.m_vertexOffset;
+		mesh.m_vertexStride = part.m_vertexStride;
+		mesh.m_vertexType = (PHY_ScalarType)part.m_vertexType;
+		m_meshInterface->addIndexedMesh(mesh,(PHY_ScalarType)part.m_indexType);
+	}
+
+	const btVector3 scaling(header->m_scaling[0],header->m_scaling[1],header->m_scaling[2]);
+	m_meshInterface->setScaling(scaling);
+	//the shape takes its aabb from the premade aabb instead of reading all vertices
+	m_meshInterface->setPremadeAabb(btVector3(header->m_localAabbMin[0],header->m_localAabbMin[1],header->m_localAabbMin[2]),
+		btVector3(header->m_localAabbMax[0],header->m_localAabbMax[1],header->m_localAabbMax[2]));
+
+	//deSerializeInPlace only checks the size of the buffer, the nodes are walked without bounds checks
+	if (!btQuantizedBvh::isValidSerializedBuffer(blob+header->m_bvhOffset,header->m_bvhSize,header->m_numParts,header->m_numParts ? &numTrianglesPerPart[0] : 0))
+		return false;
+	btOptimizedBvh* bvh = btOptimizedBvh::deSerializeInPlace(blob+header->m_bvhOffset,header->m_bvhSize,false);
+	if (!bvh)
+		return false;
+
+	m_shape = new btBvhTriangleMeshShape(m_meshInterface,header->m_useQuantizedAabbCompression!=0,false);
+	m_shape->setOptimizedBvh(bvh,scaling);
+
+	if (header->m_triangleInfoMapOffset)
+	{
+		m_triangleInfoMap = new btTriangleInfoMap();
+		if (!m_triangleInfoMap->deSerializeInPlace(blob+header->m_triangleInfoMapOffset,header->m_blobSize-header->m_triangleInfoMapOffset))
+			return false;
+		m_shape->setTriangleInfoMap(m_triangleInfoMap);
+	}
+	return true;
+}
+
+void	btCollisionMeshBlob::release()
+{
+	delete m_shape;
+	m_shape = 0;
+	delete m_triangleInfoMap;
+	m_triangleInfoMap = 0;
+	delete m_meshInterface;
+	m_meshInterface = 0;
+
+	switch (m_storage)
+	{
+	case BT_BLOB_MAPPED:
+#if defined(_WIN32)
+		UnmapViewOfFile(m_blob);
+#elif defined(BT_COLLISION_MESH_BLOB_MAPPING)
+		munmap(m_blob,m_blobSize);
+#endif
+		break;
+	case BT_BLOB_ALLOCATED:
+		btAlignedFree(m_blob);
+		break;
+	default:
+		break;
+	}
+	m_blob = 0;
+	m_blobSize = 0;
+	m_storage = BT_BLOB_NONE;
+}
@@ -0,0 +1,112 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_COLLISION_MESH_BLOB_H
+#define BT_COLLISION_MESH_BLOB_H
+
+#include "LinearMath/btScalar.h"
+
+class btBvhTriangleMeshShape;
+class btTriangleIndexVertexArray;
+struct btTriangleInfoMap;
+
+#define BT_COLLISION_MESH_BLOB_VERSION 1
+
+///btCollisionMeshBlobHeader starts a collision mesh blob. All offsets are in bytes from the start of the blob and 16 byte aligned
+struct btCollisionMeshBlobHeader
+{
+	char			m_magic[8];					// "BTCMBLOB"
+	int				m_version;					// BT_COLLISION_MESH_BLOB_VERSION
+	int				m_endianMarker;				// 1 in the byte order of the writer
+	int				m_scalarSize;				// sizeof(btScalar) of the writer
+	int				m_numParts;
+	unsigned int	m_blobSize;
+	unsigned int	m_partsOffset;				// btCollisionMeshBlobPart[m_numParts]
+	unsigned int	m_bvhOffset;				// btOptimizedBvh, see btQuantizedBvh::serialize
+	unsigned int	m_bvhSize;
+	unsigned int	m_triangleInfoMapOffset;	// btTriangleInfoMap::serializeInPlace, 0 if the shape has no triangle info map
+	int				m_useQuantizedAabbCompression;
+	btScalar		m_scaling[4];
+	btScalar		m_localAabbMin[4];
+	btScalar		m_localAabbMax[4];
+};
+
+///the vertices and triangle indices of one btIndexedMesh, packed without gaps between vertices or triangles
+struct btCollisionMeshBlobPart
+{
+	unsigned int	m_triangleIndexOffset;
+	unsigned int	m_vertexOffset;
+	int				m_numTriangles;
+	int				m_triangleIndexStride;
+	int				m_numVertices;
+	int				m_vertexStride;
+	int				m_indexType;	// PHY_INTEGER, PHY_SHORT or PHY_UCHAR
+	int				m_vertexType;	// PHY_FLOAT or PHY_DOUBLE
+};
+
+///btCollisionMeshBlob stores a btBvhTriangleMeshShape, its mesh, optimized bvh and triangle info map, in one file that is
+///used in place: mapFile maps it copy on write and wraps the shape around the mapped data, so loading neither copies the
+///mesh nor builds the bvh, and the pages are only read once a query touches them.
+///The blob is in the native format of the writer, it can't be loaded with a different byte order or btScalar size.
+class btCollisionMeshBlob
+{
+	void*						m_blob;
+	unsigned int				m_blobSize;
+	int							m_storage;
+	btTriangleIndexVertexArray*	m_meshInterface;
+	btTriangleInfoMap*			m_triangleInfoMap;
+	btBvhTriangleMeshShape*		m_shape;
+
+	///wraps the mesh interface, bvh, triangle info map and shape around m_blob
+	bool	createShape(bool checkTriangleIndices);
+
+public:
+
+	btCollisionMeshBlob();
+
+	virtual ~btCollisionMeshBlob();
+
+	///the size of the blob of shape, 0 if the mesh or bvh can't be stored
+	static unsigned int	calculateBlobSize(btBvhTriangleMeshShape* shape);
+
+	///writes the blob of shape to a 16 byte aligned buffer of calculateBlobSize(shape) bytes
+	static bool	writeBlob(btBvhTriangleMeshShape* shape,void* alignedDataBuffer,unsigned int dataBufferSize);
+
+	static bool	writeFile(btBvhTriangleMeshShape* shape,const char* fileName);
+
+	///maps a file written by writeFile and wraps it, it is read into memory where files can't be mapped.
+	///Truncated and corrupt files are rejected. checkTriangleIndices reads all triangle indices to check them against the
+	///vertex count, trusted files can skip it so only the pages that queries touch are read
+	bool	mapFile(const char* fileName,bool checkTriangleIndices=true);
+
+	///wraps a writable, 16 byte aligned blob in memory, which has to outlive this btCollisionMeshBlob
+	bool	wrapBlob(void* alignedDataBuffer,unsigned int dataBufferSize,bool checkTriangleIndices=true);
+
+	///releases the shape and the blob, the shape must not be used after this
+	void	release();
+
+	///the shape does not own its mesh, bvh and triangle info map, they are released with the btCollisionMeshBlob
+	btBvhTriangleMeshShape*	getShape()
+	{
+		return m_shape;
+	}
+
+	const btBvhTriangleMeshShape*	getShape() const
+	{
+		return m_shape;
+	}
+};
+
+#endif //BT_COLLISION_MESH_BLOB_H
@@ -16,12 +16,14 @@ subject to the following restrictions:
 #include "btCompoundShape.h"
 #include "btCollisionShape.h"
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtCompact.h"
 #include "LinearMath/btSerializer.h"
 
 btCompoundShape::btCompoundShape(bool enableDynamicAabbTree)
 : m_localAabbMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT)),
 m_localAabbMax(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT)),
 m_dynamicAabbTree(0),
+m_compactAabbTree(0),
 m_updateRevision(1),
 m_collisionMargin(btScalar(0.)),
 m_localScaling(btScalar(1.),btScalar(1.),btScalar(1.))
@@ -44,6 +46,7 @@ btCompoundShape::~btCompoundShape()
 		m_dynamicAabbTree->~btDbvt();
 		btAlignedFree(m_dynamicAabbTree);
 	}
+	setUseCompactAabbTree(false);
 }
 
 void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisionShape* shape)
@@ -83,6 +86,7 @@ void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisio
 
 	m_children.push_back(child);
 
+	updateCompactAabbTree();
 }
 
 void	btCompoundShape::updateChildTransform(int childIndex, const btTransform& newChildTransform,bool shouldRecalculateLocalAabb)
@@ -161,6 +165,8 @@ void btCompoundShape::recalculateLocalAabb()
 				m_localAabbMax[i] = localAabbMax[i];
 		}
 	}
+
+	updateCompactAabbTree();
 }
 
 ///getAabb's default implementation is brute force, expected derived classes to implement a fast dedicated version
@@ -315,6 +321,43 @@ void btCompoundShape::createAabbTreeFromChildren()
             child.m_node = m_dynamicAabbTree->insert(bounds,(void*)index);
         }
     }
+    updateCompactAabbTree();
+}
+
+void btCompoundShape::setUseCompactAabbTree(bool useCompactAabbTree)
+{
+	if (useCompactAabbTree)
+	{
+		if (!m_compactAabbTree)
+		{
+			void* mem = btAlignedAlloc(sizeof(btDbvtCompact),16);
+			m_compactAabbTree = new(mem) btDbvtCompact();
+		}
+		updateCompactAabbTree();
+	}
+	else if (m_compactAabbTree)
+	{
+		m_compactAabbTree->~btDbvtCompact();
+		btAlignedFree(m_compactAabbTree);
+		m_compactAabbTree = 0;
+	}
+}
+
+const btDbvtCompact* btCompoundShape::getCompactAabbTree() const
+{
+	if (m_compactAabbTree && m_dynamicAabbTree && m_compactAabbTree->isCurrent(*m_dynamicAabbTree))
+	{
+		return m_compactAabbTree;
+	}
+	return 0;
+}
+
+void btCompoundShape::updateCompactAabbTree()
+{
+	if (m_compactAabbTree && m_dynamicAabbTree && !m_compactAabbTree->isCurrent(*m_dynamicAabbTree))
+	{
+		m_compactAabbTree->build(*m_dynamicAabbTree);
+	}
 }
 
 
@@ -26,6 +26,7 @@ subject to the following restrictions:
 
 //class btOptimizedBvh;
 struct btDbvt;
+struct btDbvtCompact;
 
 ATTRIBUTE_ALIGNED16(struct) btCompoundShapeChild
 {
@@ -59,6 +60,9 @@ ATTRIBUTE_ALIGNED16(class) btCompoundShape	: public btCollisionShape
 
 	btDbvt*							m_dynamicAabbTree;
 
+	///read-only copy of m_dynamicAabbTree in the btDbvtCompact layout, see setUseCompactAabbTree
+	btDbvtCompact*					m_compactAabbTree;
+
 	///increment m_updateRevision when adding/removing/replacing child shapes, so that some caches can be updated
 	int								m_updateRevision;
 
@@ -155,6 +159,17 @@ public:
 
 	void createAabbTreeFromChildren();
 
+	///keeps a btDbvtCompact copy of the dynamic aabb tree, which the compound collision algorithm traverses instead of the tree.
+	///The copy is rebuilt by addChildShape, recalculateLocalAabb and createAabbTreeFromChildren, so a batch of
+	///updateChildTransform(...,false) calls should end with recalculateLocalAabb. Until then the tree itself is used.
+	void	setUseCompactAabbTree(bool useCompactAabbTree);
+
+	///the compact copy of the dynamic aabb tree, or 0 when it is disabled or out of date
+	const btDbvtCompact*	getCompactAabbTree() const;
+
+	///rebuilds the compact copy after the dynamic aabb tree was changed directly
+	void	updateCompactAabbTree();
+
 	///computes the exact moment of inertia and the transform from the coordinate system defined by the principal axes of the moment of inertia
 	///and the center of mass to the current coordinate system. "masses" points to an array of masses of the children. The resulting transform
 	///"principal" has to be applied inversely to all children transforms in order for the local coordinate system of the compound
@@ -18,12 +18,14 @@ subject to the following restrictions:
 #endif
 
 #include "btConvexHullShape.h"
+#include "btConvexHullSupportMap.h"
 #include "BulletCollision/CollisionShapes/btCollisionMargin.h"
 
 #include "LinearMath/btQuaternion.h"
 #include "LinearMath/btSerializer.h"
 
-btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int stride) : btPolyhedralConvexAabbCachingShape ()
+btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int stride) : btPolyhedralConvexAabbCachingShape (),
+m_supportMap(0)
 {
 	m_shapeType = CONVEX_HULL_SHAPE_PROXYTYPE;
 	m_unscaledPoints.resize(numPoints);
@@ -42,6 +44,34 @@ btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int
 }
 
 
+btConvexHullShape::~btConvexHullShape()
+{
+	removeSupportMap();
+}
+
+void	btConvexHullShape::removeSupportMap()
+{
+	if (m_supportMap)
+	{
+		m_supportMap->~btConvexHullSupportMap();
+		btAlignedFree(m_supportMap);
+		m_supportMap = 0;
+	}
+}
+
+bool	btConvexHullShape::initializeSupportMap()
+{
+	if (!m_supportMap)
+	{
+		void* mem = btAlignedAlloc(sizeof(btConvexHullSupportMap),16);
+		m_supportMap = new (mem) btConvexHullSupportMap;
+	}
+	if (m_unscaledPoints.size() && m_supportMap->build(&m_unscaledPoints[0],m_unscaledPoints.size()))
+		return true;
+
+	removeSupportMap();
+	return false;
+}
 
 void btConvexHullShape::setLocalScaling(const btVector3& scaling)
 {
@@ -52,6 +82,7 @@ void btConvexHullShape::setLocalScaling(const btVector3& scaling)
 void btConvexHullShape::addPoint(const btVector3& point, bool recalculateLocalAabb)
 {
 	m_unscaledPoints.push_back(point);
+	removeSupportMap();
 	if (recalculateLocalAabb)
 		recalcLocalAabb();
 
@@ -66,7 +97,8 @@ btVector3	btConvexHullShape::localGetSupportingVertexWithoutMargin(const btVecto
     if( 0 < m_unscaledPoints.size() )
     {
         btVector3 scaled = vec * m_localScaling;
-        int index = (int) scaled.maxDot( &m_unscaledPoints[0], m_unscaledPoints.size(), maxDot); // FIXME: may violate encapsulation of m_unscaledPoints
+        int index = m_supportMap ? m_supportMap->getSupportingPointIndex(scaled, maxDot) :
+            (int) scaled.maxDot( &m_unscaledPoints[0], m_unscaledPoints.size(), maxDot); // FIXME: may violate encapsulation of m_unscaledPoints
         return m_unscaledPoints[index] * m_localScaling;
     }
 
@@ -89,7 +121,8 @@ void	btConvexHullShape::batchedUnitVectorGetSupportingVertexWithoutMargin(const
         btVector3 vec = vectors[j] * m_localScaling;        // dot(a*b,c) = dot(a,b*c)
         if( 0 <  m_unscaledPoints.size() )
         {
-            int i = (int) vec.maxDot( &m_unscaledPoints[0], m_unscaledPoints.size(), newDot);
+            int i = m_supportMap ? m_supportMap->getSupportingPointIndex(vec, newDot) :
+                (int) vec.maxDot( &m_unscaledPoints[0], m_unscaledPoints.size(), newDot);
             supportVerticesOut[j] = getScaledPoint(i);
             supportVerticesOut[j][3] = newDot;        
         }
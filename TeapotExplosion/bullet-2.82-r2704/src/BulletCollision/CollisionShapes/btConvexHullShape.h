@@ -20,6 +20,7 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h" // for the types
 #include "LinearMath/btAlignedObjectArray.h"
 
+class btConvexHullSupportMap;
 
 ///The btConvexHullShape implements an implicit convex hull of an array of vertices.
 ///Bullet provides a general and fast collision detector for convex shapes based on GJK and EPA using localGetSupportingVertex.
@@ -27,6 +28,10 @@ ATTRIBUTE_ALIGNED16(class) btConvexHullShape : public btPolyhedralConvexAabbCach
 {
 	btAlignedObjectArray<btVector3>	m_unscaledPoints;
 
+	btConvexHullSupportMap*	m_supportMap;
+
+	void	removeSupportMap();
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -36,8 +41,20 @@ public:
 	///btConvexHullShape make an internal copy of the points.
 	btConvexHullShape(const btScalar* points=0,int numPoints=0, int stride=sizeof(btVector3));
 
+	virtual ~btConvexHullShape();
+
+	///addPoint removes the support map, call initializeSupportMap again after the last point
 	void addPoint(const btVector3& point, bool recalculateLocalAabb = true);
 
+	///the support functions of hulls with many points climb the vertex adjacency of the hull instead of testing every point,
+	///see btConvexHullSupportMap. Returns false if the hull has no points.
+	bool	initializeSupportMap();
+
+	const btConvexHullSupportMap*	getSupportMap() const
+	{
+		return m_supportMap;
+	}
+
 	
 	btVector3* getUnscaledPoints()
 	{
@@ -0,0 +1,231 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btConvexHullSupportMap.h"
+#include "LinearMath/btConvexHullComputer.h"
+
+
+btConvexHullSupportMap::btConvexHullSupportMap()
+:m_paddedNumVertices(0)
+{
+	for (int i=0;i<6;i++)
+	{
+		m_startVertices[i] = 0;
+	}
+}
+
+bool	btConvexHullSupportMap::build(const btVector3* points,int numPoints)
+{
+	m_vertices.resize(0);
+	m_pointIndices.resize(0);
+	m_adjacencyOffsets.resize(0);
+	m_adjacency.resize(0);
+	m_coordinates.resize(0);
+	m_paddedNumVertices = 0;
+	if (numPoints<=0)
+		return false;
+
+	btConvexHullComputer conv;
+	conv.compute(&points[0].getX(), sizeof(btVector3),numPoints,0.f,0.f);
+	const int numVertices = conv.vertices.size();
+	if (numVertices==0)
+		return false;
+
+	//the hull computer works on rounded coordinates, keep the original point nearest to each hull vertex
+	m_vertices.resize(numVertices);
+	m_pointIndices.resize(numVertices);
+	for (int v=0;v<numVertices;v++)
+	{
+		int nearest = 0;
+		btScalar nearestDistance2 = conv.vertices[v].distance2(points[0]);
+		for (int i=1;i<numPoints;i++)
+		{
+			const btScalar distance2 = conv.vertices[v].distance2(points[i]);
+			if (distance2<nearestDistance2)
+			{
+				nearestDistance2 = distance2;
+				nearest = i;
+			}
+		}
+		m_pointIndices[v] = nearest;
+		m_vertices[v] = points[nearest];
+	}
+
+	//every edge is stored in both directions, so each vertex sees each of its neighbours once
+	m_adjacencyOffsets.resize(numVertices+1);
+	for (int v=0;v<=numVertices;v++)
+	{
+		m_adjacencyOffsets[v] = 0;
+	}
+	for (int e=0;e<conv.edges.size();e++)
+	{
+		m_adjacencyOffsets[conv.edges[e].getSourceVertex()+1]++;
+	}
+	for (int v=0;v<numVertices;v++)
+	{
+		m_adjacencyOffsets[v+1] += m_adjacencyOffsets[v];
+	}
+	m_adjacency.resize(conv.edges.size());
+	btAlignedObjectArray<int> fill;
+	fill.resize(numVertices);
+	for (int v=0;v<numVertices;v++)
+	{
+		fill[v] = m_adjacencyOffsets[v];
+	}
+	for (int e=0;e<conv.edges.size();e++)
+	{
+		const btConvexHullComputer::Edge& edge = conv.edges[e];
+		m_adjacency[fill[edge.getSourceVertex()]++] = edge.getTargetVertex();
+	}
+
+	//the padding repeats the last vertex, it never wins over the vertex itself
+	m_paddedNumVertices = (numVertices+3)&~3;
+	m_coordinates.resize(3*m_paddedNumVertices);
+	for (int v=0;v<m_paddedNumVertices;v++)
+	{
+		const btVector3& vertex = m_vertices[btMin(v,numVertices-1)];
+		m_coordinates[v] = vertex.getX();
+		m_coordinates[m_paddedNumVertices+v] = vertex.getY();
+		m_coordinates[2*m_paddedNumVertices+v] = vertex.getZ();
+	}
+
+	for (int axis=0;axis<3;axis++)
+	{
+		int maxVertex = 0;
+		int minVertex = 0;
+		for (int v=1;v<numVertices;v++)
+		{
+			if (m_vertices[v][axis]>m_vertices[maxVertex][axis])
+				maxVertex = v;
+			if (m_vertices[v][axis]<m_vertices[minVertex][axis])
+				minVertex = v;
+		}
+		m_startVertices[2*axis] = maxVertex;
+		m_startVertices[2*axis+1] = minVertex;
+	}
+	return true;
+}
+
+int		btConvexHullSupportMap::getStartVertex(const btVector3& dir) const
+{
+	const int axis = dir.closestAxis();
+	return m_startVertices[2*axis + (dir[axis]<btScalar(0.) ? 1 : 0)];
+}
+
+int		btConvexHullSupportMap::getSupportingPointIndex(const btVector3& dir,btScalar& maxDot) const
+{
+	btAssert(getNumVertices()>0);
+	if (getNumVertices()<BT_SUPPORT_MAP_MIN_CLIMB_VERTICES)
+	{
+		return m_pointIndices[findSupportingVertex(dir,maxDot)];
+	}
+	return m_pointIndices[climbToSupportingVertex(dir,getStartVertex(dir),maxDot)];
+}
+
+int		btConvexHullSupportMap::getSupportingPointIndex(const btVector3& dir,btScalar& maxDot,int& warmStartVertex) const
+{
+	btAssert(getNumVertices()>0);
+	if (getNumVertices()<BT_SUPPORT_MAP_MIN_CLIMB_VERTICES)
+	{
+		warmStartVertex = findSupportingVertex(dir,maxDot);
+	} else
+	{
+		const int startVertex = (warmStartVertex>=0 && warmStartVertex<getNumVertices()) ? warmStartVertex : getStartVertex(dir);
+		warmStartVertex = climbToSupportingVertex(dir,startVertex,maxDot);
+	}
+	return m_pointIndices[warmStartVertex];
+}
+
+int		btConvexHullSupportMap::climbToSupportingVertex(const btVector3& dir,int startVertex,btScalar& maxDot) const
+{
+	//a linear function has no local maximum on a convex polytope that is not the global maximum,
+	//so moving to the best neighbour until no neighbour is better ends at a supporting vertex
+	int vertex = startVertex;
+	btScalar vertexDot = m_vertices[vertex].dot(dir);
+	for (;;)
+	{
+		int bestNeighbour = vertex;
+		for (int i=m_adjacencyOffsets[vertex];i<m_adjacencyOffsets[vertex+1];i++)
+		{
+			const int neighbour = m_adjacency[i];
+			const btScalar dot = m_vertices[neighbour].dot(dir);
+			if (dot>vertexDot)
+			{
+				vertexDot = dot;
+				bestNeighbour = neighbour;
+			}
+		}
+		if (bestNeighbour==vertex)
+			break;
+		vertex = bestNeighbour;
+	}
+	maxDot = vertexDot;
+	return vertex;
+}
+
+int		btConvexHullSupportMap::findSupportingVertex(const btVector3& dir,btScalar& maxDot) const
+{
+#ifdef BT_USE_SSE_SUPPORT_MAP
+	const btScalar* x = &m_coordinates[0];
+	const btScalar* y = x+m_paddedNumVertices;
+	const btScalar* z = y+m_paddedNumVertices;
+	const __m128 dirX = _mm_set1_ps(dir.getX());
+	const __m128 dirY = _mm_set1_ps(dir.getY());
+	const __m128 dirZ = _mm_set1_ps(dir.getZ());
+	const __m128i four = _mm_set1_epi32(4);
+	__m128 laneMaxDot = _mm_set1_ps(-SIMD_INFINITY);
+	__m128i laneMaxIndex = _mm_setzero_si128();
+	__m128i index = _mm_setr_epi32(0,1,2,3);
+	for (int i=0;i<m_paddedNumVertices;i+=4)
+	{
+		const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(x+i),dirX),_mm_mul_ps(_mm_load_ps(y+i),dirY)),_mm_mul_ps(_mm_load_ps(z+i),dirZ));
+		const __m128 greater = _mm_cmpgt_ps(dot,laneMaxDot);
+		const __m128i greaterMask = _mm_castps_si128(greater);
+		laneMaxDot = _mm_or_ps(_mm_and_ps(greater,dot),_mm_andnot_ps(greater,laneMaxDot));
+		laneMaxIndex = _mm_or_si128(_mm_and_si128(greaterMask,index),_mm_andnot_si128(greaterMask,laneMaxIndex));
+		index = _mm_add_epi32(index,four);
+	}
+	ATTRIBUTE_ALIGNED16(btScalar laneDots[4]);
+	ATTRIBUTE_ALIGNED16(int laneIndices[4]);
+	_mm_store_ps(laneDots,laneMaxDot);
+	_mm_store_si128((__m128i*)laneIndices,laneMaxIndex);
+
+	//the first of the largest, as btVector3::maxDot
+	int vertex = laneIndices[0];
+	maxDot = laneDots[0];
+	for (int l=1;l<4;l++)
+	{
+		if (laneDots[l]>maxDot || (laneDots[l]==maxDot && laneIndices[l]<vertex))
+		{
+			maxDot = laneDots[l];
+			vertex = laneIndices[l];
+		}
+	}
+	return vertex;
+#else
+	int vertex = 0;
+	maxDot = -SIMD_INFINITY;
+	for (int v=0;v<m_vertices.size();v++)
+	{
+		const btScalar dot = m_vertices[v].dot(dir);
+		if (dot>maxDot)
+		{
+			maxDot = dot;
+			vertex = v;
+		}
+	}
+	return vertex;
+#endif
+}
@@ -0,0 +1,82 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_CONVEX_HULL_SUPPORT_MAP_H
+#define BT_CONVEX_HULL_SUPPORT_MAP_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(BT_USE_SSE) || defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define BT_USE_SSE_SUPPORT_MAP
+#endif
+
+///hulls with fewer vertices than this are searched with the brute force loop, hill climbing doesn't pay off for them
+#define BT_SUPPORT_MAP_MIN_CLIMB_VERTICES 64
+
+///btConvexHullSupportMap answers the support queries of a point set, the point with the largest dot product with a direction.
+///Only the vertices of the convex hull of the points are kept. Large hulls climb the vertex adjacency of the hull from a start
+///vertex to the supporting vertex, small hulls are searched with a SIMD loop over a structure of arrays copy of the vertices.
+///The returned index is the index of the point in the array the map was built from. Unlike btVector3::maxDot, the point
+///returned for a direction with several supporting points depends on the start vertex.
+///See btConvexHullShape::initializeSupportMap and btConvexPointCloudShape::initializeSupportMap.
+ATTRIBUTE_ALIGNED16(class) btConvexHullSupportMap
+{
+	btAlignedObjectArray<btVector3>	m_vertices;
+	btAlignedObjectArray<int>		m_pointIndices;
+	btAlignedObjectArray<int>		m_adjacencyOffsets;	// the neighbours of vertex i are m_adjacency[m_adjacencyOffsets[i]..m_adjacencyOffsets[i+1]-1]
+	btAlignedObjectArray<int>		m_adjacency;
+	btAlignedObjectArray<btScalar>	m_coordinates;		// x, y and z of the vertices in three blocks of m_paddedNumVertices
+	int								m_paddedNumVertices;
+	int								m_startVertices[6];	// the vertices with the largest +x, -x, +y, -y, +z and -z
+
+	int		getStartVertex(const btVector3& dir) const;
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btConvexHullSupportMap();
+
+	///computes the convex hull of the points, returns false if there are no points
+	bool	build(const btVector3* points,int numPoints);
+
+	int		getNumVertices() const
+	{
+		return m_vertices.size();
+	}
+
+	///the index of the point of the hull vertex
+	int		getPointIndex(int vertex) const
+	{
+		return m_pointIndices[vertex];
+	}
+
+	///returns the index of the supporting point of dir and its dot product with dir
+	int		getSupportingPointIndex(const btVector3& dir,btScalar& maxDot) const;
+
+	///as getSupportingPointIndex, but large hulls climb from warmStartVertex, a hull vertex from an earlier query with a
+	///similar direction or -1. It is set to the supporting hull vertex.
+	int		getSupportingPointIndex(const btVector3& dir,btScalar& maxDot,int& warmStartVertex) const;
+
+	///the hill climbing of getSupportingPointIndex, returns the supporting hull vertex
+	int		climbToSupportingVertex(const btVector3& dir,int startVertex,btScalar& maxDot) const;
+
+	///the brute force search of getSupportingPointIndex, returns the supporting hull vertex
+	int		findSupportingVertex(const btVector3& dir,btScalar& maxDot) const;
+};
+
+#endif //BT_CONVEX_HULL_SUPPORT_MAP_H
@@ -14,10 +14,40 @@ subject to the following restrictions:
 */
 
 #include "btConvexPointCloudShape.h"
+#include "btConvexHullSupportMap.h"
 #include "BulletCollision/CollisionShapes/btCollisionMargin.h"
 
 #include "LinearMath/btQuaternion.h"
 
+btConvexPointCloudShape::~btConvexPointCloudShape()
+{
+	removeSupportMap();
+}
+
+void	btConvexPointCloudShape::removeSupportMap()
+{
+	if (m_supportMap)
+	{
+		m_supportMap->~btConvexHullSupportMap();
+		btAlignedFree(m_supportMap);
+		m_supportMap = 0;
+	}
+}
+
+bool	btConvexPointCloudShape::initializeSupportMap()
+{
+	if (!m_supportMap)
+	{
+		void* mem = btAlignedAlloc(sizeof(btConvexHullSupportMap),16);
+		m_supportMap = new (mem) btConvexHullSupportMap;
+	}
+	if (m_numPoints>0 && m_supportMap->build(m_unscaledPoints,m_numPoints))
+		return true;
+
+	removeSupportMap();
+	return false;
+}
+
 void btConvexPointCloudShape::setLocalScaling(const btVector3& scaling)
 {
 	m_localScaling = scaling;
@@ -45,7 +75,8 @@ btVector3	btConvexPointCloudShape::localGetSupportingVertexWithoutMargin(const b
     {
         // Here we take advantage of dot(a*b, c) = dot( a, b*c) to do less work. Note this transformation is true mathematically, not numerically.
     //    btVector3 scaled = vec * m_localScaling;
-        int index = (int) vec.maxDot( &m_unscaledPoints[0], m_numPoints, maxDot);   //FIXME: may violate encapsulation of m_unscaledPoints
+        int index = m_supportMap ? m_supportMap->getSupportingPointIndex(vec, maxDot) :
+            (int) vec.maxDot( &m_unscaledPoints[0], m_numPoints, maxDot);   //FIXME: may violate encapsulation of m_unscaledPoints
         return getScaledPoint(index);
     }
 
@@ -58,7 +89,8 @@ void	btConvexPointCloudShape::batchedUnitVectorGetSupportingVertexWithoutMargin(
     {
         const btVector3& vec = vectors[j] * m_localScaling;  // dot( a*c, b) = dot(a, b*c)
         btScalar maxDot;
-        int index = (int) vec.maxDot( &m_unscaledPoints[0], m_numPoints, maxDot);
+        int index = m_supportMap ? m_supportMap->getSupportingPointIndex(vec, maxDot) :
+            (int) vec.maxDot( &m_unscaledPoints[0], m_numPoints, maxDot);
         supportVerticesOut[j][3] = btScalar(-BT_LARGE_FLOAT);
         if( 0 <= index )
         {
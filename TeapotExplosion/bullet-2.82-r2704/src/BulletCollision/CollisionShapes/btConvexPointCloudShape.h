@@ -20,12 +20,18 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h" // for the types
 #include "LinearMath/btAlignedObjectArray.h"
 
+class btConvexHullSupportMap;
+
 ///The btConvexPointCloudShape implements an implicit convex hull of an array of vertices.
 ATTRIBUTE_ALIGNED16(class) btConvexPointCloudShape : public btPolyhedralConvexAabbCachingShape
 {
 	btVector3* m_unscaledPoints;
 	int m_numPoints;
 
+	btConvexHullSupportMap*	m_supportMap;
+
+	void	removeSupportMap();
+
 public:
 	BT_DECLARE_ALIGNED_ALLOCATOR();
 
@@ -35,6 +41,7 @@ public:
 		m_shapeType = CONVEX_POINT_CLOUD_SHAPE_PROXYTYPE;
 		m_unscaledPoints = 0;
 		m_numPoints = 0;
+		m_supportMap = 0;
 	}
 
 	btConvexPointCloudShape(btVector3* points,int numPoints, const btVector3& localScaling,bool computeAabb = true)
@@ -43,21 +50,35 @@ public:
 		m_shapeType = CONVEX_POINT_CLOUD_SHAPE_PROXYTYPE;
 		m_unscaledPoints = points;
 		m_numPoints = numPoints;
+		m_supportMap = 0;
 
 		if (computeAabb)
 			recalcLocalAabb();
 	}
 
+	virtual ~btConvexPointCloudShape();
+
+	///setPoints removes the support map, call initializeSupportMap again for the new points
 	void setPoints (btVector3* points, int numPoints, bool computeAabb = true,const btVector3& localScaling=btVector3(1.f,1.f,1.f))
 	{
 		m_unscaledPoints = points;
 		m_numPoints = numPoints;
 		m_localScaling = localScaling;
+		removeSupportMap();
 
 		if (computeAabb)
 			recalcLocalAabb();
 	}
 
+	///the support functions of point clouds with many points climb the vertex adjacency of their convex hull instead of
+	///testing every point, see btConvexHullSupportMap. The points must not change afterwards. Returns false if there are no points.
+	bool	initializeSupportMap();
+
+	const btConvexHullSupportMap*	getSupportMap() const
+	{
+		return m_supportMap;
+	}
+
 	SIMD_FORCE_INLINE	btVector3* getUnscaledPoints()
 	{
 		return m_unscaledPoints;
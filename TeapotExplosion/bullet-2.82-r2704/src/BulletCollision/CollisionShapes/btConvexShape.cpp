@@ -25,6 +25,7 @@ subject to the following restrictions:
 #include "btCapsuleShape.h"
 #include "btConvexHullShape.h"
 #include "btConvexPointCloudShape.h"
+#include "btConvexHullSupportMap.h"
 
 ///not supported on IBM SDK, until we fix the alignment of btVector3
 #if defined (__CELLOS_LV2__) && defined (__SPU__)
@@ -66,7 +67,7 @@ void btConvexShape::project(const btTransform& trans, const btVector3& dir, btSc
 }
 
 
-static btVector3 convexHullSupport (const btVector3& localDirOrg, const btVector3* points, int numPoints, const btVector3& localScaling)
+static btVector3 convexHullSupport (const btVector3& localDirOrg, const btVector3* points, int numPoints, const btVector3& localScaling, const btConvexHullSupportMap* supportMap)
 {	
 
 	btVector3 vec = localDirOrg * localScaling;
@@ -115,7 +116,7 @@ static btVector3 convexHullSupport (const btVector3& localDirOrg, const btVector
 #else
 
     btScalar maxDot;
-    long ptIndex = vec.maxDot( points, numPoints, maxDot);
+    long ptIndex = supportMap ? supportMap->getSupportingPointIndex( vec, maxDot) : vec.maxDot( points, numPoints, maxDot);
 	btAssert(ptIndex >= 0);
 	btVector3 supVec = points[ptIndex] * localScaling;
 	return supVec;
@@ -278,14 +279,14 @@ btVector3 btConvexShape::localGetSupportVertexWithoutMarginNonVirtual (const btV
 		btConvexPointCloudShape* convexPointCloudShape = (btConvexPointCloudShape*)this;
 		btVector3* points = convexPointCloudShape->getUnscaledPoints ();
 		int numPoints = convexPointCloudShape->getNumPoints ();
-		return convexHullSupport (localDir, points, numPoints,convexPointCloudShape->getLocalScalingNV());
+		return convexHullSupport (localDir, points, numPoints,convexPointCloudShape->getLocalScalingNV(),convexPointCloudShape->getSupportMap());
 	}
 	case CONVEX_HULL_SHAPE_PROXYTYPE:
 	{
 		btConvexHullShape* convexHullShape = (btConvexHullShape*)this;
 		btVector3* points = convexHullShape->getUnscaledPoints();
 		int numPoints = convexHullShape->getNumPoints ();
-		return convexHullSupport (localDir, points, numPoints,convexHullShape->getLocalScalingNV());
+		return convexHullSupport (localDir, points, numPoints,convexHullShape->getLocalScalingNV(),convexHullShape->getSupportMap());
 	}
     default:
 #ifndef __SPU__
@@ -18,6 +18,63 @@ subject to the following restrictions:
 #include "LinearMath/btTransformUtil.h"
 
 
+///reads the raw heights of heightfield data of type T, as getRawHeightFieldValue does without the switch on the data type
+template <typename T>
+struct btHeightfieldDataAccessor
+{
+	const T*	m_data;
+	int			m_width;
+	btScalar	m_heightScale;
+
+	btHeightfieldDataAccessor(const T* data,int width,btScalar heightScale)
+		:m_data(data),
+		m_width(width),
+		m_heightScale(heightScale)
+	{
+	}
+
+	SIMD_FORCE_INLINE btScalar operator()(int x,int y) const
+	{
+		return m_data[(y*m_width)+x] * m_heightScale;
+	}
+};
+
+///float heights are not scaled
+template <>
+struct btHeightfieldDataAccessor<btScalar>
+{
+	const btScalar*	m_data;
+	int				m_width;
+
+	btHeightfieldDataAccessor(const btScalar* data,int width,btScalar /*heightScale*/)
+		:m_data(data),
+		m_width(width)
+	{
+	}
+
+	SIMD_FORCE_INLINE btScalar operator()(int x,int y) const
+	{
+		return m_data[(y*m_width)+x];
+	}
+};
+
+///reads the raw heights through getRawHeightFieldValue, for derived classes that provide their own heights
+struct btHeightfieldVirtualAccessor
+{
+	const btHeightfieldTerrainShape*	m_shape;
+
+	btHeightfieldVirtualAccessor(const btHeightfieldTerrainShape* shape)
+		:m_shape(shape)
+	{
+	}
+
+	SIMD_FORCE_INLINE btScalar operator()(int x,int y) const
+	{
+		return m_shape->getRawHeightFieldValue(x,y);
+	}
+};
+
+
 
 btHeightfieldTerrainShape::btHeightfieldTerrainShape
 (
@@ -193,8 +250,14 @@ void	btHeightfieldTerrainShape::getVertex(int x,int y,btVector3& vertex) const
 	btAssert(x<m_heightStickWidth);
 	btAssert(y<m_heightStickLength);
 
-	btScalar	height = getRawHeightFieldValue(x,y);
+	getVertex(x,y,getRawHeightFieldValue(x,y),vertex);
+}
+
+
 
+/// this returns the vertex of the raw height at x,y in bullet-local coordinates
+void	btHeightfieldTerrainShape::getVertex(int x,int y,btScalar height,btVector3& vertex) const
+{
 	switch (m_upAxis)
 	{
 	case 0:
@@ -250,6 +313,19 @@ btScalar x
 
 
 
+/// the index of the grid line at or below x
+static inline int
+getFloored
+(
+btScalar x
+)
+{
+	const int i = (int) x;
+	return (x < btScalar(i)) ? i - 1 : i;
+}
+
+
+
 /// given input vector, return quantized version
 /**
   This routine is basically determining the gridpoint indices for a given
@@ -273,12 +349,293 @@ void btHeightfieldTerrainShape::quantizeWithClamp(int* out, const btVector3& poi
 
 
 
+template <class Accessor>
+void	btHeightfieldTerrainShape::updatePyramid(const Accessor& heights,int startX,int startJ,int endX,int endJ)
+{
+	//the blocks with a cell that has a corner in the range
+	int nodeStartX = btMax(startX-1,0)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int nodeStartJ = btMax(startJ-1,0)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int nodeEndX = btMin(endX,m_heightStickWidth-2)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int nodeEndJ = btMin(endJ,m_heightStickLength-2)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+
+	const int blockSize = 1<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int nodeX,nodeJ;
+	for (nodeJ=nodeStartJ;nodeJ<=nodeEndJ;nodeJ++)
+	{
+		for (nodeX=nodeStartX;nodeX<=nodeEndX;nodeX++)
+		{
+			const int x0 = nodeX*blockSize;
+			const int x1 = btMin(x0+blockSize,m_heightStickWidth-1);
+			const int j0 = nodeJ*blockSize;
+			const int j1 = btMin(j0+blockSize,m_heightStickLength-1);
+			btScalar minHeight = heights(x0,j0);
+			btScalar maxHeight = minHeight;
+			for (int j=j0;j<=j1;j++)
+			{
+				for (int x=x0;x<=x1;x++)
+				{
+					const btScalar height = heights(x,j);
+					minHeight = btMin(minHeight,height);
+					maxHeight = btMax(maxHeight,height);
+				}
+			}
+			const int node = m_pyramidLevelOffsets[0]+nodeJ*getPyramidLevelWidth(0)+nodeX;
+			m_pyramidRanges[2*node] = minHeight;
+			m_pyramidRanges[2*node+1] = maxHeight;
+		}
+	}
+
+	const int numLevels = m_pyramidLevelOffsets.size()-1;
+	for (int level=1;level<numLevels;level++)
+	{
+		nodeStartX >>= 1;
+		nodeStartJ >>= 1;
+		nodeEndX >>= 1;
+		nodeEndJ >>= 1;
+		const int childWidth = getPyramidLevelWidth(level-1);
+		const int childLength = getPyramidLevelLength(level-1);
+		for (nodeJ=nodeStartJ;nodeJ<=nodeEndJ;nodeJ++)
+		{
+			for (nodeX=nodeStartX;nodeX<=nodeEndX;nodeX++)
+			{
+				btScalar minHeight = BT_LARGE_FLOAT;
+				btScalar maxHeight = -BT_LARGE_FLOAT;
+				for (int childJ=2*nodeJ;childJ<btMin(2*nodeJ+2,childLength);childJ++)
+				{
+					for (int childX=2*nodeX;childX<btMin(2*nodeX+2,childWidth);childX++)
+					{
+						const btScalar* childRange = getPyramidRange(level-1,childX,childJ);
+						minHeight = btMin(minHeight,childRange[0]);
+						maxHeight = btMax(maxHeight,childRange[1]);
+					}
+				}
+				const int node = m_pyramidLevelOffsets[level]+nodeJ*getPyramidLevelWidth(level)+nodeX;
+				m_pyramidRanges[2*node] = minHeight;
+				m_pyramidRanges[2*node+1] = maxHeight;
+			}
+		}
+	}
+}
+
+
+
+/// reports the triangles of the cells of the node in cellRange (startX,endX,startJ,endJ) that overlap minHeight..maxHeight
+template <class Accessor>
+void	btHeightfieldTerrainShape::processPyramidNode(const Accessor& heights,btTriangleCallback* callback,int level,int nodeX,int nodeJ,const int* cellRange,btScalar minHeight,btScalar maxHeight) const
+{
+	const int shift = level+BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	const int startX = btMax(nodeX<<shift,cellRange[0]);
+	const int endX = btMin((nodeX+1)<<shift,cellRange[1]);
+	const int startJ = btMax(nodeJ<<shift,cellRange[2]);
+	const int endJ = btMin((nodeJ+1)<<shift,cellRange[3]);
+	if (startX>=endX || startJ>=endJ)
+		return;
+
+	const btScalar* range = getPyramidRange(level,nodeX,nodeJ);
+	if (range[0]>maxHeight || range[1]<minHeight)
+		return;
+
+	if (level>0)
+	{
+		for (int childJ=2*nodeJ;childJ<2*nodeJ+2;childJ++)
+		{
+			for (int childX=2*nodeX;childX<2*nodeX+2;childX++)
+			{
+				processPyramidNode(heights,callback,level-1,childX,childJ,cellRange,minHeight,maxHeight);
+			}
+		}
+		return;
+	}
+
+	for (int j=startJ;j<endJ;j++)
+	{
+		for (int x=startX;x<endX;x++)
+		{
+			btScalar cellHeights[4];
+			cellHeights[0] = heights(x,j);
+			cellHeights[1] = heights(x+1,j);
+			cellHeights[2] = heights(x,j+1);
+			cellHeights[3] = heights(x+1,j+1);
+			const btScalar cellMin = btMin(btMin(cellHeights[0],cellHeights[1]),btMin(cellHeights[2],cellHeights[3]));
+			const btScalar cellMax = btMax(btMax(cellHeights[0],cellHeights[1]),btMax(cellHeights[2],cellHeights[3]));
+			if (cellMin>maxHeight || cellMax<minHeight)
+				continue;
+			processCell(callback,x,j,cellHeights);
+		}
+	}
+}
+
+
+
+/// walks the cells under the ray in the order the ray crosses them
+/**
+  The walk starts at the coarsest level of the pyramid, level 0 being the
+  cells. A node whose height range the ray misses while it is above the node
+  is stepped over, otherwise the walk goes down to the child under the ray.
+  After a step that leaves the parent the walk goes up a level again.
+  Without a pyramid the walk is a plain DDA over the cells.
+ */
+template <class Accessor>
+void	btHeightfieldTerrainShape::marchRay(const Accessor& heights,btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const
+{
+	int gridAxes[2];
+	switch (m_upAxis)
+	{
+	case 0:
+		{
+			gridAxes[0] = 1;
+			gridAxes[1] = 2;
+			break;
+		}
+	case 1:
+		{
+			gridAxes[0] = 0;
+			gridAxes[1] = 2;
+			break;
+		}
+	default:
+		{
+			gridAxes[0] = 0;
+			gridAxes[1] = 1;
+		}
+	}
+
+	// the ray in unscaled grid coordinates, the height is the raw height
+	const btVector3 invScaling(btScalar(1.)/m_localScaling[0],btScalar(1.)/m_localScaling[1],btScalar(1.)/m_localScaling[2]);
+	const btVector3 from = raySource*invScaling + m_localOrigin;
+	const btVector3 dir = rayTarget*invScaling + m_localOrigin - from;
+	const btScalar origin[2] = {from[gridAxes[0]],from[gridAxes[1]]};
+	const btScalar delta[2] = {dir[gridAxes[0]],dir[gridAxes[1]]};
+	const int numCells[2] = {m_heightStickWidth-1,m_heightStickLength-1};
+
+	// clip the ray to the columns above the grid
+	btScalar tEnter = btScalar(0.);
+	btScalar tLeave = btScalar(1.);
+	int i;
+	for (i=0;i<2;i++)
+	{
+		if (delta[i]==btScalar(0.))
+		{
+			if (origin[i]<btScalar(0.) || origin[i]>btScalar(numCells[i]))
+				return;
+			continue;
+		}
+		btScalar t0 = -origin[i]/delta[i];
+		btScalar t1 = (btScalar(numCells[i])-origin[i])/delta[i];
+		if (t0>t1)
+			btSwap(t0,t1);
+		tEnter = btMax(tEnter,t0);
+		tLeave = btMin(tLeave,t1);
+	}
+	if (tEnter>tLeave)
+		return;
+
+	// the height of the ray is compared with some slack, a false positive only costs a triangle test
+	const btScalar tolerance = SIMD_EPSILON*btScalar(64.)*(btFabs(m_minHeight)+btFabs(m_maxHeight)+m_width+m_length);
+
+	int cell[2];
+	for (i=0;i<2;i++)
+	{
+		cell[i] = getFloored(origin[i]+delta[i]*tEnter);
+		cell[i] = btMax(0,btMin(cell[i],numCells[i]-1));
+	}
+
+	const int topLevel = hasMinMaxPyramid() ? m_pyramidLevelOffsets.size()-1 : 0;
+	int level = topLevel;
+	btScalar t = tEnter;
+	for (;;)
+	{
+		const int shift = level ? level-1+BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT : 0;
+		int nodeStart[2];
+		int nodeEnd[2];
+		btScalar tAxis[2];
+		btScalar tExit = tLeave;
+		for (i=0;i<2;i++)
+		{
+			nodeStart[i] = (cell[i]>>shift)<<shift;
+			nodeEnd[i] = btMin(nodeStart[i]+(1<<shift),numCells[i]);
+			if (delta[i]>btScalar(0.))
+			{
+				tAxis[i] = (btScalar(nodeEnd[i])-origin[i])/delta[i];
+			} else if (delta[i]<btScalar(0.))
+			{
+				tAxis[i] = (btScalar(nodeStart[i])-origin[i])/delta[i];
+			} else
+			{
+				tAxis[i] = BT_LARGE_FLOAT;
+			}
+			tExit = btMin(tExit,tAxis[i]);
+		}
+
+		// the height range of the ray over the node
+		const btScalar height0 = from[m_upAxis]+dir[m_upAxis]*t;
+		const btScalar height1 = from[m_upAxis]+dir[m_upAxis]*tExit;
+		const btScalar rayMin = btMin(height0,height1)-tolerance;
+		const btScalar rayMax = btMax(height0,height1)+tolerance;
+
+		if (level>0)
+		{
+			const btScalar* range = getPyramidRange(level-1,cell[0]>>shift,cell[1]>>shift);
+			if (range[0]<=rayMax && range[1]>=rayMin)
+			{
+				level--;
+				continue;
+			}
+		} else
+		{
+			btScalar cellHeights[4];
+			cellHeights[0] = heights(cell[0],cell[1]);
+			cellHeights[1] = heights(cell[0]+1,cell[1]);
+			cellHeights[2] = heights(cell[0],cell[1]+1);
+			cellHeights[3] = heights(cell[0]+1,cell[1]+1);
+			const btScalar cellMin = btMin(btMin(cellHeights[0],cellHeights[1]),btMin(cellHeights[2],cellHeights[3]));
+			const btScalar cellMax = btMax(btMax(cellHeights[0],cellHeights[1]),btMax(cellHeights[2],cellHeights[3]));
+			if (cellMin<=rayMax && cellMax>=rayMin)
+			{
+				processCell(callback,cell[0],cell[1],cellHeights);
+			}
+		}
+
+		if (tExit>=tLeave)
+			break;
+
+		// step into the next node, across each side the ray leaves through at tExit
+		t = tExit;
+		const int parentShift = level<topLevel ? level+BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT : 0;
+		bool leftParent = false;
+		for (i=0;i<2;i++)
+		{
+			int next;
+			if (tAxis[i]<=tExit)
+			{
+				next = delta[i]>btScalar(0.) ? nodeEnd[i] : nodeStart[i]-1;
+				if (next<0 || next>=numCells[i])
+					return;
+			} else
+			{
+				next = getFloored(origin[i]+delta[i]*t);
+				next = btMax(nodeStart[i],btMin(next,nodeEnd[i]-1));
+			}
+			leftParent |= (next>>parentShift)!=(cell[i]>>parentShift);
+			cell[i] = next;
+		}
+		if (level<topLevel && leftParent)
+		{
+			level++;
+		}
+	}
+}
+
+
+
 /// process all triangles within the provided axis-aligned bounding box
 /**
   basic algorithm:
     - convert input aabb to local coordinates (scale down and shift for local origin)
     - convert input aabb to a range of heightfield grid points (quantize)
     - iterate over all triangles in that subset of the grid
+    - with a min/max pyramid, skip the blocks and cells out of the height
+      range of the aabb
  */
 void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const
 {
@@ -356,41 +713,80 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	
   
 
-	for(int j=startJ; j<endJ; j++)
+	if (hasMinMaxPyramid())
 	{
-		for(int x=startX; x<endX; x++)
+		//skip the blocks and cells out of the height range of the aabb
+		const int cellRange[4] = {startX,endX,startJ,endJ};
+		const btScalar minHeight = btMin(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		const btScalar maxHeight = btMax(localAabbMin[m_upAxis],localAabbMax[m_upAxis]);
+		const int topLevel = m_pyramidLevelOffsets.size()-2;
+		switch (m_heightDataType)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+		case PHY_FLOAT:
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x+1,j,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-      //  getVertex(x,j,vertices[0]);//already got this vertex before, thanks to Danny Chapman
-        getVertex(x+1,j+1,vertices[1]);
-        getVertex(x,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);				
-			} else
+				processPyramidNode(btHeightfieldDataAccessor<btScalar>(m_heightfieldDataFloat,m_heightStickWidth,m_heightScale),callback,topLevel,0,0,cellRange,minHeight,maxHeight);
+				break;
+			}
+		case PHY_UCHAR:
+			{
+				processPyramidNode(btHeightfieldDataAccessor<unsigned char>(m_heightfieldDataUnsignedChar,m_heightStickWidth,m_heightScale),callback,topLevel,0,0,cellRange,minHeight,maxHeight);
+				break;
+			}
+		case PHY_SHORT:
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x+1,j,vertices[0]);
-        //getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
+				processPyramidNode(btHeightfieldDataAccessor<short>(m_heightfieldDataShort,m_heightStickWidth,m_heightScale),callback,topLevel,0,0,cellRange,minHeight,maxHeight);
+				break;
+			}
+		default:
+			{
+				btAssert(!"Bad m_heightDataType");
 			}
 		}
+		return;
 	}
 
-	
+	for(int j=startJ; j<endJ; j++)
+	{
+		for(int x=startX; x<endX; x++)
+		{
+			btScalar heights[4];
+			heights[0] = getRawHeightFieldValue(x,j);
+			heights[1] = getRawHeightFieldValue(x+1,j);
+			heights[2] = getRawHeightFieldValue(x,j+1);
+			heights[3] = getRawHeightFieldValue(x+1,j+1);
+			processCell(callback,x,j,heights);
+		}
+	}
+}
+
 
+
+void	btHeightfieldTerrainShape::processCell(btTriangleCallback* callback,int x,int j,const btScalar* heights) const
+{
+	btVector3 vertices[3];
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1))|| (m_useZigzagSubdivision  && !(j & 1)))
+	{
+		//first triangle
+		getVertex(x,j,heights[0],vertices[0]);
+		getVertex(x+1,j,heights[1],vertices[1]);
+		getVertex(x+1,j+1,heights[3],vertices[2]);
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		getVertex(x+1,j+1,heights[3],vertices[1]);
+		getVertex(x,j+1,heights[2],vertices[2]);
+		callback->processTriangle(vertices,x,j);
+	} else
+	{
+		//first triangle
+		getVertex(x,j,heights[0],vertices[0]);
+		getVertex(x,j+1,heights[2],vertices[1]);
+		getVertex(x+1,j,heights[1],vertices[2]);
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		getVertex(x+1,j,heights[1],vertices[0]);
+		getVertex(x+1,j+1,heights[3],vertices[2]);
+		callback->processTriangle(vertices,x,j);
+	}
 }
 
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
@@ -408,3 +804,99 @@ const btVector3& btHeightfieldTerrainShape::getLocalScaling() const
 {
 	return m_localScaling;
 }
+
+
+
+void	btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const
+{
+	if (!hasMinMaxPyramid())
+	{
+		marchRay(btHeightfieldVirtualAccessor(this),callback,raySource,rayTarget);
+		return;
+	}
+
+	switch (m_heightDataType)
+	{
+	case PHY_FLOAT:
+		{
+			marchRay(btHeightfieldDataAccessor<btScalar>(m_heightfieldDataFloat,m_heightStickWidth,m_heightScale),callback,raySource,rayTarget);
+			break;
+		}
+	case PHY_UCHAR:
+		{
+			marchRay(btHeightfieldDataAccessor<unsigned char>(m_heightfieldDataUnsignedChar,m_heightStickWidth,m_heightScale),callback,raySource,rayTarget);
+			break;
+		}
+	case PHY_SHORT:
+		{
+			marchRay(btHeightfieldDataAccessor<short>(m_heightfieldDataShort,m_heightStickWidth,m_heightScale),callback,raySource,rayTarget);
+			break;
+		}
+	default:
+		{
+			btAssert(!"Bad m_heightDataType");
+		}
+	}
+}
+
+void	btHeightfieldTerrainShape::buildMinMaxPyramid()
+{
+	// levels of halving width and length, up to a single node
+	m_pyramidLevelOffsets.resize(0);
+	int numNodes = 0;
+	for (int level=0;;level++)
+	{
+		m_pyramidLevelOffsets.push_back(numNodes);
+		const int levelWidth = getPyramidLevelWidth(level);
+		const int levelLength = getPyramidLevelLength(level);
+		numNodes += levelWidth*levelLength;
+		if (levelWidth==1 && levelLength==1)
+			break;
+	}
+	m_pyramidLevelOffsets.push_back(numNodes);
+	m_pyramidRanges.resize(2*numNodes);
+
+	updateMinMaxPyramid(0,0,m_heightStickWidth-1,m_heightStickLength-1);
+}
+
+void	btHeightfieldTerrainShape::updateMinMaxPyramid(int startX,int startJ,int endX,int endJ)
+{
+	if (!hasMinMaxPyramid())
+		return;
+
+	startX = btMax(startX,0);
+	startJ = btMax(startJ,0);
+	endX = btMin(endX,m_heightStickWidth-1);
+	endJ = btMin(endJ,m_heightStickLength-1);
+	if (startX>endX || startJ>endJ)
+		return;
+
+	switch (m_heightDataType)
+	{
+	case PHY_FLOAT:
+		{
+			updatePyramid(btHeightfieldDataAccessor<btScalar>(m_heightfieldDataFloat,m_heightStickWidth,m_heightScale),startX,startJ,endX,endJ);
+			break;
+		}
+	case PHY_UCHAR:
+		{
+			updatePyramid(btHeightfieldDataAccessor<unsigned char>(m_heightfieldDataUnsignedChar,m_heightStickWidth,m_heightScale),startX,startJ,endX,endJ);
+			break;
+		}
+	case PHY_SHORT:
+		{
+			updatePyramid(btHeightfieldDataAccessor<short>(m_heightfieldDataShort,m_heightStickWidth,m_heightScale),startX,startJ,endX,endJ);
+			break;
+		}
+	default:
+		{
+			btAssert(!"Bad m_heightDataType");
+		}
+	}
+}
+
+void	btHeightfieldTerrainShape::clearMinMaxPyramid()
+{
+	m_pyramidRanges.resize(0);
+	m_pyramidLevelOffsets.resize(0);
+}
@@ -17,6 +17,10 @@ subject to the following restrictions:
 #define BT_HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+///the blocks of cells at the finest level of the min/max pyramid are (1<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT) cells wide
+#define BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT 2
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -66,6 +70,10 @@ subject to the following restrictions:
   or maximum heights.  These values are used to determine the heightfield's
   axis-aligned bounding box, multiplied by localScaling.
 
+  processAllTriangles and performRaycast can skip the parts of the grid that
+  are out of the height range of the query with a min/max pyramid, see
+  buildMinMaxPyramid.
+
   For usage and testing see the TerrainDemo.
  */
 ATTRIBUTE_ALIGNED16(class) btHeightfieldTerrainShape : public btConcaveShape
@@ -100,9 +108,39 @@ protected:
 	
 	btVector3	m_localScaling;
 
+	///the min/max pyramid, see buildMinMaxPyramid
+	btAlignedObjectArray<btScalar>	m_pyramidRanges;	// the min and max raw height of each node, level by level and row by row
+	btAlignedObjectArray<int>	m_pyramidLevelOffsets;	// the first node of each level, and the number of nodes at the end
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
+	void		getVertex(int x,int y,btScalar height,btVector3& vertex) const;
+
+	///reports the two triangles of the cell at x,j, heights are the raw heights at (x,j), (x+1,j), (x,j+1) and (x+1,j+1)
+	void		processCell(btTriangleCallback* callback,int x,int j,const btScalar* heights) const;
+
+	int		getPyramidLevelWidth(int level) const
+	{
+		return ((m_heightStickWidth-2)>>(level+BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT))+1;
+	}
+	int		getPyramidLevelLength(int level) const
+	{
+		return ((m_heightStickLength-2)>>(level+BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT))+1;
+	}
+	const btScalar*	getPyramidRange(int level,int nodeX,int nodeJ) const
+	{
+		return &m_pyramidRanges[2*(m_pyramidLevelOffsets[level]+nodeJ*getPyramidLevelWidth(level)+nodeX)];
+	}
+
+	template <class Accessor>
+	void	updatePyramid(const Accessor& heights,int startX,int startJ,int endX,int endJ);
+	template <class Accessor>
+	void	processPyramidNode(const Accessor& heights,btTriangleCallback* callback,int level,int nodeX,int nodeJ,const int* cellRange,btScalar minHeight,btScalar maxHeight) const;
+	template <class Accessor>
+	void	marchRay(const Accessor& heights,btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const;
+
+	friend struct btHeightfieldVirtualAccessor;
 
 
 
@@ -153,6 +191,26 @@ public:
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///reports the triangles of the cells crossed by the ray, in local coordinates, walking the grid from raySource to rayTarget.
+	///btCollisionWorld::rayTest calls it instead of processAllTriangles, so a derived class that overrides processAllTriangles
+	///has to override performRaycast as well, for example by passing the aabb of the ray to its processAllTriangles
+	virtual void	performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget) const;
+
+	///builds a pyramid of the min and max heights of blocks of cells. processAllTriangles and performRaycast skip the blocks and
+	///cells out of the height range of the query, and read the heights from the heightfield data with an accessor per data type
+	///instead of getRawHeightFieldValue. Call updateMinMaxPyramid after changing heights.
+	void	buildMinMaxPyramid();
+
+	///updates the pyramid after the heights of the grid points from startX,startJ to endX,endJ (inclusive) changed
+	void	updateMinMaxPyramid(int startX,int startJ,int endX,int endJ);
+
+	void	clearMinMaxPyramid();
+
+	bool	hasMinMaxPyramid() const
+	{
+		return m_pyramidLevelOffsets.size()!=0;
+	}
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
@@ -29,7 +29,7 @@ btOptimizedBvh::~btOptimizedBvh()
 }
 
 
-void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax)
+void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, btBuildMethod buildMethod)
 {
 	m_useQuantization = useQuantizedAabbCompression;
 
@@ -181,7 +181,14 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 
 	m_curNodeIndex = 0;
 
-	buildTree(0,numLeafNodes);
+	if (buildMethod==BUILD_BINNED_SAH)
+	{
+		buildTreeBinnedSah(numLeafNodes);
+	}
+	else
+	{
+		buildTree(0,numLeafNodes);
+	}
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -83,6 +83,16 @@ struct	btTriangleInfoMap : public btHashMap<btHashInt,btTriangleInfo>
 
 	void	deSerialize(struct btTriangleInfoMapData& data);
 
+	///the number of bytes serializeInPlace writes
+	int	calculateInPlaceBufferSize() const;
+
+	///writes the map to a 16 byte aligned buffer in native format, so deSerializeInPlace can use the tables without copying them
+	void	serializeInPlace(void* alignedDataBuffer) const;
+
+	///points the tables of the map into a buffer written by serializeInPlace with the same endianness and btScalar size.
+	///The buffer has to outlive the map, an insert copies the tables out of it. Returns false if the tables don't fit in dataBufferSize bytes
+	bool	deSerializeInPlace(void* alignedDataBuffer,unsigned int dataBufferSize);
+
 };
 
 ///those fields have to be float and not btScalar for the serialization to work properly
@@ -114,6 +124,21 @@ struct	btTriangleInfoMapData
 	char	m_padding[4];
 };
 
+///btTriangleInfoMap::serializeInPlace writes this, followed by the hash table, next, value and key arrays
+struct	btTriangleInfoMapInPlaceData
+{
+	btScalar	m_convexEpsilon;
+	btScalar	m_planarEpsilon;
+	btScalar	m_equalVertexThreshold;
+	btScalar	m_edgeDistanceThreshold;
+	btScalar	m_maxEdgeAngleThreshold;
+	btScalar	m_zeroAreaThreshold;
+	int			m_hashTableSize;
+	int			m_numValues;
+};
+
+#define BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(size) (((size)+15)&~15)
+
 SIMD_FORCE_INLINE	int	btTriangleInfoMap::calculateSerializeBufferSize() const
 {
 	return sizeof(btTriangleInfoMapData);
@@ -237,5 +262,75 @@ SIMD_FORCE_INLINE	void	btTriangleInfoMap::deSerialize(btTriangleInfoMapData& tma
 	}
 }
 
+SIMD_FORCE_INLINE	int	btTriangleInfoMap::calculateInPlaceBufferSize() const
+{
+	return BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btTriangleInfoMapInPlaceData)))
+		+ 2*BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(int))*m_hashTable.size())
+		+ BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btTriangleInfo))*m_valueArray.size())
+		+ BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btHashInt))*m_keyArray.size());
+}
+
+SIMD_FORCE_INLINE	void	btTriangleInfoMap::serializeInPlace(void* alignedDataBuffer) const
+{
+	btTriangleInfoMapInPlaceData* tmapData = (btTriangleInfoMapInPlaceData*)alignedDataBuffer;
+	tmapData->m_convexEpsilon = m_convexEpsilon;
+	tmapData->m_planarEpsilon = m_planarEpsilon;
+	tmapData->m_equalVertexThreshold = m_equalVertexThreshold;
+	tmapData->m_edgeDistanceThreshold = m_edgeDistanceThreshold;
+	tmapData->m_maxEdgeAngleThreshold = m_maxEdgeAngleThreshold;
+	tmapData->m_zeroAreaThreshold = m_zeroAreaThreshold;
+	tmapData->m_hashTableSize = m_hashTable.size();
+	tmapData->m_numValues = m_valueArray.size();
+	btAssert(m_next.size()==m_hashTable.size());
+	btAssert(m_keyArray.size()==m_valueArray.size());
+
+	unsigned char* data = (unsigned char*)alignedDataBuffer + BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btTriangleInfoMapInPlaceData)));
+	const int tableSize = int(sizeof(int))*m_hashTable.size();
+	const int valueSize = int(sizeof(btTriangleInfo))*m_valueArray.size();
+	if (tableSize)
+	{
+		memcpy(data,&m_hashTable[0],tableSize);
+		memcpy(data+BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(tableSize),&m_next[0],tableSize);
+	}
+	data += 2*BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(tableSize);
+	if (valueSize)
+	{
+		memcpy(data,&m_valueArray[0],valueSize);
+		memcpy(data+BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(valueSize),&m_keyArray[0],int(sizeof(btHashInt))*m_keyArray.size());
+	}
+}
+
+SIMD_FORCE_INLINE	bool	btTriangleInfoMap::deSerializeInPlace(void* alignedDataBuffer,unsigned int dataBufferSize)
+{
+	const btTriangleInfoMapInPlaceData* tmapData = (const btTriangleInfoMapInPlaceData*)alignedDataBuffer;
+	const unsigned int headerSize = BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(sizeof(btTriangleInfoMapInPlaceData));
+	if (dataBufferSize<headerSize || tmapData->m_hashTableSize<0 || tmapData->m_numValues<0)
+		return false;
+	//the sizes in 64 bit, the counts of a corrupt buffer can overflow int
+	const unsigned long long tableBytes = BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN((unsigned long long)sizeof(int)*tmapData->m_hashTableSize);
+	const unsigned long long valueBytes = BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN((unsigned long long)sizeof(btTriangleInfo)*tmapData->m_numValues);
+	const unsigned long long keyBytes = BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN((unsigned long long)sizeof(btHashInt)*tmapData->m_numValues);
+	if (2*tableBytes+valueBytes+keyBytes>dataBufferSize-headerSize)
+		return false;
+
+	m_convexEpsilon = tmapData->m_convexEpsilon;
+	m_planarEpsilon = tmapData->m_planarEpsilon;
+	m_equalVertexThreshold = tmapData->m_equalVertexThreshold;
+	m_edgeDistanceThreshold = tmapData->m_edgeDistanceThreshold;
+	m_maxEdgeAngleThreshold = tmapData->m_maxEdgeAngleThreshold;
+	m_zeroAreaThreshold = tmapData->m_zeroAreaThreshold;
+
+	const int hashTableSize = tmapData->m_hashTableSize;
+	const int numValues = tmapData->m_numValues;
+	unsigned char* data = (unsigned char*)alignedDataBuffer + BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btTriangleInfoMapInPlaceData)));
+	const int tableSize = BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(int))*hashTableSize);
+	m_hashTable.initializeFromBuffer(data,hashTableSize,hashTableSize);
+	m_next.initializeFromBuffer(data+tableSize,hashTableSize,hashTableSize);
+	data += 2*tableSize;
+	m_valueArray.initializeFromBuffer(data,numValues,numValues);
+	m_keyArray.initializeFromBuffer(data+BT_TRIANGLE_INFO_MAP_IN_PLACE_ALIGN(int(sizeof(btTriangleInfo))*numValues),numValues,numValues);
+	return true;
+}
+
 
 #endif //_BT_TRIANGLE_INFO_MAP_H
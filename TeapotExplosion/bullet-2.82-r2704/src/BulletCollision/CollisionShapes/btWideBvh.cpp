@@ -0,0 +1,717 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWideBvh.h"
+#include "btStridingMeshInterface.h"
+#include "LinearMath/btAabbUtil2.h"
+
+///number of bins along the split axis of the surface area heuristic
+#define BT_WIDE_BVH_BINS 16
+
+void	btWideBvhNode::setChildren(const int* children,const btVector3* childAabbMin,const btVector3* childAabbMax,int numChildren)
+{
+	btAssert(numChildren>0 && numChildren<=BT_WIDE_BVH_WIDTH);
+	btVector3 aabbMin = childAabbMin[0];
+	btVector3 aabbMax = childAabbMax[0];
+	for (int i=1;i<numChildren;i++)
+	{
+		aabbMin.setMin(childAabbMin[i]);
+		aabbMax.setMax(childAabbMax[i]);
+	}
+	for (int j=0;j<3;j++)
+	{
+		const btScalar origin = aabbMin[j];
+		btScalar scale = (aabbMax[j]-aabbMin[j])/btScalar(255);
+		if (scale<=btScalar(0) && aabbMax[j]>aabbMin[j])
+			scale = aabbMax[j]-aabbMin[j];
+		//rounding can leave the last step short of the maximum
+		while (origin+btScalar(255)*scale<aabbMax[j])
+			scale += scale*SIMD_EPSILON;
+		m_origin[j] = origin;
+		m_scale[j] = scale;
+		for (int i=0;i<numChildren;i++)
+		{
+			int qmin = 0;
+			int qmax = 0;
+			if (scale>btScalar(0))
+			{
+				qmin = btMin(255,btMax(0,int((childAabbMin[i][j]-origin)/scale)));
+				qmax = btMin(255,btMax(0,int((childAabbMax[i][j]-origin)/scale)));
+			}
+			//round outwards, with the same float operations as getChildAabb
+			while (qmin>0 && origin+btScalar(qmin)*scale>childAabbMin[i][j])
+				qmin--;
+			while (qmax<255 && origin+btScalar(qmax)*scale<childAabbMax[i][j])
+				qmax++;
+			m_childMin[j][i] = (unsigned char)qmin;
+			m_childMax[j][i] = (unsigned char)qmax;
+		}
+		for (int i=numChildren;i<BT_WIDE_BVH_WIDTH;i++)
+		{
+			m_childMin[j][i] = 0;
+			m_childMax[j][i] = 0;
+		}
+	}
+	m_origin[3] = btScalar(0);
+	m_scale[3] = btScalar(0);
+	for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+	{
+		m_child[i] = i<numChildren ? children[i] : 0;
+	}
+	m_numChildren = numChildren;
+	m_pad[0] = m_pad[1] = m_pad[2] = 0;
+}
+
+///the box of a triangle, with the minimum size btOptimizedBvh gives it
+static void	btWideBvhTriangleAabb(const btVector3* triangle,btVector3& aabbMin,btVector3& aabbMax)
+{
+	aabbMin = triangle[0];
+	aabbMax = triangle[0];
+	aabbMin.setMin(triangle[1]);
+	aabbMax.setMax(triangle[1]);
+	aabbMin.setMin(triangle[2]);
+	aabbMax.setMax(triangle[2]);
+
+	const btScalar MIN_AABB_DIMENSION = btScalar(0.002);
+	const btScalar MIN_AABB_HALF_DIMENSION = btScalar(0.001);
+	for (int j=0;j<3;j++)
+	{
+		if (aabbMax[j]-aabbMin[j]<MIN_AABB_DIMENSION)
+		{
+			aabbMax[j] += MIN_AABB_HALF_DIMENSION;
+			aabbMin[j] -= MIN_AABB_HALF_DIMENSION;
+		}
+	}
+}
+
+///collects the triangle boxes in the order of InternalProcessAllTriangles
+struct	btWideBvhTriangleCallback : public btInternalTriangleIndexCallback
+{
+	btAlignedObjectArray<btVector3>&			m_aabbMin;
+	btAlignedObjectArray<btVector3>&			m_aabbMax;
+	btAlignedObjectArray<btWideBvhPrimitive>*	m_primitives;
+
+	btWideBvhTriangleCallback(btAlignedObjectArray<btVector3>& aabbMin,btAlignedObjectArray<btVector3>& aabbMax,btAlignedObjectArray<btWideBvhPrimitive>* primitives)
+		:m_aabbMin(aabbMin),
+		m_aabbMax(aabbMax),
+		m_primitives(primitives)
+	{
+	}
+
+	virtual void internalProcessTriangleIndex(btVector3* triangle,int partId,int triangleIndex)
+	{
+		btVector3 aabbMin,aabbMax;
+		btWideBvhTriangleAabb(triangle,aabbMin,aabbMax);
+		m_aabbMin.push_back(aabbMin);
+		m_aabbMax.push_back(aabbMax);
+
+		if (m_primitives)
+		{
+			btWideBvhPrimitive primitive;
+			primitive.m_partId = partId;
+			primitive.m_triangleIndex = triangleIndex;
+			m_primitives->push_back(primitive);
+		}
+	}
+};
+
+///reads single triangles for partialRefit, keeping the last used part of the mesh locked
+struct	btWideBvhRefitData
+{
+	btStridingMeshInterface*	m_triangles;
+	btVector3					m_aabbMin;
+	btVector3					m_aabbMax;
+	int							m_lockedPart;
+	const unsigned char*		m_vertexBase;
+	int							m_numVerts;
+	PHY_ScalarType				m_vertexType;
+	int							m_vertexStride;
+	const unsigned char*		m_indexBase;
+	int							m_indexStride;
+	int							m_numFaces;
+	PHY_ScalarType				m_indexType;
+
+	btWideBvhRefitData(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax)
+		:m_triangles(triangles),
+		m_aabbMin(aabbMin),
+		m_aabbMax(aabbMax),
+		m_lockedPart(-1)
+	{
+	}
+
+	~btWideBvhRefitData()
+	{
+		if (m_lockedPart>=0)
+			m_triangles->unLockReadOnlyVertexBase(m_lockedPart);
+	}
+
+	void	getTriangleAabb(const btWideBvhPrimitive& primitive,btVector3& aabbMin,btVector3& aabbMax)
+	{
+		if (primitive.m_partId!=m_lockedPart)
+		{
+			if (m_lockedPart>=0)
+				m_triangles->unLockReadOnlyVertexBase(m_lockedPart);
+			m_triangles->getLockedReadOnlyVertexIndexBase(&m_vertexBase,m_numVerts,m_vertexType,m_vertexStride,&m_indexBase,m_indexStride,m_numFaces,m_indexType,primitive.m_partId);
+			m_lockedPart = primitive.m_partId;
+		}
+		const unsigned char* indices = m_indexBase+primitive.m_triangleIndex*m_indexStride;
+		const btVector3& meshScaling = m_triangles->getScaling();
+		btVector3 triangle[3];
+		for (int j=0;j<3;j++)
+		{
+			unsigned int index;
+			switch (m_indexType)
+			{
+			case PHY_SHORT:
+				index = ((const unsigned short int*)indices)[j];
+				break;
+			case PHY_UCHAR:
+				index = indices[j];
+				break;
+			default:
+				btAssert(m_indexType==PHY_INTEGER);
+				index = ((const unsigned int*)indices)[j];
+				break;
+			}
+			if (m_vertexType==PHY_DOUBLE)
+			{
+				const double* vertex = (const double*)(m_vertexBase+index*m_vertexStride);
+				triangle[j].setValue((btScalar)vertex[0]*meshScaling.getX(),(btScalar)vertex[1]*meshScaling.getY(),(btScalar)vertex[2]*meshScaling.getZ());
+			}
+			else
+			{
+				const float* vertex = (const float*)(m_vertexBase+index*m_vertexStride);
+				triangle[j].setValue(vertex[0]*meshScaling.getX(),vertex[1]*meshScaling.getY(),vertex[2]*meshScaling.getZ());
+			}
+		}
+		btWideBvhTriangleAabb(triangle,aabbMin,aabbMax);
+	}
+};
+
+struct	btWideBvhBuildData
+{
+	btAlignedObjectArray<btVector3>	m_aabbMin;
+	btAlignedObjectArray<btVector3>	m_aabbMax;
+	btAlignedObjectArray<int>		m_order;
+	int								m_maxDepth;
+};
+
+static SIMD_FORCE_INLINE btScalar	btWideBvhHalfArea(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	const btVector3 extent = aabbMax-aabbMin;
+	return extent.x()*extent.y()+extent.y()*extent.z()+extent.z()*extent.x();
+}
+
+static void	btWideBvhBounds(const btWideBvhBuildData& data,int begin,int end,btVector3& aabbMin,btVector3& aabbMax)
+{
+	aabbMin = data.m_aabbMin[data.m_order[begin]];
+	aabbMax = data.m_aabbMax[data.m_order[begin]];
+	for (int i=begin+1;i<end;i++)
+	{
+		aabbMin.setMin(data.m_aabbMin[data.m_order[i]]);
+		aabbMax.setMax(data.m_aabbMax[data.m_order[i]]);
+	}
+}
+
+static SIMD_FORCE_INLINE int	btWideBvhBin(btScalar centroid,btScalar centroidMin,btScalar binScale)
+{
+	const int bin = int((centroid-centroidMin)*binScale);
+	return btMin(BT_WIDE_BVH_BINS-1,btMax(0,bin));
+}
+
+///partitions data.m_order[begin..end) at the cheapest bin boundary by the surface area heuristic and returns the split index
+static int	btWideBvhSplit(btWideBvhBuildData& data,int begin,int end)
+{
+	btAlignedObjectArray<int>& order = data.m_order;
+	btVector3 centroidMin = (data.m_aabbMin[order[begin]]+data.m_aabbMax[order[begin]])*btScalar(0.5);
+	btVector3 centroidMax = centroidMin;
+	for (int i=begin+1;i<end;i++)
+	{
+		const btVector3 centroid = (data.m_aabbMin[order[i]]+data.m_aabbMax[order[i]])*btScalar(0.5);
+		centroidMin.setMin(centroid);
+		centroidMax.setMax(centroid);
+	}
+	const int axis = (centroidMax-centroidMin).maxAxis();
+	const btScalar extent = centroidMax[axis]-centroidMin[axis];
+	if (extent<=btScalar(0))
+	{
+		return (begin+end)/2;
+	}
+	const btScalar binScale = btScalar(BT_WIDE_BVH_BINS)/extent;
+
+	int binCount[BT_WIDE_BVH_BINS];
+	btVector3 binMin[BT_WIDE_BVH_BINS];
+	btVector3 binMax[BT_WIDE_BVH_BINS];
+	for (int b=0;b<BT_WIDE_BVH_BINS;b++)
+	{
+		binCount[b] = 0;
+		binMin[b].setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		binMax[b].setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	}
+	for (int i=begin;i<end;i++)
+	{
+		const btVector3& aabbMin = data.m_aabbMin[order[i]];
+		const btVector3& aabbMax = data.m_aabbMax[order[i]];
+		const int b = btWideBvhBin((aabbMin[axis]+aabbMax[axis])*btScalar(0.5),centroidMin[axis],binScale);
+		binCount[b]++;
+		binMin[b].setMin(aabbMin);
+		binMax[b].setMax(aabbMax);
+	}
+
+	//rightCost[b] is the cost of the bins after b
+	btScalar rightCost[BT_WIDE_BVH_BINS];
+	btVector3 accumMin = binMin[BT_WIDE_BVH_BINS-1];
+	btVector3 accumMax = binMax[BT_WIDE_BVH_BINS-1];
+	int accumCount = 0;
+	for (int b=BT_WIDE_BVH_BINS-1;b>0;b--)
+	{
+		accumMin.setMin(binMin[b]);
+		accumMax.setMax(binMax[b]);
+		accumCount += binCount[b];
+		rightCost[b-1] = accumCount ? btWideBvhHalfArea(accumMin,accumMax)*btScalar(accumCount) : btScalar(0);
+	}
+
+	int bestBin = -1;
+	btScalar bestCost = btScalar(BT_LARGE_FLOAT);
+	accumMin = binMin[0];
+	accumMax = binMax[0];
+	accumCount = 0;
+	for (int b=0;b<BT_WIDE_BVH_BINS-1;b++)
+	{
+		accumMin.setMin(binMin[b]);
+		accumMax.setMax(binMax[b]);
+		accumCount += binCount[b];
+		if (accumCount==0 || accumCount==end-begin)
+			continue;
+		const btScalar cost = btWideBvhHalfArea(accumMin,accumMax)*btScalar(accumCount)+rightCost[b];
+		if (cost<bestCost)
+		{
+			bestCost = cost;
+			bestBin = b;
+		}
+	}
+	if (bestBin<0)
+	{
+		return (begin+end)/2;
+	}
+
+	int mid = begin;
+	int last = end;
+	while (mid<last)
+	{
+		const int index = order[mid];
+		if (btWideBvhBin((data.m_aabbMin[index][axis]+data.m_aabbMax[index][axis])*btScalar(0.5),centroidMin[axis],binScale)<=bestBin)
+		{
+			mid++;
+		}
+		else
+		{
+			order.swap(mid,--last);
+		}
+	}
+	return mid;
+}
+
+btWideBvh::btWideBvh()
+:m_maxStackSize(0)
+{
+}
+
+///splits the triangles into up to BT_WIDE_BVH_WIDTH groups, always splitting the group with the largest surface next
+int	btWideBvh::buildNode(btWideBvhBuildData& data,int begin,int end,int depth)
+{
+	const int nodeIndex = m_nodes.size();
+	m_nodes.expandNonInitializing();
+	data.m_maxDepth = btMax(data.m_maxDepth,depth);
+
+	int groupBegin[BT_WIDE_BVH_WIDTH];
+	int groupEnd[BT_WIDE_BVH_WIDTH];
+	btVector3 groupMin[BT_WIDE_BVH_WIDTH];
+	btVector3 groupMax[BT_WIDE_BVH_WIDTH];
+	int numGroups = 1;
+	groupBegin[0] = begin;
+	groupEnd[0] = end;
+	btWideBvhBounds(data,begin,end,groupMin[0],groupMax[0]);
+
+	while (numGroups<BT_WIDE_BVH_WIDTH)
+	{
+		//a group that fits into the free slots as single triangles is split first, it would otherwise become an underfull node
+		int largest = -1;
+		btScalar largestArea = btScalar(-1);
+		bool largestFits = false;
+		for (int g=0;g<numGroups;g++)
+		{
+			const int size = groupEnd[g]-groupBegin[g];
+			if (size>1)
+			{
+				const bool fits = size-1<=BT_WIDE_BVH_WIDTH-numGroups;
+				const btScalar area = btWideBvhHalfArea(groupMin[g],groupMax[g]);
+				if ((fits && !largestFits) || (fits==largestFits && area>largestArea))
+				{
+					largestArea = area;
+					largest = g;
+					largestFits = fits;
+				}
+			}
+		}
+		if (largest<0)
+			break;
+
+		const int mid = btWideBvhSplit(data,groupBegin[largest],groupEnd[largest]);
+		//keep the groups in split order, so neighbouring children are neighbours in space
+		for (int g=numGroups;g>largest+1;g--)
+		{
+			groupBegin[g] = groupBegin[g-1];
+			groupEnd[g] = groupEnd[g-1];
+			groupMin[g] = groupMin[g-1];
+			groupMax[g] = groupMax[g-1];
+		}
+		groupBegin[largest+1] = mid;
+		groupEnd[largest+1] = groupEnd[largest];
+		groupEnd[largest] = mid;
+		btWideBvhBounds(data,groupBegin[largest],groupEnd[largest],groupMin[largest],groupMax[largest]);
+		btWideBvhBounds(data,groupBegin[largest+1],groupEnd[largest+1],groupMin[largest+1],groupMax[largest+1]);
+		numGroups++;
+	}
+
+	int children[BT_WIDE_BVH_WIDTH];
+	for (int g=0;g<numGroups;g++)
+	{
+		if (groupEnd[g]-groupBegin[g]==1)
+		{
+			children[g] = ~data.m_order[groupBegin[g]];
+		}
+		else
+		{
+			children[g] = buildNode(data,groupBegin[g],groupEnd[g],depth+1);
+		}
+	}
+	m_nodes[nodeIndex].setChildren(children,groupMin,groupMax,numGroups);
+	return nodeIndex;
+}
+
+void	btWideBvh::build(btStridingMeshInterface* triangles)
+{
+	m_nodes.clear();
+	m_primitives.clear();
+	m_maxStackSize = 0;
+
+	btWideBvhBuildData data;
+	btWideBvhTriangleCallback callback(data.m_aabbMin,data.m_aabbMax,&m_primitives);
+	const btVector3 aabbMin(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	const btVector3 aabbMax(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	triangles->InternalProcessAllTriangles(&callback,aabbMin,aabbMax);
+
+	const int numPrimitives = m_primitives.size();
+	if (!numPrimitives)
+		return;
+
+	data.m_order.resize(numPrimitives);
+	for (int i=0;i<numPrimitives;i++)
+	{
+		data.m_order[i] = i;
+	}
+	data.m_maxDepth = 0;
+	m_nodes.reserve(numPrimitives/(BT_WIDE_BVH_WIDTH-1)+1);
+	buildNode(data,0,numPrimitives,0);
+	//a node pops one entry and pushes at most BT_WIDE_BVH_WIDTH
+	m_maxStackSize = (data.m_maxDepth+1)*(BT_WIDE_BVH_WIDTH-1)+1;
+}
+
+void	btWideBvh::refit(btStridingMeshInterface* triangles)
+{
+	btAlignedObjectArray<btVector3> primitiveMin;
+	btAlignedObjectArray<btVector3> primitiveMax;
+	btWideBvhTriangleCallback callback(primitiveMin,primitiveMax,0);
+	const btVector3 aabbMin(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	const btVector3 aabbMax(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	triangles->InternalProcessAllTriangles(&callback,aabbMin,aabbMax);
+	btAssert(primitiveMin.size()==m_primitives.size());
+
+	//children come after their parent, so walking backwards refits every child before its parent
+	btAlignedObjectArray<btVector3> nodeMin;
+	btAlignedObjectArray<btVector3> nodeMax;
+	nodeMin.resize(m_nodes.size());
+	nodeMax.resize(m_nodes.size());
+	for (int n=m_nodes.size()-1;n>=0;n--)
+	{
+		btWideBvhNode& node = m_nodes[n];
+		int children[BT_WIDE_BVH_WIDTH];
+		btVector3 childMin[BT_WIDE_BVH_WIDTH];
+		btVector3 childMax[BT_WIDE_BVH_WIDTH];
+		for (int i=0;i<node.m_numChildren;i++)
+		{
+			children[i] = node.m_child[i];
+			childMin[i] = node.isLeafChild(i) ? primitiveMin[~children[i]] : nodeMin[children[i]];
+			childMax[i] = node.isLeafChild(i) ? primitiveMax[~children[i]] : nodeMax[children[i]];
+			if (i==0)
+			{
+				nodeMin[n] = childMin[0];
+				nodeMax[n] = childMax[0];
+			}
+			nodeMin[n].setMin(childMin[i]);
+			nodeMax[n].setMax(childMax[i]);
+		}
+		node.setChildren(children,childMin,childMax,node.m_numChildren);
+	}
+}
+
+///refits the children whose box overlaps the refit box and returns the box of the node
+void	btWideBvh::partialRefitNode(btWideBvhRefitData& data,int nodeIndex,btVector3& aabbMin,btVector3& aabbMax)
+{
+	btWideBvhNode& node = m_nodes[nodeIndex];
+	int children[BT_WIDE_BVH_WIDTH];
+	btVector3 childMin[BT_WIDE_BVH_WIDTH];
+	btVector3 childMax[BT_WIDE_BVH_WIDTH];
+	bool changed = false;
+	for (int i=0;i<node.m_numChildren;i++)
+	{
+		children[i] = node.m_child[i];
+		node.getChildAabb(i,childMin[i],childMax[i]);
+		if (TestAabbAgainstAabb2(childMin[i],childMax[i],data.m_aabbMin,data.m_aabbMax))
+		{
+			if (node.isLeafChild(i))
+			{
+				data.getTriangleAabb(m_primitives[~children[i]],childMin[i],childMax[i]);
+			}
+			else
+			{
+				partialRefitNode(data,children[i],childMin[i],childMax[i]);
+			}
+			changed = true;
+		}
+		if (i==0)
+		{
+			aabbMin = childMin[0];
+			aabbMax = childMax[0];
+		}
+		aabbMin.setMin(childMin[i]);
+		aabbMax.setMax(childMax[i]);
+	}
+	if (changed)
+	{
+		node.setChildren(children,childMin,childMax,node.m_numChildren);
+	}
+}
+
+void	btWideBvh::partialRefit(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	if (!m_nodes.size())
+		return;
+	btWideBvhRefitData data(triangles,aabbMin,aabbMax);
+	btVector3 rootMin,rootMax;
+	partialRefitNode(data,0,rootMin,rootMax);
+}
+
+#ifdef BT_USE_SSE_RAY_PACKET
+///the coordinates of children 0..3 and 4..7 on one axis, the same float operations as btWideBvhNode::getChildAabb
+static SIMD_FORCE_INLINE void	btWideBvhUnQuantize(const unsigned char* quantized,__m128 origin,__m128 scale,__m128 out[2])
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i words = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)quantized),zero);
+	out[0] = _mm_add_ps(origin,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(words,zero)),scale));
+	out[1] = _mm_add_ps(origin,_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(words,zero)),scale));
+}
+#endif
+
+///returns the children of a node that overlap an aabb, like TestAabbAgainstAabb2
+struct	btWideBvhAabbTester
+{
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+
+	int	testNode(const btWideBvhNode& node) const
+	{
+#ifdef BT_USE_SSE_RAY_PACKET
+		__m128 miss[2] = {_mm_setzero_ps(),_mm_setzero_ps()};
+		for (int j=0;j<3;j++)
+		{
+			const __m128 origin = _mm_set1_ps(node.m_origin[j]);
+			const __m128 scale = _mm_set1_ps(node.m_scale[j]);
+			const __m128 queryMin = _mm_set1_ps(m_aabbMin[j]);
+			const __m128 queryMax = _mm_set1_ps(m_aabbMax[j]);
+			__m128 childMin[2];
+			__m128 childMax[2];
+			btWideBvhUnQuantize(node.m_childMin[j],origin,scale,childMin);
+			btWideBvhUnQuantize(node.m_childMax[j],origin,scale,childMax);
+			for (int h=0;h<2;h++)
+			{
+				miss[h] = _mm_or_ps(miss[h],_mm_or_ps(_mm_cmpgt_ps(childMin[h],queryMax),_mm_cmplt_ps(childMax[h],queryMin)));
+			}
+		}
+		return ~(_mm_movemask_ps(miss[0])|(_mm_movemask_ps(miss[1])<<4)) & ((1<<node.m_numChildren)-1);
+#else
+		int mask = 0;
+		for (int i=0;i<node.m_numChildren;i++)
+		{
+			btVector3 childMin,childMax;
+			node.getChildAabb(i,childMin,childMax);
+			if (TestAabbAgainstAabb2(childMin,childMax,m_aabbMin,m_aabbMax))
+				mask |= 1<<i;
+		}
+		return mask;
+#endif
+	}
+};
+
+///returns the children of a node that a ray or box cast hits, like btRayAabb2 on the child box grown by the cast box
+struct	btWideBvhRayTester
+{
+	btVector3		m_rayFrom;
+	btVector3		m_rayInvDirection;
+	unsigned int	m_raySign[3];
+	btScalar		m_lambdaMax;
+	btVector3		m_aabbMin;
+	btVector3		m_aabbMax;
+
+	int	testNode(const btWideBvhNode& node) const
+	{
+#ifdef BT_USE_SSE_RAY_PACKET
+		__m128 tmin[2];
+		__m128 tmax[2];
+		__m128 miss[2];
+		for (int j=0;j<3;j++)
+		{
+			const __m128 origin = _mm_set1_ps(node.m_origin[j]);
+			const __m128 scale = _mm_set1_ps(node.m_scale[j]);
+			const __m128 castMin = _mm_set1_ps(m_aabbMin[j]);
+			const __m128 castMax = _mm_set1_ps(m_aabbMax[j]);
+			const __m128 from = _mm_set1_ps(m_rayFrom[j]);
+			const __m128 inv = _mm_set1_ps(m_rayInvDirection[j]);
+			__m128 childMin[2];
+			__m128 childMax[2];
+			btWideBvhUnQuantize(node.m_childMin[j],origin,scale,childMin);
+			btWideBvhUnQuantize(node.m_childMax[j],origin,scale,childMax);
+			for (int h=0;h<2;h++)
+			{
+				const __m128 lo = _mm_sub_ps(childMin[h],castMax);
+				const __m128 hi = _mm_sub_ps(childMax[h],castMin);
+				const __m128 tnear = _mm_mul_ps(_mm_sub_ps(m_raySign[j] ? hi : lo,from),inv);
+				const __m128 tfar = _mm_mul_ps(_mm_sub_ps(m_raySign[j] ? lo : hi,from),inv);
+				if (j==0)
+				{
+					tmin[h] = tnear;
+					tmax[h] = tfar;
+					miss[h] = _mm_setzero_ps();
+				}
+				else
+				{
+					miss[h] = _mm_or_ps(miss[h],_mm_or_ps(_mm_cmpgt_ps(tmin[h],tfar),_mm_cmpgt_ps(tnear,tmax[h])));
+					tmin[h] = _mm_max_ps(tnear,tmin[h]);
+					tmax[h] = _mm_min_ps(tfar,tmax[h]);
+				}
+			}
+		}
+		const __m128 lambdaMax = _mm_set1_ps(m_lambdaMax);
+		const __m128 zero = _mm_setzero_ps();
+		int mask = 0;
+		for (int h=0;h<2;h++)
+		{
+			const __m128 hit = _mm_and_ps(_mm_cmplt_ps(tmin[h],lambdaMax),_mm_cmpgt_ps(tmax[h],zero));
+			mask |= _mm_movemask_ps(_mm_andnot_ps(miss[h],hit))<<(4*h);
+		}
+		return mask & ((1<<node.m_numChildren)-1);
+#else
+		int mask = 0;
+		for (int i=0;i<node.m_numChildren;i++)
+		{
+			btVector3 bounds[2];
+			node.getChildAabb(i,bounds[0],bounds[1]);
+			bounds[0] -= m_aabbMax;
+			bounds[1] -= m_aabbMin;
+			btScalar param;
+			if (btRayAabb2(m_rayFrom,m_rayInvDirection,m_raySign,bounds,param,btScalar(0),m_lambdaMax))
+				mask |= 1<<i;
+		}
+		return mask;
+#endif
+	}
+};
+
+template <typename NodeTester>
+static void	btWideBvhWalk(const btWideBvhNode* nodes,const btWideBvhPrimitive* primitives,int maxStackSize,btNodeOverlapCallback* nodeCallback,const NodeTester& tester)
+{
+	int localStack[BT_WIDE_BVH_STACK_SIZE];
+	btAlignedObjectArray<int> heapStack;
+	int* stack = localStack;
+	if (maxStackSize>BT_WIDE_BVH_STACK_SIZE)
+	{
+		heapStack.resize(maxStackSize);
+		stack = &heapStack[0];
+	}
+	int depth = 0;
+	stack[depth++] = 0;
+	while (depth>0)
+	{
+		const btWideBvhNode& node = nodes[stack[--depth]];
+		const int mask = tester.testNode(node);
+		if (!mask)
+			continue;
+		//report the leaves in child order, then push the child nodes so the first one is walked next
+		for (int i=0;i<node.m_numChildren;i++)
+		{
+			if (((mask>>i)&1) && node.isLeafChild(i))
+			{
+				const btWideBvhPrimitive& primitive = primitives[~node.m_child[i]];
+				nodeCallback->processNode(primitive.m_partId,primitive.m_triangleIndex);
+			}
+		}
+		for (int i=node.m_numChildren-1;i>=0;i--)
+		{
+			if (((mask>>i)&1) && !node.isLeafChild(i))
+			{
+				btAssert(depth<maxStackSize);
+				stack[depth++] = node.m_child[i];
+			}
+		}
+	}
+}
+
+void	btWideBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
+{
+	if (!m_nodes.size())
+		return;
+	btWideBvhAabbTester tester;
+	tester.m_aabbMin = aabbMin;
+	tester.m_aabbMax = aabbMax;
+	btWideBvhWalk(&m_nodes[0],&m_primitives[0],m_maxStackSize,nodeCallback,tester);
+}
+
+void	btWideBvh::reportRayOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& raySource,const btVector3& rayTarget) const
+{
+	reportBoxCastOverlappingNodex(nodeCallback,raySource,rayTarget,btVector3(0,0,0),btVector3(0,0,0));
+}
+
+void	btWideBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& raySource,const btVector3& rayTarget,const btVector3& aabbMin,const btVector3& aabbMax) const
+{
+	if (!m_nodes.size())
+		return;
+	//the same ray setup as btQuantizedBvh::walkStacklessQuantizedTreeAgainstRay
+	btVector3 rayDirection = (rayTarget-raySource);
+	rayDirection.normalize ();
+	btWideBvhRayTester tester;
+	tester.m_lambdaMax = rayDirection.dot(rayTarget-raySource);
+	rayDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0];
+	rayDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1];
+	rayDirection[2] = rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2];
+	tester.m_rayFrom = raySource;
+	tester.m_rayInvDirection = rayDirection;
+	tester.m_raySign[0] = rayDirection[0] < 0.0;
+	tester.m_raySign[1] = rayDirection[1] < 0.0;
+	tester.m_raySign[2] = rayDirection[2] < 0.0;
+	tester.m_aabbMin = aabbMin;
+	tester.m_aabbMax = aabbMax;
+	btWideBvhWalk(&m_nodes[0],&m_primitives[0],m_maxStackSize,nodeCallback,tester);
+}
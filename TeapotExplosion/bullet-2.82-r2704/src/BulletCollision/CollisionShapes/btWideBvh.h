@@ -0,0 +1,118 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_WIDE_BVH_H
+#define BT_WIDE_BVH_H
+
+#include "BulletCollision/BroadphaseCollision/btQuantizedBvh.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+class btStridingMeshInterface;
+
+///number of children of a btWideBvhNode, the SSE traversal tests them as two groups of four
+#define BT_WIDE_BVH_WIDTH 8
+///traversal stack entries on the stack of a query, deeper trees use a heap allocated stack
+#define BT_WIDE_BVH_STACK_SIZE 256
+
+///btWideBvhNode has the boxes of up to BT_WIDE_BVH_WIDTH children. Child box coordinates are stored as 8 bit steps of
+///m_scale from m_origin, rounded outwards, and laid out per axis so one load gets that axis for all children.
+ATTRIBUTE_ALIGNED16(struct) btWideBvhNode
+{
+	btScalar		m_origin[4];	// x,y,z: minimum of the node box
+	btScalar		m_scale[4];		// x,y,z: size of one quantization step
+	unsigned char	m_childMin[3][BT_WIDE_BVH_WIDTH];
+	unsigned char	m_childMax[3][BT_WIDE_BVH_WIDTH];
+	int				m_child[BT_WIDE_BVH_WIDTH];	// >=0: index of a child node, <0: ~index of a btWideBvhPrimitive
+	int				m_numChildren;
+	int				m_pad[3];
+
+	bool	isLeafChild(int i) const
+	{
+		return m_child[i]<0;
+	}
+
+	void	getChildAabb(int i,btVector3& aabbMin,btVector3& aabbMax) const
+	{
+		aabbMin.setValue(m_origin[0]+btScalar(m_childMin[0][i])*m_scale[0],m_origin[1]+btScalar(m_childMin[1][i])*m_scale[1],m_origin[2]+btScalar(m_childMin[2][i])*m_scale[2]);
+		aabbMax.setValue(m_origin[0]+btScalar(m_childMax[0][i])*m_scale[0],m_origin[1]+btScalar(m_childMax[1][i])*m_scale[1],m_origin[2]+btScalar(m_childMax[2][i])*m_scale[2]);
+	}
+
+	///sets the children and quantizes their boxes relative to the union of the boxes
+	void	setChildren(const int* children,const btVector3* childAabbMin,const btVector3* childAabbMax,int numChildren);
+};
+
+///a triangle of the mesh, leaf children of btWideBvhNode point into btWideBvh::m_primitives
+struct btWideBvhPrimitive
+{
+	int	m_partId;
+	int	m_triangleIndex;
+};
+
+///btWideBvh is an alternative to btOptimizedBvh for btBvhTriangleMeshShape, see btBvhTriangleMeshShape::setUseWideBvh.
+///It is built top down with a binned surface area heuristic and has up to BT_WIDE_BVH_WIDTH children per node, so a query
+///visits far fewer nodes than in the binary btQuantizedBvh, and tests all children of a node at once with SSE.
+///Queries report triangles through btNodeOverlapCallback, like btQuantizedBvh, but in a different order.
+ATTRIBUTE_ALIGNED16(class) btWideBvh
+{
+	btAlignedObjectArray<btWideBvhNode>			m_nodes;		// m_nodes[0] is the root, children come after their parent
+	btAlignedObjectArray<btWideBvhPrimitive>	m_primitives;	// in the order btStridingMeshInterface::InternalProcessAllTriangles reports them
+	int											m_maxStackSize;	// traversal stack entries a query can need
+
+	int	buildNode(struct btWideBvhBuildData& data,int begin,int end,int depth);
+	void	partialRefitNode(struct btWideBvhRefitData& data,int nodeIndex,btVector3& aabbMin,btVector3& aabbMax);
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btWideBvh();
+
+	void	build(btStridingMeshInterface* triangles);
+
+	///updates the boxes after the vertices of triangles moved, the tree topology is kept
+	void	refit(btStridingMeshInterface* triangles);
+
+	///like btOptimizedBvh::refitPartial, only the subtrees whose current box overlaps aabbMin/aabbMax are refit,
+	///so the box has to contain the old positions of all triangles that moved
+	void	partialRefit(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax);
+
+	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
+
+	void	reportRayOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& raySource,const btVector3& rayTarget) const;
+
+	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& raySource,const btVector3& rayTarget,const btVector3& aabbMin,const btVector3& aabbMax) const;
+
+	int	getNumNodes() const
+	{
+		return m_nodes.size();
+	}
+
+	const btWideBvhNode&	getNode(int i) const
+	{
+		return m_nodes[i];
+	}
+
+	int	getNumPrimitives() const
+	{
+		return m_primitives.size();
+	}
+
+	const btWideBvhPrimitive&	getPrimitive(int i) const
+	{
+		return m_primitives[i];
+	}
+};
+
+#endif //BT_WIDE_BVH_H
@@ -0,0 +1,738 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btGjkBatch.h"
+
+#include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullSupportMap.h"
+
+//the tolerances of btGjkPairDetector and btVoronoiSimplexSolver
+#define BT_GJK_BATCH_REL_ERROR2 btScalar(1.0e-6)
+#define BT_GJK_BATCH_EQUAL_VERTEX_THRESHOLD btScalar(0.0001)
+#define BT_GJK_BATCH_DEGENERATE_TETRAHEDRON btScalar(1e-4)
+#define BT_GJK_BATCH_MAX_ITERATIONS 1000
+//btGjkPairDetector runs the penetration depth solver below this distance of the shapes without margin
+#define BT_GJK_BATCH_PENETRATION_DISTANCE btScalar(0.01)
+
+enum btGjkBatchLaneStatus
+{
+	BT_GJK_BATCH_LANE_ITERATE,
+	BT_GJK_BATCH_LANE_CLOSEST,
+	BT_GJK_BATCH_LANE_FALLBACK
+};
+
+static SIMD_FORCE_INLINE btVector3	btGjkBatchGetLane(const btScalar v[3][BT_GJK_BATCH_WIDTH],int lane)
+{
+	return btVector3(v[0][lane],v[1][lane],v[2][lane]);
+}
+
+static SIMD_FORCE_INLINE void	btGjkBatchSetLane(btScalar v[3][BT_GJK_BATCH_WIDTH],int lane,const btVector3& value)
+{
+	v[0][lane] = value.getX();
+	v[1][lane] = value.getY();
+	v[2][lane] = value.getZ();
+}
+
+///support function of btBoxShape, like btBoxShape::localGetSupportingVertexWithoutMargin for all lanes at once
+ATTRIBUTE_ALIGNED16(struct) btGjkBatchBoxSupport
+{
+	btScalar	m_halfExtents[3][BT_GJK_BATCH_WIDTH];
+
+	void	setLane(int lane,const btConvexShape* shape)
+	{
+		btGjkBatchSetLane(m_halfExtents,lane,static_cast<const btBoxShape*>(shape)->getHalfExtentsWithoutMargin());
+	}
+
+	void	getSupportingVertices(const btScalar dir[3][BT_GJK_BATCH_WIDTH],btScalar supportOut[3][BT_GJK_BATCH_WIDTH],int laneMask) const
+	{
+		(void)laneMask;
+		for (int j=0;j<3;j++)
+		{
+#ifdef BT_USE_SSE_GJK_BATCH
+			const __m128 halfExtents = _mm_load_ps(m_halfExtents[j]);
+			const __m128 positive = _mm_cmpge_ps(_mm_load_ps(dir[j]),_mm_setzero_ps());
+			const __m128 negated = _mm_sub_ps(_mm_setzero_ps(),halfExtents);
+			_mm_store_ps(supportOut[j],_mm_or_ps(_mm_and_ps(positive,halfExtents),_mm_andnot_ps(positive,negated)));
+#else
+			for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+			{
+				supportOut[j][l] = btFsels(dir[j][l],m_halfExtents[j][l],-m_halfExtents[j][l]);
+			}
+#endif
+		}
+	}
+};
+
+///support function of btSphereShape, the sphere is all margin
+ATTRIBUTE_ALIGNED16(struct) btGjkBatchSphereSupport
+{
+	void	setLane(int lane,const btConvexShape* shape)
+	{
+		(void)lane;
+		(void)shape;
+	}
+
+	void	getSupportingVertices(const btScalar dir[3][BT_GJK_BATCH_WIDTH],btScalar supportOut[3][BT_GJK_BATCH_WIDTH],int laneMask) const
+	{
+		(void)dir;
+		(void)laneMask;
+		for (int j=0;j<3;j++)
+		{
+			for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+			{
+				supportOut[j][l] = btScalar(0.);
+			}
+		}
+	}
+};
+
+///support function of btConvexHullShape. Lanes with different hulls search their own points, when all lanes have the
+///same hull, as with many pieces of the same debris, one pass over the points finds the supporting vertex of all lanes
+ATTRIBUTE_ALIGNED16(struct) btGjkBatchConvexHullSupport
+{
+	btVector3			m_localScaling[BT_GJK_BATCH_WIDTH];
+	const btVector3*	m_points[BT_GJK_BATCH_WIDTH];
+	int					m_numPoints[BT_GJK_BATCH_WIDTH];
+	const btConvexHullSupportMap*	m_supportMaps[BT_GJK_BATCH_WIDTH];
+	mutable int			m_warmStartVertices[BT_GJK_BATCH_WIDTH];	// the supporting vertex of the last iteration of the lane
+	bool				m_sameHull;
+
+	///lanes are set in order, starting with lane 0
+	void	setLane(int lane,const btConvexShape* shape)
+	{
+		const btConvexHullShape* hull = static_cast<const btConvexHullShape*>(shape);
+		m_localScaling[lane] = hull->getLocalScaling();
+		m_points[lane] = hull->getUnscaledPoints();
+		m_numPoints[lane] = hull->getNumPoints();
+		m_supportMaps[lane] = hull->getSupportMap();
+		m_warmStartVertices[lane] = -1;
+		if (lane==0)
+		{
+			m_sameHull = !m_supportMaps[0];
+		} else
+		{
+			m_sameHull = m_sameHull && (m_points[lane]==m_points[0]) && (m_numPoints[lane]==m_numPoints[0]) && (m_localScaling[lane]==m_localScaling[0]);
+		}
+	}
+
+	void	getSupportingVertices(const btScalar dir[3][BT_GJK_BATCH_WIDTH],btScalar supportOut[3][BT_GJK_BATCH_WIDTH],int laneMask) const
+	{
+#ifdef BT_USE_SSE_GJK_BATCH
+		if (m_sameHull && m_numPoints[0]>0)
+		{
+			//the dot products and comparisons of btVector3::maxDot, for four directions at once
+			const btVector3* points = m_points[0];
+			const btVector3& localScaling = m_localScaling[0];
+			const __m128 scaledX = _mm_mul_ps(_mm_load_ps(dir[0]),_mm_set1_ps(localScaling.getX()));
+			const __m128 scaledY = _mm_mul_ps(_mm_load_ps(dir[1]),_mm_set1_ps(localScaling.getY()));
+			const __m128 scaledZ = _mm_mul_ps(_mm_load_ps(dir[2]),_mm_set1_ps(localScaling.getZ()));
+			__m128 maxDot = _mm_set1_ps(-SIMD_INFINITY);
+			__m128i maxIndex = _mm_setzero_si128();
+			for (int i=0;i<m_numPoints[0];i++)
+			{
+				const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(points[i].getX()),scaledX),
+					_mm_mul_ps(_mm_set1_ps(points[i].getY()),scaledY)),_mm_mul_ps(_mm_set1_ps(points[i].getZ()),scaledZ));
+				const __m128 greater = _mm_cmpgt_ps(dot,maxDot);
+				const __m128i greaterMask = _mm_castps_si128(greater);
+				maxDot = _mm_or_ps(_mm_and_ps(greater,dot),_mm_andnot_ps(greater,maxDot));
+				maxIndex = _mm_or_si128(_mm_and_si128(greaterMask,_mm_set1_epi32(i)),_mm_andnot_si128(greaterMask,maxIndex));
+			}
+			ATTRIBUTE_ALIGNED16(int index[BT_GJK_BATCH_WIDTH]);
+			_mm_store_si128((__m128i*)index,maxIndex);
+			for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+			{
+				btGjkBatchSetLane(supportOut,l,points[index[l]] * localScaling);
+			}
+			return;
+		}
+#endif
+		for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+		{
+			if (!(laneMask & (1<<l)))
+				continue;
+			btVector3 supVec(btScalar(0.),btScalar(0.),btScalar(0.));
+			if (m_numPoints[l]>0)
+			{
+				btScalar maxDot;
+				const btVector3 scaled = btGjkBatchGetLane(dir,l) * m_localScaling[l];
+				const long index = m_supportMaps[l] ? m_supportMaps[l]->getSupportingPointIndex(scaled,maxDot,m_warmStartVertices[l]) :
+					scaled.maxDot(m_points[l],m_numPoints[l],maxDot);
+				supVec = m_points[l][index] * m_localScaling[l];
+			}
+			btGjkBatchSetLane(supportOut,l,supVec);
+		}
+	}
+};
+
+///the simplex of one lane, the same closest point computation and vertex reduction as btVoronoiSimplexSolver
+struct btGjkBatchSimplex
+{
+	btVector3	m_simplexVectorW[4];
+	btVector3	m_simplexPointsP[4];
+	btVector3	m_simplexPointsQ[4];
+	btVector3	m_lastW;
+	btVector3	m_closestPointP;
+	btVector3	m_closestPointQ;
+	int			m_numVertices;
+
+	void	reset()
+	{
+		m_numVertices = 0;
+		m_lastW.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	}
+
+	bool	inSimplex(const btVector3& w) const
+	{
+		if (w == m_lastW)
+			return true;
+		for (int i=0;i<m_numVertices;i++)
+		{
+			if (m_simplexVectorW[i].distance2(w) <= BT_GJK_BATCH_EQUAL_VERTEX_THRESHOLD)
+				return true;
+		}
+		return false;
+	}
+
+	void	addVertex(const btVector3& w,const btVector3& p,const btVector3& q)
+	{
+		m_lastW = w;
+		m_simplexVectorW[m_numVertices] = w;
+		m_simplexPointsP[m_numVertices] = p;
+		m_simplexPointsQ[m_numVertices] = q;
+		m_numVertices++;
+	}
+
+	void	removeVertex(int index)
+	{
+		m_numVertices--;
+		m_simplexVectorW[index] = m_simplexVectorW[m_numVertices];
+		m_simplexPointsP[index] = m_simplexPointsP[m_numVertices];
+		m_simplexPointsQ[index] = m_simplexPointsQ[m_numVertices];
+	}
+
+	///keeps the vertices with a nonzero bit in usedVertices, bit i for vertex i
+	void	reduceVertices(int usedVertices)
+	{
+		for (int i=3;i>=0;i--)
+		{
+			if ((m_numVertices > i) && !(usedVertices & (1<<i)))
+				removeVertex(i);
+		}
+	}
+
+	///btVoronoiSimplexSolver::closestPtPointTriangle for the origin
+	static int	closestPointTriangle(const btVector3& a,const btVector3& b,const btVector3& c,btScalar bary[3],btVector3& closestPoint)
+	{
+		const btVector3 ab = b - a;
+		const btVector3 ac = c - a;
+		const btVector3 ap = -a;
+		const btScalar d1 = ab.dot(ap);
+		const btScalar d2 = ac.dot(ap);
+		if (d1 <= btScalar(0.0) && d2 <= btScalar(0.0))
+		{
+			closestPoint = a;
+			bary[0] = 1; bary[1] = 0; bary[2] = 0;
+			return 1;
+		}
+
+		const btVector3 bp = -b;
+		const btScalar d3 = ab.dot(bp);
+		const btScalar d4 = ac.dot(bp);
+		if (d3 >= btScalar(0.0) && d4 <= d3)
+		{
+			closestPoint = b;
+			bary[0] = 0; bary[1] = 1; bary[2] = 0;
+			return 2;
+		}
+
+		const btScalar vc = d1*d4 - d3*d2;
+		if (vc <= btScalar(0.0) && d1 >= btScalar(0.0) && d3 <= btScalar(0.0))
+		{
+			const btScalar v = d1 / (d1 - d3);
+			closestPoint = a + v * ab;
+			bary[0] = 1-v; bary[1] = v; bary[2] = 0;
+			return 1|2;
+		}
+
+		const btVector3 cp = -c;
+		const btScalar d5 = ab.dot(cp);
+		const btScalar d6 = ac.dot(cp);
+		if (d6 >= btScalar(0.0) && d5 <= d6)
+		{
+			closestPoint = c;
+			bary[0] = 0; bary[1] = 0; bary[2] = 1;
+			return 4;
+		}
+
+		const btScalar vb = d5*d2 - d1*d6;
+		if (vb <= btScalar(0.0) && d2 >= btScalar(0.0) && d6 <= btScalar(0.0))
+		{
+			const btScalar w = d2 / (d2 - d6);
+			closestPoint = a + w * ac;
+			bary[0] = 1-w; bary[1] = 0; bary[2] = w;
+			return 1|4;
+		}
+
+		const btScalar va = d3*d6 - d5*d4;
+		if (va <= btScalar(0.0) && (d4 - d3) >= btScalar(0.0) && (d5 - d6) >= btScalar(0.0))
+		{
+			const btScalar w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			closestPoint = b + w * (c - b);
+			bary[0] = 0; bary[1] = 1-w; bary[2] = w;
+			return 2|4;
+		}
+
+		const btScalar denom = btScalar(1.0) / (va + vb + vc);
+		const btScalar v = vb * denom;
+		const btScalar w = vc * denom;
+		closestPoint = a + ab * v + ac * w;
+		bary[0] = 1-v-w; bary[1] = v; bary[2] = w;
+		return 1|2|4;
+	}
+
+	///btVoronoiSimplexSolver::pointOutsideOfPlane for the origin, -1 for a degenerate tetrahedron
+	static int	originOutsideOfPlane(const btVector3& a,const btVector3& b,const btVector3& c,const btVector3& d)
+	{
+		const btVector3 normal = (b-a).cross(c-a);
+		const btScalar signp = (-a).dot(normal);
+		const btScalar signd = (d - a).dot(normal);
+		if (signd * signd < (BT_GJK_BATCH_DEGENERATE_TETRAHEDRON * BT_GJK_BATCH_DEGENERATE_TETRAHEDRON))
+			return -1;
+		return signp * signd < btScalar(0.);
+	}
+
+	///the closest point of the face (i0,i1,i2) of the tetrahedron, if it is closer than bestSqDist
+	void	closestPointTetrahedronFace(int i0,int i1,int i2,btScalar& bestSqDist,btScalar bary[4],int& usedVertices) const
+	{
+		btScalar faceBary[3];
+		btVector3 q;
+		const int faceUsed = closestPointTriangle(m_simplexVectorW[i0],m_simplexVectorW[i1],m_simplexVectorW[i2],faceBary,q);
+		const btScalar sqDist = q.dot(q);
+		if (sqDist < bestSqDist)
+		{
+			bestSqDist = sqDist;
+			bary[0] = bary[1] = bary[2] = bary[3] = btScalar(0.);
+			bary[i0] = faceBary[0];
+			bary[i1] = faceBary[1];
+			bary[i2] = faceBary[2];
+			usedVertices = ((faceUsed&1) ? (1<<i0) : 0) | ((faceUsed&2) ? (1<<i1) : 0) | ((faceUsed&4) ? (1<<i2) : 0);
+		}
+	}
+
+	///the point of the simplex closest to the origin, false if the origin is inside a tetrahedron, the tetrahedron is degenerate or
+	///the barycentric coordinates are invalid, these are the cases where btGjkPairDetector ends with its penetration depth solver
+	bool	closest(btVector3& v)
+	{
+		btScalar bary[4] = {btScalar(1.),btScalar(0.),btScalar(0.),btScalar(0.)};
+		int usedVertices = 1;
+		switch (m_numVertices)
+		{
+		case 1:
+			{
+				m_closestPointP = m_simplexPointsP[0];
+				m_closestPointQ = m_simplexPointsQ[0];
+				v = m_closestPointP - m_closestPointQ;
+				return true;
+			}
+		case 2:
+			{
+				const btVector3& from = m_simplexVectorW[0];
+				const btVector3 diff = -from;
+				const btVector3 seg = m_simplexVectorW[1] - from;
+				btScalar t = seg.dot(diff);
+				if (t > 0)
+				{
+					const btScalar dotVV = seg.dot(seg);
+					if (t < dotVV)
+					{
+						t /= dotVV;
+						usedVertices = 1|2;
+					} else
+					{
+						t = 1;
+						usedVertices = 2;
+					}
+				} else
+				{
+					t = 0;
+				}
+				bary[0] = 1-t;
+				bary[1] = t;
+				m_closestPointP = m_simplexPointsP[0] + t * (m_simplexPointsP[1] - m_simplexPointsP[0]);
+				m_closestPointQ = m_simplexPointsQ[0] + t * (m_simplexPointsQ[1] - m_simplexPointsQ[0]);
+				break;
+			}
+		case 3:
+			{
+				btVector3 q;
+				usedVertices = closestPointTriangle(m_simplexVectorW[0],m_simplexVectorW[1],m_simplexVectorW[2],bary,q);
+				m_closestPointP = m_simplexPointsP[0] * bary[0] + m_simplexPointsP[1] * bary[1] + m_simplexPointsP[2] * bary[2];
+				m_closestPointQ = m_simplexPointsQ[0] * bary[0] + m_simplexPointsQ[1] * bary[1] + m_simplexPointsQ[2] * bary[2];
+				break;
+			}
+		case 4:
+			{
+				const btVector3& a = m_simplexVectorW[0];
+				const btVector3& b = m_simplexVectorW[1];
+				const btVector3& c = m_simplexVectorW[2];
+				const btVector3& d = m_simplexVectorW[3];
+				const int outsideABC = originOutsideOfPlane(a,b,c,d);
+				const int outsideACD = originOutsideOfPlane(a,c,d,b);
+				const int outsideADB = originOutsideOfPlane(a,d,b,c);
+				const int outsideBDC = originOutsideOfPlane(b,d,c,a);
+				if (outsideABC < 0 || outsideACD < 0 || outsideADB < 0 || outsideBDC < 0)
+					return false;
+				if (!outsideABC && !outsideACD && !outsideADB && !outsideBDC)
+					return false;
+
+				btScalar bestSqDist = BT_LARGE_FLOAT;
+				usedVertices = 1|2|4|8;
+				if (outsideABC)
+					closestPointTetrahedronFace(0,1,2,bestSqDist,bary,usedVertices);
+				if (outsideACD)
+					closestPointTetrahedronFace(0,2,3,bestSqDist,bary,usedVertices);
+				if (outsideADB)
+					closestPointTetrahedronFace(0,3,1,bestSqDist,bary,usedVertices);
+				if (outsideBDC)
+					closestPointTetrahedronFace(1,3,2,bestSqDist,bary,usedVertices);
+				m_closestPointP = m_simplexPointsP[0] * bary[0] + m_simplexPointsP[1] * bary[1] + m_simplexPointsP[2] * bary[2] + m_simplexPointsP[3] * bary[3];
+				m_closestPointQ = m_simplexPointsQ[0] * bary[0] + m_simplexPointsQ[1] * bary[1] + m_simplexPointsQ[2] * bary[2] + m_simplexPointsQ[3] * bary[3];
+				break;
+			}
+		default:
+			return false;
+		}
+
+		v = m_closestPointP - m_closestPointQ;
+		reduceVertices(usedVertices);
+		return (bary[0] >= btScalar(0.)) && (bary[1] >= btScalar(0.)) && (bary[2] >= btScalar(0.)) && (bary[3] >= btScalar(0.));
+	}
+};
+
+///the GJK state of BT_GJK_BATCH_WIDTH pairs, one pair per lane. Both transforms are relative to the midpoint of their
+///origins, like the local transforms of btGjkPairDetector::getClosestPointsNonVirtual
+ATTRIBUTE_ALIGNED16(struct) btGjkBatchLanes
+{
+	btScalar	m_basisA[3][3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_originA[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_basisB[3][3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_originB[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_separatingAxis[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_squaredDistance[BT_GJK_BATCH_WIDTH];
+	btScalar	m_maximumDistanceSquared[BT_GJK_BATCH_WIDTH];
+	btScalar	m_directionA[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_directionB[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_supportA[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_supportB[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_pointA[3][BT_GJK_BATCH_WIDTH];
+	btScalar	m_pointB[3][BT_GJK_BATCH_WIDTH];
+
+	void	setLane(int lane,const btGjkBatchInput& input,btVector3& positionOffset)
+	{
+		positionOffset = (input.m_transformA.getOrigin() + input.m_transformB.getOrigin()) * btScalar(0.5);
+		for (int i=0;i<3;i++)
+		{
+			for (int j=0;j<3;j++)
+			{
+				m_basisA[i][j][lane] = input.m_transformA.getBasis()[i][j];
+				m_basisB[i][j][lane] = input.m_transformB.getBasis()[i][j];
+			}
+		}
+		btGjkBatchSetLane(m_originA,lane,input.m_transformA.getOrigin() - positionOffset);
+		btGjkBatchSetLane(m_originB,lane,input.m_transformB.getOrigin() - positionOffset);
+		btGjkBatchSetLane(m_separatingAxis,lane,btVector3(0,1,0));
+		btGjkBatchSetLane(m_supportA,lane,btVector3(0,0,0));
+		btGjkBatchSetLane(m_supportB,lane,btVector3(0,0,0));
+		m_squaredDistance[lane] = BT_LARGE_FLOAT;
+		m_maximumDistanceSquared[lane] = input.m_maximumDistanceSquared;
+	}
+
+#ifdef BT_USE_SSE_GJK_BATCH
+	///row i of the basis times v
+	static SIMD_FORCE_INLINE __m128	dotRow(const btScalar basis[3][3][BT_GJK_BATCH_WIDTH],int i,const __m128 v[3])
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(basis[i][0]),v[0]),_mm_mul_ps(_mm_load_ps(basis[i][1]),v[1])),_mm_mul_ps(_mm_load_ps(basis[i][2]),v[2]));
+	}
+
+	///column j of the basis times v
+	static SIMD_FORCE_INLINE __m128	dotColumn(const btScalar basis[3][3][BT_GJK_BATCH_WIDTH],int j,const __m128 v[3])
+	{
+		return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(basis[0][j]),v[0]),_mm_mul_ps(_mm_load_ps(basis[1][j]),v[1])),_mm_mul_ps(_mm_load_ps(basis[2][j]),v[2]));
+	}
+#endif
+
+	///the separating axis in the frame of A, negated, and in the frame of B
+	void	computeSupportDirections()
+	{
+#ifdef BT_USE_SSE_GJK_BATCH
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 axis[3] = {_mm_load_ps(m_separatingAxis[0]),_mm_load_ps(m_separatingAxis[1]),_mm_load_ps(m_separatingAxis[2])};
+		const __m128 negatedAxis[3] = {_mm_sub_ps(zero,axis[0]),_mm_sub_ps(zero,axis[1]),_mm_sub_ps(zero,axis[2])};
+		for (int j=0;j<3;j++)
+		{
+			_mm_store_ps(m_directionA[j],dotColumn(m_basisA,j,negatedAxis));
+			_mm_store_ps(m_directionB[j],dotColumn(m_basisB,j,axis));
+		}
+#else
+		for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+		{
+			for (int j=0;j<3;j++)
+			{
+				m_directionA[j][l] = -(m_basisA[0][j][l]*m_separatingAxis[0][l] + m_basisA[1][j][l]*m_separatingAxis[1][l] + m_basisA[2][j][l]*m_separatingAxis[2][l]);
+				m_directionB[j][l] = m_basisB[0][j][l]*m_separatingAxis[0][l] + m_basisB[1][j][l]*m_separatingAxis[1][l] + m_basisB[2][j][l]*m_separatingAxis[2][l];
+			}
+		}
+#endif
+	}
+
+	///transforms the support points, and returns the lanes where the new point is beyond the maximum distance or
+	///brings the pair no closer, the first two exits of btGjkPairDetector
+	int	computeSupportPoints()
+	{
+#ifdef BT_USE_SSE_GJK_BATCH
+		const __m128 supportA[3] = {_mm_load_ps(m_supportA[0]),_mm_load_ps(m_supportA[1]),_mm_load_ps(m_supportA[2])};
+		const __m128 supportB[3] = {_mm_load_ps(m_supportB[0]),_mm_load_ps(m_supportB[1]),_mm_load_ps(m_supportB[2])};
+		__m128 delta = _mm_setzero_ps();
+		for (int i=0;i<3;i++)
+		{
+			const __m128 pointA = _mm_add_ps(dotRow(m_basisA,i,supportA),_mm_load_ps(m_originA[i]));
+			const __m128 pointB = _mm_add_ps(dotRow(m_basisB,i,supportB),_mm_load_ps(m_originB[i]));
+			_mm_store_ps(m_pointA[i],pointA);
+			_mm_store_ps(m_pointB[i],pointB);
+			delta = _mm_add_ps(delta,_mm_mul_ps(_mm_load_ps(m_separatingAxis[i]),_mm_sub_ps(pointA,pointB)));
+		}
+		const __m128 squaredDistance = _mm_load_ps(m_squaredDistance);
+		const __m128 beyondMaximum = _mm_and_ps(_mm_cmpgt_ps(delta,_mm_setzero_ps()),
+			_mm_cmpgt_ps(_mm_mul_ps(delta,delta),_mm_mul_ps(squaredDistance,_mm_load_ps(m_maximumDistanceSquared))));
+		const __m128 noCloser = _mm_cmple_ps(_mm_sub_ps(squaredDistance,delta),_mm_mul_ps(squaredDistance,_mm_set1_ps(BT_GJK_BATCH_REL_ERROR2)));
+		return _mm_movemask_ps(_mm_or_ps(beyondMaximum,noCloser));
+#else
+		int mask = 0;
+		for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+		{
+			btScalar delta = btScalar(0.);
+			for (int i=0;i<3;i++)
+			{
+				m_pointA[i][l] = m_basisA[i][0][l]*m_supportA[0][l] + m_basisA[i][1][l]*m_supportA[1][l] + m_basisA[i][2][l]*m_supportA[2][l] + m_originA[i][l];
+				m_pointB[i][l] = m_basisB[i][0][l]*m_supportB[0][l] + m_basisB[i][1][l]*m_supportB[1][l] + m_basisB[i][2][l]*m_supportB[2][l] + m_originB[i][l];
+				delta += m_separatingAxis[i][l]*(m_pointA[i][l]-m_pointB[i][l]);
+			}
+			const btScalar squaredDistance = m_squaredDistance[l];
+			if (((delta > btScalar(0.0)) && (delta * delta > squaredDistance * m_maximumDistanceSquared[l])) ||
+				(squaredDistance - delta <= squaredDistance * BT_GJK_BATCH_REL_ERROR2))
+			{
+				mask |= 1<<l;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	///adds the support point of a lane to its simplex and moves the separating axis to the closest point, the rest of an
+	///iteration of btGjkPairDetector
+	int	updateSimplex(int lane,btGjkBatchSimplex& simplex,int& numIterations)
+	{
+		const btVector3 pointA = btGjkBatchGetLane(m_pointA,lane);
+		const btVector3 pointB = btGjkBatchGetLane(m_pointB,lane);
+		const btVector3 w = pointA - pointB;
+		if (simplex.inSimplex(w))
+			return BT_GJK_BATCH_LANE_CLOSEST;
+
+		simplex.addVertex(w,pointA,pointB);
+		btVector3 newSeparatingAxis;
+		if (!simplex.closest(newSeparatingAxis))
+			return BT_GJK_BATCH_LANE_FALLBACK;
+		if (newSeparatingAxis.length2() < BT_GJK_BATCH_REL_ERROR2)
+			return BT_GJK_BATCH_LANE_FALLBACK;
+
+		const btScalar previousSquaredDistance = m_squaredDistance[lane];
+		const btScalar squaredDistance = newSeparatingAxis.length2();
+		m_squaredDistance[lane] = squaredDistance;
+		if (previousSquaredDistance - squaredDistance <= SIMD_EPSILON * previousSquaredDistance)
+			return BT_GJK_BATCH_LANE_CLOSEST;
+
+		btGjkBatchSetLane(m_separatingAxis,lane,newSeparatingAxis);
+		if (numIterations++ > BT_GJK_BATCH_MAX_ITERATIONS || simplex.m_numVertices == 4)
+			return BT_GJK_BATCH_LANE_FALLBACK;
+		return BT_GJK_BATCH_LANE_ITERATE;
+	}
+
+	///the contact point of a lane that converged, like btGjkPairDetector after its iterations
+	void	computeOutput(int lane,const btGjkBatchSimplex& simplex,const btGjkBatchInput& input,const btVector3& positionOffset,btGjkBatchOutput& output) const
+	{
+		output.m_status = BT_GJK_BATCH_FALLBACK;
+
+		const btVector3 separatingAxis = btGjkBatchGetLane(m_separatingAxis,lane);
+		const btScalar lenSqr = separatingAxis.length2();
+		if (lenSqr <= SIMD_EPSILON*SIMD_EPSILON)
+			return;
+
+		const btScalar marginA = input.m_shapeA->getMargin();
+		const btScalar marginB = input.m_shapeB->getMargin();
+		const btScalar margin = marginA + marginB;
+		const btScalar rlen = btScalar(1.) / btSqrt(lenSqr);
+		const btScalar s = btSqrt(m_squaredDistance[lane]);
+		btVector3 normalInB = separatingAxis * rlen;
+		const btVector3 pointOnB = simplex.m_closestPointQ + separatingAxis * (marginB / s);
+		const btScalar distance = (btScalar(1.)/rlen) - margin;
+		if ((distance+margin) < BT_GJK_BATCH_PENETRATION_DISTANCE)
+			return;
+
+		if ((distance < 0) || (distance*distance < input.m_maximumDistanceSquared))
+		{
+			//contact normals point from B to A, see m_fixContactNormalDirection of btGjkPairDetector
+			btTransform localTransA = input.m_transformA;
+			btTransform localTransB = input.m_transformB;
+			localTransA.getOrigin() -= positionOffset;
+			localTransB.getOrigin() -= positionOffset;
+			btVector3 aabbMin,aabbMax;
+			input.m_shapeA->getAabb(localTransA,aabbMin,aabbMax);
+			const btVector3 posA = (aabbMax+aabbMin)*btScalar(0.5);
+			input.m_shapeB->getAabb(localTransB,aabbMin,aabbMax);
+			const btVector3 posB = (aabbMin+aabbMax)*btScalar(0.5);
+			if ((posA-posB).dot(normalInB) < 0.f)
+				normalInB *= -1.f;
+
+			output.m_normalOnBInWorld = normalInB;
+			output.m_pointInWorld = pointOnB + positionOffset;
+			output.m_separatingAxis = normalInB;
+			output.m_distance = distance;
+			output.m_status = BT_GJK_BATCH_CONTACT;
+		} else
+		{
+			output.m_separatingAxis = separatingAxis;
+			output.m_distance = distance;
+			output.m_status = BT_GJK_BATCH_SEPARATED;
+		}
+	}
+};
+
+template <class SupportA,class SupportB>
+static void	btGjkBatchKernel(const btGjkBatchInput* inputs,btGjkBatchOutput* outputs,int numPairs)
+{
+	for (int base=0;base<numPairs;base+=BT_GJK_BATCH_WIDTH)
+	{
+		const int numLanes = btMin(numPairs-base,int(BT_GJK_BATCH_WIDTH));
+		btGjkBatchLanes lanes;
+		SupportA supportA;
+		SupportB supportB;
+		btGjkBatchSimplex simplex[BT_GJK_BATCH_WIDTH];
+		btVector3 positionOffset[BT_GJK_BATCH_WIDTH];
+		int numIterations[BT_GJK_BATCH_WIDTH];
+
+		//unused lanes repeat the last pair, so they compute on valid data
+		for (int l=0;l<BT_GJK_BATCH_WIDTH;l++)
+		{
+			const btGjkBatchInput& input = inputs[base+btMin(l,numLanes-1)];
+			lanes.setLane(l,input,positionOffset[l]);
+			supportA.setLane(l,input.m_shapeA);
+			supportB.setLane(l,input.m_shapeB);
+			simplex[l].reset();
+			numIterations[l] = 0;
+		}
+
+		int activeLanes = (1<<numLanes)-1;
+		while (activeLanes)
+		{
+			lanes.computeSupportDirections();
+			supportA.getSupportingVertices(lanes.m_directionA,lanes.m_supportA,activeLanes);
+			supportB.getSupportingVertices(lanes.m_directionB,lanes.m_supportB,activeLanes);
+			const int closestLanes = lanes.computeSupportPoints();
+
+			for (int l=0;l<numLanes;l++)
+			{
+				if (!(activeLanes & (1<<l)))
+					continue;
+				const int status = (closestLanes & (1<<l)) ? BT_GJK_BATCH_LANE_CLOSEST : lanes.updateSimplex(l,simplex[l],numIterations[l]);
+				if (status == BT_GJK_BATCH_LANE_ITERATE)
+					continue;
+
+				activeLanes &= ~(1<<l);
+				btGjkBatchOutput& output = outputs[base+l];
+				if (status == BT_GJK_BATCH_LANE_CLOSEST)
+				{
+					lanes.computeOutput(l,simplex[l],inputs[base+l],positionOffset[l],output);
+				} else
+				{
+					output.m_status = BT_GJK_BATCH_FALLBACK;
+				}
+			}
+		}
+	}
+}
+
+template <class SupportA>
+static void	btGjkBatchKernelB(int shapeTypeB,const btGjkBatchInput* inputs,btGjkBatchOutput* outputs,int numPairs)
+{
+	switch (shapeTypeB)
+	{
+	case BOX_SHAPE_PROXYTYPE:
+		btGjkBatchKernel<SupportA,btGjkBatchBoxSupport>(inputs,outputs,numPairs);
+		break;
+	case SPHERE_SHAPE_PROXYTYPE:
+		btGjkBatchKernel<SupportA,btGjkBatchSphereSupport>(inputs,outputs,numPairs);
+		break;
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+		btGjkBatchKernel<SupportA,btGjkBatchConvexHullSupport>(inputs,outputs,numPairs);
+		break;
+	default:
+		for (int i=0;i<numPairs;i++)
+		{
+			outputs[i].m_status = BT_GJK_BATCH_FALLBACK;
+		}
+	}
+}
+
+bool	btGjkBatch::isBatchShapeType(int shapeType)
+{
+	return (shapeType == BOX_SHAPE_PROXYTYPE) || (shapeType == SPHERE_SHAPE_PROXYTYPE) || (shapeType == CONVEX_HULL_SHAPE_PROXYTYPE);
+}
+
+void	btGjkBatch::computeClosestPoints(const btGjkBatchInput* inputs,btGjkBatchOutput* outputs,int numPairs)
+{
+	int begin = 0;
+	while (begin<numPairs)
+	{
+		const int shapeTypeA = inputs[begin].m_shapeA->getShapeType();
+		const int shapeTypeB = inputs[begin].m_shapeB->getShapeType();
+		int end = begin+1;
+		while (end<numPairs && inputs[end].m_shapeA->getShapeType()==shapeTypeA && inputs[end].m_shapeB->getShapeType()==shapeTypeB)
+		{
+			end++;
+		}
+
+		switch (shapeTypeA)
+		{
+		case BOX_SHAPE_PROXYTYPE:
+			btGjkBatchKernelB<btGjkBatchBoxSupport>(shapeTypeB,inputs+begin,outputs+begin,end-begin);
+			break;
+		case SPHERE_SHAPE_PROXYTYPE:
+			btGjkBatchKernelB<btGjkBatchSphereSupport>(shapeTypeB,inputs+begin,outputs+begin,end-begin);
+			break;
+		case CONVEX_HULL_SHAPE_PROXYTYPE:
+			btGjkBatchKernelB<btGjkBatchConvexHullSupport>(shapeTypeB,inputs+begin,outputs+begin,end-begin);
+			break;
+		default:
+			for (int i=begin;i<end;i++)
+			{
+				outputs[i].m_status = BT_GJK_BATCH_FALLBACK;
+			}
+		}
+		begin = end;
+	}
+}
@@ -0,0 +1,77 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_GJK_BATCH_H
+#define BT_GJK_BATCH_H
+
+#include "LinearMath/btTransform.h"
+
+class btConvexShape;
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(BT_USE_SSE) || defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define BT_USE_SSE_GJK_BATCH
+#endif
+
+///number of pairs that run in the SIMD lanes of one btGjkBatch kernel
+#define BT_GJK_BATCH_WIDTH 4
+
+///one pair of a batch, the arguments btGjkPairDetector gets in its constructor and btGjkPairDetector::ClosestPointInput
+struct btGjkBatchInput
+{
+	btTransform				m_transformA;
+	btTransform				m_transformB;
+	const btConvexShape*	m_shapeA;
+	const btConvexShape*	m_shapeB;
+	btScalar				m_maximumDistanceSquared;
+};
+
+enum btGjkBatchStatus
+{
+	BT_GJK_BATCH_SEPARATED = 0,	// btGjkPairDetector would not report a contact point
+	BT_GJK_BATCH_CONTACT,		// btGjkPairDetector would report the contact point in the output
+	BT_GJK_BATCH_FALLBACK		// penetration or a degenerate simplex, the pair needs btGjkPairDetector with a penetration depth solver
+};
+
+struct btGjkBatchOutput
+{
+	btVector3	m_normalOnBInWorld;
+	btVector3	m_pointInWorld;		// the point on B
+	btVector3	m_separatingAxis;	// btGjkPairDetector::getCachedSeparatingAxis after the query
+	btScalar	m_distance;
+	int			m_status;			// btGjkBatchStatus
+};
+
+///btGjkBatch finds the closest points of many convex pairs, the GJK iterations of BT_GJK_BATCH_WIDTH pairs run side by side
+///in SIMD lanes. The support functions of box, sphere and convex hull shapes are compiled into the kernel for each pair of
+///shape types, instead of a call through btConvexShape per iteration, and the simplex has no cached state.
+///The results are those of btGjkPairDetector::getClosestPoints with a penetration depth solver, except for the pairs that
+///would need the penetration depth solver, they are left to btGjkPairDetector with BT_GJK_BATCH_FALLBACK.
+///Convex hulls with a btConvexHullSupportMap start the hill climbing of each lane at the supporting vertex of its last
+///iteration, so for directions with several supporting points the results can differ from btGjkPairDetector.
+///See btCollisionDispatcherMt, which batches the convex pairs of btConvexConvexAlgorithm.
+class btGjkBatch
+{
+public:
+
+	///true for the shape types computeClosestPoints has a support function for
+	static bool	isBatchShapeType(int shapeType);
+
+	///the pairs can have any shape types, consecutive pairs with the same types of A and B share the SIMD lanes,
+	///so sort them by the shape types. Pairs with other shape types get BT_GJK_BATCH_FALLBACK.
+	static void	computeClosestPoints(const btGjkBatchInput* inputs,btGjkBatchOutput* outputs,int numPairs);
+};
+
+#endif //BT_GJK_BATCH_H
@@ -24,6 +24,11 @@ subject to the following restrictions:
 
 #include <float.h> //for FLT_MAX
 
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(BT_USE_SSE) || defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define BT_USE_SSE_POLYHEDRAL_CLIPPING
+#endif
+
 int gExpectedNbTests=0;
 int gActualNbTests = 0;
 bool gUseInternalObject = true;
@@ -77,15 +82,118 @@ void btPolyhedralContactClipping::clipFace(const btVertexArray& pVtxIn, btVertex
 }
 
 
-static bool TestSepAxis(const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, const btVector3& sep_axis, btScalar& depth, btVector3& witnessPointA, btVector3& witnessPointB)
+///The vertices of the hulls are transformed to world space once per findSeparatingAxis and stored in groups of four,
+///the x, y and z of a group in three consecutive btVector3, so the projections onto the axes run four vertices at a time.
+static SIMD_FORCE_INLINE void storeSoA(btVector3* soa, int i, const btVector3& v)
+{
+	btVector3* group = &soa[3*(i>>2)];
+	group[0][i&3] = v.getX();
+	group[1][i&3] = v.getY();
+	group[2][i&3] = v.getZ();
+}
+
+static SIMD_FORCE_INLINE btVector3 loadSoA(const btVector3* soa, int i)
+{
+	const btVector3* group = &soa[3*(i>>2)];
+	return btVector3(group[0][i&3],group[1][i&3],group[2][i&3]);
+}
+
+///stores the vertices transformed by trans, the last group is padded with the last vertex, which never wins over the vertex itself
+static int transformVerticesSoA(const btAlignedObjectArray<btVector3>& vertices, const btTransform& trans, btVector3* soa)
+{
+	const int numVertices = vertices.size();
+	const int numGroups = (numVertices+3)>>2;
+	for (int i=0;i<numGroups*4;i++)
+	{
+		storeSoA(soa,i,trans*vertices[btMin(i,numVertices-1)]);
+	}
+	return numGroups;
+}
+
+///as btConvexPolyhedron::project, returns the indices of the witness points
+static void projectSoA(const btVector3* soa, int numGroups, const btVector3& dir, btScalar& minProj, btScalar& maxProj, int& witnesMin, int& witnesMax)
+{
+	minProj = FLT_MAX;
+	maxProj = -FLT_MAX;
+	witnesMin = -1;
+	witnesMax = -1;
+#ifdef BT_USE_SSE_POLYHEDRAL_CLIPPING
+	const __m128 dirX = _mm_set1_ps(dir.getX());
+	const __m128 dirY = _mm_set1_ps(dir.getY());
+	const __m128 dirZ = _mm_set1_ps(dir.getZ());
+	const __m128i four = _mm_set1_epi32(4);
+	__m128 laneMin = _mm_set1_ps(minProj);
+	__m128 laneMax = _mm_set1_ps(maxProj);
+	__m128i laneMinIndex = _mm_set1_epi32(-1);
+	__m128i laneMaxIndex = _mm_set1_epi32(-1);
+	__m128i index = _mm_setr_epi32(0,1,2,3);
+	for (int g=0;g<numGroups;g++)
+	{
+		const btVector3* group = &soa[3*g];
+		const __m128 dp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(group[0]),dirX),_mm_mul_ps(_mm_load_ps(group[1]),dirY)),_mm_mul_ps(_mm_load_ps(group[2]),dirZ));
+		const __m128 less = _mm_cmplt_ps(dp,laneMin);
+		const __m128 greater = _mm_cmpgt_ps(dp,laneMax);
+		laneMin = _mm_or_ps(_mm_and_ps(less,dp),_mm_andnot_ps(less,laneMin));
+		laneMax = _mm_or_ps(_mm_and_ps(greater,dp),_mm_andnot_ps(greater,laneMax));
+		laneMinIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(less),index),_mm_andnot_si128(_mm_castps_si128(less),laneMinIndex));
+		laneMaxIndex = _mm_or_si128(_mm_and_si128(_mm_castps_si128(greater),index),_mm_andnot_si128(_mm_castps_si128(greater),laneMaxIndex));
+		index = _mm_add_epi32(index,four);
+	}
+	ATTRIBUTE_ALIGNED16(btScalar laneMins[4]);
+	ATTRIBUTE_ALIGNED16(btScalar laneMaxs[4]);
+	ATTRIBUTE_ALIGNED16(int laneMinIndices[4]);
+	ATTRIBUTE_ALIGNED16(int laneMaxIndices[4]);
+	_mm_store_ps(laneMins,laneMin);
+	_mm_store_ps(laneMaxs,laneMax);
+	_mm_store_si128((__m128i*)laneMinIndices,laneMinIndex);
+	_mm_store_si128((__m128i*)laneMaxIndices,laneMaxIndex);
+
+	//each lane holds the first of its smallest and largest, keep the first over all lanes as the scalar loop does
+	for (int l=0;l<4;l++)
+	{
+		if (laneMinIndices[l]>=0 && (laneMins[l]<minProj || (laneMins[l]==minProj && laneMinIndices[l]<witnesMin)))
+		{
+			minProj = laneMins[l];
+			witnesMin = laneMinIndices[l];
+		}
+		if (laneMaxIndices[l]>=0 && (laneMaxs[l]>maxProj || (laneMaxs[l]==maxProj && laneMaxIndices[l]<witnesMax)))
+		{
+			maxProj = laneMaxs[l];
+			witnesMax = laneMaxIndices[l];
+		}
+	}
+#else
+	for (int i=0;i<numGroups*4;i++)
+	{
+		const btScalar dp = loadSoA(soa,i).dot(dir);
+		if(dp < minProj)
+		{
+			minProj = dp;
+			witnesMin = i;
+		}
+		if(dp > maxProj)
+		{
+			maxProj = dp;
+			witnesMax = i;
+		}
+	}
+#endif
+	if(minProj>maxProj)
+	{
+		btSwap(minProj,maxProj);
+		btSwap(witnesMin,witnesMax);
+	}
+}
+
+static bool TestSepAxis(const btVector3* worldVertsA, int numGroupsA, const btVector3* worldVertsB, int numGroupsB, const btVector3& sep_axis, btScalar& depth, btVector3& witnessPointA, btVector3& witnessPointB)
 {
 	btScalar Min0,Max0;
 	btScalar Min1,Max1;
-	btVector3 witnesPtMinA,witnesPtMaxA;
-	btVector3 witnesPtMinB,witnesPtMaxB;
+	int witnesMinA,witnesMaxA;
+	int witnesMinB,witnesMaxB;
 
-	hullA.project(transA,sep_axis, Min0, Max0,witnesPtMinA,witnesPtMaxA);
-	hullB.project(transB, sep_axis, Min1, Max1,witnesPtMinB,witnesPtMaxB);
+	projectSoA(worldVertsA,numGroupsA,sep_axis, Min0, Max0,witnesMinA,witnesMaxA);
+	projectSoA(worldVertsB,numGroupsB,sep_axis, Min1, Max1,witnesMinB,witnesMaxB);
 
 	if(Max0<Min1 || Max1<Min0)
 		return false;
@@ -94,18 +202,23 @@ static bool TestSepAxis(const btConvexPolyhedron& hullA, const btConvexPolyhedro
 	btAssert(d0>=0.0f);
 	btScalar d1 = Max1 - Min0;
 	btAssert(d1>=0.0f);
+	int witnesA,witnesB;
 	if (d0<d1)
 	{
 		depth = d0;
-		witnessPointA = witnesPtMaxA;
-		witnessPointB = witnesPtMinB;
+		witnesA = witnesMaxA;
+		witnesB = witnesMinB;
 
 	} else
 	{
 		depth = d1;
-		witnessPointA = witnesPtMinA;
-		witnessPointB = witnesPtMaxB;
+		witnesA = witnesMinA;
+		witnesB = witnesMaxB;
 	}
+	if (witnesA>=0)
+		witnessPointA = loadSoA(worldVertsA,witnesA);
+	if (witnesB>=0)
+		witnessPointB = loadSoA(worldVertsB,witnesB);
 	
 	return true;
 }
@@ -147,7 +260,8 @@ void InverseTransformPoint3x3(btVector3& out, const btVector3& in, const btTrans
 	out.setValue(x, y, z);
 }
 
- bool TestInternalObjects( const btTransform& trans0, const btTransform& trans1, const btVector3& delta_c, const btVector3& axis, const btConvexPolyhedron& convex0, const btConvexPolyhedron& convex1, btScalar dmin)
+///the smallest depth an axis can have, from the boxes and spheres inside the hulls
+static btScalar InternalObjectsDepth( const btTransform& trans0, const btTransform& trans1, const btVector3& delta_c, const btVector3& axis, const btConvexPolyhedron& convex0, const btConvexPolyhedron& convex1)
 {
 	const btScalar dp = delta_c.dot(axis);
 
@@ -172,12 +286,116 @@ void InverseTransformPoint3x3(btVector3& out, const btVector3& in, const btTrans
 	const btScalar d1 = MinMaxRadius - dp;
 
 	const btScalar depth = d0<d1 ? d0:d1;
+	return depth;
+}
+
+ bool TestInternalObjects( const btTransform& trans0, const btTransform& trans1, const btVector3& delta_c, const btVector3& axis, const btConvexPolyhedron& convex0, const btConvexPolyhedron& convex1, btScalar dmin)
+{
+	const btScalar depth = InternalObjectsDepth(trans0,trans1,delta_c,axis,convex0,convex1);
 	if(depth>dmin)
 		return false;
 	return true;
 }
 #endif //TEST_INTERNAL_OBJECTS
 
+///the edge-edge axes of one world edge of hull A with a group of four world edges of hull B
+ATTRIBUTE_ALIGNED16(struct) btEdgeAxes4
+{
+	btVector3	m_x;		// the normalized cross products, pointing from hull B to hull A
+	btVector3	m_y;
+	btVector3	m_z;
+	btVector3	m_depth;	// the depth bound of TestInternalObjects, an axis whose bound exceeds dmin is skipped
+	int			m_nonZero[4];
+};
+
+#ifdef BT_USE_SSE_POLYHEDRAL_CLIPPING
+#ifdef TEST_INTERNAL_OBJECTS
+///the radius of TestInternalObjects of four axes, the operations are those of the scalar code so the results are the same
+static SIMD_FORCE_INLINE __m128 internalObjectRadius4(const btTransform& trans, const btConvexPolyhedron& convex, __m128 axisX, __m128 axisY, __m128 axisZ)
+{
+	const btMatrix3x3& rot = trans.getBasis();
+	__m128 radius = _mm_setzero_ps();
+	for (int k=0;k<3;k++)
+	{
+		const __m128 localAxis = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(rot[0][k]),axisX),_mm_mul_ps(_mm_set1_ps(rot[1][k]),axisY)),_mm_mul_ps(_mm_set1_ps(rot[2][k]),axisZ));
+		const __m128 negative = _mm_cmplt_ps(localAxis,_mm_setzero_ps());
+		const __m128 extent = _mm_or_ps(_mm_and_ps(negative,_mm_set1_ps(-convex.m_extents[k])),_mm_andnot_ps(negative,_mm_set1_ps(convex.m_extents[k])));
+		const __m128 term = _mm_mul_ps(extent,localAxis);
+		radius = k ? _mm_add_ps(radius,term) : term;
+	}
+	return _mm_max_ps(radius,_mm_set1_ps(convex.m_radius));
+}
+#endif //TEST_INTERNAL_OBJECTS
+
+static void computeEdgeAxes4(const btVector3& worldEdge0, const btVector3* worldEdges1, const btVector3& delta_c, const btTransform& transA, const btTransform& transB, const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, btEdgeAxes4& axes)
+{
+	const __m128 ax = _mm_set1_ps(worldEdge0.getX());
+	const __m128 ay = _mm_set1_ps(worldEdge0.getY());
+	const __m128 az = _mm_set1_ps(worldEdge0.getZ());
+	const __m128 bx = _mm_load_ps(worldEdges1[0]);
+	const __m128 by = _mm_load_ps(worldEdges1[1]);
+	const __m128 bz = _mm_load_ps(worldEdges1[2]);
+	__m128 cx = _mm_sub_ps(_mm_mul_ps(ay,bz),_mm_mul_ps(az,by));
+	__m128 cy = _mm_sub_ps(_mm_mul_ps(az,bx),_mm_mul_ps(ax,bz));
+	__m128 cz = _mm_sub_ps(_mm_mul_ps(ax,by),_mm_mul_ps(ay,bx));
+
+	//IsAlmostZero, fabsf(x)>1e-6 is the same test as fabsf(x)>1e-6f for a float
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	const __m128 epsilon = _mm_set1_ps(1e-6f);
+	const __m128 nonZero = _mm_or_ps(_mm_or_ps(_mm_cmpgt_ps(_mm_and_ps(cx,absMask),epsilon),_mm_cmpgt_ps(_mm_and_ps(cy,absMask),epsilon)),_mm_cmpgt_ps(_mm_and_ps(cz,absMask),epsilon));
+	_mm_store_si128((__m128i*)axes.m_nonZero,_mm_castps_si128(nonZero));
+
+	//btVector3::normalize, the lanes that are almost zero are never used
+	const __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(cx,cx),_mm_mul_ps(cy,cy)),_mm_mul_ps(cz,cz)));
+	const __m128 invLength = _mm_div_ps(_mm_set1_ps(1.f),length);
+	cx = _mm_mul_ps(cx,invLength);
+	cy = _mm_mul_ps(cy,invLength);
+	cz = _mm_mul_ps(cz,invLength);
+
+	const __m128 dcx = _mm_set1_ps(delta_c.getX());
+	const __m128 dcy = _mm_set1_ps(delta_c.getY());
+	const __m128 dcz = _mm_set1_ps(delta_c.getZ());
+	const __m128 flip = _mm_and_ps(_mm_cmplt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dcx,cx),_mm_mul_ps(dcy,cy)),_mm_mul_ps(dcz,cz)),_mm_setzero_ps()),_mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+	cx = _mm_xor_ps(cx,flip);
+	cy = _mm_xor_ps(cy,flip);
+	cz = _mm_xor_ps(cz,flip);
+	_mm_store_ps(axes.m_x,cx);
+	_mm_store_ps(axes.m_y,cy);
+	_mm_store_ps(axes.m_z,cz);
+
+#ifdef TEST_INTERNAL_OBJECTS
+	const __m128 dp = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dcx,cx),_mm_mul_ps(dcy,cy)),_mm_mul_ps(dcz,cz));
+	const __m128 MinRadius = internalObjectRadius4(transA,hullA,cx,cy,cz);
+	const __m128 MaxRadius = internalObjectRadius4(transB,hullB,cx,cy,cz);
+	const __m128 MinMaxRadius = _mm_add_ps(MaxRadius,MinRadius);
+	_mm_store_ps(axes.m_depth,_mm_min_ps(_mm_add_ps(MinMaxRadius,dp),_mm_sub_ps(MinMaxRadius,dp)));
+#endif //TEST_INTERNAL_OBJECTS
+}
+
+#else //BT_USE_SSE_POLYHEDRAL_CLIPPING
+
+static void computeEdgeAxes4(const btVector3& worldEdge0, const btVector3* worldEdges1, const btVector3& delta_c, const btTransform& transA, const btTransform& transB, const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, btEdgeAxes4& axes)
+{
+	for (int l=0;l<4;l++)
+	{
+		btVector3 Cross = worldEdge0.cross(loadSoA(worldEdges1,l));
+		axes.m_nonZero[l] = !IsAlmostZero(Cross);
+		if (!axes.m_nonZero[l])
+			continue;
+		Cross = Cross.normalize();
+		if (delta_c.dot(Cross)<0)
+			Cross *= -1.f;
+		axes.m_x[l] = Cross.getX();
+		axes.m_y[l] = Cross.getY();
+		axes.m_z[l] = Cross.getZ();
+#ifdef TEST_INTERNAL_OBJECTS
+		axes.m_depth[l] = InternalObjectsDepth(transA,transB,delta_c,Cross,hullA,hullB);
+#endif //TEST_INTERNAL_OBJECTS
+	}
+}
+
+#endif //BT_USE_SSE_POLYHEDRAL_CLIPPING
+
  
  
  SIMD_FORCE_INLINE void btSegmentsClosestPoints(
@@ -238,6 +456,13 @@ void InverseTransformPoint3x3(btVector3& out, const btVector3& in, const btTrans
 
 
 bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut)
+{
+	btVertexArray worldVertsA;
+	btVertexArray worldVertsB;
+	return findSeparatingAxis(hullA,hullB,transA,transB,sep,resultOut,worldVertsA,worldVertsB);
+}
+
+bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, btVector3& sep, btDiscreteCollisionDetectorInterface::Result& resultOut, btVertexArray& worldVertsA, btVertexArray& worldVertsB)
 {
 	gActualSATPairTests++;
 
@@ -247,6 +472,23 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 	const btVector3 DeltaC2 = c0 - c1;
 //#endif
 
+	//worldVertsB holds the world vertices of hullB followed by its world unique edges
+	const int numGroupsA = (hullA.m_vertices.size()+3)>>2;
+	const int numGroupsB = (hullB.m_vertices.size()+3)>>2;
+	const int numEdgesB = hullB.m_uniqueEdges.size();
+	const int numEdgeGroupsB = (numEdgesB+3)>>2;
+	worldVertsA.resize(3*numGroupsA);
+	worldVertsB.resize(3*(numGroupsB+numEdgeGroupsB));
+	btVector3* soaA = worldVertsA.size() ? &worldVertsA[0] : 0;
+	btVector3* soaB = worldVertsB.size() ? &worldVertsB[0] : 0;
+	btVector3* worldEdgesB = soaB + 3*numGroupsB;
+	transformVerticesSoA(hullA.m_vertices,transA,soaA);
+	transformVerticesSoA(hullB.m_vertices,transB,soaB);
+	for (int i=0;i<numEdgeGroupsB*4;i++)
+	{
+		storeSoA(worldEdgesB,i,transB.getBasis() * hullB.m_uniqueEdges[btMin(i,numEdgesB-1)]);
+	}
+
 	btScalar dmin = FLT_MAX;
 	int curPlaneTests=0;
 
@@ -269,7 +511,7 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 
 		btScalar d;
 		btVector3 wA,wB;
-		if(!TestSepAxis( hullA, hullB, transA,transB, faceANormalWS, d,wA,wB))
+		if(!TestSepAxis( soaA, numGroupsA, soaB, numGroupsB, faceANormalWS, d,wA,wB))
 			return false;
 
 		if(d<dmin)
@@ -298,7 +540,7 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 
 		btScalar d;
 		btVector3 wA,wB;
-		if(!TestSepAxis(hullA, hullB,transA,transB, WorldNormal,d,wA,wB))
+		if(!TestSepAxis(soaA, numGroupsA, soaB, numGroupsB, WorldNormal,d,wA,wB))
 			return false;
 
 		if(d<dmin)
@@ -322,30 +564,31 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 	{
 		const btVector3 edge0 = hullA.m_uniqueEdges[e0];
 		const btVector3 WorldEdge0 = transA.getBasis() * edge0;
-		for(int e1=0;e1<hullB.m_uniqueEdges.size();e1++)
-		{
-			const btVector3 edge1 = hullB.m_uniqueEdges[e1];
-			const btVector3 WorldEdge1 = transB.getBasis() * edge1;
 
-			btVector3 Cross = WorldEdge0.cross(WorldEdge1);
-			curEdgeEdge++;
-			if(!IsAlmostZero(Cross))
+		//the axes and their internal object bounds are computed for four edges of hullB at a time,
+		//then tested in the order of the edges because dmin shrinks from one axis to the next
+		for(int g=0;g<numEdgeGroupsB;g++)
+		{
+			btEdgeAxes4 axes;
+			computeEdgeAxes4(WorldEdge0,&worldEdgesB[3*g],DeltaC2,transA,transB,hullA,hullB,axes);
+			const int numLanes = btMin(4,numEdgesB-4*g);
+			for(int l=0;l<numLanes;l++)
 			{
-				Cross = Cross.normalize();
-				if (DeltaC2.dot(Cross)<0)
-					Cross *= -1.f;
-
+				curEdgeEdge++;
+				if(!axes.m_nonZero[l])
+					continue;
 
 #ifdef TEST_INTERNAL_OBJECTS
 				gExpectedNbTests++;
-				if(gUseInternalObject && !TestInternalObjects(transA,transB,DeltaC2, Cross, hullA, hullB, dmin))
+				if(gUseInternalObject && axes.m_depth[l]>dmin)
 					continue;
 				gActualNbTests++;
 #endif
 
+				const btVector3 Cross(axes.m_x[l],axes.m_y[l],axes.m_z[l]);
 				btScalar dist;
 				btVector3 wA,wB;
-				if(!TestSepAxis( hullA, hullB, transA,transB, Cross, dist,wA,wB))
+				if(!TestSepAxis( soaA, numGroupsA, soaB, numGroupsB, Cross, dist,wA,wB))
 					return false;
 
 				if(dist<dmin)
@@ -353,9 +596,9 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 					dmin = dist;
 					sep = Cross;
 					edgeA=e0;
-					edgeB=e1;
+					edgeB=4*g+l;
 					worldEdgeA = WorldEdge0;
-					worldEdgeB = WorldEdge1;
+					worldEdgeB = loadSoA(worldEdgesB,edgeB);
 					witnessPointA=wA;
 					witnessPointB=wB;
 				}
@@ -414,8 +657,14 @@ bool btPolyhedralContactClipping::findSeparatingAxis(	const btConvexPolyhedron&
 void	btPolyhedralContactClipping::clipFaceAgainstHull(const btVector3& separatingNormal, const btConvexPolyhedron& hullA,  const btTransform& transA, btVertexArray& worldVertsB1, const btScalar minDist, btScalar maxDist,btDiscreteCollisionDetectorInterface::Result& resultOut)
 {
 	btVertexArray worldVertsB2;
+	clipFaceAgainstHull(separatingNormal, hullA, transA, worldVertsB1, worldVertsB2, minDist, maxDist, resultOut);
+}
+
+void	btPolyhedralContactClipping::clipFaceAgainstHull(const btVector3& separatingNormal, const btConvexPolyhedron& hullA,  const btTransform& transA, btVertexArray& worldVertsB1, btVertexArray& worldVertsB2, const btScalar minDist, btScalar maxDist,btDiscreteCollisionDetectorInterface::Result& resultOut)
+{
 	btVertexArray* pVtxIn = &worldVertsB1;
 	btVertexArray* pVtxOut = &worldVertsB2;
+	pVtxOut->resize(0);
 	pVtxOut->reserve(pVtxIn->size());
 
 	int closestFaceA=-1;
@@ -440,14 +689,14 @@ void	btPolyhedralContactClipping::clipFaceAgainstHull(const btVector3& separatin
 	const btFace& polyA = hullA.m_faces[closestFaceA];
 
 		// clip polygon to back of planes of all faces of hull A that are adjacent to witness face
+	const btVector3 worldPlaneAnormal1 = transA.getBasis()* btVector3(polyA.m_plane[0],polyA.m_plane[1],polyA.m_plane[2]);
 	int numVerticesA = polyA.m_indices.size();
 	for(int e0=0;e0<numVerticesA;e0++)
 	{
 		const btVector3& a = hullA.m_vertices[polyA.m_indices[e0]];
-		const btVector3& b = hullA.m_vertices[polyA.m_indices[(e0+1)%numVerticesA]];
+		const btVector3& b = hullA.m_vertices[polyA.m_indices[e0+1<numVerticesA ? e0+1 : 0]];
 		const btVector3 edge0 = a - b;
 		const btVector3 WorldEdge0 = transA.getBasis() * edge0;
-		btVector3 worldPlaneAnormal1 = transA.getBasis()* btVector3(polyA.m_plane[0],polyA.m_plane[1],polyA.m_plane[2]);
 
 		btVector3 planeNormalWS1 = -WorldEdge0.cross(worldPlaneAnormal1);//.cross(WorldEdge0);
 		btVector3 worldA1 = transA*a;
@@ -528,6 +777,13 @@ void	btPolyhedralContactClipping::clipFaceAgainstHull(const btVector3& separatin
 
 
 void	btPolyhedralContactClipping::clipHullAgainstHull(const btVector3& separatingNormal1, const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, const btScalar minDist, btScalar maxDist,btDiscreteCollisionDetectorInterface::Result& resultOut)
+{
+	btVertexArray worldVertsB1;
+	btVertexArray worldVertsB2;
+	clipHullAgainstHull(separatingNormal1, hullA, hullB, transA, transB, minDist, maxDist, worldVertsB1, worldVertsB2, resultOut);
+}
+
+void	btPolyhedralContactClipping::clipHullAgainstHull(const btVector3& separatingNormal1, const btConvexPolyhedron& hullA, const btConvexPolyhedron& hullB, const btTransform& transA,const btTransform& transB, const btScalar minDist, btScalar maxDist, btVertexArray& worldVertsB1, btVertexArray& worldVertsB2, btDiscreteCollisionDetectorInterface::Result& resultOut)
 {
 
 	btVector3 separatingNormal = separatingNormal1.normalized();
@@ -552,19 +808,20 @@ void	btPolyhedralContactClipping::clipHullAgainstHull(const btVector3& separatin
 			}
 		}
 	}
-				btVertexArray worldVertsB1;
-				{
-					const btFace& polyB = hullB.m_faces[closestFaceB];
-					const int numVertices = polyB.m_indices.size();
-					for(int e0=0;e0<numVertices;e0++)
-					{
-						const btVector3& b = hullB.m_vertices[polyB.m_indices[e0]];
-						worldVertsB1.push_back(transB*b);
-					}
-				}
+	if (closestFaceB<0)
+		return;
 
-	
-	if (closestFaceB>=0)
-		clipFaceAgainstHull(separatingNormal, hullA, transA,worldVertsB1, minDist, maxDist,resultOut);
+	worldVertsB1.resize(0);
+	{
+		const btFace& polyB = hullB.m_faces[closestFaceB];
+		const int numVertices = polyB.m_indices.size();
+		for(int e0=0;e0<numVertices;e0++)
+		{
+			const btVector3& b = hullB.m_vertices[polyB.m_indices[e0]];
+			worldVertsB1.push_back(transB*b);
+		}
+	}
+
+	clipFaceAgainstHull(separatingNormal, hullA, transA,worldVertsB1, worldVertsB2, minDist, maxDist,resultOut);
 
 }
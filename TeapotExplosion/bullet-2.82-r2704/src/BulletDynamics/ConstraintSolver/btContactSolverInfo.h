@@ -29,7 +29,10 @@ enum	btSolverMode
 	SOLVER_CACHE_FRIENDLY = 128,
 	SOLVER_SIMD = 256,
 	SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS = 512,
-	SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024
+	SOLVER_ALLOW_ZERO_LENGTH_FRICTION_DIRECTIONS = 1024,
+	///colors the contact and friction rows into batches without a shared dynamic body and solves each batch with btParallelFor,
+	///ignored together with SOLVER_RANDMIZE_ORDER
+	SOLVER_PARALLEL_BATCHES = 2048
 };
 
 struct btContactSolverInfoData
@@ -31,14 +31,17 @@ subject to the following restrictions:
 //#include "btSolverBody.h"
 //#include "btSolverConstraint.h"
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
 #include <string.h> //for memset
+#include <atomic>
 
-int		gNumSplitImpulseRecoveries = 0;
+std::atomic<int>	gNumSplitImpulseRecoveries(0);
 
 #include "BulletDynamics/Dynamics/btRigidBody.h"
 
 btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
-:m_btSeed2(0)
+:m_useParallelBatches(false),
+m_btSeed2(0)
 {
 
 }
@@ -183,7 +186,6 @@ void	btSequentialImpulseConstraintSolver::resolveSplitPenetrationImpulseCacheFri
 {
 		if (c.m_rhsPenetration)
         {
-			gNumSplitImpulseRecoveries++;
 			btScalar deltaImpulse = c.m_rhsPenetration-btScalar(c.m_appliedPushImpulse)*c.m_cfm;
 			const btScalar deltaVel1Dotn	=	c.m_contactNormal1.dot(body1.internalGetPushVelocity()) 	+ c.m_relpos1CrossNormal.dot(body1.internalGetTurnVelocity());
 			const btScalar deltaVel2Dotn	=	c.m_contactNormal2.dot(body2.internalGetPushVelocity())		+ c.m_relpos2CrossNormal.dot(body2.internalGetTurnVelocity());
@@ -211,8 +213,6 @@ void	btSequentialImpulseConstraintSolver::resolveSplitPenetrationImpulseCacheFri
 	if (!c.m_rhsPenetration)
 		return;
 
-	gNumSplitImpulseRecoveries++;
-
 	__m128 cpAppliedImp = _mm_set1_ps(c.m_appliedPushImpulse);
 	__m128	lowerLimit1 = _mm_set1_ps(c.m_lowerLimit);
 	__m128	upperLimit1 = _mm_set1_ps(c.m_upperLimit);
@@ -1327,11 +1327,243 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 		}
 	}
 
+	m_useParallelBatches = (infoGlobal.m_solverMode & SOLVER_PARALLEL_BATCHES) && !(infoGlobal.m_solverMode & SOLVER_RANDMIZE_ORDER);
+	if (m_useParallelBatches)
+	{
+		BT_PROFILE("buildParallelBatches");
+
+		int numSolverBodies = m_tmpSolverBodyPool.size();
+		m_batchBodyIsDynamic.resizeNoInitialize(numSolverBodies);
+		for (int i=0;i<numSolverBodies;i++)
+		{
+			btRigidBody* body = m_tmpSolverBodyPool[i].m_originalBody;
+			m_batchBodyIsDynamic[i] = body && body->getInvMass()!=btScalar(0);
+		}
+		if (m_batchZeroBodies.size()==0)
+		{
+			m_batchZeroBodies.resize(BT_MAX_THREAD_COUNT);
+			for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+			{
+				initSolverBody(&m_batchZeroBodies[i],0,infoGlobal.m_timeStep);
+			}
+		}
+
+		buildParallelBatches(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactBatchOffsets);
+
+		if ((infoGlobal.m_solverMode & SOLVER_SIMD) && (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS))
+		{
+			//the interleaved loop solves the friction rows at c*multiplier right after contact c, keep them together
+			int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS)? 2 : 1;
+			for (int c=0;c<numConstraintPool;c++)
+			{
+				int frictionIndex = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[c]].m_frictionIndex;
+				for (int k=0;k<multiplier;k++)
+				{
+					m_orderFrictionConstraintPool[c*multiplier+k] = frictionIndex+k;
+				}
+			}
+		} else
+		{
+			buildParallelBatches(m_tmpSolverContactFrictionConstraintPool,m_orderFrictionConstraintPool,m_frictionBatchOffsets);
+		}
+	}
+
 	return 0.f;
 
 }
 
 
+void	btSequentialImpulseConstraintSolver::buildParallelBatches(const btConstraintArray& rows, btAlignedObjectArray<int>& order, btAlignedObjectArray<int>& batchOffsets)
+{
+	int numRows = rows.size();
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	m_batchRowColors.resizeNoInitialize(numRows);
+	int i;
+	for (i=0;i<numRows;i++)
+	{
+		m_batchRowColors[i] = -1;
+	}
+
+	//greedy coloring in row order, a pass hands out 32 colors and the rows that found none wait for the next pass
+	int numColors = 0;
+	int numColoredRows = 0;
+	for (int firstColor=0;numColoredRows<numRows;firstColor+=32)
+	{
+		m_batchBodyColorMasks.resizeNoInitialize(numSolverBodies);
+		for (i=0;i<numSolverBodies;i++)
+		{
+			m_batchBodyColorMasks[i] = 0;
+		}
+		for (i=0;i<numRows;i++)
+		{
+			if (m_batchRowColors[i]>=0)
+				continue;
+			int bodyIdA = rows[i].m_solverBodyIdA;
+			int bodyIdB = rows[i].m_solverBodyIdB;
+			unsigned int usedColors = 0;
+			if (m_batchBodyIsDynamic[bodyIdA])
+				usedColors |= m_batchBodyColorMasks[bodyIdA];
+			if (m_batchBodyIsDynamic[bodyIdB])
+				usedColors |= m_batchBodyColorMasks[bodyIdB];
+			if (usedColors==0xffffffff)
+				continue;
+			int bit = 0;
+			while (usedColors & (1u<<bit))
+				bit++;
+			m_batchRowColors[i] = firstColor+bit;
+			numColors = btMax(numColors,firstColor+bit+1);
+			m_batchBodyColorMasks[bodyIdA] |= 1u<<bit;
+			m_batchBodyColorMasks[bodyIdB] |= 1u<<bit;
+			numColoredRows++;
+		}
+	}
+
+	sortParallelBatches(m_batchRowColors,numColors,order,batchOffsets);
+}
+
+void	btSequentialImpulseConstraintSolver::sortParallelBatches(const btAlignedObjectArray<int>& rowColors, int numColors, btAlignedObjectArray<int>& order, btAlignedObjectArray<int>& batchOffsets)
+{
+	//counting sort on color, rows keep their order within a batch
+	int numRows = rowColors.size();
+	int i;
+	batchOffsets.resize(numColors+1);
+	for (i=0;i<=numColors;i++)
+	{
+		batchOffsets[i] = 0;
+	}
+	for (i=0;i<numRows;i++)
+	{
+		batchOffsets[rowColors[i]+1]++;
+	}
+	for (i=0;i<numColors;i++)
+	{
+		batchOffsets[i+1] += batchOffsets[i];
+	}
+	m_batchBodyColorMasks.resizeNoInitialize(numColors);
+	for (i=0;i<numColors;i++)
+	{
+		m_batchBodyColorMasks[i] = batchOffsets[i];
+	}
+	for (i=0;i<numRows;i++)
+	{
+		order[m_batchBodyColorMasks[rowColors[i]]++] = i;
+	}
+}
+
+///rows of a batch per task
+#define BT_SOLVER_BATCH_GRAIN_SIZE 64
+
+class btSolverBatchLoop : public btIParallelForBody
+{
+	btSequentialImpulseConstraintSolver*	m_solver;
+	int										m_rowType;
+	const btContactSolverInfo&				m_infoGlobal;
+
+public:
+
+	btSolverBatchLoop(btSequentialImpulseConstraintSolver* solver, int rowType, const btContactSolverInfo& infoGlobal)
+	:m_solver(solver),
+	m_rowType(rowType),
+	m_infoGlobal(infoGlobal)
+	{
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		m_solver->solveBatchRows(m_rowType,m_infoGlobal,iBegin,iEnd);
+	}
+};
+
+void	btSequentialImpulseConstraintSolver::solveParallelBatches(int rowType, const btAlignedObjectArray<int>& batchOffsets, const btContactSolverInfo& infoGlobal)
+{
+	btSolverBatchLoop batchLoop(this,rowType,infoGlobal);
+	for (int b=0;b+1<batchOffsets.size();b++)
+	{
+		btParallelFor(batchOffsets[b],batchOffsets[b+1],BT_SOLVER_BATCH_GRAIN_SIZE,batchLoop);
+	}
+}
+
+void	btSequentialImpulseConstraintSolver::solveBatchRows(int rowType, const btContactSolverInfo& infoGlobal, int iBegin, int iEnd)
+{
+	btSolverBody& zeroBody = m_batchZeroBodies[btGetCurrentThreadIndex()];
+	int j;
+
+	switch (rowType)
+	{
+	case BT_BATCH_CONTACT_ROWS:
+		{
+			for (j=iBegin;j<iEnd;j++)
+			{
+				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
+				resolveSingleConstraintRowLowerLimit(getBatchSolverBody(solveManifold.m_solverBodyIdA,zeroBody),getBatchSolverBody(solveManifold.m_solverBodyIdB,zeroBody),solveManifold);
+			}
+			break;
+		}
+	case BT_BATCH_FRICTION_ROWS:
+		{
+			for (j=iBegin;j<iEnd;j++)
+			{
+				btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
+				btScalar totalImpulse = m_tmpSolverContactConstraintPool[solveManifold.m_frictionIndex].m_appliedImpulse;
+
+				if (totalImpulse>btScalar(0))
+				{
+					solveManifold.m_lowerLimit = -(solveManifold.m_friction*totalImpulse);
+					solveManifold.m_upperLimit = solveManifold.m_friction*totalImpulse;
+
+					resolveSingleConstraintRowGeneric(getBatchSolverBody(solveManifold.m_solverBodyIdA,zeroBody),getBatchSolverBody(solveManifold.m_solverBodyIdB,zeroBody),solveManifold);
+				}
+			}
+			break;
+		}
+	case BT_BATCH_INTERLEAVED_ROWS:
+		{
+			int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS)? 2 : 1;
+			for (int c=iBegin;c<iEnd;c++)
+			{
+				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[c]];
+				btSolverBody& bodyA = getBatchSolverBody(solveManifold.m_solverBodyIdA,zeroBody);
+				btSolverBody& bodyB = getBatchSolverBody(solveManifold.m_solverBodyIdB,zeroBody);
+				resolveSingleConstraintRowLowerLimitSIMD(bodyA,bodyB,solveManifold);
+				btScalar totalImpulse = solveManifold.m_appliedImpulse;
+
+				for (int k=0;k<multiplier;k++)
+				{
+					btSolverConstraint& frictionConstraint = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[c*multiplier+k]];
+					if (totalImpulse>btScalar(0))
+					{
+						frictionConstraint.m_lowerLimit = -(frictionConstraint.m_friction*totalImpulse);
+						frictionConstraint.m_upperLimit = frictionConstraint.m_friction*totalImpulse;
+
+						resolveSingleConstraintRowGenericSIMD(bodyA,bodyB,frictionConstraint);
+					}
+				}
+			}
+			break;
+		}
+	case BT_BATCH_SPLIT_PENETRATION_ROWS:
+		{
+			for (j=iBegin;j<iEnd;j++)
+			{
+				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
+				resolveSplitPenetrationImpulseCacheFriendly(getBatchSolverBody(solveManifold.m_solverBodyIdA,zeroBody),getBatchSolverBody(solveManifold.m_solverBodyIdB,zeroBody),solveManifold);
+			}
+			break;
+		}
+	case BT_BATCH_SPLIT_PENETRATION_ROWS_SIMD:
+		{
+			for (j=iBegin;j<iEnd;j++)
+			{
+				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
+				resolveSplitPenetrationSIMD(getBatchSolverBody(solveManifold.m_solverBodyIdA,zeroBody),getBatchSolverBody(solveManifold.m_solverBodyIdB,zeroBody),solveManifold);
+			}
+			break;
+		}
+	default:
+		btAssert(0);
+	}
+}
+
 btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration, btCollisionObject** /*bodies */,int /*numBodies*/,btPersistentManifold** /*manifoldPtr*/, int /*numManifolds*/,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* /*debugDrawer*/)
 {
 
@@ -1396,7 +1628,11 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 			}
 
 			///solve all contact constraints using SIMD, if available
-			if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
+			if (m_useParallelBatches && (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS))
+			{
+				solveParallelBatches(BT_BATCH_INTERLEAVED_ROWS,m_contactBatchOffsets,infoGlobal);
+			}
+			else if (infoGlobal.m_solverMode & SOLVER_INTERLEAVE_CONTACT_AND_FRICTION_CONSTRAINTS)
 			{
 				int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
 				int multiplier = (infoGlobal.m_solverMode & SOLVER_USE_2_FRICTION_DIRECTIONS)? 2 : 1;
@@ -1449,6 +1685,11 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 				int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
 				int j;
 
+				if (m_useParallelBatches)
+				{
+					solveParallelBatches(BT_BATCH_CONTACT_ROWS,m_contactBatchOffsets,infoGlobal);
+					numPoolConstraints = 0;
+				}
 				for (j=0;j<numPoolConstraints;j++)
 				{
 					const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
@@ -1462,6 +1703,11 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 				///solve all friction constraints, using SIMD, if available
 
 				int numFrictionPoolConstraints = m_tmpSolverContactFrictionConstraintPool.size();
+				if (m_useParallelBatches)
+				{
+					solveParallelBatches(BT_BATCH_FRICTION_ROWS,m_frictionBatchOffsets,infoGlobal);
+					numFrictionPoolConstraints = 0;
+				}
 				for (j=0;j<numFrictionPoolConstraints;j++)
 				{
 					btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
@@ -1526,6 +1772,11 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 			}
 			///solve all contact constraints
 			int numPoolConstraints = m_tmpSolverContactConstraintPool.size();
+			if (m_useParallelBatches)
+			{
+				solveParallelBatches(BT_BATCH_CONTACT_ROWS,m_contactBatchOffsets,infoGlobal);
+				numPoolConstraints = 0;
+			}
 			for (int j=0;j<numPoolConstraints;j++)
 			{
 				const btSolverConstraint& solveManifold = m_tmpSolverContactConstraintPool[m_orderTmpConstraintPool[j]];
@@ -1533,6 +1784,11 @@ btScalar btSequentialImpulseConstraintSolver::solveSingleIteration(int iteration
 			}
 			///solve all friction constraints
 			int numFrictionPoolConstraints = m_tmpSolverContactFrictionConstraintPool.size();
+			if (m_useParallelBatches)
+			{
+				solveParallelBatches(BT_BATCH_FRICTION_ROWS,m_frictionBatchOffsets,infoGlobal);
+				numFrictionPoolConstraints = 0;
+			}
 			for (int j=0;j<numFrictionPoolConstraints;j++)
 			{
 				btSolverConstraint& solveManifold = m_tmpSolverContactFrictionConstraintPool[m_orderFrictionConstraintPool[j]];
@@ -1575,7 +1831,27 @@ void btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySplitImpulseIte
 	int iteration;
 	if (infoGlobal.m_splitImpulse)
 	{
-		if (infoGlobal.m_solverMode & SOLVER_SIMD)
+		//counted here instead of per row, islands and batches are solved on several threads at once
+		int numRecoveries = 0;
+		for (int j=0;j<m_tmpSolverContactConstraintPool.size();j++)
+		{
+			if (m_tmpSolverContactConstraintPool[j].m_rhsPenetration)
+				numRecoveries++;
+		}
+		if (numRecoveries)
+		{
+			gNumSplitImpulseRecoveries.fetch_add(numRecoveries*infoGlobal.m_numIterations,std::memory_order_relaxed);
+		}
+
+		if (m_useParallelBatches)
+		{
+			int rowType = (infoGlobal.m_solverMode & SOLVER_SIMD) ? BT_BATCH_SPLIT_PENETRATION_ROWS_SIMD : BT_BATCH_SPLIT_PENETRATION_ROWS;
+			for ( iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
+			{
+				solveParallelBatches(rowType,m_contactBatchOffsets,infoGlobal);
+			}
+		}
+		else if (infoGlobal.m_solverMode & SOLVER_SIMD)
 		{
 			for ( iteration = 0;iteration<infoGlobal.m_numIterations;iteration++)
 			{
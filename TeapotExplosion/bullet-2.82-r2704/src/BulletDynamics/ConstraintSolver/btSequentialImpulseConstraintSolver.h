@@ -43,6 +43,17 @@ protected:
 	btAlignedObjectArray<btTypedConstraint::btConstraintInfo1> m_tmpConstraintSizesPool;
 	int							m_maxOverrideNumSolverIterations;
 	int m_fixedBodyId;
+
+	///SOLVER_PARALLEL_BATCHES: batch i holds the rows at positions m_contactBatchOffsets[i] to m_contactBatchOffsets[i+1]-1
+	///of m_orderTmpConstraintPool, and likewise for the friction rows, no two rows of a batch share a dynamic solver body
+	bool						m_useParallelBatches;
+	btAlignedObjectArray<int>	m_contactBatchOffsets;
+	btAlignedObjectArray<int>	m_frictionBatchOffsets;
+	btAlignedObjectArray<int>	m_batchRowColors;
+	btAlignedObjectArray<unsigned int>	m_batchBodyColorMasks;
+	btAlignedObjectArray<bool>	m_batchBodyIsDynamic;
+	///static and kinematic bodies are replaced by a zero body of the solving thread, so concurrent rows never write to them
+	btAlignedObjectArray<btSolverBody>	m_batchZeroBodies;
 	void setupFrictionConstraint(	btSolverConstraint& solverConstraint, const btVector3& normalAxis,int solverBodyIdA,int  solverBodyIdB,
 									btManifoldPoint& cp,const btVector3& rel_pos1,const btVector3& rel_pos2,
 									btCollisionObject* colObj0,btCollisionObject* colObj1, btScalar relaxation, 
@@ -95,6 +106,17 @@ protected:
 	void	resolveSingleConstraintRowLowerLimit(btSolverBody& bodyA,btSolverBody& bodyB,const btSolverConstraint& contactConstraint);
 	
 	void	resolveSingleConstraintRowLowerLimitSIMD(btSolverBody& bodyA,btSolverBody& bodyB,const btSolverConstraint& contactConstraint);
+
+	void	buildParallelBatches(const btConstraintArray& rows, btAlignedObjectArray<int>& order, btAlignedObjectArray<int>& batchOffsets);
+
+	void	sortParallelBatches(const btAlignedObjectArray<int>& rowColors, int numColors, btAlignedObjectArray<int>& order, btAlignedObjectArray<int>& batchOffsets);
+
+	void	solveParallelBatches(int rowType, const btAlignedObjectArray<int>& batchOffsets, const btContactSolverInfo& infoGlobal);
+
+	btSolverBody&	getBatchSolverBody(int solverBodyId, btSolverBody& zeroBody)
+	{
+		return m_batchBodyIsDynamic[solverBodyId] ? m_tmpSolverBodyPool[solverBodyId] : zeroBody;
+	}
 		
 protected:
 	
@@ -115,6 +137,18 @@ public:
 	virtual ~btSequentialImpulseConstraintSolver();
 
 	virtual btScalar solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& info, btIDebugDraw* debugDrawer,btDispatcher* dispatcher);
+
+	enum btBatchRowType
+	{
+		BT_BATCH_CONTACT_ROWS,
+		BT_BATCH_FRICTION_ROWS,
+		BT_BATCH_INTERLEAVED_ROWS,
+		BT_BATCH_SPLIT_PENETRATION_ROWS,
+		BT_BATCH_SPLIT_PENETRATION_ROWS_SIMD
+	};
+
+	///internal method of SOLVER_PARALLEL_BATCHES, solves the rows at positions iBegin to iEnd-1 of one batch
+	void	solveBatchRows(int rowType, const btContactSolverInfo& infoGlobal, int iBegin, int iEnd);
 	
 
 	
@@ -0,0 +1,573 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btSoaConstraintSolver.h"
+#include "btContactSolverInfo.h"
+#include "btTypedConstraint.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+#include "LinearMath/btQuickprof.h"
+
+//btSoaLane holds one btScalar per lane, the functions below are the few operations the row kernel needs
+
+#if !defined(BT_USE_DOUBLE_PRECISION) && defined(__AVX__)
+
+#include <immintrin.h>
+
+typedef __m256 btSoaLane;
+
+static SIMD_FORCE_INLINE btSoaLane btSoaLoad(const btScalar* p)					{ return _mm256_loadu_ps(p); }
+static SIMD_FORCE_INLINE void btSoaStore(btScalar* p, btSoaLane a)				{ _mm256_storeu_ps(p,a); }
+static SIMD_FORCE_INLINE btSoaLane btSoaZero()									{ return _mm256_setzero_ps(); }
+static SIMD_FORCE_INLINE btSoaLane btSoaAdd(btSoaLane a, btSoaLane b)			{ return _mm256_add_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSub(btSoaLane a, btSoaLane b)			{ return _mm256_sub_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMul(btSoaLane a, btSoaLane b)			{ return _mm256_mul_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMin(btSoaLane a, btSoaLane b)			{ return _mm256_min_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMax(btSoaLane a, btSoaLane b)			{ return _mm256_max_ps(a,b); }
+///b in the lanes where a is positive, zero elsewhere
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectPositive(btSoaLane a, btSoaLane b)	{ return _mm256_and_ps(_mm256_cmp_ps(a,_mm256_setzero_ps(),_CMP_GT_OQ),b); }
+///b in the lanes where a is not zero, zero elsewhere
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectNonZero(btSoaLane a, btSoaLane b)	{ return _mm256_and_ps(_mm256_cmp_ps(a,_mm256_setzero_ps(),_CMP_NEQ_UQ),b); }
+
+//btVector3 entries are 16 byte aligned, a 4x4 transpose turns four of them into x, y and z lanes and back
+static SIMD_FORCE_INLINE void btSoaGather3(const btVector3* v, const int* ids, btSoaLane* out)
+{
+	__m128 lo0 = _mm_load_ps(v[ids[0]].m_floats), lo1 = _mm_load_ps(v[ids[1]].m_floats), lo2 = _mm_load_ps(v[ids[2]].m_floats), lo3 = _mm_load_ps(v[ids[3]].m_floats);
+	__m128 hi0 = _mm_load_ps(v[ids[4]].m_floats), hi1 = _mm_load_ps(v[ids[5]].m_floats), hi2 = _mm_load_ps(v[ids[6]].m_floats), hi3 = _mm_load_ps(v[ids[7]].m_floats);
+	_MM_TRANSPOSE4_PS(lo0,lo1,lo2,lo3);
+	_MM_TRANSPOSE4_PS(hi0,hi1,hi2,hi3);
+	out[0] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo0),hi0,1);
+	out[1] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo1),hi1,1);
+	out[2] = _mm256_insertf128_ps(_mm256_castps128_ps256(lo2),hi2,1);
+}
+
+static SIMD_FORCE_INLINE void btSoaScatter3(btVector3* v, const int* ids, const btSoaLane* in)
+{
+	__m128 lo0 = _mm256_castps256_ps128(in[0]), lo1 = _mm256_castps256_ps128(in[1]), lo2 = _mm256_castps256_ps128(in[2]), lo3 = _mm_setzero_ps();
+	__m128 hi0 = _mm256_extractf128_ps(in[0],1), hi1 = _mm256_extractf128_ps(in[1],1), hi2 = _mm256_extractf128_ps(in[2],1), hi3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(lo0,lo1,lo2,lo3);
+	_MM_TRANSPOSE4_PS(hi0,hi1,hi2,hi3);
+	_mm_store_ps(v[ids[0]].m_floats,lo0); _mm_store_ps(v[ids[1]].m_floats,lo1); _mm_store_ps(v[ids[2]].m_floats,lo2); _mm_store_ps(v[ids[3]].m_floats,lo3);
+	_mm_store_ps(v[ids[4]].m_floats,hi0); _mm_store_ps(v[ids[5]].m_floats,hi1); _mm_store_ps(v[ids[6]].m_floats,hi2); _mm_store_ps(v[ids[7]].m_floats,hi3);
+}
+
+#elif !defined(BT_USE_DOUBLE_PRECISION) && (defined(__SSE__) || defined(_M_X64))
+
+#include <xmmintrin.h>
+
+typedef __m128 btSoaLane;
+
+static SIMD_FORCE_INLINE btSoaLane btSoaLoad(const btScalar* p)					{ return _mm_load_ps(p); }
+static SIMD_FORCE_INLINE void btSoaStore(btScalar* p, btSoaLane a)				{ _mm_store_ps(p,a); }
+static SIMD_FORCE_INLINE btSoaLane btSoaZero()									{ return _mm_setzero_ps(); }
+static SIMD_FORCE_INLINE btSoaLane btSoaAdd(btSoaLane a, btSoaLane b)			{ return _mm_add_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSub(btSoaLane a, btSoaLane b)			{ return _mm_sub_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMul(btSoaLane a, btSoaLane b)			{ return _mm_mul_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMin(btSoaLane a, btSoaLane b)			{ return _mm_min_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMax(btSoaLane a, btSoaLane b)			{ return _mm_max_ps(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectPositive(btSoaLane a, btSoaLane b)	{ return _mm_and_ps(_mm_cmpgt_ps(a,_mm_setzero_ps()),b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectNonZero(btSoaLane a, btSoaLane b)	{ return _mm_and_ps(_mm_cmpneq_ps(a,_mm_setzero_ps()),b); }
+
+//btVector3 entries are 16 byte aligned, a 4x4 transpose turns four of them into x, y and z lanes and back
+static SIMD_FORCE_INLINE void btSoaGather3(const btVector3* v, const int* ids, btSoaLane* out)
+{
+	__m128 r0 = _mm_load_ps(v[ids[0]].m_floats), r1 = _mm_load_ps(v[ids[1]].m_floats), r2 = _mm_load_ps(v[ids[2]].m_floats), r3 = _mm_load_ps(v[ids[3]].m_floats);
+	_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+	out[0] = r0;
+	out[1] = r1;
+	out[2] = r2;
+}
+
+static SIMD_FORCE_INLINE void btSoaScatter3(btVector3* v, const int* ids, const btSoaLane* in)
+{
+	__m128 r0 = in[0], r1 = in[1], r2 = in[2], r3 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(r0,r1,r2,r3);
+	_mm_store_ps(v[ids[0]].m_floats,r0);
+	_mm_store_ps(v[ids[1]].m_floats,r1);
+	_mm_store_ps(v[ids[2]].m_floats,r2);
+	_mm_store_ps(v[ids[3]].m_floats,r3);
+}
+
+#elif !defined(BT_USE_DOUBLE_PRECISION) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+
+#include <arm_neon.h>
+
+typedef float32x4_t btSoaLane;
+
+static SIMD_FORCE_INLINE btSoaLane btSoaLoad(const btScalar* p)					{ return vld1q_f32(p); }
+static SIMD_FORCE_INLINE void btSoaStore(btScalar* p, btSoaLane a)				{ vst1q_f32(p,a); }
+static SIMD_FORCE_INLINE btSoaLane btSoaZero()									{ return vdupq_n_f32(0.f); }
+static SIMD_FORCE_INLINE btSoaLane btSoaAdd(btSoaLane a, btSoaLane b)			{ return vaddq_f32(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSub(btSoaLane a, btSoaLane b)			{ return vsubq_f32(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMul(btSoaLane a, btSoaLane b)			{ return vmulq_f32(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMin(btSoaLane a, btSoaLane b)			{ return vminq_f32(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaMax(btSoaLane a, btSoaLane b)			{ return vmaxq_f32(a,b); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectPositive(btSoaLane a, btSoaLane b)	{ return vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(a,vdupq_n_f32(0.f)),vreinterpretq_u32_f32(b))); }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectNonZero(btSoaLane a, btSoaLane b)	{ return vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(b),vceqq_f32(a,vdupq_n_f32(0.f)))); }
+
+static SIMD_FORCE_INLINE void btSoaTranspose4(float32x4_t& r0, float32x4_t& r1, float32x4_t& r2, float32x4_t& r3)
+{
+	float32x4x2_t t01 = vtrnq_f32(r0,r1);
+	float32x4x2_t t23 = vtrnq_f32(r2,r3);
+	r0 = vcombine_f32(vget_low_f32(t01.val[0]),vget_low_f32(t23.val[0]));
+	r1 = vcombine_f32(vget_low_f32(t01.val[1]),vget_low_f32(t23.val[1]));
+	r2 = vcombine_f32(vget_high_f32(t01.val[0]),vget_high_f32(t23.val[0]));
+	r3 = vcombine_f32(vget_high_f32(t01.val[1]),vget_high_f32(t23.val[1]));
+}
+
+//btVector3 entries are 16 byte aligned, a 4x4 transpose turns four of them into x, y and z lanes and back
+static SIMD_FORCE_INLINE void btSoaGather3(const btVector3* v, const int* ids, btSoaLane* out)
+{
+	float32x4_t r0 = vld1q_f32(v[ids[0]].m_floats), r1 = vld1q_f32(v[ids[1]].m_floats), r2 = vld1q_f32(v[ids[2]].m_floats), r3 = vld1q_f32(v[ids[3]].m_floats);
+	btSoaTranspose4(r0,r1,r2,r3);
+	out[0] = r0;
+	out[1] = r1;
+	out[2] = r2;
+}
+
+static SIMD_FORCE_INLINE void btSoaScatter3(btVector3* v, const int* ids, const btSoaLane* in)
+{
+	float32x4_t r0 = in[0], r1 = in[1], r2 = in[2], r3 = vdupq_n_f32(0.f);
+	btSoaTranspose4(r0,r1,r2,r3);
+	vst1q_f32(v[ids[0]].m_floats,r0);
+	vst1q_f32(v[ids[1]].m_floats,r1);
+	vst1q_f32(v[ids[2]].m_floats,r2);
+	vst1q_f32(v[ids[3]].m_floats,r3);
+}
+
+#else
+
+struct btSoaLane
+{
+	btScalar	m_lanes[BT_SOA_SOLVER_WIDTH];
+};
+
+static SIMD_FORCE_INLINE btSoaLane btSoaLoad(const btScalar* p)			{ btSoaLane r; for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) r.m_lanes[l] = p[l]; return r; }
+static SIMD_FORCE_INLINE void btSoaStore(btScalar* p, btSoaLane a)		{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) p[l] = a.m_lanes[l]; }
+static SIMD_FORCE_INLINE btSoaLane btSoaZero()							{ btSoaLane r; for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) r.m_lanes[l] = btScalar(0); return r; }
+static SIMD_FORCE_INLINE btSoaLane btSoaAdd(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) a.m_lanes[l] += b.m_lanes[l]; return a; }
+static SIMD_FORCE_INLINE btSoaLane btSoaSub(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) a.m_lanes[l] -= b.m_lanes[l]; return a; }
+static SIMD_FORCE_INLINE btSoaLane btSoaMul(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) a.m_lanes[l] *= b.m_lanes[l]; return a; }
+static SIMD_FORCE_INLINE btSoaLane btSoaMin(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) a.m_lanes[l] = btMin(a.m_lanes[l],b.m_lanes[l]); return a; }
+static SIMD_FORCE_INLINE btSoaLane btSoaMax(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) a.m_lanes[l] = btMax(a.m_lanes[l],b.m_lanes[l]); return a; }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectPositive(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) b.m_lanes[l] = a.m_lanes[l]>btScalar(0) ? b.m_lanes[l] : btScalar(0); return b; }
+static SIMD_FORCE_INLINE btSoaLane btSoaSelectNonZero(btSoaLane a, btSoaLane b)	{ for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++) b.m_lanes[l] = a.m_lanes[l]!=btScalar(0) ? b.m_lanes[l] : btScalar(0); return b; }
+
+static SIMD_FORCE_INLINE void btSoaGather3(const btVector3* v, const int* ids, btSoaLane* out)
+{
+	for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+	{
+		const btVector3& p = v[ids[l]];
+		out[0].m_lanes[l] = p.getX();
+		out[1].m_lanes[l] = p.getY();
+		out[2].m_lanes[l] = p.getZ();
+	}
+}
+
+static SIMD_FORCE_INLINE void btSoaScatter3(btVector3* v, const int* ids, const btSoaLane* in)
+{
+	for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+	{
+		v[ids[l]].setValue(in[0].m_lanes[l],in[1].m_lanes[l],in[2].m_lanes[l]);
+	}
+}
+
+#endif
+
+
+static SIMD_FORCE_INLINE btSoaLane btSoaDot3(const btScalar v[3][BT_SOA_SOLVER_WIDTH], const btSoaLane* w)
+{
+	return btSoaAdd(btSoaAdd(btSoaMul(btSoaLoad(v[0]),w[0]),btSoaMul(btSoaLoad(v[1]),w[1])),btSoaMul(btSoaLoad(v[2]),w[2]));
+}
+
+static SIMD_FORCE_INLINE void btSoaMadd3(btSoaLane* w, const btScalar v[3][BT_SOA_SOLVER_WIDTH], btSoaLane s)
+{
+	for (int k=0;k<3;k++)
+	{
+		w[k] = btSoaAdd(w[k],btSoaMul(btSoaLoad(v[k]),s));
+	}
+}
+
+enum btSoaRowType
+{
+	BT_SOA_CONTACT_ROWS,
+	BT_SOA_FRICTION_ROWS,
+	BT_SOA_SPLIT_PENETRATION_ROWS
+};
+
+///projected Gauss-Seidel step on every row of a group, the same math as resolveSingleConstraintRowGeneric,
+///resolveSingleConstraintRowLowerLimit and resolveSplitPenetrationImpulseCacheFriendly
+static void btSoaSolveRowGroups(int rowType, btSoaRowGroup* groups, int numGroups, const btSoaRowGroup* contactGroups, btVector3* linearDeltas, btVector3* angularDeltas)
+{
+	for (int g=0;g<numGroups;g++)
+	{
+		btSoaRowGroup& group = groups[g];
+
+		btSoaLane linearA[3], angularA[3], linearB[3], angularB[3];
+		btSoaGather3(linearDeltas,group.m_solverBodyIdA,linearA);
+		btSoaGather3(angularDeltas,group.m_solverBodyIdA,angularA);
+		btSoaGather3(linearDeltas,group.m_solverBodyIdB,linearB);
+		btSoaGather3(angularDeltas,group.m_solverBodyIdB,angularB);
+
+		btScalar* appliedPtr = (rowType==BT_SOA_SPLIT_PENETRATION_ROWS) ? group.m_appliedPushImpulse : group.m_appliedImpulse;
+		const btScalar* rhsPtr = (rowType==BT_SOA_SPLIT_PENETRATION_ROWS) ? group.m_rhsPenetration : group.m_rhs;
+
+		btSoaLane applied = btSoaLoad(appliedPtr);
+		btSoaLane deltaImpulse = btSoaSub(btSoaLoad(rhsPtr),btSoaMul(applied,btSoaLoad(group.m_cfm)));
+		btSoaLane deltaVel1Dotn = btSoaAdd(btSoaDot3(group.m_contactNormal1,linearA),btSoaDot3(group.m_relpos1CrossNormal,angularA));
+		btSoaLane deltaVel2Dotn = btSoaAdd(btSoaDot3(group.m_contactNormal2,linearB),btSoaDot3(group.m_relpos2CrossNormal,angularB));
+		btSoaLane jacDiagABInv = btSoaLoad(group.m_jacDiagABInv);
+		deltaImpulse = btSoaSub(deltaImpulse,btSoaMul(deltaVel1Dotn,jacDiagABInv));
+		deltaImpulse = btSoaSub(deltaImpulse,btSoaMul(deltaVel2Dotn,jacDiagABInv));
+
+		btSoaLane sum = btSoaAdd(applied,deltaImpulse);
+		switch (rowType)
+		{
+		case BT_SOA_CONTACT_ROWS:
+			{
+				sum = btSoaMin(btSoaMax(sum,btSoaLoad(group.m_lowerLimit)),btSoaLoad(group.m_upperLimit));
+				deltaImpulse = btSoaSub(sum,applied);
+				break;
+			}
+		case BT_SOA_FRICTION_ROWS:
+			{
+				//the limits follow the impulse of the contact, rows of a contact without impulse are skipped
+				ATTRIBUTE_ALIGNED16(btScalar totalImpulses[BT_SOA_SOLVER_WIDTH]);
+				for (int l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+				{
+					int contactLane = group.m_contactLane[l];
+					totalImpulses[l] = contactGroups[contactLane/BT_SOA_SOLVER_WIDTH].m_appliedImpulse[contactLane%BT_SOA_SOLVER_WIDTH];
+				}
+				btSoaLane totalImpulse = btSoaLoad(totalImpulses);
+				btSoaLane limit = btSoaMul(btSoaLoad(group.m_friction),totalImpulse);
+				sum = btSoaMin(btSoaMax(sum,btSoaSub(btSoaZero(),limit)),limit);
+				deltaImpulse = btSoaSelectPositive(totalImpulse,btSoaSub(sum,applied));
+				sum = btSoaAdd(applied,deltaImpulse);
+				break;
+			}
+		default:
+			{
+				//rows without penetration are skipped
+				sum = btSoaMax(sum,btSoaLoad(group.m_lowerLimit));
+				deltaImpulse = btSoaSelectNonZero(btSoaLoad(group.m_rhsPenetration),btSoaSub(sum,applied));
+				sum = btSoaAdd(applied,deltaImpulse);
+			}
+		}
+		btSoaStore(appliedPtr,sum);
+
+		btSoaMadd3(linearA,group.m_linearComponentA,deltaImpulse);
+		btSoaMadd3(angularA,group.m_angularComponentA,deltaImpulse);
+		btSoaMadd3(linearB,group.m_linearComponentB,deltaImpulse);
+		btSoaMadd3(angularB,group.m_angularComponentB,deltaImpulse);
+
+		//the lanes of a group never share a dynamic body, and static and kinematic lanes all write zero to the last entry
+		btSoaScatter3(linearDeltas,group.m_solverBodyIdA,linearA);
+		btSoaScatter3(angularDeltas,group.m_solverBodyIdA,angularA);
+		btSoaScatter3(linearDeltas,group.m_solverBodyIdB,linearB);
+		btSoaScatter3(angularDeltas,group.m_solverBodyIdB,angularB);
+	}
+}
+
+
+btSoaConstraintSolver::btSoaConstraintSolver()
+{
+}
+
+btSoaConstraintSolver::~btSoaConstraintSolver()
+{
+}
+
+void	btSoaConstraintSolver::packRowGroups(const btConstraintArray& rows, const btAlignedObjectArray<int>& order, const btAlignedObjectArray<int>& batchOffsets, btAlignedObjectArray<btSoaRowGroup>& groups, btAlignedObjectArray<int>& lanes, bool frictionRows)
+{
+	int zeroBodyId = m_tmpSolverBodyPool.size();
+	int numGroups = 0;
+	int b;
+	for (b=0;b+1<batchOffsets.size();b++)
+	{
+		numGroups += (batchOffsets[b+1]-batchOffsets[b]+BT_SOA_SOLVER_WIDTH-1)/BT_SOA_SOLVER_WIDTH;
+	}
+	groups.resizeNoInitialize(numGroups);
+	lanes.resizeNoInitialize(rows.size());
+
+	//a group never spans two colors, the tail of a color is padded with unused lanes
+	int g = 0;
+	for (b=0;b+1<batchOffsets.size();b++)
+	{
+		int l = 0;
+		for (int pos=batchOffsets[b];pos<batchOffsets[b+1];pos++)
+		{
+			lanes[order[pos]] = g*BT_SOA_SOLVER_WIDTH+l;
+			if (++l==BT_SOA_SOLVER_WIDTH)
+			{
+				l = 0;
+				g++;
+			}
+		}
+		if (l==0)
+			continue;
+		btSoaRowGroup& group = groups[g];
+		for (;l<BT_SOA_SOLVER_WIDTH;l++)
+		{
+			for (int k=0;k<3;k++)
+			{
+				group.m_contactNormal1[k][l] = group.m_relpos1CrossNormal[k][l] = btScalar(0);
+				group.m_contactNormal2[k][l] = group.m_relpos2CrossNormal[k][l] = btScalar(0);
+				group.m_linearComponentA[k][l] = group.m_angularComponentA[k][l] = btScalar(0);
+				group.m_linearComponentB[k][l] = group.m_angularComponentB[k][l] = btScalar(0);
+			}
+			group.m_rhs[l] = group.m_rhsPenetration[l] = group.m_cfm[l] = group.m_jacDiagABInv[l] = btScalar(0);
+			group.m_friction[l] = group.m_lowerLimit[l] = group.m_upperLimit[l] = btScalar(0);
+			group.m_appliedImpulse[l] = group.m_appliedPushImpulse[l] = btScalar(0);
+			group.m_solverBodyIdA[l] = group.m_solverBodyIdB[l] = zeroBodyId;
+			group.m_rowIndex[l] = -1;
+			group.m_contactLane[l] = 0;
+		}
+		g++;
+	}
+
+	//the rows are read in pool order, that is the order they were written in
+	for (int rowIndex=0;rowIndex<rows.size();rowIndex++)
+	{
+		const btSolverConstraint& row = rows[rowIndex];
+		btSoaRowGroup& group = groups[lanes[rowIndex]/BT_SOA_SOLVER_WIDTH];
+		int l = lanes[rowIndex]%BT_SOA_SOLVER_WIDTH;
+
+		int bodyIdA = row.m_solverBodyIdA;
+		int bodyIdB = row.m_solverBodyIdB;
+		const btSolverBody& bodyA = m_tmpSolverBodyPool[bodyIdA];
+		const btSolverBody& bodyB = m_tmpSolverBodyPool[bodyIdB];
+		//internalApplyImpulse scales by the linear and angular factors, and skips bodies without m_originalBody
+		btVector3 linearComponentA(0,0,0), angularComponentA(0,0,0), linearComponentB(0,0,0), angularComponentB(0,0,0);
+		if (m_batchBodyIsDynamic[bodyIdA])
+		{
+			linearComponentA = row.m_contactNormal1*bodyA.internalGetInvMass()*bodyA.m_linearFactor;
+			angularComponentA = row.m_angularComponentA*bodyA.m_angularFactor;
+		} else
+		{
+			bodyIdA = zeroBodyId;
+		}
+		if (m_batchBodyIsDynamic[bodyIdB])
+		{
+			linearComponentB = row.m_contactNormal2*bodyB.internalGetInvMass()*bodyB.m_linearFactor;
+			angularComponentB = row.m_angularComponentB*bodyB.m_angularFactor;
+		} else
+		{
+			bodyIdB = zeroBodyId;
+		}
+
+		for (int k=0;k<3;k++)
+		{
+			group.m_contactNormal1[k][l] = row.m_contactNormal1[k];
+			group.m_relpos1CrossNormal[k][l] = row.m_relpos1CrossNormal[k];
+			group.m_contactNormal2[k][l] = row.m_contactNormal2[k];
+			group.m_relpos2CrossNormal[k][l] = row.m_relpos2CrossNormal[k];
+			group.m_linearComponentA[k][l] = linearComponentA[k];
+			group.m_angularComponentA[k][l] = angularComponentA[k];
+			group.m_linearComponentB[k][l] = linearComponentB[k];
+			group.m_angularComponentB[k][l] = angularComponentB[k];
+		}
+		group.m_rhs[l] = row.m_rhs;
+		group.m_rhsPenetration[l] = row.m_rhsPenetration;
+		group.m_cfm[l] = row.m_cfm;
+		group.m_jacDiagABInv[l] = row.m_jacDiagABInv;
+		group.m_friction[l] = row.m_friction;
+		group.m_lowerLimit[l] = row.m_lowerLimit;
+		group.m_upperLimit[l] = row.m_upperLimit;
+		group.m_appliedImpulse[l] = row.m_appliedImpulse;
+		group.m_appliedPushImpulse[l] = row.m_appliedPushImpulse;
+		group.m_solverBodyIdA[l] = bodyIdA;
+		group.m_solverBodyIdB[l] = bodyIdB;
+		group.m_rowIndex[l] = rowIndex;
+		group.m_contactLane[l] = frictionRows ? m_contactLanes[row.m_frictionIndex] : 0;
+	}
+}
+
+btScalar btSoaConstraintSolver::solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
+{
+	btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(bodies,numBodies,manifoldPtr,numManifolds,constraints,numConstraints,infoGlobal,debugDrawer);
+
+	BT_PROFILE("packRowGroups");
+
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	m_batchBodyIsDynamic.resizeNoInitialize(numSolverBodies);
+	for (int i=0;i<numSolverBodies;i++)
+	{
+		btRigidBody* body = m_tmpSolverBodyPool[i].m_originalBody;
+		m_batchBodyIsDynamic[i] = body && body->getInvMass()!=btScalar(0);
+	}
+
+	buildParallelBatches(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactBatchOffsets);
+
+	//a friction row has the bodies of its contact, so it takes the color of its contact, one set of colors per friction direction
+	int numContactColors = m_contactBatchOffsets.size()-1;
+	int numFrictionColors = 0;
+	int numFrictionRows = m_tmpSolverContactFrictionConstraintPool.size();
+	m_frictionRowColors.resizeNoInitialize(numFrictionRows);
+	for (int i=0;i<numFrictionRows;i++)
+	{
+		int contactIndex = m_tmpSolverContactFrictionConstraintPool[i].m_frictionIndex;
+		int direction = i-m_tmpSolverContactConstraintPool[contactIndex].m_frictionIndex;
+		m_frictionRowColors[i] = m_batchRowColors[contactIndex]+direction*numContactColors;
+		numFrictionColors = btMax(numFrictionColors,m_frictionRowColors[i]+1);
+	}
+	sortParallelBatches(m_frictionRowColors,numFrictionColors,m_orderFrictionConstraintPool,m_frictionBatchOffsets);
+
+	packRowGroups(m_tmpSolverContactConstraintPool,m_orderTmpConstraintPool,m_contactBatchOffsets,m_contactGroups,m_contactLanes,false);
+	packRowGroups(m_tmpSolverContactFrictionConstraintPool,m_orderFrictionConstraintPool,m_frictionBatchOffsets,m_frictionGroups,m_frictionLanes,true);
+
+	m_soaLinearDeltas.resizeNoInitialize(numSolverBodies+1);
+	m_soaAngularDeltas.resizeNoInitialize(numSolverBodies+1);
+	return 0.f;
+}
+
+void	btSoaConstraintSolver::gatherDeltas(bool pushVelocities)
+{
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	for (int i=0;i<numSolverBodies;i++)
+	{
+		btSolverBody& body = m_tmpSolverBodyPool[i];
+		m_soaLinearDeltas[i] = pushVelocities ? body.internalGetPushVelocity() : body.internalGetDeltaLinearVelocity();
+		m_soaAngularDeltas[i] = pushVelocities ? body.internalGetTurnVelocity() : body.internalGetDeltaAngularVelocity();
+	}
+	m_soaLinearDeltas[numSolverBodies].setValue(0,0,0);
+	m_soaAngularDeltas[numSolverBodies].setValue(0,0,0);
+}
+
+void	btSoaConstraintSolver::scatterDeltas(bool pushVelocities)
+{
+	int numSolverBodies = m_tmpSolverBodyPool.size();
+	for (int i=0;i<numSolverBodies;i++)
+	{
+		if (!m_batchBodyIsDynamic[i])
+			continue;
+		btSolverBody& body = m_tmpSolverBodyPool[i];
+		if (pushVelocities)
+		{
+			body.internalGetPushVelocity() = m_soaLinearDeltas[i];
+			body.internalGetTurnVelocity() = m_soaAngularDeltas[i];
+		} else
+		{
+			body.internalGetDeltaLinearVelocity() = m_soaLinearDeltas[i];
+			body.internalGetDeltaAngularVelocity() = m_soaAngularDeltas[i];
+		}
+	}
+}
+
+void	btSoaConstraintSolver::writeAppliedImpulses()
+{
+	int g, l;
+	for (g=0;g<m_contactGroups.size();g++)
+	{
+		const btSoaRowGroup& group = m_contactGroups[g];
+		for (l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+		{
+			if (group.m_rowIndex[l]>=0)
+			{
+				btSolverConstraint& row = m_tmpSolverContactConstraintPool[group.m_rowIndex[l]];
+				row.m_appliedImpulse = group.m_appliedImpulse[l];
+				row.m_appliedPushImpulse = group.m_appliedPushImpulse[l];
+			}
+		}
+	}
+	for (g=0;g<m_frictionGroups.size();g++)
+	{
+		const btSoaRowGroup& group = m_frictionGroups[g];
+		for (l=0;l<BT_SOA_SOLVER_WIDTH;l++)
+		{
+			if (group.m_rowIndex[l]>=0)
+			{
+				m_tmpSolverContactFrictionConstraintPool[group.m_rowIndex[l]].m_appliedImpulse = group.m_appliedImpulse[l];
+			}
+		}
+	}
+}
+
+btScalar btSoaConstraintSolver::solveGroupCacheFriendlyIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer)
+{
+	BT_PROFILE("solveGroupCacheFriendlyIterations");
+
+	btSoaRowGroup* contactGroups = m_contactGroups.size() ? &m_contactGroups[0] : 0;
+	btSoaRowGroup* frictionGroups = m_frictionGroups.size() ? &m_frictionGroups[0] : 0;
+	int iteration;
+
+	if (infoGlobal.m_splitImpulse)
+	{
+		gatherDeltas(true);
+		for (iteration=0;iteration<infoGlobal.m_numIterations;iteration++)
+		{
+			btSoaSolveRowGroups(BT_SOA_SPLIT_PENETRATION_ROWS,contactGroups,m_contactGroups.size(),contactGroups,&m_soaLinearDeltas[0],&m_soaAngularDeltas[0]);
+		}
+		scatterDeltas(true);
+	}
+
+	int numNonContactPool = m_tmpSolverNonContactConstraintPool.size();
+	int numRollingFrictionPool = m_tmpSolverContactRollingFrictionConstraintPool.size();
+	int maxIterations = m_maxOverrideNumSolverIterations > infoGlobal.m_numIterations? m_maxOverrideNumSolverIterations : infoGlobal.m_numIterations;
+
+	for (iteration=0;iteration<maxIterations;iteration++)
+	{
+		int j;
+		for (j=0;j<numNonContactPool;j++)
+		{
+			btSolverConstraint& constraint = m_tmpSolverNonContactConstraintPool[m_orderNonContactConstraintPool[j]];
+			if (iteration < constraint.m_overrideNumSolverIterations)
+				resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[constraint.m_solverBodyIdA],m_tmpSolverBodyPool[constraint.m_solverBodyIdB],constraint);
+		}
+
+		if (iteration>=infoGlobal.m_numIterations)
+			continue;
+
+		for (j=0;j<numConstraints;j++)
+		{
+			if (constraints[j]->isEnabled())
+			{
+				int bodyAid = getOrInitSolverBody(constraints[j]->getRigidBodyA(),infoGlobal.m_timeStep);
+				int bodyBid = getOrInitSolverBody(constraints[j]->getRigidBodyB(),infoGlobal.m_timeStep);
+				btSolverBody& bodyA = m_tmpSolverBodyPool[bodyAid];
+				btSolverBody& bodyB = m_tmpSolverBodyPool[bodyBid];
+				constraints[j]->solveConstraintObsolete(bodyA,bodyB,infoGlobal.m_timeStep);
+			}
+		}
+
+		gatherDeltas(false);
+		btSoaSolveRowGroups(BT_SOA_CONTACT_ROWS,contactGroups,m_contactGroups.size(),contactGroups,&m_soaLinearDeltas[0],&m_soaAngularDeltas[0]);
+		btSoaSolveRowGroups(BT_SOA_FRICTION_ROWS,frictionGroups,m_frictionGroups.size(),contactGroups,&m_soaLinearDeltas[0],&m_soaAngularDeltas[0]);
+		scatterDeltas(false);
+
+		if (numRollingFrictionPool)
+		{
+			writeAppliedImpulses();
+		}
+		for (j=0;j<numRollingFrictionPool;j++)
+		{
+			btSolverConstraint& rollingFrictionConstraint = m_tmpSolverContactRollingFrictionConstraintPool[j];
+			btScalar totalImpulse = m_tmpSolverContactConstraintPool[rollingFrictionConstraint.m_frictionIndex].m_appliedImpulse;
+			if (totalImpulse>btScalar(0))
+			{
+				btScalar rollingFrictionMagnitude = rollingFrictionConstraint.m_friction*totalImpulse;
+				if (rollingFrictionMagnitude>rollingFrictionConstraint.m_friction)
+					rollingFrictionMagnitude = rollingFrictionConstraint.m_friction;
+
+				rollingFrictionConstraint.m_lowerLimit = -rollingFrictionMagnitude;
+				rollingFrictionConstraint.m_upperLimit = rollingFrictionMagnitude;
+
+				resolveSingleConstraintRowGeneric(m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdA],m_tmpSolverBodyPool[rollingFrictionConstraint.m_solverBodyIdB],rollingFrictionConstraint);
+			}
+		}
+	}
+
+	writeAppliedImpulses();
+	return 0.f;
+}
@@ -0,0 +1,98 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SOA_CONSTRAINT_SOLVER_H
+#define BT_SOA_CONSTRAINT_SOLVER_H
+
+#include "btSequentialImpulseConstraintSolver.h"
+
+///rows solved at once by btSoaConstraintSolver, 8 with AVX, 4 with SSE, NEON or plain scalar code
+#if !defined(BT_USE_DOUBLE_PRECISION) && defined(__AVX__)
+#define BT_SOA_SOLVER_WIDTH 8
+#else
+#define BT_SOA_SOLVER_WIDTH 4
+#endif
+
+///btSoaRowGroup holds BT_SOA_SOLVER_WIDTH contact or friction rows in structure of arrays layout, one row per lane.
+///Unused lanes hold rows without mass that never change a velocity.
+ATTRIBUTE_ALIGNED16(struct) btSoaRowGroup
+{
+	btScalar	m_contactNormal1[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_relpos1CrossNormal[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_contactNormal2[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_relpos2CrossNormal[3][BT_SOA_SOLVER_WIDTH];
+	///velocity change of body A per unit impulse, zero for static and kinematic bodies
+	btScalar	m_linearComponentA[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_angularComponentA[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_linearComponentB[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_angularComponentB[3][BT_SOA_SOLVER_WIDTH];
+	btScalar	m_rhs[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_rhsPenetration[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_cfm[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_jacDiagABInv[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_friction[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_lowerLimit[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_upperLimit[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_appliedImpulse[BT_SOA_SOLVER_WIDTH];
+	btScalar	m_appliedPushImpulse[BT_SOA_SOLVER_WIDTH];
+	int			m_solverBodyIdA[BT_SOA_SOLVER_WIDTH];
+	int			m_solverBodyIdB[BT_SOA_SOLVER_WIDTH];
+	///index in the contact or friction pool, -1 for an unused lane
+	int			m_rowIndex[BT_SOA_SOLVER_WIDTH];
+	///friction rows: lane of their contact row, group*BT_SOA_SOLVER_WIDTH+lane
+	int			m_contactLane[BT_SOA_SOLVER_WIDTH];
+};
+
+///btSoaConstraintSolver is a btSequentialImpulseConstraintSolver that solves the contact and friction rows
+///BT_SOA_SOLVER_WIDTH at a time with SIMD instructions. The rows are colored like SOLVER_PARALLEL_BATCHES does it and
+///each color is packed into btSoaRowGroup lanes, so no two lanes of a group share a dynamic body and a group is
+///solved in one projected Gauss-Seidel step. The body velocity deltas are kept in a compact array during the iterations.
+///Joints and rolling friction use the btSequentialImpulseConstraintSolver rows, contacts are always solved before
+///friction and SOLVER_RANDMIZE_ORDER is ignored.
+ATTRIBUTE_ALIGNED16(class) btSoaConstraintSolver : public btSequentialImpulseConstraintSolver
+{
+protected:
+
+	btAlignedObjectArray<btSoaRowGroup>	m_contactGroups;
+	btAlignedObjectArray<btSoaRowGroup>	m_frictionGroups;
+	///lane of each row of m_tmpSolverContactConstraintPool and m_tmpSolverContactFrictionConstraintPool, group*BT_SOA_SOLVER_WIDTH+lane
+	btAlignedObjectArray<int>			m_contactLanes;
+	btAlignedObjectArray<int>			m_frictionLanes;
+	btAlignedObjectArray<int>			m_frictionRowColors;
+	///velocity or push velocity deltas of the solver bodies, the last entry stands in for all static and kinematic bodies
+	btAlignedObjectArray<btVector3>		m_soaLinearDeltas;
+	btAlignedObjectArray<btVector3>		m_soaAngularDeltas;
+
+	void	packRowGroups(const btConstraintArray& rows, const btAlignedObjectArray<int>& order, const btAlignedObjectArray<int>& batchOffsets, btAlignedObjectArray<btSoaRowGroup>& groups, btAlignedObjectArray<int>& lanes, bool frictionRows);
+	void	gatherDeltas(bool pushVelocities);
+	void	scatterDeltas(bool pushVelocities);
+	void	writeAppliedImpulses();
+
+	virtual btScalar solveGroupCacheFriendlySetup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
+	virtual btScalar solveGroupCacheFriendlyIterations(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifoldPtr, int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& infoGlobal,btIDebugDraw* debugDrawer);
+
+public:
+
+	btSoaConstraintSolver();
+
+	virtual ~btSoaConstraintSolver();
+
+	virtual btConstraintSolverType	getSolverType() const
+	{
+		return BT_SOA_SOLVER;
+	}
+};
+
+#endif //BT_SOA_CONSTRAINT_SOLVER_H
@@ -0,0 +1,320 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btDiscreteDynamicsWorldMt.h"
+
+#include "BulletCollision/CollisionDispatch/btSimulationIslandManager.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "BulletDynamics/ConstraintSolver/btSequentialImpulseConstraintSolver.h"
+#include "BulletDynamics/ConstraintSolver/btContactSolverInfo.h"
+#include "BulletDynamics/ConstraintSolver/btTypedConstraint.h"
+#include "LinearMath/btQuickprof.h"
+
+
+static SIMD_FORCE_INLINE int btGetConstraintIslandIdMt(const btTypedConstraint* lhs)
+{
+	const btCollisionObject& rcolObj0 = lhs->getRigidBodyA();
+	const btCollisionObject& rcolObj1 = lhs->getRigidBodyB();
+	return rcolObj0.getIslandTag()>=0?rcolObj0.getIslandTag():rcolObj1.getIslandTag();
+}
+
+class btSortConstraintOnIslandPredicateMt
+{
+	public:
+
+		bool operator() ( const btTypedConstraint* lhs, const btTypedConstraint* rhs ) const
+		{
+			return btGetConstraintIslandIdMt(lhs) < btGetConstraintIslandIdMt(rhs);
+		}
+};
+
+
+struct btIslandBatch
+{
+	int		m_firstBody;
+	int		m_numBodies;
+	int		m_firstManifold;
+	int		m_numManifolds;
+	int		m_firstConstraint;
+	int		m_numConstraints;
+	bool	m_touchesKinematic;
+};
+
+class btIslandBatchSortPredicate
+{
+	const btIslandBatch*	m_batches;
+
+	public:
+
+		btIslandBatchSortPredicate(const btIslandBatch* batches)
+		:m_batches(batches)
+		{
+		}
+
+		///larger batches first, so the last tasks of the parallel loop are short ones
+		bool operator() ( int lhs, int rhs ) const
+		{
+			int lhsCost = m_batches[lhs].m_numManifolds + m_batches[lhs].m_numConstraints;
+			int rhsCost = m_batches[rhs].m_numManifolds + m_batches[rhs].m_numConstraints;
+			return (lhsCost > rhsCost) || ((lhsCost == rhsCost) && (lhs < rhs));
+		}
+};
+
+
+///btIslandBatchCallback copies the islands into batches, the island manager reuses its body array between islands
+struct btIslandBatchCallback : public btSimulationIslandManager::IslandCallback
+{
+	btContactSolverInfo*	m_solverInfo;
+	btTypedConstraint**		m_sortedConstraints;
+	int						m_numConstraints;
+
+	btAlignedObjectArray<btCollisionObject*>	m_bodies;
+	btAlignedObjectArray<btPersistentManifold*>	m_manifolds;
+	btAlignedObjectArray<btTypedConstraint*>	m_constraints;
+
+	btAlignedObjectArray<btIslandBatch>	m_batches;
+	btAlignedObjectArray<int>			m_parallelBatches;
+	btAlignedObjectArray<int>			m_serialBatches;
+
+	btIslandBatch	m_openBatch;
+
+	btIslandBatchCallback()
+		:m_solverInfo(NULL),
+		m_sortedConstraints(NULL),
+		m_numConstraints(0)
+	{
+	}
+
+	void	openBatch()
+	{
+		m_openBatch.m_firstBody = m_bodies.size();
+		m_openBatch.m_numBodies = 0;
+		m_openBatch.m_firstManifold = m_manifolds.size();
+		m_openBatch.m_numManifolds = 0;
+		m_openBatch.m_firstConstraint = m_constraints.size();
+		m_openBatch.m_numConstraints = 0;
+		m_openBatch.m_touchesKinematic = false;
+	}
+
+	void	setup(btContactSolverInfo* solverInfo, btTypedConstraint** sortedConstraints, int numConstraints)
+	{
+		btAssert(solverInfo);
+		m_solverInfo = solverInfo;
+		m_sortedConstraints = sortedConstraints;
+		m_numConstraints = numConstraints;
+		m_bodies.resize(0);
+		m_manifolds.resize(0);
+		m_constraints.resize(0);
+		m_batches.resize(0);
+		m_parallelBatches.resize(0);
+		m_serialBatches.resize(0);
+		openBatch();
+	}
+
+	virtual	void	processIsland(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifolds,int numManifolds, int islandId)
+	{
+		btAssert(islandId>=0);
+
+		//the constraints are sorted on island, find the range of this island
+		int i = 0;
+		while (i<m_numConstraints && btGetConstraintIslandIdMt(m_sortedConstraints[i]) != islandId)
+		{
+			i++;
+		}
+		for (;i<m_numConstraints && btGetConstraintIslandIdMt(m_sortedConstraints[i]) == islandId;i++)
+		{
+			btTypedConstraint* constraint = m_sortedConstraints[i];
+			m_constraints.push_back(constraint);
+			if (constraint->getRigidBodyA().isKinematicObject() || constraint->getRigidBodyB().isKinematicObject())
+			{
+				m_openBatch.m_touchesKinematic = true;
+			}
+		}
+
+		for (i=0;i<numBodies;i++)
+		{
+			m_bodies.push_back(bodies[i]);
+		}
+		for (i=0;i<numManifolds;i++)
+		{
+			btPersistentManifold* manifold = manifolds[i];
+			m_manifolds.push_back(manifold);
+			if (manifold->getBody0()->isKinematicObject() || manifold->getBody1()->isKinematicObject())
+			{
+				m_openBatch.m_touchesKinematic = true;
+			}
+		}
+
+		m_openBatch.m_numBodies = m_bodies.size() - m_openBatch.m_firstBody;
+		m_openBatch.m_numManifolds = m_manifolds.size() - m_openBatch.m_firstManifold;
+		m_openBatch.m_numConstraints = m_constraints.size() - m_openBatch.m_firstConstraint;
+
+		//same rule as InplaceSolverIslandCallback, so the batches and the results match btDiscreteDynamicsWorld
+		if (m_solverInfo->m_minimumSolverBatchSize<=1 ||
+			(m_openBatch.m_numConstraints+m_openBatch.m_numManifolds)>m_solverInfo->m_minimumSolverBatchSize)
+		{
+			closeBatch();
+		}
+	}
+
+	void	closeBatch()
+	{
+		if (m_openBatch.m_numBodies || m_openBatch.m_numManifolds || m_openBatch.m_numConstraints)
+		{
+			if (m_openBatch.m_touchesKinematic)
+			{
+				m_serialBatches.push_back(m_batches.size());
+			} else
+			{
+				m_parallelBatches.push_back(m_batches.size());
+			}
+			m_batches.push_back(m_openBatch);
+		}
+		openBatch();
+	}
+};
+
+
+class btIslandBatchLoop : public btIParallelForBody
+{
+	btDiscreteDynamicsWorldMt*	m_world;
+	const int*					m_batchIndices;
+
+public:
+
+	btIslandBatchLoop(btDiscreteDynamicsWorldMt* world, const int* batchIndices)
+	:m_world(world),
+	m_batchIndices(batchIndices)
+	{
+	}
+
+	virtual void forLoop(int iBegin, int iEnd) const
+	{
+		for (int i=iBegin;i<iEnd;i++)
+		{
+			m_world->solveIslandBatch(m_batchIndices[i]);
+		}
+	}
+};
+
+
+btDiscreteDynamicsWorldMt::btDiscreteDynamicsWorldMt(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver, btCollisionConfiguration* collisionConfiguration)
+:btDiscreteDynamicsWorld(dispatcher,pairCache,constraintSolver,collisionConfiguration)
+{
+	void* mem = btAlignedAlloc(sizeof(btIslandBatchCallback),16);
+	m_islandBatchCallback = new (mem) btIslandBatchCallback();
+
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		m_islandSolvers[i] = 0;
+	}
+}
+
+btDiscreteDynamicsWorldMt::~btDiscreteDynamicsWorldMt()
+{
+	for (int i=0;i<BT_MAX_THREAD_COUNT;i++)
+	{
+		if (m_islandSolvers[i])
+		{
+			m_islandSolvers[i]->~btConstraintSolver();
+			btAlignedFree(m_islandSolvers[i]);
+		}
+	}
+
+	m_islandBatchCallback->~btIslandBatchCallback();
+	btAlignedFree(m_islandBatchCallback);
+}
+
+btConstraintSolver*	btDiscreteDynamicsWorldMt::createIslandSolver()
+{
+	btAssert(m_constraintSolver->getSolverType()==BT_SEQUENTIAL_IMPULSE_SOLVER);
+	void* mem = btAlignedAlloc(sizeof(btSequentialImpulseConstraintSolver),16);
+	btSequentialImpulseConstraintSolver* solver = new (mem) btSequentialImpulseConstraintSolver;
+	solver->setRandSeed(static_cast<btSequentialImpulseConstraintSolver*>(m_constraintSolver)->getRandSeed());
+	return solver;
+}
+
+btConstraintSolver*	btDiscreteDynamicsWorldMt::getIslandSolver()
+{
+	//only the calling thread uses its slot, so creating the solver here is safe
+	int threadIndex = btGetCurrentThreadIndex();
+	if (!m_islandSolvers[threadIndex])
+	{
+		m_islandSolvers[threadIndex] = createIslandSolver();
+	}
+	return m_islandSolvers[threadIndex];
+}
+
+void	btDiscreteDynamicsWorldMt::solveIslandBatch(int batchIndex)
+{
+	btIslandBatchCallback* callback = m_islandBatchCallback;
+	const btIslandBatch& batch = callback->m_batches[batchIndex];
+
+	btCollisionObject** bodies = batch.m_numBodies ? &callback->m_bodies[batch.m_firstBody] : 0;
+	btPersistentManifold** manifolds = batch.m_numManifolds ? &callback->m_manifolds[batch.m_firstManifold] : 0;
+	btTypedConstraint** constraints = batch.m_numConstraints ? &callback->m_constraints[batch.m_firstConstraint] : 0;
+
+	getIslandSolver()->solveGroup(bodies,batch.m_numBodies,manifolds,batch.m_numManifolds,constraints,batch.m_numConstraints,*callback->m_solverInfo,m_debugDrawer,m_dispatcher1);
+}
+
+void	btDiscreteDynamicsWorldMt::solveConstraints(btContactSolverInfo& solverInfo)
+{
+	if (m_constraintSolver->getSolverType()!=BT_SEQUENTIAL_IMPULSE_SOLVER ||
+		!m_islandManager->getSplitIslands() ||
+		(solverInfo.m_solverMode & SOLVER_RANDMIZE_ORDER))
+	{
+		btDiscreteDynamicsWorld::solveConstraints(solverInfo);
+		return;
+	}
+
+	BT_PROFILE("solveConstraints");
+
+	m_sortedConstraints.resize( m_constraints.size());
+	int i;
+	for (i=0;i<getNumConstraints();i++)
+	{
+		m_sortedConstraints[i] = m_constraints[i];
+	}
+	m_sortedConstraints.quickSort(btSortConstraintOnIslandPredicateMt());
+
+	btTypedConstraint** constraintsPtr = getNumConstraints() ? &m_sortedConstraints[0] : 0;
+
+	btIslandBatchCallback* callback = m_islandBatchCallback;
+	callback->setup(&solverInfo,constraintsPtr,m_sortedConstraints.size());
+	m_constraintSolver->prepareSolve(getNumCollisionObjects(), getDispatcher()->getNumManifolds());
+
+	m_islandManager->buildAndProcessIslands(getDispatcher(),this,callback);
+	callback->closeBatch();
+
+	{
+		BT_PROFILE("solveIslandBatches");
+		int numParallelBatches = callback->m_parallelBatches.size();
+		if (numParallelBatches)
+		{
+			callback->m_parallelBatches.quickSort(btIslandBatchSortPredicate(&callback->m_batches[0]));
+			btIslandBatchLoop batchLoop(this,&callback->m_parallelBatches[0]);
+			btParallelFor(0,numParallelBatches,1,batchLoop);
+		}
+
+		//in island order, kinematic bodies are written back by every batch that touches them
+		for (i=0;i<callback->m_serialBatches.size();i++)
+		{
+			solveIslandBatch(callback->m_serialBatches[i]);
+		}
+	}
+
+	m_constraintSolver->allSolved(solverInfo, m_debugDrawer);
+}
@@ -0,0 +1,67 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_DISCRETE_DYNAMICS_WORLD_MT_H
+#define BT_DISCRETE_DYNAMICS_WORLD_MT_H
+
+#include "btDiscreteDynamicsWorld.h"
+#include "LinearMath/btThreads.h"
+
+struct btIslandBatchCallback;
+
+
+///btDiscreteDynamicsWorldMt is a drop-in replacement for btDiscreteDynamicsWorld that solves the simulation islands
+///on the task scheduler set with btSetTaskScheduler.
+///Islands are merged into batches exactly like btDiscreteDynamicsWorld does it, until a batch holds more than
+///btContactSolverInfo::m_minimumSolverBatchSize manifolds and constraints, so a large island is a batch of its own and
+///small islands share one. The batches are solved by one solver per thread, made by createIslandSolver, and the
+///results are the same as those of btDiscreteDynamicsWorld for any number of threads. The constraint solver of the
+///world only prepares and finishes the solve, override createIslandSolver to solve islands with a subclass of
+///btSequentialImpulseConstraintSolver.
+///Kinematic bodies are shared by the islands they touch, so batches with a kinematic body are solved afterwards on
+///the calling thread. Worlds without split islands, with SOLVER_RANDMIZE_ORDER or with a constraint solver whose type
+///is not BT_SEQUENTIAL_IMPULSE_SOLVER are solved like btDiscreteDynamicsWorld does.
+ATTRIBUTE_ALIGNED16(class) btDiscreteDynamicsWorldMt : public btDiscreteDynamicsWorld
+{
+protected:
+
+	btIslandBatchCallback*	m_islandBatchCallback;
+
+	btConstraintSolver*		m_islandSolvers[BT_MAX_THREAD_COUNT];
+
+	virtual void	solveConstraints(btContactSolverInfo& solverInfo);
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	///this btDiscreteDynamicsWorldMt constructor gets created objects from the user, and will not delete those
+	btDiscreteDynamicsWorldMt(btDispatcher* dispatcher,btBroadphaseInterface* pairCache,btConstraintSolver* constraintSolver,btCollisionConfiguration* collisionConfiguration);
+
+	virtual ~btDiscreteDynamicsWorldMt();
+
+	///creates the island solver of a thread, a btSequentialImpulseConstraintSolver with the random seed of the constraint
+	///solver of the world. The world deletes it with btAlignedFree, allocate it with btAlignedAlloc
+	virtual btConstraintSolver*	createIslandSolver();
+
+	///the solver of the calling thread, created on first use
+	btConstraintSolver*	getIslandSolver();
+
+	///solves the batch with index batchIndex, called from several threads at once
+	void	solveIslandBatch(int batchIndex);
+};
+
+#endif //BT_DISCRETE_DYNAMICS_WORLD_MT_H
@@ -0,0 +1,222 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "TaskSchedulerThreadSupport.h"
+#include "LinearMath/btMinMax.h"
+
+#include <stdio.h>
+#include <mutex>
+#include <condition_variable>
+
+
+void TaskSchedulerThreadSupport::btSpuStatus::run()
+{
+	m_userThreadFunc(m_userPtr,m_lsMemory);
+	m_threadSupport->taskFinished(m_taskId);
+}
+
+
+TaskSchedulerThreadSupport::TaskSchedulerThreadSupport(const ThreadConstructionInfo& threadConstructionInfo)
+	:m_numTasks(0),
+	m_numOutstandingTasks(0)
+{
+	startThreads(threadConstructionInfo);
+}
+
+TaskSchedulerThreadSupport::~TaskSchedulerThreadSupport()
+{
+	stopSPU();
+}
+
+void TaskSchedulerThreadSupport::startThreads(const ThreadConstructionInfo& threadConstructionInfo)
+{
+	int numTasks = btMax(1,threadConstructionInfo.m_numThreads);
+	m_activeSpuStatus.resize(numTasks);
+	for (int i=0;i<numTasks;i++)
+	{
+		btSpuStatus& spuStatus = m_activeSpuStatus[i];
+		spuStatus.m_taskId = i;
+		spuStatus.m_commandId = 0;
+		spuStatus.m_status = 0;
+		spuStatus.m_userThreadFunc = threadConstructionInfo.m_userThreadFunc;
+		spuStatus.m_userPtr = 0;
+		spuStatus.m_lsMemory = threadConstructionInfo.m_lsMemoryFunc();
+		spuStatus.m_threadSupport = this;
+	}
+	setNumTasks(numTasks);
+
+	printf("%s: %d tasks for \"%s\" on the %s task scheduler\n", __FUNCTION__, m_numTasks,
+		threadConstructionInfo.m_uniqueName, m_taskGroup.getTaskScheduler()->getName());
+}
+
+void TaskSchedulerThreadSupport::taskFinished(int taskId)
+{
+	m_finishedTasksMutex.lock();
+	m_activeSpuStatus[taskId].m_status = 2;
+	m_finishedTasks.push_back(taskId);
+	m_finishedTasksMutex.unlock();
+}
+
+void TaskSchedulerThreadSupport::sendRequest(uint32_t uiCommand, ppu_address_t uiArgument0, uint32_t taskId)
+{
+	btAssert(taskId < (uint32_t)m_activeSpuStatus.size());
+
+	btSpuStatus& spuStatus = m_activeSpuStatus[taskId];
+	btAssert(spuStatus.m_status == 0);
+	spuStatus.m_commandId = uiCommand;
+	spuStatus.m_status = 1;
+	spuStatus.m_userPtr = (void*)uiArgument0;
+
+	m_numOutstandingTasks++;
+	m_taskGroup.run(spuStatus);
+}
+
+void TaskSchedulerThreadSupport::waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1)
+{
+	btAssert(m_numOutstandingTasks > 0);
+
+	//every task that left the group but was not reported yet is in m_finishedTasks
+	m_taskGroup.wait(m_numOutstandingTasks-1);
+
+	m_finishedTasksMutex.lock();
+	btAssert(m_finishedTasks.size());
+	int taskId = m_finishedTasks[m_finishedTasks.size()-1];
+	m_finishedTasks.pop_back();
+	m_finishedTasksMutex.unlock();
+	m_numOutstandingTasks--;
+
+	btSpuStatus& spuStatus = m_activeSpuStatus[taskId];
+	spuStatus.m_status = 0;
+
+	*puiArgument0 = spuStatus.m_taskId;
+	*puiArgument1 = spuStatus.m_status;
+}
+
+void TaskSchedulerThreadSupport::startSPU()
+{
+}
+
+void TaskSchedulerThreadSupport::stopSPU()
+{
+	m_taskGroup.wait();
+	for (int i=0;i<m_finishedTasks.size();i++)
+	{
+		m_activeSpuStatus[m_finishedTasks[i]].m_status = 0;
+	}
+	m_finishedTasks.resize(0);
+	m_numOutstandingTasks = 0;
+}
+
+void TaskSchedulerThreadSupport::setNumTasks(int numTasks)
+{
+	//tasks that wait for each other at a barrier each need a thread
+	int numThreads = m_taskGroup.getTaskScheduler()->getNumThreads();
+	m_numTasks = btMax(1,btMin(numTasks,btMin(numThreads,m_activeSpuStatus.size())));
+}
+
+
+class TaskSchedulerCriticalSection : public btCriticalSection
+{
+	btSpinMutex	m_mutex;
+
+public:
+
+	virtual unsigned int getSharedParam(int i)
+	{
+		return mCommonBuff[i];
+	}
+	virtual void setSharedParam(int i,unsigned int p)
+	{
+		mCommonBuff[i] = p;
+	}
+
+	virtual void lock()
+	{
+		m_mutex.lock();
+	}
+	virtual void unlock()
+	{
+		m_mutex.unlock();
+	}
+};
+
+class TaskSchedulerBarrier : public btBarrier
+{
+	std::mutex	m_mutex;
+	std::condition_variable	m_condition;
+	int	m_numThreads;
+	int	m_called;
+	unsigned int	m_generation;
+
+public:
+
+	TaskSchedulerBarrier()
+		:m_numThreads(0),
+		m_called(0),
+		m_generation(0)
+	{
+	}
+
+	virtual void sync()
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		unsigned int generation = m_generation;
+		if (++m_called == m_numThreads)
+		{
+			m_called = 0;
+			m_generation++;
+			m_condition.notify_all();
+		} else
+		{
+			while (generation == m_generation)
+			{
+				m_condition.wait(lock);
+			}
+		}
+	}
+	virtual void setMaxCount(int numThreads)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_numThreads = numThreads;
+		m_called = 0;
+	}
+	virtual int  getMaxCount()
+	{
+		return m_numThreads;
+	}
+};
+
+
+btBarrier* TaskSchedulerThreadSupport::createBarrier()
+{
+	TaskSchedulerBarrier* barrier = new TaskSchedulerBarrier();
+	barrier->setMaxCount(getNumTasks());
+	return barrier;
+}
+
+btCriticalSection* TaskSchedulerThreadSupport::createCriticalSection()
+{
+	return new TaskSchedulerCriticalSection();
+}
+
+void TaskSchedulerThreadSupport::deleteBarrier(btBarrier* barrier)
+{
+	delete barrier;
+}
+
+void TaskSchedulerThreadSupport::deleteCriticalSection(btCriticalSection* criticalSection)
+{
+	delete criticalSection;
+}
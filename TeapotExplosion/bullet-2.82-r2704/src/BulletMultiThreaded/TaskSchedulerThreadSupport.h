@@ -0,0 +1,121 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_TASK_SCHEDULER_THREAD_SUPPORT_H
+#define BT_TASK_SCHEDULER_THREAD_SUPPORT_H
+
+#include "LinearMath/btScalar.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btThreads.h"
+#include "PlatformDefinitions.h"
+
+#include "btThreadSupportInterface.h"
+
+typedef void (*TaskSchedulerThreadFunc)(void* userPtr,void* lsMemory);
+typedef void* (*TaskSchedulerlsMemorySetupFunc)();
+
+///TaskSchedulerThreadSupport runs the tasks of btParallelConstraintSolver, SpuGatheringCollisionDispatcher and other
+///btThreadSupportInterface users on the task scheduler set with btSetTaskScheduler, instead of a thread per task.
+///sendRequest queues the task in a btTaskGroup, waitForResponse runs queued work until a task has finished.
+///The tasks of btParallelConstraintSolver meet at barriers, so getNumTasks is limited to the number of scheduler threads.
+class TaskSchedulerThreadSupport : public btThreadSupportInterface
+{
+public:
+
+	struct	btSpuStatus : public btITask
+	{
+		uint32_t	m_taskId;
+		uint32_t	m_commandId;
+		uint32_t	m_status;
+
+		TaskSchedulerThreadFunc	m_userThreadFunc;
+		void*	m_userPtr; //for taskDesc etc
+		void*	m_lsMemory; //initialized using TaskSchedulerlsMemorySetupFunc
+
+		TaskSchedulerThreadSupport*	m_threadSupport;
+
+		virtual void run();
+	};
+
+	struct	ThreadConstructionInfo
+	{
+		ThreadConstructionInfo(const char* uniqueName,
+									TaskSchedulerThreadFunc userThreadFunc,
+									TaskSchedulerlsMemorySetupFunc	lsMemoryFunc,
+									int numThreads=1
+									)
+									:m_uniqueName(uniqueName),
+									m_userThreadFunc(userThreadFunc),
+									m_lsMemoryFunc(lsMemoryFunc),
+									m_numThreads(numThreads)
+		{
+		}
+
+		const char*						m_uniqueName;
+		TaskSchedulerThreadFunc			m_userThreadFunc;
+		TaskSchedulerlsMemorySetupFunc	m_lsMemoryFunc;
+		int								m_numThreads;
+	};
+
+private:
+
+	btAlignedObjectArray<btSpuStatus>	m_activeSpuStatus;
+	btTaskGroup							m_taskGroup;
+	int									m_numTasks;
+	int									m_numOutstandingTasks;
+
+	btSpinMutex							m_finishedTasksMutex;
+	btAlignedObjectArray<int>			m_finishedTasks;
+
+	void	taskFinished(int taskId);
+
+public:
+
+	TaskSchedulerThreadSupport(const ThreadConstructionInfo& threadConstructionInfo);
+
+	virtual	~TaskSchedulerThreadSupport();
+
+	void	startThreads(const ThreadConstructionInfo& threadConstructionInfo);
+
+	virtual	void sendRequest(uint32_t uiCommand, ppu_address_t uiArgument0, uint32_t uiArgument1);
+
+	virtual	void waitForResponse(unsigned int *puiArgument0, unsigned int *puiArgument1);
+
+	virtual	void startSPU();
+
+	virtual	void stopSPU();
+
+	virtual void setNumTasks(int numTasks);
+
+	virtual int getNumTasks() const
+	{
+		return m_numTasks;
+	}
+
+	virtual btBarrier* createBarrier();
+
+	virtual btCriticalSection* createCriticalSection();
+
+	virtual void deleteBarrier(btBarrier* barrier);
+
+	virtual void deleteCriticalSection(btCriticalSection* criticalSection);
+
+	virtual void*	getThreadLocalMemory(int taskId)
+	{
+		return m_activeSpuStatus[taskId].m_lsMemory;
+	}
+};
+
+#endif //BT_TASK_SCHEDULER_THREAD_SUPPORT_H
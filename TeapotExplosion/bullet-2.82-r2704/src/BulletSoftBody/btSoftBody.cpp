@@ -97,6 +97,7 @@ void	btSoftBody::initDefaults()
 	m_tag				=	0;
 	m_timeacc			=	0;
 	m_bUpdateRtCst		=	true;
+	m_useCompactDbvt	=	false;
 	m_bounds[0]			=	btVector3(0,0,0);
 	m_bounds[1]			=	btVector3(0,0,0);
 	m_worldTransform.setIdentity();
@@ -1841,6 +1842,12 @@ void			btSoftBody::predictMotion(btScalar dt)
 	m_ndbvt.optimizeIncremental(1);
 	m_fdbvt.optimizeIncremental(1);
 	m_cdbvt.optimizeIncremental(1);
+	/* Compact dbvt's		*/ 
+	if(m_useCompactDbvt)
+	{
+		m_ndbvtCompact.build(m_ndbvt);
+		m_fdbvtCompact.build(m_fdbvt);
+	}
 }
 
 //
@@ -3176,7 +3183,13 @@ void			btSoftBody::defaultCollisionHandler(const btCollisionObjectWrapper* pcoWr
 
 			docollide.dynmargin	=	basemargin+timemargin;
 			docollide.stamargin	=	basemargin;
-			m_ndbvt.collideTV(m_ndbvt.m_root,volume,docollide);
+			if(m_useCompactDbvt&&m_ndbvtCompact.isCurrent(m_ndbvt))
+			{
+				btDbvtCompactScratch<int>	scratch;
+				m_ndbvtCompact.collideTV(volume,scratch.stack(),docollide);
+			}
+			else
+				m_ndbvt.collideTV(m_ndbvt.m_root,volume,docollide);
 		}
 		break;
 	case	fCollision::CL_RS:
@@ -3188,6 +3201,22 @@ void			btSoftBody::defaultCollisionHandler(const btCollisionObjectWrapper* pcoWr
 	}
 }
 
+//
+static void		collideNodesFaces(btSoftBody* psbn,btSoftBody* psbf,btSoftColliders::CollideVF_SS& docollide)
+{
+	if(psbn->m_useCompactDbvt&&psbf->m_useCompactDbvt&&
+		psbn->m_ndbvtCompact.isCurrent(psbn->m_ndbvt)&&
+		psbf->m_fdbvtCompact.isCurrent(psbf->m_fdbvt))
+	{
+		btDbvtCompactScratch<btDbvtCompact::sStkRR>	scratch;
+		btDbvtCompact::collideTT(psbn->m_ndbvtCompact,psbf->m_fdbvtCompact,scratch.stack(),docollide);
+	}
+	else
+	{
+		psbn->m_ndbvt.collideTT(psbn->m_ndbvt.m_root,psbf->m_fdbvt.m_root,docollide);
+	}
+}
+
 //
 void			btSoftBody::defaultCollisionHandler(btSoftBody* psb)
 {
@@ -3218,15 +3247,11 @@ void			btSoftBody::defaultCollisionHandler(btSoftBody* psb)
 				/* psb0 nodes vs psb1 faces	*/ 
 				docollide.psb[0]=this;
 				docollide.psb[1]=psb;
-				docollide.psb[0]->m_ndbvt.collideTT(	docollide.psb[0]->m_ndbvt.m_root,
-					docollide.psb[1]->m_fdbvt.m_root,
-					docollide);
+				collideNodesFaces(docollide.psb[0],docollide.psb[1],docollide);
 				/* psb1 nodes vs psb0 faces	*/ 
 				docollide.psb[0]=psb;
 				docollide.psb[1]=this;
-				docollide.psb[0]->m_ndbvt.collideTT(	docollide.psb[0]->m_ndbvt.m_root,
-					docollide.psb[1]->m_fdbvt.m_root,
-					docollide);
+				collideNodesFaces(docollide.psb[0],docollide.psb[1],docollide);
 			}
 		}
 		break;
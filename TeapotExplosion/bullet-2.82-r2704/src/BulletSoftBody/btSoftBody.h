@@ -26,6 +26,7 @@ subject to the following restrictions:
 #include "BulletCollision/CollisionDispatch/btCollisionCreateFunc.h"
 #include "btSparseSDF.h"
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/BroadphaseCollision/btDbvtCompact.h"
 
 //#ifdef BT_USE_DOUBLE_PRECISION
 //#define btRigidBodyData	btRigidBodyDoubleData
@@ -666,6 +667,9 @@ public:
 	btDbvt					m_ndbvt;		// Nodes tree
 	btDbvt					m_fdbvt;		// Faces tree
 	btDbvt					m_cdbvt;		// Clusters tree
+	bool					m_useCompactDbvt;	// Collide through the compact copies of the nodes and faces trees
+	btDbvtCompact			m_ndbvtCompact;	// Nodes tree copy, rebuilt by predictMotion
+	btDbvtCompact			m_fdbvtCompact;	// Faces tree copy, rebuilt by predictMotion
 	tClusterArray			m_clusters;		// Clusters
 
 	btAlignedObjectArray<bool>m_clusterConnectivity;//cluster connectivity, for self-collision
@@ -279,6 +279,15 @@ void	btSoftRigidDynamicsWorld::rayTest(const btVector3& rayFromWorld, const btVe
 
 }
 
+void	btSoftRigidDynamicsWorld::rayTestBatchSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans, btCollisionObject* collisionObject, RayResultCallback& resultCallback) const
+{
+	rayTestSingle(rayFromTrans,rayToTrans,
+		collisionObject,
+		collisionObject->getCollisionShape(),
+		collisionObject->getWorldTransform(),
+		resultCallback);
+}
+
 
 void	btSoftRigidDynamicsWorld::rayTestSingle(const btTransform& rayFromTrans,const btTransform& rayToTrans,
 					  btCollisionObject* collisionObject,
@@ -122,6 +122,105 @@ SIMD_FORCE_INLINE bool btRayAabb2(const btVector3& rayFrom,
 	return ( (tmin < lambda_max) && (tmax > lambda_min) );
 }
 
+#if !defined(BT_USE_DOUBLE_PRECISION) && (defined(BT_USE_SSE) || defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define BT_USE_SSE_RAY_PACKET
+#endif
+
+///btRayPacket holds up to four rays for btRayAabbPacket, lane i has the rayFrom, rayInvDirection, raySign and lambda_max
+///arguments that btRayAabb2 would get for ray i
+ATTRIBUTE_ALIGNED16(struct) btRayPacket
+{
+	btScalar		m_rayFrom[3][4];
+	btScalar		m_rayInvDirection[3][4];
+	btScalar		m_lambdaMax[4];
+	unsigned int	m_raySign[3][4];
+	int				m_numRays;
+
+	void	setRay(int i,const btVector3& rayFrom,const btVector3& rayInvDirection,const unsigned int raySign[3],btScalar lambda_max)
+	{
+		for (int j=0;j<3;j++)
+		{
+			m_rayFrom[j][i] = rayFrom[j];
+			m_rayInvDirection[j][i] = rayInvDirection[j];
+			m_raySign[j][i] = raySign[j] ? ~0u : 0u;
+		}
+		m_lambdaMax[i] = lambda_max;
+	}
+
+	///call after setting rays 0..numRays-1, the unused lanes get copies of the last ray
+	void	setNumRays(int numRays)
+	{
+		btAssert(numRays>0 && numRays<=4);
+		m_numRays = numRays;
+		for (int i=numRays;i<4;i++)
+		{
+			for (int j=0;j<3;j++)
+			{
+				m_rayFrom[j][i] = m_rayFrom[j][numRays-1];
+				m_rayInvDirection[j][i] = m_rayInvDirection[j][numRays-1];
+				m_raySign[j][i] = m_raySign[j][numRays-1];
+			}
+			m_lambdaMax[i] = m_lambdaMax[numRays-1];
+		}
+	}
+};
+
+#ifdef BT_USE_SSE_RAY_PACKET
+///btRayAabbPacket with the box as (x,y,z,-) lanes, for callers that compute the box with SSE
+SIMD_FORCE_INLINE int btRayAabbPacket(const btRayPacket& packet,
+									  __m128 boundsMin,
+									  __m128 boundsMax,
+									  btScalar lambda_min)
+{
+	__m128 tnear[3];
+	__m128 tfar[3];
+	const __m128 lo[3] = {_mm_shuffle_ps(boundsMin,boundsMin,0x00),_mm_shuffle_ps(boundsMin,boundsMin,0x55),_mm_shuffle_ps(boundsMin,boundsMin,0xaa)};
+	const __m128 hi[3] = {_mm_shuffle_ps(boundsMax,boundsMax,0x00),_mm_shuffle_ps(boundsMax,boundsMax,0x55),_mm_shuffle_ps(boundsMax,boundsMax,0xaa)};
+	for (int j=0;j<3;j++)
+	{
+		const __m128 sign = _mm_castsi128_ps(_mm_load_si128((const __m128i*)packet.m_raySign[j]));
+		const __m128 from = _mm_load_ps(packet.m_rayFrom[j]);
+		const __m128 inv = _mm_load_ps(packet.m_rayInvDirection[j]);
+		tnear[j] = _mm_mul_ps(_mm_sub_ps(_mm_or_ps(_mm_and_ps(sign,hi[j]),_mm_andnot_ps(sign,lo[j])),from),inv);
+		tfar[j] = _mm_mul_ps(_mm_sub_ps(_mm_or_ps(_mm_and_ps(sign,lo[j]),_mm_andnot_ps(sign,hi[j])),from),inv);
+	}
+	__m128 tmin = tnear[0];
+	__m128 tmax = tfar[0];
+	__m128 miss = _mm_or_ps(_mm_cmpgt_ps(tmin,tfar[1]),_mm_cmpgt_ps(tnear[1],tmax));
+	tmin = _mm_max_ps(tnear[1],tmin);
+	tmax = _mm_min_ps(tfar[1],tmax);
+	miss = _mm_or_ps(miss,_mm_or_ps(_mm_cmpgt_ps(tmin,tfar[2]),_mm_cmpgt_ps(tnear[2],tmax)));
+	tmin = _mm_max_ps(tnear[2],tmin);
+	tmax = _mm_min_ps(tfar[2],tmax);
+	const __m128 hit = _mm_and_ps(_mm_cmplt_ps(tmin,_mm_load_ps(packet.m_lambdaMax)),_mm_cmpgt_ps(tmax,_mm_set1_ps(lambda_min)));
+	return _mm_movemask_ps(_mm_andnot_ps(miss,hit)) & ((1<<packet.m_numRays)-1);
+}
+#endif
+
+///btRayAabb2 for all rays of packet at once, bit i of the result is set when ray i hits the box.
+///The lanes do the same float operations in the same order, so each bit matches btRayAabb2 exactly.
+SIMD_FORCE_INLINE int btRayAabbPacket(const btRayPacket& packet,
+									  const btVector3 bounds[2],
+									  btScalar lambda_min)
+{
+#ifdef BT_USE_SSE_RAY_PACKET
+	return btRayAabbPacket(packet,_mm_setr_ps(bounds[0][0],bounds[0][1],bounds[0][2],0.f),_mm_setr_ps(bounds[1][0],bounds[1][1],bounds[1][2],0.f),lambda_min);
+#else
+	int mask = 0;
+	for (int i=0;i<packet.m_numRays;i++)
+	{
+		const btVector3 rayFrom(packet.m_rayFrom[0][i],packet.m_rayFrom[1][i],packet.m_rayFrom[2][i]);
+		const btVector3 rayInvDirection(packet.m_rayInvDirection[0][i],packet.m_rayInvDirection[1][i],packet.m_rayInvDirection[2][i]);
+		const unsigned int raySign[3] = {packet.m_raySign[0][i]&1,packet.m_raySign[1][i]&1,packet.m_raySign[2][i]&1};
+		btScalar tmin;
+		if (btRayAabb2(rayFrom,rayInvDirection,raySign,bounds,tmin,lambda_min,packet.m_lambdaMax[i]))
+			mask |= 1<<i;
+	}
+	return mask;
+#endif
+}
+
 SIMD_FORCE_INLINE bool btRayAabb(const btVector3& rayFrom, 
 								 const btVector3& rayTo, 
 								 const btVector3& aabbMin, 
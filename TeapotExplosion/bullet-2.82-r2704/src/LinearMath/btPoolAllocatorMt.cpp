@@ -0,0 +1,369 @@
+/*
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btPoolAllocatorMt.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+
+#include <atomic>
+#include <new>
+
+///elements moved between a thread cache and the global free list at a time
+#define BT_POOL_CACHE_BATCH 16
+
+//A free element holds the index of the next free element in an std::atomic<int> at its start,
+//-1 ends a list. The global free list is a Treiber stack of batches of BT_POOL_CACHE_BATCH
+//elements, so a thread cache refills or spills with a single compare and swap. A second
+//std::atomic<int> in the first element of a batch links to the next batch. The low 32 bits of
+//m_globalHead are the first batch, the high 32 bits a tag that changes with every update, so a
+//pop that read a stale link fails its compare and swap. Slabs are never freed while the pool
+//lives, so that stale read always hits valid memory.
+//The list of a thread cache packs its first element and its length into one atomic. Only the
+//owning thread pushes to it, so a pop of the owner can't be fooled by a list that went away and
+//came back, and other threads only ever take the whole list. A thread that finds the global list
+//empty takes the lists of the other caches, so elements freed by threads that no longer allocate
+//are not lost to it.
+
+static SIMD_FORCE_INLINE std::atomic<int>* btPoolNext(unsigned char* element)
+{
+	return reinterpret_cast<std::atomic<int>*>(element);
+}
+
+static SIMD_FORCE_INLINE std::atomic<int>* btPoolNextBatch(unsigned char* element)
+{
+	return reinterpret_cast<std::atomic<int>*>(element + sizeof(std::atomic<int>));
+}
+
+///creates the links of an element that becomes free, the memory held an object of the caller until now
+static SIMD_FORCE_INLINE std::atomic<int>* btPoolInitLinks(unsigned char* element, int next)
+{
+	new (element + sizeof(std::atomic<int>)) std::atomic<int>(-1);
+	return new (element) std::atomic<int>(next);
+}
+
+static SIMD_FORCE_INLINE unsigned long long btPoolPackHead(unsigned long long oldHead, int index)
+{
+	return (((oldHead >> 32) + 1) << 32) | (unsigned int)index;
+}
+
+static SIMD_FORCE_INLINE int btPoolHeadIndex(unsigned long long head)
+{
+	return (int)(unsigned int)(head & 0xffffffffULL);
+}
+
+static SIMD_FORCE_INLINE unsigned long long btPoolPackList(int head, int count)
+{
+	return ((unsigned long long)(unsigned int)count << 32) | (unsigned int)head;
+}
+
+static SIMD_FORCE_INLINE int btPoolListCount(unsigned long long list)
+{
+	return (int)(unsigned int)(list >> 32);
+}
+
+static const unsigned long long btPoolEmptyList = 0xffffffffULL;
+
+
+btPoolAllocatorMt::btPoolAllocatorMt(int elemSize, int elementsPerSlab)
+	:m_elemSize((btMax(elemSize, int(2 * sizeof(std::atomic<int>))) + 15) & ~15),
+	m_elementsPerSlab(btMax(elementsPerSlab, 1)),
+	m_numSlabs(0),
+	m_globalHead(0xffffffffULL)
+{
+	for (int i = 0; i < BT_POOL_MAX_SLABS; i++)
+	{
+		m_slabs[i] = 0;
+	}
+
+	m_caches = (btThreadCache*)btAlignedAlloc(sizeof(btThreadCache) * BT_MAX_THREAD_COUNT, 64);
+	for (int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		btThreadCache& cache = *new (&m_caches[i]) btThreadCache;
+		cache.m_list.store(btPoolEmptyList, std::memory_order_relaxed);
+		cache.m_numAllocations = 0;
+		cache.m_numFrees = 0;
+		cache.m_numOverflowAllocations = 0;
+		cache.m_slabHint = 0;
+	}
+
+	//the first slab is allocated up front, like the single block of btPoolAllocator
+	int head;
+	int count;
+	if (grow(head, count))
+	{
+		m_caches[0].m_list.store(btPoolPackList(head, count), std::memory_order_release);
+	}
+}
+
+btPoolAllocatorMt::~btPoolAllocatorMt()
+{
+	int numSlabs = m_numSlabs.load(std::memory_order_relaxed);
+	for (int i = 0; i < numSlabs; i++)
+	{
+		btAlignedFree(m_slabs[i]);
+	}
+	for (int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		m_caches[i].~btThreadCache();
+	}
+	btAlignedFree(m_caches);
+}
+
+int btPoolAllocatorMt::findElement(const void* ptr, int& slabHint) const
+{
+	const unsigned char* p = (const unsigned char*)ptr;
+	int numSlabs = m_numSlabs.load(std::memory_order_acquire);
+	int slabSize = m_elementsPerSlab * m_elemSize;
+	for (int j = 0; j < numSlabs; j++)
+	{
+		//start at the slab of the last hit, frees tend to come from the same slab
+		int i = (slabHint + j) % numSlabs;
+		if (p >= m_slabs[i] && p < m_slabs[i] + slabSize)
+		{
+			slabHint = i;
+			return i * m_elementsPerSlab + int(p - m_slabs[i]) / m_elemSize;
+		}
+	}
+	return -1;
+}
+
+int btPoolAllocatorMt::popGlobal()
+{
+	unsigned long long oldHead = m_globalHead.load(std::memory_order_acquire);
+	for (;;)
+	{
+		int batch = btPoolHeadIndex(oldHead);
+		if (batch < 0)
+		{
+			return -1;
+		}
+		int nextBatch = btPoolNextBatch(getElement(batch))->load(std::memory_order_relaxed);
+		if (m_globalHead.compare_exchange_weak(oldHead, btPoolPackHead(oldHead, nextBatch), std::memory_order_acquire, std::memory_order_acquire))
+		{
+			return batch;
+		}
+	}
+}
+
+void btPoolAllocatorMt::pushGlobal(int firstBatch, int lastBatch)
+{
+	std::atomic<int>* lastNextBatch = btPoolNextBatch(getElement(lastBatch));
+	unsigned long long oldHead = m_globalHead.load(std::memory_order_relaxed);
+	do
+	{
+		lastNextBatch->store(btPoolHeadIndex(oldHead), std::memory_order_relaxed);
+	} while (!m_globalHead.compare_exchange_weak(oldHead, btPoolPackHead(oldHead, firstBatch), std::memory_order_release, std::memory_order_relaxed));
+}
+
+bool btPoolAllocatorMt::reclaim(btThreadCache& cache, int& head, int& count)
+{
+	for (int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		btThreadCache& other = m_caches[i];
+		if (&other == &cache || btPoolListCount(other.m_list.load(std::memory_order_relaxed)) == 0)
+		{
+			continue;
+		}
+		unsigned long long list = other.m_list.exchange(btPoolEmptyList, std::memory_order_acquire);
+		if (btPoolListCount(list) > 0)
+		{
+			head = btPoolHeadIndex(list);
+			count = btPoolListCount(list);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool btPoolAllocatorMt::grow(int& head, int& count)
+{
+	btMutexLock(&m_growMutex);
+
+	//another thread may have grown the pool while this one waited
+	int batch = popGlobal();
+	if (batch >= 0)
+	{
+		head = batch;
+		count = BT_POOL_CACHE_BATCH;
+		btMutexUnlock(&m_growMutex);
+		return true;
+	}
+
+	int slab = m_numSlabs.load(std::memory_order_relaxed);
+	if (slab == BT_POOL_MAX_SLABS)
+	{
+		btMutexUnlock(&m_growMutex);
+		return false;
+	}
+
+	m_slabs[slab] = (unsigned char*)btAlignedAlloc(m_elemSize * m_elementsPerSlab, 16);
+	int first = slab * m_elementsPerSlab;
+	int end = first + m_elementsPerSlab;
+
+	//the cache of the growing thread takes what does not fill a whole batch, the rest
+	//is linked into batches and pushed to the global list at once
+	int numCached = m_elementsPerSlab - BT_POOL_CACHE_BATCH * ((m_elementsPerSlab - 1) / BT_POOL_CACHE_BATCH);
+	for (int i = first; i < end; i++)
+	{
+		int offset = i - first - numCached;
+		bool endOfList = (offset < 0) ? (i == first + numCached - 1) : (offset % BT_POOL_CACHE_BATCH == BT_POOL_CACHE_BATCH - 1);
+		unsigned char* element = getElement(i);
+		btPoolInitLinks(element, endOfList ? -1 : i + 1);
+		if (offset >= 0 && offset % BT_POOL_CACHE_BATCH == 0)
+		{
+			int nextBatch = i + BT_POOL_CACHE_BATCH;
+			btPoolNextBatch(element)->store(nextBatch < end ? nextBatch : -1, std::memory_order_relaxed);
+		}
+	}
+	m_numSlabs.store(slab + 1, std::memory_order_release);
+
+	if (numCached < m_elementsPerSlab)
+	{
+		pushGlobal(first + numCached, end - BT_POOL_CACHE_BATCH);
+	}
+	head = first;
+	count = numCached;
+
+	btMutexUnlock(&m_growMutex);
+	return true;
+}
+
+void btPoolAllocatorMt::spill(btThreadCache& cache)
+{
+	//take the list, so the batch can be cut from it without racing threads that reclaim it
+	unsigned long long list = cache.m_list.exchange(btPoolEmptyList, std::memory_order_acquire);
+	int head = btPoolHeadIndex(list);
+	int count = btPoolListCount(list);
+	if (count > 2 * BT_POOL_CACHE_BATCH)
+	{
+		int first = head;
+		int last = first;
+		for (int i = 1; i < BT_POOL_CACHE_BATCH; i++)
+		{
+			last = btPoolNext(getElement(last))->load(std::memory_order_relaxed);
+		}
+		head = btPoolNext(getElement(last))->load(std::memory_order_relaxed);
+		count -= BT_POOL_CACHE_BATCH;
+		btPoolNext(getElement(last))->store(-1, std::memory_order_relaxed);
+		pushGlobal(first, first);
+	}
+	//only the owner fills the list, other threads can only have emptied it meanwhile
+	cache.m_list.store(count ? btPoolPackList(head, count) : btPoolEmptyList, std::memory_order_release);
+}
+
+void* btPoolAllocatorMt::allocate(bool allowGrowth)
+{
+	btThreadCache& cache = m_caches[btGetCurrentThreadIndex()];
+	unsigned long long list = cache.m_list.load(std::memory_order_relaxed);
+	while (btPoolListCount(list) > 0)
+	{
+		int index = btPoolHeadIndex(list);
+		unsigned char* element = getElement(index);
+		int next = btPoolNext(element)->load(std::memory_order_relaxed);
+		//fails when another thread reclaimed the list meanwhile, then next may be stale
+		if (cache.m_list.compare_exchange_weak(list, btPoolPackList(next, btPoolListCount(list) - 1), std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			cache.m_numAllocations++;
+			return element;
+		}
+	}
+
+	int head;
+	int count;
+	int batch = popGlobal();
+	if (batch >= 0)
+	{
+		head = batch;
+		count = BT_POOL_CACHE_BATCH;
+	}
+	else if (!reclaim(cache, head, count) && !(allowGrowth && grow(head, count)))
+	{
+		if (!allowGrowth)
+		{
+			return 0;
+		}
+		cache.m_numAllocations++;
+		cache.m_numOverflowAllocations++;
+		return btAlignedAlloc(m_elemSize, 16);
+	}
+
+	//the cache is empty and only this thread fills it
+	unsigned char* element = getElement(head);
+	int next = btPoolNext(element)->load(std::memory_order_relaxed);
+	cache.m_list.store(count > 1 ? btPoolPackList(next, count - 1) : btPoolEmptyList, std::memory_order_release);
+	cache.m_numAllocations++;
+	return element;
+}
+
+void btPoolAllocatorMt::freeMemory(void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	btThreadCache& cache = m_caches[btGetCurrentThreadIndex()];
+	cache.m_numFrees++;
+
+	int index = findElement(ptr, cache.m_slabHint);
+	if (index < 0)
+	{
+		btAlignedFree(ptr);
+		return;
+	}
+
+	std::atomic<int>* next = btPoolInitLinks((unsigned char*)ptr, -1);
+	unsigned long long list = cache.m_list.load(std::memory_order_relaxed);
+	int count;
+	do
+	{
+		count = btPoolListCount(list) + 1;
+		next->store(btPoolHeadIndex(list), std::memory_order_relaxed);
+	} while (!cache.m_list.compare_exchange_weak(list, btPoolPackList(index, count), std::memory_order_release, std::memory_order_relaxed));
+
+	//hand a batch back when this thread frees more than it allocates
+	if (count > 2 * BT_POOL_CACHE_BATCH)
+	{
+		spill(cache);
+	}
+}
+
+bool btPoolAllocatorMt::validPtr(const void* ptr) const
+{
+	int slabHint = 0;
+	return ptr && findElement(ptr, slabHint) >= 0;
+}
+
+void btPoolAllocatorMt::getStats(btPoolAllocatorStats& stats) const
+{
+	stats.m_elementSize = m_elemSize;
+	stats.m_numSlabs = m_numSlabs;
+	stats.m_capacity = m_numSlabs * m_elementsPerSlab;
+	unsigned int numAllocations = 0;
+	unsigned int numFrees = 0;
+	unsigned int numOverflowAllocations = 0;
+	for (int i = 0; i < BT_MAX_THREAD_COUNT; i++)
+	{
+		const btThreadCache& cache = m_caches[i];
+		numAllocations += cache.m_numAllocations;
+		numFrees += cache.m_numFrees;
+		numOverflowAllocations += cache.m_numOverflowAllocations;
+	}
+	stats.m_numAllocations = int(numAllocations);
+	stats.m_numFrees = int(numFrees);
+	stats.m_numOverflowAllocations = int(numOverflowAllocations);
+	//the counters wrap around in long runs, their difference stays right
+	stats.m_usedCount = int(numAllocations - numFrees);
+}
@@ -0,0 +1,115 @@
+/*
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_POOL_ALLOCATOR_MT_H
+#define BT_POOL_ALLOCATOR_MT_H
+
+#include "btScalar.h"
+#include "btThreads.h"
+
+///upper limit on the number of slabs of a btPoolAllocatorMt, allocations past the last slab go to btAlignedAlloc
+#define BT_POOL_MAX_SLABS 256
+
+struct btPoolAllocatorStats
+{
+	int	m_elementSize;
+	int	m_numSlabs;
+	///elements in all slabs
+	int	m_capacity;
+	int	m_usedCount;
+	int	m_numAllocations;
+	int	m_numFrees;
+	///allocations that did not fit in BT_POOL_MAX_SLABS slabs
+	int	m_numOverflowAllocations;
+};
+
+///btPoolAllocatorMt is a fixed size element allocator that can be used from the threads of the task scheduler at once.
+///Each thread allocates from and frees to a small cache of its own, without locks. Caches refill from, and spill to, a global
+///lock-free list of batches of free elements. When that is empty the free elements of the other caches are reclaimed,
+///and only then the pool grows by another slab of elementsPerSlab elements.
+///Elements are rounded up to 16 bytes and 16 byte aligned. Memory is returned to the system only when the allocator is destroyed.
+class btPoolAllocatorMt
+{
+public:
+
+	struct btThreadCache
+	{
+		///the first free element in the low 32 bits and the number of free elements in the high 32 bits.
+		///Only the owning thread adds and takes single elements, threads that reclaim elements take the whole list at once
+		std::atomic<unsigned long long>	m_list;
+		unsigned int	m_numAllocations;
+		unsigned int	m_numFrees;
+		unsigned int	m_numOverflowAllocations;
+		int		m_slabHint;
+		int		m_padding[10];
+	};
+
+private:
+
+	int					m_elemSize;
+	int					m_elementsPerSlab;
+	unsigned char*		m_slabs[BT_POOL_MAX_SLABS];
+	std::atomic<int>	m_numSlabs;
+	btSpinMutex			m_growMutex;
+
+	///index of the first batch and an ABA tag, see btPoolAllocatorMt.cpp
+	ATTRIBUTE_ALIGNED16(std::atomic<unsigned long long>	m_globalHead);
+
+	btThreadCache*		m_caches;
+
+	unsigned char*	getElement(int index) const
+	{
+		return m_slabs[index / m_elementsPerSlab] + (index % m_elementsPerSlab) * m_elemSize;
+	}
+
+	int		findElement(const void* ptr, int& slabHint) const;
+	int		popGlobal();
+	void	pushGlobal(int firstBatch, int lastBatch);
+	bool	grow(int& head, int& count);
+	bool	reclaim(btThreadCache& cache, int& head, int& count);
+	void	spill(btThreadCache& cache);
+
+	btPoolAllocatorMt(const btPoolAllocatorMt&);
+	btPoolAllocatorMt& operator=(const btPoolAllocatorMt&);
+
+public:
+
+	btPoolAllocatorMt(int elemSize, int elementsPerSlab);
+
+	~btPoolAllocatorMt();
+
+	///returns 0 instead of growing the pool when allowGrowth is false and no element is free in any cache
+	void*	allocate(bool allowGrowth = true);
+
+	void	freeMemory(void* ptr);
+
+	///true if ptr points into one of the slabs
+	bool	validPtr(const void* ptr) const;
+
+	int		getElementSize() const
+	{
+		return m_elemSize;
+	}
+
+	int		getElementsPerSlab() const
+	{
+		return m_elementsPerSlab;
+	}
+
+	///sums the counters of all threads, call it while no other thread uses the pool
+	void	getStats(btPoolAllocatorStats& stats) const;
+};
+
+#endif //BT_POOL_ALLOCATOR_MT_H
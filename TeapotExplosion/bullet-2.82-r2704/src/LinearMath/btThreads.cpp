@@ -0,0 +1,568 @@
+/*
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btThreads.h"
+#include "btMinMax.h"
+#include "btAlignedObjectArray.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#if BT_MAX_THREAD_COUNT > 64
+#error "the thread indices are bits of an unsigned long long"
+#endif
+
+#define BT_UNASSIGNED_THREAD_INDEX 0xffffffffu
+
+static thread_local unsigned int gThreadIndex = BT_UNASSIGNED_THREAD_INDEX;
+static thread_local bool gIsWorkerThread = false;
+static thread_local bool gIsInParallelFor = false;
+
+///bit i is set while a thread holds index i
+static std::atomic<unsigned long long> gUsedThreadIndices(0);
+
+///releases the index of a thread when it exits
+struct btThreadIndexOwner
+{
+	unsigned int m_index;
+
+	btThreadIndexOwner()
+		:m_index(BT_UNASSIGNED_THREAD_INDEX)
+	{
+	}
+
+	~btThreadIndexOwner()
+	{
+		if (m_index != BT_UNASSIGNED_THREAD_INDEX)
+		{
+			gUsedThreadIndices.fetch_and(~(1ULL << m_index), std::memory_order_release);
+		}
+	}
+};
+
+static thread_local btThreadIndexOwner gThreadIndexOwner;
+
+///workers claim the lowest free index from 1 up, other threads 0 or else the highest free index,
+///so the indices of the workers of a scheduler stay below those of the threads that call it
+static unsigned int btClaimThreadIndex(bool isWorker)
+{
+	unsigned long long used = gUsedThreadIndices.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		int index = -1;
+		if (isWorker)
+		{
+			for (int i = 1; i < BT_MAX_THREAD_COUNT && index < 0; i++)
+			{
+				index = (used & (1ULL << i)) ? -1 : i;
+			}
+		}
+		else
+		{
+			for (int i = BT_MAX_THREAD_COUNT; i > 0 && index < 0; i--)
+			{
+				int candidate = i % BT_MAX_THREAD_COUNT;
+				index = (used & (1ULL << candidate)) ? -1 : candidate;
+			}
+		}
+		if (index < 0)
+		{
+			//more threads use Bullet at once than there are indices, this one shares the per-thread data of index 0
+			btAssert(!"btGetCurrentThreadIndex: more than BT_MAX_THREAD_COUNT threads");
+			return 0;
+		}
+		if (gUsedThreadIndices.compare_exchange_weak(used, used | (1ULL << index), std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			gThreadIndexOwner.m_index = (unsigned int)index;
+			return (unsigned int)index;
+		}
+	}
+}
+
+unsigned int btGetCurrentThreadIndex()
+{
+	unsigned int index = gThreadIndex;
+	if (index == BT_UNASSIGNED_THREAD_INDEX)
+	{
+		index = btClaimThreadIndex(false);
+		gThreadIndex = index;
+	}
+	return index;
+}
+
+bool btIsMainThread()
+{
+	return !gIsWorkerThread;
+}
+
+
+void btSpinMutex::lock()
+{
+	while (!tryLock())
+	{
+		std::this_thread::yield();
+	}
+}
+
+void btSpinMutex::unlock()
+{
+	m_lock.store(0, std::memory_order_release);
+}
+
+bool btSpinMutex::tryLock()
+{
+	int expected = 0;
+	return m_lock.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+}
+
+
+class btTaskSchedulerSequential : public btITaskScheduler
+{
+public:
+	btTaskSchedulerSequential()
+		:btITaskScheduler("Sequential")
+	{
+	}
+	virtual int getMaxNumThreads() const
+	{
+		return 1;
+	}
+	virtual int getNumThreads() const
+	{
+		return 1;
+	}
+	virtual void setNumThreads(int numThreads)
+	{
+		(void)numThreads;
+	}
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		(void)grainSize;
+		body.forLoop(iBegin, iEnd);
+	}
+};
+
+
+///btWorkItem is a queued task or a range of a parallel loop
+struct btWorkItem
+{
+	btITask* m_task;
+	btTaskGroup* m_group;
+
+	const btIParallelForBody* m_body;
+	int m_begin;
+	int m_end;
+	int m_grainSize;
+	///iterations of the loop that have not run yet
+	std::atomic<int>* m_numPendingIterations;
+};
+
+///btWorkQueue is the deque of one thread, the owner takes work from the back and idle threads steal from the front
+struct btWorkQueue
+{
+	btSpinMutex m_mutex;
+	btAlignedObjectArray<btWorkItem> m_items;
+	int m_head;
+	char m_padding[64];
+
+	btWorkQueue()
+		:m_head(0)
+	{
+	}
+
+	void push(const btWorkItem& item)
+	{
+		m_mutex.lock();
+		if (m_head == m_items.size())
+		{
+			m_head = 0;
+			m_items.resize(0);
+		}
+		m_items.push_back(item);
+		m_mutex.unlock();
+	}
+
+	bool popBack(btWorkItem& item)
+	{
+		m_mutex.lock();
+		bool found = m_items.size() > m_head;
+		if (found)
+		{
+			item = m_items[m_items.size() - 1];
+			m_items.pop_back();
+		}
+		m_mutex.unlock();
+		return found;
+	}
+
+	bool stealFront(btWorkItem& item)
+	{
+		m_mutex.lock();
+		bool found = m_items.size() > m_head;
+		if (found)
+		{
+			item = m_items[m_head++];
+		}
+		m_mutex.unlock();
+		return found;
+	}
+};
+
+
+class btTaskSchedulerDefault;
+
+static thread_local const btTaskSchedulerDefault* gWorkerScheduler = 0;
+static thread_local int gWorkerQueueIndex = 0;
+
+///btTaskSchedulerDefault is a work-stealing pool. A parallelFor queues the whole range on the calling thread,
+///which splits it in halves until a half is no larger than grainSize, queueing the upper halves. Idle workers
+///steal the oldest item of another thread, which is the largest remaining part of the range, and split it the same way.
+///Workers spin a little before they sleep, queueing work wakes them.
+class btTaskSchedulerDefault : public btITaskScheduler
+{
+	enum
+	{
+		NUM_IDLE_SPINS = 64
+	};
+
+	std::vector<std::thread> m_workers;
+	btWorkQueue m_queues[BT_MAX_THREAD_COUNT];
+	int m_numThreads;
+
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::atomic<unsigned int> m_workEpoch;
+	std::atomic<int> m_numSleepingWorkers;
+	bool m_exit;
+
+	///the queue of a worker, threads outside the scheduler share queue 0
+	int getQueueIndex() const
+	{
+		return gWorkerScheduler == this ? gWorkerQueueIndex : 0;
+	}
+
+	void pushWork(int queueIndex, const btWorkItem& item)
+	{
+		m_queues[queueIndex].push(item);
+		m_workEpoch.fetch_add(1);
+		if (m_numSleepingWorkers.load() > 0)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_wakeCondition.notify_all();
+		}
+	}
+
+	bool findWork(int queueIndex, btWorkItem& item)
+	{
+		if (m_queues[queueIndex].popBack(item))
+		{
+			return true;
+		}
+		for (int i = 1; i < m_numThreads; i++)
+		{
+			if (m_queues[(queueIndex + i) % m_numThreads].stealFront(item))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void runWork(int queueIndex, btWorkItem& item)
+	{
+		bool wasInParallelFor = gIsInParallelFor;
+		gIsInParallelFor = true;
+		if (item.m_task)
+		{
+			item.m_task->run();
+			item.m_group->taskFinished();
+		}
+		else
+		{
+			while (item.m_end - item.m_begin > item.m_grainSize)
+			{
+				int numChunks = (item.m_end - item.m_begin + item.m_grainSize - 1) / item.m_grainSize;
+				btWorkItem upperHalf = item;
+				upperHalf.m_begin = item.m_begin + (numChunks / 2) * item.m_grainSize;
+				item.m_end = upperHalf.m_begin;
+				pushWork(queueIndex, upperHalf);
+			}
+			item.m_body->forLoop(item.m_begin, item.m_end);
+			item.m_numPendingIterations->fetch_sub(item.m_end - item.m_begin, std::memory_order_release);
+		}
+		gIsInParallelFor = wasInParallelFor;
+	}
+
+	bool runOneWorkItem(int queueIndex)
+	{
+		btWorkItem item;
+		if (!findWork(queueIndex, item))
+		{
+			return false;
+		}
+		runWork(queueIndex, item);
+		return true;
+	}
+
+	void workerMain(int queueIndex)
+	{
+		gThreadIndex = btClaimThreadIndex(true);
+		gIsWorkerThread = true;
+		gIsInParallelFor = true;
+		gWorkerScheduler = this;
+		gWorkerQueueIndex = queueIndex;
+
+		for (;;)
+		{
+			unsigned int epoch = m_workEpoch.load();
+			bool foundWork = false;
+			for (int i = 0; i < NUM_IDLE_SPINS && !foundWork; i++)
+			{
+				foundWork = runOneWorkItem(queueIndex);
+				if (!foundWork)
+				{
+					std::this_thread::yield();
+				}
+			}
+			if (foundWork)
+			{
+				continue;
+			}
+
+			//announce the sleep before checking the epoch, so a concurrent pushWork either sees a sleeper or changes the epoch
+			std::unique_lock<std::mutex> lock(m_mutex);
+			if (m_exit)
+			{
+				break;
+			}
+			m_numSleepingWorkers.fetch_add(1);
+			if (m_workEpoch.load() == epoch)
+			{
+				m_wakeCondition.wait(lock);
+			}
+			m_numSleepingWorkers.fetch_sub(1);
+		}
+	}
+
+	void startWorkers(int numWorkers)
+	{
+		m_exit = false;
+		m_numThreads = numWorkers + 1;
+		for (int i = 0; i < numWorkers; i++)
+		{
+			m_workers.push_back(std::thread(&btTaskSchedulerDefault::workerMain, this, i + 1));
+		}
+	}
+
+	void stopWorkers()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_exit = true;
+		}
+		m_wakeCondition.notify_all();
+		for (size_t i = 0; i < m_workers.size(); i++)
+		{
+			m_workers[i].join();
+		}
+		m_workers.clear();
+		m_numThreads = 1;
+	}
+
+public:
+	btTaskSchedulerDefault()
+		:btITaskScheduler("Default"),
+		m_numThreads(1),
+		m_workEpoch(0),
+		m_numSleepingWorkers(0),
+		m_exit(false)
+	{
+		startWorkers(getMaxNumThreads() - 1);
+	}
+
+	virtual ~btTaskSchedulerDefault()
+	{
+		stopWorkers();
+	}
+
+	virtual int getMaxNumThreads() const
+	{
+		int numThreads = (int)std::thread::hardware_concurrency();
+		return btMax(1, btMin(numThreads, BT_MAX_THREAD_COUNT));
+	}
+
+	virtual int getNumThreads() const
+	{
+		return m_numThreads;
+	}
+
+	///must not be called while loops or tasks are running
+	virtual void setNumThreads(int numThreads)
+	{
+		numThreads = btMax(1, btMin(numThreads, BT_MAX_THREAD_COUNT));
+		if (numThreads != getNumThreads())
+		{
+			stopWorkers();
+			startWorkers(numThreads - 1);
+		}
+	}
+
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+	{
+		grainSize = btMax(1, grainSize);
+		if (m_workers.empty() || iEnd - iBegin <= grainSize)
+		{
+			body.forLoop(iBegin, iEnd);
+			return;
+		}
+
+		std::atomic<int> numPendingIterations(iEnd - iBegin);
+		btWorkItem item;
+		item.m_task = 0;
+		item.m_group = 0;
+		item.m_body = &body;
+		item.m_begin = iBegin;
+		item.m_end = iEnd;
+		item.m_grainSize = grainSize;
+		item.m_numPendingIterations = &numPendingIterations;
+
+		int queueIndex = getQueueIndex();
+		runWork(queueIndex, item);
+
+		while (numPendingIterations.load(std::memory_order_acquire) > 0)
+		{
+			if (!runOneWorkItem(queueIndex))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	virtual void runTask(btITask& task, btTaskGroup& group)
+	{
+		btWorkItem item;
+		item.m_task = &task;
+		item.m_group = &group;
+		item.m_body = 0;
+		item.m_begin = 0;
+		item.m_end = 0;
+		item.m_grainSize = 1;
+		item.m_numPendingIterations = 0;
+		pushWork(getQueueIndex(), item);
+	}
+
+	virtual void waitTaskGroup(btTaskGroup& group, int maxNumPending)
+	{
+		int queueIndex = getQueueIndex();
+		while (group.getNumPending() > maxNumPending)
+		{
+			if (!runOneWorkItem(queueIndex))
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+};
+
+
+void btITaskScheduler::runTask(btITask& task, btTaskGroup& group)
+{
+	task.run();
+	group.taskFinished();
+}
+
+void btITaskScheduler::waitTaskGroup(btTaskGroup& group, int maxNumPending)
+{
+	//runTask finished the tasks already
+	(void)maxNumPending;
+	btAssert(group.getNumPending() <= maxNumPending);
+}
+
+
+btTaskGroup::btTaskGroup()
+	:m_scheduler(btGetTaskScheduler()),
+	m_numPending(0)
+{
+}
+
+btTaskGroup::~btTaskGroup()
+{
+	btAssert(getNumPending() == 0);
+}
+
+void btTaskGroup::run(btITask& task)
+{
+	m_numPending.fetch_add(1, std::memory_order_relaxed);
+	m_scheduler->runTask(task, *this);
+}
+
+void btTaskGroup::wait(int maxNumPending)
+{
+	m_scheduler->waitTaskGroup(*this, maxNumPending);
+}
+
+int btTaskGroup::getNumPending() const
+{
+	return m_numPending.load(std::memory_order_acquire);
+}
+
+void btTaskGroup::taskFinished()
+{
+	m_numPending.fetch_sub(1, std::memory_order_release);
+}
+
+
+static btTaskSchedulerSequential gSequentialTaskScheduler;
+static btITaskScheduler* gTaskScheduler = &gSequentialTaskScheduler;
+
+void btSetTaskScheduler(btITaskScheduler* scheduler)
+{
+	gTaskScheduler = scheduler ? scheduler : &gSequentialTaskScheduler;
+}
+
+btITaskScheduler* btGetTaskScheduler()
+{
+	return gTaskScheduler;
+}
+
+btITaskScheduler* btGetSequentialTaskScheduler()
+{
+	return &gSequentialTaskScheduler;
+}
+
+btITaskScheduler* btCreateDefaultTaskScheduler()
+{
+	return new btTaskSchedulerDefault();
+}
+
+void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body)
+{
+	if (iBegin >= iEnd)
+	{
+		return;
+	}
+	if (gIsInParallelFor)
+	{
+		body.forLoop(iBegin, iEnd);
+		return;
+	}
+
+	gIsInParallelFor = true;
+	gTaskScheduler->parallelFor(iBegin, iEnd, grainSize, body);
+	gIsInParallelFor = false;
+}
@@ -0,0 +1,156 @@
+/*
+Copyright (c) 2003-2014 Erwin Coumans  http://bullet.googlecode.com
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+
+#ifndef BT_THREADS_H
+#define BT_THREADS_H
+
+#include "btScalar.h" // has definitions like SIMD_FORCE_INLINE
+
+#include <atomic>
+
+///upper limit on the number of threads that use Bullet at once, the workers of the task schedulers included
+#define BT_MAX_THREAD_COUNT 64
+
+///index of the calling thread, below BT_MAX_THREAD_COUNT and never shared by two threads that run at the same time.
+///Workers of the task scheduler take the lowest free indices from 1 up. Other threads claim an index the first time
+///they ask, the first of them 0 and the others the highest free one, and release it when they exit.
+///Per-thread data indexed by it is handed on to the next thread that claims the index.
+///A thread that finds no free index asserts and shares index 0
+unsigned int btGetCurrentThreadIndex();
+///true for every thread that is not a worker of the task scheduler
+bool btIsMainThread();
+
+///btSpinMutex is a small lock for short critical sections, it busy-waits instead of sleeping
+class btSpinMutex
+{
+	std::atomic<int> m_lock;
+
+public:
+	btSpinMutex()
+		:m_lock(0)
+	{
+	}
+	void lock();
+	void unlock();
+	bool tryLock();
+};
+
+SIMD_FORCE_INLINE void btMutexLock(btSpinMutex* mutex)
+{
+	mutex->lock();
+}
+
+SIMD_FORCE_INLINE void btMutexUnlock(btSpinMutex* mutex)
+{
+	mutex->unlock();
+}
+
+SIMD_FORCE_INLINE bool btMutexTryLock(btSpinMutex* mutex)
+{
+	return mutex->tryLock();
+}
+
+///btIParallelForBody is the loop body of btParallelFor, forLoop is called with disjoint sub-ranges from several threads at once
+class btIParallelForBody
+{
+public:
+	virtual ~btIParallelForBody() {}
+	virtual void forLoop(int iBegin, int iEnd) const = 0;
+};
+
+class btTaskGroup;
+
+///btITask is a unit of work for btTaskGroup::run, run is called once on some thread of the task scheduler
+class btITask
+{
+public:
+	virtual ~btITask() {}
+	virtual void run() = 0;
+};
+
+///btITaskScheduler runs the parallel loops of Bullet. Only one scheduler is active at a time, see btSetTaskScheduler
+class btITaskScheduler
+{
+	const char* m_name;
+
+public:
+	btITaskScheduler(const char* name)
+		:m_name(name)
+	{
+	}
+	virtual ~btITaskScheduler() {}
+
+	const char* getName() const
+	{
+		return m_name;
+	}
+
+	virtual int getMaxNumThreads() const = 0;
+	virtual int getNumThreads() const = 0;
+	virtual void setNumThreads(int numThreads) = 0;
+	virtual void parallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body) = 0;
+
+	///queues task for group, the default implementation runs it right away on the calling thread
+	virtual void runTask(btITask& task, btTaskGroup& group);
+	///returns once no more than maxNumPending tasks of group are unfinished, the calling thread runs queued work meanwhile
+	virtual void waitTaskGroup(btTaskGroup& group, int maxNumPending);
+};
+
+///btTaskGroup runs tasks on the task scheduler that was set when the group was created. The tasks may run in any order
+///and on any thread, including the one that waits for them. Loops started with btParallelFor from inside a task run
+///sequentially. Wait for all tasks before the group or the tasks are destroyed.
+class btTaskGroup
+{
+	btITaskScheduler* m_scheduler;
+	std::atomic<int> m_numPending;
+
+public:
+	btTaskGroup();
+	~btTaskGroup();
+
+	btITaskScheduler* getTaskScheduler() const
+	{
+		return m_scheduler;
+	}
+
+	void run(btITask& task);
+
+	///returns once no more than maxNumPending of the tasks are unfinished, wait() returns once all are finished
+	void wait(int maxNumPending = 0);
+
+	int getNumPending() const;
+
+	///called by the task scheduler after a task of this group has finished
+	void taskFinished();
+};
+
+///the scheduler used by btParallelFor, the sequential scheduler unless another one is set
+void btSetTaskScheduler(btITaskScheduler* scheduler);
+btITaskScheduler* btGetTaskScheduler();
+
+///runs every loop on the calling thread
+btITaskScheduler* btGetSequentialTaskScheduler();
+
+///a work-stealing thread pool scheduler built on std::thread, one worker per hardware thread after the calling thread.
+///Every thread has a deque of loop ranges and tasks, idle threads steal the oldest and largest pieces of work.
+///The caller owns the returned scheduler and must delete it after it is no longer set.
+btITaskScheduler* btCreateDefaultTaskScheduler();
+
+///splits [iBegin, iEnd) into chunks of grainSize and runs body on them with the current task scheduler.
+///Nested calls from inside a body run sequentially.
+void btParallelFor(int iBegin, int iEnd, int grainSize, const btIParallelForBody& body);
+
+#endif //BT_THREADS_H
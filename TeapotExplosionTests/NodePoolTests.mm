@@ -0,0 +1,98 @@
+//
+//  NodePoolTests.mm
+//  TeapotExplosionTests
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Node.hpp"
+#include "NodePool.hpp"
+
+#include <vector>
+
+// Bullet's running count of btAlignedAlloc calls (btAlignedAllocator.cpp).
+extern int gNumAlignedAllocs;
+
+static const unsigned long NUMBER_OF_NODES = 10000;
+
+@interface NodePoolTests : XCTestCase
+
+@end
+
+@implementation NodePoolTests
+
+- (void)testPooledNodesAreAligned {
+    jamesfolk::NodePool pool(256);
+    std::vector<jamesfolk::Node*> nodes;
+
+    pool.create(1000, nodes);
+    XCTAssertEqual(nodes.size(), 1000ul);
+    XCTAssertEqual(pool.numberOfNodes(), 1000ul);
+    XCTAssertEqual(pool.numberOfSlabs(), 4ul);
+
+    for (std::vector<jamesfolk::Node*>::iterator i = nodes.begin(); i != nodes.end(); i++)
+    {
+        XCTAssertEqual(((size_t)(*i)) % 16, 0ul);
+        XCTAssertTrue(pool.owns(*i));
+        XCTAssertEqual((*i)->getScale(), btVector3(1.0f, 1.0f, 1.0f));
+    }
+
+    pool.destroy(nodes);
+    XCTAssertTrue(nodes.empty());
+    XCTAssertEqual(pool.numberOfNodes(), 0ul);
+
+    // Freed slots are reused before a new slab is added.
+    pool.create(1000, nodes);
+    XCTAssertEqual(pool.numberOfSlabs(), 4ul);
+    pool.destroy(nodes);
+}
+
+- (void)testAllocationCount {
+    std::vector<jamesfolk::Node*> nodes;
+    nodes.reserve(NUMBER_OF_NODES);
+
+    int allocations = gNumAlignedAllocs;
+    for (unsigned long i = 0; i < NUMBER_OF_NODES; i++)
+        nodes.push_back(new jamesfolk::Node());
+    const int heapAllocations = gNumAlignedAllocs - allocations;
+    for (std::vector<jamesfolk::Node*>::iterator i = nodes.begin(); i != nodes.end(); i++)
+        delete *i;
+    nodes.clear();
+
+    jamesfolk::NodePool pool(1024);
+    allocations = gNumAlignedAllocs;
+    pool.create(NUMBER_OF_NODES, nodes);
+    const int poolAllocations = gNumAlignedAllocs - allocations;
+    pool.destroy(nodes);
+
+    NSLog(@"%lu nodes: %d aligned allocations with new, %d from the pool (%lu slabs)",
+          NUMBER_OF_NODES, heapAllocations, poolAllocations, pool.numberOfSlabs());
+
+    XCTAssertEqual(heapAllocations, (int)NUMBER_OF_NODES);
+    XCTAssertEqual(poolAllocations, (int)pool.numberOfSlabs());
+}
+
+- (void)testPerformanceHeapNodes {
+    [self measureBlock:^{
+        std::vector<jamesfolk::Node*> nodes;
+        nodes.reserve(NUMBER_OF_NODES);
+        for (unsigned long i = 0; i < NUMBER_OF_NODES; i++)
+            nodes.push_back(new jamesfolk::Node());
+        for (std::vector<jamesfolk::Node*>::iterator i = nodes.begin(); i != nodes.end(); i++)
+            delete *i;
+    }];
+}
+
+- (void)testPerformancePooledNodes {
+    [self measureBlock:^{
+        jamesfolk::NodePool pool(1024);
+        std::vector<jamesfolk::Node*> nodes;
+        pool.create(NUMBER_OF_NODES, nodes);
+        pool.destroy(nodes);
+    }];
+}
+
+@end
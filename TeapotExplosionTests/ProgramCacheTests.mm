@@ -0,0 +1,268 @@
+//
+//  ProgramCacheTests.mm
+//  TeapotExplosionTests
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "ProgramCache.hpp"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const GLenum STUB_BINARY_FORMAT = 0x8741;
+
+// Stands in for the driver: a program binary is the program name followed by the driver identity.
+class StubBackend : public jamesfolk::ProgramCache::Backend
+{
+public:
+    StubBackend(const std::string &identity):
+    m_Identity(identity),
+    m_Supported(true),
+    m_RejectBinaries(false),
+    m_NumCreated(0)
+    {
+    }
+
+    virtual std::string getDriverIdentity()const
+    {
+        return m_Identity;
+    }
+
+    virtual bool isProgramBinarySupported()const
+    {
+        return m_Supported;
+    }
+
+    virtual bool getProgramBinary(GLuint program, GLenum &format, std::vector<unsigned char> &binary)const
+    {
+        const std::string data = std::to_string(program) + '@' + m_Identity;
+        format = STUB_BINARY_FORMAT;
+        binary.assign(data.begin(), data.end());
+        return true;
+    }
+
+    virtual GLuint createProgramFromBinary(GLenum format, const std::vector<unsigned char> &binary)const
+    {
+        const std::string data(binary.begin(), binary.end());
+        const std::string::size_type separator = data.find('@');
+        if(m_RejectBinaries || format != STUB_BINARY_FORMAT || separator == std::string::npos ||
+           data.substr(separator + 1) != m_Identity)
+            return 0;
+
+        m_NumCreated++;
+        return (GLuint)std::stoul(data.substr(0, separator));
+    }
+
+    std::string m_Identity;
+    bool m_Supported;
+    bool m_RejectBinaries;
+    mutable int m_NumCreated;
+};
+
+static const char *VERTEX_SOURCE = "attribute vec4 inPosition;\nvoid main() { gl_Position = inPosition; }\n";
+static const char *FRAGMENT_SOURCE = "uniform lowp vec4 color;\nvoid main() { gl_FragColor = color; }\n";
+
+@interface ProgramCacheTests : XCTestCase
+{
+    NSString *_directory;
+}
+
+@end
+
+@implementation ProgramCacheTests
+
+- (void)setUp {
+    [super setUp];
+    _directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[[NSUUID UUID] UUIDString]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:nil];
+}
+
+- (void)tearDown {
+    [[NSFileManager defaultManager] removeItemAtPath:_directory error:nil];
+    [super tearDown];
+}
+
+- (NSArray *)entries {
+    NSArray *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_directory error:nil];
+    return [files filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"self ENDSWITH '.program'"]];
+}
+
+- (void)storeProgram:(GLuint)program inCache:(jamesfolk::ProgramCache &)cache {
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    attributes.insert(jamesfolk::ProgramCache::LocationPair("inPosition", 0));
+    uniforms.insert(jamesfolk::ProgramCache::LocationPair("color", 3));
+    XCTAssertTrue(cache.store(program, VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms));
+}
+
+- (void)testMissThenHit {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    XCTAssertTrue(cache.isEnabled());
+
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+    XCTAssertEqual(backend.m_NumCreated, 0);
+
+    [self storeProgram:42 inCache:cache];
+    XCTAssertEqual([[self entries] count], 1ul);
+
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 42u);
+    XCTAssertEqual(backend.m_NumCreated, 1);
+    XCTAssertEqual(attributes.size(), 1ul);
+    XCTAssertEqual(attributes["inPosition"], 0);
+    XCTAssertEqual(uniforms.size(), 1ul);
+    XCTAssertEqual(uniforms["color"], 3);
+}
+
+- (void)testOtherSourcesMiss {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    [self storeProgram:42 inCache:cache];
+
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, std::string(FRAGMENT_SOURCE) + "\n", attributes, uniforms), 0u);
+    XCTAssertEqual(cache.load(FRAGMENT_SOURCE, VERTEX_SOURCE, attributes, uniforms), 0u);
+    // The same concatenation split differently is another program.
+    XCTAssertEqual(cache.load(std::string(VERTEX_SOURCE) + FRAGMENT_SOURCE, "", attributes, uniforms), 0u);
+    XCTAssertEqual(backend.m_NumCreated, 0);
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 42u);
+}
+
+- (void)testDriverIdentityChange {
+    StubBackend oldDriver("Stub GPU\n1.0\n");
+    {
+        jamesfolk::ProgramCache cache(&oldDriver);
+        cache.setDirectory([_directory UTF8String]);
+        [self storeProgram:42 inCache:cache];
+    }
+
+    // An updated driver misses instead of being handed a binary it can't use.
+    StubBackend newDriver("Stub GPU\n2.0\n");
+    {
+        jamesfolk::ProgramCache cache(&newDriver);
+        cache.setDirectory([_directory UTF8String]);
+        jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+        XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+        XCTAssertEqual(newDriver.m_NumCreated, 0);
+        [self storeProgram:43 inCache:cache];
+        XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 43u);
+    }
+    XCTAssertEqual([[self entries] count], 2ul);
+
+    {
+        jamesfolk::ProgramCache cache(&oldDriver);
+        cache.setDirectory([_directory UTF8String]);
+        jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+        XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 42u);
+    }
+}
+
+- (void)testRejectedEntryIsDiscarded {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    [self storeProgram:42 inCache:cache];
+
+    backend.m_RejectBinaries = true;
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+    XCTAssertEqual([[self entries] count], 0ul);
+
+    backend.m_RejectBinaries = false;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+    XCTAssertTrue(attributes.empty());
+    XCTAssertTrue(uniforms.empty());
+}
+
+- (void)testTruncatedEntryMisses {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    [self storeProgram:42 inCache:cache];
+
+    NSString *path = [_directory stringByAppendingPathComponent:[[self entries] firstObject]];
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    [[data subdataWithRange:NSMakeRange(0, [data length] - 3)] writeToFile:path atomically:YES];
+
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+    XCTAssertEqual(backend.m_NumCreated, 0);
+    XCTAssertEqual([[self entries] count], 0ul);
+}
+
+- (void)testConcurrentStores {
+    StubBackend backend("Stub GPU\n1.0\n");
+    const int numThreads = 4;
+    const int numStores = 50;
+    std::atomic<int> numStored(0);
+    std::vector<std::thread> threads;
+    for(int t = 0; t < numThreads; t++)
+    {
+        // Every thread has its own cache on the same directory, like two processes of the app.
+        threads.push_back(std::thread([&, t]() {
+            jamesfolk::ProgramCache cache(&backend);
+            cache.setDirectory([_directory UTF8String]);
+            jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+            for(int i = 0; i < numStores; i++)
+            {
+                if(cache.store(100 + t, VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms))
+                    numStored++;
+            }
+        }));
+    }
+    for(size_t t = 0; t < threads.size(); t++)
+        threads[t].join();
+
+    XCTAssertEqual(numStored.load(), numThreads * numStores);
+    NSArray *files = [[NSFileManager defaultManager] contentsOfDirectoryAtPath:_directory error:nil];
+    XCTAssertEqual([files count], 1ul);
+    XCTAssertEqual([[self entries] count], 1ul);
+
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    const GLuint program = cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms);
+    XCTAssertTrue(program >= 100 && program < 100 + numThreads);
+}
+
+- (void)testInvalidate {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    [self storeProgram:42 inCache:cache];
+
+    cache.invalidate(VERTEX_SOURCE, FRAGMENT_SOURCE);
+    XCTAssertEqual([[self entries] count], 0ul);
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+}
+
+- (void)testDisabled {
+    StubBackend backend("Stub GPU\n1.0\n");
+    jamesfolk::ProgramCache::LocationMap attributes, uniforms;
+    {
+        // No directory.
+        jamesfolk::ProgramCache cache(&backend);
+        XCTAssertFalse(cache.isEnabled());
+        XCTAssertFalse(cache.store(42, VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms));
+    }
+
+    // No GL_OES_get_program_binary.
+    backend.m_Supported = false;
+    jamesfolk::ProgramCache cache(&backend);
+    cache.setDirectory([_directory UTF8String]);
+    XCTAssertFalse(cache.isEnabled());
+    XCTAssertFalse(cache.store(42, VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms));
+    XCTAssertEqual(cache.load(VERTEX_SOURCE, FRAGMENT_SOURCE, attributes, uniforms), 0u);
+    XCTAssertEqual([[self entries] count], 0ul);
+}
+
+@end
@@ -0,0 +1,163 @@
+//
+//  TangentSpaceTests.mm
+//  TeapotExplosionTests
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Geometry.hpp"
+#include "TangentSpace.hpp"
+#include "btThreads.h"
+
+#include <map>
+#include <math.h>
+#include <utility>
+#include <vector>
+
+// Enough quads that every pass is split into several chunks.
+static const int GRID_SIZE = 64;
+static const int NUMBER_OF_THREADS = 4;
+static const float EPSILON = 1e-4f;
+
+// A GRID_SIZE x GRID_SIZE height field as an un-indexed triangle list. The
+// texture coordinates follow x and y, so the tangent follows x and the
+// bitangent follows y. With 'bumpy' set the surface is a sine wave in x with
+// per-vertex normals, so neighbouring welds get different frames.
+static void buildGrid(bool bumpy, std::vector<jamesfolk::TexturedColoredVertex> &vertices)
+{
+    vertices.clear();
+    vertices.reserve(GRID_SIZE * GRID_SIZE * 6);
+
+    static const int corners[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+    for (int y = 0; y < GRID_SIZE; y++)
+    {
+        for (int x = 0; x < GRID_SIZE; x++)
+        {
+            for (int corner = 0; corner < 6; corner++)
+            {
+                const float u = float(x + corners[corner][0]) / GRID_SIZE;
+                const float v = float(y + corners[corner][1]) / GRID_SIZE;
+                const float height = bumpy ? 0.1f * sinf(u * SIMD_2_PI) : 0.0f;
+                const float slope = bumpy ? 0.1f * SIMD_2_PI * cosf(u * SIMD_2_PI) : 0.0f;
+
+                jamesfolk::TexturedColoredVertex vertex;
+                vertex.vertex = btVector3(u, v, height);
+                vertex.texture = btVector2(u, v);
+                vertex.normal = btVector3(-slope, 0.0f, 1.0f).normalized();
+                vertices.push_back(vertex);
+            }
+        }
+    }
+}
+
+// Generates the frames on a task scheduler, and puts back the scheduler the app set.
+static void generate(btITaskScheduler *scheduler, std::vector<jamesfolk::TexturedColoredVertex> &vertices)
+{
+    btITaskScheduler *previousScheduler = btGetTaskScheduler();
+    btSetTaskScheduler(scheduler);
+
+    jamesfolk::TangentSpace tangentSpace;
+    tangentSpace.generate(&vertices[0], (GLsizei)vertices.size());
+
+    btSetTaskScheduler(previousScheduler);
+}
+
+// Compares x, y and z only; the fourth float of a btVector3 is padding.
+static bool sameVector(const btVector3 &a, const btVector3 &b)
+{
+    return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+@interface TangentSpaceTests : XCTestCase
+
+@end
+
+@implementation TangentSpaceTests {
+    btITaskScheduler *_scheduler;
+}
+
+- (void)setUp {
+    [super setUp];
+    _scheduler = btCreateDefaultTaskScheduler();
+    // Several workers even on a single core, so the chunks run on several threads.
+    _scheduler->setNumThreads(NUMBER_OF_THREADS);
+}
+
+- (void)tearDown {
+    delete _scheduler;
+    _scheduler = NULL;
+    [super tearDown];
+}
+
+- (void)testFlatGridFollowsTextureAxes {
+    std::vector<jamesfolk::TexturedColoredVertex> vertices;
+    buildGrid(false, vertices);
+    generate(_scheduler, vertices);
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        XCTAssertLessThan((vertices[i].tangent - btVector3(1.0f, 0.0f, 0.0f)).length(), EPSILON, @"vertex %zu", i);
+        XCTAssertLessThan((vertices[i].bitangent - btVector3(0.0f, 1.0f, 0.0f)).length(), EPSILON, @"vertex %zu", i);
+    }
+}
+
+- (void)testFramesAreOrthonormal {
+    std::vector<jamesfolk::TexturedColoredVertex> vertices;
+    buildGrid(true, vertices);
+    generate(_scheduler, vertices);
+
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const jamesfolk::TexturedColoredVertex &vertex = vertices[i];
+        XCTAssertEqualWithAccuracy(vertex.tangent.length(), 1.0f, EPSILON, @"vertex %zu", i);
+        XCTAssertEqualWithAccuracy(vertex.bitangent.length(), 1.0f, EPSILON, @"vertex %zu", i);
+        XCTAssertEqualWithAccuracy(vertex.tangent.dot(vertex.normal), 0.0f, EPSILON, @"vertex %zu", i);
+        XCTAssertEqualWithAccuracy(vertex.bitangent.dot(vertex.normal), 0.0f, EPSILON, @"vertex %zu", i);
+        // Right handed, the bitangent follows +v.
+        XCTAssertGreaterThan(vertex.bitangent.y(), 0.0f, @"vertex %zu", i);
+    }
+}
+
+- (void)testWeldedVerticesShareFrame {
+    std::vector<jamesfolk::TexturedColoredVertex> vertices;
+    buildGrid(true, vertices);
+    generate(_scheduler, vertices);
+
+    // Inner grid points are a corner of up to six triangles, with the same
+    // position, texture coordinate and normal in each of them.
+    std::map<std::pair<float, float>, size_t> firstVertex;
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const std::pair<float, float> key(vertices[i].texture.x(), vertices[i].texture.y());
+        std::pair<std::map<std::pair<float, float>, size_t>::iterator, bool> result =
+        firstVertex.insert(std::make_pair(key, i));
+        if(result.second)
+            continue;
+
+        const size_t first = result.first->second;
+        XCTAssertTrue(sameVector(vertices[first].tangent, vertices[i].tangent), @"vertices %zu, %zu", first, i);
+        XCTAssertTrue(sameVector(vertices[first].bitangent, vertices[i].bitangent), @"vertices %zu, %zu", first, i);
+    }
+    XCTAssertEqual(firstVertex.size(), (size_t)((GRID_SIZE + 1) * (GRID_SIZE + 1)));
+}
+
+- (void)testSchedulerDoesNotChangeFrames {
+    std::vector<jamesfolk::TexturedColoredVertex> sequential;
+    buildGrid(true, sequential);
+    generate(btGetSequentialTaskScheduler(), sequential);
+
+    std::vector<jamesfolk::TexturedColoredVertex> parallel;
+    buildGrid(true, parallel);
+    generate(_scheduler, parallel);
+
+    for (size_t i = 0; i < sequential.size(); i++)
+    {
+        XCTAssertTrue(sameVector(sequential[i].tangent, parallel[i].tangent), @"vertex %zu", i);
+        XCTAssertTrue(sameVector(sequential[i].bitangent, parallel[i].bitangent), @"vertex %zu", i);
+    }
+}
+
+@end
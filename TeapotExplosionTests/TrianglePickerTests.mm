@@ -0,0 +1,98 @@
+//
+//  TrianglePickerTests.mm
+//  TeapotExplosionTests
+//
+//  Created by James Folk on 10/19/26.
+//  Copyright © 2026 NJLIGames Ltd. All rights reserved.
+//
+
+#import <XCTest/XCTest.h>
+
+#include "Geometry.hpp"
+#include "TrianglePicker.hpp"
+#include "World.hpp"
+
+// The tests run inside the app, so they pick against the teapots the world
+// has loaded. Moved instances are put back before a test returns.
+@interface TrianglePickerTests : XCTestCase
+
+@end
+
+@implementation TrianglePickerTests
+
+- (GLsizei)firstReferencedInstance:(const jamesfolk::Geometry &)geometry {
+    for (GLsizei i = 0; i < geometry.numberOfInstances(); i++)
+    {
+        if(geometry.isInstanceReferenced(i))
+            return i;
+    }
+    return -1;
+}
+
+- (void)moveInstance:(GLsizei)instanceIdx ofGeometry:(jamesfolk::Geometry &)geometry by:(const btVector3 &)offset {
+    btTransform transform(btTransform::getIdentity());
+    transform.setOrigin(offset);
+    for (GLsizei i = 0; i < geometry.numberOfVertices(); i++)
+        geometry.transformVertice(instanceIdx, i, transform);
+}
+
+// A short ray through the center of a triangle along its normal.
+- (void)rayThrough:(const jamesfolk::Geometry &)geometry instance:(GLsizei)instanceIdx from:(btVector3 &)from to:(btVector3 &)to {
+    const btVector3 a(geometry.getVertexWorldPosition(instanceIdx, 0));
+    const btVector3 b(geometry.getVertexWorldPosition(instanceIdx, 1));
+    const btVector3 c(geometry.getVertexWorldPosition(instanceIdx, 2));
+    const btVector3 center((a + b + c) / 3.0f);
+    const btVector3 normal((b - a).cross(c - a).normalized());
+    from = center + normal * 0.01f;
+    to = center - normal * 0.01f;
+}
+
+- (void)testUnchangedGeometryIsNotRefit {
+    jamesfolk::Geometry *geometry = jamesfolk::World::getInstance()->getGeometry();
+    jamesfolk::TrianglePicker picker;
+
+    picker.update(*geometry);
+    XCTAssertGreaterThan(picker.numberOfTriangles(), 0ul);
+    XCTAssertEqual(picker.numberOfRefits(), picker.numberOfTriangles());
+
+    // No vertex transform was written, so nothing is read or refit.
+    picker.update(*geometry);
+    XCTAssertEqual(picker.numberOfRefits(), 0ul);
+}
+
+- (void)testMovedInstanceIsRefitOnNextUpdate {
+    jamesfolk::Geometry *geometry = jamesfolk::World::getInstance()->getGeometry();
+    const GLsizei instanceIdx = [self firstReferencedInstance:*geometry];
+    XCTAssertGreaterThanOrEqual(instanceIdx, 0);
+    if(instanceIdx < 0)
+        return;
+
+    jamesfolk::TrianglePicker picker;
+    picker.update(*geometry);
+
+    btVector3 from, to;
+    [self rayThrough:*geometry instance:instanceIdx from:from to:to];
+    jamesfolk::TrianglePicker::Hit hit;
+    XCTAssertTrue(picker.pick(from, to, hit));
+    XCTAssertEqual(hit.instance, instanceIdx);
+    XCTAssertEqual(hit.triangle, 0);
+
+    // Several frames of movement are caught up by one refit.
+    const btVector3 offset(0.0f, 100.0f, 0.0f);
+    for (int frame = 0; frame < 4; frame++)
+        [self moveInstance:instanceIdx ofGeometry:*geometry by:offset / 4.0f];
+
+    picker.update(*geometry);
+    XCTAssertEqual(picker.numberOfRefits(), (unsigned long)geometry->numberOfVertices() / 3);
+    XCTAssertTrue(!picker.pick(from, to, hit) || hit.instance != instanceIdx);
+
+    // The offset is applied before the vertex transform, so find the triangle again.
+    [self rayThrough:*geometry instance:instanceIdx from:from to:to];
+    XCTAssertTrue(picker.pick(from, to, hit));
+    XCTAssertEqual(hit.instance, instanceIdx);
+    XCTAssertEqual(hit.triangle, 0);
+
+    [self moveInstance:instanceIdx ofGeometry:*geometry by:-offset];
+}
+
+@end